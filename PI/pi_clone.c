@@ -1,14 +1,23 @@
 #include <config.h>
 #include <PI/target/pi_clone_imp.h>
 
+#include "p4rt-pre.h"
+
 pi_status_t _pi_clone_session_set(
         pi_session_handle_t session_handle, pi_dev_tgt_t dev_tgt,
         pi_clone_session_id_t clone_session_id,
         const pi_clone_session_config_t *clone_session_config) {
     (void)session_handle;
     (void)dev_tgt;
-    (void)clone_session_id;
-    (void)clone_session_config;
+
+    if (p4rt_pre_clone_session_set(clone_session_id,
+                                   clone_session_config->eg_port_valid,
+                                   clone_session_config->eg_port,
+                                   clone_session_config->mc_grp_id_valid,
+                                   clone_session_config->mc_grp_id)) {
+        return PI_STATUS_TARGET_ERROR;
+    }
+
     return PI_STATUS_SUCCESS;
 }
 
@@ -17,7 +26,10 @@ pi_status_t _pi_clone_session_reset(pi_session_handle_t session_handle,
                                     pi_clone_session_id_t clone_session_id) {
     (void)session_handle;
     (void)dev_tgt;
-    (void)clone_session_id;
+
+    if (p4rt_pre_clone_session_reset(clone_session_id)) {
+        return PI_STATUS_TARGET_ERROR;
+    }
 
     return PI_STATUS_SUCCESS;
 }
@@ -1,19 +1,8 @@
 #include <config.h>
 #include <PI/target/pi_counter_imp.h>
 
-pi_status_t _pi_counter_read(pi_session_handle_t session_handle,
-                             pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
-                             size_t index, int flags,
-                             pi_counter_data_t *counter_data) {
-    (void)session_handle;
-    (void)dev_tgt;
-    (void)counter_id;
-    (void)index;
-    (void)flags;
-    (void)counter_data;
-
-    return PI_STATUS_SUCCESS;
-}
+/* _pi_counter_read() is implemented in p4rt/p4rt.c, where it serves
+ * reads from a whole-array snapshot taken in one datapath pass. */
 
 pi_status_t _pi_counter_write(pi_session_handle_t session_handle,
                               pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
@@ -2,6 +2,22 @@
 #include <PI/pi_mc.h>
 #include <PI/target/pi_mc_imp.h>
 
+#include "p4rt-pre.h"
+#include "util.h"
+
+/* Translates a PI egress port list into the uint32_t form that the
+ * packet replication engine stores.  Caller frees the result. */
+static uint32_t *
+mc_ports_to_u32(size_t eg_ports_count, const pi_mc_port_t *eg_ports) {
+    uint32_t *ports = xmalloc(eg_ports_count * sizeof *ports);
+    size_t i;
+
+    for (i = 0; i < eg_ports_count; i++) {
+        ports[i] = eg_ports[i];
+    }
+    return ports;
+}
+
 pi_status_t _pi_mc_session_init(pi_mc_session_handle_t *session_handle) {
     *session_handle = 0;
 
@@ -19,8 +35,8 @@ pi_status_t _pi_mc_grp_create(pi_mc_session_handle_t session_handle,
                               pi_mc_grp_handle_t *grp_handle) {
     (void)session_handle;
     (void)dev_id;
-    (void)grp_id;
-    (void)grp_handle;
+
+    *grp_handle = p4rt_pre_group_create(grp_id);
 
     return PI_STATUS_SUCCESS;
 }
@@ -30,7 +46,10 @@ pi_status_t _pi_mc_grp_delete(pi_mc_session_handle_t session_handle,
                               pi_mc_grp_handle_t grp_handle) {
     (void)session_handle;
     (void)dev_id;
-    (void)grp_handle;
+
+    if (p4rt_pre_group_delete(grp_handle)) {
+        return PI_STATUS_TARGET_ERROR;
+    }
 
     return PI_STATUS_SUCCESS;
 }
@@ -40,12 +59,19 @@ pi_status_t _pi_mc_node_create(pi_mc_session_handle_t session_handle,
                                size_t eg_ports_count,
                                const pi_mc_port_t *eg_ports,
                                pi_mc_node_handle_t *node_handle) {
+    uint32_t *ports = mc_ports_to_u32(eg_ports_count, eg_ports);
+    uint32_t handle;
+    int error;
+
     (void)session_handle;
     (void)dev_id;
-    (void)rid;
-    (void)eg_ports_count;
-    (void)eg_ports;
-    (void)node_handle;
+
+    error = p4rt_pre_node_create(rid, eg_ports_count, ports, &handle);
+    free(ports);
+    if (error) {
+        return PI_STATUS_TARGET_ERROR;
+    }
+    *node_handle = handle;
 
     return PI_STATUS_SUCCESS;
 }
@@ -55,11 +81,17 @@ pi_status_t _pi_mc_node_modify(pi_mc_session_handle_t session_handle,
                                pi_mc_node_handle_t node_handle,
                                size_t eg_ports_count,
                                const pi_mc_port_t *eg_ports) {
+    uint32_t *ports = mc_ports_to_u32(eg_ports_count, eg_ports);
+    int error;
+
     (void)session_handle;
     (void)dev_id;
-    (void)node_handle;
-    (void)eg_ports_count;
-    (void)eg_ports;
+
+    error = p4rt_pre_node_modify(node_handle, eg_ports_count, ports);
+    free(ports);
+    if (error) {
+        return PI_STATUS_TARGET_ERROR;
+    }
 
     return PI_STATUS_SUCCESS;
 }
@@ -69,7 +101,10 @@ pi_status_t _pi_mc_node_delete(pi_mc_session_handle_t session_handle,
                                pi_mc_node_handle_t node_handle) {
     (void)session_handle;
     (void)dev_id;
-    (void)node_handle;
+
+    if (p4rt_pre_node_delete(node_handle)) {
+        return PI_STATUS_TARGET_ERROR;
+    }
 
     return PI_STATUS_SUCCESS;
 }
@@ -80,8 +115,10 @@ pi_status_t _pi_mc_grp_attach_node(pi_mc_session_handle_t session_handle,
                                    pi_mc_node_handle_t node_handle) {
     (void)session_handle;
     (void)dev_id;
-    (void)grp_handle;
-    (void)node_handle;
+
+    if (p4rt_pre_group_attach(grp_handle, node_handle)) {
+        return PI_STATUS_TARGET_ERROR;
+    }
 
     return PI_STATUS_SUCCESS;
 }
@@ -92,8 +129,10 @@ pi_status_t _pi_mc_grp_detach_node(pi_mc_session_handle_t session_handle,
                                    pi_mc_node_handle_t node_handle) {
     (void)session_handle;
     (void)dev_id;
-    (void)grp_handle;
-    (void)node_handle;
+
+    if (p4rt_pre_group_detach(grp_handle, node_handle)) {
+        return PI_STATUS_TARGET_ERROR;
+    }
 
     return PI_STATUS_SUCCESS;
 }
@@ -796,6 +796,19 @@ struct ovs_action_push_tnl {
 	uint32_t tnl_type;     /* For logging. */
 	uint32_t header[TNL_PUSH_HEADER_SIZE / 4];
 };
+
+/*
+ * struct ovs_action_sticky - %OVS_ACTION_ATTR_STICKY_LEARN and
+ * %OVS_ACTION_ATTR_STICKY_LOOKUP.
+ * @table_id: Sticky table to operate on.  Tables are created on first use.
+ * @ttl_ms: For a learn, the entry lifetime in milliseconds.  For a lookup,
+ * a nonzero value re-arms a hit entry with this lifetime; zero leaves the
+ * entry's expiry unchanged.
+ */
+struct ovs_action_sticky {
+	uint32_t table_id;
+	uint32_t ttl_ms;
+};
 #endif
 
 /**
@@ -990,6 +1003,10 @@ struct check_pkt_len_arg {
  * of actions if greater than the specified packet length, else execute
  * another set of actions.
  * @OVS_ACTION_ATTR_DROP: Explicit drop action.
+ * @OVS_ACTION_ATTR_STICKY_LEARN: Learn the packet's source address into a
+ * sticky table with a TTL, recording the packet's mark as the value.
+ * @OVS_ACTION_ATTR_STICKY_LOOKUP: Look the packet's source address up in a
+ * sticky table and, on a hit, store the learned value in the packet's mark.
  */
 
 enum ovs_action_attr {
@@ -1024,6 +1041,8 @@ enum ovs_action_attr {
 	OVS_ACTION_ATTR_TUNNEL_POP,    /* u32 port number. */
 	OVS_ACTION_ATTR_DROP,          /* u32 xlate_error. */
 	OVS_ACTION_ATTR_LB_OUTPUT,     /* u32 bond-id. */
+	OVS_ACTION_ATTR_STICKY_LEARN,  /* struct ovs_action_sticky. */
+	OVS_ACTION_ATTR_STICKY_LOOKUP, /* struct ovs_action_sticky. */
 #endif
 	__OVS_ACTION_ATTR_MAX,	      /* Nothing past this will be accepted
 				       * from userspace. */
@@ -136,6 +136,7 @@ enum {
 };
 char *json_to_string(const struct json *, int flags);
 void json_to_ds(const struct json *, int flags, struct ds *);
+size_t json_serialized_length(const struct json *);
 
 /* JSON string formatting operations. */
 
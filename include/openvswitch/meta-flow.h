@@ -695,6 +695,7 @@ enum OVS_PACKED_ENUM mf_field_id {
      * NXM: none.
      * OXM: OXM_OF_METADATA(2) since OF1.2 and v1.8.
      * OF1.1: bitwise mask.
+     * Prefix lookup member: metadata.
      */
     MFF_METADATA,
 
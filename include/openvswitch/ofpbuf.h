@@ -124,7 +124,7 @@ struct ofpbuf *ofpbuf_clone_with_headroom(const struct ofpbuf *,
 struct ofpbuf *ofpbuf_clone_data(const void *, size_t);
 struct ofpbuf *ofpbuf_clone_data_with_headroom(const void *, size_t,
                                                size_t headroom);
-static inline void ofpbuf_delete(struct ofpbuf *);
+void ofpbuf_delete(struct ofpbuf *);
 
 static inline void *ofpbuf_at(const struct ofpbuf *, size_t offset,
                               size_t size);
@@ -165,15 +165,6 @@ static inline bool ofpbuf_equal(const struct ofpbuf *, const struct ofpbuf *);
 static inline bool ofpbuf_oversized(const struct ofpbuf *ofpacts);
 
 
-/* Frees memory that 'b' points to, as well as 'b' itself. */
-static inline void ofpbuf_delete(struct ofpbuf *b)
-{
-    if (b) {
-        ofpbuf_uninit(b);
-        free(b);
-    }
-}
-
 /* If 'b' contains at least 'offset + size' bytes of data, returns a pointer to
  * byte 'offset'.  Otherwise, returns a null pointer. */
 static inline void *ofpbuf_at(const struct ofpbuf *b, size_t offset,
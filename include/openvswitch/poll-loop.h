@@ -73,6 +73,27 @@ void poll_timer_wait_until_at(long long int msec, const char *where);
 void poll_immediate_wake_at(const char *where);
 #define poll_immediate_wake() poll_immediate_wake_at(OVS_SOURCE_LOCATOR)
 
+/* Scheduling classes for poll waiters.
+ *
+ * Events registered while a class is in effect (see poll_set_wait_class())
+ * are tagged with it.  The poll loop itself wakes up for any ready event
+ * regardless of class; the class of the event that caused a wakeup is
+ * reported by poll_woke_class(), so that a main loop can service critical
+ * work first and defer housekeeping.  The poll loop also keeps coverage
+ * counters of wakeups per class and detects starvation: a critical waiter
+ * found already ready after a long processing burst was sitting unserviced
+ * for that whole burst.  Lower values are more critical. */
+enum poll_wait_class {
+    POLL_WAIT_CRITICAL,     /* Datapath-critical work, e.g. upcall and
+                             * revalidation kicks. */
+    POLL_WAIT_DEFAULT,
+    POLL_WAIT_BACKGROUND,   /* Housekeeping that may be deferred. */
+    POLL_N_WAIT_CLASSES
+};
+
+void poll_set_wait_class(enum poll_wait_class);
+enum poll_wait_class poll_woke_class(void);
+
 /* Wait until an event occurs. */
 void poll_block(void);
 
@@ -0,0 +1,215 @@
+/* Copyright (c) 2013 Nicira, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+/* This implementation of the async-append.h interface uses Linux io_uring. */
+
+#include "async-append.h"
+
+#include <errno.h>
+#include <liburing.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "byteq.h"
+#include "util.h"
+
+/* Maximum number of bytes of buffered data. */
+enum { BUFFER_SIZE = 65536 };
+
+/* Submission queue depth, which also bounds the number of writes in flight.
+ * A deep queue means that even a burst of small appends is absorbed without
+ * waiting for completions. */
+enum { SQ_DEPTH = 256 };
+BUILD_ASSERT_DECL(IS_POW2(SQ_DEPTH));
+
+struct async_append {
+    int fd;
+
+    struct io_uring ring;
+    bool registered;            /* 'buffer' registered with the kernel? */
+
+    /* Ring of writes in flight, in submission order.  Completions can arrive
+     * out of order, so each slot records its size and completion separately
+     * and buffer space is reclaimed in submission order. */
+    size_t nbytes[SQ_DEPTH];
+    bool done[SQ_DEPTH];
+    unsigned int op_head, op_tail;
+
+    uint8_t *buffer;
+    struct byteq byteq;
+};
+
+struct async_append *
+async_append_create(int fd)
+{
+    struct async_append *ap;
+    struct iovec iov;
+
+    ap = xmalloc(sizeof *ap);
+    if (io_uring_queue_init(SQ_DEPTH, &ap->ring, 0) < 0) {
+        free(ap);
+        return NULL;
+    }
+    ap->fd = fd;
+    ap->op_head = ap->op_tail = 0;
+    memset(ap->done, 0, sizeof ap->done);
+    ap->buffer = xmalloc(BUFFER_SIZE);
+    byteq_init(&ap->byteq, ap->buffer, BUFFER_SIZE);
+
+    /* Registering the buffer lets the kernel skip per-write page pinning.  If
+     * registration fails (e.g. a RLIMIT_MEMLOCK too small), fall back to
+     * ordinary write requests on the same buffer. */
+    iov.iov_base = ap->buffer;
+    iov.iov_len = BUFFER_SIZE;
+    ap->registered = !io_uring_register_buffers(&ap->ring, &iov, 1);
+
+    return ap;
+}
+
+void
+async_append_destroy(struct async_append *ap)
+{
+    if (ap) {
+        async_append_flush(ap);
+        if (ap->registered) {
+            io_uring_unregister_buffers(&ap->ring);
+        }
+        io_uring_queue_exit(&ap->ring);
+        free(ap->buffer);
+        free(ap);
+    }
+}
+
+static bool
+async_append_is_full(const struct async_append *ap)
+{
+    return (ap->op_head - ap->op_tail >= SQ_DEPTH
+            || byteq_is_full(&ap->byteq));
+}
+
+static bool
+async_append_is_empty(const struct async_append *ap)
+{
+    return byteq_is_empty(&ap->byteq);
+}
+
+static void
+async_append_wait(struct async_append *ap)
+{
+    int n = 0;
+
+    while (!async_append_is_empty(ap)) {
+        struct io_uring_cqe *cqe;
+        unsigned int slot;
+
+        if (io_uring_peek_cqe(&ap->ring, &cqe)) {
+            if (n > 0) {
+                return;
+            }
+            /* Push any requests that a previous, transiently failed submit
+             * left queued, then block.  Without this a failed submit could
+             * leave us waiting for a completion that was never started. */
+            io_uring_submit(&ap->ring);
+            if (io_uring_wait_cqe(&ap->ring, &cqe) < 0) {
+                continue;
+            }
+        }
+
+        /* As with the POSIX AIO backend, there is nothing sensible to do
+         * about a failed log write, so the result is ignored and the buffer
+         * space reclaimed either way. */
+        slot = (uintptr_t) io_uring_cqe_get_data(cqe);
+        ap->done[slot & (SQ_DEPTH - 1)] = true;
+        io_uring_cqe_seen(&ap->ring, cqe);
+
+        while (ap->op_tail != ap->op_head
+               && ap->done[ap->op_tail & (SQ_DEPTH - 1)]) {
+            unsigned int tail = ap->op_tail & (SQ_DEPTH - 1);
+
+            byteq_advance_tail(&ap->byteq, ap->nbytes[tail]);
+            ap->done[tail] = false;
+            ap->op_tail++;
+        }
+        n++;
+    }
+}
+
+void
+async_append_write(struct async_append *ap, const void *data_, size_t size)
+{
+    const uint8_t *data = data_;
+
+    while (size > 0) {
+        struct io_uring_sqe *sqe;
+        size_t chunk_size;
+        void *chunk;
+
+        while (async_append_is_full(ap)) {
+            async_append_wait(ap);
+        }
+
+        chunk = byteq_head(&ap->byteq);
+        chunk_size = byteq_headroom(&ap->byteq);
+        if (chunk_size > size) {
+            chunk_size = size;
+        }
+        memcpy(chunk, data, chunk_size);
+
+        sqe = io_uring_get_sqe(&ap->ring);
+        if (!sqe) {
+            /* The submission queue is full of unsubmitted requests.  Push
+             * them; if that does not free up an entry, fall back to a
+             * synchronous write, like the POSIX AIO backend does when
+             * aio_write() fails. */
+            io_uring_submit(&ap->ring);
+            sqe = io_uring_get_sqe(&ap->ring);
+            if (!sqe) {
+                async_append_flush(ap);
+                ignore(write(ap->fd, data, size));
+                return;
+            }
+        }
+
+        /* 'fd' is in append mode, so the offset here is immaterial. */
+        if (ap->registered) {
+            io_uring_prep_write_fixed(sqe, ap->fd, chunk, chunk_size, 0, 0);
+        } else {
+            io_uring_prep_write(sqe, ap->fd, chunk, chunk_size, 0);
+        }
+        io_uring_sqe_set_data(sqe, (void *) (uintptr_t) ap->op_head);
+        ap->nbytes[ap->op_head & (SQ_DEPTH - 1)] = chunk_size;
+
+        data += chunk_size;
+        size -= chunk_size;
+        byteq_advance_head(&ap->byteq, chunk_size);
+        ap->op_head++;
+    }
+
+    /* One submit for the whole batch.  A transient failure here is harmless:
+     * the requests stay queued and async_append_wait() resubmits them. */
+    io_uring_submit(&ap->ring);
+}
+
+void
+async_append_flush(struct async_append *ap)
+{
+    while (!async_append_is_empty(ap)) {
+        async_append_wait(ap);
+    }
+}
@@ -38,7 +38,8 @@ lib_libopenvswitchavx512_la_CFLAGS = \
 	-fPIC \
 	$(AM_CFLAGS)
 lib_libopenvswitchavx512_la_SOURCES = \
-	lib/dpif-netdev-lookup-avx512-gather.c
+	lib/dpif-netdev-lookup-avx512-gather.c \
+	lib/dpif-netdev-extract-avx512.c
 lib_libopenvswitchavx512_la_LDFLAGS = \
 	-static
 endif
@@ -62,6 +63,8 @@ lib_libopenvswitch_la_SOURCES = \
 	lib/bpf/lookup3.h \
 	lib/bpf/ubpf_jit_x86_64.c \
 	lib/bpf/ubpf_jit_x86_64.h \
+	lib/bpf/ubpf_jit_arm64.c \
+	lib/bpf/ubpf_jit_arm64.h \
 	lib/bpf/ubpf_array.c \
 	lib/bpf/ubpf_array.h \
 	lib/bpf/ubpf_bf.c \
@@ -71,8 +74,30 @@ lib_libopenvswitch_la_SOURCES = \
 	lib/bpf/ubpf_hashmap.c \
 	lib/bpf/ubpf_hashmap.h \
 	lib/bpf/ubpf_loader.c \
+	lib/bpf/ubpf_lpm_dir24.c \
+	lib/bpf/ubpf_lpm_dir24.h \
 	lib/bpf/ubpf_lpm_trie.c \
 	lib/bpf/ubpf_lpm_trie.h \
+	lib/bpf/ubpf_digest.c \
+	lib/bpf/ubpf_digest.h \
+	lib/bpf/ubpf_expiry.c \
+	lib/bpf/ubpf_expiry.h \
+	lib/bpf/ubpf_packetin.c \
+	lib/bpf/ubpf_packetin.h \
+	lib/bpf/ubpf_mem.c \
+	lib/bpf/ubpf_mem.h \
+	lib/bpf/ubpf_meter.c \
+	lib/bpf/ubpf_meter.h \
+	lib/bpf/ubpf_opt.c \
+	lib/bpf/ubpf_opt.h \
+	lib/bpf/ubpf_percpu.c \
+	lib/bpf/ubpf_percpu.h \
+	lib/bpf/ubpf_act_prof.c \
+	lib/bpf/ubpf_act_prof.h \
+	lib/bpf/ubpf_range.c \
+	lib/bpf/ubpf_range.h \
+	lib/bpf/ubpf_ternary.c \
+	lib/bpf/ubpf_ternary.h \
 	lib/bpf.c \
 	lib/bpf.h \
 	lib/bundle.c \
@@ -131,6 +156,9 @@ lib_libopenvswitch_la_SOURCES = \
 	lib/dpif-netdev-lookup.c \
 	lib/dpif-netdev-lookup-autovalidator.c \
 	lib/dpif-netdev-lookup-generic.c \
+	lib/dpif-netdev-lookup-jit.c \
+	lib/dpif-netdev-extract.h \
+	lib/dpif-netdev-extract.c \
 	lib/dpif-netdev.c \
 	lib/dpif-netdev.h \
 	lib/dpif-netdev-private.h \
@@ -183,6 +211,8 @@ lib_libopenvswitch_la_SOURCES = \
 	lib/lockfile.h \
 	lib/mac-learning.c \
 	lib/mac-learning.h \
+	lib/malloc-cache.c \
+	lib/malloc-cache.h \
 	lib/match.c \
 	lib/mcast-snooping.c \
 	lib/mcast-snooping.h \
@@ -284,7 +314,13 @@ lib_libopenvswitch_la_SOURCES = \
 	lib/ovsdb-types.h \
 	lib/ox-stat.c \
 	lib/ox-stat.h \
+	lib/p4rt-arena.c \
+	lib/p4rt-arena.h \
 	lib/p4rt-objects.h \
+	lib/p4rt-offload.c \
+	lib/p4rt-offload.h \
+	lib/p4rt-pre.c \
+	lib/p4rt-pre.h \
 	lib/packets.c \
 	lib/packets.h \
 	lib/pcap-file.c \
@@ -327,6 +363,10 @@ lib_libopenvswitch_la_SOURCES = \
 	lib/sort.h \
 	lib/sset.c \
 	lib/sset.h \
+	lib/stats-shm.c \
+	lib/stats-shm.h \
+	lib/sticky-table.c \
+	lib/sticky-table.h \
 	lib/stp.c \
 	lib/stp.h \
 	lib/stream-fd.c \
@@ -505,11 +545,15 @@ lib_libopenvswitch_la_SOURCES += \
 	lib/wmi.h
 endif
 
+if HAVE_LIBURING
+lib_libopenvswitch_la_SOURCES += lib/async-append-uring.c
+else
 if HAVE_POSIX_AIO
 lib_libopenvswitch_la_SOURCES += lib/async-append-aio.c
 else
 lib_libopenvswitch_la_SOURCES += lib/async-append-null.c
 endif
+endif
 
 if HAVE_IF_DL
 lib_libopenvswitch_la_SOURCES += \
@@ -15,10 +15,26 @@
 #include <config.h>
 #include <stdio.h>
 #include <errno.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#ifdef HAVE_NUMA_H
+#include <numa.h>
+#endif
 
 #include "bpf.h"
+#include "bpf/ubpf_digest.h"
+#include "bpf/ubpf_hashmap.h"
+#include "bpf/ubpf_lpm_dir24.h"
+#include "bpf/ubpf_lpm_trie.h"
+#include "bpf/ubpf_meter.h"
+#include "bpf/ubpf_range.h"
+#include "bpf/ubpf_ternary.h"
 
 #include "openvswitch/vlog.h"
+#include "ovs-numa.h"
+#include "ovs-thread.h"
+#include "sticky-table.h"
 
 VLOG_DEFINE_THIS_MODULE(bpf)
 
@@ -63,9 +79,55 @@ load_bpf_prog(struct ubpf_vm *vm, size_t code_len, const char *code)
     return true;
 }
 
+/* Returns the calling thread's stats shard, or NULL for maps that do not
+ * carry stats (only maps built by the ELF loader allocate the shards). */
+static inline struct ubpf_map_stats_shard *
+ubpf_map_stats_shard(const struct ubpf_map *map)
+{
+    return map->stats
+           ? &map->stats[ovsthread_id_self() % UBPF_MAP_STATS_SHARDS]
+           : NULL;
+}
+
+/* PMDs are pinned, so the node a thread runs on never changes: resolve it
+ * once per thread.  An unpinned thread that later migrates just keeps
+ * reading a replica that is no longer local, which only costs latency. */
+DEFINE_STATIC_PER_THREAD_DATA(int, numa_node_cache, OVS_NUMA_UNSPEC);
+
+static int
+ubpf_thread_numa_node(void)
+{
+    int *node = numa_node_cache_get();
+
+    if (OVS_UNLIKELY(*node == OVS_NUMA_UNSPEC)) {
+#ifdef __linux__
+        int id = ovs_numa_get_numa_id(sched_getcpu());
+
+        *node = id == OVS_NUMA_UNSPEC ? -1 : id;
+#else
+        *node = -1;
+#endif
+    }
+    return *node;
+}
+
+/* Returns the clone of 'map' local to this thread's NUMA node, or 'map'
+ * itself for threads whose node is unknown. */
+static inline const struct ubpf_map *
+ubpf_map_local_replica(const struct ubpf_map *map)
+{
+    const struct ubpf_map_replicas *replicas = map->numa_replicas;
+    int node = ubpf_thread_numa_node();
+
+    return node >= 0 && node < replicas->n ? replicas->rep[node] : map;
+}
+
 void *
 ubpf_map_lookup(const struct ubpf_map *map, void *key)
 {
+    struct ubpf_map_stats_shard *stats;
+    void *value;
+
     if (OVS_UNLIKELY(!map)) {
         return NULL;
     }
@@ -75,9 +137,85 @@ ubpf_map_lookup(const struct ubpf_map *map, void *key)
     if (OVS_UNLIKELY(!key)) {
         return NULL;
     }
-    return map->ops.map_lookup(map, key);
+    if (OVS_UNLIKELY(map->numa_replicas)) {
+        map = ubpf_map_local_replica(map);
+    }
+
+    value = map->ops.map_lookup(map, key);
+
+    stats = ubpf_map_stats_shard(map);
+    if (OVS_LIKELY(stats)) {
+        if (value) {
+            stats->hits++;
+        } else {
+            stats->misses++;
+        }
+    }
+    return value;
 }
 
+/* Looks up 'count' keys laid out back to back in 'keys' and fills
+ * 'values' with a value pointer, or NULL, for each.  Hash maps resolve
+ * the whole batch through cmap_find_batch(), which prefetches all the
+ * buckets before touching any of them; other map types fall back to one
+ * lookup per key.  P4 programs doing resubmit-style multi-table chains
+ * can collect their keys and issue one call instead of N. */
+uint64_t
+ubpf_map_lookup_bulk(const struct ubpf_map *map, void *keys, uint64_t count,
+                     void **values)
+{
+    struct ubpf_map_stats_shard *stats;
+    uint64_t hits = 0;
+
+    if (OVS_UNLIKELY(!map || !keys || !values)) {
+        return 0;
+    }
+    if (OVS_UNLIKELY(map->numa_replicas)) {
+        map = ubpf_map_local_replica(map);
+    }
+    if (map->type == UBPF_MAP_TYPE_HASHMAP) {
+        ubpf_hashmap_lookup_bulk(map, keys, count, values);
+    } else {
+        if (OVS_UNLIKELY(!map->ops.map_lookup)) {
+            return 0;
+        }
+        for (uint64_t i = 0; i < count; i++) {
+            values[i] = map->ops.map_lookup(map, (char *) keys
+                                                 + i * map->key_size);
+        }
+    }
+
+    for (uint64_t i = 0; i < count; i++) {
+        hits += values[i] != NULL;
+    }
+    stats = ubpf_map_stats_shard(map);
+    if (OVS_LIKELY(stats)) {
+        stats->hits += hits;
+        stats->misses += count - hits;
+    }
+
+    return count;
+}
+
+static struct ubpf_func_proto ubpf_map_lookup_bulk_proto = {
+    .func = (ext_func)ubpf_map_lookup_bulk,
+    .arg_types = {
+                MAP_PTR,
+                PKT_PTR | MAP_VALUE_PTR | STACK_PTR | UNKNOWN,
+                IMM,
+                STACK_PTR | UNKNOWN,
+                0xff,
+            },
+    .arg_sizes = {
+                0xff,
+                SIZE_PTR_MAX,
+                SIZE_64,
+                SIZE_PTR_MAX,
+                0xff,
+            },
+    .ret = UNKNOWN,
+};
+
 static struct ubpf_func_proto ubpf_map_lookup_proto = {
     .func = (ext_func)ubpf_map_lookup,
     .arg_types = {
@@ -100,6 +238,9 @@ static struct ubpf_func_proto ubpf_map_lookup_proto = {
 int
 ubpf_map_update(struct ubpf_map *map, const void *key, void *item)
 {
+    struct ubpf_map staged_map;
+    int err;
+
     if (OVS_UNLIKELY(!map)) {
         return -1;
     }
@@ -112,7 +253,27 @@ ubpf_map_update(struct ubpf_map *map, const void *key, void *item)
     if (OVS_UNLIKELY(!item)) {
         return -4;
     }
-    return map->ops.map_update(map, key, item);
+    if (OVS_UNLIKELY(map->staged)) {
+        /* A replace transaction is open: writes build the next version
+         * aside while lookups keep hitting the live table. */
+        staged_map = *map;
+        staged_map.data = map->staged;
+        map = &staged_map;
+    }
+    err = map->ops.map_update(map, key, item);
+    if (OVS_UNLIKELY(map->numa_replicas) && !err) {
+        /* Keep every node-local clone in step with the primary.  Each
+         * clone takes the same RCU-safe update the primary did, so its
+         * readers see either the old or the new entry, never a torn
+         * one; a reader can briefly see a different version than a
+         * reader on another node, which read-mostly tables tolerate. */
+        const struct ubpf_map_replicas *replicas = map->numa_replicas;
+
+        for (int i = 0; i < replicas->n; i++) {
+            replicas->rep[i]->ops.map_update(replicas->rep[i], key, item);
+        }
+    }
+    return err;
 }
 
 static struct ubpf_func_proto ubpf_map_update_proto = {
@@ -148,6 +309,26 @@ ubpf_map_dump(struct ubpf_map *map, char *data)
     return map->ops.map_dump(map, data);
 }
 
+/* Streaming counterpart of ubpf_map_dump(): copies up to 'max_entries'
+ * (key, value) pairs into 'data', resuming from '*cursor', which must be
+ * zeroed before the first call.  Returns the number of pairs copied (zero
+ * once the iteration is complete) or a negative value if 'map' does not
+ * support streaming dumps. */
+int
+ubpf_map_dump_next(struct ubpf_map *map, struct ubpf_map_cursor *cursor,
+                   unsigned int max_entries, char *data)
+{
+    if (OVS_UNLIKELY(!map)) {
+        return -1;
+    }
+
+    if (OVS_UNLIKELY(!map->ops.map_dump_next)) {
+        return -2;
+    }
+
+    return map->ops.map_dump_next(map, cursor, max_entries, data);
+}
+
 unsigned int
 ubpf_map_size(struct ubpf_map *map)
 {
@@ -199,6 +380,9 @@ static struct ubpf_func_proto ubpf_map_add_proto = {
 int
 ubpf_map_delete(struct ubpf_map *map, const void *key)
 {
+    struct ubpf_map staged_map;
+    int err;
+
     if (OVS_UNLIKELY(!map)) {
         return -1;
     }
@@ -208,7 +392,254 @@ ubpf_map_delete(struct ubpf_map *map, const void *key)
     if (OVS_UNLIKELY(!key)) {
         return -3;
     }
-    return map->ops.map_delete(map, key);
+    if (OVS_UNLIKELY(map->staged)) {
+        staged_map = *map;
+        staged_map.data = map->staged;
+        map = &staged_map;
+    }
+    err = map->ops.map_delete(map, key);
+    if (OVS_UNLIKELY(map->numa_replicas) && !err) {
+        const struct ubpf_map_replicas *replicas = map->numa_replicas;
+
+        for (int i = 0; i < replicas->n; i++) {
+            replicas->rep[i]->ops.map_delete(replicas->rep[i], key);
+        }
+    }
+    return err;
+}
+
+/* Ages out entries of 'map' that go 'secs' seconds without a lookup hit,
+ * 0 to disable.  Only hash maps keep last-hit stamps, so any other type
+ * returns -2.  'prog_id' tags the eviction notifications the expiry
+ * sweeper emits (see ubpf_expiry.h). */
+int
+ubpf_map_set_idle_timeout(struct ubpf_map *map, uint32_t secs,
+                          uint32_t prog_id)
+{
+    if (!map) {
+        return -1;
+    }
+    if (map->type != UBPF_MAP_TYPE_HASHMAP) {
+        return -2;
+    }
+    if (map->numa_replicas) {
+        /* The sweeper evicts from the primary only, so aging a
+         * replicated table would leave stale entries on the clones. */
+        return -2;
+    }
+    ubpf_hashmap_set_idle_timeout(map, secs, prog_id);
+    return 0;
+}
+
+/* Builds a fresh, empty table of 'map''s type and geometry for a replace
+ * transaction.  Only the table-style types support this; the sketches and
+ * the per-thread replicated types do not. */
+static void *
+ubpf_map_data_create(const struct ubpf_map *map)
+{
+    struct ubpf_map_def def = {
+        .type = map->type,
+        .key_size = map->key_size,
+        .value_size = map->value_size,
+        .max_entries = map->max_entries,
+    };
+
+    switch (map->type) {
+    case UBPF_MAP_TYPE_HASHMAP:
+        return ubpf_hashmap_create(&def);
+    case UBPF_MAP_TYPE_LPM_TRIE:
+        return ubpf_lpm_trie_create(&def);
+    case UBPF_MAP_TYPE_LPM_DIR24:
+        return ubpf_lpm_dir24_create(&def);
+    case UBPF_MAP_TYPE_TERNARY:
+        return ubpf_ternary_create(&def);
+    case UBPF_MAP_TYPE_RANGE:
+        return ubpf_range_create(&def);
+    default:
+        return NULL;
+    }
+}
+
+/* Opens a double-buffered replace transaction on 'map': an empty table is
+ * built aside, and until the transaction ends every update and delete
+ * lands there while lookups keep hitting the live table.  A full-table
+ * refresh thus streams in against the staged copy and goes live in the
+ * single pointer flip of ubpf_map_replace_commit(), with no window where
+ * readers see a half-populated table.
+ *
+ * Callers serialize transactions against other control-plane writers of
+ * 'map'.  Returns 0 on success, -1 with no map, -2 for a map type without
+ * replace support and -3 if a transaction is already open. */
+int
+ubpf_map_replace_begin(struct ubpf_map *map)
+{
+    if (!map) {
+        return -1;
+    }
+    if (map->staged) {
+        return -3;
+    }
+    if (map->numa_replicas) {
+        /* The commit flip swaps the primary's data only; it cannot swap
+         * every node-local clone in one atomic step. */
+        return -2;
+    }
+    map->staged = ubpf_map_data_create(map);
+    return map->staged ? 0 : -2;
+}
+
+/* Publishes the staged table of an open replace transaction.  An aligned
+ * pointer store is atomic on the platforms we support, so a concurrent
+ * lookup sees either the outgoing table or the staged one in full; the
+ * outgoing table is torn down only after every reader has quiesced. */
+int
+ubpf_map_replace_commit(struct ubpf_map *map)
+{
+    struct ubpf_map old;
+
+    if (!map || !map->staged) {
+        return map ? -3 : -1;
+    }
+
+    old = *map;
+    old.staged = NULL;
+    map->data = map->staged;
+    map->staged = NULL;
+
+    ovsrcu_synchronize();
+    map->ops.map_destroy(&old);
+    return 0;
+}
+
+/* Drops the staged table of an open replace transaction, leaving the live
+ * table untouched. */
+int
+ubpf_map_replace_abort(struct ubpf_map *map)
+{
+    struct ubpf_map dead;
+
+    if (!map || !map->staged) {
+        return map ? -3 : -1;
+    }
+
+    dead = *map;
+    dead.data = map->staged;
+    dead.staged = NULL;
+    map->staged = NULL;
+
+    /* Wait out any datapath helper still writing through the staged
+     * pointer it read before it was cleared. */
+    ovsrcu_synchronize();
+    map->ops.map_destroy(&dead);
+    return 0;
+}
+
+/* Builds a full clone of 'map' with its own data, preferring 'node' for
+ * every allocation the clone makes so that PMDs on that node read
+ * node-local memory.  Without libnuma the clone still gets its own pages
+ * and placement is whatever the allocator does by default. */
+static struct ubpf_map *
+ubpf_map_clone_onto_node(struct ubpf_map *map, int node)
+{
+    struct ubpf_map *rep;
+    struct ubpf_map_cursor cursor;
+    char *entry;
+
+#ifdef HAVE_NUMA_H
+    if (numa_available() != -1) {
+        numa_set_preferred(node);
+    }
+#endif
+
+    rep = xmemdup(map, sizeof *map);
+    rep->staged = NULL;
+    rep->numa_replicas = NULL;
+    rep->data = ubpf_map_data_create(map);
+
+    /* Replay the primary's entries into the clone.  'stats' stays shared
+     * with the primary: the shards are picked per thread, not per map, so
+     * counts land in the same place whichever copy served the lookup. */
+    memset(&cursor, 0, sizeof cursor);
+    entry = xmalloc(map->key_size + map->value_size);
+    while (map->ops.map_dump_next(map, &cursor, 1, entry) > 0) {
+        rep->ops.map_update(rep, entry, entry + map->key_size);
+    }
+    free(entry);
+
+#ifdef HAVE_NUMA_H
+    if (numa_available() != -1) {
+        /* The daemon's default policy is local allocation. */
+        numa_set_localalloc();
+    }
+#endif
+    return rep;
+}
+
+/* Turns NUMA replication for 'map' on or off.  While it is on, every
+ * NUMA node holds its own clone of the table: lookups read the clone
+ * local to the calling thread's node and every update or delete is
+ * applied to the primary and to each clone, trading one copy of the
+ * table per node for never paying remote-node latency on the read path.
+ * Meant for read-mostly tables such as a FIB; write-heavy tables pay the
+ * fan-out on every update.
+ *
+ * Callers serialize this against other control-plane writers of 'map'.
+ * Returns 0 on success (turning an already-on map on, or an already-off
+ * map off, is a no-op), -1 with no map, -2 for a map type without
+ * replication support, -3 while a replace transaction is open or aging
+ * is enabled, and -4 on a single-node machine. */
+int
+ubpf_map_set_numa_replication(struct ubpf_map *map, bool enable)
+{
+    struct ubpf_map_replicas *replicas;
+    int n_numas;
+
+    if (!map) {
+        return -1;
+    }
+    if (map->type != UBPF_MAP_TYPE_HASHMAP) {
+        return -2;
+    }
+
+    if (!enable) {
+        replicas = map->numa_replicas;
+        if (!replicas) {
+            return 0;
+        }
+        map->numa_replicas = NULL;
+        /* Wait out lookups still reading a clone through the pointer
+         * they loaded before it was cleared. */
+        ovsrcu_synchronize();
+        for (int i = 0; i < replicas->n; i++) {
+            replicas->rep[i]->ops.map_destroy(replicas->rep[i]);
+            free(replicas->rep[i]);
+        }
+        free(replicas);
+        return 0;
+    }
+
+    if (map->numa_replicas) {
+        return 0;
+    }
+    if (map->staged || map->idle_timeout) {
+        return -3;
+    }
+    n_numas = ovs_numa_get_n_numas();
+    if (n_numas == OVS_NUMA_UNSPEC || n_numas < 2) {
+        return -4;
+    }
+
+    replicas = xzalloc(sizeof *replicas
+                       + n_numas * sizeof replicas->rep[0]);
+    replicas->n = n_numas;
+    for (int node = 0; node < n_numas; node++) {
+        replicas->rep[node] = ubpf_map_clone_onto_node(map, node);
+    }
+
+    /* A single aligned pointer store publishes the clones; a lookup sees
+     * either no replicas or the complete set. */
+    map->numa_replicas = replicas;
+    return 0;
 }
 
 static struct ubpf_func_proto ubpf_map_delete_proto = {
@@ -400,6 +831,237 @@ static struct ubpf_func_proto ubpf_get_rss_hash_proto = {
         .ret = UNKNOWN,
 };
 
+/* Runs a two-rate three-color meter over one packet and returns its
+ * color (0 green, 1 yellow, 2 red).  'map' must be a meter map; any
+ * other type passes everything green. */
+static uint32_t
+ubpf_meter_execute(const struct ubpf_map *map, uint64_t index, uint64_t len)
+{
+    if (OVS_UNLIKELY(!map || map->type != UBPF_MAP_TYPE_METER)) {
+        return 0;
+    }
+    return ubpf_meter_exec(map, index, len);
+}
+
+static struct ubpf_func_proto ubpf_meter_execute_proto = {
+    .func = (ext_func)ubpf_meter_execute,
+    .arg_types = {
+                MAP_PTR,
+                IMM,
+                IMM,
+                0xff,
+                0xff,
+            },
+    .arg_sizes = {
+                0xff,
+                SIZE_64,
+                SIZE_64,
+                0xff,
+                0xff,
+            },
+    .ret = UNKNOWN,
+};
+
+/* Emits a digest record toward the control plane.  The data is copied
+ * into the digest ring, so the program may reuse the buffer as soon as
+ * the call returns; a full ring drops the record rather than stall the
+ * packet path. */
+static int
+ubpf_digest(void *data, uint64_t size, uint64_t digest_id)
+{
+    return ubpf_digest_push(digest_id, data, size);
+}
+
+static struct ubpf_func_proto ubpf_digest_proto = {
+    .func = (ext_func)ubpf_digest,
+    .arg_types = {
+                PKT_PTR | MAP_VALUE_PTR | STACK_PTR,
+                IMM,
+                IMM,
+                0xff,
+                0xff,
+            },
+    .arg_sizes = {
+                SIZE_PTR_MAX,
+                SIZE_64,
+                SIZE_64,
+                0xff,
+                0xff,
+            },
+    .ret = UNKNOWN,
+};
+
+/* Merges 'new_val' into the 'size'-byte header field at 'field' under
+ * 'mask' (value and mask in host byte order, the field itself in network
+ * byte order) and folds the change into the running ones-complement delta
+ * 'csum_delta', returning the new delta.  This is the incremental-update
+ * trick packet_set_ipv4() uses, exposed to P4 deparsers: rewrite any number
+ * of fields while accumulating one delta, then fix each checksum with a
+ * single ubpf_csum_commit() instead of summing the whole packet after every
+ * write.  'size' must be 2, 4 or 8; anything else leaves the packet and the
+ * delta untouched. */
+static uint64_t
+ubpf_csum_update(uint64_t csum_delta, void *field, uint64_t new_val,
+                 uint64_t mask, uint64_t size)
+{
+    union {
+        ovs_be16 be16;
+        ovs_be32 be32;
+        ovs_be64 be64;
+        uint16_t words[4];
+    } old_f, new_f;
+
+    memcpy(&old_f, field, MIN(size, sizeof old_f));
+    switch (size) {
+    case 2:
+        new_f.be16 = htons((ntohs(old_f.be16) & ~mask) | (new_val & mask));
+        break;
+    case 4:
+        new_f.be32 = htonl((ntohl(old_f.be32) & ~mask) | (new_val & mask));
+        break;
+    case 8:
+        new_f.be64 = htonll((ntohll(old_f.be64) & ~mask) | (new_val & mask));
+        break;
+    default:
+        return csum_delta;
+    }
+    memcpy(field, &new_f, size);
+
+    /* Ones-complement arithmetic is byte-order independent as long as every
+     * word is treated in the same order, so sum the stored representation
+     * directly. */
+    for (uint64_t i = 0; i < size / 2; i++) {
+        csum_delta += (uint16_t)~old_f.words[i];
+        csum_delta += new_f.words[i];
+    }
+    while (csum_delta >> 16) {
+        csum_delta = (csum_delta & 0xffff) + (csum_delta >> 16);
+    }
+    return csum_delta;
+}
+
+static struct ubpf_func_proto ubpf_csum_update_proto = {
+    .func = (ext_func)ubpf_csum_update,
+    .arg_types = {
+                IMM | UNKNOWN,
+                PKT_PTR | MAP_VALUE_PTR | STACK_PTR,
+                IMM | UNKNOWN,
+                IMM | UNKNOWN,
+                IMM,
+            },
+    .arg_sizes = {
+                SIZE_64,
+                0xff,
+                SIZE_64,
+                SIZE_64,
+                SIZE_64,
+            },
+    .ret = UNKNOWN,
+};
+
+/* Applies the delta accumulated by ubpf_csum_update() calls to the 16-bit
+ * ones-complement checksum field at 'csum_field', using the RFC 1624
+ * HC' = ~(~HC + delta) form.  A zero delta leaves the field unchanged. */
+static void
+ubpf_csum_commit(void *csum_field, uint64_t csum_delta)
+{
+    uint16_t csum;
+    uint32_t sum;
+
+    memcpy(&csum, csum_field, sizeof csum);
+    sum = (uint16_t)~csum + (uint32_t)csum_delta;
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    csum = ~sum;
+    memcpy(csum_field, &csum, sizeof csum);
+}
+
+static struct ubpf_func_proto ubpf_csum_commit_proto = {
+    .func = (ext_func)ubpf_csum_commit,
+    .arg_types = {
+                PKT_PTR | MAP_VALUE_PTR | STACK_PTR,
+                IMM | UNKNOWN,
+                0xff,
+                0xff,
+                0xff,
+            },
+    .arg_sizes = {
+                0xff,
+                SIZE_64,
+                0xff,
+                0xff,
+                0xff,
+            },
+    .ret = UNINIT,
+};
+
+/* Sticky-table externs: datapath-native learn tables with per-entry TTL,
+ * shared with the OVS_ACTION_ATTR_STICKY_* actions (see sticky-table.c).
+ * 'key' points to a 16-byte value in a program-defined layout. */
+static uint32_t
+ubpf_sticky_learn(void *key, uint64_t table_id, uint64_t value,
+                  uint64_t ttl_ms)
+{
+    ovs_u128 k;
+
+    memcpy(&k, key, sizeof k);
+    return sticky_table_learn(table_id, &k, value, ttl_ms);
+}
+
+static struct ubpf_func_proto ubpf_sticky_learn_proto = {
+    .func = (ext_func)ubpf_sticky_learn,
+    .arg_types = {
+                PKT_PTR | MAP_VALUE_PTR | STACK_PTR,
+                IMM,
+                IMM | UNKNOWN,
+                IMM,
+                0xff,
+            },
+    .arg_sizes = {
+                SIZE_PTR_MAX,
+                SIZE_64,
+                SIZE_64,
+                SIZE_64,
+                0xff,
+            },
+    .ret = UNKNOWN,
+};
+
+/* Returns the learned 32-bit value, or UINT64_MAX on a miss.  A nonzero
+ * 'ttl_ms' re-arms a hit entry with that lifetime. */
+static uint64_t
+ubpf_sticky_lookup(void *key, uint64_t table_id, uint64_t ttl_ms)
+{
+    ovs_u128 k;
+    uint32_t value;
+
+    memcpy(&k, key, sizeof k);
+    if (!sticky_table_lookup(table_id, &k, ttl_ms, &value)) {
+        return UINT64_MAX;
+    }
+    return value;
+}
+
+static struct ubpf_func_proto ubpf_sticky_lookup_proto = {
+    .func = (ext_func)ubpf_sticky_lookup,
+    .arg_types = {
+                PKT_PTR | MAP_VALUE_PTR | STACK_PTR,
+                IMM,
+                IMM,
+                0xff,
+                0xff,
+            },
+    .arg_sizes = {
+                SIZE_PTR_MAX,
+                SIZE_64,
+                SIZE_64,
+                0xff,
+                0xff,
+            },
+    .ret = UNKNOWN,
+};
+
 static void
 register_functions(struct ubpf_vm *vm)
 {
@@ -413,4 +1075,15 @@ register_functions(struct ubpf_vm *vm)
     ubpf_register_function(vm, UBPF_ADJUST_HEAD_ID, "ubpf_adjust_head", ubpf_adjust_head_proto);
     ubpf_register_function(vm, 9, "ubpf_packet_data", ubpf_packet_data_proto);
     ubpf_register_function(vm, 10, "ubpf_get_rss_hash", ubpf_get_rss_hash_proto);
+    ubpf_register_function(vm, 11, "ubpf_map_lookup_bulk",
+                           ubpf_map_lookup_bulk_proto);
+    ubpf_register_function(vm, 12, "ubpf_digest", ubpf_digest_proto);
+    ubpf_register_function(vm, 13, "ubpf_meter_execute",
+                           ubpf_meter_execute_proto);
+    ubpf_register_function(vm, 14, "ubpf_csum_update", ubpf_csum_update_proto);
+    ubpf_register_function(vm, 15, "ubpf_csum_commit", ubpf_csum_commit_proto);
+    ubpf_register_function(vm, 16, "ubpf_sticky_learn",
+                           ubpf_sticky_learn_proto);
+    ubpf_register_function(vm, 17, "ubpf_sticky_lookup",
+                           ubpf_sticky_lookup_proto);
 }
@@ -32,21 +32,67 @@ typedef enum OVS_PACKED_ENUM {
 struct ubpf_vm *create_ubpf_vm(const ovs_be16 prog_id);
 bool load_bpf_prog(struct ubpf_vm *vm, size_t code_len, const char *code);
 void *ubpf_map_lookup(const struct ubpf_map *map, void *key);
+uint64_t ubpf_map_lookup_bulk(const struct ubpf_map *map, void *keys,
+                              uint64_t count, void **values);
 int ubpf_map_update(struct ubpf_map *map, const void *key, void *item);
 int ubpf_map_delete(struct ubpf_map *map, const void *key);
 unsigned int ubpf_map_size(struct ubpf_map *map);
 int ubpf_map_dump(struct ubpf_map *map, char *data);
+int ubpf_map_dump_next(struct ubpf_map *map, struct ubpf_map_cursor *cursor,
+                       unsigned int max_entries, char *data);
+int ubpf_map_replace_begin(struct ubpf_map *map);
+int ubpf_map_replace_commit(struct ubpf_map *map);
+int ubpf_map_replace_abort(struct ubpf_map *map);
+int ubpf_map_set_idle_timeout(struct ubpf_map *map, uint32_t secs,
+                              uint32_t prog_id);
+int ubpf_map_set_numa_replication(struct ubpf_map *map, bool enable);
 void *ubpf_adjust_head(void* ctx, int offset);
 void *ubpf_packet_data(void *ctx);
 
+/* While an execution profile is attached to 'vm' (see
+ * ubpf_profile_start()), packets run through the interpreter instead of
+ * the JIT: that is where the helper counters and program-counter sampling
+ * live.  ubpf_exec() passes its second argument in R2, so handing it the
+ * metadata pointer matches the JIT's (mem, md) calling convention. */
+static inline bool
+ubpf_profiling(const struct ubpf_vm *vm)
+{
+    return ovsrcu_get(struct ubpf_profile *, &vm->profile) != NULL;
+}
+
 static inline bpf_result
 ubpf_handle_packet(struct ubpf_vm *vm, struct standard_metadata *md, struct dp_packet *packet)
 {
     md->packet_length = dp_packet_size(packet);
-    uint64_t ret = vm->jitted(packet, md);
+    uint64_t ret;
+    if (OVS_UNLIKELY(ubpf_profiling(vm))) {
+        ret = ubpf_exec(vm, packet, (uintptr_t) md);
+    } else {
+        ret = vm->jitted(packet, md);
+    }
     return (ret == 1)? BPF_MATCH : BPF_NO_MATCH;
 }
 
+/* Runs the program over 'count' packets in one VM invocation when the JIT
+ * backend provides a batch entry point, amortizing entry/exit over the
+ * burst.  Callers must have filled in 'md->packet_length' for each entry. */
+static inline void
+ubpf_handle_packet_batch(struct ubpf_vm *vm, struct ubpf_batch_entry *entries,
+                         size_t count)
+{
+    if (OVS_UNLIKELY(ubpf_profiling(vm))) {
+        for (size_t i = 0; i < count; i++) {
+            ubpf_exec(vm, entries[i].mem, (uintptr_t) entries[i].md);
+        }
+    } else if (OVS_LIKELY(vm->jitted_batch)) {
+        vm->jitted_batch(entries, count);
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            vm->jitted(entries[i].mem, entries[i].md);
+        }
+    }
+}
+
 static inline bool
 ubpf_is_empty(struct ubpf_vm *vm)
 {
@@ -27,6 +27,7 @@ enum ubpf_action{
     DROP,
     PASS,
     REDIRECT,
+    MULTICAST,  /* output_port carries the multicast group id. */
 };
 
 struct standard_metadata {
@@ -34,11 +35,24 @@ struct standard_metadata {
     uint32_t packet_length;
     enum ubpf_action output_action;
     uint32_t output_port;
+    uint32_t clone_session_id;  /* Mirror to this clone session; 0 is none.
+                                 * Programs compiled against the older model
+                                 * leave it untouched. */
 };
 
 struct ubpf_vm;
 typedef uint64_t (*ubpf_jit_fn)(void *mem, struct standard_metadata *);
 
+/* One packet's worth of program input for batch execution.  Verdicts come
+ * back through the standard metadata, as for single-packet runs. */
+struct ubpf_batch_entry {
+    void *mem;
+    struct standard_metadata *md;
+};
+
+typedef void (*ubpf_jit_batch_fn)(struct ubpf_batch_entry *entries,
+                                  uint64_t count);
+
 struct ubpf_map;
 struct ubpf_func_proto;
 
@@ -0,0 +1,254 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include <config.h>
+#include "ubpf_act_prof.h"
+
+#include "hash.h"
+#include "util.h"
+
+/* Action profile / selector map: per-packet member selection.
+ *
+ * Emulating a P4 action selector with per-flow table entries multiplies
+ * every logical rule by its group's member count.  This map stores each
+ * member's action value once and selects among a group's members by
+ * packet hash through a small indirection array, so group membership
+ * changes touch the indirection slots and nothing else. */
+
+void *
+ubpf_act_prof_create(const struct ubpf_map_def *map_def)
+{
+    struct act_prof *ap;
+
+    if (map_def->key_size != sizeof(struct ubpf_act_selector_key)) {
+        return NULL;
+    }
+
+    ap = xzalloc(sizeof *ap);
+    cmap_init(&ap->groups);
+    ovs_mutex_init(&ap->mutex);
+    ap->value_size = map_def->value_size;
+    ap->max_members = map_def->max_entries;
+    ap->next_group_handle = 1;
+    ap->members = xcalloc(ap->max_members, sizeof *ap->members);
+
+    return ap;
+}
+
+void
+ubpf_act_prof_destroy(struct ubpf_map *map)
+{
+    struct act_prof *ap = map->data;
+    struct act_prof_group *group;
+
+    /* Wait out all readers so everything can be torn down in place. */
+    ovsrcu_synchronize();
+
+    CMAP_FOR_EACH (group, cmap_node, &ap->groups) {
+        cmap_remove(&ap->groups, &group->cmap_node,
+                    hash_int(group->handle, 0));
+        ovsrcu_postpone(free, group);
+    }
+    cmap_destroy(&ap->groups);
+    for (uint32_t i = 0; i < ap->max_members; i++) {
+        free(ovsrcu_get_protected(void *, &ap->members[i]));
+    }
+    free(ap->members);
+    ovs_mutex_destroy(&ap->mutex);
+    free(ap);
+}
+
+unsigned int
+ubpf_act_prof_size(const struct ubpf_map *map)
+{
+    struct act_prof *ap = map->data;
+    return ap->n_members;
+}
+
+static struct act_prof_group *
+act_prof_find_group(const struct act_prof *ap, uint32_t handle)
+{
+    struct act_prof_group *group;
+
+    CMAP_FOR_EACH_WITH_HASH (group, cmap_node, hash_int(handle, 0),
+                             &ap->groups) {
+        if (group->handle == handle) {
+            return group;
+        }
+    }
+    return NULL;
+}
+
+void *
+ubpf_act_prof_lookup(const struct ubpf_map *map, const void *key)
+{
+    const struct ubpf_act_selector_key *sel = key;
+    struct act_prof *ap = map->data;
+    struct act_prof_group *group;
+    uint32_t mbr;
+
+    group = act_prof_find_group(ap, sel->group);
+    if (OVS_UNLIKELY(!group)) {
+        return NULL;
+    }
+
+    atomic_read_relaxed(&group->slots[sel->hash
+                                      & (UBPF_ACT_PROF_GROUP_SLOTS - 1)],
+                        &mbr);
+    if (OVS_UNLIKELY(mbr == UBPF_ACT_PROF_NO_MEMBER)) {
+        return NULL;
+    }
+    return ovsrcu_get(void *, &ap->members[mbr]);
+}
+
+int
+ubpf_act_prof_member_create(struct ubpf_map *map, const void *value,
+                            uint32_t *mbrp)
+{
+    struct act_prof *ap = map->data;
+    int error = -4;
+
+    ovs_mutex_lock(&ap->mutex);
+    for (uint32_t i = 0; i < ap->max_members; i++) {
+        if (!ovsrcu_get_protected(void *, &ap->members[i])) {
+            ovsrcu_set(&ap->members[i], xmemdup(value, ap->value_size));
+            ap->n_members++;
+            *mbrp = i;
+            error = 0;
+            break;
+        }
+    }
+    ovs_mutex_unlock(&ap->mutex);
+
+    return error;
+}
+
+int
+ubpf_act_prof_member_modify(struct ubpf_map *map, uint32_t mbr,
+                            const void *value)
+{
+    struct act_prof *ap = map->data;
+    void *old_value;
+
+    ovs_mutex_lock(&ap->mutex);
+    old_value = mbr < ap->max_members
+                ? ovsrcu_get_protected(void *, &ap->members[mbr]) : NULL;
+    if (!old_value) {
+        ovs_mutex_unlock(&ap->mutex);
+        return -4;
+    }
+    ovsrcu_set(&ap->members[mbr], xmemdup(value, ap->value_size));
+    ovs_mutex_unlock(&ap->mutex);
+    ovsrcu_postpone(free, old_value);
+
+    return 0;
+}
+
+/* Frees 'mbr''s slot.  The controller removes a member from every group
+ * before deleting it; a packet racing with that at worst selects an
+ * already-empty slot and misses. */
+int
+ubpf_act_prof_member_delete(struct ubpf_map *map, uint32_t mbr)
+{
+    struct act_prof *ap = map->data;
+    void *old_value;
+
+    ovs_mutex_lock(&ap->mutex);
+    old_value = mbr < ap->max_members
+                ? ovsrcu_get_protected(void *, &ap->members[mbr]) : NULL;
+    if (!old_value) {
+        ovs_mutex_unlock(&ap->mutex);
+        return -4;
+    }
+    ovsrcu_set(&ap->members[mbr], NULL);
+    ap->n_members--;
+    ovs_mutex_unlock(&ap->mutex);
+    ovsrcu_postpone(free, old_value);
+
+    return 0;
+}
+
+int
+ubpf_act_prof_group_create(struct ubpf_map *map, uint32_t *grpp)
+{
+    struct act_prof *ap = map->data;
+    struct act_prof_group *group = xzalloc(sizeof *group);
+
+    for (int i = 0; i < UBPF_ACT_PROF_GROUP_SLOTS; i++) {
+        atomic_init(&group->slots[i], UBPF_ACT_PROF_NO_MEMBER);
+    }
+
+    ovs_mutex_lock(&ap->mutex);
+    group->handle = ap->next_group_handle++;
+    cmap_insert(&ap->groups, &group->cmap_node, hash_int(group->handle, 0));
+    ovs_mutex_unlock(&ap->mutex);
+
+    *grpp = group->handle;
+    return 0;
+}
+
+/* Replaces 'grp''s membership with 'mbrs' by rewriting the indirection
+ * slots round-robin, so a member listed twice receives twice the share
+ * (WCMP).  Packets in flight keep selecting valid members throughout. */
+int
+ubpf_act_prof_group_set_members(struct ubpf_map *map, uint32_t grp,
+                                const uint32_t *mbrs, size_t n_mbrs)
+{
+    struct act_prof *ap = map->data;
+    struct act_prof_group *group;
+    int error = 0;
+
+    ovs_mutex_lock(&ap->mutex);
+    group = act_prof_find_group(ap, grp);
+    if (!group) {
+        error = -4;
+        goto out;
+    }
+    for (size_t i = 0; i < n_mbrs; i++) {
+        if (mbrs[i] >= ap->max_members
+            || !ovsrcu_get_protected(void *, &ap->members[mbrs[i]])) {
+            error = -5;
+            goto out;
+        }
+    }
+    for (int i = 0; i < UBPF_ACT_PROF_GROUP_SLOTS; i++) {
+        atomic_store_relaxed(&group->slots[i],
+                             n_mbrs ? mbrs[i % n_mbrs]
+                                    : UBPF_ACT_PROF_NO_MEMBER);
+    }
+out:
+    ovs_mutex_unlock(&ap->mutex);
+    return error;
+}
+
+int
+ubpf_act_prof_group_delete(struct ubpf_map *map, uint32_t grp)
+{
+    struct act_prof *ap = map->data;
+    struct act_prof_group *group;
+
+    ovs_mutex_lock(&ap->mutex);
+    group = act_prof_find_group(ap, grp);
+    if (!group) {
+        ovs_mutex_unlock(&ap->mutex);
+        return -4;
+    }
+    cmap_remove(&ap->groups, &group->cmap_node, hash_int(grp, 0));
+    ovs_mutex_unlock(&ap->mutex);
+    ovsrcu_postpone(free, group);
+
+    return 0;
+}
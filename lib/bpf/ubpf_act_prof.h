@@ -0,0 +1,89 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef UBPF_ACT_PROF_H
+#define UBPF_ACT_PROF_H 1
+
+#include "cmap.h"
+#include "ovs-atomic.h"
+#include "ovs-rcu.h"
+#include "ovs-thread.h"
+
+#include "ubpf_int.h"
+
+/* Slots in a group's member indirection array.  A power of two, so the
+ * data path can mask a packet hash instead of dividing, and weighted
+ * (WCMP) groups spread their members over the slots proportionally. */
+#define UBPF_ACT_PROF_GROUP_SLOTS 64
+
+/* Slot value meaning "no member": lookups miss instead of selecting. */
+#define UBPF_ACT_PROF_NO_MEMBER UINT32_MAX
+
+/* Data-path lookup key: the match table's value carries the group handle,
+ * the program supplies a packet hash, e.g. from ubpf_hash(). */
+struct ubpf_act_selector_key {
+    uint32_t group;
+    uint32_t hash;
+};
+
+void *ubpf_act_prof_create(const struct ubpf_map_def *map_def);
+unsigned int ubpf_act_prof_size(const struct ubpf_map *map);
+void *ubpf_act_prof_lookup(const struct ubpf_map *map, const void *key);
+void ubpf_act_prof_destroy(struct ubpf_map *map);
+
+/* Control-plane operations, driven from the PI action profile calls.
+ * Member handles double as indices into the member array; group handles
+ * are allocated by group_create. */
+int ubpf_act_prof_member_create(struct ubpf_map *map, const void *value,
+                                uint32_t *mbrp);
+int ubpf_act_prof_member_modify(struct ubpf_map *map, uint32_t mbr,
+                                const void *value);
+int ubpf_act_prof_member_delete(struct ubpf_map *map, uint32_t mbr);
+int ubpf_act_prof_group_create(struct ubpf_map *map, uint32_t *grpp);
+int ubpf_act_prof_group_set_members(struct ubpf_map *map, uint32_t grp,
+                                    const uint32_t *mbrs, size_t n_mbrs);
+int ubpf_act_prof_group_delete(struct ubpf_map *map, uint32_t grp);
+
+/* Action profile with selector groups.  'members' holds one RCU pointer
+ * per member to its action value, so a member edit is a pointer swap; a
+ * group is a fixed indirection array of member indices written with
+ * relaxed atomic stores, so group edits only rewrite slots and never
+ * stall a PMD mid-selection.  Lookups are lock-free; 'mutex' only
+ * serializes control-plane writers. */
+struct act_prof {
+    struct cmap groups;         /* struct act_prof_group by handle. */
+    struct ovs_mutex mutex;     /* Serializes writers. */
+    uint32_t value_size;
+    uint32_t max_members;
+    uint32_t next_group_handle OVS_GUARDED;
+    uint32_t n_members OVS_GUARDED;
+    OVSRCU_TYPE(void *) *members; /* max_members action values; NULL = free. */
+};
+
+struct act_prof_group {
+    struct cmap_node cmap_node; /* In act_prof's 'groups'. */
+    uint32_t handle;
+    ATOMIC(uint32_t) slots[UBPF_ACT_PROF_GROUP_SLOTS]; /* Member indices. */
+};
+
+static const struct ubpf_map_ops ubpf_act_prof_ops = {
+    .map_size = ubpf_act_prof_size,
+    .map_dump = NULL,
+    .map_lookup = ubpf_act_prof_lookup,
+    .map_update = NULL,
+    .map_delete = NULL,
+    .map_add = NULL,
+    .map_destroy = ubpf_act_prof_destroy,
+};
+
+#endif
@@ -19,13 +19,21 @@
 #include <config.h>
 #include "util.h"
 #include "ubpf_array.h"
+#include "ubpf_mem.h"
 
 
 
 void *
 ubpf_array_create(const struct ubpf_map_def *map_def)
 {
-    return xcalloc(map_def->max_entries, map_def->value_size);
+    return ubpf_mem_alloc((size_t) map_def->max_entries
+                          * map_def->value_size);
+}
+
+void
+ubpf_array_destroy(struct ubpf_map *map)
+{
+    ubpf_mem_free(map->data);
 }
 
 void *
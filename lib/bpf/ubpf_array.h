@@ -15,6 +15,7 @@
 #include "ubpf_int.h"
 
 void *ubpf_array_create(const struct ubpf_map_def *map_def);
+void ubpf_array_destroy(struct ubpf_map *map);
 void *ubpf_array_lookup(const struct ubpf_map *map, const void *key);
 int ubpf_array_update(struct ubpf_map *map, const void *key,
                              void *value);
@@ -24,4 +25,5 @@ static const struct ubpf_map_ops ubpf_array_ops = {
         .map_update = ubpf_array_update,
         .map_delete = NULL,
         .map_add = NULL,
+        .map_destroy = ubpf_array_destroy,
 };
@@ -23,81 +23,97 @@
 #include "ubpf_bf.h"
 #include "util.h"
 
+/* Blocked bloom filter.
+ *
+ * The bit array is partitioned into cache-line-sized blocks.  One hash
+ * picks the block and all k probe bits land inside it, so a membership
+ * test touches exactly one cache line regardless of k.  The k bits are
+ * collected into a line-wide mask first and tested with eight 64-bit
+ * AND/compare operations, which the compiler vectorizes into a single
+ * masked compare where SSE/AVX is available. */
+
+#define BF_BLOCK_BYTES CACHE_LINE_SIZE
+#define BF_BLOCK_BITS (BF_BLOCK_BYTES * 8)
+#define BF_BLOCK_WORDS (BF_BLOCK_BYTES / 8)
+
 struct bloom_filter {
     unsigned int nb_hash_functions;
+    uint32_t n_blocks;
     int ret_true;
     int ret_false;
-    uint8_t bits[];
+    OVS_ALIGNED_VAR(CACHE_LINE_SIZE) uint64_t blocks[];
 };
 
 void *
 ubpf_bf_create(const struct ubpf_map_def *map_def)
 {
-    int nb_bytes = map_def->max_entries / 8;
-    struct bloom_filter* bf = xmalloc(sizeof(struct bloom_filter) +
-                                    sizeof(uint8_t) * nb_bytes +
-                                    sizeof(int) * 3);
+    int nb_bytes = ROUND_UP(MAX(map_def->max_entries / 8, 1), BF_BLOCK_BYTES);
+    struct bloom_filter *bf = xmalloc_cacheline(sizeof(struct bloom_filter)
+                                                + nb_bytes);
     bf->nb_hash_functions = map_def->nb_hash_functions;
+    bf->n_blocks = nb_bytes / BF_BLOCK_BYTES;
     bf->ret_true = 1;
     bf->ret_false = 0;
-    memset(bf->bits, 0, nb_bytes);
+    memset(bf->blocks, 0, nb_bytes);
     return bf;
 }
 
+/* Scatters the k probe bits for (h1, h2) into a one-block-wide mask. */
+static inline void
+bf_block_mask(const struct bloom_filter *bf, uint32_t h1, uint32_t h2,
+              uint64_t mask[BF_BLOCK_WORDS])
+{
+    unsigned int i;
+
+    memset(mask, 0, BF_BLOCK_BYTES);
+    for (i = 0; i < bf->nb_hash_functions; i++) {
+        uint32_t bit = (h2 + i * (h1 | 1)) % BF_BLOCK_BITS;
+        mask[bit / 64] |= UINT64_C(1) << (bit % 64);
+    }
+}
+
 void *
 ubpf_bf_lookup(const struct ubpf_map *map, const void *value)
 {
-    unsigned int i;
     struct bloom_filter *bf = map->data;
-    uint32_t h1 = 0, h2 = 0, hash;
-    if (bf->nb_hash_functions == 1) {
-        h1 = hashlittle(value, map->value_size, 0);
-    } else {
-        hashlittle2(value, map->value_size, &h1, &h2);
-    }
-    for (i=0; i<bf->nb_hash_functions; i++) {
-        switch (i) {
-        case 0:
-            hash = h1;
-            break;
-        case 1:
-            hash = h2;
-            break;
-        default:
-            hash = h1 + i * h2;
-        }
-        hash %= map->max_entries * 8;
-        if (!(bf->bits[hash / 8] & 1 << hash % 8)) {
+    uint64_t mask[BF_BLOCK_WORDS];
+    uint32_t h1 = 0, h2 = 0;
+    const uint64_t *block;
+    int w;
+
+    hashlittle2(value, map->value_size, &h1, &h2);
+    block = &bf->blocks[(h1 % bf->n_blocks) * BF_BLOCK_WORDS];
+    bf_block_mask(bf, h1, h2, mask);
+
+    for (w = 0; w < BF_BLOCK_WORDS; w++) {
+        if ((block[w] & mask[w]) != mask[w]) {
             return &bf->ret_false;
         }
     }
     return &bf->ret_true;
 }
 
+void
+ubpf_bf_destroy(struct ubpf_map *map)
+{
+    free_cacheline(map->data);
+}
+
 int
 ubpf_bf_add(struct ubpf_map *map, void *value)
 {
-    unsigned int i;
     struct bloom_filter *bf = map->data;
-    uint32_t h1 = 0, h2 = 0, hash;
-    if (bf->nb_hash_functions == 1) {
-        h1 = hashlittle(value, map->value_size, 0);
-    } else {
-        hashlittle2(value, map->value_size, &h1, &h2);
-    }
-    for (i=0; i<bf->nb_hash_functions; i++) {
-        switch (i) {
-        case 0:
-            hash = h1;
-            break;
-        case 1:
-            hash = h2;
-            break;
-        default:
-            hash = h1 + i * h2;
-        }
-        hash %= map->max_entries * 8;
-        bf->bits[hash / 8] |= 1 << hash % 8;
+    uint64_t mask[BF_BLOCK_WORDS];
+    uint32_t h1 = 0, h2 = 0;
+    uint64_t *block;
+    int w;
+
+    hashlittle2(value, map->value_size, &h1, &h2);
+    block = &bf->blocks[(h1 % bf->n_blocks) * BF_BLOCK_WORDS];
+    bf_block_mask(bf, h1, h2, mask);
+
+    for (w = 0; w < BF_BLOCK_WORDS; w++) {
+        block[w] |= mask[w];
     }
     return 0;
 }
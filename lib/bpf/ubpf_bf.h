@@ -17,3 +17,4 @@
 void *ubpf_bf_create(const struct ubpf_map_def *map_def);
 void *ubpf_bf_lookup(const struct ubpf_map *map, const void *value);
 int ubpf_bf_add(struct ubpf_map *map, void *value);
+void ubpf_bf_destroy(struct ubpf_map *map);
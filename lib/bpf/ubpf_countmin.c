@@ -25,62 +25,69 @@
 #define min(a,b) ((a < b)? a : b)
 #endif
 
+/* Blocked count-min sketch.
+ *
+ * Instead of d independent rows scattered across memory, the counter
+ * array is partitioned into cache-line-sized blocks of 16 counters.
+ * One hash picks the block for a key and its d counters all live inside
+ * it, so an update or estimate touches exactly one cache line and the
+ * short fixed-bound loop over the slots unrolls and vectorizes.  The
+ * per-line slot collisions this introduces cost a little accuracy for a
+ * given memory budget, which telemetry-heavy pipelines trade gladly for
+ * the removed misses. */
+
+#define CM_BLOCK_BYTES CACHE_LINE_SIZE
+#define CM_BLOCK_COUNTERS (CM_BLOCK_BYTES / sizeof(uint32_t))
+
 struct countmin_sketch {
-    unsigned int nb_columns;
-    unsigned int nb_rows;
+    unsigned int nb_rows;       /* Counters examined per key (d). */
+    uint32_t n_blocks;
     void *current_count;
-    uint32_t counters[];
+    OVS_ALIGNED_VAR(CACHE_LINE_SIZE) uint32_t counters[];
 };
 
 void *
 ubpf_countmin_create(const struct ubpf_map_def *map_def)
 {
-    int size_bitmap = sizeof(uint32_t) * map_def->nb_hash_functions *
-                      map_def->max_entries;
-    struct countmin_sketch *countmin = xmalloc(sizeof(struct countmin_sketch) +
-                                              size_bitmap);
+    int size_bitmap = ROUND_UP(sizeof(uint32_t) * map_def->nb_hash_functions
+                               * map_def->max_entries, CM_BLOCK_BYTES);
+    struct countmin_sketch *countmin =
+        xmalloc_cacheline(sizeof(struct countmin_sketch) + size_bitmap);
 
     /* Whatever the value size, we always return a uint32_t,
      * so we need to zero out the rest of the memory buffer.
      */
     countmin->current_count = xcalloc(1, map_def->value_size);
 
-    countmin->nb_columns = map_def->nb_hash_functions;
-    countmin->nb_rows = map_def->max_entries;
+    countmin->nb_rows = map_def->nb_hash_functions;
+    countmin->n_blocks = size_bitmap / CM_BLOCK_BYTES;
     memset(countmin->counters, 0, size_bitmap);
 
     return countmin;
 }
 
+static inline uint32_t
+countmin_slot(uint32_t h1, uint32_t h2, unsigned int i)
+{
+    return (h2 + i * (h1 | 1)) % CM_BLOCK_COUNTERS;
+}
+
 void *
 ubpf_countmin_lookup(const struct ubpf_map *map, const void *value)
 {
     unsigned int i;
     struct countmin_sketch *countmin = map->data;
-    uint32_t h1 = 0, h2 = 0, hash;
+    uint32_t h1 = 0, h2 = 0;
+    const uint32_t *block;
 
     uint32_t *count = countmin->current_count;
     *count = UINT32_MAX;
 
-    if (countmin->nb_columns == 1) {
-        h1 = hashlittle(value, map->value_size, 0);
-    } else {
-        hashlittle2(value, map->value_size, &h1, &h2);
-    }
-    for (i=0; i<countmin->nb_columns; i++) {
-        switch (i) {
-        case 0:
-            hash = h1;
-            break;
-        case 1:
-            hash = h2;
-            break;
-        default:
-            hash = h1 + i * h2;
-        }
-        hash %= countmin->nb_rows;
-        *count = min(*count,
-                    countmin->counters[i * countmin->nb_columns + hash]);
+    hashlittle2(value, map->value_size, &h1, &h2);
+    block = &countmin->counters[(h1 % countmin->n_blocks)
+                                * CM_BLOCK_COUNTERS];
+    for (i = 0; i < countmin->nb_rows; i++) {
+        *count = min(*count, block[countmin_slot(h1, h2, i)]);
     }
 
     return count;
@@ -91,25 +98,23 @@ ubpf_countmin_add(struct ubpf_map *map, void *value)
 {
     unsigned int i;
     struct countmin_sketch *countmin = map->data;
-    uint32_t h1 = 0, h2 = 0, hash;
-    if (countmin->nb_columns == 1) {
-        h1 = hashlittle(value, map->value_size, 0);
-    } else {
-        hashlittle2(value, map->value_size, &h1, &h2);
-    }
-    for (i=0; i<countmin->nb_columns; i++) {
-        switch (i) {
-        case 0:
-            hash = h1;
-            break;
-        case 1:
-            hash = h2;
-            break;
-        default:
-            hash = h1 + i * h2;
-        }
-        hash %= countmin->nb_rows;
-        countmin->counters[i * countmin->nb_columns + hash]++;
+    uint32_t h1 = 0, h2 = 0;
+    uint32_t *block;
+
+    hashlittle2(value, map->value_size, &h1, &h2);
+    block = &countmin->counters[(h1 % countmin->n_blocks)
+                                * CM_BLOCK_COUNTERS];
+    for (i = 0; i < countmin->nb_rows; i++) {
+        block[countmin_slot(h1, h2, i)]++;
     }
     return 0;
 }
+
+void
+ubpf_countmin_destroy(struct ubpf_map *map)
+{
+    struct countmin_sketch *countmin = map->data;
+
+    free(countmin->current_count);
+    free_cacheline(countmin);
+}
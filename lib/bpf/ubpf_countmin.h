@@ -17,3 +17,4 @@
 void *ubpf_countmin_create(const struct ubpf_map_def *map_def);
 void *ubpf_countmin_lookup(const struct ubpf_map *map, const void *key);
 int ubpf_countmin_add(struct ubpf_map *map, void *value);
+void ubpf_countmin_destroy(struct ubpf_map *map);
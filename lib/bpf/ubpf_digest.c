@@ -0,0 +1,207 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Digest (learn notification) path from PMD threads to the control
+ * plane.
+ *
+ * PMD threads push fixed-size digest records into a bounded
+ * multi-producer ring with the ubpf_digest() helper; pushing is
+ * lock-free and never blocks, a full ring just drops the record and
+ * counts it.  A dedicated thread drains the ring every couple of
+ * milliseconds, drops duplicate records within the batch - a learning
+ * burst repeats the same MAC many times before the control plane reacts
+ * - and hands the batch to a registered sink in one call, so the
+ * control connection sees one message per batch instead of one per
+ * packet.
+ *
+ * The ring is the bounded queue of Vyukov: every slot carries a
+ * sequence number, producers claim slots with a compare-and-swap on the
+ * enqueue position, and the single consumer needs no synchronization
+ * beyond the per-slot acquire/release pair. */
+
+#include <string.h>
+
+#include <config.h>
+#include "ubpf_digest.h"
+#include "openvswitch/vlog.h"
+#include "ovs-atomic.h"
+#include "ovs-thread.h"
+#include "util.h"
+
+VLOG_DEFINE_THIS_MODULE(ubpf_digest);
+
+static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 20);
+
+#define DIGEST_RING_SIZE 4096   /* Must be a power of two. */
+#define DIGEST_RING_MASK (DIGEST_RING_SIZE - 1)
+#define DIGEST_BATCH_MAX 256
+#define DIGEST_DRAIN_INTERVAL_NS (2 * 1000 * 1000)
+
+struct digest_slot {
+    atomic_uint64_t seq;
+    struct ubpf_digest_record rec;
+};
+
+static struct digest_slot digest_ring[DIGEST_RING_SIZE];
+static atomic_uint64_t enqueue_pos = ATOMIC_VAR_INIT(0);
+static uint64_t dequeue_pos;    /* Digest thread only. */
+static atomic_uint64_t n_ring_drops = ATOMIC_VAR_INIT(0);
+
+static ubpf_digest_cb *digest_cb;
+static void *digest_cb_aux;
+
+static void *digest_thread(void *arg OVS_UNUSED);
+
+static void
+digest_init(void)
+{
+    for (uint64_t i = 0; i < DIGEST_RING_SIZE; i++) {
+        atomic_init(&digest_ring[i].seq, i);
+    }
+    ovs_thread_create("ubpf_digest", digest_thread, NULL);
+}
+
+static void
+digest_init_once(void)
+{
+    static struct ovsthread_once once = OVSTHREAD_ONCE_INITIALIZER;
+
+    if (ovsthread_once_start(&once)) {
+        digest_init();
+        ovsthread_once_done(&once);
+    }
+}
+
+/* Pushes one digest record.  Safe to call from any number of threads
+ * concurrently; returns 0 on success, -1 if the payload is oversized or
+ * the ring is full (the record is dropped and counted, the caller
+ * should not retry from the packet path). */
+int
+ubpf_digest_push(uint32_t digest_id, const void *data, uint32_t len)
+{
+    struct digest_slot *slot;
+    uint64_t pos, seq;
+
+    if (OVS_UNLIKELY(len > UBPF_DIGEST_DATA_MAX)) {
+        return -1;
+    }
+    digest_init_once();
+
+    atomic_read_relaxed(&enqueue_pos, &pos);
+    for (;;) {
+        slot = &digest_ring[pos & DIGEST_RING_MASK];
+        atomic_read_explicit(&slot->seq, &seq, memory_order_acquire);
+
+        if (seq == pos) {
+            if (atomic_compare_exchange_weak_explicit(&enqueue_pos, &pos,
+                                                      pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+            /* 'pos' was reloaded by the failed exchange; retry. */
+        } else if (seq < pos) {
+            /* Consumer has not freed this slot yet: ring is full. */
+            atomic_count_inc64(&n_ring_drops);
+            return -1;
+        } else {
+            atomic_read_relaxed(&enqueue_pos, &pos);
+        }
+    }
+
+    slot->rec.digest_id = digest_id;
+    slot->rec.len = len;
+    memcpy(slot->rec.data, data, len);
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+
+    return 0;
+}
+
+/* Registers the batch sink.  Set this once at startup, before any
+ * program pushes digests; batches arriving with no sink are dropped. */
+void
+ubpf_digest_set_cb(ubpf_digest_cb *cb, void *aux)
+{
+    digest_cb = cb;
+    digest_cb_aux = aux;
+}
+
+static bool
+digest_pop(struct ubpf_digest_record *rec)
+{
+    struct digest_slot *slot = &digest_ring[dequeue_pos & DIGEST_RING_MASK];
+    uint64_t seq;
+
+    atomic_read_explicit(&slot->seq, &seq, memory_order_acquire);
+    if (seq != dequeue_pos + 1) {
+        return false;
+    }
+
+    *rec = slot->rec;
+    atomic_store_explicit(&slot->seq, dequeue_pos + DIGEST_RING_SIZE,
+                          memory_order_release);
+    dequeue_pos++;
+    return true;
+}
+
+static bool
+digest_record_equal(const struct ubpf_digest_record *a,
+                    const struct ubpf_digest_record *b)
+{
+    return a->digest_id == b->digest_id && a->len == b->len
+           && !memcmp(a->data, b->data, a->len);
+}
+
+static void *
+digest_thread(void *arg OVS_UNUSED)
+{
+    struct ubpf_digest_record batch[DIGEST_BATCH_MAX];
+
+    for (;;) {
+        uint64_t drops;
+        size_t n = 0;
+
+        /* The sleep is the coalescing window: everything a learning
+         * burst produces within it goes out as one batch. */
+        xnanosleep(DIGEST_DRAIN_INTERVAL_NS);
+
+        while (n < DIGEST_BATCH_MAX && digest_pop(&batch[n])) {
+            bool dup = false;
+
+            for (size_t i = 0; i < n; i++) {
+                if (digest_record_equal(&batch[i], &batch[n])) {
+                    dup = true;
+                    break;
+                }
+            }
+            if (!dup) {
+                n++;
+            }
+        }
+
+        if (n && digest_cb) {
+            digest_cb(batch, n, digest_cb_aux);
+        }
+
+        atomic_read_relaxed(&n_ring_drops, &drops);
+        if (drops) {
+            uint64_t zero = 0;
+            atomic_store_relaxed(&n_ring_drops, zero);
+            VLOG_WARN_RL(&rl, "digest ring overflow: %"PRIu64" records "
+                         "dropped", drops);
+        }
+    }
+
+    OVS_NOT_REACHED();
+}
@@ -0,0 +1,38 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UBPF_DIGEST_H
+#define UBPF_DIGEST_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Largest digest payload a P4 program can emit.  MAC-learning digests
+ * (port + address) fit with plenty of room. */
+#define UBPF_DIGEST_DATA_MAX 48
+
+struct ubpf_digest_record {
+    uint32_t digest_id;         /* P4 digest id, program-defined. */
+    uint16_t len;               /* Bytes used in 'data'. */
+    uint8_t data[UBPF_DIGEST_DATA_MAX];
+};
+
+/* Called from the digest thread with a coalesced batch of records. */
+typedef void ubpf_digest_cb(const struct ubpf_digest_record *recs,
+                            size_t n, void *aux);
+
+int ubpf_digest_push(uint32_t digest_id, const void *data, uint32_t len);
+void ubpf_digest_set_cb(ubpf_digest_cb *cb, void *aux);
+
+#endif
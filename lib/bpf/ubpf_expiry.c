@@ -0,0 +1,177 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Idle-entry expiry for P4 tables.
+ *
+ * Without aging, a MAC-learning table grows with every address ever
+ * seen and its chains only get longer.  PMD threads stamp entries with
+ * a coarse clock on every lookup hit - one relaxed load and a plain
+ * store, no time syscall on the packet path.  A background sweeper
+ * advances the clock once a second and walks each registered map in
+ * bounded slices, evicting entries idle past the map's timeout and
+ * handing the evicted keys to a registered sink in batches, so tables
+ * track their working set instead of their history. */
+
+#include <config.h>
+
+#include "ubpf_expiry.h"
+
+#include "ubpf_int.h"
+
+#include "openvswitch/list.h"
+#include "openvswitch/vlog.h"
+#include "ovs-thread.h"
+#include "timeval.h"
+#include "util.h"
+
+VLOG_DEFINE_THIS_MODULE(ubpf_expiry);
+
+#define EXPIRY_BATCH_MAX 64
+#define EXPIRY_SWEEP_INTERVAL_NS (1000 * 1000 * 1000)
+
+struct expiry_reg {
+    struct ovs_list list_node;  /* In 'expiry_regs'. */
+    struct ubpf_map *map;
+    uint32_t prog_id;
+    ubpf_expiry_sweep_fn *sweep;
+};
+
+atomic_uint32_t ubpf_expiry_clock = ATOMIC_VAR_INIT(0);
+
+static struct ovs_mutex expiry_mutex = OVS_MUTEX_INITIALIZER;
+static struct ovs_list expiry_regs OVS_GUARDED_BY(expiry_mutex)
+    = OVS_LIST_INITIALIZER(&expiry_regs);
+
+static ubpf_expiry_cb *expiry_cb;
+static void *expiry_cb_aux;
+static void (*expiry_evict_hook)(void);
+
+static void *expiry_thread(void *arg OVS_UNUSED);
+
+static struct expiry_reg *
+expiry_find(const struct ubpf_map *map)
+    OVS_REQUIRES(expiry_mutex)
+{
+    struct expiry_reg *reg;
+
+    LIST_FOR_EACH (reg, list_node, &expiry_regs) {
+        if (reg->map == map) {
+            return reg;
+        }
+    }
+    return NULL;
+}
+
+/* Puts 'map' under the sweeper, starting the sweeper thread on first
+ * use.  'sweep' does the type-specific aging; 'prog_id' tags the
+ * eviction notifications.  Re-registering a map just updates it. */
+void
+ubpf_expiry_register(struct ubpf_map *map, uint32_t prog_id,
+                     ubpf_expiry_sweep_fn *sweep)
+{
+    static struct ovsthread_once once = OVSTHREAD_ONCE_INITIALIZER;
+    struct expiry_reg *reg;
+
+    if (ovsthread_once_start(&once)) {
+        ovs_thread_create("ubpf_expiry", expiry_thread, NULL);
+        ovsthread_once_done(&once);
+    }
+
+    ovs_mutex_lock(&expiry_mutex);
+    reg = expiry_find(map);
+    if (!reg) {
+        reg = xzalloc(sizeof *reg);
+        reg->map = map;
+        ovs_list_push_back(&expiry_regs, &reg->list_node);
+    }
+    reg->prog_id = prog_id;
+    reg->sweep = sweep;
+    ovs_mutex_unlock(&expiry_mutex);
+}
+
+/* Takes 'map' away from the sweeper.  The sweeper walks its maps under
+ * 'expiry_mutex', so on return it can no longer touch 'map'; a no-op for
+ * maps that were never registered. */
+void
+ubpf_expiry_unregister(struct ubpf_map *map)
+{
+    struct expiry_reg *reg;
+
+    ovs_mutex_lock(&expiry_mutex);
+    reg = expiry_find(map);
+    if (reg) {
+        ovs_list_remove(&reg->list_node);
+        free(reg);
+    }
+    ovs_mutex_unlock(&expiry_mutex);
+}
+
+/* Registers the eviction sink.  Set this once at startup; evictions with
+ * no sink registered are only logged. */
+void
+ubpf_expiry_set_cb(ubpf_expiry_cb *cb, void *aux)
+{
+    expiry_cb = cb;
+    expiry_cb_aux = aux;
+}
+
+/* Registers a hook run after every eviction batch, before the sink.  The
+ * datapath uses it to invalidate memoized verdicts that the evicted
+ * entries may have produced. */
+void
+ubpf_expiry_set_evict_hook(void (*hook)(void))
+{
+    expiry_evict_hook = hook;
+}
+
+static void *
+expiry_thread(void *arg OVS_UNUSED)
+{
+    struct ubpf_expiry_record recs[EXPIRY_BATCH_MAX];
+    time_t base = time_now();
+
+    for (;;) {
+        struct expiry_reg *reg;
+        uint32_t now;
+
+        xnanosleep(EXPIRY_SWEEP_INTERVAL_NS);
+
+        now = time_now() - base;
+        atomic_store_relaxed(&ubpf_expiry_clock, now);
+
+        ovs_mutex_lock(&expiry_mutex);
+        LIST_FOR_EACH (reg, list_node, &expiry_regs) {
+            unsigned int n;
+
+            do {
+                n = reg->sweep(reg->map, now, recs, EXPIRY_BATCH_MAX);
+                if (n) {
+                    for (unsigned int i = 0; i < n; i++) {
+                        recs[i].prog_id = reg->prog_id;
+                        recs[i].map_id = reg->map->id;
+                    }
+                    if (expiry_evict_hook) {
+                        expiry_evict_hook();
+                    }
+                    if (expiry_cb) {
+                        expiry_cb(recs, n, expiry_cb_aux);
+                    }
+                }
+            } while (n == EXPIRY_BATCH_MAX);
+        }
+        ovs_mutex_unlock(&expiry_mutex);
+    }
+
+    OVS_NOT_REACHED();
+}
@@ -0,0 +1,66 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UBPF_EXPIRY_H
+#define UBPF_EXPIRY_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ovs-atomic.h"
+
+struct ubpf_map;
+
+/* Largest match key an eviction notification can carry. */
+#define UBPF_EXPIRY_KEY_MAX 64
+
+struct ubpf_expiry_record {
+    uint32_t prog_id;           /* P4 program the table belongs to. */
+    uint16_t map_id;            /* Datapath table id. */
+    uint16_t key_len;           /* Bytes used in 'key'. */
+    uint8_t key[UBPF_EXPIRY_KEY_MAX];
+};
+
+/* Called from the sweeper thread with a batch of evicted entries. */
+typedef void ubpf_expiry_cb(const struct ubpf_expiry_record *recs, size_t n,
+                            void *aux);
+
+/* Map-type specific sweep hook: evicts up to 'max' entries of 'map' that
+ * are idle at coarse time 'now', records their keys into 'recs' and
+ * returns how many it evicted. */
+typedef unsigned int ubpf_expiry_sweep_fn(struct ubpf_map *map, uint32_t now,
+                                          struct ubpf_expiry_record *recs,
+                                          unsigned int max);
+
+/* Coarse datapath clock in seconds, zero until the sweeper thread starts
+ * and advanced only by it.  Reading it is one relaxed load, cheap enough
+ * to stamp map entries on the PMD fast path. */
+extern atomic_uint32_t ubpf_expiry_clock;
+
+static inline uint32_t
+ubpf_expiry_now(void)
+{
+    uint32_t now;
+
+    atomic_read_relaxed(&ubpf_expiry_clock, &now);
+    return now;
+}
+
+void ubpf_expiry_register(struct ubpf_map *map, uint32_t prog_id,
+                          ubpf_expiry_sweep_fn *sweep);
+void ubpf_expiry_unregister(struct ubpf_map *map);
+void ubpf_expiry_set_cb(ubpf_expiry_cb *cb, void *aux);
+void ubpf_expiry_set_evict_hook(void (*hook)(void));
+
+#endif
@@ -14,25 +14,69 @@
  * limitations under the License.
  */
 #include <stdio.h>
+#include <limits.h>
 
 #include <config.h>
 #include "ubpf_hashmap.h"
+#include "ubpf_mem.h"
+
+#include "ovs-rcu.h"
+
+/* Chains a new arena of 'n_elems' element slots onto 'hmap' and threads the
+ * slots onto the free list.  ubpf_mem_alloc() never fails, so neither does
+ * growing the map. */
+static void
+hashmap_arena_add(struct hashmap *hmap, uint32_t n_elems)
+    OVS_REQUIRES(hmap->mutex)
+{
+    struct hmap_arena *arena = ubpf_mem_alloc(sizeof *arena
+                                              + CACHE_LINE_SIZE
+                                              + (size_t) n_elems
+                                                * hmap->elem_size);
+    /* 'elem_size' is sized so elements do not straddle cache lines; that
+     * only holds if the first slot starts on one. */
+    char *base = (char *) ROUND_UP((uintptr_t) arena->slots,
+                                   CACHE_LINE_SIZE);
+
+    for (uint32_t i = 0; i < n_elems; i++) {
+        struct hmap_elem *elem =
+            (void *) (base + (size_t) i * hmap->elem_size);
+        elem->owner = hmap;
+        elem->next_free = hmap->free_list;
+        hmap->free_list = elem;
+    }
+
+    arena->next = hmap->arenas;
+    hmap->arenas = arena;
+    hmap->n_elems += n_elems;
+}
 
 void *
 ubpf_hashmap_create(const struct ubpf_map_def *map_def)
 {
     struct hashmap *hmap = xzalloc(sizeof(*hmap));
 
-    hmap->nb_buckets = round_up_pow_of_two(map_def->max_entries);
-    hmap->count = 0;
-    hmap->elem_size = sizeof(struct hmap_elem) + round_up(map_def->key_size, 8)
-                             + map_def->value_size;
+    uint32_t elem_size = offsetof(struct hmap_elem, key)
+                         + round_up(map_def->key_size, 8)
+                         + map_def->value_size;
 
-    hmap->buckets = xmalloc(sizeof(struct ovs_list) * hmap->nb_buckets);
-    for (int i = 0; i < hmap->nb_buckets; i++) {
-        ovs_list_init(&hmap->buckets[i]);
+    cmap_init(&hmap->cmap);
+    ovs_mutex_init(&hmap->mutex);
+    /* Pad slots so an element never spans a cache-line boundary it could
+     * avoid: with a few words of action data the whole element -
+     * bookkeeping, key and value - is served by the one line the bucket
+     * walk touches anyway, and bigger elements at least start on one.
+     * Costs up to half a line of padding per slot for small elements. */
+    if (elem_size <= CACHE_LINE_SIZE) {
+        hmap->elem_size = round_up_pow_of_two(elem_size);
+    } else {
+        hmap->elem_size = round_up(elem_size, CACHE_LINE_SIZE);
     }
 
+    ovs_mutex_lock(&hmap->mutex);
+    hashmap_arena_add(hmap, 2 * map_def->max_entries);
+    ovs_mutex_unlock(&hmap->mutex);
+
     return hmap;
 }
 
@@ -40,27 +84,64 @@ void
 ubpf_hashmap_destroy(struct ubpf_map *map)
 {
     struct hashmap *hmap = map->data;
-    free(hmap->buckets);
+    struct hmap_arena *arena, *next;
+
+    /* The sweeper must let go of the map before its storage goes away;
+     * a no-op unless aging was ever enabled. */
+    ubpf_expiry_unregister(map);
+
+    /* Wait out any elements still parked for recycling so that
+     * hashmap_elem_recycle() cannot touch the map after it is gone. */
+    ovsrcu_synchronize();
+
+    cmap_destroy(&hmap->cmap);
+    ovs_mutex_destroy(&hmap->mutex);
+    for (arena = hmap->arenas; arena; arena = next) {
+        next = arena->next;
+        ubpf_mem_free(arena);
+    }
     free(hmap);
 }
 
-static inline uint32_t ubpf_hashmap_hash(const void *key, uint32_t key_len)
+static struct hmap_elem *
+hashmap_elem_alloc(struct hashmap *hmap)
+    OVS_REQUIRES(hmap->mutex)
+{
+    struct hmap_elem *elem = hmap->free_list;
+
+    if (elem) {
+        hmap->free_list = elem->next_free;
+    }
+    return elem;
+}
+
+/* RCU callback: returns 'elem_' to its arena's free list once no reader
+ * can hold a pointer into it anymore. */
+static void
+hashmap_elem_recycle(void *elem_)
 {
-    return hashlittle(key, key_len, 0);
+    struct hmap_elem *elem = elem_;
+    struct hashmap *hmap = elem->owner;
+
+    ovs_mutex_lock(&hmap->mutex);
+    elem->next_free = hmap->free_list;
+    hmap->free_list = elem;
+    ovs_mutex_unlock(&hmap->mutex);
 }
 
-static inline struct ovs_list *select_bucket(struct hashmap *hmap,
-                                               uint32_t hash)
+static inline uint32_t ubpf_hashmap_hash(const void *key, uint32_t key_len)
 {
-    return &hmap->buckets[hash & (hmap->nb_buckets - 1)];
+    /* hash_bytes() picks up hardware CRC32 where available, which matters
+     * here: this runs once per map access on the packet path. */
+    return hash_bytes(key, key_len, 0);
 }
 
-static inline struct hmap_elem* lookup_elem_raw(struct ovs_list *head,
+static inline struct hmap_elem* lookup_elem_raw(const struct cmap *cmap,
                                                 uint32_t hash, const void *key,
                                                 uint32_t key_size)
 {
     struct hmap_elem *l;
-    LIST_FOR_EACH(l, hash_node, head) {
+    CMAP_FOR_EACH_WITH_HASH (l, cmap_node, hash, cmap) {
         if (l->hash == hash && !memcmp(&l->key, key, key_size)) {
             return l;
         }
@@ -72,36 +153,45 @@ unsigned int
 ubpf_hashmap_size(const struct ubpf_map *map)
 {
     struct hashmap *hmap = map->data;
-    return hmap->count;
+    return cmap_count(&hmap->cmap);
 }
 
+/* Copies up to 'max_entries' (key, value) pairs into 'data', resuming
+ * from '*cursor' and advancing it.  Returns the number of pairs copied;
+ * zero means the iteration is complete.
+ *
+ * The walk reads the cmap under RCU, so writers and PMD threads are
+ * never paused, and the caller may quiesce between calls: the cursor
+ * holds bucket indexes, not element pointers.  The price is snapshot
+ * semantics - an entry inserted or removed while the dump is under way
+ * may be missed or returned twice. */
 unsigned int
-ubpf_hashmap_dump(const struct ubpf_map *map, char *data)
+ubpf_hashmap_dump_next(const struct ubpf_map *map,
+                       struct ubpf_map_cursor *cursor,
+                       unsigned int max_entries, char *data)
 {
     struct hashmap *hmap = map->data;
-    const struct ovs_list *head;
-    struct hmap_elem *element;
-    int key_size = map->key_size;
-    int value_size = map->value_size;
     int key_rounded_size = round_up(map->key_size, 8);
+    unsigned int count = 0;
 
-    for(int j = 0; j < hmap->nb_buckets; j++) {
-        head = hmap->buckets + j;
-
-        LIST_FOR_EACH(element, hash_node, head) {
-            if (element != NULL) {
-                char *key_pointer = element->key;
-                memcpy(data, key_pointer, key_size);
-                data += key_size;
+    while (count < max_entries) {
+        struct cmap_node *node = cmap_next_position(&hmap->cmap,
+                                                    &cursor->pos);
+        struct hmap_elem *elem;
 
-                char *value_pointer = key_pointer + key_rounded_size;
-                memcpy(data, value_pointer, value_size);
-                data += value_size;
-            }
+        if (!node) {
+            break;
         }
+        elem = CONTAINER_OF(node, struct hmap_elem, cmap_node);
+
+        memcpy(data, elem->key, map->key_size);
+        data += map->key_size;
+        memcpy(data, elem->key + key_rounded_size, map->value_size);
+        data += map->value_size;
+        count++;
     }
 
-    return hmap->count;
+    return count;
 }
 
 void *
@@ -111,15 +201,73 @@ ubpf_hashmap_lookup(const struct ubpf_map *map, const void *key)
     struct hashmap *hmap = map->data;
 
     uint32_t hash = ubpf_hashmap_hash(key, map->key_size);
-    struct ovs_list *head = select_bucket(hmap, hash);
-    elem = lookup_elem_raw(head, hash, key, map->key_size);
+    elem = lookup_elem_raw(&hmap->cmap, hash, key, map->key_size);
 
     if (elem) {
+        if (map->idle_timeout) {
+            elem->last_hit = ubpf_expiry_now();
+        }
         return elem->key + round_up(map->key_size, 8);
     }
     return NULL;
 }
 
+/* Looks up 'count' keys, laid out back to back at 'map''s key size, and
+ * stores a value pointer (or NULL) for each into 'values'.  Hashing all
+ * keys up front lets cmap_find_batch() prefetch every bucket before any
+ * of them is dereferenced, the same way dpcls_lookup() overlaps lookups
+ * across subtables, so a multi-table resubmit pays one DRAM latency for
+ * the whole batch instead of one per key. */
+void
+ubpf_hashmap_lookup_bulk(const struct ubpf_map *map, const void *keys,
+                         uint32_t count, void **values)
+{
+    const size_t chunk_max = sizeof(unsigned long) * CHAR_BIT;
+    struct hashmap *hmap = map->data;
+    const char *key = keys;
+    uint32_t done = 0;
+
+    while (done < count) {
+        uint32_t n = MIN(count - done, chunk_max);
+        const struct cmap_node *nodes[sizeof(unsigned long) * CHAR_BIT];
+        uint32_t hashes[sizeof(unsigned long) * CHAR_BIT];
+        unsigned long found;
+
+        for (uint32_t i = 0; i < n; i++) {
+            hashes[i] = ubpf_hashmap_hash(key + (size_t) i * map->key_size,
+                                          map->key_size);
+        }
+
+        found = cmap_find_batch(&hmap->cmap, n == chunk_max
+                                             ? ULONG_MAX
+                                             : (1UL << n) - 1,
+                                hashes, nodes);
+
+        for (uint32_t i = 0; i < n; i++) {
+            const char *ikey = key + (size_t) i * map->key_size;
+            struct hmap_elem *elem;
+
+            values[done + i] = NULL;
+            if (!(found & (1UL << i))) {
+                continue;
+            }
+            CMAP_NODE_FOR_EACH (elem, cmap_node, nodes[i]) {
+                if (elem->hash == hashes[i]
+                    && !memcmp(&elem->key, ikey, map->key_size)) {
+                    if (map->idle_timeout) {
+                        elem->last_hit = ubpf_expiry_now();
+                    }
+                    values[done + i] = elem->key + round_up(map->key_size, 8);
+                    break;
+                }
+            }
+        }
+
+        done += n;
+        key += (size_t) n * map->key_size;
+    }
+}
+
 int
 ubpf_hashmap_update(struct ubpf_map *map, const void *key, void *value)
 {
@@ -127,26 +275,33 @@ ubpf_hashmap_update(struct ubpf_map *map, const void *key, void *value)
     struct hashmap *hmap = map->data;
 
     uint32_t hash = ubpf_hashmap_hash(key, map->key_size);
-    struct ovs_list *head = select_bucket(hmap, hash);
-    old_elem = lookup_elem_raw(head, hash, key, map->key_size);
 
-    if (!old_elem && OVS_UNLIKELY(hmap->count >= map->max_entries)) {
-        return -4;
-    }
+    ovs_mutex_lock(&hmap->mutex);
+    old_elem = lookup_elem_raw(&hmap->cmap, hash, key, map->key_size);
 
-    struct hmap_elem *new_elem = xmalloc(hmap->elem_size);
+    struct hmap_elem *new_elem = hashmap_elem_alloc(hmap);
+    if (OVS_UNLIKELY(!new_elem)) {
+        /* Either the controller grew the table past 'max_entries' or every
+         * spare slot is parked waiting for a grace period.  'max_entries'
+         * only sizes the initial arena, so double the element storage
+         * rather than fail the insert. */
+        hashmap_arena_add(hmap, hmap->n_elems);
+        new_elem = hashmap_elem_alloc(hmap);
+    }
     new_elem->hash = hash;
+    new_elem->last_hit = ubpf_expiry_now();
     memcpy(new_elem->key, key, map->key_size);
     void *value_ptr = new_elem->key + round_up(map->key_size, 8);
     memcpy(value_ptr, value, map->value_size);
 
-    ovs_list_insert(head, &new_elem->hash_node);
     if (old_elem) {
-        ovs_list_remove(&old_elem->hash_node);
-        free(old_elem);
+        cmap_replace(&hmap->cmap, &old_elem->cmap_node,
+                     &new_elem->cmap_node, hash);
+        ovsrcu_postpone(hashmap_elem_recycle, old_elem);
     } else {
-        hmap->count++;
+        cmap_insert(&hmap->cmap, &new_elem->cmap_node, hash);
     }
+    ovs_mutex_unlock(&hmap->mutex);
 
     return 0;
 }
@@ -158,16 +313,79 @@ ubpf_hashmap_delete(struct ubpf_map *map, const void *key)
     struct hashmap *hmap = map->data;
 
     uint32_t hash = ubpf_hashmap_hash(key, map->key_size);
-    struct ovs_list *head = select_bucket(hmap, hash);
-    elem = lookup_elem_raw(head, hash, key, map->key_size);
+
+    ovs_mutex_lock(&hmap->mutex);
+    elem = lookup_elem_raw(&hmap->cmap, hash, key, map->key_size);
 
     if (!elem) {
+        ovs_mutex_unlock(&hmap->mutex);
         return -4;
     }
 
-    ovs_list_remove(&elem->hash_node);
-    free(elem);
-    hmap->count--;
+    cmap_remove(&hmap->cmap, &elem->cmap_node, elem->hash);
+    ovs_mutex_unlock(&hmap->mutex);
+    ovsrcu_postpone(hashmap_elem_recycle, elem);
 
     return 0;
 }
+
+/* Ages out entries that go 'secs' seconds without a lookup hit, 0 to
+ * disable.  'prog_id' tags the eviction notifications.  The timeout is
+ * a plain word racing with PMD readers, who at worst stamp or skip a
+ * stamp for one more lookup - harmless at second grain. */
+void
+ubpf_hashmap_set_idle_timeout(struct ubpf_map *map, uint32_t secs,
+                              uint32_t prog_id)
+{
+    map->idle_timeout = secs;
+    if (secs) {
+        ubpf_expiry_register(map, prog_id, ubpf_hashmap_sweep_expired);
+    } else {
+        ubpf_expiry_unregister(map);
+    }
+}
+
+#define HASHMAP_SWEEP_CHUNK 1024
+
+/* Expiry hook (see ubpf_expiry.h): scans up to HASHMAP_SWEEP_CHUNK
+ * entries from the saved position, evicting those whose last hit is at
+ * least the map's timeout behind 'now' and recording their keys.  The
+ * position survives across calls, so a large table is aged in bounded
+ * slices instead of one long mutex hold; removals move cmap nodes
+ * around, so a slice may skip or revisit an entry - it just waits for
+ * the next pass. */
+unsigned int
+ubpf_hashmap_sweep_expired(struct ubpf_map *map, uint32_t now,
+                           struct ubpf_expiry_record *recs, unsigned int max)
+{
+    struct hashmap *hmap = map->data;
+    unsigned int scanned = 0;
+    unsigned int n = 0;
+
+    if (map->key_size > UBPF_EXPIRY_KEY_MAX) {
+        return 0;
+    }
+
+    ovs_mutex_lock(&hmap->mutex);
+    while (n < max && scanned < HASHMAP_SWEEP_CHUNK) {
+        struct cmap_node *node = cmap_next_position(&hmap->cmap,
+                                                    &hmap->sweep_pos);
+        struct hmap_elem *elem;
+
+        if (!node) {
+            break;              /* Wrapped; resume from the top next pass. */
+        }
+        elem = CONTAINER_OF(node, struct hmap_elem, cmap_node);
+        scanned++;
+        if (now - elem->last_hit >= map->idle_timeout) {
+            recs[n].key_len = map->key_size;
+            memcpy(recs[n].key, elem->key, map->key_size);
+            n++;
+            cmap_remove(&hmap->cmap, &elem->cmap_node, elem->hash);
+            ovsrcu_postpone(hashmap_elem_recycle, elem);
+        }
+    }
+    ovs_mutex_unlock(&hmap->mutex);
+
+    return n;
+}
@@ -16,9 +16,11 @@
 #ifndef UBPF_HASHMAP_H
 #define UBPF_HASHMAP_H 1
 
-#include "openvswitch/list.h"
+#include "cmap.h"
+#include "ovs-thread.h"
 
-#include "lookup3.h"
+#include "hash.h"
+#include "ubpf_expiry.h"
 #include "ubpf_int.h"
 #include "util.h"
 
@@ -39,28 +41,74 @@
 
 void *ubpf_hashmap_create(const struct ubpf_map_def *map_def);
 unsigned int ubpf_hashmap_size(const struct ubpf_map *map);
-unsigned int ubpf_hashmap_dump(const struct ubpf_map *map, char *data);
+unsigned int ubpf_hashmap_dump_next(const struct ubpf_map *map,
+                                    struct ubpf_map_cursor *cursor,
+                                    unsigned int max_entries, char *data);
 void *ubpf_hashmap_lookup(const struct ubpf_map *map, const void *key);
+void ubpf_hashmap_lookup_bulk(const struct ubpf_map *map, const void *keys,
+                              uint32_t count, void **values);
 int ubpf_hashmap_update(struct ubpf_map *map, const void *key, void *value);
 int ubpf_hashmap_delete(struct ubpf_map *map, const void *key);
+void ubpf_hashmap_set_idle_timeout(struct ubpf_map *map, uint32_t secs,
+                                   uint32_t prog_id);
+unsigned int ubpf_hashmap_sweep_expired(struct ubpf_map *map, uint32_t now,
+                                        struct ubpf_expiry_record *recs,
+                                        unsigned int max);
 void ubpf_hashmap_destroy(struct ubpf_map *map);
 
+/* Reader-mostly hash map.  Lookups from PMD threads walk the RCU-friendly
+ * cmap without taking any lock; 'mutex' only serializes control-plane
+ * updates against each other.
+ *
+ * Elements live in arenas and are handed out from 'free_list', so table
+ * churn does pointer manipulation instead of hitting the heap allocator on
+ * every insert and delete.  The initial arena holds twice 'max_entries'
+ * elements because a replaced or deleted element keeps its slot until a
+ * grace period has passed.  When a controller grows the table past that,
+ * the map doubles by chaining on another arena: existing elements never
+ * move and the cmap rehashes its buckets incrementally, so concurrent
+ * readers are undisturbed. */
 struct hashmap {
-    struct ovs_list *buckets;
-    uint32_t count;
-    uint32_t nb_buckets;
+    struct cmap cmap;
+    struct ovs_mutex mutex;     /* Serializes writers. */
     uint32_t elem_size;
+    uint32_t n_elems OVS_GUARDED; /* Total element slots across arenas. */
+    struct hmap_arena *arenas OVS_GUARDED; /* Chain of element arenas. */
+    struct hmap_elem *free_list OVS_GUARDED; /* Unused arena slots. */
+    struct cmap_position sweep_pos OVS_GUARDED; /* Expiry sweeper resume
+                                                 * position. */
+};
+
+struct hmap_arena {
+    struct hmap_arena *next;    /* Link in owner's arena chain. */
+    char slots[0] OVS_ALIGNED_VAR(8); /* Element slots; the first one is
+                                       * aligned up to a cache line. */
 };
 
+/* The free-list link shares storage with the key: an element is either
+ * live, when the key and value matter, or parked on the free list, when
+ * they do not.  That keeps the live part of the element - hash, key and
+ * value - starting 24 bytes in, so a small action value (an egress port
+ * and a next-hop index, say) sits in the same cache line the bucket walk
+ * already pulled in to compare the key. */
 struct hmap_elem {
-    struct ovs_list hash_node;
+    struct cmap_node cmap_node;
+    struct hashmap *owner;      /* Arena this element was carved from. */
     uint32_t hash;
-    char key[0] OVS_ALIGNED_VAR(8);
+    uint32_t last_hit;          /* Coarse ubpf_expiry_now() stamp of the last
+                                 * lookup hit; racy plain stores, an exact
+                                 * value does not matter at second grain. */
+    union {
+        struct hmap_elem *next_free; /* Link in owner->free_list when
+                                      * unused. */
+        char key[0] OVS_ALIGNED_VAR(8); /* Key, then value, while live. */
+    };
 };
 
 static const struct ubpf_map_ops ubpf_hashmap_ops = {
     .map_size = ubpf_hashmap_size,
-    .map_dump = ubpf_hashmap_dump,
+    .map_dump = NULL,           /* Streamed; see ubpf_hashmap_dump_next(). */
+    .map_dump_next = ubpf_hashmap_dump_next,
     .map_lookup = ubpf_hashmap_lookup,
     .map_update = ubpf_hashmap_update,
     .map_delete = ubpf_hashmap_delete,
@@ -70,4 +118,4 @@ static const struct ubpf_map_ops ubpf_hashmap_ops = {
 
 #define BPF_KEY_IS_HASH 1
 
-#endif
\ No newline at end of file
+#endif
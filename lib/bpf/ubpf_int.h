@@ -19,7 +19,10 @@
 
 #include "ubpf.h"
 #include "ebpf.h"
+#include "cmap.h"
 #include "openvswitch/hmap.h"
+#include "ovs-atomic.h"
+#include "ovs-rcu.h"
 
 #define MAX_INSTS 65536
 #define STACK_SIZE 1024
@@ -64,6 +67,13 @@ enum ubpf_map_type {
     UBPF_MAP_TYPE_COUNTMIN = 3,
     UBPF_MAP_TYPE_HASHMAP = 4,
     UBPF_MAP_TYPE_LPM_TRIE = 5,
+    UBPF_MAP_TYPE_LPM_DIR24 = 6,
+    UBPF_MAP_TYPE_PERCPU_ARRAY = 7,
+    UBPF_MAP_TYPE_PERCPU_HASHMAP = 8,
+    UBPF_MAP_TYPE_METER = 9,
+    UBPF_MAP_TYPE_TERNARY = 10,
+    UBPF_MAP_TYPE_ACT_SELECTOR = 11,
+    UBPF_MAP_TYPE_RANGE = 12,
 };
 
 struct ubpf_map_def {
@@ -76,9 +86,40 @@ struct ubpf_map_def {
 
 struct ubpf_map;
 
+/* Position of a streaming map dump (see ubpf_map_dump_next()).  Zero it
+ * before the first call; opaque to callers after that. */
+struct ubpf_map_cursor {
+    struct cmap_position pos;
+};
+
+/* Lookup telemetry, kept per map.  Threads pick a shard at
+ * ovsthread_id_self() % UBPF_MAP_STATS_SHARDS, the same scheme as the
+ * per-thread map replicas, so a shard normally has a single writer and
+ * the increments are plain stores on a private cache line; colliding
+ * thread ids race benignly at the cost of an occasional lost count.
+ * Readers sum the shards. */
+#define UBPF_MAP_STATS_SHARDS 16
+
+struct ubpf_map_stats_shard {
+    OVS_ALIGNED_VAR(CACHE_LINE_SIZE) uint64_t hits;
+    uint64_t misses;
+};
+
+/* Per-NUMA-node clones of a read-mostly map (see
+ * ubpf_map_set_numa_replication()).  'rep[node]' is a full map whose data
+ * lives on that node; the primary map stays the source of truth for the
+ * control plane. */
+struct ubpf_map_replicas {
+    int n;                      /* One clone per NUMA node at enable time. */
+    struct ubpf_map *rep[0];
+};
+
 struct ubpf_map_ops {
     unsigned int (*map_size)(const struct ubpf_map *map);
     unsigned int (*map_dump)(const struct ubpf_map *map, char *data);
+    unsigned int (*map_dump_next)(const struct ubpf_map *map,
+                                  struct ubpf_map_cursor *cursor,
+                                  unsigned int max_entries, char *data);
     void *(*map_lookup)(const struct ubpf_map *map, const void *key);
     int (*map_update)(struct ubpf_map *map, const void *key, void *value);
     int (*map_delete)(struct ubpf_map *map, const void *key);
@@ -95,25 +136,69 @@ struct ubpf_map {
     unsigned int value_size;
     unsigned int max_entries;
     void *data;
+    void *staged;               /* Build-aside table for an open replace
+                                 * transaction, otherwise NULL (see
+                                 * ubpf_map_replace_begin()). */
+    uint32_t idle_timeout;      /* Seconds an entry may go without a lookup
+                                 * hit before the expiry sweeper evicts it;
+                                 * 0 disables aging (see ubpf_expiry.h). */
+    struct ubpf_map_replicas *numa_replicas; /* Node-local clones lookups
+                                 * read instead of 'data', or NULL when
+                                 * the table is not replicated. */
+    struct ubpf_map_stats_shard *stats; /* UBPF_MAP_STATS_SHARDS shards. */
+};
+
+/* Execution profile, attached to a VM by ubpf_profile_start().
+ *
+ * While a profile is attached packets run through the interpreter, which
+ * counts every helper invocation and samples the program counter once per
+ * UBPF_PROFILE_SAMPLE_INTERVAL executed instructions.  All counters are
+ * bumped with relaxed atomics, so PMD threads never synchronize on them
+ * and concurrent increments race only benignly. */
+#define UBPF_PROFILE_MAX_HELPERS 64
+#define UBPF_PROFILE_SAMPLE_INTERVAL 64
+
+struct ubpf_profile {
+    uint16_t num_insts;               /* Number of 'insn_samples' slots. */
+    ATOMIC(uint64_t) helper_calls[UBPF_PROFILE_MAX_HELPERS];
+    ATOMIC(uint64_t) insn_samples[0]; /* One slot per instruction. */
 };
 
 struct ubpf_vm {
     ovs_be16 prog_id;
     struct hmap_node hmap_node;
     struct ebpf_inst *insts;
+    uint8_t *int_ops;       /* Interpreter dispatch opcode per instruction:
+                             * the instruction's own opcode, or a
+                             * superinstruction for a fused pair. */
+    unsigned long *proven_access; /* Bitmap over instructions: set bits mark
+                                   * loads and stores proven in bounds at
+                                   * load time, which the interpreter
+                                   * executes without a runtime check.
+                                   * NULL if the program could not be
+                                   * analyzed. */
     uint16_t num_insts;
     ubpf_jit_fn jitted;
     size_t jitted_size;
+    ubpf_jit_batch_fn jitted_batch; /* NULL if the backend has no batch mode. */
+    size_t jitted_batch_size;
     struct ubpf_func_proto *ext_funcs;
     const char **ext_func_names;
     struct ubpf_map **ext_maps;
     const char **ext_map_names;
     uint16_t nb_maps;
+    bool uses_adjust_head;  /* Program calls ubpf_adjust_head() somewhere. */
+    uint16_t parse_depth;   /* Furthest packet byte the program can read, as
+                             * proven at load time; 0 when unknown or when
+                             * the program can reach the whole packet. */
     unsigned long long int loaded_at;
+    OVSRCU_TYPE(struct ubpf_profile *) profile; /* NULL unless profiling. */
 };
 
 char *ubpf_error(const char *fmt, ...);
 unsigned int ubpf_lookup_registered_function(struct ubpf_vm *vm, const char *name);
 struct ubpf_map *ubpf_lookup_registered_map(struct ubpf_vm *vm, const char *name);
+int ubpf_profile_start(struct ubpf_vm *vm);
+void ubpf_profile_stop(struct ubpf_vm *vm);
 
 #endif
@@ -0,0 +1,583 @@
+/*
+ * Copyright 2015 Big Switch Networks, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _GNU_SOURCE
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include "util.h"
+#include "ubpf_int.h"
+
+#if defined(__aarch64__)
+
+#include "ubpf_jit_arm64.h"
+
+/* Special values for target_pc in struct jump */
+#define TARGET_PC_EXIT -1
+#define TARGET_PC_DIV_BY_ZERO -2
+
+/* Scratch registers, never part of the eBPF register file.  TMP1 holds
+ * materialized immediates and call targets, TMP2 holds out-of-range
+ * load/store offsets and the PC passed to the division-by-zero handler,
+ * TMP3 holds the quotient while computing a modulus. */
+#define TMP1 A64_R8
+#define TMP2 A64_R7
+#define TMP3 A64_R9
+
+static void muldivmod(struct jit_state *state, uint16_t pc, uint8_t opcode, int src, int dst, int32_t imm);
+
+#define REGISTER_MAP_SIZE 11
+static int register_map[REGISTER_MAP_SIZE] = {
+    A64_R5,
+    A64_R0,
+    A64_R1,
+    A64_R2,
+    A64_R3,
+    A64_R4,
+    A64_R19,
+    A64_R20,
+    A64_R21,
+    A64_R22,
+    A64_R25,
+};
+
+/* Return the A64 register for the given eBPF register.  eBPF r1-r5 map
+ * straight onto the AAPCS64 argument registers so external helper calls
+ * need no argument shuffling; r6-r10 live in callee-saved registers. */
+static int
+map_register(int r)
+{
+    ovs_assert(r < REGISTER_MAP_SIZE);
+    return register_map[r % REGISTER_MAP_SIZE];
+}
+
+static int
+translate(struct ubpf_vm *vm, struct jit_state *state, char **errmsg)
+{
+    emit_push_pair(state, A64_FP, A64_LR);
+    emit_addsub_imm(state, true, false, A64_SP, A64_FP, 0);
+    emit_push_pair(state, A64_R19, A64_R20);
+    emit_push_pair(state, A64_R21, A64_R22);
+    emit_push_pair(state, A64_R25, A64_R26);
+
+    emit_mov(state, A64_R2, A64_R26);
+
+    /* First argument is already in map_register(1) == x0. */
+
+    /* Allocate stack space and point eBPF r10 at the top of it. */
+    emit_addsub_imm(state, true, true, A64_SP, A64_SP, STACK_SIZE);
+    emit_addsub_imm(state, true, false, A64_SP, map_register(10), STACK_SIZE);
+
+    int i;
+    for (i = 0; i < vm->num_insts; i++) {
+        struct ebpf_inst inst = vm->insts[i];
+        state->pc_locs[i] = state->offset;
+
+        int dst = map_register(inst.dst);
+        int src = map_register(inst.src);
+        uint32_t target_pc = i + inst.offset + 1;
+
+        switch (inst.opcode) {
+        case EBPF_OP_ADD_IMM:
+            emit_load_imm(state, TMP1, (uint32_t)inst.imm);
+            emit_alu_reg(state, false, A64_OP_ADD, TMP1, dst, dst);
+            break;
+        case EBPF_OP_ADD_REG:
+            emit_alu_reg(state, false, A64_OP_ADD, src, dst, dst);
+            break;
+        case EBPF_OP_SUB_IMM:
+            emit_load_imm(state, TMP1, (uint32_t)inst.imm);
+            emit_alu_reg(state, false, A64_OP_SUB, TMP1, dst, dst);
+            break;
+        case EBPF_OP_SUB_REG:
+            emit_alu_reg(state, false, A64_OP_SUB, src, dst, dst);
+            break;
+        case EBPF_OP_MUL_IMM:
+        case EBPF_OP_MUL_REG:
+        case EBPF_OP_DIV_IMM:
+        case EBPF_OP_DIV_REG:
+        case EBPF_OP_MOD_IMM:
+        case EBPF_OP_MOD_REG:
+            muldivmod(state, i, inst.opcode, src, dst, inst.imm);
+            break;
+        case EBPF_OP_OR_IMM:
+            emit_load_imm(state, TMP1, (uint32_t)inst.imm);
+            emit_alu_reg(state, false, A64_OP_ORR, TMP1, dst, dst);
+            break;
+        case EBPF_OP_OR_REG:
+            emit_alu_reg(state, false, A64_OP_ORR, src, dst, dst);
+            break;
+        case EBPF_OP_AND_IMM:
+            emit_load_imm(state, TMP1, (uint32_t)inst.imm);
+            emit_alu_reg(state, false, A64_OP_AND, TMP1, dst, dst);
+            break;
+        case EBPF_OP_AND_REG:
+            emit_alu_reg(state, false, A64_OP_AND, src, dst, dst);
+            break;
+        case EBPF_OP_LSH_IMM:
+            emit_load_imm(state, TMP1, (uint32_t)inst.imm);
+            emit_alu_reg(state, false, A64_OP_LSLV, TMP1, dst, dst);
+            break;
+        case EBPF_OP_LSH_REG:
+            emit_alu_reg(state, false, A64_OP_LSLV, src, dst, dst);
+            break;
+        case EBPF_OP_RSH_IMM:
+            emit_load_imm(state, TMP1, (uint32_t)inst.imm);
+            emit_alu_reg(state, false, A64_OP_LSRV, TMP1, dst, dst);
+            break;
+        case EBPF_OP_RSH_REG:
+            emit_alu_reg(state, false, A64_OP_LSRV, src, dst, dst);
+            break;
+        case EBPF_OP_NEG:
+            emit_alu_reg(state, false, A64_OP_SUB, dst, A64_XZR, dst);
+            break;
+        case EBPF_OP_XOR_IMM:
+            emit_load_imm(state, TMP1, (uint32_t)inst.imm);
+            emit_alu_reg(state, false, A64_OP_EOR, TMP1, dst, dst);
+            break;
+        case EBPF_OP_XOR_REG:
+            emit_alu_reg(state, false, A64_OP_EOR, src, dst, dst);
+            break;
+        case EBPF_OP_MOV_IMM:
+            emit_load_imm(state, dst, (uint32_t)inst.imm);
+            break;
+        case EBPF_OP_MOV_REG:
+            emit_alu_reg(state, false, A64_OP_ORR, src, A64_XZR, dst);
+            break;
+        case EBPF_OP_ARSH_IMM:
+            emit_load_imm(state, TMP1, (uint32_t)inst.imm);
+            emit_alu_reg(state, false, A64_OP_ASRV, TMP1, dst, dst);
+            break;
+        case EBPF_OP_ARSH_REG:
+            emit_alu_reg(state, false, A64_OP_ASRV, src, dst, dst);
+            break;
+
+        case EBPF_OP_LE:
+            /* No-op */
+            break;
+        case EBPF_OP_BE:
+            if (inst.imm == 16) {
+                /* rev16 dst, dst; uxth dst, dst */
+                emit_insn(state, UINT32_C(0xdac00400) | (dst << 5) | dst);
+                emit_insn(state, UINT32_C(0x53003c00) | (dst << 5) | dst);
+            } else if (inst.imm == 32) {
+                /* rev wdst, wdst */
+                emit_insn(state, UINT32_C(0x5ac00800) | (dst << 5) | dst);
+            } else if (inst.imm == 64) {
+                /* rev xdst, xdst */
+                emit_insn(state, UINT32_C(0xdac00c00) | (dst << 5) | dst);
+            }
+            break;
+
+        case EBPF_OP_ADD64_IMM:
+            emit_load_imm(state, TMP1, (int64_t)inst.imm);
+            emit_alu_reg(state, true, A64_OP_ADD, TMP1, dst, dst);
+            break;
+        case EBPF_OP_ADD64_REG:
+            emit_alu_reg(state, true, A64_OP_ADD, src, dst, dst);
+            break;
+        case EBPF_OP_SUB64_IMM:
+            emit_load_imm(state, TMP1, (int64_t)inst.imm);
+            emit_alu_reg(state, true, A64_OP_SUB, TMP1, dst, dst);
+            break;
+        case EBPF_OP_SUB64_REG:
+            emit_alu_reg(state, true, A64_OP_SUB, src, dst, dst);
+            break;
+        case EBPF_OP_MUL64_IMM:
+        case EBPF_OP_MUL64_REG:
+        case EBPF_OP_DIV64_IMM:
+        case EBPF_OP_DIV64_REG:
+        case EBPF_OP_MOD64_IMM:
+        case EBPF_OP_MOD64_REG:
+            muldivmod(state, i, inst.opcode, src, dst, inst.imm);
+            break;
+        case EBPF_OP_OR64_IMM:
+            emit_load_imm(state, TMP1, (int64_t)inst.imm);
+            emit_alu_reg(state, true, A64_OP_ORR, TMP1, dst, dst);
+            break;
+        case EBPF_OP_OR64_REG:
+            emit_alu_reg(state, true, A64_OP_ORR, src, dst, dst);
+            break;
+        case EBPF_OP_AND64_IMM:
+            emit_load_imm(state, TMP1, (int64_t)inst.imm);
+            emit_alu_reg(state, true, A64_OP_AND, TMP1, dst, dst);
+            break;
+        case EBPF_OP_AND64_REG:
+            emit_alu_reg(state, true, A64_OP_AND, src, dst, dst);
+            break;
+        case EBPF_OP_LSH64_IMM:
+            emit_load_imm(state, TMP1, (uint32_t)inst.imm);
+            emit_alu_reg(state, true, A64_OP_LSLV, TMP1, dst, dst);
+            break;
+        case EBPF_OP_LSH64_REG:
+            emit_alu_reg(state, true, A64_OP_LSLV, src, dst, dst);
+            break;
+        case EBPF_OP_RSH64_IMM:
+            emit_load_imm(state, TMP1, (uint32_t)inst.imm);
+            emit_alu_reg(state, true, A64_OP_LSRV, TMP1, dst, dst);
+            break;
+        case EBPF_OP_RSH64_REG:
+            emit_alu_reg(state, true, A64_OP_LSRV, src, dst, dst);
+            break;
+        case EBPF_OP_NEG64:
+            emit_alu_reg(state, true, A64_OP_SUB, dst, A64_XZR, dst);
+            break;
+        case EBPF_OP_XOR64_IMM:
+            emit_load_imm(state, TMP1, (int64_t)inst.imm);
+            emit_alu_reg(state, true, A64_OP_EOR, TMP1, dst, dst);
+            break;
+        case EBPF_OP_XOR64_REG:
+            emit_alu_reg(state, true, A64_OP_EOR, src, dst, dst);
+            break;
+        case EBPF_OP_MOV64_IMM:
+            emit_load_imm(state, dst, (int64_t)inst.imm);
+            break;
+        case EBPF_OP_MOV64_REG:
+            emit_mov(state, src, dst);
+            break;
+        case EBPF_OP_ARSH64_IMM:
+            emit_load_imm(state, TMP1, (uint32_t)inst.imm);
+            emit_alu_reg(state, true, A64_OP_ASRV, TMP1, dst, dst);
+            break;
+        case EBPF_OP_ARSH64_REG:
+            emit_alu_reg(state, true, A64_OP_ASRV, src, dst, dst);
+            break;
+
+        case EBPF_OP_JA:
+            emit_jmp(state, target_pc);
+            break;
+        case EBPF_OP_JEQ_IMM:
+            emit_load_imm(state, TMP1, (int64_t)inst.imm);
+            emit_cmp(state, TMP1, dst);
+            emit_jcc(state, COND_EQ, target_pc);
+            break;
+        case EBPF_OP_JEQ_REG:
+            emit_cmp(state, src, dst);
+            emit_jcc(state, COND_EQ, target_pc);
+            break;
+        case EBPF_OP_JGT_IMM:
+            emit_load_imm(state, TMP1, (int64_t)inst.imm);
+            emit_cmp(state, TMP1, dst);
+            emit_jcc(state, COND_HI, target_pc);
+            break;
+        case EBPF_OP_JGT_REG:
+            emit_cmp(state, src, dst);
+            emit_jcc(state, COND_HI, target_pc);
+            break;
+        case EBPF_OP_JGE_IMM:
+            emit_load_imm(state, TMP1, (int64_t)inst.imm);
+            emit_cmp(state, TMP1, dst);
+            emit_jcc(state, COND_CS, target_pc);
+            break;
+        case EBPF_OP_JGE_REG:
+            emit_cmp(state, src, dst);
+            emit_jcc(state, COND_CS, target_pc);
+            break;
+        case EBPF_OP_JSET_IMM:
+            emit_load_imm(state, TMP1, (int64_t)inst.imm);
+            emit_tst(state, TMP1, dst);
+            emit_jcc(state, COND_NE, target_pc);
+            break;
+        case EBPF_OP_JSET_REG:
+            emit_tst(state, src, dst);
+            emit_jcc(state, COND_NE, target_pc);
+            break;
+        case EBPF_OP_JNE_IMM:
+            emit_load_imm(state, TMP1, (int64_t)inst.imm);
+            emit_cmp(state, TMP1, dst);
+            emit_jcc(state, COND_NE, target_pc);
+            break;
+        case EBPF_OP_JNE_REG:
+            emit_cmp(state, src, dst);
+            emit_jcc(state, COND_NE, target_pc);
+            break;
+        case EBPF_OP_JSGT_IMM:
+            emit_load_imm(state, TMP1, (int64_t)inst.imm);
+            emit_cmp(state, TMP1, dst);
+            emit_jcc(state, COND_GT, target_pc);
+            break;
+        case EBPF_OP_JSGT_REG:
+            emit_cmp(state, src, dst);
+            emit_jcc(state, COND_GT, target_pc);
+            break;
+        case EBPF_OP_JSGE_IMM:
+            emit_load_imm(state, TMP1, (int64_t)inst.imm);
+            emit_cmp(state, TMP1, dst);
+            emit_jcc(state, COND_GE, target_pc);
+            break;
+        case EBPF_OP_JSGE_REG:
+            emit_cmp(state, src, dst);
+            emit_jcc(state, COND_GE, target_pc);
+            break;
+        case EBPF_OP_CALL:
+            /* eBPF r1-r5 already sit in x0-x4. */
+            emit_call(state, vm->ext_funcs[inst.imm].func, TMP1);
+            if (map_register(0) != A64_R0) {
+                emit_mov(state, A64_R0, map_register(0));
+            }
+            break;
+        case EBPF_OP_EXIT:
+            if (i != vm->num_insts - 1) {
+                emit_jmp(state, TARGET_PC_EXIT);
+            }
+            break;
+
+        case EBPF_OP_LDABSB:
+            emit_load(state, S8,  A64_R26, map_register(0), inst.imm, TMP1);
+            break;
+        case EBPF_OP_LDABSH:
+            emit_load(state, S16, A64_R26, map_register(0), inst.imm, TMP1);
+            break;
+        case EBPF_OP_LDABSW:
+            emit_load(state, S32, A64_R26, map_register(0), inst.imm, TMP1);
+            break;
+        case EBPF_OP_LDABSDW:
+            emit_load(state, S64, A64_R26, map_register(0), inst.imm, TMP1);
+            break;
+        case EBPF_OP_LDINDB:
+            emit_alu_reg(state, true, A64_OP_ADD, src, A64_R26, TMP2);
+            emit_load(state, S8,  TMP2, map_register(0), inst.imm, TMP1);
+            break;
+        case EBPF_OP_LDINDH:
+            emit_alu_reg(state, true, A64_OP_ADD, src, A64_R26, TMP2);
+            emit_load(state, S16, TMP2, map_register(0), inst.imm, TMP1);
+            break;
+        case EBPF_OP_LDINDW:
+            emit_alu_reg(state, true, A64_OP_ADD, src, A64_R26, TMP2);
+            emit_load(state, S32, TMP2, map_register(0), inst.imm, TMP1);
+            break;
+        case EBPF_OP_LDINDDW:
+            emit_alu_reg(state, true, A64_OP_ADD, src, A64_R26, TMP2);
+            emit_load(state, S64, TMP2, map_register(0), inst.imm, TMP1);
+            break;
+        case EBPF_OP_LDXW:
+            emit_load(state, S32, src, dst, inst.offset, TMP1);
+            break;
+        case EBPF_OP_LDXH:
+            emit_load(state, S16, src, dst, inst.offset, TMP1);
+            break;
+        case EBPF_OP_LDXB:
+            emit_load(state, S8, src, dst, inst.offset, TMP1);
+            break;
+        case EBPF_OP_LDXDW:
+            emit_load(state, S64, src, dst, inst.offset, TMP1);
+            break;
+
+        case EBPF_OP_STW:
+            emit_load_imm(state, TMP1, (uint32_t)inst.imm);
+            emit_store(state, S32, TMP1, dst, inst.offset, TMP2);
+            break;
+        case EBPF_OP_STH:
+            emit_load_imm(state, TMP1, (uint32_t)inst.imm);
+            emit_store(state, S16, TMP1, dst, inst.offset, TMP2);
+            break;
+        case EBPF_OP_STB:
+            emit_load_imm(state, TMP1, (uint32_t)inst.imm);
+            emit_store(state, S8, TMP1, dst, inst.offset, TMP2);
+            break;
+        case EBPF_OP_STDW:
+            emit_load_imm(state, TMP1, (int64_t)inst.imm);
+            emit_store(state, S64, TMP1, dst, inst.offset, TMP2);
+            break;
+
+        case EBPF_OP_STXW:
+            emit_store(state, S32, src, dst, inst.offset, TMP1);
+            break;
+        case EBPF_OP_STXH:
+            emit_store(state, S16, src, dst, inst.offset, TMP1);
+            break;
+        case EBPF_OP_STXB:
+            emit_store(state, S8, src, dst, inst.offset, TMP1);
+            break;
+        case EBPF_OP_STXDW:
+            emit_store(state, S64, src, dst, inst.offset, TMP1);
+            break;
+
+        case EBPF_OP_LDDW: {
+            struct ebpf_inst inst2 = vm->insts[++i];
+            uint64_t imm = (uint32_t)inst.imm | ((uint64_t)inst2.imm << 32);
+            emit_load_imm(state, dst, imm);
+            break;
+        }
+
+        default:
+            *errmsg = ubpf_error("Unknown instruction at PC %d: opcode %02x", i, inst.opcode);
+            return -1;
+        }
+    }
+
+    /* Epilogue */
+    state->exit_loc = state->offset;
+
+    /* Move register 0 into x0 */
+    if (map_register(0) != A64_R0) {
+        emit_mov(state, map_register(0), A64_R0);
+    }
+
+    /* Deallocate stack space */
+    emit_addsub_imm(state, true, false, A64_SP, A64_SP, STACK_SIZE);
+
+    emit_pop_pair(state, A64_R25, A64_R26);
+    emit_pop_pair(state, A64_R21, A64_R22);
+    emit_pop_pair(state, A64_R19, A64_R20);
+    emit_pop_pair(state, A64_FP, A64_LR);
+
+    emit_ret(state);
+
+    /* Division by zero handler */
+    const char *div_by_zero_fmt = "uBPF error: division by zero at PC %u\n";
+    state->div_by_zero_loc = state->offset;
+    emit_load_imm(state, A64_R0, (uintptr_t)stderr);
+    emit_load_imm(state, A64_R1, (uintptr_t)div_by_zero_fmt);
+    emit_mov(state, TMP2, A64_R2); /* muldivmod stored pc in TMP2 */
+    emit_call(state, fprintf, TMP1);
+    emit_load_imm(state, map_register(0), -1);
+    emit_jmp(state, TARGET_PC_EXIT);
+
+    return 0;
+}
+
+static void
+muldivmod(struct jit_state *state, uint16_t pc, uint8_t opcode, int src, int dst, int32_t imm)
+{
+    bool mul = (opcode & EBPF_ALU_OP_MASK) == (EBPF_OP_MUL_IMM & EBPF_ALU_OP_MASK);
+    bool div = (opcode & EBPF_ALU_OP_MASK) == (EBPF_OP_DIV_IMM & EBPF_ALU_OP_MASK);
+    bool mod = (opcode & EBPF_ALU_OP_MASK) == (EBPF_OP_MOD_IMM & EBPF_ALU_OP_MASK);
+    bool is64 = (opcode & EBPF_CLS_MASK) == EBPF_CLS_ALU64;
+    int rm = src;
+
+    if (EBPF_SRC(opcode) == EBPF_SRC_IMM) {
+        emit_load_imm(state, TMP1, is64 ? (int64_t)imm : (uint32_t)imm);
+        rm = TMP1;
+    }
+
+    if (div || mod) {
+        emit_load_imm(state, TMP2, pc);
+        emit_cbz(state, is64, rm, TARGET_PC_DIV_BY_ZERO);
+    }
+
+    if (mul) {
+        emit_muladd(state, is64, false, rm, A64_XZR, dst, dst);
+    } else if (div) {
+        emit_alu_reg(state, is64, A64_OP_UDIV, rm, dst, dst);
+    } else if (mod) {
+        emit_alu_reg(state, is64, A64_OP_UDIV, rm, dst, TMP3);
+        emit_muladd(state, is64, true, rm, dst, TMP3, dst);
+    }
+}
+
+static void
+resolve_jumps(struct jit_state *state)
+{
+    int i;
+    for (i = 0; i < state->num_jumps; i++) {
+        struct jump jump = state->jumps[i];
+
+        int target_loc;
+        if (jump.target_pc == TARGET_PC_EXIT) {
+            target_loc = state->exit_loc;
+        } else if (jump.target_pc == TARGET_PC_DIV_BY_ZERO) {
+            target_loc = state->div_by_zero_loc;
+        } else {
+            target_loc = state->pc_locs[jump.target_pc];
+        }
+
+        /* Branch offsets count instructions, not bytes. */
+        int32_t rel = (target_loc - (int32_t)jump.offset_loc) / 4;
+
+        uint8_t *insn_ptr = &state->buf[jump.offset_loc];
+        uint32_t insn;
+        memcpy(&insn, insn_ptr, sizeof(insn));
+        if ((insn & UINT32_C(0x7c000000)) == UINT32_C(0x14000000)) {
+            /* B: 26-bit immediate. */
+            insn |= rel & 0x3ffffff;
+        } else {
+            /* B.cond and CBZ: 19-bit immediate at bit 5. */
+            insn |= (rel & 0x7ffff) << 5;
+        }
+        memcpy(insn_ptr, &insn, sizeof(insn));
+    }
+}
+
+ubpf_jit_fn
+ubpf_compile(struct ubpf_vm *vm, char **errmsg)
+{
+    void *jitted = NULL;
+    size_t jitted_size;
+    struct jit_state state;
+
+    state.offset = 0;
+    state.size = 65536;
+    state.buf = xcalloc(state.size, 1);
+    state.pc_locs = xcalloc(MAX_INSTS+1, sizeof(state.pc_locs[0]));
+    state.jumps = xcalloc(MAX_INSTS, sizeof(state.jumps[0]));
+    state.num_jumps = 0;
+
+    *errmsg = NULL;
+
+    if (vm->jitted) {
+        return vm->jitted;
+    }
+
+    if (!vm->insts) {
+        *errmsg = ubpf_error("code has not been loaded into this VM");
+        return NULL;
+    }
+
+    if (translate(vm, &state, errmsg) < 0) {
+        goto error;
+    }
+
+    resolve_jumps(&state);
+
+    jitted_size = state.offset;
+    jitted = mmap(NULL, jitted_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (jitted == MAP_FAILED) {
+        *errmsg = ubpf_error("internal uBPF error: mmap failed: %s\n", strerror(errno));
+        goto error;
+    }
+
+    memcpy(jitted, state.buf, jitted_size);
+
+    /* The data cache is not coherent with the instruction fetch path. */
+    __builtin___clear_cache(jitted, (char *)jitted + jitted_size);
+
+    if (mprotect(jitted, jitted_size, PROT_READ | PROT_EXEC) < 0) {
+        *errmsg = ubpf_error("internal uBPF error: mprotect failed: %s\n", strerror(errno));
+        goto error;
+    }
+
+    free(state.buf);
+    free(state.pc_locs);
+    free(state.jumps);
+    vm->jitted = jitted;
+    vm->jitted_size = jitted_size;
+    return vm->jitted;
+
+error:
+    if (jitted) {
+        munmap(jitted, jitted_size);
+    }
+    free(state.buf);
+    return NULL;
+}
+
+#endif /* __aarch64__ */
@@ -0,0 +1,300 @@
+/*
+ * Copyright 2015 Big Switch Networks, Inc
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Generic AArch64 (A64) code generation functions
+ */
+
+#ifndef UBPF_JIT_ARM64_H
+#define UBPF_JIT_ARM64_H
+
+#include <string.h>
+#include <stdint.h>
+
+/* A64 integer registers.  R31 encodes either SP or XZR depending on the
+ * instruction; the emitters below always use it as XZR unless noted. */
+#define A64_R0  0
+#define A64_R1  1
+#define A64_R2  2
+#define A64_R3  3
+#define A64_R4  4
+#define A64_R5  5
+#define A64_R6  6
+#define A64_R7  7
+#define A64_R8  8
+#define A64_R9  9
+#define A64_R19 19
+#define A64_R20 20
+#define A64_R21 21
+#define A64_R22 22
+#define A64_R25 25
+#define A64_R26 26
+#define A64_FP  29
+#define A64_LR  30
+#define A64_SP  31
+#define A64_XZR 31
+
+enum operand_size {
+    S8,
+    S16,
+    S32,
+    S64,
+};
+
+/* A64 condition codes. */
+enum a64_cond {
+    COND_EQ = 0x0,
+    COND_NE = 0x1,
+    COND_CS = 0x2,  /* Unsigned >= */
+    COND_HI = 0x8,  /* Unsigned > */
+    COND_GE = 0xa,  /* Signed >= */
+    COND_GT = 0xc,  /* Signed > */
+};
+
+struct jump {
+    uint32_t offset_loc;
+    uint32_t target_pc;
+};
+
+struct jit_state {
+    uint8_t *buf;
+    uint32_t offset;
+    uint32_t size;
+    uint32_t *pc_locs;
+    uint32_t exit_loc;
+    uint32_t div_by_zero_loc;
+    struct jump *jumps;
+    int num_jumps;
+};
+
+/* Every A64 instruction is a single 32-bit word. */
+static inline void
+emit_insn(struct jit_state *state, uint32_t insn)
+{
+    ovs_assert(state->offset <= state->size - sizeof(insn));
+    memcpy(state->buf + state->offset, &insn, sizeof(insn));
+    state->offset += sizeof(insn);
+}
+
+static inline uint32_t
+sf_bit(bool is64)
+{
+    return is64 ? UINT32_C(1) << 31 : 0;
+}
+
+/* Add/subtract, logical and multiply register forms.  'op' is the opcode
+ * base with sf clear, e.g. 0x0b000000 for ADD. */
+static inline void
+emit_alu_reg(struct jit_state *state, bool is64, uint32_t op,
+             int rm, int rn, int rd)
+{
+    emit_insn(state, sf_bit(is64) | op | (rm << 16) | (rn << 5) | rd);
+}
+
+#define A64_OP_ADD  UINT32_C(0x0b000000)
+#define A64_OP_SUB  UINT32_C(0x4b000000)
+#define A64_OP_SUBS UINT32_C(0x6b000000)
+#define A64_OP_AND  UINT32_C(0x0a000000)
+#define A64_OP_ANDS UINT32_C(0x6a000000)
+#define A64_OP_ORR  UINT32_C(0x2a000000)
+#define A64_OP_EOR  UINT32_C(0x4a000000)
+
+/* Data-processing (2 source): UDIV, LSLV, LSRV, ASRV. */
+#define A64_OP_UDIV UINT32_C(0x1ac00800)
+#define A64_OP_LSLV UINT32_C(0x1ac02000)
+#define A64_OP_LSRV UINT32_C(0x1ac02400)
+#define A64_OP_ASRV UINT32_C(0x1ac02800)
+
+/* MADD/MSUB: rd = ra +/- rn * rm. */
+static inline void
+emit_muladd(struct jit_state *state, bool is64, bool sub,
+            int rm, int ra, int rn, int rd)
+{
+    uint32_t op = sub ? UINT32_C(0x1b008000) : UINT32_C(0x1b000000);
+    emit_insn(state, sf_bit(is64) | op | (rm << 16) | (ra << 10)
+                     | (rn << 5) | rd);
+}
+
+/* Register to register mov: ORR rd, xzr, rm. */
+static inline void
+emit_mov(struct jit_state *state, int src, int dst)
+{
+    emit_alu_reg(state, true, A64_OP_ORR, src, A64_XZR, dst);
+}
+
+/* MOVZ/MOVK with a 16-bit chunk at position 'shift' (0, 16, 32, 48). */
+static inline void
+emit_movz(struct jit_state *state, bool is64, int rd, uint16_t imm, int shift)
+{
+    emit_insn(state, sf_bit(is64) | UINT32_C(0x52800000)
+                     | ((shift / 16) << 21) | ((uint32_t)imm << 5) | rd);
+}
+
+static inline void
+emit_movk(struct jit_state *state, bool is64, int rd, uint16_t imm, int shift)
+{
+    emit_insn(state, sf_bit(is64) | UINT32_C(0x72800000)
+                     | ((shift / 16) << 21) | ((uint32_t)imm << 5) | rd);
+}
+
+/* Load a 64-bit immediate into a register.  At most four instructions;
+ * zero chunks above the first are skipped. */
+static inline void
+emit_load_imm(struct jit_state *state, int dst, uint64_t imm)
+{
+    int shift;
+
+    emit_movz(state, true, dst, imm & 0xffff, 0);
+    for (shift = 16; shift < 64; shift += 16) {
+        uint16_t chunk = imm >> shift;
+        if (chunk) {
+            emit_movk(state, true, dst, chunk, shift);
+        }
+    }
+}
+
+/* ADD/SUB with a 12-bit unsigned immediate.  Also used to copy to/from SP
+ * with imm == 0 since ORR cannot name SP. */
+static inline void
+emit_addsub_imm(struct jit_state *state, bool is64, bool sub,
+                int rn, int rd, uint32_t imm12)
+{
+    uint32_t op = sub ? UINT32_C(0x51000000) : UINT32_C(0x11000000);
+    ovs_assert(imm12 < (1 << 12));
+    emit_insn(state, sf_bit(is64) | op | (imm12 << 10) | (rn << 5) | rd);
+}
+
+/* STP/LDP of a register pair at [sp, #-16]! / [sp], #16. */
+static inline void
+emit_push_pair(struct jit_state *state, int r1, int r2)
+{
+    emit_insn(state, UINT32_C(0xa9bf0000) | (r2 << 10) | (A64_SP << 5) | r1);
+}
+
+static inline void
+emit_pop_pair(struct jit_state *state, int r1, int r2)
+{
+    emit_insn(state, UINT32_C(0xa8c10000) | (r2 << 10) | (A64_SP << 5) | r1);
+}
+
+static inline void
+emit_jump_insn(struct jit_state *state, uint32_t insn, int32_t target_pc)
+{
+    struct jump *jump = &state->jumps[state->num_jumps++];
+    jump->offset_loc = state->offset;
+    jump->target_pc = target_pc;
+    emit_insn(state, insn);
+}
+
+/* Unconditional branch; offset patched in by resolve_jumps(). */
+static inline void
+emit_jmp(struct jit_state *state, int32_t target_pc)
+{
+    emit_jump_insn(state, UINT32_C(0x14000000), target_pc);
+}
+
+/* Conditional branch; offset patched in by resolve_jumps(). */
+static inline void
+emit_jcc(struct jit_state *state, enum a64_cond cond, int32_t target_pc)
+{
+    emit_jump_insn(state, UINT32_C(0x54000000) | cond, target_pc);
+}
+
+/* CBZ; offset patched in by resolve_jumps(). */
+static inline void
+emit_cbz(struct jit_state *state, bool is64, int rt, int32_t target_pc)
+{
+    emit_jump_insn(state, sf_bit(is64) | UINT32_C(0x34000000) | rt,
+                   target_pc);
+}
+
+static inline void
+emit_cmp(struct jit_state *state, int src, int dst)
+{
+    emit_alu_reg(state, true, A64_OP_SUBS, src, dst, A64_XZR);
+}
+
+static inline void
+emit_tst(struct jit_state *state, int src, int dst)
+{
+    emit_alu_reg(state, true, A64_OP_ANDS, src, dst, A64_XZR);
+}
+
+/* LDUR/STUR opcode bases indexed by operand size; loads zero-extend. */
+static inline uint32_t
+ldst_opcode(enum operand_size size, bool store, bool reg_offset)
+{
+    static const uint32_t base[4] = {
+        UINT32_C(0x38000000),   /* S8 */
+        UINT32_C(0x78000000),   /* S16 */
+        UINT32_C(0xb8000000),   /* S32 */
+        UINT32_C(0xf8000000),   /* S64 */
+    };
+    uint32_t op = base[size];
+    if (!store) {
+        op |= UINT32_C(0x00400000);
+    }
+    if (reg_offset) {
+        op |= UINT32_C(0x00206800);
+    }
+    return op;
+}
+
+/* Load [src + offset] into dst, zero-extending; may clobber 'tmp'. */
+static inline void
+emit_load(struct jit_state *state, enum operand_size size, int src, int dst,
+          int32_t offset, int tmp)
+{
+    if (offset >= -256 && offset <= 255) {
+        emit_insn(state, ldst_opcode(size, false, false)
+                         | ((offset & 0x1ff) << 12) | (src << 5) | dst);
+    } else {
+        emit_load_imm(state, tmp, (int64_t)offset);
+        emit_insn(state, ldst_opcode(size, false, true)
+                         | (tmp << 16) | (src << 5) | dst);
+    }
+}
+
+/* Store register src to [dst + offset]; may clobber 'tmp'. */
+static inline void
+emit_store(struct jit_state *state, enum operand_size size, int src, int dst,
+           int32_t offset, int tmp)
+{
+    if (offset >= -256 && offset <= 255) {
+        emit_insn(state, ldst_opcode(size, true, false)
+                         | ((offset & 0x1ff) << 12) | (dst << 5) | src);
+    } else {
+        emit_load_imm(state, tmp, (int64_t)offset);
+        emit_insn(state, ldst_opcode(size, true, true)
+                         | (tmp << 16) | (dst << 5) | src);
+    }
+}
+
+static inline void
+emit_call(struct jit_state *state, void *target, int tmp)
+{
+    emit_load_imm(state, tmp, (uintptr_t)target);
+    /* blr tmp */
+    emit_insn(state, UINT32_C(0xd63f0000) | (tmp << 5));
+}
+
+static inline void
+emit_ret(struct jit_state *state)
+{
+    emit_insn(state, UINT32_C(0xd65f03c0));
+}
+
+#endif
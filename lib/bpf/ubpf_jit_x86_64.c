@@ -15,6 +15,7 @@
  */
 
 #define _GNU_SOURCE
+#include <config.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -24,12 +25,16 @@
 #include <errno.h>
 #include "util.h"
 #include "ubpf_int.h"
+#include "ubpf_hashmap.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+
 #include "ubpf_jit_x86_64.h"
-#include <config.h>
 
 /* Special values for target_pc in struct jump */
 #define TARGET_PC_EXIT -1
 #define TARGET_PC_DIV_BY_ZERO -2
+#define TARGET_PC_BATCH_DONE -3
 
 static void muldivmod(struct jit_state *state, uint16_t pc, uint8_t opcode, int src, int dst, int32_t imm);
 
@@ -79,20 +84,141 @@ ubpf_set_register_offset(int x)
     }
 }
 
+/* Emits a forward jcc/jmp with a 32-bit offset to be filled in later and
+ * returns the location of the offset.  Used for jumps local to one emitted
+ * sequence, which the BPF-pc-based jump table cannot express. */
+static uint32_t
+emit_local_jcc(struct jit_state *state, int code)
+{
+    emit1(state, 0x0f);
+    emit1(state, code);
+    emit4(state, 0);
+    return state->offset - sizeof(uint32_t);
+}
+
+static uint32_t
+emit_local_jmp(struct jit_state *state)
+{
+    emit1(state, 0xe9);
+    emit4(state, 0);
+    return state->offset - sizeof(uint32_t);
+}
+
+static void
+patch_local_jump(struct jit_state *state, uint32_t offset_loc)
+{
+    uint32_t rel = state->offset - (offset_loc + sizeof(uint32_t));
+    memcpy(&state->buf[offset_loc], &rel, sizeof(rel));
+}
+
+/* Returns the registered map whose address a LDDW instruction loaded, or
+ * NULL if 'imm' is not a map pointer. */
+static struct ubpf_map *
+find_map_by_address(struct ubpf_vm *vm, uint64_t imm)
+{
+    int i;
+    for (i = 0; i < vm->nb_maps; i++) {
+        if ((uint64_t)(uintptr_t)vm->ext_maps[i] == imm) {
+            return vm->ext_maps[i];
+        }
+    }
+    return NULL;
+}
+
+/* Specializes a ubpf_map_lookup() call against a map known at compile
+ * time.  Array lookups are emitted inline; hashmap lookups still call out
+ * but go straight to ubpf_hashmap_lookup(), skipping the NULL guards and
+ * the ops table indirection of the generic helper.  Returns false if the
+ * map type has no specialization, in which case the caller emits the
+ * ordinary external call. */
+static bool
+emit_specialized_map_lookup(struct jit_state *state, struct ubpf_map *map)
+{
+    switch (map->type) {
+    case UBPF_MAP_TYPE_ARRAY: {
+        uint32_t miss_loc, done_loc;
+
+        /* idx = *(uint64_t *)key; key is in eBPF r2. */
+        emit_load(state, S64, map_register(2), RAX, 0);
+        emit_load_imm(state, RCX, map->max_entries);
+        emit_cmp(state, RCX, RAX);
+        miss_loc = emit_local_jcc(state, 0x83); /* jae: idx out of range */
+        /* rax = map->data + idx * value_size */
+        emit_basic_rex(state, 1, RAX, RAX);
+        emit1(state, 0x69); /* imul rax, rax, imm32 */
+        emit_modrm_reg2reg(state, RAX, RAX);
+        emit4(state, map->value_size);
+        emit_load_imm(state, RCX, (uintptr_t)map->data);
+        emit_alu64(state, 0x01, RCX, RAX);
+        done_loc = emit_local_jmp(state);
+        patch_local_jump(state, miss_loc);
+        emit_alu32(state, 0x31, RAX, RAX); /* NULL */
+        patch_local_jump(state, done_loc);
+        return true;
+    }
+
+    case UBPF_MAP_TYPE_HASHMAP:
+        emit_call(state, ubpf_hashmap_lookup);
+        return true;
+
+    case UBPF_MAP_TYPE_BLOOMFILTER:
+    case UBPF_MAP_TYPE_COUNTMIN:
+    case UBPF_MAP_TYPE_LPM_TRIE:
+    case UBPF_MAP_TYPE_LPM_DIR24:
+    case UBPF_MAP_TYPE_PERCPU_ARRAY:
+    case UBPF_MAP_TYPE_PERCPU_HASHMAP:
+    case UBPF_MAP_TYPE_METER:
+    case UBPF_MAP_TYPE_TERNARY:
+    case UBPF_MAP_TYPE_RANGE:
+    case UBPF_MAP_TYPE_ACT_SELECTOR:
+    default:
+        return false;
+    }
+}
+
 static int
-translate(struct ubpf_vm *vm, struct jit_state *state, char **errmsg)
+translate(struct ubpf_vm *vm, struct jit_state *state, bool batch,
+          char **errmsg)
 {
+    uint32_t loop_top = 0;
+    unsigned int map_lookup_idx =
+        ubpf_lookup_registered_function(vm, "ubpf_map_lookup");
+    /* Compile-time shadow of which eBPF registers hold a known map
+     * pointer, maintained per basic block for lookup specialization. */
+    struct ubpf_map *reg_map[16] = { NULL };
+    bool *jump_target = xzalloc(vm->num_insts * sizeof *jump_target);
+
+    for (int j = 0; j < vm->num_insts; j++) {
+        uint8_t op = vm->insts[j].opcode;
+        if ((op & EBPF_CLS_MASK) == EBPF_CLS_JMP
+            && op != EBPF_OP_CALL && op != EBPF_OP_EXIT) {
+            uint32_t target = j + vm->insts[j].offset + 1;
+            if (target < vm->num_insts) {
+                jump_target[target] = true;
+            }
+        }
+    }
+
     emit_push(state, RBP);
     emit_push(state, RBX);
     emit_push(state, R13);
     emit_push(state, R14);
     emit_push(state, R15);
 
-    emit_mov(state, RDX, R10);
-
-    /* Move rdi into register 1 */
-    if (map_register(1) != RDI) {
-        emit_mov(state, RDI, map_register(1));
+    if (batch) {
+        /* Batch mode: rdi is an array of struct ubpf_batch_entry, rsi the
+         * entry count.  R12 walks the array; the end pointer lives in the
+         * stack slot at [r10] (above the eBPF stack, which only grows
+         * down).  The program body runs once per entry with the VM
+         * entry/exit cost paid once for the burst. */
+        emit_push(state, R12);
+        emit_mov(state, RDI, R12);
+        /* end = entries + count * sizeof(struct ubpf_batch_entry) */
+        emit_alu64_imm8(state, 0xc1, 4, RSI, 4);
+        emit_alu64(state, 0x01, RDI, RSI);
+        emit_push(state, RSI);
+    } else {
+        emit_mov(state, RDX, R10);
     }
 
     /* Copy stack pointer to R10 */
@@ -101,6 +227,22 @@ translate(struct ubpf_vm *vm, struct jit_state *state, char **errmsg)
     /* Allocate stack space */
     emit_alu64_imm32(state, 0x81, 5, RSP, STACK_SIZE);
 
+    if (batch) {
+        loop_top = state->offset;
+        /* Done with the burst? */
+        emit_load(state, S64, map_register(10), RCX, 0);
+        emit_cmp(state, RCX, R12);
+        emit_jcc(state, 0x84, TARGET_PC_BATCH_DONE);
+        /* Per-packet arguments. */
+        emit_load(state, S64, R12, RDI, 0);
+        emit_load(state, S64, R12, RSI, 8);
+    }
+
+    /* Move rdi into register 1 */
+    if (map_register(1) != RDI) {
+        emit_mov(state, RDI, map_register(1));
+    }
+
     int i;
     for (i = 0; i < vm->num_insts; i++) {
         struct ebpf_inst inst = vm->insts[i];
@@ -110,6 +252,11 @@ translate(struct ubpf_vm *vm, struct jit_state *state, char **errmsg)
         int src = map_register(inst.src);
         uint32_t target_pc = i + inst.offset + 1;
 
+        if (jump_target[i]) {
+            /* Register contents are unknown across merge points. */
+            memset(reg_map, 0, sizeof reg_map);
+        }
+
         switch (inst.opcode) {
         case EBPF_OP_ADD_IMM:
             emit_alu32_imm32(state, 0x81, 0, dst, inst.imm);
@@ -328,6 +475,10 @@ translate(struct ubpf_vm *vm, struct jit_state *state, char **errmsg)
             emit_jcc(state, 0x8d, target_pc);
             break;
         case EBPF_OP_CALL:
+            if (inst.imm == map_lookup_idx && reg_map[1]
+                && emit_specialized_map_lookup(state, reg_map[1])) {
+                break;
+            }
             /* We reserve RCX for shifts */
             emit_mov(state, R9, RCX);
             emit_call(state, vm->ext_funcs[inst.imm].func);
@@ -418,13 +569,46 @@ translate(struct ubpf_vm *vm, struct jit_state *state, char **errmsg)
 
         default:
             *errmsg = ubpf_error("Unknown instruction at PC %d: opcode %02x", i, inst.opcode);
+            free(jump_target);
             return -1;
         }
+
+        /* Update the map-pointer shadow for this instruction. */
+        if (inst.opcode == EBPF_OP_LDDW) {
+            /* 'i' already stepped over the second half above. */
+            uint64_t imm = (uint32_t)inst.imm
+                           | ((uint64_t)vm->insts[i].imm << 32);
+            reg_map[inst.dst] = find_map_by_address(vm, imm);
+        } else if (inst.opcode == EBPF_OP_CALL) {
+            /* Calls clobber r0-r5. */
+            memset(reg_map, 0, 6 * sizeof reg_map[0]);
+        } else {
+            uint8_t cls = inst.opcode & EBPF_CLS_MASK;
+            if (cls == EBPF_CLS_ALU || cls == EBPF_CLS_ALU64
+                || cls == EBPF_CLS_LDX) {
+                reg_map[inst.dst] = NULL;
+            } else if (cls == EBPF_CLS_LD) {
+                /* LDABS/LDIND write r0. */
+                reg_map[0] = NULL;
+            }
+        }
     }
 
+    free(jump_target);
+
     /* Epilogue */
     state->exit_loc = state->offset;
 
+    if (batch) {
+        /* Per-packet tail: step to the next entry and loop. */
+        emit_alu64_imm32(state, 0x81, 0, R12,
+                         sizeof(struct ubpf_batch_entry));
+        emit1(state, 0xe9); /* jmp loop_top */
+        emit4(state, loop_top - (state->offset + sizeof(uint32_t)));
+
+        state->batch_done_loc = state->offset;
+    }
+
     /* Move register 0 into rax */
     if (map_register(0) != RAX) {
         emit_mov(state, map_register(0), RAX);
@@ -433,6 +617,10 @@ translate(struct ubpf_vm *vm, struct jit_state *state, char **errmsg)
     /* Deallocate stack space */
     emit_alu64_imm32(state, 0x81, 0, RSP, STACK_SIZE);
 
+    if (batch) {
+        emit_pop(state, RCX); /* end pointer slot */
+        emit_pop(state, R12);
+    }
     emit_pop(state, R15);
     emit_pop(state, R14);
     emit_pop(state, R13);
@@ -462,7 +650,7 @@ muldivmod(struct jit_state *state, uint16_t pc, uint8_t opcode, int src, int dst
     bool mod = (opcode & EBPF_ALU_OP_MASK) == (EBPF_OP_MOD_IMM & EBPF_ALU_OP_MASK);
     bool is64 = (opcode & EBPF_CLS_MASK) == EBPF_CLS_ALU64;
 
-    if (div || mod) {
+    if ((div || mod) && (opcode & EBPF_SRC_REG)) {
         emit_load_imm(state, RCX, pc);
 
         /* test src,src */
@@ -474,6 +662,11 @@ muldivmod(struct jit_state *state, uint16_t pc, uint8_t opcode, int src, int dst
 
         /* jz div_by_zero */
         emit_jcc(state, 0x84, TARGET_PC_DIV_BY_ZERO);
+    } else if ((div || mod) && !imm) {
+        /* Constant zero divisor: fail unconditionally at runtime. */
+        emit_load_imm(state, RCX, pc);
+        emit_jmp(state, TARGET_PC_DIV_BY_ZERO);
+        return;
     }
 
     if (dst != RAX) {
@@ -528,6 +721,8 @@ resolve_jumps(struct jit_state *state)
             target_loc = state->exit_loc;
         } else if (jump.target_pc == TARGET_PC_DIV_BY_ZERO) {
             target_loc = state->div_by_zero_loc;
+        } else if (jump.target_pc == TARGET_PC_BATCH_DONE) {
+            target_loc = state->batch_done_loc;
         } else {
             target_loc = state->pc_locs[jump.target_pc];
         }
@@ -540,11 +735,13 @@ resolve_jumps(struct jit_state *state)
     }
 }
 
-ubpf_jit_fn
-ubpf_compile(struct ubpf_vm *vm, char **errmsg)
+/* Translates 'vm' once in the requested mode and returns an executable
+ * mapping of the result, or NULL on error. */
+static void *
+compile_variant(struct ubpf_vm *vm, bool batch, size_t *sizep, char **errmsg)
 {
     void *jitted = NULL;
-    size_t jitted_size;
+    size_t jitted_size = 0;
     struct jit_state state;
 
     state.offset = 0;
@@ -554,18 +751,7 @@ ubpf_compile(struct ubpf_vm *vm, char **errmsg)
     state.jumps = xcalloc(MAX_INSTS, sizeof(state.jumps[0]));
     state.num_jumps = 0;
 
-    *errmsg = NULL;
-
-    if (vm->jitted) {
-        return vm->jitted;
-    }
-
-    if (!vm->insts) {
-        *errmsg = ubpf_error("code has not been loaded into this VM");
-        return NULL;
-    }
-
-    if (translate(vm, &state, errmsg) < 0) {
+    if (translate(vm, &state, batch, errmsg) < 0) {
         goto error;
     }
 
@@ -574,6 +760,7 @@ ubpf_compile(struct ubpf_vm *vm, char **errmsg)
     jitted_size = state.offset;
     jitted = mmap(NULL, jitted_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
     if (jitted == MAP_FAILED) {
+        jitted = NULL;
         *errmsg = ubpf_error("internal uBPF error: mmap failed: %s\n", strerror(errno));
         goto error;
     }
@@ -588,14 +775,50 @@ ubpf_compile(struct ubpf_vm *vm, char **errmsg)
     free(state.buf);
     free(state.pc_locs);
     free(state.jumps);
-    vm->jitted = jitted;
-    vm->jitted_size = jitted_size;
-    return vm->jitted;
+    *sizep = jitted_size;
+    return jitted;
 
 error:
     if (jitted) {
         munmap(jitted, jitted_size);
     }
     free(state.buf);
+    free(state.pc_locs);
+    free(state.jumps);
     return NULL;
 }
+
+ubpf_jit_fn
+ubpf_compile(struct ubpf_vm *vm, char **errmsg)
+{
+    void *jitted;
+    void *jitted_batch;
+
+    *errmsg = NULL;
+
+    if (vm->jitted) {
+        return vm->jitted;
+    }
+
+    if (!vm->insts) {
+        *errmsg = ubpf_error("code has not been loaded into this VM");
+        return NULL;
+    }
+
+    jitted = compile_variant(vm, false, &vm->jitted_size, errmsg);
+    if (!jitted) {
+        return NULL;
+    }
+
+    jitted_batch = compile_variant(vm, true, &vm->jitted_batch_size, errmsg);
+    if (!jitted_batch) {
+        munmap(jitted, vm->jitted_size);
+        return NULL;
+    }
+
+    vm->jitted = jitted;
+    vm->jitted_batch = jitted_batch;
+    return vm->jitted;
+}
+
+#endif /* __x86_64__ || _M_X64 */
@@ -59,6 +59,7 @@ struct jit_state {
     uint32_t size;
     uint32_t *pc_locs;
     uint32_t exit_loc;
+    uint32_t batch_done_loc;
     uint32_t div_by_zero_loc;
     struct jump *jumps;
     int num_jumps;
@@ -123,13 +124,24 @@ emit_modrm_reg2reg(struct jit_state *state, int r, int m)
 static inline void
 emit_modrm_and_displacement(struct jit_state *state, int r, int m, int32_t d)
 {
+    int mod;
+
     if (d == 0 && (m & 7) != RBP) {
-        emit_modrm(state, 0x00, r, m);
+        mod = 0x00;
     } else if (d >= -128 && d <= 127) {
-        emit_modrm(state, 0x40, r, m);
-        emit1(state, d);
+        mod = 0x40;
     } else {
-        emit_modrm(state, 0x80, r, m);
+        mod = 0x80;
+    }
+    emit_modrm(state, mod, r, m);
+    if ((m & 7) == RSP) {
+        /* rm=100 does not name a base register but announces a SIB byte,
+         * so an RSP or R12 base needs the SIB form "no index, base = m". */
+        emit1(state, 0x24);
+    }
+    if (mod == 0x40) {
+        emit1(state, d);
+    } else if (mod == 0x80) {
         emit4(state, d);
     }
 }
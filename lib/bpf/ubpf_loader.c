@@ -28,7 +28,13 @@
 #include "ubpf_bf.h"
 #include "ubpf_countmin.h"
 #include "ubpf_hashmap.h"
+#include "ubpf_lpm_dir24.h"
+#include "ubpf_meter.h"
+#include "ubpf_percpu.h"
 #include "ubpf_lpm_trie.h"
+#include "ubpf_range.h"
+#include "ubpf_ternary.h"
+#include "ubpf_act_prof.h"
 
 #define MAX_SECTIONS 32
 
@@ -61,6 +67,7 @@ static const struct ubpf_map_ops ubpf_bf_ops = {
         .map_update = NULL,
         .map_delete = NULL,
         .map_add = ubpf_bf_add,
+        .map_destroy = ubpf_bf_destroy,
 };
 
 static const struct ubpf_map_ops ubpf_countmin_ops = {
@@ -68,6 +75,7 @@ static const struct ubpf_map_ops ubpf_countmin_ops = {
         .map_update = NULL,
         .map_delete = NULL,
         .map_add = ubpf_countmin_add,
+        .map_destroy = ubpf_countmin_destroy,
 };
 
 
@@ -285,6 +293,10 @@ ubpf_load_elf(struct ubpf_vm *vm, const void *elf, size_t elf_size, char **errms
                         map->key_size = map_def->key_size;
                         map->value_size = map_def->value_size;
                         map->max_entries = map_def->max_entries;
+                        map->staged = NULL;
+                        map->idle_timeout = 0;
+                        map->numa_replicas = NULL;
+                        map->stats = NULL;
 
                         switch(map_def->type) {
                         case UBPF_MAP_TYPE_ARRAY:
@@ -307,6 +319,34 @@ ubpf_load_elf(struct ubpf_vm *vm, const void *elf, size_t elf_size, char **errms
                             map->ops = ubpf_lpm_trie_ops;
                             map->data = ubpf_lpm_trie_create(map_def);
                             break;
+                        case UBPF_MAP_TYPE_LPM_DIR24:
+                            map->ops = ubpf_lpm_dir24_ops;
+                            map->data = ubpf_lpm_dir24_create(map_def);
+                            break;
+                        case UBPF_MAP_TYPE_PERCPU_ARRAY:
+                            map->ops = ubpf_percpu_array_ops;
+                            map->data = ubpf_percpu_array_create(map_def);
+                            break;
+                        case UBPF_MAP_TYPE_PERCPU_HASHMAP:
+                            map->ops = ubpf_percpu_hashmap_ops;
+                            map->data = ubpf_percpu_hashmap_create(map_def);
+                            break;
+                        case UBPF_MAP_TYPE_METER:
+                            map->ops = ubpf_meter_ops;
+                            map->data = ubpf_meter_create(map_def);
+                            break;
+                        case UBPF_MAP_TYPE_TERNARY:
+                            map->ops = ubpf_ternary_ops;
+                            map->data = ubpf_ternary_create(map_def);
+                            break;
+                        case UBPF_MAP_TYPE_RANGE:
+                            map->ops = ubpf_range_ops;
+                            map->data = ubpf_range_create(map_def);
+                            break;
+                        case UBPF_MAP_TYPE_ACT_SELECTOR:
+                            map->ops = ubpf_act_prof_ops;
+                            map->data = ubpf_act_prof_create(map_def);
+                            break;
                         default:
                             *errmsg = ubpf_error("unrecognized map type: %d", map_def->type);
                             goto error_map;
@@ -317,6 +357,9 @@ ubpf_load_elf(struct ubpf_vm *vm, const void *elf, size_t elf_size, char **errms
                             goto error_map;
                         }
 
+                        map->stats = xzalloc_cacheline(UBPF_MAP_STATS_SHARDS
+                                                       * sizeof *map->stats);
+
                         int result = ubpf_register_map(vm, sym_name, map);
                         if (result == -1) {
                             *errmsg = ubpf_error("failed to register variable '%s'", sym_name);
@@ -377,6 +420,9 @@ ubpf_load_elf(struct ubpf_vm *vm, const void *elf, size_t elf_size, char **errms
     return rv;
 
 error_map:
+    if (map) {
+        free_cacheline(map->stats);
+    }
     free(map);
 error:
     free(text_copy);
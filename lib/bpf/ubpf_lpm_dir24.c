@@ -0,0 +1,353 @@
+/*
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* DIR-24-8 longest-prefix match.
+ *
+ * The trie in ubpf_lpm_trie.c takes a dependent load per matched bit,
+ * which dominates lookup cost on large IPv4 route tables.  This map
+ * trades memory for lookup latency: a flat 2^24-entry table indexed by
+ * the top 24 bits of the address resolves all prefixes of length <= 24
+ * in one load, and prefixes longer than /24 spill into per-/24 groups
+ * of 256 entries ("tbl8"), for a worst case of two dependent loads.
+ *
+ * The key layout is the same as the trie's (struct lpm_trie_key with
+ * four bytes of data in network byte order), so a P4 program can switch
+ * between the two implementations by changing only the map type. */
+
+#include <config.h>
+#include <errno.h>
+
+#include "ubpf_lpm_dir24.h"
+#include "ubpf_lpm_trie.h"
+#include "openvswitch/vlog.h"
+
+VLOG_DEFINE_THIS_MODULE(ubpf_lpm_dir24);
+
+#define DIR24_TBL24_SIZE (1u << 24)
+
+void *
+ubpf_lpm_dir24_create(const struct ubpf_map_def *map_def)
+{
+    struct lpm_dir24 *dir24;
+
+    if (map_def->key_size != offsetof(struct lpm_trie_key, data) + 4) {
+        VLOG_ERR("DIR-24-8 maps support IPv4 keys only");
+        return NULL;
+    }
+    if (map_def->max_entries > DIR24_INDEX(UINT32_MAX)) {
+        VLOG_ERR("DIR-24-8 maps support at most %"PRIu32" entries",
+                 DIR24_INDEX(UINT32_MAX));
+        return NULL;
+    }
+
+    dir24 = xzalloc(sizeof *dir24);
+    dir24->tbl24 = xzalloc(DIR24_TBL24_SIZE * sizeof *dir24->tbl24);
+    dir24->values = xzalloc((size_t) map_def->max_entries
+                            * map_def->value_size);
+    dir24->rules = xzalloc(map_def->max_entries * sizeof *dir24->rules);
+
+    return dir24;
+}
+
+void
+ubpf_lpm_dir24_destroy(struct ubpf_map *map)
+{
+    struct lpm_dir24 *dir24 = map->data;
+
+    for (size_t i = 0; i < dir24->n_tbl8; i++) {
+        free(dir24->tbl8[i]);
+    }
+    free(dir24->tbl8);
+    free(dir24->rules);
+    free(dir24->values);
+    free(dir24->tbl24);
+    free(dir24);
+}
+
+static inline uint32_t
+dir24_key_addr(const struct lpm_trie_key *key)
+{
+    return ((uint32_t) key->data[0] << 24 | (uint32_t) key->data[1] << 16
+            | (uint32_t) key->data[2] << 8 | key->data[3]);
+}
+
+static inline uint32_t
+dir24_prefix_mask(unsigned int prefix_len)
+{
+    return prefix_len ? UINT32_MAX << (32 - prefix_len) : 0;
+}
+
+static int
+dir24_find_rule(const struct lpm_dir24 *dir24, uint32_t max_entries,
+                uint32_t prefix, uint8_t prefix_len)
+{
+    for (uint32_t i = 0; i < max_entries; i++) {
+        const struct dir24_rule *rule = &dir24->rules[i];
+        if (rule->in_use && rule->prefix_len == prefix_len
+            && rule->prefix == prefix) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Returns the index of a fresh tbl8 group, growing the group table as
+ * needed.  Every slot of the new group is initialized to 'entry'. */
+static uint32_t
+dir24_tbl8_alloc(struct lpm_dir24 *dir24, uint32_t entry)
+{
+    uint32_t *group;
+    size_t gi;
+
+    for (gi = 0; gi < dir24->n_tbl8; gi++) {
+        if (!dir24->tbl8[gi]) {
+            break;
+        }
+    }
+    if (gi == dir24->n_tbl8) {
+        dir24->tbl8 = xrealloc(dir24->tbl8,
+                               (dir24->n_tbl8 + 1) * sizeof *dir24->tbl8);
+        dir24->n_tbl8++;
+    }
+
+    group = xmalloc(DIR24_TBL8_SIZE * sizeof *group);
+    for (int i = 0; i < DIR24_TBL8_SIZE; i++) {
+        group[i] = entry;
+    }
+    dir24->tbl8[gi] = group;
+
+    return gi;
+}
+
+/* Collapses the tbl8 group behind tbl24 slot 'idx' back into tbl24 if
+ * all of its entries have become identical. */
+static void
+dir24_tbl8_maybe_collapse(struct lpm_dir24 *dir24, uint32_t idx)
+{
+    uint32_t e = dir24->tbl24[idx];
+    uint32_t *group;
+
+    if (!(e & DIR24_EXT)) {
+        return;
+    }
+
+    group = dir24->tbl8[DIR24_INDEX(e)];
+    for (int i = 1; i < DIR24_TBL8_SIZE; i++) {
+        if (group[i] != group[0]) {
+            return;
+        }
+    }
+
+    dir24->tbl24[idx] = group[0];
+    free(group);
+    dir24->tbl8[DIR24_INDEX(e)] = NULL;
+}
+
+/* Overwrites every slot covered by 'prefix'/'prefix_len' whose current
+ * occupant is no more specific than 'prefix_len' (or, when 'match_slot'
+ * is nonnegative, exactly the slots installed for rule 'match_slot' at
+ * that depth) with 'entry'.  This single walk serves both insertion
+ * ('match_slot' < 0) and deletion. */
+static void
+dir24_set_range(struct lpm_dir24 *dir24, uint32_t prefix, uint8_t prefix_len,
+                uint32_t entry, int match_slot)
+{
+    if (prefix_len <= 24) {
+        uint32_t first = prefix >> 8;
+        uint32_t n = 1u << (24 - prefix_len);
+
+        for (uint32_t i = first; i < first + n; i++) {
+            uint32_t e = dir24->tbl24[i];
+
+            if (e & DIR24_EXT) {
+                uint32_t *group = dir24->tbl8[DIR24_INDEX(e)];
+
+                for (int j = 0; j < DIR24_TBL8_SIZE; j++) {
+                    uint32_t g = group[j];
+                    if (match_slot < 0
+                        ? (!(g & DIR24_VALID) || DIR24_DEPTH(g) <= prefix_len)
+                        : (g & DIR24_VALID) && DIR24_DEPTH(g) == prefix_len
+                          && DIR24_INDEX(g) == (uint32_t) match_slot) {
+                        group[j] = entry;
+                    }
+                }
+                dir24_tbl8_maybe_collapse(dir24, i);
+            } else if (match_slot < 0
+                       ? (!(e & DIR24_VALID) || DIR24_DEPTH(e) <= prefix_len)
+                       : (e & DIR24_VALID) && DIR24_DEPTH(e) == prefix_len
+                         && DIR24_INDEX(e) == (uint32_t) match_slot) {
+                dir24->tbl24[i] = entry;
+            }
+        }
+    } else {
+        uint32_t idx = prefix >> 8;
+        uint32_t e = dir24->tbl24[idx];
+        uint32_t first = prefix & 0xff;
+        uint32_t n = 1u << (32 - prefix_len);
+        uint32_t *group;
+
+        if (!(e & DIR24_EXT)) {
+            /* Spill this /24 into a group seeded with its current entry. */
+            uint32_t gi = dir24_tbl8_alloc(dir24, e);
+            dir24->tbl24[idx] = DIR24_VALID | DIR24_EXT | gi;
+        }
+        group = dir24->tbl8[DIR24_INDEX(dir24->tbl24[idx])];
+
+        for (uint32_t j = first; j < first + n; j++) {
+            uint32_t g = group[j];
+            if (match_slot < 0
+                ? (!(g & DIR24_VALID) || DIR24_DEPTH(g) <= prefix_len)
+                : (g & DIR24_VALID) && DIR24_DEPTH(g) == prefix_len
+                  && DIR24_INDEX(g) == (uint32_t) match_slot) {
+                group[j] = entry;
+            }
+        }
+        dir24_tbl8_maybe_collapse(dir24, idx);
+    }
+}
+
+int
+ubpf_lpm_dir24_update(struct ubpf_map *map, const void *_key, void *value)
+{
+    struct lpm_dir24 *dir24 = map->data;
+    const struct lpm_trie_key *key = _key;
+    uint32_t prefix;
+    int slot;
+
+    if (key->prefix_len > 32) {
+        return -EINVAL;
+    }
+    prefix = dir24_key_addr(key) & dir24_prefix_mask(key->prefix_len);
+
+    slot = dir24_find_rule(dir24, map->max_entries, prefix, key->prefix_len);
+    if (slot >= 0) {
+        /* Existing rule: the tables already point at this slot. */
+        memcpy(dir24->values + (size_t) slot * map->value_size, value,
+               map->value_size);
+        return 0;
+    }
+
+    if (dir24->n_rules == map->max_entries) {
+        return ENOSPC;
+    }
+    for (slot = 0; dir24->rules[slot].in_use; slot++) {
+        continue;
+    }
+
+    memcpy(dir24->values + (size_t) slot * map->value_size, value,
+           map->value_size);
+    dir24->rules[slot].prefix = prefix;
+    dir24->rules[slot].prefix_len = key->prefix_len;
+    dir24->rules[slot].in_use = true;
+    dir24->n_rules++;
+
+    dir24_set_range(dir24, prefix, key->prefix_len,
+                    DIR24_ENTRY(slot, key->prefix_len), -1);
+
+    return 0;
+}
+
+int
+ubpf_lpm_dir24_delete(struct ubpf_map *map, const void *_key)
+{
+    struct lpm_dir24 *dir24 = map->data;
+    const struct lpm_trie_key *key = _key;
+    uint32_t prefix, cov_entry = 0;
+    int slot, best_len = -1;
+
+    if (key->prefix_len > 32) {
+        return -EINVAL;
+    }
+    prefix = dir24_key_addr(key) & dir24_prefix_mask(key->prefix_len);
+
+    slot = dir24_find_rule(dir24, map->max_entries, prefix, key->prefix_len);
+    if (slot < 0) {
+        return ENOENT;
+    }
+
+    dir24->rules[slot].in_use = false;
+    dir24->n_rules--;
+
+    /* The vacated slots fall back to the longest remaining prefix that
+     * covers the deleted one, or become empty if there is none. */
+    for (uint32_t i = 0; i < map->max_entries; i++) {
+        const struct dir24_rule *rule = &dir24->rules[i];
+        if (rule->in_use && rule->prefix_len < key->prefix_len
+            && rule->prefix_len > best_len
+            && (prefix & dir24_prefix_mask(rule->prefix_len)) == rule->prefix) {
+            best_len = rule->prefix_len;
+            cov_entry = DIR24_ENTRY(i, rule->prefix_len);
+        }
+    }
+
+    dir24_set_range(dir24, prefix, key->prefix_len, cov_entry, slot);
+
+    return 0;
+}
+
+void *
+ubpf_lpm_dir24_lookup(const struct ubpf_map *map, const void *_key)
+{
+    struct lpm_dir24 *dir24 = map->data;
+    const struct lpm_trie_key *key = _key;
+    uint32_t addr = dir24_key_addr(key);
+    uint32_t e = dir24->tbl24[addr >> 8];
+
+    if (OVS_UNLIKELY(e & DIR24_EXT)) {
+        e = dir24->tbl8[DIR24_INDEX(e)][addr & 0xff];
+    }
+    if (!(e & DIR24_VALID)) {
+        return NULL;
+    }
+
+    return dir24->values + (size_t) DIR24_INDEX(e) * map->value_size;
+}
+
+unsigned int
+ubpf_lpm_dir24_size(const struct ubpf_map *map)
+{
+    struct lpm_dir24 *dir24 = map->data;
+    return dir24->n_rules;
+}
+
+unsigned int
+ubpf_lpm_dir24_dump(const struct ubpf_map *map, char *data)
+{
+    struct lpm_dir24 *dir24 = map->data;
+    unsigned int nr_entries = 0;
+
+    for (uint32_t i = 0; i < map->max_entries; i++) {
+        const struct dir24_rule *rule = &dir24->rules[i];
+        if (!rule->in_use) {
+            continue;
+        }
+
+        ovs_be32 plen = htonl(rule->prefix_len);
+        memcpy(data, &plen, sizeof plen);
+        data += sizeof plen;
+
+        ovs_be32 prefix = htonl(rule->prefix);
+        memcpy(data, &prefix, map->key_size - sizeof plen);
+        data += map->key_size - sizeof plen;
+
+        memcpy(data, dir24->values + (size_t) i * map->value_size,
+               map->value_size);
+        data += map->value_size;
+
+        nr_entries++;
+    }
+
+    return nr_entries;
+}
@@ -0,0 +1,68 @@
+/*
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UBPF_LPM_DIR24_H
+#define UBPF_LPM_DIR24_H 1
+
+#include "ubpf_int.h"
+#include "util.h"
+
+void *ubpf_lpm_dir24_create(const struct ubpf_map_def *map_def);
+int ubpf_lpm_dir24_update(struct ubpf_map *map, const void *key, void *value);
+void *ubpf_lpm_dir24_lookup(const struct ubpf_map *map, const void *key);
+unsigned int ubpf_lpm_dir24_size(const struct ubpf_map *map);
+void ubpf_lpm_dir24_destroy(struct ubpf_map *map);
+int ubpf_lpm_dir24_delete(struct ubpf_map *map, const void *key);
+unsigned int ubpf_lpm_dir24_dump(const struct ubpf_map *map, char *data);
+
+static const struct ubpf_map_ops ubpf_lpm_dir24_ops = {
+    .map_size = ubpf_lpm_dir24_size,
+    .map_dump = ubpf_lpm_dir24_dump,
+    .map_lookup = ubpf_lpm_dir24_lookup,
+    .map_update = ubpf_lpm_dir24_update,
+    .map_delete = ubpf_lpm_dir24_delete,
+    .map_add = NULL,
+    .map_destroy = ubpf_lpm_dir24_destroy,
+};
+
+/* DIR-24-8 table entry.  The same encoding is used for tbl24 and tbl8
+ * slots; 'ext' is only ever set in tbl24. */
+#define DIR24_VALID   (1u << 31)  /* Slot holds a match (or tbl8 index). */
+#define DIR24_EXT     (1u << 30)  /* Index points at a tbl8 group. */
+#define DIR24_DEPTH(e) (((e) >> 24) & 0x3f)
+#define DIR24_INDEX(e) ((e) & 0xffffff)
+#define DIR24_ENTRY(index, depth) \
+    (DIR24_VALID | ((uint32_t)(depth) << 24) | (index))
+
+#define DIR24_TBL8_SIZE 256
+
+/* A rule as installed by the control plane.  Kept around so that deletes
+ * can recompute the covering entry for the range they vacate. */
+struct dir24_rule {
+    uint32_t prefix;            /* Host byte order, masked to prefix_len. */
+    uint8_t prefix_len;
+    bool in_use;
+};
+
+struct lpm_dir24 {
+    uint32_t *tbl24;            /* 1 << 24 entries. */
+    uint32_t **tbl8;            /* Lazily allocated groups of 256 entries. */
+    size_t n_tbl8;
+    char *values;               /* max_entries slots of value_size bytes. */
+    struct dir24_rule *rules;   /* max_entries slots, parallel to values. */
+    size_t n_rules;
+};
+
+#endif
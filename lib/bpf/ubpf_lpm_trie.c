@@ -315,6 +315,7 @@ ubpf_lpm_trie_destroy(struct ubpf_map *map)
 
             if (node->child[1]) {
                 slot = &node->child[1];
+                continue;
             }
 
             free(node);
@@ -0,0 +1,141 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Hugepage-backed allocation for map payloads.
+ *
+ * Gigabytes of P4 table state on ordinary 4K pages show up in profiles as
+ * dTLB miss cycles, so large map payloads are placed on hugepages: through
+ * the DPDK hugepage heap when DPDK is initialized, else an explicit
+ * MAP_HUGETLB mapping, else a plain anonymous mapping marked MADV_HUGEPAGE
+ * so the kernel can assemble transparent hugepages behind it.  Small
+ * payloads are not worth a hugepage of their own and stay on the heap.
+ *
+ * The anonymous mappings are deliberately not pre-faulted: their pages land
+ * on the NUMA node of the thread that touches them first, which for table
+ * data is normally the PMD polling the program. */
+
+#include <config.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "ubpf_mem.h"
+
+#ifdef DPDK_NETDEV
+#include <rte_malloc.h>
+
+#include "dpdk.h"
+#endif
+
+#include "util.h"
+
+/* Assumed hugepage size for the MAP_HUGETLB path; mmap() fails cleanly when
+ * no hugepages of this size are reserved.  Also the size below which a
+ * payload stays on the heap. */
+#define UBPF_MEM_HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+enum ubpf_mem_src {
+    UBPF_MEM_HEAP,              /* xzalloc(). */
+    UBPF_MEM_DPDK,              /* rte_zmalloc(): DPDK hugepage heap. */
+    UBPF_MEM_MMAP,              /* mmap(): hugetlb or THP-eligible. */
+};
+
+/* Every block is preceded by one cache line recording how to free it. */
+struct ubpf_mem_hdr {
+    enum ubpf_mem_src src;
+    size_t map_len;             /* Mapping length, for UBPF_MEM_MMAP. */
+    size_t acct_len;            /* Bytes accounted to MEM_TAG_UBPF. */
+};
+BUILD_ASSERT_DECL(sizeof(struct ubpf_mem_hdr) <= CACHE_LINE_SIZE);
+
+/* Returns 'size' zeroed bytes for a map payload.  Never returns NULL: every
+ * hugepage path degrades to the next one and ultimately to xzalloc(). */
+void *
+ubpf_mem_alloc(size_t size)
+{
+    struct ubpf_mem_hdr *hdr = NULL;
+    enum ubpf_mem_src src = UBPF_MEM_HEAP;
+    size_t total = size + CACHE_LINE_SIZE;
+    size_t map_len = 0;
+
+    if (size >= UBPF_MEM_HUGEPAGE_SIZE) {
+#ifdef DPDK_NETDEV
+        if (dpdk_available()) {
+            hdr = rte_zmalloc("ubpf_map", total, CACHE_LINE_SIZE);
+            if (hdr) {
+                src = UBPF_MEM_DPDK;
+            }
+        }
+#endif
+        if (!hdr) {
+            void *base;
+
+            map_len = ROUND_UP(total, UBPF_MEM_HUGEPAGE_SIZE);
+            base = mmap(NULL, map_len, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (base == MAP_FAILED) {
+                base = mmap(NULL, map_len, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#ifdef MADV_HUGEPAGE
+                if (base != MAP_FAILED) {
+                    madvise(base, map_len, MADV_HUGEPAGE);
+                }
+#endif
+            }
+            if (base != MAP_FAILED) {
+                hdr = base;
+                src = UBPF_MEM_MMAP;
+            }
+        }
+    }
+    if (!hdr) {
+        hdr = xzalloc(total);
+        src = UBPF_MEM_HEAP;
+    }
+
+    hdr->src = src;
+    hdr->map_len = map_len;
+    hdr->acct_len = src == UBPF_MEM_MMAP ? map_len : total;
+    mem_tag_adjust(MEM_TAG_UBPF, hdr->acct_len, 1);
+    return (char *) hdr + CACHE_LINE_SIZE;
+}
+
+/* Frees a block obtained from ubpf_mem_alloc().  'data' may be NULL. */
+void
+ubpf_mem_free(void *data)
+{
+    struct ubpf_mem_hdr *hdr;
+
+    if (!data) {
+        return;
+    }
+    hdr = (struct ubpf_mem_hdr *) ((char *) data - CACHE_LINE_SIZE);
+    mem_tag_adjust(MEM_TAG_UBPF, -(long long int) hdr->acct_len, -1);
+    switch (hdr->src) {
+    case UBPF_MEM_HEAP:
+        free(hdr);
+        break;
+    case UBPF_MEM_DPDK:
+#ifdef DPDK_NETDEV
+        rte_free(hdr);
+#else
+        OVS_NOT_REACHED();
+#endif
+        break;
+    case UBPF_MEM_MMAP:
+        munmap(hdr, hdr->map_len);
+        break;
+    }
+}
@@ -0,0 +1,242 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Two-rate three-color meters as a uBPF map type.
+ *
+ * A meter has a committed and a peak token bucket (RFC 2698 coloring:
+ * out of peak tokens is red, out of committed tokens is yellow, green
+ * otherwise).  Both buckets are split into a shared pool and small
+ * per-thread token caches indexed like the per-thread maps, by
+ * ovsthread_id_self() modulo the replica count.  A PMD spends its local
+ * cache byte by byte and only touches the shared pool when the cache
+ * runs dry, pulling a whole quantum at once, so in the steady state
+ * metering is a couple of local arithmetic operations per packet.  The
+ * pool itself is refilled lazily from the elapsed wall time whenever a
+ * pull finds it short - that is the reconciliation point at which
+ * tokens left unused by idle threads become available to busy ones. */
+
+#include <string.h>
+
+#include <config.h>
+#include "ovs-atomic.h"
+#include "ovs-thread.h"
+#include "timeval.h"
+#include "ubpf_meter.h"
+#include "ubpf_percpu.h"
+#include "util.h"
+
+/* How many bytes a thread pulls from the shared pool at a time.  Large
+ * enough that pool atomics are rare, small enough that a burst spread
+ * over many threads cannot overshoot the burst size by much. */
+#define METER_QUANTUM 2048
+
+struct meter_cache {
+    OVS_ALIGNED_VAR(CACHE_LINE_SIZE) atomic_int64_t c_tokens;
+    atomic_int64_t p_tokens;
+};
+
+struct ubpf_meter {
+    struct ubpf_meter_config cfg;
+    atomic_llong last_fill;     /* Wall clock of the last pool refill, us. */
+    atomic_int64_t c_pool;
+    atomic_int64_t p_pool;
+    struct meter_cache caches[UBPF_PERCPU_REPLICAS];
+};
+
+struct meter_map {
+    struct ubpf_meter *meters;
+};
+
+void *
+ubpf_meter_create(const struct ubpf_map_def *map_def)
+{
+    struct meter_map *map;
+
+    if (map_def->key_size != sizeof(uint32_t)
+        || map_def->value_size != sizeof(struct ubpf_meter_config)) {
+        return NULL;
+    }
+
+    map = xzalloc(sizeof *map);
+    map->meters = xzalloc_cacheline((size_t) map_def->max_entries
+                                    * sizeof *map->meters);
+    return map;
+}
+
+void *
+ubpf_meter_lookup(const struct ubpf_map *map, const void *key)
+{
+    struct meter_map *mmap = map->data;
+    uint32_t idx = *(const uint32_t *) key;
+
+    if (OVS_UNLIKELY(idx >= map->max_entries)) {
+        return NULL;
+    }
+    return &mmap->meters[idx].cfg;
+}
+
+/* Sets a meter's rates and resets its buckets to a full burst. */
+int
+ubpf_meter_update(struct ubpf_map *map, const void *key, void *value)
+{
+    struct meter_map *mmap = map->data;
+    uint32_t idx = *(const uint32_t *) key;
+    struct ubpf_meter *meter;
+
+    if (OVS_UNLIKELY(idx >= map->max_entries)) {
+        return -5;
+    }
+
+    meter = &mmap->meters[idx];
+    memcpy(&meter->cfg, value, sizeof meter->cfg);
+    atomic_store_relaxed(&meter->last_fill, time_usec());
+    atomic_store_relaxed(&meter->c_pool, (int64_t) meter->cfg.cbs);
+    atomic_store_relaxed(&meter->p_pool, (int64_t) meter->cfg.pbs);
+    for (int i = 0; i < UBPF_PERCPU_REPLICAS; i++) {
+        int64_t zero = 0;
+        atomic_store_relaxed(&meter->caches[i].c_tokens, zero);
+        atomic_store_relaxed(&meter->caches[i].p_tokens, zero);
+    }
+    return 0;
+}
+
+unsigned int
+ubpf_meter_size(const struct ubpf_map *map)
+{
+    return map->max_entries;
+}
+
+unsigned int
+ubpf_meter_dump(const struct ubpf_map *map, char *data)
+{
+    struct meter_map *mmap = map->data;
+
+    for (uint32_t idx = 0; idx < map->max_entries; idx++) {
+        memcpy(data, &mmap->meters[idx].cfg, sizeof(struct ubpf_meter_config));
+        data += sizeof(struct ubpf_meter_config);
+    }
+    return map->max_entries;
+}
+
+void
+ubpf_meter_destroy(struct ubpf_map *map)
+{
+    struct meter_map *mmap = map->data;
+
+    free_cacheline(mmap->meters);
+    free(mmap);
+}
+
+/* Credits the pools with tokens for the time since the last refill.
+ * Racing threads compete on the timestamp; the loser just sees a pool
+ * that someone else already refilled. */
+static void
+meter_refill_pools(struct ubpf_meter *meter)
+{
+    long long int now = time_usec();
+    long long int last;
+
+    atomic_read_relaxed(&meter->last_fill, &last);
+    if (now <= last
+        || !atomic_compare_exchange_strong_explicit(&meter->last_fill, &last,
+                                                    now,
+                                                    memory_order_relaxed,
+                                                    memory_order_relaxed)) {
+        return;
+    }
+
+    long long int elapsed = now - last;
+    int64_t c_add = (int64_t) meter->cfg.cir * elapsed / 1000000;
+    int64_t p_add = (int64_t) meter->cfg.pir * elapsed / 1000000;
+    int64_t tokens;
+
+    atomic_add_relaxed(&meter->c_pool, c_add, &tokens);
+    if (tokens + c_add > (int64_t) meter->cfg.cbs) {
+        atomic_store_relaxed(&meter->c_pool, (int64_t) meter->cfg.cbs);
+    }
+    atomic_add_relaxed(&meter->p_pool, p_add, &tokens);
+    if (tokens + p_add > (int64_t) meter->cfg.pbs) {
+        atomic_store_relaxed(&meter->p_pool, (int64_t) meter->cfg.pbs);
+    }
+}
+
+/* Moves up to METER_QUANTUM tokens from 'pool' into 'cache'.  Returns
+ * the number of tokens actually moved. */
+static int64_t
+meter_pull_quantum(struct ubpf_meter *meter, atomic_int64_t *pool,
+                   atomic_int64_t *cache)
+{
+    int64_t before, grabbed, ignore;
+
+    meter_refill_pools(meter);
+
+    atomic_add_relaxed(pool, -(int64_t) METER_QUANTUM, &before);
+    if (before <= 0) {
+        atomic_add_relaxed(pool, (int64_t) METER_QUANTUM, &ignore);
+        return 0;
+    }
+    grabbed = MIN(before, METER_QUANTUM);
+    if (grabbed < METER_QUANTUM) {
+        atomic_add_relaxed(pool, METER_QUANTUM - grabbed, &ignore);
+    }
+    atomic_add_relaxed(cache, grabbed, &ignore);
+    return grabbed;
+}
+
+/* Tries to spend 'len' tokens from 'cache', pulling from 'pool' when
+ * the cache is short.  Returns false if the tokens are not there. */
+static bool
+meter_spend(struct ubpf_meter *meter, atomic_int64_t *pool,
+            atomic_int64_t *cache, uint32_t len)
+{
+    int64_t have, ignore;
+
+    atomic_read_relaxed(cache, &have);
+    while (have < len) {
+        if (!meter_pull_quantum(meter, pool, cache)) {
+            return false;
+        }
+        atomic_read_relaxed(cache, &have);
+    }
+    atomic_add_relaxed(cache, -(int64_t) len, &ignore);
+    return true;
+}
+
+/* Colors one packet of 'len' bytes against meter 'index'.  Returns a
+ * ubpf_meter_color; an unconfigured or out-of-range meter passes
+ * everything green. */
+uint32_t
+ubpf_meter_exec(const struct ubpf_map *map, uint32_t index, uint32_t len)
+{
+    struct meter_map *mmap = map->data;
+    struct ubpf_meter *meter;
+    struct meter_cache *cache;
+
+    if (OVS_UNLIKELY(index >= map->max_entries)) {
+        return UBPF_METER_GREEN;
+    }
+    meter = &mmap->meters[index];
+    if (OVS_UNLIKELY(!meter->cfg.pir)) {
+        return UBPF_METER_GREEN;
+    }
+    cache = &meter->caches[ovsthread_id_self() % UBPF_PERCPU_REPLICAS];
+
+    if (!meter_spend(meter, &meter->p_pool, &cache->p_tokens, len)) {
+        return UBPF_METER_RED;
+    }
+    if (!meter_spend(meter, &meter->c_pool, &cache->c_tokens, len)) {
+        return UBPF_METER_YELLOW;
+    }
+    return UBPF_METER_GREEN;
+}
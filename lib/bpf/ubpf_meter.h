@@ -0,0 +1,55 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UBPF_METER_H
+#define UBPF_METER_H 1
+
+#include "ubpf_int.h"
+
+/* Two-rate three-color meter colors, PSA numbering. */
+enum ubpf_meter_color {
+    UBPF_METER_GREEN = 0,
+    UBPF_METER_YELLOW = 1,
+    UBPF_METER_RED = 2,
+};
+
+/* Control-plane view of one meter: the map's value layout. */
+struct ubpf_meter_config {
+    uint32_t cir;               /* Committed rate, bytes/s. */
+    uint32_t cbs;               /* Committed burst, bytes. */
+    uint32_t pir;               /* Peak rate, bytes/s. */
+    uint32_t pbs;               /* Peak burst, bytes. */
+};
+
+void *ubpf_meter_create(const struct ubpf_map_def *map_def);
+void *ubpf_meter_lookup(const struct ubpf_map *map, const void *key);
+int ubpf_meter_update(struct ubpf_map *map, const void *key, void *value);
+unsigned int ubpf_meter_size(const struct ubpf_map *map);
+unsigned int ubpf_meter_dump(const struct ubpf_map *map, char *data);
+void ubpf_meter_destroy(struct ubpf_map *map);
+
+uint32_t ubpf_meter_exec(const struct ubpf_map *map, uint32_t index,
+                         uint32_t len);
+
+static const struct ubpf_map_ops ubpf_meter_ops = {
+    .map_size = ubpf_meter_size,
+    .map_dump = ubpf_meter_dump,
+    .map_lookup = ubpf_meter_lookup,
+    .map_update = ubpf_meter_update,
+    .map_delete = NULL,
+    .map_add = NULL,
+    .map_destroy = ubpf_meter_destroy,
+};
+
+#endif
@@ -0,0 +1,308 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Lightweight optimization pass over loaded eBPF bytecode, run between
+ * ubpf_load_elf() and JIT translation.
+ *
+ * p4c-generated parsers re-check packet bounds before every header
+ * field they touch, so a single basic block commonly carries dozens of
+ *
+ *     mov64  rX, rPKT
+ *     add64  rX, <offset>
+ *     jgt    rX, rEND, reject
+ *
+ * guards against the same packet end.  Within a basic block, once a
+ * guard for some offset has fallen through, every later guard on the
+ * same base and bound with an equal or smaller offset is implied by it
+ * and is rewritten into "ja +0", which both the interpreter and the
+ * JIT treat as a fall-through.  Rewriting in place keeps every jump
+ * offset in the program valid, which is what keeps this pass cheap.
+ *
+ * The pass also rewrites divisions by a register that provably holds a
+ * non-zero constant into the immediate form, which lets the JIT skip
+ * the runtime divide-by-zero guard.
+ *
+ * The tracking is deliberately conservative: facts are dropped at every
+ * join point (any jump target), on every helper call, and whenever a
+ * register involved is written.  Pointer arithmetic is assumed not to
+ * wrap, which holds for the packet offsets p4c emits.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include <config.h>
+#include "ubpf_opt.h"
+#include "openvswitch/vlog.h"
+#include "util.h"
+
+VLOG_DEFINE_THIS_MODULE(ubpf_opt);
+
+#define OPT_NB_REGS 16
+#define OPT_MAX_FACTS 16
+
+/* Symbolic register value: the value some base register held at version
+ * 'base_ver', plus 'off'.  Versions make stale expressions harmless:
+ * once the base is rewritten its version changes and old facts simply
+ * stop matching. */
+struct reg_expr {
+    uint8_t base;
+    uint32_t base_ver;
+    int32_t off;
+};
+
+/* A guard that fell through: base_a + off_a <= base_b + off_b, strict
+ * ('<') when the guard was JGE. */
+struct bound_fact {
+    struct reg_expr a;
+    struct reg_expr b;
+    bool strict;
+};
+
+struct opt_state {
+    uint32_t ver[OPT_NB_REGS];
+    struct reg_expr expr[OPT_NB_REGS];
+    bool const_known[OPT_NB_REGS];
+    int32_t const_val[OPT_NB_REGS];
+    struct bound_fact facts[OPT_MAX_FACTS];
+    int n_facts;
+};
+
+static void
+opt_reset_regs(struct opt_state *s)
+{
+    for (int r = 0; r < OPT_NB_REGS; r++) {
+        s->expr[r].base = r;
+        s->expr[r].base_ver = s->ver[r];
+        s->expr[r].off = 0;
+        s->const_known[r] = false;
+    }
+}
+
+static void
+opt_write_reg(struct opt_state *s, uint8_t r)
+{
+    s->ver[r]++;
+    s->expr[r].base = r;
+    s->expr[r].base_ver = s->ver[r];
+    s->expr[r].off = 0;
+    s->const_known[r] = false;
+}
+
+static bool
+expr_same_value(const struct reg_expr *a, const struct reg_expr *b)
+{
+    return a->base == b->base && a->base_ver == b->base_ver
+           && a->off == b->off;
+}
+
+static bool
+expr_same_base(const struct reg_expr *a, const struct reg_expr *b)
+{
+    return a->base == b->base && a->base_ver == b->base_ver;
+}
+
+/* Returns true if 'a' <= 'b' (or 'a' < 'b' when 'strict') is already
+ * implied by a recorded fact; otherwise records it for later guards. */
+static bool
+opt_check_bound(struct opt_state *s, const struct reg_expr *a,
+                const struct reg_expr *b, bool strict)
+{
+    struct bound_fact *f;
+
+    for (int i = 0; i < s->n_facts; i++) {
+        f = &s->facts[i];
+        if (!expr_same_base(&f->a, a) || !expr_same_value(&f->b, b)) {
+            continue;
+        }
+        if (!strict && a->off <= f->a.off) {
+            return true;
+        }
+        if (strict && (f->strict ? a->off <= f->a.off : a->off < f->a.off)) {
+            return true;
+        }
+        /* Same guard shape, larger offset: widen the fact. */
+        if (a->off > f->a.off) {
+            f->a.off = a->off;
+            f->strict = strict;
+        }
+        return false;
+    }
+
+    if (s->n_facts < OPT_MAX_FACTS) {
+        f = &s->facts[s->n_facts++];
+        f->a = *a;
+        f->b = *b;
+        f->strict = strict;
+    }
+    return false;
+}
+
+void
+ubpf_optimize(struct ubpf_vm *vm)
+{
+    uint32_t n = vm->num_insts;
+    struct ebpf_inst *insts = vm->insts;
+    unsigned int n_guards_dropped = 0;
+    unsigned int n_divs_rewritten = 0;
+    struct opt_state s;
+    bool *is_target;
+
+    if (!n) {
+        return;
+    }
+
+    /* Any join point invalidates straight-line facts, so mark every
+     * jump target first. */
+    is_target = xzalloc(n * sizeof *is_target);
+    for (uint32_t i = 0; i < n; i++) {
+        uint8_t op = insts[i].opcode;
+
+        if (op == EBPF_OP_LDDW) {
+            i++; /* Skip the second slot. */
+            continue;
+        }
+        if ((op & EBPF_CLS_MASK) == EBPF_CLS_JMP
+            && op != EBPF_OP_CALL && op != EBPF_OP_EXIT) {
+            uint32_t target = i + insts[i].offset + 1;
+            if (target < n) {
+                is_target[target] = true;
+            }
+        }
+    }
+
+    memset(s.ver, 0, sizeof s.ver);
+    opt_reset_regs(&s);
+    s.n_facts = 0;
+
+    for (uint32_t i = 0; i < n; i++) {
+        struct ebpf_inst *inst = &insts[i];
+        uint8_t op = inst->opcode;
+
+        if (is_target[i]) {
+            opt_reset_regs(&s);
+            s.n_facts = 0;
+        }
+
+        switch (op) {
+        case EBPF_OP_MOV64_REG: {
+            struct reg_expr src_expr = s.expr[inst->src];
+            bool src_const = s.const_known[inst->src];
+            int32_t src_val = s.const_val[inst->src];
+
+            opt_write_reg(&s, inst->dst);
+            s.expr[inst->dst] = src_expr;
+            s.const_known[inst->dst] = src_const;
+            s.const_val[inst->dst] = src_val;
+            break;
+        }
+
+        case EBPF_OP_MOV_IMM:
+        case EBPF_OP_MOV64_IMM:
+            opt_write_reg(&s, inst->dst);
+            s.const_known[inst->dst] = true;
+            s.const_val[inst->dst] = inst->imm;
+            break;
+
+        case EBPF_OP_ADD64_IMM:
+        case EBPF_OP_SUB64_IMM: {
+            struct reg_expr expr = s.expr[inst->dst];
+            bool was_const = s.const_known[inst->dst];
+            int32_t val = s.const_val[inst->dst];
+            int32_t delta = op == EBPF_OP_ADD64_IMM ? inst->imm : -inst->imm;
+
+            s.ver[inst->dst]++;
+            expr.off += delta;
+            s.expr[inst->dst] = expr;
+            s.const_known[inst->dst] = was_const;
+            s.const_val[inst->dst] = val + delta;
+            break;
+        }
+
+        case EBPF_OP_DIV_REG:
+        case EBPF_OP_MOD_REG:
+        case EBPF_OP_DIV64_REG:
+        case EBPF_OP_MOD64_REG:
+            /* A register divisor that provably holds a positive constant
+             * becomes an immediate divisor, so the JIT needs no runtime
+             * zero check.  Positive only: MOV sign/zero-extension of a
+             * negative immediate differs between the two forms. */
+            if (s.const_known[inst->src] && s.const_val[inst->src] > 0) {
+                inst->opcode = op & ~EBPF_SRC_REG;
+                inst->imm = s.const_val[inst->src];
+                inst->src = 0;
+                n_divs_rewritten++;
+            }
+            opt_write_reg(&s, inst->dst);
+            break;
+
+        case EBPF_OP_JGT_REG:
+        case EBPF_OP_JGE_REG: {
+            /* Falling through "jgt a, b" proves a <= b; through
+             * "jge a, b" proves a < b.  A later guard on the same base
+             * and bound with an offset this already covers cannot be
+             * taken, so it degrades into a fall-through jump. */
+            const struct reg_expr *a = &s.expr[inst->dst];
+            const struct reg_expr *b = &s.expr[inst->src];
+            bool strict = op == EBPF_OP_JGE_REG;
+
+            if (opt_check_bound(&s, a, b, strict)) {
+                inst->opcode = EBPF_OP_JA;
+                inst->dst = 0;
+                inst->src = 0;
+                inst->offset = 0;
+                inst->imm = 0;
+                n_guards_dropped++;
+            }
+            break;
+        }
+
+        case EBPF_OP_CALL:
+            /* Helpers clobber r0-r5 and may move the packet
+             * (ubpf_adjust_head), so drop everything we know. */
+            for (uint8_t r = 0; r <= 5; r++) {
+                opt_write_reg(&s, r);
+            }
+            s.n_facts = 0;
+            break;
+
+        case EBPF_OP_LDDW:
+            opt_write_reg(&s, inst->dst);
+            i++; /* Skip the second slot. */
+            break;
+
+        case EBPF_OP_EXIT:
+        case EBPF_OP_JA:
+            break;
+
+        default:
+            if ((op & EBPF_CLS_MASK) == EBPF_CLS_ALU
+                || (op & EBPF_CLS_MASK) == EBPF_CLS_ALU64
+                || (op & EBPF_CLS_MASK) == EBPF_CLS_LDX) {
+                opt_write_reg(&s, inst->dst);
+            }
+            /* Stores, other loads and remaining jumps write no
+             * register; facts survive their fall-through. */
+            break;
+        }
+    }
+
+    free(is_target);
+
+    if (n_guards_dropped || n_divs_rewritten) {
+        VLOG_INFO("optimized program: %u redundant bounds guards dropped, "
+                  "%u divisions rewritten", n_guards_dropped,
+                  n_divs_rewritten);
+    }
+}
@@ -0,0 +1,214 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* PacketIn (punt to controller) path from PMD threads to the P4Runtime
+ * frontend.
+ *
+ * Each PMD thread owns a single-producer single-consumer ring of punted
+ * packets; pushing is a pair of index loads, a slot store and an index
+ * store, and never blocks - a full ring just drops the packet and counts
+ * it.  A dedicated delivery thread drains all rings every couple of
+ * milliseconds and hands the packets to a registered sink in batches, so
+ * the controller session pays its per-message wakeup and locking once
+ * per batch instead of once per punted packet.
+ *
+ * Unlike the digest ring (see ubpf_digest.c) there is one ring per
+ * producer, so neither side needs a compare-and-swap: the owning PMD is
+ * the only writer of 'tail', the delivery thread the only writer of
+ * 'head'. */
+
+#include <config.h>
+
+#include "ubpf_packetin.h"
+
+#include "dp-packet.h"
+#include "openvswitch/list.h"
+#include "openvswitch/vlog.h"
+#include "ovs-atomic.h"
+#include "ovs-thread.h"
+#include "util.h"
+
+VLOG_DEFINE_THIS_MODULE(ubpf_packetin);
+
+static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 20);
+
+#define PACKETIN_RING_SIZE 512  /* Slots per PMD; must be a power of two. */
+#define PACKETIN_RING_MASK (PACKETIN_RING_SIZE - 1)
+#define PACKETIN_BATCH_MAX 64
+#define PACKETIN_DRAIN_INTERVAL_NS (2 * 1000 * 1000)
+
+struct ubpf_packetin_ring {
+    struct ovs_list list_node;  /* In 'packetin_rings'. */
+    /* Next slot to consume; written only by the delivery thread. */
+    OVS_ALIGNED_VAR(CACHE_LINE_SIZE) atomic_uint32_t head;
+    /* Next slot to produce; written only by the owning PMD. */
+    OVS_ALIGNED_VAR(CACHE_LINE_SIZE) atomic_uint32_t tail;
+    OVS_ALIGNED_VAR(CACHE_LINE_SIZE)
+        struct ubpf_packetin slots[PACKETIN_RING_SIZE];
+};
+
+static struct ovs_mutex packetin_mutex = OVS_MUTEX_INITIALIZER;
+static struct ovs_list packetin_rings OVS_GUARDED_BY(packetin_mutex)
+    = OVS_LIST_INITIALIZER(&packetin_rings);
+static atomic_uint64_t n_ring_drops = ATOMIC_VAR_INIT(0);
+
+static ubpf_packetin_cb *packetin_cb;
+static void *packetin_cb_aux;
+
+static void *packetin_thread(void *arg OVS_UNUSED);
+
+/* Creates a ring and makes it visible to the delivery thread, starting
+ * that thread on first use.  The caller (one PMD) becomes the ring's only
+ * producer. */
+struct ubpf_packetin_ring *
+ubpf_packetin_ring_create(void)
+{
+    static struct ovsthread_once once = OVSTHREAD_ONCE_INITIALIZER;
+    struct ubpf_packetin_ring *ring = xzalloc_cacheline(sizeof *ring);
+
+    if (ovsthread_once_start(&once)) {
+        ovs_thread_create("ubpf_packetin", packetin_thread, NULL);
+        ovsthread_once_done(&once);
+    }
+
+    ovs_mutex_lock(&packetin_mutex);
+    ovs_list_push_back(&packetin_rings, &ring->list_node);
+    ovs_mutex_unlock(&packetin_mutex);
+
+    return ring;
+}
+
+static bool
+packetin_pop(struct ubpf_packetin_ring *ring, struct ubpf_packetin *rec)
+{
+    uint32_t head, tail;
+
+    atomic_read_relaxed(&ring->head, &head);
+    atomic_read_explicit(&ring->tail, &tail, memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+
+    *rec = ring->slots[head & PACKETIN_RING_MASK];
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return true;
+}
+
+/* Detaches 'ring' from the delivery thread and frees it along with any
+ * packets still queued.  The producer must have stopped pushing. */
+void
+ubpf_packetin_ring_destroy(struct ubpf_packetin_ring *ring)
+{
+    struct ubpf_packetin rec;
+
+    if (!ring) {
+        return;
+    }
+
+    /* The delivery thread drains under 'packetin_mutex', so after the
+     * removal it can no longer see the ring. */
+    ovs_mutex_lock(&packetin_mutex);
+    ovs_list_remove(&ring->list_node);
+    ovs_mutex_unlock(&packetin_mutex);
+
+    while (packetin_pop(ring, &rec)) {
+        dp_packet_delete(rec.packet);
+    }
+    free_cacheline(ring);
+}
+
+/* Pushes one punted packet, taking ownership of 'packet' whether or not
+ * the push succeeds.  Only the ring's owning PMD may call this; returns
+ * 0 on success, -1 if the ring is full (the packet is freed and the drop
+ * counted, the caller should not retry from the packet path). */
+int
+ubpf_packetin_push(struct ubpf_packetin_ring *ring, uint32_t prog_id,
+                   uint32_t in_port, struct dp_packet *packet)
+{
+    struct ubpf_packetin *slot;
+    uint32_t head, tail;
+
+    atomic_read_explicit(&ring->head, &head, memory_order_acquire);
+    atomic_read_relaxed(&ring->tail, &tail);
+    if (OVS_UNLIKELY(tail - head >= PACKETIN_RING_SIZE)) {
+        dp_packet_delete(packet);
+        atomic_count_inc64(&n_ring_drops);
+        return -1;
+    }
+
+    slot = &ring->slots[tail & PACKETIN_RING_MASK];
+    slot->prog_id = prog_id;
+    slot->in_port = in_port;
+    slot->packet = packet;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+
+    return 0;
+}
+
+/* Registers the batch sink.  Set this once at startup, before any
+ * program punts packets; batches arriving with no sink are dropped. */
+void
+ubpf_packetin_set_cb(ubpf_packetin_cb *cb, void *aux)
+{
+    packetin_cb = cb;
+    packetin_cb_aux = aux;
+}
+
+static void *
+packetin_thread(void *arg OVS_UNUSED)
+{
+    struct ubpf_packetin batch[PACKETIN_BATCH_MAX];
+
+    for (;;) {
+        uint64_t drops;
+        size_t n;
+
+        /* The sleep is the coalescing window: everything the PMDs punt
+         * within it goes out as one batch (or a few, under load). */
+        xnanosleep(PACKETIN_DRAIN_INTERVAL_NS);
+
+        do {
+            struct ubpf_packetin_ring *ring;
+
+            n = 0;
+            ovs_mutex_lock(&packetin_mutex);
+            LIST_FOR_EACH (ring, list_node, &packetin_rings) {
+                while (n < PACKETIN_BATCH_MAX
+                       && packetin_pop(ring, &batch[n])) {
+                    n++;
+                }
+            }
+            ovs_mutex_unlock(&packetin_mutex);
+
+            if (n) {
+                if (packetin_cb) {
+                    packetin_cb(batch, n, packetin_cb_aux);
+                }
+                for (size_t i = 0; i < n; i++) {
+                    dp_packet_delete(batch[i].packet);
+                }
+            }
+        } while (n == PACKETIN_BATCH_MAX);
+
+        atomic_read_relaxed(&n_ring_drops, &drops);
+        if (drops) {
+            uint64_t zero = 0;
+            atomic_store_relaxed(&n_ring_drops, zero);
+            VLOG_WARN_RL(&rl, "packet-in ring overflow: %"PRIu64" packets "
+                         "dropped", drops);
+        }
+    }
+
+    OVS_NOT_REACHED();
+}
@@ -0,0 +1,42 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UBPF_PACKETIN_H
+#define UBPF_PACKETIN_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct dp_packet;
+
+/* One punted packet on its way to the controller.  The delivery thread
+ * owns 'packet' (a malloc-backed copy, never a PMD's mbuf) and frees it
+ * after the sink returns. */
+struct ubpf_packetin {
+    uint32_t prog_id;           /* P4 device the packet belongs to. */
+    uint32_t in_port;           /* Datapath port the packet arrived on. */
+    struct dp_packet *packet;
+};
+
+struct ubpf_packetin_ring *ubpf_packetin_ring_create(void);
+void ubpf_packetin_ring_destroy(struct ubpf_packetin_ring *);
+int ubpf_packetin_push(struct ubpf_packetin_ring *, uint32_t prog_id,
+                       uint32_t in_port, struct dp_packet *);
+
+/* Called from the delivery thread with a coalesced batch of packets. */
+typedef void ubpf_packetin_cb(const struct ubpf_packetin *pkts, size_t n,
+                              void *aux);
+void ubpf_packetin_set_cb(ubpf_packetin_cb *cb, void *aux);
+
+#endif
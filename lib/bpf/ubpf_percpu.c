@@ -0,0 +1,278 @@
+/*
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Per-thread uBPF map variants.
+ *
+ * P4 counters and registers live in ordinary array or hash maps, so
+ * per-packet updates from several PMD threads ping-pong the counter
+ * cache lines between cores.  These map types keep one value replica
+ * per thread: the datapath helpers resolve to the calling thread's
+ * replica, turning hot updates into local uncontended stores, and the
+ * control plane sees the lane-wise sum of all replicas when it dumps
+ * the map.
+ *
+ * Values must be a multiple of 4 bytes and are aggregated as 32-bit
+ * lanes, which matches how p4c-ubpf lays out counter and register
+ * values.  A control-plane update writes replica 0 and clears the
+ * others, so the aggregate equals the written value. */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <config.h>
+#include "ovs-thread.h"
+#include "util.h"
+#include "ubpf_percpu.h"
+#include "ubpf_hashmap.h"
+#include "openvswitch/vlog.h"
+
+VLOG_DEFINE_THIS_MODULE(ubpf_percpu);
+
+static inline unsigned int
+percpu_replica_index(void)
+{
+    return ovsthread_id_self() % UBPF_PERCPU_REPLICAS;
+}
+
+/* Adds replica 'src' into 'dst' as 32-bit lanes. */
+static void
+percpu_value_add(char *dst, const char *src, unsigned int value_size)
+{
+    uint32_t lane;
+
+    for (unsigned int i = 0; i < value_size; i += sizeof lane) {
+        uint32_t sum;
+
+        memcpy(&sum, dst + i, sizeof sum);
+        memcpy(&lane, src + i, sizeof lane);
+        sum += lane;
+        memcpy(dst + i, &sum, sizeof sum);
+    }
+}
+
+/* ## --------------- ## */
+/* ## Per-CPU array.  ## */
+/* ## --------------- ## */
+
+/* Replica-major layout: each thread's whole array is contiguous and
+ * starts on its own cache line, so replicas never share lines. */
+struct percpu_array {
+    size_t replica_bytes;       /* max_entries * value_size, line-aligned. */
+    char *data;
+};
+
+void *
+ubpf_percpu_array_create(const struct ubpf_map_def *map_def)
+{
+    struct percpu_array *array;
+
+    if (map_def->value_size % 4) {
+        VLOG_ERR("Per-thread maps require a multiple-of-4 value size");
+        return NULL;
+    }
+
+    array = xzalloc(sizeof *array);
+    array->replica_bytes = ROUND_UP((size_t) map_def->max_entries
+                                    * map_def->value_size, CACHE_LINE_SIZE);
+    array->data = xzalloc_cacheline(UBPF_PERCPU_REPLICAS
+                                    * array->replica_bytes);
+    return array;
+}
+
+void *
+ubpf_percpu_array_lookup(const struct ubpf_map *map, const void *key)
+{
+    struct percpu_array *array = map->data;
+    uint64_t idx = *((const uint64_t *)key);
+
+    if (OVS_UNLIKELY(idx >= map->max_entries)) {
+        return NULL;
+    }
+    return array->data + percpu_replica_index() * array->replica_bytes
+           + idx * map->value_size;
+}
+
+int
+ubpf_percpu_array_update(struct ubpf_map *map, const void *key, void *value)
+{
+    struct percpu_array *array = map->data;
+    uint64_t idx = *((const uint64_t *)key);
+
+    if (OVS_UNLIKELY(idx >= map->max_entries)) {
+        return -5;
+    }
+
+    /* Write replica 0 and clear the others so that the aggregate equals
+     * the written value.  PMD threads modify their replica in place
+     * through ubpf_percpu_array_lookup() instead. */
+    for (unsigned int r = 0; r < UBPF_PERCPU_REPLICAS; r++) {
+        char *addr = array->data + r * array->replica_bytes
+                     + idx * map->value_size;
+        if (!r) {
+            memcpy(addr, value, map->value_size);
+        } else {
+            memset(addr, 0, map->value_size);
+        }
+    }
+    return 0;
+}
+
+unsigned int
+ubpf_percpu_array_size(const struct ubpf_map *map)
+{
+    return map->max_entries;
+}
+
+unsigned int
+ubpf_percpu_array_dump(const struct ubpf_map *map, char *data)
+{
+    struct percpu_array *array = map->data;
+
+    for (uint64_t idx = 0; idx < map->max_entries; idx++) {
+        memset(data, 0, map->value_size);
+        for (unsigned int r = 0; r < UBPF_PERCPU_REPLICAS; r++) {
+            percpu_value_add(data,
+                             array->data + r * array->replica_bytes
+                             + idx * map->value_size, map->value_size);
+        }
+        data += map->value_size;
+    }
+
+    return map->max_entries;
+}
+
+void
+ubpf_percpu_array_destroy(struct ubpf_map *map)
+{
+    struct percpu_array *array = map->data;
+
+    free_cacheline(array->data);
+    free(array);
+}
+
+/* ## ----------------- ## */
+/* ## Per-CPU hashmap.  ## */
+/* ## ----------------- ## */
+
+/* Implemented on top of the ordinary hashmap through a shadow map whose
+ * value is all replicas side by side.  The key structure is shared, so
+ * inserts and deletes behave exactly like the plain hashmap; only the
+ * value storage is replicated. */
+struct percpu_hashmap {
+    struct ubpf_map shadow;
+};
+
+void *
+ubpf_percpu_hashmap_create(const struct ubpf_map_def *map_def)
+{
+    struct percpu_hashmap *hmap;
+    struct ubpf_map_def wide_def = *map_def;
+
+    if (map_def->value_size % 4) {
+        VLOG_ERR("Per-thread maps require a multiple-of-4 value size");
+        return NULL;
+    }
+
+    wide_def.value_size = map_def->value_size * UBPF_PERCPU_REPLICAS;
+
+    hmap = xzalloc(sizeof *hmap);
+    hmap->shadow.key_size = wide_def.key_size;
+    hmap->shadow.value_size = wide_def.value_size;
+    hmap->shadow.max_entries = wide_def.max_entries;
+    hmap->shadow.data = ubpf_hashmap_create(&wide_def);
+    return hmap;
+}
+
+void *
+ubpf_percpu_hashmap_lookup(const struct ubpf_map *map, const void *key)
+{
+    struct percpu_hashmap *hmap = map->data;
+    char *replicas = ubpf_hashmap_lookup(&hmap->shadow, key);
+
+    if (!replicas) {
+        return NULL;
+    }
+    return replicas + percpu_replica_index() * map->value_size;
+}
+
+int
+ubpf_percpu_hashmap_update(struct ubpf_map *map, const void *key, void *value)
+{
+    struct percpu_hashmap *hmap = map->data;
+    char *replicas = xzalloc(hmap->shadow.value_size);
+    int error;
+
+    memcpy(replicas, value, map->value_size);
+    error = ubpf_hashmap_update(&hmap->shadow, key, replicas);
+    free(replicas);
+    return error;
+}
+
+int
+ubpf_percpu_hashmap_delete(struct ubpf_map *map, const void *key)
+{
+    struct percpu_hashmap *hmap = map->data;
+
+    return ubpf_hashmap_delete(&hmap->shadow, key);
+}
+
+unsigned int
+ubpf_percpu_hashmap_size(const struct ubpf_map *map)
+{
+    struct percpu_hashmap *hmap = map->data;
+
+    return ubpf_hashmap_size(&hmap->shadow);
+}
+
+unsigned int
+ubpf_percpu_hashmap_dump(const struct ubpf_map *map, char *data)
+{
+    struct percpu_hashmap *hmap = map->data;
+    unsigned int n_entries = ubpf_hashmap_size(&hmap->shadow);
+    size_t wide_entry = map->key_size + hmap->shadow.value_size;
+    char *wide = xzalloc((size_t) n_entries * wide_entry);
+    char *widep = wide;
+    struct ubpf_map_cursor cursor;
+
+    memset(&cursor, 0, sizeof cursor);
+    n_entries = ubpf_hashmap_dump_next(&hmap->shadow, &cursor, n_entries,
+                                       wide);
+
+    for (unsigned int i = 0; i < n_entries; i++) {
+        memcpy(data, widep, map->key_size);
+        data += map->key_size;
+        widep += map->key_size;
+
+        memset(data, 0, map->value_size);
+        for (unsigned int r = 0; r < UBPF_PERCPU_REPLICAS; r++) {
+            percpu_value_add(data, widep + r * map->value_size,
+                             map->value_size);
+        }
+        data += map->value_size;
+        widep += hmap->shadow.value_size;
+    }
+
+    free(wide);
+    return n_entries;
+}
+
+void
+ubpf_percpu_hashmap_destroy(struct ubpf_map *map)
+{
+    struct percpu_hashmap *hmap = map->data;
+
+    ubpf_hashmap_destroy(&hmap->shadow);
+    free(hmap);
+}
@@ -0,0 +1,65 @@
+/*
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UBPF_PERCPU_H
+#define UBPF_PERCPU_H 1
+
+#include "ubpf_int.h"
+#include "util.h"
+
+/* Number of value replicas in per-thread maps.  Threads pick the replica
+ * at ovsthread_id_self() % UBPF_PERCPU_REPLICAS, the same scheme as
+ * struct ovsthread_stats, so two threads only share a replica if their
+ * ids collide modulo this. */
+#define UBPF_PERCPU_REPLICAS 16
+
+void *ubpf_percpu_array_create(const struct ubpf_map_def *map_def);
+void *ubpf_percpu_array_lookup(const struct ubpf_map *map, const void *key);
+int ubpf_percpu_array_update(struct ubpf_map *map, const void *key,
+                             void *value);
+unsigned int ubpf_percpu_array_size(const struct ubpf_map *map);
+unsigned int ubpf_percpu_array_dump(const struct ubpf_map *map, char *data);
+void ubpf_percpu_array_destroy(struct ubpf_map *map);
+
+void *ubpf_percpu_hashmap_create(const struct ubpf_map_def *map_def);
+void *ubpf_percpu_hashmap_lookup(const struct ubpf_map *map, const void *key);
+int ubpf_percpu_hashmap_update(struct ubpf_map *map, const void *key,
+                               void *value);
+int ubpf_percpu_hashmap_delete(struct ubpf_map *map, const void *key);
+unsigned int ubpf_percpu_hashmap_size(const struct ubpf_map *map);
+unsigned int ubpf_percpu_hashmap_dump(const struct ubpf_map *map, char *data);
+void ubpf_percpu_hashmap_destroy(struct ubpf_map *map);
+
+static const struct ubpf_map_ops ubpf_percpu_array_ops = {
+    .map_size = ubpf_percpu_array_size,
+    .map_dump = ubpf_percpu_array_dump,
+    .map_lookup = ubpf_percpu_array_lookup,
+    .map_update = ubpf_percpu_array_update,
+    .map_delete = NULL,
+    .map_add = NULL,
+    .map_destroy = ubpf_percpu_array_destroy,
+};
+
+static const struct ubpf_map_ops ubpf_percpu_hashmap_ops = {
+    .map_size = ubpf_percpu_hashmap_size,
+    .map_dump = ubpf_percpu_hashmap_dump,
+    .map_lookup = ubpf_percpu_hashmap_lookup,
+    .map_update = ubpf_percpu_hashmap_update,
+    .map_delete = ubpf_percpu_hashmap_delete,
+    .map_add = NULL,
+    .map_destroy = ubpf_percpu_hashmap_destroy,
+};
+
+#endif
@@ -0,0 +1,259 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <config.h>
+#include "ubpf_range.h"
+
+#include "ovs-rcu.h"
+#include "unaligned.h"
+#include "util.h"
+
+/* Range match map: priority-ordered scan over an immutable snapshot.
+ *
+ * A P4 range field (an L4 port range, say) expanded into prefixes costs
+ * up to 2w - 2 entries per w-bit field; storing the range as written
+ * costs one.  Entries live in a flat array rebuilt on every control-plane
+ * write, so a lookup walks one contiguous allocation in descending
+ * priority order and returns at the first hit, and the per-cell bound
+ * checks accumulate into a flag instead of branching, so each entry
+ * costs a predictable, data-independent number of cycles.
+ *
+ * The key is compared as 32-bit cells in the image layout build_key()
+ * emits, where each field is byte-reversed into host order and padded to
+ * a 4-byte multiple.  A field of up to 32 bits therefore occupies one
+ * cell and any range over it is exact.  A wider field spans several
+ * cells that match independently, which is still exact whenever its two
+ * bounds agree outside the lowest cell - always the case for exact and
+ * fully wildcarded fields. */
+
+static inline uint8_t *
+range_entry(const struct range_snapshot *snap, uint32_t i)
+{
+    return CONST_CAST(uint8_t *, snap->entries)
+           + (size_t) i * snap->entry_stride;
+}
+
+static inline uint32_t
+range_entry_priority(const uint8_t *entry)
+{
+    uint32_t priority;
+
+    memcpy(&priority, entry, sizeof priority);
+    return priority;
+}
+
+static inline uint8_t *
+range_entry_value(const struct range_map *rmap, uint8_t *entry)
+{
+    return entry + sizeof(uint32_t) + 2 * rmap->key_size;
+}
+
+static struct range_snapshot *
+range_snapshot_alloc(const struct range_map *rmap, uint32_t n_entries)
+{
+    struct range_snapshot *snap;
+    uint32_t stride = ROUND_UP(sizeof(uint32_t) + 2 * rmap->key_size
+                               + rmap->value_size, 8);
+
+    snap = xzalloc(sizeof *snap + (size_t) n_entries * stride);
+    snap->n_entries = n_entries;
+    snap->entry_stride = stride;
+    return snap;
+}
+
+void *
+ubpf_range_create(const struct ubpf_map_def *map_def)
+{
+    struct range_map *rmap;
+
+    /* Keys are compared cell by cell, so they must divide into cells. */
+    if (!map_def->key_size || map_def->key_size % 4) {
+        return NULL;
+    }
+
+    rmap = xzalloc(sizeof *rmap);
+    ovs_mutex_init(&rmap->mutex);
+    rmap->key_size = map_def->key_size;
+    rmap->value_size = map_def->value_size;
+    rmap->n_cells = map_def->key_size / 4;
+    ovsrcu_init(&rmap->snapshot, range_snapshot_alloc(rmap, 0));
+
+    return rmap;
+}
+
+void
+ubpf_range_destroy(struct ubpf_map *map)
+{
+    struct range_map *rmap = map->data;
+
+    /* Wait out all readers so the snapshot can be freed in place. */
+    ovsrcu_synchronize();
+
+    free(ovsrcu_get_protected(struct range_snapshot *, &rmap->snapshot));
+    ovs_mutex_destroy(&rmap->mutex);
+    free(rmap);
+}
+
+unsigned int
+ubpf_range_size(const struct ubpf_map *map)
+{
+    struct range_map *rmap = map->data;
+    struct range_snapshot *snap;
+
+    snap = ovsrcu_get(struct range_snapshot *, &rmap->snapshot);
+    return snap->n_entries;
+}
+
+unsigned int
+ubpf_range_dump(const struct ubpf_map *map, char *data)
+{
+    struct range_map *rmap = map->data;
+    struct range_snapshot *snap;
+
+    /* The generic dump format has no room for bounds or priorities, so
+     * each entry is reported by its low bound. */
+    snap = ovsrcu_get(struct range_snapshot *, &rmap->snapshot);
+    for (uint32_t i = 0; i < snap->n_entries; i++) {
+        uint8_t *entry = range_entry(snap, i);
+
+        memcpy(data, entry + sizeof(uint32_t), rmap->key_size);
+        data += rmap->key_size;
+        memcpy(data, range_entry_value(rmap, entry), rmap->value_size);
+        data += rmap->value_size;
+    }
+
+    return snap->n_entries;
+}
+
+void *
+ubpf_range_lookup(const struct ubpf_map *map, const void *key)
+{
+    struct range_map *rmap = map->data;
+    struct range_snapshot *snap;
+
+    snap = ovsrcu_get(struct range_snapshot *, &rmap->snapshot);
+    for (uint32_t i = 0; i < snap->n_entries; i++) {
+        uint8_t *entry = range_entry(snap, i);
+        const uint32_t *lo = (const uint32_t *) (entry + sizeof(uint32_t));
+        const uint32_t *hi = lo + rmap->n_cells;
+        uint32_t ok = 1;
+
+        for (uint32_t c = 0; c < rmap->n_cells; c++) {
+            uint32_t k = get_unaligned_u32(
+                (const uint32_t *) ((const uint8_t *) key + 4 * c));
+
+            ok &= (uint32_t) (lo[c] <= k) & (uint32_t) (k <= hi[c]);
+        }
+        if (ok) {
+            return range_entry_value(rmap, entry);
+        }
+    }
+
+    return NULL;
+}
+
+/* Finds the entry with exactly 'rkey''s priority and bounds, setting
+ * '*idx' to its position, or to the position a new entry with that
+ * priority belongs at when there is none. */
+static bool
+range_find_entry(const struct range_map *rmap,
+                 const struct range_snapshot *snap,
+                 const struct ubpf_range_key *rkey, uint32_t *idx)
+    OVS_REQUIRES(rmap->mutex)
+{
+    uint32_t insert = snap->n_entries;
+
+    for (uint32_t i = 0; i < snap->n_entries; i++) {
+        const uint8_t *entry = range_entry(snap, i);
+        uint32_t priority = range_entry_priority(entry);
+
+        if (priority == rkey->priority
+            && !memcmp(entry + sizeof(uint32_t), rkey->data,
+                       2 * rmap->key_size)) {
+            *idx = i;
+            return true;
+        }
+        if (priority < rkey->priority && insert == snap->n_entries) {
+            insert = i;
+        }
+    }
+    *idx = insert;
+    return false;
+}
+
+int
+ubpf_range_update(struct ubpf_map *map, const void *key, void *value)
+{
+    const struct ubpf_range_key *rkey = key;
+    struct range_map *rmap = map->data;
+    struct range_snapshot *old, *new;
+    uint32_t idx;
+    bool found;
+
+    ovs_mutex_lock(&rmap->mutex);
+    old = ovsrcu_get_protected(struct range_snapshot *, &rmap->snapshot);
+    found = range_find_entry(rmap, old, rkey, &idx);
+
+    new = range_snapshot_alloc(rmap, old->n_entries + !found);
+    if (found) {
+        memcpy(new->entries, old->entries,
+               (size_t) old->n_entries * old->entry_stride);
+    } else {
+        uint8_t *entry = range_entry(new, idx);
+
+        memcpy(new->entries, old->entries, (size_t) idx * old->entry_stride);
+        memcpy(range_entry(new, idx + 1), range_entry(old, idx),
+               (size_t) (old->n_entries - idx) * old->entry_stride);
+        memcpy(entry, &rkey->priority, sizeof rkey->priority);
+        memcpy(entry + sizeof(uint32_t), rkey->data, 2 * rmap->key_size);
+    }
+    memcpy(range_entry_value(rmap, range_entry(new, idx)), value,
+           rmap->value_size);
+
+    ovsrcu_set(&rmap->snapshot, new);
+    ovs_mutex_unlock(&rmap->mutex);
+    ovsrcu_postpone(free, old);
+
+    return 0;
+}
+
+int
+ubpf_range_delete(struct ubpf_map *map, const void *key)
+{
+    const struct ubpf_range_key *rkey = key;
+    struct range_map *rmap = map->data;
+    struct range_snapshot *old, *new;
+    uint32_t idx;
+
+    ovs_mutex_lock(&rmap->mutex);
+    old = ovsrcu_get_protected(struct range_snapshot *, &rmap->snapshot);
+    if (!range_find_entry(rmap, old, rkey, &idx)) {
+        ovs_mutex_unlock(&rmap->mutex);
+        return -4;
+    }
+
+    new = range_snapshot_alloc(rmap, old->n_entries - 1);
+    memcpy(new->entries, old->entries, (size_t) idx * old->entry_stride);
+    memcpy(range_entry(new, idx), range_entry(old, idx + 1),
+           (size_t) (old->n_entries - idx - 1) * old->entry_stride);
+
+    ovsrcu_set(&rmap->snapshot, new);
+    ovs_mutex_unlock(&rmap->mutex);
+    ovsrcu_postpone(free, old);
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef UBPF_RANGE_H
+#define UBPF_RANGE_H 1
+
+#include "ovs-rcu.h"
+#include "ovs-thread.h"
+
+#include "ubpf_int.h"
+
+void *ubpf_range_create(const struct ubpf_map_def *map_def);
+unsigned int ubpf_range_size(const struct ubpf_map *map);
+unsigned int ubpf_range_dump(const struct ubpf_map *map, char *data);
+void *ubpf_range_lookup(const struct ubpf_map *map, const void *key);
+int ubpf_range_update(struct ubpf_map *map, const void *key, void *value);
+int ubpf_range_delete(struct ubpf_map *map, const void *key);
+void ubpf_range_destroy(struct ubpf_map *map);
+
+/* Control-plane key for map_update and map_delete.  map_lookup takes a
+ * plain key of the map's declared key size; entries are identified by
+ * their bounds and priority, so writers hand in all three: 'data' holds
+ * the low-bound key image followed by the high-bound key image, each of
+ * the map's declared key size and in the same per-field layout as an
+ * exact-match key. */
+struct ubpf_range_key {
+    uint32_t priority;          /* P4Runtime priority; higher wins. */
+    uint8_t data[0];
+};
+
+/* Range classifier over an immutable, RCU-published entry array.  The
+ * key is treated as key_size / 4 32-bit cells and an entry matches when
+ * every cell falls inside that cell's [low, high] bounds.  Lookups are
+ * lock-free; 'mutex' only serializes writers, which rebuild the snapshot
+ * and retire the old one after a grace period. */
+struct range_map {
+    OVSRCU_TYPE(struct range_snapshot *) snapshot;
+    struct ovs_mutex mutex;     /* Serializes writers. */
+    uint32_t key_size;          /* A multiple of 4. */
+    uint32_t value_size;
+    uint32_t n_cells;           /* key_size / 4. */
+};
+
+/* Entries are laid out back to back in descending priority order, each
+ * 'entry_stride' bytes: a uint32_t priority, 'n_cells' low cells,
+ * 'n_cells' high cells, then value_size value bytes, the whole record
+ * padded out to 8 bytes so the cells stay aligned. */
+struct range_snapshot {
+    uint32_t n_entries;
+    uint32_t entry_stride;      /* Bytes per entry. */
+    uint8_t entries[0] OVS_ALIGNED_VAR(8);
+};
+
+static const struct ubpf_map_ops ubpf_range_ops = {
+    .map_size = ubpf_range_size,
+    .map_dump = ubpf_range_dump,
+    .map_lookup = ubpf_range_lookup,
+    .map_update = ubpf_range_update,
+    .map_delete = ubpf_range_delete,
+    .map_add = NULL,
+    .map_destroy = ubpf_range_destroy,
+};
+
+#endif
@@ -0,0 +1,294 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <config.h>
+#include "ubpf_ternary.h"
+
+#include "hash.h"
+#include "ovs-rcu.h"
+#include "util.h"
+
+/* Ternary match map: tuple-space search over the entry masks.
+ *
+ * A P4 ternary table expanded into exact-match entries multiplies every
+ * wildcarded rule by the number of values its don't-care bits can take.
+ * Storing the rules as written instead costs one exact-match probe per
+ * distinct mask, and ACL-style tables use very few distinct masks. */
+
+static inline uint8_t *
+ternary_entry_value(const struct ternary_map *tmap, struct ternary_entry *entry)
+{
+    return entry->data + ROUND_UP(tmap->key_size, 8);
+}
+
+void *
+ubpf_ternary_create(const struct ubpf_map_def *map_def)
+{
+    struct ternary_map *tmap;
+
+    if (map_def->key_size > UBPF_TERNARY_MAX_KEY) {
+        return NULL;
+    }
+
+    tmap = xzalloc(sizeof *tmap);
+    pvector_init(&tmap->tuples);
+    ovs_mutex_init(&tmap->mutex);
+    tmap->key_size = map_def->key_size;
+    tmap->value_size = map_def->value_size;
+
+    return tmap;
+}
+
+void
+ubpf_ternary_destroy(struct ubpf_map *map)
+{
+    struct ternary_map *tmap = map->data;
+    struct ternary_tuple *tuple;
+
+    /* Wait out all readers so the tuples can be torn down in place. */
+    ovsrcu_synchronize();
+
+    PVECTOR_FOR_EACH (tuple, &tmap->tuples) {
+        struct ternary_entry *entry;
+
+        CMAP_FOR_EACH (entry, cmap_node, &tuple->entries) {
+            cmap_remove(&tuple->entries, &entry->cmap_node, entry->hash);
+            ovsrcu_postpone(free, entry);
+        }
+        cmap_destroy(&tuple->entries);
+        free(tuple);
+    }
+    pvector_destroy(&tmap->tuples);
+    ovs_mutex_destroy(&tmap->mutex);
+    free(tmap);
+}
+
+unsigned int
+ubpf_ternary_size(const struct ubpf_map *map)
+{
+    struct ternary_map *tmap = map->data;
+    return tmap->n_entries;
+}
+
+unsigned int
+ubpf_ternary_dump(const struct ubpf_map *map, char *data)
+{
+    struct ternary_map *tmap = map->data;
+    struct ternary_tuple *tuple;
+    unsigned int count = 0;
+
+    /* The generic dump format has no room for masks or priorities, so
+     * each entry is reported by its masked value. */
+    PVECTOR_FOR_EACH (tuple, &tmap->tuples) {
+        struct ternary_entry *entry;
+
+        CMAP_FOR_EACH (entry, cmap_node, &tuple->entries) {
+            memcpy(data, entry->data, tmap->key_size);
+            data += tmap->key_size;
+            memcpy(data, ternary_entry_value(tmap, entry), tmap->value_size);
+            data += tmap->value_size;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+void *
+ubpf_ternary_lookup(const struct ubpf_map *map, const void *key)
+{
+    struct ternary_map *tmap = map->data;
+    struct ternary_entry *best = NULL;
+    struct ternary_tuple *tuple;
+    int best_priority = -1;
+
+    /* Tuples are sorted by their best entry's priority, so once a match is
+     * in hand only tuples that can still beat it are visited. */
+    PVECTOR_FOR_EACH_PRIORITY (tuple, best_priority + 1, 2, sizeof *tuple,
+                               &tmap->tuples) {
+        uint8_t masked[UBPF_TERNARY_MAX_KEY];
+        struct ternary_entry *entry;
+        uint32_t hash;
+
+        for (uint32_t i = 0; i < tmap->key_size; i++) {
+            masked[i] = ((const uint8_t *) key)[i] & tuple->mask[i];
+        }
+        hash = hash_bytes(masked, tmap->key_size, 0);
+
+        CMAP_FOR_EACH_WITH_HASH (entry, cmap_node, hash, &tuple->entries) {
+            if (entry->hash == hash
+                && (int) entry->priority > best_priority
+                && !memcmp(entry->data, masked, tmap->key_size)) {
+                best = entry;
+                best_priority = entry->priority;
+            }
+        }
+    }
+
+    return best ? ternary_entry_value(tmap, best) : NULL;
+}
+
+static struct ternary_tuple *
+ternary_find_tuple(const struct ternary_map *tmap, const uint8_t *mask)
+    OVS_REQUIRES(tmap->mutex)
+{
+    struct ternary_tuple *tuple;
+
+    PVECTOR_FOR_EACH (tuple, &tmap->tuples) {
+        if (!memcmp(tuple->mask, mask, tmap->key_size)) {
+            return tuple;
+        }
+    }
+    return NULL;
+}
+
+static struct ternary_entry *
+ternary_find_entry(const struct ternary_map *tmap,
+                   const struct ternary_tuple *tuple, uint32_t hash,
+                   const uint8_t *masked, uint32_t priority)
+    OVS_REQUIRES(tmap->mutex)
+{
+    struct ternary_entry *entry;
+
+    CMAP_FOR_EACH_WITH_HASH (entry, cmap_node, hash, &tuple->entries) {
+        if (entry->hash == hash && entry->priority == priority
+            && !memcmp(entry->data, masked, tmap->key_size)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void
+ternary_tuple_free(void *tuple_)
+{
+    struct ternary_tuple *tuple = tuple_;
+
+    cmap_destroy(&tuple->entries);
+    free(tuple);
+}
+
+/* A removed tuple stays visible through the pvector version that
+ * pvector_publish() itself only retires after a grace period, so its
+ * memory goes back one grace period later still (see pvector.h). */
+static void
+ternary_tuple_defer_free(void *tuple_)
+{
+    ovsrcu_postpone(ternary_tuple_free, tuple_);
+}
+
+int
+ubpf_ternary_update(struct ubpf_map *map, const void *key, void *value)
+{
+    const struct ubpf_ternary_key *tkey = key;
+    struct ternary_map *tmap = map->data;
+    const uint8_t *mask = tkey->data + tmap->key_size;
+    uint8_t masked[UBPF_TERNARY_MAX_KEY];
+    struct ternary_entry *old_entry;
+    struct ternary_entry *entry;
+    struct ternary_tuple *tuple;
+    uint32_t hash;
+
+    for (uint32_t i = 0; i < tmap->key_size; i++) {
+        masked[i] = tkey->data[i] & mask[i];
+    }
+    hash = hash_bytes(masked, tmap->key_size, 0);
+
+    ovs_mutex_lock(&tmap->mutex);
+    tuple = ternary_find_tuple(tmap, mask);
+    if (!tuple) {
+        tuple = xzalloc(sizeof *tuple + tmap->key_size);
+        cmap_init(&tuple->entries);
+        tuple->max_priority = tkey->priority;
+        memcpy(tuple->mask, mask, tmap->key_size);
+        pvector_insert(&tmap->tuples, tuple, tuple->max_priority);
+    } else if ((int) tkey->priority > tuple->max_priority) {
+        tuple->max_priority = tkey->priority;
+        pvector_change_priority(&tmap->tuples, tuple, tuple->max_priority);
+    }
+
+    entry = xzalloc(sizeof *entry + ROUND_UP(tmap->key_size, 8)
+                    + tmap->value_size);
+    entry->hash = hash;
+    entry->priority = tkey->priority;
+    memcpy(entry->data, masked, tmap->key_size);
+    memcpy(ternary_entry_value(tmap, entry), value, tmap->value_size);
+
+    old_entry = ternary_find_entry(tmap, tuple, hash, masked, tkey->priority);
+    if (old_entry) {
+        cmap_replace(&tuple->entries, &old_entry->cmap_node,
+                     &entry->cmap_node, hash);
+        ovsrcu_postpone(free, old_entry);
+    } else {
+        cmap_insert(&tuple->entries, &entry->cmap_node, hash);
+        tuple->n_entries++;
+        tmap->n_entries++;
+    }
+    pvector_publish(&tmap->tuples);
+    ovs_mutex_unlock(&tmap->mutex);
+
+    return 0;
+}
+
+int
+ubpf_ternary_delete(struct ubpf_map *map, const void *key)
+{
+    const struct ubpf_ternary_key *tkey = key;
+    struct ternary_map *tmap = map->data;
+    const uint8_t *mask = tkey->data + tmap->key_size;
+    uint8_t masked[UBPF_TERNARY_MAX_KEY];
+    struct ternary_entry *entry;
+    struct ternary_tuple *tuple;
+    uint32_t hash;
+
+    for (uint32_t i = 0; i < tmap->key_size; i++) {
+        masked[i] = tkey->data[i] & mask[i];
+    }
+    hash = hash_bytes(masked, tmap->key_size, 0);
+
+    ovs_mutex_lock(&tmap->mutex);
+    tuple = ternary_find_tuple(tmap, mask);
+    entry = tuple ? ternary_find_entry(tmap, tuple, hash, masked,
+                                       tkey->priority) : NULL;
+    if (!entry) {
+        ovs_mutex_unlock(&tmap->mutex);
+        return -4;
+    }
+
+    cmap_remove(&tuple->entries, &entry->cmap_node, hash);
+    tuple->n_entries--;
+    tmap->n_entries--;
+
+    if (!tuple->n_entries) {
+        pvector_remove(&tmap->tuples, tuple);
+        ovsrcu_postpone(ternary_tuple_defer_free, tuple);
+    } else if ((int) entry->priority == tuple->max_priority) {
+        struct ternary_entry *other;
+        int max_priority = -1;
+
+        CMAP_FOR_EACH (other, cmap_node, &tuple->entries) {
+            max_priority = MAX(max_priority, (int) other->priority);
+        }
+        tuple->max_priority = max_priority;
+        pvector_change_priority(&tmap->tuples, tuple, tuple->max_priority);
+    }
+    pvector_publish(&tmap->tuples);
+    ovs_mutex_unlock(&tmap->mutex);
+    ovsrcu_postpone(free, entry);
+
+    return 0;
+}
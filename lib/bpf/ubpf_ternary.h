@@ -0,0 +1,84 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef UBPF_TERNARY_H
+#define UBPF_TERNARY_H 1
+
+#include "cmap.h"
+#include "ovs-thread.h"
+#include "pvector.h"
+
+#include "ubpf_int.h"
+
+/* Largest lookup key the ternary classifier accepts, so that the data path
+ * can mask a key on the stack instead of allocating. */
+#define UBPF_TERNARY_MAX_KEY 128
+
+void *ubpf_ternary_create(const struct ubpf_map_def *map_def);
+unsigned int ubpf_ternary_size(const struct ubpf_map *map);
+unsigned int ubpf_ternary_dump(const struct ubpf_map *map, char *data);
+void *ubpf_ternary_lookup(const struct ubpf_map *map, const void *key);
+int ubpf_ternary_update(struct ubpf_map *map, const void *key, void *value);
+int ubpf_ternary_delete(struct ubpf_map *map, const void *key);
+void ubpf_ternary_destroy(struct ubpf_map *map);
+
+/* Control-plane key for map_update and map_delete.  map_lookup takes a
+ * plain key of the map's declared key size; entries are identified by
+ * their masked value, mask and priority, so writers hand in all three:
+ * 'data' holds the value bytes followed by the mask bytes, each of the
+ * map's declared key size. */
+struct ubpf_ternary_key {
+    uint32_t priority;          /* P4Runtime priority; higher wins. */
+    uint8_t data[0];
+};
+
+/* Tuple-space classifier in the manner of lib/classifier.c: entries
+ * sharing a mask form a tuple with an exact-match cmap over their masked
+ * values, and 'tuples' orders the tuples by the highest entry priority
+ * inside each one, so a lookup walks tuples best-first and stops as soon
+ * as no remaining tuple can beat the match in hand.  Lookups are
+ * lock-free; 'mutex' only serializes writers. */
+struct ternary_map {
+    struct pvector tuples;      /* Of struct ternary_tuple. */
+    struct ovs_mutex mutex;     /* Serializes writers. */
+    uint32_t key_size;
+    uint32_t value_size;
+    uint32_t n_entries OVS_GUARDED;
+};
+
+struct ternary_tuple {
+    struct cmap entries;        /* struct ternary_entry by masked-value hash. */
+    uint32_t n_entries;
+    int max_priority;           /* This tuple's priority in 'tuples'. */
+    uint8_t mask[0];            /* key_size bytes. */
+};
+
+struct ternary_entry {
+    struct cmap_node cmap_node; /* In the owning tuple's 'entries'. */
+    uint32_t hash;
+    uint32_t priority;
+    uint8_t data[0] OVS_ALIGNED_VAR(8); /* Masked value bytes rounded up to 8,
+                                         * then value_size value bytes. */
+};
+
+static const struct ubpf_map_ops ubpf_ternary_ops = {
+    .map_size = ubpf_ternary_size,
+    .map_dump = ubpf_ternary_dump,
+    .map_lookup = ubpf_ternary_lookup,
+    .map_update = ubpf_ternary_update,
+    .map_delete = ubpf_ternary_delete,
+    .map_add = NULL,
+    .map_destroy = ubpf_ternary_destroy,
+};
+
+#endif
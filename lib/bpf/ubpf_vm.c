@@ -15,6 +15,7 @@
  */
 
 #define _GNU_SOURCE
+#include <config.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -24,9 +25,11 @@
 #include <sys/mman.h>
 #include <timeval.h>
 #include "ubpf_int.h"
-#include <config.h>
+#include "ubpf_opt.h"
+#include "bitmap.h"
 #include "openvswitch/list.h"
 #include "openvswitch/vlog.h"
+#include "ovs-thread.h"
 #include "util.h"
 
 
@@ -34,6 +37,18 @@
 #define MAX_EXT_MAPS 64
 #define NB_REGS 11
 
+/* Superinstruction opcodes: fused instruction pairs that p4c emits
+ * back-to-back, mostly in parser bounds guards.  These exist only in the
+ * interpreter's private dispatch array (vm->int_ops), never in vm->insts,
+ * so the verifier and the JITs never see them.  The low three bits are 0x6,
+ * an instruction class eBPF does not use, so they cannot collide with real
+ * opcodes. */
+#define UBPF_OP_MOV_ADD64 0x06  /* mov64 dst, src + add64 dst, imm */
+#define UBPF_OP_ADD_JGT64 0x0e  /* add64 dst, imm + jgt dst, src, +off */
+#define UBPF_OP_LDXH_BE16 0x16  /* ldxh dst, [src+off] + be16 dst */
+#define UBPF_OP_LDXW_BE32 0x1e  /* ldxw dst, [src+off] + be32 dst */
+#define UBPF_OP_LDXB_SHL8 0x26  /* ldxb dst, [src+off] + lsh64 dst, 8 */
+
 VLOG_DEFINE_THIS_MODULE(verifier);
 // #define DEBUG(...) VLOG_INFO(__VA_ARGS__)
 #define DEBUG(...)
@@ -66,6 +81,10 @@ struct bpf_state {
     struct bpf_reg_state stack[STACK_SIZE];
     uint32_t instno;
     uint64_t pkt_range;
+    uint64_t pkt_touch;     /* Furthest packet byte any access along this
+                             * path can reach; UINT64_MAX once an access
+                             * (or an unmodeled helper call) can reach an
+                             * unbounded offset. */
 };
 
 enum vertex_status {
@@ -108,6 +127,7 @@ static bool validate_jump(struct bpf_state *s, struct bpf_state *curr_state,
 static bool bounds_check(void *addr, int size, const char *type,
                          uint16_t cur_pc, void *mem, size_t mem_len,
                          void *stack);
+static void ubpf_prove_accesses(struct ubpf_vm *vm);
 
 static inline void
 mark_bpf_reg_as_unknown(struct bpf_reg_state *reg) {
@@ -145,22 +165,81 @@ ubpf_create(const ovs_be16 prog_id)
 void
 ubpf_destroy(struct ubpf_vm *vm)
 {
+    ubpf_profile_stop(vm);
     if (vm->jitted) {
         munmap(vm->jitted, vm->jitted_size);
     }
+    if (vm->jitted_batch) {
+        munmap(vm->jitted_batch, vm->jitted_batch_size);
+    }
     free(vm->insts);
+    free(vm->int_ops);
+    bitmap_free(vm->proven_access);
     free(vm->ext_funcs);
     free(vm->ext_func_names);
 
     for (int i = 0; i < vm->nb_maps; i++) {
-        vm->ext_maps[i]->ops.map_destroy(vm->ext_maps[i]);
-        free(vm->ext_maps[i]);
+        struct ubpf_map *map = vm->ext_maps[i];
+
+        if (map->staged) {
+            /* A replace transaction left open: tear the staged table down
+             * through the same destroy hook as the live one. */
+            struct ubpf_map shim = *map;
+
+            shim.data = map->staged;
+            map->ops.map_destroy(&shim);
+        }
+        if (map->numa_replicas) {
+            struct ubpf_map_replicas *replicas = map->numa_replicas;
+
+            for (int j = 0; j < replicas->n; j++) {
+                replicas->rep[j]->ops.map_destroy(replicas->rep[j]);
+                free(replicas->rep[j]);
+            }
+            free(replicas);
+        }
+        map->ops.map_destroy(map);
+        free_cacheline(map->stats);
+        free(map);
     }
     free(vm->ext_maps);
     free(vm->ext_map_names);
     free(vm);
 }
 
+/* Attaches a fresh execution profile to 'vm'.  Returns 0 on success, or a
+ * negative value if no program is loaded or a profile is already attached.
+ * See struct ubpf_profile for what gets collected and at what cost. */
+int
+ubpf_profile_start(struct ubpf_vm *vm)
+{
+    struct ubpf_profile *profile;
+
+    if (!vm->insts || ovsrcu_get(struct ubpf_profile *, &vm->profile)) {
+        return -1;
+    }
+
+    profile = xzalloc(sizeof *profile
+                      + vm->num_insts * sizeof profile->insn_samples[0]);
+    profile->num_insts = vm->num_insts;
+    ovsrcu_set(&vm->profile, profile);
+    return 0;
+}
+
+/* Detaches and frees 'vm''s execution profile, if any.  Packet handling
+ * falls back to the JIT once in-flight interpreter runs retire. */
+void
+ubpf_profile_stop(struct ubpf_vm *vm)
+{
+    struct ubpf_profile *profile;
+
+    profile = ovsrcu_get_protected(struct ubpf_profile *, &vm->profile);
+    if (profile) {
+        ovsrcu_set(&vm->profile, NULL);
+        ovsrcu_postpone(free, profile);
+    }
+}
+
 int
 ubpf_register_function(struct ubpf_vm *vm, unsigned int idx, const char *name,
                        struct ubpf_func_proto proto)
@@ -213,6 +292,60 @@ ubpf_lookup_registered_map(struct ubpf_vm *vm, const char *name)
     return NULL;
 }
 
+/* Builds the interpreter's private dispatch opcode array for 'vm'.  Each
+ * entry starts out as the instruction's own opcode; where two adjacent
+ * instructions form a fusible pair, the first entry is rewritten into a
+ * superinstruction whose handler executes both.
+ *
+ * The second instruction of a pair keeps its own entry, so a jump that
+ * lands on it still executes correctly, and vm->insts is not modified, so
+ * jump offsets stay valid and the verifier and the JITs are unaffected. */
+static void
+ubpf_build_int_ops(struct ubpf_vm *vm)
+{
+    uint8_t *ops = xmalloc(vm->num_insts);
+    uint32_t i;
+
+    for (i = 0; i < vm->num_insts; i++) {
+        ops[i] = vm->insts[i].opcode;
+    }
+
+    for (i = 0; i + 1 < vm->num_insts; i++) {
+        const struct ebpf_inst *inst = &vm->insts[i];
+        const struct ebpf_inst *next = &vm->insts[i + 1];
+
+        if (inst->opcode == EBPF_OP_LDDW) {
+            i++;                /* Skip the second half of the 16-byte load. */
+        } else if (inst->opcode == EBPF_OP_MOV64_REG
+                   && next->opcode == EBPF_OP_ADD64_IMM
+                   && next->dst == inst->dst) {
+            ops[i] = UBPF_OP_MOV_ADD64;
+        } else if (inst->opcode == EBPF_OP_ADD64_IMM
+                   && next->opcode == EBPF_OP_JGT_REG
+                   && next->dst == inst->dst) {
+            ops[i] = UBPF_OP_ADD_JGT64;
+        } else if (inst->opcode == EBPF_OP_LDXH
+                   && next->opcode == EBPF_OP_BE
+                   && next->dst == inst->dst && next->imm == 16) {
+            /* Parser field extraction: a 16-bit header load straight into
+             * host order, e.g. an ethertype or an L4 port. */
+            ops[i] = UBPF_OP_LDXH_BE16;
+        } else if (inst->opcode == EBPF_OP_LDXW
+                   && next->opcode == EBPF_OP_BE
+                   && next->dst == inst->dst && next->imm == 32) {
+            ops[i] = UBPF_OP_LDXW_BE32;
+        } else if (inst->opcode == EBPF_OP_LDXB
+                   && next->opcode == EBPF_OP_LSH64_IMM
+                   && next->dst == inst->dst && next->imm == 8) {
+            /* First step of a byte-at-a-time field gather. */
+            ops[i] = UBPF_OP_LDXB_SHL8;
+        }
+    }
+
+    free(vm->int_ops);
+    vm->int_ops = ops;
+}
+
 int
 ubpf_load(struct ubpf_vm *vm, const void *code, uint32_t code_len, char **errmsg)
 {
@@ -240,6 +373,23 @@ ubpf_load(struct ubpf_vm *vm, const void *code, uint32_t code_len, char **errmsg
     memcpy(vm->insts, code, code_len);
     vm->num_insts = code_len/sizeof(vm->insts[0]);
 
+    /* Callers lay out packet metadata differently for programs that can
+     * move the packet start, so note up front whether this one can. */
+    vm->uses_adjust_head = false;
+    for (uint32_t i = 0; i < vm->num_insts; i++) {
+        if (vm->insts[i].opcode == EBPF_OP_LDDW) {
+            i++;
+        } else if (vm->insts[i].opcode == EBPF_OP_CALL
+                   && vm->insts[i].imm == UBPF_ADJUST_HEAD_ID) {
+            vm->uses_adjust_head = true;
+            break;
+        }
+    }
+
+    ubpf_optimize(vm);
+    ubpf_prove_accesses(vm);
+    ubpf_build_int_ops(vm);
+
     vm->loaded_at = (unsigned long long int) time_wall_msec();
 
     return 0;
@@ -251,136 +401,262 @@ u32(uint64_t x)
     return x;
 }
 
+/* Interpreter dispatch.
+ *
+ * With GCC or Clang the interpreter uses threaded code: every handler ends
+ * by fetching the next instruction and jumping straight to its handler
+ * through a table of label addresses, so each opcode's indirect branch gets
+ * its own predictor slot instead of all of them funnelling through one
+ * shared switch dispatch.  Other compilers (and sparse) fall back to the
+ * plain switch.  The handlers share one spelling for both modes: OP() emits
+ * the goto label next to the case label, and NEXT either threads to the next
+ * handler or breaks back to the switch. */
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(__CHECKER__)
+#define UBPF_THREADED_EXEC 1
+#endif
+
+static inline void
+ubpf_profile_sample(struct ubpf_profile *profile, uint16_t cur_pc)
+{
+    uint64_t orig;
+    atomic_add_relaxed(&profile->insn_samples[cur_pc], 1, &orig);
+}
+
+/* Program-counter sampling for an attached execution profile.  Expanded
+ * in the dispatch path, so it relies on ubpf_exec()'s 'profile',
+ * 'profile_tick' and 'cur_pc' locals. */
+#define PROFILE_SAMPLE()                                                \
+    do {                                                                \
+        if (OVS_UNLIKELY(profile != NULL)                               \
+            && !(++profile_tick                                         \
+                 & (UBPF_PROFILE_SAMPLE_INTERVAL - 1))) {               \
+            ubpf_profile_sample(profile, cur_pc);                       \
+        }                                                               \
+    } while (0)
+
+#ifdef UBPF_THREADED_EXEC
+#define OP(OPCODE) do_##OPCODE: case OPCODE
+#define OP_DEFAULT do_default: default
+#define NEXT                                    \
+    do {                                        \
+        cur_pc = pc;                            \
+        inst = insts[pc++];                     \
+        PROFILE_SAMPLE();                       \
+        goto *dispatch[ops[cur_pc]];            \
+    } while (0)
+#else
+#define OP(OPCODE) case OPCODE
+#define OP_DEFAULT default
+#define NEXT break
+#endif
+
+/* Every opcode the interpreter handles, for building the dispatch table.
+ * Must match the OP() handlers in ubpf_exec() exactly. */
+#define UBPF_OP_LIST                                                    \
+    UBPF_OP(EBPF_OP_ADD_IMM)    UBPF_OP(EBPF_OP_ADD_REG)                \
+    UBPF_OP(EBPF_OP_SUB_IMM)    UBPF_OP(EBPF_OP_SUB_REG)                \
+    UBPF_OP(EBPF_OP_MUL_IMM)    UBPF_OP(EBPF_OP_MUL_REG)                \
+    UBPF_OP(EBPF_OP_DIV_IMM)    UBPF_OP(EBPF_OP_DIV_REG)                \
+    UBPF_OP(EBPF_OP_OR_IMM)     UBPF_OP(EBPF_OP_OR_REG)                 \
+    UBPF_OP(EBPF_OP_AND_IMM)    UBPF_OP(EBPF_OP_AND_REG)                \
+    UBPF_OP(EBPF_OP_LSH_IMM)    UBPF_OP(EBPF_OP_LSH_REG)                \
+    UBPF_OP(EBPF_OP_RSH_IMM)    UBPF_OP(EBPF_OP_RSH_REG)                \
+    UBPF_OP(EBPF_OP_NEG)                                                \
+    UBPF_OP(EBPF_OP_MOD_IMM)    UBPF_OP(EBPF_OP_MOD_REG)                \
+    UBPF_OP(EBPF_OP_XOR_IMM)    UBPF_OP(EBPF_OP_XOR_REG)                \
+    UBPF_OP(EBPF_OP_MOV_IMM)    UBPF_OP(EBPF_OP_MOV_REG)                \
+    UBPF_OP(EBPF_OP_ARSH_IMM)   UBPF_OP(EBPF_OP_ARSH_REG)               \
+    UBPF_OP(EBPF_OP_LE)         UBPF_OP(EBPF_OP_BE)                     \
+    UBPF_OP(EBPF_OP_ADD64_IMM)  UBPF_OP(EBPF_OP_ADD64_REG)              \
+    UBPF_OP(EBPF_OP_SUB64_IMM)  UBPF_OP(EBPF_OP_SUB64_REG)              \
+    UBPF_OP(EBPF_OP_MUL64_IMM)  UBPF_OP(EBPF_OP_MUL64_REG)              \
+    UBPF_OP(EBPF_OP_DIV64_IMM)  UBPF_OP(EBPF_OP_DIV64_REG)              \
+    UBPF_OP(EBPF_OP_OR64_IMM)   UBPF_OP(EBPF_OP_OR64_REG)               \
+    UBPF_OP(EBPF_OP_AND64_IMM)  UBPF_OP(EBPF_OP_AND64_REG)              \
+    UBPF_OP(EBPF_OP_LSH64_IMM)  UBPF_OP(EBPF_OP_LSH64_REG)              \
+    UBPF_OP(EBPF_OP_RSH64_IMM)  UBPF_OP(EBPF_OP_RSH64_REG)              \
+    UBPF_OP(EBPF_OP_NEG64)                                              \
+    UBPF_OP(EBPF_OP_MOD64_IMM)  UBPF_OP(EBPF_OP_MOD64_REG)              \
+    UBPF_OP(EBPF_OP_XOR64_IMM)  UBPF_OP(EBPF_OP_XOR64_REG)              \
+    UBPF_OP(EBPF_OP_MOV64_IMM)  UBPF_OP(EBPF_OP_MOV64_REG)              \
+    UBPF_OP(EBPF_OP_ARSH64_IMM) UBPF_OP(EBPF_OP_ARSH64_REG)             \
+    UBPF_OP(EBPF_OP_LDXW)       UBPF_OP(EBPF_OP_LDXH)                   \
+    UBPF_OP(EBPF_OP_LDXB)       UBPF_OP(EBPF_OP_LDXDW)                  \
+    UBPF_OP(EBPF_OP_STW)        UBPF_OP(EBPF_OP_STH)                    \
+    UBPF_OP(EBPF_OP_STB)        UBPF_OP(EBPF_OP_STDW)                   \
+    UBPF_OP(EBPF_OP_STXW)       UBPF_OP(EBPF_OP_STXH)                   \
+    UBPF_OP(EBPF_OP_STXB)       UBPF_OP(EBPF_OP_STXDW)                  \
+    UBPF_OP(EBPF_OP_LDDW)                                               \
+    UBPF_OP(EBPF_OP_JA)                                                 \
+    UBPF_OP(EBPF_OP_JEQ_IMM)    UBPF_OP(EBPF_OP_JEQ_REG)                \
+    UBPF_OP(EBPF_OP_JGT_IMM)    UBPF_OP(EBPF_OP_JGT_REG)                \
+    UBPF_OP(EBPF_OP_JGE_IMM)    UBPF_OP(EBPF_OP_JGE_REG)                \
+    UBPF_OP(EBPF_OP_JSET_IMM)   UBPF_OP(EBPF_OP_JSET_REG)               \
+    UBPF_OP(EBPF_OP_JNE_IMM)    UBPF_OP(EBPF_OP_JNE_REG)                \
+    UBPF_OP(EBPF_OP_JSGT_IMM)   UBPF_OP(EBPF_OP_JSGT_REG)               \
+    UBPF_OP(EBPF_OP_JSGE_IMM)   UBPF_OP(EBPF_OP_JSGE_REG)               \
+    UBPF_OP(EBPF_OP_EXIT)       UBPF_OP(EBPF_OP_CALL)                   \
+    UBPF_OP(UBPF_OP_MOV_ADD64)  UBPF_OP(UBPF_OP_ADD_JGT64)              \
+    UBPF_OP(UBPF_OP_LDXH_BE16)  UBPF_OP(UBPF_OP_LDXW_BE32)              \
+    UBPF_OP(UBPF_OP_LDXB_SHL8)
+
 uint64_t
 ubpf_exec(const struct ubpf_vm *vm, void *mem, size_t mem_len)
 {
     uint16_t pc = 0;
     const struct ebpf_inst *insts = vm->insts;
+    const uint8_t *ops = vm->int_ops;
+    const unsigned long *proven = vm->proven_access;
     uint64_t reg[16];
     uint64_t stack[(STACK_SIZE+7)/8];
+    uint16_t cur_pc;
+    struct ebpf_inst inst;
+    struct ubpf_profile *profile = ovsrcu_get(struct ubpf_profile *,
+                                              &vm->profile);
+    uint32_t profile_tick = 0;
 
     if (!insts) {
         /* Code must be loaded before we can execute */
         return UINT64_MAX;
     }
 
+#ifdef UBPF_THREADED_EXEC
+    static struct ovsthread_once dispatch_once = OVSTHREAD_ONCE_INITIALIZER;
+    static const void *dispatch[UINT8_MAX + 1];
+
+    if (ovsthread_once_start(&dispatch_once)) {
+        for (size_t i = 0; i < ARRAY_SIZE(dispatch); i++) {
+            dispatch[i] = &&do_default;
+        }
+#define UBPF_OP(OPCODE) dispatch[OPCODE] = &&do_##OPCODE;
+        UBPF_OP_LIST
+#undef UBPF_OP
+        ovsthread_once_done(&dispatch_once);
+    }
+#endif
+
+    /* R2 carries the second argument, so calling ubpf_exec(vm, mem, md)
+     * with a metadata pointer cast through 'mem_len' is equivalent to
+     * entering the program through the JIT's (mem, md) convention. */
     reg[1] = (uintptr_t)mem;
+    reg[2] = (uint64_t)mem_len;
     reg[10] = (uintptr_t)stack + sizeof(stack);
 
     while (1) {
-        const uint16_t cur_pc = pc;
-        struct ebpf_inst inst = insts[pc++];
+        cur_pc = pc;
+        inst = insts[pc++];
+        PROFILE_SAMPLE();
 
-        switch (inst.opcode) {
-        case EBPF_OP_ADD_IMM:
+        switch (ops[cur_pc]) {
+        OP(EBPF_OP_ADD_IMM):
             reg[inst.dst] += inst.imm;
             reg[inst.dst] &= UINT32_MAX;
-            break;
-        case EBPF_OP_ADD_REG:
+            NEXT;
+        OP(EBPF_OP_ADD_REG):
             reg[inst.dst] += reg[inst.src];
             reg[inst.dst] &= UINT32_MAX;
-            break;
-        case EBPF_OP_SUB_IMM:
+            NEXT;
+        OP(EBPF_OP_SUB_IMM):
             reg[inst.dst] -= inst.imm;
             reg[inst.dst] &= UINT32_MAX;
-            break;
-        case EBPF_OP_SUB_REG:
+            NEXT;
+        OP(EBPF_OP_SUB_REG):
             reg[inst.dst] -= reg[inst.src];
             reg[inst.dst] &= UINT32_MAX;
-            break;
-        case EBPF_OP_MUL_IMM:
+            NEXT;
+        OP(EBPF_OP_MUL_IMM):
             reg[inst.dst] *= inst.imm;
             reg[inst.dst] &= UINT32_MAX;
-            break;
-        case EBPF_OP_MUL_REG:
+            NEXT;
+        OP(EBPF_OP_MUL_REG):
             reg[inst.dst] *= reg[inst.src];
             reg[inst.dst] &= UINT32_MAX;
-            break;
-        case EBPF_OP_DIV_IMM:
+            NEXT;
+        OP(EBPF_OP_DIV_IMM):
             reg[inst.dst] = u32(reg[inst.dst]) / u32(inst.imm);
             reg[inst.dst] &= UINT32_MAX;
-            break;
-        case EBPF_OP_DIV_REG:
+            NEXT;
+        OP(EBPF_OP_DIV_REG):
             if (reg[inst.src] == 0) {
                 fprintf(stderr, "uBPF error: division by zero at PC %u\n", cur_pc);
                 return UINT64_MAX;
             }
             reg[inst.dst] = u32(reg[inst.dst]) / u32(reg[inst.src]);
             reg[inst.dst] &= UINT32_MAX;
-            break;
-        case EBPF_OP_OR_IMM:
+            NEXT;
+        OP(EBPF_OP_OR_IMM):
             reg[inst.dst] |= inst.imm;
             reg[inst.dst] &= UINT32_MAX;
-            break;
-        case EBPF_OP_OR_REG:
+            NEXT;
+        OP(EBPF_OP_OR_REG):
             reg[inst.dst] |= reg[inst.src];
             reg[inst.dst] &= UINT32_MAX;
-            break;
-        case EBPF_OP_AND_IMM:
+            NEXT;
+        OP(EBPF_OP_AND_IMM):
             reg[inst.dst] &= inst.imm;
             reg[inst.dst] &= UINT32_MAX;
-            break;
-        case EBPF_OP_AND_REG:
+            NEXT;
+        OP(EBPF_OP_AND_REG):
             reg[inst.dst] &= reg[inst.src];
             reg[inst.dst] &= UINT32_MAX;
-            break;
-        case EBPF_OP_LSH_IMM:
+            NEXT;
+        OP(EBPF_OP_LSH_IMM):
             reg[inst.dst] <<= inst.imm;
             reg[inst.dst] &= UINT32_MAX;
-            break;
-        case EBPF_OP_LSH_REG:
+            NEXT;
+        OP(EBPF_OP_LSH_REG):
             reg[inst.dst] <<= reg[inst.src];
             reg[inst.dst] &= UINT32_MAX;
-            break;
-        case EBPF_OP_RSH_IMM:
+            NEXT;
+        OP(EBPF_OP_RSH_IMM):
             reg[inst.dst] = u32(reg[inst.dst]) >> inst.imm;
             reg[inst.dst] &= UINT32_MAX;
-            break;
-        case EBPF_OP_RSH_REG:
+            NEXT;
+        OP(EBPF_OP_RSH_REG):
             reg[inst.dst] = u32(reg[inst.dst]) >> reg[inst.src];
             reg[inst.dst] &= UINT32_MAX;
-            break;
-        case EBPF_OP_NEG:
+            NEXT;
+        OP(EBPF_OP_NEG):
             reg[inst.dst] = -reg[inst.dst];
             reg[inst.dst] &= UINT32_MAX;
-            break;
-        case EBPF_OP_MOD_IMM:
+            NEXT;
+        OP(EBPF_OP_MOD_IMM):
             reg[inst.dst] = u32(reg[inst.dst]) % u32(inst.imm);
             reg[inst.dst] &= UINT32_MAX;
-            break;
-        case EBPF_OP_MOD_REG:
+            NEXT;
+        OP(EBPF_OP_MOD_REG):
             if (reg[inst.src] == 0) {
                 fprintf(stderr, "uBPF error: division by zero at PC %u\n", cur_pc);
                 return UINT64_MAX;
             }
             reg[inst.dst] = u32(reg[inst.dst]) % u32(reg[inst.src]);
-            break;
-        case EBPF_OP_XOR_IMM:
+            NEXT;
+        OP(EBPF_OP_XOR_IMM):
             reg[inst.dst] ^= inst.imm;
             reg[inst.dst] &= UINT32_MAX;
-            break;
-        case EBPF_OP_XOR_REG:
+            NEXT;
+        OP(EBPF_OP_XOR_REG):
             reg[inst.dst] ^= reg[inst.src];
             reg[inst.dst] &= UINT32_MAX;
-            break;
-        case EBPF_OP_MOV_IMM:
+            NEXT;
+        OP(EBPF_OP_MOV_IMM):
             reg[inst.dst] = inst.imm;
             reg[inst.dst] &= UINT32_MAX;
-            break;
-        case EBPF_OP_MOV_REG:
+            NEXT;
+        OP(EBPF_OP_MOV_REG):
             reg[inst.dst] = reg[inst.src];
             reg[inst.dst] &= UINT32_MAX;
-            break;
-        case EBPF_OP_ARSH_IMM:
+            NEXT;
+        OP(EBPF_OP_ARSH_IMM):
             reg[inst.dst] = (int32_t)reg[inst.dst] >> inst.imm;
             reg[inst.dst] &= UINT32_MAX;
-            break;
-        case EBPF_OP_ARSH_REG:
+            NEXT;
+        OP(EBPF_OP_ARSH_REG):
             reg[inst.dst] = (int32_t)reg[inst.dst] >> u32(reg[inst.src]);
             reg[inst.dst] &= UINT32_MAX;
-            break;
+            NEXT;
 
-        case EBPF_OP_LE:
+        OP(EBPF_OP_LE):
             if (inst.imm == 16) {
                 reg[inst.dst] = htole16(reg[inst.dst]);
             } else if (inst.imm == 32) {
@@ -388,8 +664,8 @@ ubpf_exec(const struct ubpf_vm *vm, void *mem, size_t mem_len)
             } else if (inst.imm == 64) {
                 reg[inst.dst] = htole64(reg[inst.dst]);
             }
-            break;
-        case EBPF_OP_BE:
+            NEXT;
+        OP(EBPF_OP_BE):
             if (inst.imm == 16) {
                 reg[inst.dst] = htobe16(reg[inst.dst]);
             } else if (inst.imm == 32) {
@@ -397,244 +673,291 @@ ubpf_exec(const struct ubpf_vm *vm, void *mem, size_t mem_len)
             } else if (inst.imm == 64) {
                 reg[inst.dst] = htobe64(reg[inst.dst]);
             }
-            break;
+            NEXT;
 
 
-        case EBPF_OP_ADD64_IMM:
+        OP(EBPF_OP_ADD64_IMM):
             reg[inst.dst] += inst.imm;
-            break;
-        case EBPF_OP_ADD64_REG:
+            NEXT;
+        OP(EBPF_OP_ADD64_REG):
             reg[inst.dst] += reg[inst.src];
-            break;
-        case EBPF_OP_SUB64_IMM:
+            NEXT;
+        OP(EBPF_OP_SUB64_IMM):
             reg[inst.dst] -= inst.imm;
-            break;
-        case EBPF_OP_SUB64_REG:
+            NEXT;
+        OP(EBPF_OP_SUB64_REG):
             reg[inst.dst] -= reg[inst.src];
-            break;
-        case EBPF_OP_MUL64_IMM:
+            NEXT;
+        OP(EBPF_OP_MUL64_IMM):
             reg[inst.dst] *= inst.imm;
-            break;
-        case EBPF_OP_MUL64_REG:
+            NEXT;
+        OP(EBPF_OP_MUL64_REG):
             reg[inst.dst] *= reg[inst.src];
-            break;
-        case EBPF_OP_DIV64_IMM:
+            NEXT;
+        OP(EBPF_OP_DIV64_IMM):
             reg[inst.dst] /= inst.imm;
-            break;
-        case EBPF_OP_DIV64_REG:
+            NEXT;
+        OP(EBPF_OP_DIV64_REG):
             if (reg[inst.src] == 0) {
                 fprintf(stderr, "uBPF error: division by zero at PC %u\n", cur_pc);
                 return UINT64_MAX;
             }
             reg[inst.dst] /= reg[inst.src];
-            break;
-        case EBPF_OP_OR64_IMM:
+            NEXT;
+        OP(EBPF_OP_OR64_IMM):
             reg[inst.dst] |= inst.imm;
-            break;
-        case EBPF_OP_OR64_REG:
+            NEXT;
+        OP(EBPF_OP_OR64_REG):
             reg[inst.dst] |= reg[inst.src];
-            break;
-        case EBPF_OP_AND64_IMM:
+            NEXT;
+        OP(EBPF_OP_AND64_IMM):
             reg[inst.dst] &= inst.imm;
-            break;
-        case EBPF_OP_AND64_REG:
+            NEXT;
+        OP(EBPF_OP_AND64_REG):
             reg[inst.dst] &= reg[inst.src];
-            break;
-        case EBPF_OP_LSH64_IMM:
+            NEXT;
+        OP(EBPF_OP_LSH64_IMM):
             reg[inst.dst] <<= inst.imm;
-            break;
-        case EBPF_OP_LSH64_REG:
+            NEXT;
+        OP(EBPF_OP_LSH64_REG):
             reg[inst.dst] <<= reg[inst.src];
-            break;
-        case EBPF_OP_RSH64_IMM:
+            NEXT;
+        OP(EBPF_OP_RSH64_IMM):
             reg[inst.dst] >>= inst.imm;
-            break;
-        case EBPF_OP_RSH64_REG:
+            NEXT;
+        OP(EBPF_OP_RSH64_REG):
             reg[inst.dst] >>= reg[inst.src];
-            break;
-        case EBPF_OP_NEG64:
+            NEXT;
+        OP(EBPF_OP_NEG64):
             reg[inst.dst] = -reg[inst.dst];
-            break;
-        case EBPF_OP_MOD64_IMM:
+            NEXT;
+        OP(EBPF_OP_MOD64_IMM):
             reg[inst.dst] %= inst.imm;
-            break;
-        case EBPF_OP_MOD64_REG:
+            NEXT;
+        OP(EBPF_OP_MOD64_REG):
             if (reg[inst.src] == 0) {
                 fprintf(stderr, "uBPF error: division by zero at PC %u\n", cur_pc);
                 return UINT64_MAX;
             }
             reg[inst.dst] %= reg[inst.src];
-            break;
-        case EBPF_OP_XOR64_IMM:
+            NEXT;
+        OP(EBPF_OP_XOR64_IMM):
             reg[inst.dst] ^= inst.imm;
-            break;
-        case EBPF_OP_XOR64_REG:
+            NEXT;
+        OP(EBPF_OP_XOR64_REG):
             reg[inst.dst] ^= reg[inst.src];
-            break;
-        case EBPF_OP_MOV64_IMM:
+            NEXT;
+        OP(EBPF_OP_MOV64_IMM):
             reg[inst.dst] = inst.imm;
-            break;
-        case EBPF_OP_MOV64_REG:
+            NEXT;
+        OP(EBPF_OP_MOV64_REG):
             reg[inst.dst] = reg[inst.src];
-            break;
-        case EBPF_OP_ARSH64_IMM:
+            NEXT;
+        OP(EBPF_OP_ARSH64_IMM):
             reg[inst.dst] = (int64_t)reg[inst.dst] >> inst.imm;
-            break;
-        case EBPF_OP_ARSH64_REG:
+            NEXT;
+        OP(EBPF_OP_ARSH64_REG):
             reg[inst.dst] = (int64_t)reg[inst.dst] >> reg[inst.src];
-            break;
+            NEXT;
 
         /*
-         * HACK runtime bounds check
-         *
-         * Needed since we don't have a verifier yet.
+         * Runtime bounds check, skipped for accesses that
+         * ubpf_prove_accesses() proved in bounds at load time.
          */
 #define BOUNDS_CHECK_LOAD(size) \
     do { \
-        if (!bounds_check((void *)(reg[inst.src] + inst.offset), size, "load", cur_pc, mem, mem_len, stack)) { \
+        if (!(proven && bitmap_is_set(proven, cur_pc)) \
+            && !bounds_check((void *)(reg[inst.src] + inst.offset), size, "load", cur_pc, mem, mem_len, stack)) { \
             return UINT64_MAX; \
         } \
     } while (0)
 #define BOUNDS_CHECK_STORE(size) \
     do { \
-        if (!bounds_check((void *)(reg[inst.dst] + inst.offset), size, "store", cur_pc, mem, mem_len, stack)) { \
+        if (!(proven && bitmap_is_set(proven, cur_pc)) \
+            && !bounds_check((void *)(reg[inst.dst] + inst.offset), size, "store", cur_pc, mem, mem_len, stack)) { \
             return UINT64_MAX; \
         } \
     } while (0)
 
-        case EBPF_OP_LDXW:
+        OP(EBPF_OP_LDXW):
             BOUNDS_CHECK_LOAD(4);
             reg[inst.dst] = *(uint32_t *)(uintptr_t)(reg[inst.src] + inst.offset);
-            break;
-        case EBPF_OP_LDXH:
+            NEXT;
+        OP(EBPF_OP_LDXH):
             BOUNDS_CHECK_LOAD(2);
             reg[inst.dst] = *(uint16_t *)(uintptr_t)(reg[inst.src] + inst.offset);
-            break;
-        case EBPF_OP_LDXB:
+            NEXT;
+        OP(EBPF_OP_LDXB):
             BOUNDS_CHECK_LOAD(1);
             reg[inst.dst] = *(uint8_t *)(uintptr_t)(reg[inst.src] + inst.offset);
-            break;
-        case EBPF_OP_LDXDW:
+            NEXT;
+        OP(EBPF_OP_LDXDW):
             BOUNDS_CHECK_LOAD(8);
             reg[inst.dst] = *(uint64_t *)(uintptr_t)(reg[inst.src] + inst.offset);
-            break;
+            NEXT;
 
-        case EBPF_OP_STW:
+        OP(EBPF_OP_STW):
             BOUNDS_CHECK_STORE(4);
             *(uint32_t *)(uintptr_t)(reg[inst.dst] + inst.offset) = inst.imm;
-            break;
-        case EBPF_OP_STH:
+            NEXT;
+        OP(EBPF_OP_STH):
             BOUNDS_CHECK_STORE(2);
             *(uint16_t *)(uintptr_t)(reg[inst.dst] + inst.offset) = inst.imm;
-            break;
-        case EBPF_OP_STB:
+            NEXT;
+        OP(EBPF_OP_STB):
             BOUNDS_CHECK_STORE(1);
             *(uint8_t *)(uintptr_t)(reg[inst.dst] + inst.offset) = inst.imm;
-            break;
-        case EBPF_OP_STDW:
+            NEXT;
+        OP(EBPF_OP_STDW):
             BOUNDS_CHECK_STORE(8);
             *(uint64_t *)(uintptr_t)(reg[inst.dst] + inst.offset) = inst.imm;
-            break;
+            NEXT;
 
-        case EBPF_OP_STXW:
+        OP(EBPF_OP_STXW):
             BOUNDS_CHECK_STORE(4);
             *(uint32_t *)(uintptr_t)(reg[inst.dst] + inst.offset) = reg[inst.src];
-            break;
-        case EBPF_OP_STXH:
+            NEXT;
+        OP(EBPF_OP_STXH):
             BOUNDS_CHECK_STORE(2);
             *(uint16_t *)(uintptr_t)(reg[inst.dst] + inst.offset) = reg[inst.src];
-            break;
-        case EBPF_OP_STXB:
+            NEXT;
+        OP(EBPF_OP_STXB):
             BOUNDS_CHECK_STORE(1);
             *(uint8_t *)(uintptr_t)(reg[inst.dst] + inst.offset) = reg[inst.src];
-            break;
-        case EBPF_OP_STXDW:
+            NEXT;
+        OP(EBPF_OP_STXDW):
             BOUNDS_CHECK_STORE(8);
             *(uint64_t *)(uintptr_t)(reg[inst.dst] + inst.offset) = reg[inst.src];
-            break;
+            NEXT;
 
-        case EBPF_OP_LDDW:
+        OP(EBPF_OP_LDDW):
             reg[inst.dst] = (uint32_t)inst.imm | ((uint64_t)insts[pc++].imm << 32);
-            break;
+            NEXT;
 
-        case EBPF_OP_JA:
+        OP(EBPF_OP_JA):
             pc += inst.offset;
-            break;
-        case EBPF_OP_JEQ_IMM:
+            NEXT;
+        OP(EBPF_OP_JEQ_IMM):
             if (reg[inst.dst] == inst.imm) {
                 pc += inst.offset;
             }
-            break;
-        case EBPF_OP_JEQ_REG:
+            NEXT;
+        OP(EBPF_OP_JEQ_REG):
             if (reg[inst.dst] == reg[inst.src]) {
                 pc += inst.offset;
             }
-            break;
-        case EBPF_OP_JGT_IMM:
+            NEXT;
+        OP(EBPF_OP_JGT_IMM):
             if (reg[inst.dst] > (uint32_t)inst.imm) {
                 pc += inst.offset;
             }
-            break;
-        case EBPF_OP_JGT_REG:
+            NEXT;
+        OP(EBPF_OP_JGT_REG):
             if (reg[inst.dst] > reg[inst.src]) {
                 pc += inst.offset;
             }
-            break;
-        case EBPF_OP_JGE_IMM:
+            NEXT;
+        OP(EBPF_OP_JGE_IMM):
             if (reg[inst.dst] >= (uint32_t)inst.imm) {
                 pc += inst.offset;
             }
-            break;
-        case EBPF_OP_JGE_REG:
+            NEXT;
+        OP(EBPF_OP_JGE_REG):
             if (reg[inst.dst] >= reg[inst.src]) {
                 pc += inst.offset;
             }
-            break;
-        case EBPF_OP_JSET_IMM:
+            NEXT;
+        OP(EBPF_OP_JSET_IMM):
             if (reg[inst.dst] & inst.imm) {
                 pc += inst.offset;
             }
-            break;
-        case EBPF_OP_JSET_REG:
+            NEXT;
+        OP(EBPF_OP_JSET_REG):
             if (reg[inst.dst] & reg[inst.src]) {
                 pc += inst.offset;
             }
-            break;
-        case EBPF_OP_JNE_IMM:
+            NEXT;
+        OP(EBPF_OP_JNE_IMM):
             if (reg[inst.dst] != inst.imm) {
                 pc += inst.offset;
             }
-            break;
-        case EBPF_OP_JNE_REG:
+            NEXT;
+        OP(EBPF_OP_JNE_REG):
             if (reg[inst.dst] != reg[inst.src]) {
                 pc += inst.offset;
             }
-            break;
-        case EBPF_OP_JSGT_IMM:
+            NEXT;
+        OP(EBPF_OP_JSGT_IMM):
             if ((int64_t)reg[inst.dst] > inst.imm) {
                 pc += inst.offset;
             }
-            break;
-        case EBPF_OP_JSGT_REG:
+            NEXT;
+        OP(EBPF_OP_JSGT_REG):
             if ((int64_t)reg[inst.dst] > (int64_t)reg[inst.src]) {
                 pc += inst.offset;
             }
-            break;
-        case EBPF_OP_JSGE_IMM:
+            NEXT;
+        OP(EBPF_OP_JSGE_IMM):
             if ((int64_t)reg[inst.dst] >= inst.imm) {
                 pc += inst.offset;
             }
-            break;
-        case EBPF_OP_JSGE_REG:
+            NEXT;
+        OP(EBPF_OP_JSGE_REG):
             if ((int64_t)reg[inst.dst] >= (int64_t)reg[inst.src]) {
                 pc += inst.offset;
             }
-            break;
-        case EBPF_OP_EXIT:
+            NEXT;
+        OP(EBPF_OP_EXIT):
             return reg[0];
-        case EBPF_OP_CALL:
+        OP(EBPF_OP_CALL):
+            if (OVS_UNLIKELY(profile != NULL)
+                && inst.imm < UBPF_PROFILE_MAX_HELPERS) {
+                uint64_t orig;
+                atomic_add_relaxed(&profile->helper_calls[inst.imm], 1,
+                                   &orig);
+            }
             reg[0] = vm->ext_funcs[inst.imm].func(reg[1], reg[2], reg[3], reg[4], reg[5]);
-            break;
+            NEXT;
+
+        /* Superinstructions.  ubpf_build_int_ops() rewrites the dispatch
+         * opcode of the first instruction of a fusible pair; the handler
+         * consumes both underlying instructions. */
+        OP(UBPF_OP_MOV_ADD64): {        /* mov64 dst, src + add64 dst, imm */
+            const struct ebpf_inst inst2 = insts[pc++];
+
+            reg[inst.dst] = reg[inst.src] + inst2.imm;
+            NEXT;
+        }
+        OP(UBPF_OP_ADD_JGT64): {        /* add64 dst, imm + jgt dst, src */
+            const struct ebpf_inst inst2 = insts[pc++];
+
+            reg[inst.dst] += inst.imm;
+            if (reg[inst.dst] > reg[inst2.src]) {
+                pc += inst2.offset;
+            }
+            NEXT;
+        }
+        OP(UBPF_OP_LDXH_BE16):          /* ldxh dst, [src+off] + be16 dst */
+            BOUNDS_CHECK_LOAD(2);
+            reg[inst.dst] =
+                htobe16(*(uint16_t *)(uintptr_t)(reg[inst.src] + inst.offset));
+            pc++;
+            NEXT;
+        OP(UBPF_OP_LDXW_BE32):          /* ldxw dst, [src+off] + be32 dst */
+            BOUNDS_CHECK_LOAD(4);
+            reg[inst.dst] =
+                htobe32(*(uint32_t *)(uintptr_t)(reg[inst.src] + inst.offset));
+            pc++;
+            NEXT;
+        OP(UBPF_OP_LDXB_SHL8):          /* ldxb dst, [src+off] + lsh64 dst, 8 */
+            BOUNDS_CHECK_LOAD(1);
+            reg[inst.dst] = (uint64_t)
+                *(uint8_t *)(uintptr_t)(reg[inst.src] + inst.offset) << 8;
+            pc++;
+            NEXT;
+
+        OP_DEFAULT:
+            NEXT;
         }
     }
 }
@@ -763,6 +1086,12 @@ validate_call(const struct ubpf_vm *vm, struct bpf_state *state,
             max_val = reg->u.max;
             switch (reg->type) {
                 case PKT_PTR:
+                    if (max_val >= REGISTER_MAX_RANGE) {
+                        state->pkt_touch = UINT64_MAX;
+                    } else {
+                        state->pkt_touch = MAX(state->pkt_touch,
+                                               max_val + size);
+                    }
                     if (min_val < 0 || size + max_val > state->pkt_range) {
                         *errmsg = ubpf_error("invalid access to packet (%d +"
                                              " %d > %d) at PC %d", max_val,
@@ -1476,6 +1805,18 @@ validate_mem_access(struct bpf_state *state, uint8_t regno,
             min_val = state->regs[regno].s.min;
             max_val = state->regs[regno].u.max;
 
+            /* Remember the furthest packet byte this access can reach.
+             * The runtime guard keeps every access inside the actual
+             * packet, so an offset the model cannot bound just means
+             * "anywhere in the packet". */
+            if (max_val >= REGISTER_MAX_RANGE) {
+                state->pkt_touch = UINT64_MAX;
+            } else if ((int64_t) max_val + inst->offset + size > 0) {
+                state->pkt_touch = MAX(state->pkt_touch,
+                                       (uint64_t) ((int64_t) max_val
+                                                   + inst->offset + size));
+            }
+
             DEBUG("\t%d + %lu + %d < %lu\n", inst->offset, max_val, size, state->pkt_range);
             if (inst->offset + min_val < 0
                 || inst->offset + max_val + size > state->pkt_range) {
@@ -1684,6 +2025,233 @@ validate_accesses(const struct ubpf_vm *vm,
     return true;
 }
 
+/* Advisory bounds-proof pass.
+ *
+ * Runs the verifier's abstract interpretation over the loaded program and
+ * records, per instruction, whether every path reaching a load or store
+ * proves the access in bounds.  ubpf_exec() skips its runtime bounds_check()
+ * for proven accesses.  Unlike validate(), this pass never rejects a
+ * program: an access it cannot prove simply keeps its runtime guard, and if
+ * the program does not fit the verifier's model at all the proofs are
+ * discarded and every guard stays.
+ *
+ * Only stack and map-value accesses are recorded.  Those proofs depend only
+ * on R10 and on the helpers' return contracts, which ubpf_exec() honors.
+ * Packet-pointer proofs would additionally require R2 to hold the packet
+ * length on entry, which this runtime's calling convention does not
+ * guarantee, so packet accesses always keep their guard.
+ *
+ * The same walk also derives the program's parse depth: the furthest
+ * packet byte any path can read.  Packet offsets are immediates (or
+ * immediate-bounded values) in compiled parsers, so the bound is usually
+ * exact, and dpif-ubpf uses it to shrink the action cache key to the
+ * prefix the program can actually observe.  A path whose packet offsets
+ * the model cannot bound, a helper call it cannot model, or a program
+ * that moves the packet start all leave the depth unknown. */
+static void
+ubpf_prove_accesses(struct ubpf_vm *vm)
+{
+    const struct ebpf_inst *insts = vm->insts;
+    char *errmsg = NULL;
+
+    if (!vm->num_insts
+        || !validate_instructions(vm, insts, vm->num_insts, &errmsg)
+        || !validate_cfg(insts, vm->num_insts, &errmsg)) {
+        free(errmsg);
+        return;
+    }
+
+    unsigned long *proven = bitmap_allocate(vm->num_insts);
+    unsigned long *disproven = bitmap_allocate(vm->num_insts);
+    struct bpf_state *s = calloc(1, sizeof(struct bpf_state));
+    struct bpf_state *curr_state = s;
+    uint64_t parse_depth = 0;
+    bool ok = true;
+
+    ovs_list_init(&s->node);
+    s->regs[1].type = CTX_PTR;
+    s->regs[2].type = PKT_SIZE;
+    s->regs[2].u.max = UINT64_MAX;
+    s->regs[2].s.max = INT64_MAX;
+    s->regs[2].s.min = INT64_MIN;
+    s->regs[10].type = STACK_PTR;
+
+    while (ok) {
+        struct ebpf_inst inst = insts[curr_state->instno];
+        uint32_t pc = curr_state->instno;
+        enum ubpf_reg_type ptr_type;
+
+        switch (EBPF_CLASS(inst.opcode)) {
+        case EBPF_CLS_JMP:
+            if (inst.opcode == EBPF_OP_JA) {
+                curr_state->instno += inst.offset + 1;
+                continue;
+            } else if (inst.opcode == EBPF_OP_CALL) {
+                if (!validate_call(vm, curr_state, inst.imm, &errmsg)) {
+                    /* The call does not fit the model.  Keep exploring with
+                     * everything derived from it invalidated; accesses
+                     * through its results stay guarded, and a packet
+                     * pointer it was handed could be read to any depth. */
+                    free(errmsg);
+                    errmsg = NULL;
+                    invalidate_pkt_pointers(curr_state);
+                    mark_bpf_reg_as_unknown(&curr_state->regs[0]);
+                    curr_state->pkt_touch = UINT64_MAX;
+                }
+            } else if (inst.opcode == EBPF_OP_EXIT) {
+                parse_depth = MAX(parse_depth, curr_state->pkt_touch);
+                if (ovs_list_is_empty(&s->node)) {
+                    goto done;
+                }
+                struct bpf_state *next =
+                    CONTAINER_OF(ovs_list_pop_front(&s->node),
+                                 struct bpf_state, node);
+                if (curr_state != s) {
+                    free(curr_state);
+                }
+                curr_state = next;
+                continue;
+            } else if (!validate_jump(s, curr_state, &inst, &errmsg)) {
+                ok = false;
+            }
+            break;
+
+        case EBPF_CLS_ST:
+        case EBPF_CLS_STX:
+            if (!validate_reg_access(curr_state->regs, inst.dst, pc, READ,
+                                     &errmsg)
+                || (EBPF_CLASS(inst.opcode) == EBPF_CLS_STX
+                    && !validate_reg_access(curr_state->regs, inst.src, pc,
+                                            READ, &errmsg))) {
+                ok = false;
+                break;
+            }
+            ptr_type = curr_state->regs[inst.dst].type;
+            if (!validate_mem_access(curr_state, inst.dst, &inst, WRITE,
+                                     &errmsg)) {
+                free(errmsg);
+                errmsg = NULL;
+                bitmap_set1(disproven, pc);
+                break;
+            }
+            if (ptr_type == STACK_PTR || ptr_type == MAP_VALUE_PTR) {
+                bitmap_set1(proven, pc);
+            } else {
+                bitmap_set1(disproven, pc);
+            }
+            if (EBPF_SIZE(inst.opcode) == EBPF_SIZE_DW
+                && ptr_type == STACK_PTR
+                && EBPF_CLASS(inst.opcode) == EBPF_CLS_STX) {
+                /* Register spilling. */
+                curr_state->stack[STACK_SIZE + inst.offset] =
+                    curr_state->regs[inst.src];
+            }
+            break;
+
+        case EBPF_CLS_LDX:
+            if (!validate_reg_access(curr_state->regs, inst.dst, pc, WRITE,
+                                     &errmsg)
+                || !validate_reg_access(curr_state->regs, inst.src, pc, READ,
+                                        &errmsg)) {
+                ok = false;
+                break;
+            }
+            ptr_type = curr_state->regs[inst.src].type;
+            if (!validate_mem_access(curr_state, inst.src, &inst, READ,
+                                     &errmsg)) {
+                free(errmsg);
+                errmsg = NULL;
+                bitmap_set1(disproven, pc);
+                mark_bpf_reg_as_unknown(&curr_state->regs[inst.dst]);
+                break;
+            }
+            if (ptr_type == STACK_PTR || ptr_type == MAP_VALUE_PTR) {
+                bitmap_set1(proven, pc);
+            } else {
+                bitmap_set1(disproven, pc);
+            }
+            if (EBPF_SIZE(inst.opcode) == EBPF_SIZE_DW
+                && ptr_type == STACK_PTR) {
+                /* Register fill. */
+                curr_state->regs[inst.dst] =
+                    curr_state->stack[STACK_SIZE + inst.offset];
+            } else {
+                /* The loaded value itself is a runtime quantity. */
+                mark_bpf_reg_as_unknown(&curr_state->regs[inst.dst]);
+            }
+            break;
+
+        case EBPF_CLS_LD:
+            if (inst.opcode != EBPF_OP_LDDW
+                || !validate_reg_access(curr_state->regs, inst.dst, pc, WRITE,
+                                        &errmsg)) {
+                ok = false;
+                break;
+            }
+            if (inst.src == BPF_PSEUDO_MAP_FD) {
+                uint64_t imm2 = (uint64_t)insts[pc + 1].imm;
+
+                curr_state->regs[inst.dst].map =
+                    (void *)((imm2 << 32) | (uint32_t)inst.imm);
+                curr_state->regs[inst.dst].type = MAP_PTR;
+                curr_state->regs[inst.dst].u.min = 0;
+                curr_state->regs[inst.dst].u.max = 0;
+                curr_state->regs[inst.dst].s.min = 0;
+                curr_state->regs[inst.dst].s.max = 0;
+            } else {
+                uint64_t val = (uint32_t)inst.imm
+                               | ((uint64_t)insts[pc + 1].imm << 32);
+
+                curr_state->regs[inst.dst].type = IMM;
+                curr_state->regs[inst.dst].s.min = val;
+                curr_state->regs[inst.dst].s.max = val;
+                curr_state->regs[inst.dst].u.min = val;
+                curr_state->regs[inst.dst].u.max = val;
+                curr_state->regs[inst.dst].map = NULL;
+            }
+            curr_state->instno++;       /* Skip the second half. */
+            break;
+
+        case EBPF_CLS_ALU:
+        case EBPF_CLS_ALU64:
+            if (!validate_alu_op(curr_state, &inst, &errmsg)) {
+                ok = false;
+            }
+            break;
+        }
+
+        curr_state->instno++;
+    }
+
+done:
+    free(errmsg);
+    if (curr_state != s) {
+        free(curr_state);
+    }
+    struct bpf_state *queued;
+    LIST_FOR_EACH_POP (queued, node, &s->node) {
+        free(queued);
+    }
+    free(s);
+
+    if (ok) {
+        for (uint32_t i = 0; i < vm->num_insts; i++) {
+            if (bitmap_is_set(disproven, i)) {
+                bitmap_set0(proven, i);
+            }
+        }
+        free(vm->proven_access);
+        vm->proven_access = proven;
+        /* The depth bound only holds if every path was explored and the
+         * packet start cannot move out from under the recorded offsets. */
+        vm->parse_depth = !vm->uses_adjust_head && parse_depth
+                          && parse_depth <= UINT16_MAX ? parse_depth : 0;
+    } else {
+        bitmap_free(proven);
+    }
+    bitmap_free(disproven);
+}
+
 static int
 explore_cfg_edge(enum vertex_status *vertices, enum edge_status *edges,
                  uint32_t v, uint32_t u, enum edge_status branch,
@@ -2015,3 +2583,13 @@ ubpf_error(const char *fmt, ...)
     va_end(ap);
     return msg;
 }
+
+#if !defined(__x86_64__) && !defined(_M_X64) && !defined(__aarch64__)
+/* Architectures without a JIT backend fall back to ubpf_exec(). */
+ubpf_jit_fn
+ubpf_compile(struct ubpf_vm *vm OVS_UNUSED, char **errmsg)
+{
+    *errmsg = ubpf_error("JIT is not available on this architecture");
+    return NULL;
+}
+#endif
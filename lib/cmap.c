@@ -99,6 +99,31 @@ COVERAGE_DEFINE(cmap_shrink);
  * could be stored in two buckets).
  *
  *
+ * Incremental Expansion
+ * =====================
+ *
+ * Enlarging a small cmap simply copies every node into a new, larger
+ * implementation and then publishes it.  For a large cmap that copy can take
+ * milliseconds, all charged to the single unlucky insertion that crossed the
+ * load threshold.  To bound the worst-case cost of any one modification, a
+ * large cmap is instead expanded incrementally: the new (empty) table is
+ * published immediately with a pointer back to the old one, and each
+ * subsequent modification moves a few buckets' worth of entries from the old
+ * table into the new one until the old table is drained and retired.
+ *
+ * While both tables are live, the single-writer invariant is extended to say
+ * that all nodes with a given client-provided hash live in one chain in one
+ * bucket in ONE TABLE: insertions whose hash still has a chain in the old
+ * table extend that chain, everything else goes into the new table.  Readers
+ * probe the old table first.  An entry is moved by inserting it into the new
+ * table before clearing its slot in the old one, so a reader that misses in
+ * the old table is guaranteed to find a moved entry in the new one (see the
+ * ordering argument in cmap_migrate()).  Clearing may not begin until every
+ * reader that could have fetched the pre-expansion implementation pointer
+ * (and thus probes only the old table) has quiesced; an RCU callback flags
+ * when that is the case.
+ *
+ *
  * References
  * ==========
  *
@@ -158,6 +183,17 @@ BUILD_ASSERT_DECL(sizeof(struct cmap_bucket) == CACHE_LINE_SIZE);
  * means cmap will have a 40% load factor after shrink. */
 #define CMAP_MIN_LOAD ((uint32_t) (UINT32_MAX * .20))
 
+/* An expansion copies the whole table at once when the old table has fewer
+ * than this many buckets; from this size up the copy is spread across
+ * subsequent modifications instead (see "Incremental Expansion" above). */
+#define CMAP_MIGRATE_MIN_BUCKETS 1024
+
+/* Number of old-table buckets drained per modification during an incremental
+ * expansion.  Even one bucket per insertion would drain the old table well
+ * before the new one fills up; a few at a time retires it sooner without
+ * noticeably lengthening any individual operation. */
+#define CMAP_MIGRATE_BUCKETS 4
+
 /* The implementation of a concurrent hash map. */
 struct cmap_impl {
     PADDED_MEMBERS_CACHELINE_MARKER(CACHE_LINE_SIZE, cacheline0,
@@ -167,6 +203,12 @@ struct cmap_impl {
         uint32_t mask;              /* Number of 'buckets', minus one. */
         uint32_t basis;             /* Basis for rehashing client's
                                        hash values. */
+        OVSRCU_TYPE(struct cmap_impl *) old; /* Smaller table still being
+                                                drained into this one, or
+                                                NULL. */
+        uint32_t migrate_next;      /* First undrained bucket in 'old'. */
+        atomic_bool migrate_safe;   /* Readers predating 'old' have quiesced,
+                                       so entries may be moved out of it. */
     );
 
     PADDED_MEMBERS_CACHELINE_MARKER(CACHE_LINE_SIZE, cacheline1,
@@ -179,6 +221,7 @@ BUILD_ASSERT_DECL(sizeof(struct cmap_impl) == CACHE_LINE_SIZE * 2);
 OVS_ALIGNED_VAR(CACHE_LINE_SIZE) const struct cmap_impl empty_cmap;
 
 static struct cmap_impl *cmap_rehash(struct cmap *, uint32_t mask);
+static struct cmap_impl *cmap_migrate(struct cmap *, struct cmap_impl *);
 
 /* Explicit inline keywords in utility functions seem to be necessary
  * to prevent performance regression on cmap_find(). */
@@ -207,6 +250,14 @@ cmap_get_impl(const struct cmap *cmap)
     return ovsrcu_get(struct cmap_impl *, &cmap->impl);
 }
 
+/* Returns the table that 'impl' is still being drained from as part of an
+ * incremental expansion, or NULL if there is none. */
+static inline struct cmap_impl *
+cmap_get_old_impl(const struct cmap_impl *impl)
+{
+    return ovsrcu_get(struct cmap_impl *, &impl->old);
+}
+
 static uint32_t
 calc_max_n(uint32_t mask)
 {
@@ -234,6 +285,9 @@ cmap_impl_create(uint32_t mask)
     impl->min_n = calc_min_n(mask);
     impl->mask = mask;
     impl->basis = random_uint32();
+    ovsrcu_init(&impl->old, NULL);
+    impl->migrate_next = 0;
+    atomic_init(&impl->migrate_safe, false);
 
     return impl;
 }
@@ -255,6 +309,11 @@ cmap_destroy(struct cmap *cmap)
     if (cmap) {
         struct cmap_impl *impl = cmap_get_impl(cmap);
         if (impl != &empty_cmap) {
+            struct cmap_impl *old = cmap_get_old_impl(impl);
+
+            if (old) {
+                ovsrcu_postpone(free_cacheline, old);
+            }
             ovsrcu_postpone(free_cacheline, impl);
         }
     }
@@ -365,14 +424,60 @@ const struct cmap_node *
 cmap_find(const struct cmap *cmap, uint32_t hash)
 {
     const struct cmap_impl *impl = cmap_get_impl(cmap);
-    uint32_t h1 = rehash(impl, hash);
-    uint32_t h2 = other_hash(h1);
+    const struct cmap_impl *old = cmap_get_old_impl(impl);
+    uint32_t h1, h2;
+
+    if (OVS_UNLIKELY(old)) {
+        /* Probe the table being drained first: an entry is inserted into
+         * 'impl' before its slot in 'old' is cleared, so an entry missing
+         * here is either in 'impl' or absent altogether. */
+        const struct cmap_node *node;
+
+        h1 = rehash(old, hash);
+        h2 = other_hash(h1);
+        node = cmap_find__(&old->buckets[h1 & old->mask],
+                           &old->buckets[h2 & old->mask],
+                           hash);
+        if (node) {
+            return node;
+        }
+    }
 
+    h1 = rehash(impl, hash);
+    h2 = other_hash(h1);
     return cmap_find__(&impl->buckets[h1 & impl->mask],
                        &impl->buckets[h2 & impl->mask],
                        hash);
 }
 
+/* Prefetches the first bucket that a subsequent cmap_find() of 'hash' in
+ * 'cmap' will probe.  Useful to overlap the cache misses of a batch of
+ * independent lookups with other work. */
+void
+cmap_prefetch(const struct cmap *cmap, uint32_t hash)
+{
+    const struct cmap_impl *impl = cmap_get_impl(cmap);
+    const struct cmap_impl *old = cmap_get_old_impl(impl);
+
+    if (OVS_UNLIKELY(old)) {
+        OVS_PREFETCH(&old->buckets[rehash(old, hash) & old->mask]);
+    }
+    OVS_PREFETCH(&impl->buckets[rehash(impl, hash) & impl->mask]);
+}
+
+/* Prefetches the bucket that a subsequent cmap_find_by_index() of 'index'
+ * in 'cmap' will read.  See cmap_prefetch(). */
+void
+cmap_prefetch_index(const struct cmap *cmap, uint32_t index)
+{
+    const struct cmap_impl *impl = cmap_get_impl(cmap);
+    uint32_t b = index / CMAP_K;
+
+    if (b <= impl->mask) {
+        OVS_PREFETCH(&impl->buckets[b]);
+    }
+}
+
 /* Find a node by the index of the entry of cmap. Index N means the N/CMAP_K
  * bucket and N%CMAP_K entry in that bucket.
  * Notice that it is not protected by the optimistic lock (versioning) because
@@ -401,7 +506,13 @@ cmap_find_by_index(const struct cmap *cmap, uint32_t index)
  * SMC cache.
  *
  * Return the index of the entry if found, or UINT32_MAX if not found. The
- * function assumes entry index cannot be larger than UINT32_MAX. */
+ * function assumes entry index cannot be larger than UINT32_MAX.
+ *
+ * Indexes are only meaningful relative to the current implementation, so
+ * during an incremental expansion an entry that has not yet been moved out of
+ * the old table reports UINT32_MAX, the same as a missing entry.  The caller
+ * already copes with that: an entry whose index cannot be cached now can be
+ * cached once the expansion finishes. */
 uint32_t
 cmap_find_index(const struct cmap *cmap, uint32_t hash)
 {
@@ -467,6 +578,23 @@ cmap_find_batch(const struct cmap *cmap, unsigned long map,
     const struct cmap_bucket *b2s[sizeof map * CHAR_BIT];
     uint32_t c1s[sizeof map * CHAR_BIT];
 
+    if (OVS_UNLIKELY(cmap_get_old_impl(impl))) {
+        /* An incremental expansion is in progress.  Rather than threading a
+         * second table through the prefetch pipeline below for a state that
+         * lasts only until the old table is drained, just look the hashes up
+         * one by one. */
+        ULLONG_FOR_EACH_1(i, map) {
+            const struct cmap_node *node = cmap_find(cmap, hashes[i]);
+
+            if (node) {
+                nodes[i] = node;
+            } else {
+                ULLONG_SET0(result, i);
+            }
+        }
+        return result;
+    }
+
     /* Compute hashes and prefetch 1st buckets. */
     ULLONG_FOR_EACH_1(i, map) {
         h1s[i] = rehash(impl, hashes[i]);
@@ -567,6 +695,7 @@ struct cmap_node *
 cmap_find_protected(const struct cmap *cmap, uint32_t hash)
 {
     struct cmap_impl *impl = cmap_get_impl(cmap);
+    struct cmap_impl *old = cmap_get_old_impl(impl);
     uint32_t h1 = rehash(impl, hash);
     uint32_t h2 = other_hash(h1);
     struct cmap_node *node;
@@ -575,7 +704,18 @@ cmap_find_protected(const struct cmap *cmap, uint32_t hash)
     if (node) {
         return node;
     }
-    return cmap_find_bucket_protected(impl, hash, h2);
+    node = cmap_find_bucket_protected(impl, hash, h2);
+    if (node || !old) {
+        return node;
+    }
+
+    h1 = rehash(old, hash);
+    h2 = other_hash(h1);
+    node = cmap_find_bucket_protected(old, hash, h1);
+    if (node) {
+        return node;
+    }
+    return cmap_find_bucket_protected(old, hash, h2);
 }
 
 static int
@@ -843,6 +983,121 @@ cmap_try_insert(struct cmap_impl *impl, struct cmap_node *node, uint32_t hash)
             cmap_insert_bfs(impl, node, hash, b1, b2));
 }
 
+/* RCU callback: every reader that could have fetched the pre-expansion
+ * implementation pointer, and thus probes only the old table, has quiesced,
+ * so entries may now be moved out of that table.  This runs strictly before
+ * any later postponed free of 'impl_' because callbacks postponed by one
+ * thread execute in the order they were postponed. */
+static void
+cmap_migrate_enable(void *impl_)
+{
+    struct cmap_impl *impl = impl_;
+
+    atomic_store_relaxed(&impl->migrate_safe, true);
+}
+
+/* If there is a live chain for 'hash' in 'old', prepends 'node' (a singleton)
+ * to it and returns true, otherwise returns false.  Keeping all nodes with
+ * one hash value in one table means a reader that finds a chain in the old
+ * table never needs to check the new table for more nodes of the same hash,
+ * and that a drained chain carries every node of its hash with it.
+ *
+ * Unlike cmap_insert_dup(), this must not reuse an empty slot whose stale
+ * hash value happens to match: the slot might already have been drained, and
+ * a node parked after the migration point would never be moved. */
+static bool
+cmap_insert_old(struct cmap_impl *old, struct cmap_node *node, uint32_t hash)
+{
+    uint32_t h1 = rehash(old, hash);
+    uint32_t h2 = other_hash(h1);
+    struct cmap_bucket *b = &old->buckets[h1 & old->mask];
+    int slot = cmap_find_slot_protected(b, hash);
+
+    if (slot < 0) {
+        b = &old->buckets[h2 & old->mask];
+        slot = cmap_find_slot_protected(b, hash);
+        if (slot < 0) {
+            return false;
+        }
+    }
+
+    ovsrcu_set_hidden(&node->next, cmap_node_next_protected(&b->nodes[slot]));
+    ovsrcu_set(&b->nodes[slot].next, node);
+    return true;
+}
+
+/* Starts enlarging 'impl', the current implementation of 'cmap', to twice as
+ * many buckets, and returns the implementation to insert into.  A small
+ * table is rehashed on the spot; a large one is expanded incrementally (see
+ * "Incremental Expansion" at the top of this file). */
+static struct cmap_impl *
+cmap_expand(struct cmap *cmap, struct cmap_impl *impl)
+{
+    uint32_t mask = (impl->mask << 1) | 1;
+    struct cmap_impl *new;
+
+    if (impl->mask + 1 < CMAP_MIGRATE_MIN_BUCKETS) {
+        return cmap_rehash(cmap, mask);
+    }
+
+    new = cmap_impl_create(mask);
+    new->n = impl->n;
+    ovsrcu_set_hidden(&new->old, impl);
+    ovsrcu_set(&cmap->impl, new);
+    ovsrcu_postpone(cmap_migrate_enable, new);
+
+    return new;
+}
+
+/* Moves up to CMAP_MIGRATE_BUCKETS buckets' worth of entries from the table
+ * being drained into 'impl', clearing the source slots as it goes, and
+ * retires the old table once it is empty.  Falls back to a full rehash if a
+ * chain cannot be placed, which also retires the old table.  Returns the
+ * implementation to use for subsequent operations. */
+static struct cmap_impl *
+cmap_migrate(struct cmap *cmap, struct cmap_impl *impl)
+{
+    struct cmap_impl *old = cmap_get_old_impl(impl);
+    bool safe;
+    int budget;
+
+    atomic_read_relaxed(&impl->migrate_safe, &safe);
+    if (!safe) {
+        return impl;
+    }
+
+    for (budget = CMAP_MIGRATE_BUCKETS; budget > 0; budget--) {
+        struct cmap_bucket *b = &old->buckets[impl->migrate_next];
+        int i;
+
+        for (i = 0; i < CMAP_K; i++) {
+            struct cmap_node *node = cmap_node_next_protected(&b->nodes[i]);
+
+            if (node) {
+                if (OVS_UNLIKELY(!cmap_try_insert(impl, node, b->hashes[i]))) {
+                    return cmap_rehash(cmap, impl->mask);
+                }
+
+                /* Clear the slot only now that the chain is visible in
+                 * 'impl'.  The insertion above ends with a release store and
+                 * a reader's probe of this table ends with an acquire fence
+                 * (see counter_changed()), so a reader that sees the cleared
+                 * slot cannot then read a pre-insertion view of 'impl'. */
+                ovsrcu_set(&b->nodes[i].next, NULL);
+            }
+        }
+
+        if (impl->migrate_next == old->mask) {
+            ovsrcu_set(&impl->old, NULL);
+            ovsrcu_postpone(free_cacheline, old);
+            break;
+        }
+        impl->migrate_next++;
+    }
+
+    return impl;
+}
+
 /* Inserts 'node', with the given 'hash', into 'cmap'.  The caller must ensure
  * that 'cmap' cannot change concurrently (from another thread).  If duplicates
  * are undesirable, the caller must have already verified that 'cmap' does not
@@ -853,12 +1108,31 @@ size_t
 cmap_insert(struct cmap *cmap, struct cmap_node *node, uint32_t hash)
 {
     struct cmap_impl *impl = cmap_get_impl(cmap);
+    struct cmap_impl *old = cmap_get_old_impl(impl);
 
     ovsrcu_set_hidden(&node->next, NULL);
 
     if (OVS_UNLIKELY(impl->n >= impl->max_n)) {
         COVERAGE_INC(cmap_expand);
-        impl = cmap_rehash(cmap, (impl->mask << 1) | 1);
+        if (!old) {
+            impl = cmap_expand(cmap, impl);
+            old = cmap_get_old_impl(impl);
+        } else {
+            /* The new table filled up before the old one drained, which
+             * migration pacing should make impossible in practice: give up
+             * on draining and rehash everything at once. */
+            impl = cmap_rehash(cmap, (impl->mask << 1) | 1);
+            old = NULL;
+        }
+    }
+
+    if (OVS_UNLIKELY(old)) {
+        bool spliced = cmap_insert_old(old, node, hash);
+
+        impl = cmap_migrate(cmap, impl);
+        if (spliced) {
+            return ++impl->n;
+        }
     }
 
     while (OVS_UNLIKELY(!cmap_try_insert(impl, node, hash))) {
@@ -915,15 +1189,32 @@ cmap_replace(struct cmap *cmap, struct cmap_node *old_node,
              struct cmap_node *new_node, uint32_t hash)
 {
     struct cmap_impl *impl = cmap_get_impl(cmap);
+    struct cmap_impl *old = cmap_get_old_impl(impl);
     uint32_t h1 = rehash(impl, hash);
     uint32_t h2 = other_hash(h1);
 
-    ovs_assert(cmap_replace__(impl, old_node, new_node, hash, h1) ||
-               cmap_replace__(impl, old_node, new_node, hash, h2));
+    if (!(cmap_replace__(impl, old_node, new_node, hash, h1)
+          || cmap_replace__(impl, old_node, new_node, hash, h2))) {
+        /* During an incremental expansion, an entry not yet drained is still
+         * in the old table, hashed with that table's own basis. */
+        uint32_t oh1, oh2;
+
+        ovs_assert(old);
+        oh1 = rehash(old, hash);
+        oh2 = other_hash(oh1);
+        ovs_assert(cmap_replace__(old, old_node, new_node, hash, oh1)
+                   || cmap_replace__(old, old_node, new_node, hash, oh2));
+    }
+
+    if (OVS_UNLIKELY(old)) {
+        /* Keep the old table draining even if insertions have stopped. */
+        impl = cmap_migrate(cmap, impl);
+        old = cmap_get_old_impl(impl);
+    }
 
     if (!new_node) {
         impl->n--;
-        if (OVS_UNLIKELY(impl->n < impl->min_n)) {
+        if (!old && OVS_UNLIKELY(impl->n < impl->min_n)) {
             COVERAGE_INC(cmap_shrink);
             impl = cmap_rehash(cmap, impl->mask >> 1);
         }
@@ -955,22 +1246,29 @@ cmap_try_rehash(const struct cmap_impl *old, struct cmap_impl *new)
 static struct cmap_impl *
 cmap_rehash(struct cmap *cmap, uint32_t mask)
 {
-    struct cmap_impl *old = cmap_get_impl(cmap);
+    struct cmap_impl *impl = cmap_get_impl(cmap);
+    struct cmap_impl *old = cmap_get_old_impl(impl);
     struct cmap_impl *new;
 
     new = cmap_impl_create(mask);
-    ovs_assert(old->n < new->max_n);
+    ovs_assert(impl->n < new->max_n);
 
-    while (!cmap_try_rehash(old, new)) {
+    /* If an incremental expansion is still in progress, part of the contents
+     * is in the table being drained; fold both tables into 'new'. */
+    while (!cmap_try_rehash(impl, new)
+           || (old && !cmap_try_rehash(old, new))) {
         memset(new->buckets, 0, (mask + 1) * sizeof *new->buckets);
         new->basis = random_uint32();
     }
 
-    new->n = old->n;
+    new->n = impl->n;
     ovsrcu_set(&cmap->impl, new);
-    if (old != &empty_cmap) {
+    if (old) {
         ovsrcu_postpone(free_cacheline, old);
     }
+    if (impl != &empty_cmap) {
+        ovsrcu_postpone(free_cacheline, impl);
+    }
 
     return new;
 }
@@ -978,9 +1276,14 @@ cmap_rehash(struct cmap *cmap, uint32_t mask)
 struct cmap_cursor
 cmap_cursor_start(const struct cmap *cmap)
 {
+    const struct cmap_impl *impl = cmap_get_impl(cmap);
+    const struct cmap_impl *old = cmap_get_old_impl(impl);
     struct cmap_cursor cursor;
 
-    cursor.impl = cmap_get_impl(cmap);
+    /* During an incremental expansion, walk the table being drained before
+     * the one being filled, so that entries not yet moved are not missed. */
+    cursor.impl = old ? old : impl;
+    cursor.next_impl = old ? impl : NULL;
     cursor.bucket_idx = 0;
     cursor.entry_idx = 0;
     cursor.node = NULL;
@@ -1001,17 +1304,27 @@ cmap_cursor_advance(struct cmap_cursor *cursor)
         }
     }
 
-    while (cursor->bucket_idx <= impl->mask) {
-        const struct cmap_bucket *b = &impl->buckets[cursor->bucket_idx];
+    for (;;) {
+        while (cursor->bucket_idx <= impl->mask) {
+            const struct cmap_bucket *b = &impl->buckets[cursor->bucket_idx];
 
-        while (cursor->entry_idx < CMAP_K) {
-            cursor->node = cmap_node_next(&b->nodes[cursor->entry_idx++]);
-            if (cursor->node) {
-                return;
+            while (cursor->entry_idx < CMAP_K) {
+                cursor->node = cmap_node_next(&b->nodes[cursor->entry_idx++]);
+                if (cursor->node) {
+                    return;
+                }
             }
+
+            cursor->bucket_idx++;
+            cursor->entry_idx = 0;
         }
 
-        cursor->bucket_idx++;
+        if (!cursor->next_impl) {
+            return;
+        }
+        impl = cursor->impl = cursor->next_impl;
+        cursor->next_impl = NULL;
+        cursor->bucket_idx = 0;
         cursor->entry_idx = 0;
     }
 }
@@ -1029,12 +1342,20 @@ cmap_next_position(const struct cmap *cmap,
                    struct cmap_position *pos)
 {
     struct cmap_impl *impl = cmap_get_impl(cmap);
+    struct cmap_impl *old = cmap_get_old_impl(impl);
+    unsigned int n_old = old ? old->mask + 1 : 0;
+    unsigned int n_buckets = n_old + impl->mask + 1;
     unsigned int bucket = pos->bucket;
     unsigned int entry = pos->entry;
     unsigned int offset = pos->offset;
 
-    while (bucket <= impl->mask) {
-        const struct cmap_bucket *b = &impl->buckets[bucket];
+    /* During an incremental expansion, the buckets of the table being
+     * drained come first in the position space, followed by those of the
+     * current table, so that entries not yet moved are not missed. */
+    while (bucket < n_buckets) {
+        const struct cmap_bucket *b = bucket < n_old
+            ? &old->buckets[bucket]
+            : &impl->buckets[bucket - n_old];
 
         while (entry < CMAP_K) {
             const struct cmap_node *node = cmap_node_next(&b->nodes[entry]);
@@ -144,6 +144,8 @@ size_t cmap_replace(struct cmap *, struct cmap_node *old_node,
 
 const struct cmap_node *cmap_find(const struct cmap *, uint32_t hash);
 struct cmap_node *cmap_find_protected(const struct cmap *, uint32_t hash);
+void cmap_prefetch(const struct cmap *, uint32_t hash);
+void cmap_prefetch_index(const struct cmap *, uint32_t index);
 
 /* Find node by index or find index by hash. The 'index' of a cmap entry is a
  * way to combine the specific bucket and the entry of the bucket into a
@@ -235,6 +237,8 @@ unsigned long cmap_find_batch(const struct cmap *cmap, unsigned long map,
 
 struct cmap_cursor {
     const struct cmap_impl *impl;
+    const struct cmap_impl *next_impl; /* Table walked after 'impl', if the
+                                        * cmap is being expanded, else NULL. */
     uint32_t bucket_idx;
     int entry_idx;
     struct cmap_node *node;
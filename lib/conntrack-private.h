@@ -59,6 +59,12 @@ struct conn_key {
     uint8_t nw_proto;
 };
 
+/* Verify that there is no padding in struct conn_key up to and including
+ * 'nw_proto', so that conn_key_cmp() may compare the used bytes as one
+ * flat buffer. */
+BUILD_ASSERT_DECL(offsetof(struct conn_key, nw_proto)
+                  == 2 * sizeof(struct ct_endpoint) + 4);
+
 /* This is used for alg expectations; an expectation is a
  * context created in preparation for establishing a data
  * connection. The expectation is created by the control
@@ -95,6 +101,7 @@ struct conn {
     struct conn_key master_key; /* Only used for orig_tuple support. */
     struct ovs_list exp_node;
     struct cmap_node cm_node;
+    uint32_t hash; /* Hash of 'key'; selects the bucket of this entry. */
     struct nat_action_info_t *nat_info;
     char *alg;
     struct conn *nat_conn; /* The NAT 'conn' context, if there is one. */
@@ -113,10 +120,14 @@ struct conn {
     /* Mutable data. */
     bool seq_skew_dir; /* TCP sequence skew direction due to NATTing of FTP
                         * control messages; true if reply direction. */
-    bool cleaned; /* True if cleaned from expiry lists. */
+    bool cleaned; /* True if cleaned from the expiry wheel.  Protected by
+                   * the bucket lock of this connection. */
 
     /* Immutable data. */
     bool alg_related; /* True if alg data connection. */
+    bool alg_none; /* True if this connection can never require ALG
+                    * processing: created without a helper, not from an
+                    * expectation and not on an ALG control tuple. */
     enum ct_conn_type conn_type;
 
     uint32_t tp_id; /* Timeout policy ID. */
@@ -152,12 +163,60 @@ enum ct_timeout {
     N_CT_TM
 };
 
-struct conntrack {
-    struct ovs_mutex ct_lock; /* Protects 2 following fields. */
+/* The connection table is partitioned into this many independently locked
+ * buckets, so that threads establishing connections mostly do not contend
+ * with each other. */
+#define CONNTRACK_BUCKETS_SHIFT 8
+#define CONNTRACK_BUCKETS (1 << CONNTRACK_BUCKETS_SHIFT)
+
+/* Hierarchical timing wheel holding connections by expiration time.
+ *
+ * The wheel has CT_WHEEL_LEVELS levels of CT_WHEEL_SLOTS slots each, with a
+ * granularity of one second at level 0: a slot at level 'l' spans 64^l
+ * seconds.  Inserting, removing and rescheduling a connection are all O(1),
+ * and the sweeper only ever touches slots holding connections that are due
+ * or that need cascading down a level, so expiry work is proportional to
+ * the connections actually expiring rather than to the table size. */
+#define CT_WHEEL_LEVELS 3
+#define CT_WHEEL_SLOT_SHIFT 6
+#define CT_WHEEL_SLOTS (1 << CT_WHEEL_SLOT_SHIFT)
+#define CT_WHEEL_MASK (CT_WHEEL_SLOTS - 1)
+#define CT_WHEEL_TICK_MS 1000LL
+/* Ticks covered by level 'LEVEL' together with all the levels below it. */
+#define CT_WHEEL_HORIZON(LEVEL) \
+    (1LL << ((LEVEL) * CT_WHEEL_SLOT_SHIFT + CT_WHEEL_SLOT_SHIFT))
+
+struct ct_exp_wheel {
+    struct ovs_list slots[CT_WHEEL_LEVELS][CT_WHEEL_SLOTS];
+    long long tick; /* Slots for ticks at or before this one have been
+                     * drained. */
+    size_t n; /* Number of connections on the wheel. */
+};
+
+/* A shard of the connection table.  A connection is mapped to its bucket by
+ * the hash of its key ('conn->hash'), so a NATed connection and the un-NAT
+ * entry it points to may live in different buckets. */
+struct ct_bucket {
+    struct ovs_mutex lock; /* Protects modifications of 'conns' and the
+                            * 'wheel'.  Lookups in 'conns' are lock-free. */
     struct cmap conns OVS_GUARDED;
-    struct ovs_list exp_lists[N_CT_TM] OVS_GUARDED;
-    struct hmap zone_limits OVS_GUARDED;
-    struct hmap timeout_policies OVS_GUARDED;
+    struct ct_exp_wheel wheel OVS_GUARDED;
+    atomic_uint64_t purge_gen; /* Incremented whenever a connection is
+                                * removed from 'conns'; lets connection
+                                * pointers cached outside the module be
+                                * revalidated without dereferencing them.
+                                * See conntrack_conn_ref_restore(). */
+};
+
+struct conntrack {
+    struct ct_bucket buckets[CONNTRACK_BUCKETS]; /* Sharded connection
+                                                  * tables. */
+    struct ovs_mutex nat_lock; /* Serializes NATed connection setup; see
+                                * conn_not_found(). */
+    struct ovs_mutex ct_lock; /* Protects modifications of 'zone_limits'
+                               * and 'timeout_policies' below. */
+    struct cmap zone_limits; /* Lookups are lock-free. */
+    struct cmap timeout_policies; /* Lookups are lock-free. */
     uint32_t hash_basis; /* Salt for hashing a connection key. */
     pthread_t clean_thread; /* Periodically cleans up connection tracker. */
     struct latch clean_thread_exit; /* To destroy the 'clean_thread'. */
@@ -179,10 +238,67 @@ struct conntrack {
     atomic_bool tcp_seq_chk; /* Check TCP sequence numbers. */
 };
 
+/* Returns the bucket that a connection key hashing to 'hash' belongs to. */
+static inline struct ct_bucket *
+ct_bucket(struct conntrack *ct, uint32_t hash)
+{
+    return &ct->buckets[hash & (CONNTRACK_BUCKETS - 1)];
+}
+
+/* Schedules 'conn' on 'wheel' according to 'conn->expiration'.  The caller
+ * must hold the bucket lock of 'conn'. */
+static inline void
+ct_wheel_insert(struct ct_exp_wheel *wheel, struct conn *conn)
+{
+    long long tick_e = conn->expiration / CT_WHEEL_TICK_MS;
+    long long delta = tick_e - wheel->tick;
+    unsigned int level = 0;
+    unsigned int slot;
+
+    if (delta < 1) {
+        /* Already due; expires on the next advance. */
+        tick_e = wheel->tick + 1;
+        delta = 1;
+    }
+
+    if (delta >= CT_WHEEL_HORIZON(CT_WHEEL_LEVELS - 1)) {
+        /* Beyond the horizon of the wheel.  Park the connection one slot
+         * behind the top level cursor, the farthest point in the future;
+         * it is rescheduled from there as the cursor comes around. */
+        level = CT_WHEEL_LEVELS - 1;
+        slot = ((wheel->tick >> (level * CT_WHEEL_SLOT_SHIFT)) - 1)
+               & CT_WHEEL_MASK;
+    } else {
+        while (delta >= CT_WHEEL_HORIZON(level)) {
+            level++;
+        }
+        slot = (tick_e >> (level * CT_WHEEL_SLOT_SHIFT)) & CT_WHEEL_MASK;
+    }
+    ovs_list_push_back(&wheel->slots[level][slot], &conn->exp_node);
+    wheel->n++;
+}
+
+/* Takes 'conn' off 'wheel', if it is scheduled there.  A connection that
+ * the sweeper has already collected has a self-linked 'exp_node' and is
+ * left alone.  The caller must hold the bucket lock of 'conn'. */
+static inline void
+ct_wheel_remove(struct ct_exp_wheel *wheel, struct conn *conn)
+{
+    if (!ovs_list_is_empty(&conn->exp_node)) {
+        ovs_list_remove(&conn->exp_node);
+        ovs_list_init(&conn->exp_node);
+        wheel->n--;
+    }
+}
+
 /* Lock acquisition order:
- *    1. 'ct_lock'
- *    2. 'conn->lock'
- *    3. 'resources_lock'
+ *    1. 'nat_lock'
+ *    2. Bucket 'lock's.  Only conn_not_found() holds two bucket locks at
+ *       the same time, and only while holding 'nat_lock', so no ordering
+ *       between buckets is needed.
+ *    3. 'ct_lock'
+ *    4. 'conn->lock'
+ *    5. 'resources_lock'
  */
 
 extern struct ct_l4_proto ct_proto_tcp;
@@ -47,6 +47,7 @@
 
 COVERAGE_DEFINE(conntrack_tcp_seq_chk_bypass);
 COVERAGE_DEFINE(conntrack_tcp_seq_chk_failed);
+COVERAGE_DEFINE(conntrack_tcp_est_fast_path);
 COVERAGE_DEFINE(conntrack_invalid_tcp_flags);
 
 struct tcp_peer {
@@ -79,6 +80,8 @@ enum {
 #define SEQ_MIN(a, b)   INT_MOD_MIN(a, b)
 #define SEQ_MAX(a, b)   INT_MOD_MAX(a, b)
 
+#define MAXACKWINDOW (0xffff + 1500)    /* 1500 is an arbitrary fudge factor */
+
 static struct conn_tcp*
 conn_tcp_cast(const struct conn* conn)
 {
@@ -209,6 +212,51 @@ tcp_conn_update(struct conntrack *ct, struct conn *conn_,
         dws = TCP_MAX_WSCALE;
     }
 
+    /* Fast path for the overwhelmingly common case: both directions
+     * established and a plain (possibly data-carrying) ACK landing inside
+     * the tracked windows.  The conditions mirror the in-window checks of
+     * the full algorithm below, but are combined with '&' so that the
+     * whole plausibility test compiles to straight-line code with a single
+     * branch; evaluating them one by one mispredicts heavily on links that
+     * reorder segments.  Anything unusual falls through to the full state
+     * machine. */
+    if (src->state == CT_DPIF_TCPS_ESTABLISHED
+        && dst->state == CT_DPIF_TCPS_ESTABLISHED
+        && !(tcp_flags & (TCP_SYN | TCP_FIN | TCP_RST))) {
+        bool in_window;
+        int fp_ackskew;
+
+        seq = ntohl(get_16aligned_be32(&tcp->tcp_seq));
+        ack = ntohl(get_16aligned_be32(&tcp->tcp_ack));
+        end = seq + p_len;
+        if (seq == end) {
+            /* Ease sequencing restrictions on no data packets */
+            seq = end = src->seqlo;
+        }
+        fp_ackskew = dst->seqlo - ack;
+
+        in_window = SEQ_GEQ(src->seqhi, end)
+                    & SEQ_GEQ(seq, src->seqlo
+                                   - ((uint32_t) dst->max_win << dws))
+                    & (fp_ackskew >= -MAXACKWINDOW)
+                    & (fp_ackskew <= (MAXACKWINDOW << sws));
+
+        if (OVS_LIKELY(in_window)) {
+            COVERAGE_INC(conntrack_tcp_est_fast_path);
+
+            /* Same window bookkeeping as below, in branchless form. */
+            src->max_win = MAX(src->max_win, win);
+            src->seqlo = SEQ_MAX(src->seqlo, end);
+            dst->seqhi = SEQ_MAX(dst->seqhi,
+                                 ack + MAX((uint32_t) win << sws, 1));
+
+            conn_update_expiration(ct, &conn->up, CT_TM_TCP_ESTABLISHED, now);
+            return CT_UPDATE_VALID;
+        }
+        /* Out of window, a bare seq-check bypass, or a broken-stack corner
+         * case: let the full algorithm judge it. */
+    }
+
     /*
      * Sequence tracking algorithm from Guido van Rooij's paper:
      *   http://www.madison-gurkha.com/publications/tcp_filtering/
@@ -293,7 +341,6 @@ tcp_conn_update(struct conntrack *ct, struct conn *conn_,
     }
 
     int ackskew = check_ackskew ? dst->seqlo - ack : 0;
-#define MAXACKWINDOW (0xffff + 1500)    /* 1500 is an arbitrary fudge factor */
     if ((SEQ_GEQ(src->seqhi, end)
         /* Last octet inside other's window space */
         && SEQ_GEQ(seq, src->seqlo - (dst->max_win << dws))
@@ -46,15 +46,17 @@ static unsigned int ct_dpif_netdev_tp_def[] = {
     [CT_DPIF_TP_ATTR_ICMP_REPLY] = 30,
 };
 
+/* Lookups are lock-free; modifications of 'ct->timeout_policies' are done
+ * under 'ct->ct_lock' and freed via RCU, so a policy returned here must be
+ * used before the current thread quiesces. */
 static struct timeout_policy *
 timeout_policy_lookup(struct conntrack *ct, int32_t tp_id)
-    OVS_REQUIRES(ct->ct_lock)
 {
     struct timeout_policy *tp;
     uint32_t hash;
 
     hash = hash_int(tp_id, ct->hash_basis);
-    HMAP_FOR_EACH_IN_BUCKET (tp, node, hash, &ct->timeout_policies) {
+    CMAP_FOR_EACH_WITH_HASH (tp, node, hash, &ct->timeout_policies) {
         if (tp->policy.id == tp_id) {
             return tp;
         }
@@ -65,17 +67,7 @@ timeout_policy_lookup(struct conntrack *ct, int32_t tp_id)
 struct timeout_policy *
 timeout_policy_get(struct conntrack *ct, int32_t tp_id)
 {
-    struct timeout_policy *tp;
-
-    ovs_mutex_lock(&ct->ct_lock);
-    tp = timeout_policy_lookup(ct, tp_id);
-    if (!tp) {
-        ovs_mutex_unlock(&ct->ct_lock);
-        return NULL;
-    }
-
-    ovs_mutex_unlock(&ct->ct_lock);
-    return tp;
+    return timeout_policy_lookup(ct, tp_id);
 }
 
 static void
@@ -125,15 +117,16 @@ timeout_policy_create(struct conntrack *ct,
     init_default_tp(tp, tp_id);
     update_existing_tp(tp, new_tp);
     hash = hash_int(tp_id, ct->hash_basis);
-    hmap_insert(&ct->timeout_policies, &tp->node, hash);
+    cmap_insert(&ct->timeout_policies, &tp->node, hash);
 }
 
 static void
 timeout_policy_clean(struct conntrack *ct, struct timeout_policy *tp)
     OVS_REQUIRES(ct->ct_lock)
 {
-    hmap_remove(&ct->timeout_policies, &tp->node);
-    free(tp);
+    cmap_remove(&ct->timeout_policies, &tp->node,
+                hash_int(tp->policy.id, ct->hash_basis));
+    ovsrcu_postpone(free, tp);
 }
 
 static int
@@ -170,7 +163,7 @@ timeout_policy_init(struct conntrack *ct)
 {
     struct timeout_policy tp;
 
-    hmap_init(&ct->timeout_policies);
+    cmap_init(&ct->timeout_policies);
 
     /* Create default timeout policy. */
     memset(&tp, 0, sizeof tp);
@@ -232,21 +225,23 @@ tm_to_ct_dpif_tp(enum ct_timeout tm)
 
 static void
 conn_update_expiration__(struct conntrack *ct, struct conn *conn,
-                         enum ct_timeout tm, long long now,
+                         enum ct_timeout tm OVS_UNUSED, long long now,
                          uint32_t tp_value)
     OVS_REQUIRES(conn->lock)
 {
+    struct ct_bucket *bucket = ct_bucket(ct, conn->hash);
+
     ovs_mutex_unlock(&conn->lock);
 
-    ovs_mutex_lock(&ct->ct_lock);
+    ovs_mutex_lock(&bucket->lock);
     ovs_mutex_lock(&conn->lock);
     if (!conn->cleaned) {
         conn->expiration = now + tp_value * 1000;
-        ovs_list_remove(&conn->exp_node);
-        ovs_list_push_back(&ct->exp_lists[tm], &conn->exp_node);
+        ct_wheel_remove(&bucket->wheel, conn);
+        ct_wheel_insert(&bucket->wheel, conn);
     }
     ovs_mutex_unlock(&conn->lock);
-    ovs_mutex_unlock(&ct->ct_lock);
+    ovs_mutex_unlock(&bucket->lock);
 
     ovs_mutex_lock(&conn->lock);
 }
@@ -260,20 +255,13 @@ conn_update_expiration(struct conntrack *ct, struct conn *conn,
     struct timeout_policy *tp;
     uint32_t val;
 
-    ovs_mutex_unlock(&conn->lock);
-
-    ovs_mutex_lock(&ct->ct_lock);
-    ovs_mutex_lock(&conn->lock);
     tp = timeout_policy_lookup(ct, conn->tp_id);
     if (tp) {
         val = tp->policy.attrs[tm_to_ct_dpif_tp(tm)];
     } else {
         val = ct_dpif_netdev_tp_def[tm_to_ct_dpif_tp(tm)];
     }
-    ovs_mutex_unlock(&conn->lock);
-    ovs_mutex_unlock(&ct->ct_lock);
 
-    ovs_mutex_lock(&conn->lock);
     VLOG_DBG_RL(&rl, "Update timeout %s zone=%u with policy id=%d "
                 "val=%u sec.",
                 ct_timeout_str[tm], conn->key.zone, conn->tp_id, val);
@@ -282,19 +270,19 @@ conn_update_expiration(struct conntrack *ct, struct conn *conn,
 }
 
 static void
-conn_init_expiration__(struct conntrack *ct, struct conn *conn,
-                       enum ct_timeout tm, long long now,
+conn_init_expiration__(struct conntrack *ct OVS_UNUSED, struct conn *conn,
+                       enum ct_timeout tm OVS_UNUSED, long long now,
                        uint32_t tp_value)
 {
     conn->expiration = now + tp_value * 1000;
-    ovs_list_push_back(&ct->exp_lists[tm], &conn->exp_node);
 }
 
-/* ct_lock must be held. */
+/* Sets the expiration of 'conn' without scheduling it: the caller inserts
+ * the connection into its bucket's expiry wheel when inserting it into the
+ * bucket. */
 void
 conn_init_expiration(struct conntrack *ct, struct conn *conn,
                      enum ct_timeout tm, long long now)
-    OVS_REQUIRES(ct->ct_lock)
 {
     struct timeout_policy *tp;
     uint32_t val;
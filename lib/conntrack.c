@@ -21,6 +21,9 @@
 #include <netinet/in.h>
 #include <netinet/icmp6.h>
 #include <string.h>
+#if __AVX2__
+#include <immintrin.h>
+#endif
 
 #include "bitmap.h"
 #include "conntrack.h"
@@ -78,9 +81,14 @@ enum ct_alg_ctl_type {
     CT_ALG_CTL_SIP,
 };
 
+/* Per-zone connection limit.  Lives in the lock-free 'ct->zone_limits'
+ * cmap; insertion and removal are serialized by 'ct->ct_lock', lookups
+ * and accounting from the datapath take no lock at all.  The live count
+ * is 'count'; it is folded into a 'czl' copy by zone_limit_get(). */
 struct zone_limit {
-    struct hmap_node node;
-    struct conntrack_zone_limit czl;
+    struct cmap_node node;
+    struct conntrack_zone_limit czl; /* 'czl.count' unused; see above. */
+    atomic_count count; /* Connections currently admitted to the zone. */
 };
 
 static bool conn_key_extract(struct conntrack *, struct dp_packet *,
@@ -210,12 +218,36 @@ static alg_helper alg_helpers[] = {
  * are accepted; this is for CT_CONN_TYPE_DEFAULT connections. */
 #define DEFAULT_N_CONN_LIMIT 3000000
 
+/* Number of bytes of struct conn_key covered by actual fields: everything
+ * up to and including 'nw_proto', excluding trailing padding. */
+#define CONN_KEY_USED_LEN (offsetof(struct conn_key, nw_proto) + 1)
+
 /* Does a member by member comparison of two conn_keys; this
  * function must be kept in sync with struct conn_key; returns 0
  * if the keys are equal or 1 if the keys are not equal. */
 static int
 conn_key_cmp(const struct conn_key *key1, const struct conn_key *key2)
 {
+#if __AVX2__
+    /* struct conn_key has no internal padding (see the build assertions
+     * next to its definition), so the used bytes can be compared with two
+     * overlapping 32-byte vector compares; the trailing padding is never
+     * examined. */
+    const uint8_t *p1 = (const uint8_t *) key1;
+    const uint8_t *p2 = (const uint8_t *) key2;
+    __m256i eq_lo, eq_hi;
+
+    BUILD_ASSERT(CONN_KEY_USED_LEN >= sizeof(__m256i));
+    eq_lo = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) p1),
+                              _mm256_loadu_si256((const __m256i *) p2));
+    eq_hi = _mm256_cmpeq_epi8(
+        _mm256_loadu_si256(
+            (const __m256i *) (p1 + CONN_KEY_USED_LEN - sizeof(__m256i))),
+        _mm256_loadu_si256(
+            (const __m256i *) (p2 + CONN_KEY_USED_LEN - sizeof(__m256i))));
+
+    return _mm256_movemask_epi8(_mm256_and_si256(eq_lo, eq_hi)) != -1;
+#else
     if (!memcmp(&key1->src.addr, &key2->src.addr, sizeof key1->src.addr) &&
         !memcmp(&key1->dst.addr, &key2->dst.addr, sizeof key1->dst.addr) &&
         (key1->src.icmp_id == key2->src.icmp_id) &&
@@ -231,6 +263,7 @@ conn_key_cmp(const struct conn_key *key1, const struct conn_key *key2)
         return 0;
     }
     return 1;
+#endif
 }
 
 static void
@@ -288,6 +321,18 @@ ct_print_conn_info(const struct conn *c, const char *log_msg,
     }
 }
 
+static void
+ct_wheel_init(struct ct_exp_wheel *wheel, long long now)
+{
+    for (unsigned int level = 0; level < CT_WHEEL_LEVELS; level++) {
+        for (unsigned int slot = 0; slot < CT_WHEEL_SLOTS; slot++) {
+            ovs_list_init(&wheel->slots[level][slot]);
+        }
+    }
+    wheel->tick = now / CT_WHEEL_TICK_MS;
+    wheel->n = 0;
+}
+
 /* Initializes the connection tracker 'ct'.  The caller is responsible for
  * calling 'conntrack_destroy()', when the instance is not needed anymore */
 struct conntrack *
@@ -301,18 +346,26 @@ conntrack_init(void)
     hindex_init(&ct->alg_expectation_refs);
     ovs_rwlock_unlock(&ct->resources_lock);
 
+    for (unsigned i = 0; i < CONNTRACK_BUCKETS; i++) {
+        struct ct_bucket *bucket = &ct->buckets[i];
+
+        ovs_mutex_init_adaptive(&bucket->lock);
+        cmap_init(&bucket->conns);
+        ct_wheel_init(&bucket->wheel, time_msec());
+        atomic_init(&bucket->purge_gen, 0);
+    }
+
+    ovs_mutex_init_adaptive(&ct->nat_lock);
     ovs_mutex_init_adaptive(&ct->ct_lock);
+    /* 'hash_basis' feeds the timeout policy and zone limit hashes, so it
+     * must be set before anything is inserted into those maps. */
+    ct->hash_basis = random_uint32();
     ovs_mutex_lock(&ct->ct_lock);
-    cmap_init(&ct->conns);
-    for (unsigned i = 0; i < ARRAY_SIZE(ct->exp_lists); i++) {
-        ovs_list_init(&ct->exp_lists[i]);
-    }
-    hmap_init(&ct->zone_limits);
+    cmap_init(&ct->zone_limits);
     ct->zone_limit_seq = 0;
     timeout_policy_init(ct);
     ovs_mutex_unlock(&ct->ct_lock);
 
-    ct->hash_basis = random_uint32();
     atomic_count_init(&ct->n_conn, 0);
     atomic_init(&ct->n_conn_limit, DEFAULT_N_CONN_LIMIT);
     atomic_init(&ct->tcp_seq_chk, true);
@@ -332,11 +385,10 @@ zone_key_hash(int32_t zone, uint32_t basis)
 
 static struct zone_limit *
 zone_limit_lookup(struct conntrack *ct, int32_t zone)
-    OVS_REQUIRES(ct->ct_lock)
 {
     uint32_t hash = zone_key_hash(zone, ct->hash_basis);
     struct zone_limit *zl;
-    HMAP_FOR_EACH_IN_BUCKET (zl, node, hash, &ct->zone_limits) {
+    CMAP_FOR_EACH_WITH_HASH (zl, node, hash, &ct->zone_limits) {
         if (zl->czl.zone == zone) {
             return zl;
         }
@@ -346,7 +398,6 @@ zone_limit_lookup(struct conntrack *ct, int32_t zone)
 
 static struct zone_limit *
 zone_limit_lookup_or_default(struct conntrack *ct, int32_t zone)
-    OVS_REQUIRES(ct->ct_lock)
 {
     struct zone_limit *zl = zone_limit_lookup(ct, zone);
     return zl ? zl : zone_limit_lookup(ct, DEFAULT_ZONE);
@@ -355,13 +406,12 @@ zone_limit_lookup_or_default(struct conntrack *ct, int32_t zone)
 struct conntrack_zone_limit
 zone_limit_get(struct conntrack *ct, int32_t zone)
 {
-    ovs_mutex_lock(&ct->ct_lock);
     struct conntrack_zone_limit czl = {DEFAULT_ZONE, 0, 0, 0};
     struct zone_limit *zl = zone_limit_lookup_or_default(ct, zone);
     if (zl) {
         czl = zl->czl;
+        czl.count = atomic_count_get(&zl->count);
     }
-    ovs_mutex_unlock(&ct->ct_lock);
     return czl;
 }
 
@@ -374,8 +424,9 @@ zone_limit_create(struct conntrack *ct, int32_t zone, uint32_t limit)
         zl->czl.limit = limit;
         zl->czl.zone = zone;
         zl->czl.zone_limit_seq = ct->zone_limit_seq++;
+        atomic_count_init(&zl->count, 0);
         uint32_t hash = zone_key_hash(zone, ct->hash_basis);
-        hmap_insert(&ct->zone_limits, &zl->node, hash);
+        cmap_insert(&ct->zone_limits, &zl->node, hash);
         return 0;
     } else {
         return EINVAL;
@@ -408,8 +459,9 @@ static void
 zone_limit_clean(struct conntrack *ct, struct zone_limit *zl)
     OVS_REQUIRES(ct->ct_lock)
 {
-    hmap_remove(&ct->zone_limits, &zl->node);
-    free(zl);
+    cmap_remove(&ct->zone_limits, &zl->node,
+                zone_key_hash(zl->czl.zone, ct->hash_basis));
+    ovsrcu_postpone(free, zl);
 }
 
 int
@@ -428,49 +480,80 @@ zone_limit_delete(struct conntrack *ct, uint16_t zone)
     return 0;
 }
 
+/* Called with the bucket lock of 'conn' held (or with no other thread
+ * accessing 'ct', during destruction). */
 static void
 conn_clean_cmn(struct conntrack *ct, struct conn *conn)
-    OVS_REQUIRES(ct->ct_lock)
 {
+    struct ct_bucket *bucket = ct_bucket(ct, conn->hash);
+    uint64_t gen;
+
     if (conn->alg) {
         expectation_clean(ct, &conn->key);
     }
 
-    uint32_t hash = conn_key_hash(&conn->key, ct->hash_basis);
-    cmap_remove(&ct->conns, &conn->cm_node, hash);
+    cmap_remove(&bucket->conns, &conn->cm_node, conn->hash);
+    /* Invalidate connection references cached outside the module; the bump
+     * is published to lock-free readers by the bucket lock release (or the
+     * RCU grace period preceding the deferred free, at the latest). */
+    atomic_add_relaxed(&bucket->purge_gen, 1, &gen);
 
-    struct zone_limit *zl = zone_limit_lookup(ct, conn->admit_zone);
-    if (zl && zl->czl.zone_limit_seq == conn->zone_limit_seq) {
-        zl->czl.count--;
+    if (conn->admit_zone != INVALID_ZONE) {
+        struct zone_limit *zl = zone_limit_lookup(ct, conn->admit_zone);
+        if (zl && zl->czl.zone_limit_seq == conn->zone_limit_seq) {
+            atomic_count_dec(&zl->count);
+        }
     }
 }
 
 /* Must be called with 'conn' of 'conn_type' CT_CONN_TYPE_DEFAULT.  Also
- * removes the associated nat 'conn' from the lookup datastructures. */
+ * removes the associated nat 'conn' from the lookup datastructures.  Takes
+ * the bucket locks it needs by itself, one at a time; threads racing to
+ * clean the same connection are safe, only one of them will actually clean
+ * it. */
 static void
 conn_clean(struct conntrack *ct, struct conn *conn)
-    OVS_REQUIRES(ct->ct_lock)
 {
+    struct ct_bucket *bucket = ct_bucket(ct, conn->hash);
+
     ovs_assert(conn->conn_type == CT_CONN_TYPE_DEFAULT);
 
+    ovs_mutex_lock(&bucket->lock);
+    if (conn->cleaned) {
+        /* Lost the race against another cleaner. */
+        ovs_mutex_unlock(&bucket->lock);
+        return;
+    }
     conn_clean_cmn(ct, conn);
+    ct_wheel_remove(&bucket->wheel, conn);
+    conn->cleaned = true;
+    ovs_mutex_unlock(&bucket->lock);
+
+    /* The un-NAT entry may be in a different bucket; it is removed in a
+     * separate critical section to keep bucket locking one-at-a-time.
+     * Reply direction lookups in the short window between the two removals
+     * fail to find the master connection and treat the packet as invalid,
+     * the same as after both removals. */
     if (conn->nat_conn) {
-        uint32_t hash = conn_key_hash(&conn->nat_conn->key, ct->hash_basis);
-        cmap_remove(&ct->conns, &conn->nat_conn->cm_node, hash);
+        struct ct_bucket *nat_bucket = ct_bucket(ct, conn->nat_conn->hash);
+
+        ovs_mutex_lock(&nat_bucket->lock);
+        cmap_remove(&nat_bucket->conns, &conn->nat_conn->cm_node,
+                    conn->nat_conn->hash);
+        ovs_mutex_unlock(&nat_bucket->lock);
     }
-    ovs_list_remove(&conn->exp_node);
-    conn->cleaned = true;
     ovsrcu_postpone(delete_conn, conn);
     atomic_count_dec(&ct->n_conn);
 }
 
+/* Only usable when no other thread accesses 'ct' anymore, i.e. from
+ * conntrack_destroy(). */
 static void
 conn_clean_one(struct conntrack *ct, struct conn *conn)
-    OVS_REQUIRES(ct->ct_lock)
 {
     conn_clean_cmn(ct, conn);
     if (conn->conn_type == CT_CONN_TYPE_DEFAULT) {
-        ovs_list_remove(&conn->exp_node);
+        ct_wheel_remove(&ct_bucket(ct, conn->hash)->wheel, conn);
         conn->cleaned = true;
         atomic_count_dec(&ct->n_conn);
     }
@@ -488,26 +571,36 @@ conntrack_destroy(struct conntrack *ct)
     pthread_join(ct->clean_thread, NULL);
     latch_destroy(&ct->clean_thread_exit);
 
-    ovs_mutex_lock(&ct->ct_lock);
-    CMAP_FOR_EACH (conn, cm_node, &ct->conns) {
-        conn_clean_one(ct, conn);
+    for (unsigned i = 0; i < CONNTRACK_BUCKETS; i++) {
+        struct ct_bucket *bucket = &ct->buckets[i];
+
+        CMAP_FOR_EACH (conn, cm_node, &bucket->conns) {
+            conn_clean_one(ct, conn);
+        }
+        cmap_destroy(&bucket->conns);
+        ovs_mutex_destroy(&bucket->lock);
     }
-    cmap_destroy(&ct->conns);
 
+    ovs_mutex_lock(&ct->ct_lock);
     struct zone_limit *zl;
-    HMAP_FOR_EACH_POP (zl, node, &ct->zone_limits) {
-        free(zl);
+    CMAP_FOR_EACH (zl, node, &ct->zone_limits) {
+        cmap_remove(&ct->zone_limits, &zl->node,
+                    zone_key_hash(zl->czl.zone, ct->hash_basis));
+        ovsrcu_postpone(free, zl);
     }
-    hmap_destroy(&ct->zone_limits);
+    cmap_destroy(&ct->zone_limits);
 
     struct timeout_policy *tp;
-    HMAP_FOR_EACH_POP (tp, node, &ct->timeout_policies) {
-        free(tp);
+    CMAP_FOR_EACH (tp, node, &ct->timeout_policies) {
+        cmap_remove(&ct->timeout_policies, &tp->node,
+                    hash_int(tp->policy.id, ct->hash_basis));
+        ovsrcu_postpone(free, tp);
     }
-    hmap_destroy(&ct->timeout_policies);
+    cmap_destroy(&ct->timeout_policies);
 
     ovs_mutex_unlock(&ct->ct_lock);
     ovs_mutex_destroy(&ct->ct_lock);
+    ovs_mutex_destroy(&ct->nat_lock);
 
     ovs_rwlock_wrlock(&ct->resources_lock);
     struct alg_exp_node *alg_exp_node;
@@ -532,7 +625,8 @@ conn_key_lookup(struct conntrack *ct, const struct conn_key *key,
     struct conn *conn;
     bool found = false;
 
-    CMAP_FOR_EACH_WITH_HASH (conn, cm_node, hash, &ct->conns) {
+    CMAP_FOR_EACH_WITH_HASH (conn, cm_node, hash,
+                             &ct_bucket(ct, hash)->conns) {
         if (!conn_key_cmp(&conn->key, key) && !conn_expired(conn, now)) {
             found = true;
             if (reply) {
@@ -955,13 +1049,16 @@ ct_verify_helper(const char *helper, enum ct_alg_ctl_type ct_alg_ctl)
     }
 }
 
+/* Called with the bucket lock for 'ctx->hash' held, plus 'ct->nat_lock' if
+ * 'nat_action_info' is nonnull.  This is the only place where a second
+ * bucket lock may be taken while one is already held, which 'nat_lock'
+ * keeps deadlock free. */
 static struct conn *
 conn_not_found(struct conntrack *ct, struct dp_packet *pkt,
                struct conn_lookup_ctx *ctx, bool commit, long long now,
                const struct nat_action_info_t *nat_action_info,
                const char *helper, const struct alg_exp_node *alg_exp,
                enum ct_alg_ctl_type ct_alg_ctl, uint32_t tp_id)
-    OVS_REQUIRES(ct->ct_lock)
 {
     struct conn *nc = NULL;
     struct conn *nat_conn = NULL;
@@ -978,9 +1075,17 @@ conn_not_found(struct conntrack *ct, struct dp_packet *pkt,
     }
 
     if (commit) {
-        struct zone_limit *zl = zone_limit_lookup_or_default(ct,
-                                                             ctx->key.zone);
-        if (zl && zl->czl.count >= zl->czl.limit) {
+        struct ct_bucket *bucket = ct_bucket(ct, ctx->hash);
+        struct zone_limit *zl;
+        bool zl_full;
+
+        /* The zone limit is checked here and charged once the connection
+         * is inserted, without any lock held in between, so concurrent
+         * setups may transiently overshoot the limit by the number of
+         * in-flight setups. */
+        zl = zone_limit_lookup_or_default(ct, ctx->key.zone);
+        zl_full = zl && atomic_count_get(&zl->count) >= zl->czl.limit;
+        if (zl_full) {
             return nc;
         }
 
@@ -992,6 +1097,7 @@ conn_not_found(struct conntrack *ct, struct dp_packet *pkt,
         }
 
         nc = new_conn(ct, pkt, &ctx->key, now, tp_id);
+        nc->hash = ctx->hash;
         memcpy(&nc->key, &ctx->key, sizeof nc->key);
         memcpy(&nc->rev_key, &nc->key, sizeof nc->rev_key);
         conn_key_reverse(&nc->rev_key);
@@ -1007,6 +1113,9 @@ conn_not_found(struct conntrack *ct, struct dp_packet *pkt,
             nc->master_key = alg_exp->master_key;
         }
 
+        nc->alg_none = !nc->alg && !alg_exp
+                       && ct_alg_ctl == CT_ALG_CTL_NONE;
+
         if (nat_action_info) {
             nc->nat_info = xmemdup(nat_action_info, sizeof *nc->nat_info);
             nat_conn = xzalloc(sizeof *nat_conn);
@@ -1040,19 +1149,31 @@ conn_not_found(struct conntrack *ct, struct dp_packet *pkt,
             nat_conn->alg = NULL;
             nat_conn->nat_conn = NULL;
             uint32_t nat_hash = conn_key_hash(&nat_conn->key, ct->hash_basis);
-            cmap_insert(&ct->conns, &nat_conn->cm_node, nat_hash);
+            struct ct_bucket *nat_bucket = ct_bucket(ct, nat_hash);
+
+            nat_conn->hash = nat_hash;
+            if (nat_bucket != bucket) {
+                ovs_mutex_lock(&nat_bucket->lock);
+            }
+            cmap_insert(&nat_bucket->conns, &nat_conn->cm_node, nat_hash);
+            if (nat_bucket != bucket) {
+                ovs_mutex_unlock(&nat_bucket->lock);
+            }
         }
 
         nc->nat_conn = nat_conn;
         ovs_mutex_init_adaptive(&nc->lock);
         nc->conn_type = CT_CONN_TYPE_DEFAULT;
-        cmap_insert(&ct->conns, &nc->cm_node, ctx->hash);
+        ct_wheel_insert(&bucket->wheel, nc);
+        cmap_insert(&bucket->conns, &nc->cm_node, ctx->hash);
         atomic_count_inc(&ct->n_conn);
         ctx->conn = nc; /* For completeness. */
+
+        zl = zone_limit_lookup_or_default(ct, ctx->key.zone);
         if (zl) {
             nc->admit_zone = zl->czl.zone;
             nc->zone_limit_seq = zl->czl.zone_limit_seq;
-            zl->czl.count++;
+            atomic_count_inc(&zl->count);
         } else {
             nc->admit_zone = INVALID_ZONE;
         }
@@ -1067,7 +1188,7 @@ conn_not_found(struct conntrack *ct, struct dp_packet *pkt,
      * can limit DoS impact. */
 nat_res_exhaustion:
     free(nat_conn);
-    ovs_list_remove(&nc->exp_node);
+    /* 'nc' was never put on an expiry list, so there is nothing to unlink. */
     delete_conn_cmn(nc);
     static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 5);
     VLOG_WARN_RL(&rl, "Unable to NAT due to tuple space exhaustion - "
@@ -1107,11 +1228,7 @@ conn_update_state(struct conntrack *ct, struct dp_packet *pkt,
             pkt->md.ct_state = CS_INVALID;
             break;
         case CT_UPDATE_NEW:
-            ovs_mutex_lock(&ct->ct_lock);
-            if (conn_lookup(ct, &conn->key, now, NULL, NULL)) {
-                conn_clean(ct, conn);
-            }
-            ovs_mutex_unlock(&ct->ct_lock);
+            conn_clean(ct, conn);
             create_new_conn = true;
             break;
         case CT_UPDATE_VALID_NEW:
@@ -1273,6 +1390,42 @@ process_one_fast(uint16_t zone, const uint32_t *setmark,
     }
 }
 
+/* Fast path for a packet of an established connection that can never
+ * require ALG processing (see 'conn->alg_none'): updates the connection
+ * state and the packet metadata with no helper-related work at all.
+ * Returns false if the state update demands a new connection; the caller
+ * then continues on the full path, with the old connection already
+ * cleaned. */
+static bool
+process_one_established(struct conntrack *ct, struct dp_packet *pkt,
+                        struct conn_lookup_ctx *ctx, struct conn *conn,
+                        uint16_t zone, const uint32_t *setmark,
+                        const struct ovs_key_ct_labels *setlabel,
+                        const struct nat_action_info_t *nat_action_info,
+                        long long now)
+{
+    if (conn_update_state(ct, pkt, ctx, conn, now)) {
+        return false;
+    }
+
+    if (nat_action_info) {
+        handle_nat(pkt, conn, zone, ctx->reply, ctx->icmp_related);
+    }
+
+    write_ct_md(pkt, zone, conn, &ctx->key, NULL);
+
+    if (setmark) {
+        set_mark(pkt, conn, setmark[0], setmark[1]);
+    }
+
+    if (setlabel) {
+        set_label(pkt, conn, &setlabel[0], &setlabel[1]);
+    }
+
+    set_cached_conn(nat_action_info, ctx, conn, pkt);
+    return true;
+}
+
 static void
 process_one(struct conntrack *ct, struct dp_packet *pkt,
             struct conn_lookup_ctx *ctx, uint16_t zone,
@@ -1288,16 +1441,35 @@ process_one(struct conntrack *ct, struct dp_packet *pkt,
     }
 
     bool create_new_conn = false;
-    conn_key_lookup(ct, &ctx->key, ctx->hash, now, &ctx->conn, &ctx->reply);
+
+    /* A connection primed from the datapath's flow cache (see
+     * conntrack_conn_ref_restore()) lets established flows skip the
+     * hash-table probe: the hint is validated against the packet's
+     * extracted key, so a stale one just falls back to a normal lookup. */
+    struct conn *hint = pkt->md.conn;
+    bool hint_valid = false;
+    if (hint && !pkt->md.ct_state
+        && hint->conn_type == CT_CONN_TYPE_DEFAULT
+        && !conn_expired(hint, now)) {
+        if (!conn_key_cmp(&hint->key, &ctx->key)) {
+            ctx->conn = hint;
+            ctx->reply = false;
+            hint_valid = true;
+        } else if (!conn_key_cmp(&hint->rev_key, &ctx->key)) {
+            ctx->conn = hint;
+            ctx->reply = true;
+            hint_valid = true;
+        }
+    }
+    if (!hint_valid) {
+        conn_key_lookup(ct, &ctx->key, ctx->hash, now, &ctx->conn,
+                        &ctx->reply);
+    }
     struct conn *conn = ctx->conn;
 
     /* Delete found entry if in wrong direction. 'force' implies commit. */
     if (OVS_UNLIKELY(force && ctx->reply && conn)) {
-        ovs_mutex_lock(&ct->ct_lock);
-        if (conn_lookup(ct, &conn->key, now, NULL, NULL)) {
-            conn_clean(ct, conn);
-        }
-        ovs_mutex_unlock(&ct->ct_lock);
+        conn_clean(ct, conn);
         conn = NULL;
     }
 
@@ -1320,29 +1492,46 @@ process_one(struct conntrack *ct, struct dp_packet *pkt,
         }
     }
 
-    enum ct_alg_ctl_type ct_alg_ctl = get_alg_ctl_type(pkt, tp_src, tp_dst,
-                                                       helper);
-
-    if (OVS_LIKELY(conn)) {
-        if (OVS_LIKELY(!conn_update_state_alg(ct, pkt, ctx, conn,
-                                              nat_action_info,
-                                              ct_alg_ctl, now,
-                                              &create_new_conn))) {
-            create_new_conn = conn_update_state(ct, pkt, ctx, conn, now);
-        }
-        if (nat_action_info && !create_new_conn) {
-            handle_nat(pkt, conn, zone, ctx->reply, ctx->icmp_related);
+    /* Established connections flagged ALG-free at creation take a
+     * short-circuit path with no helper-related branches; it lives in its
+     * own function so the hot code stays within one I-cache working set.
+     * A helper on the action, or a state change that demands a new
+     * connection, falls back to the full path below. */
+    if (OVS_LIKELY(conn && conn->alg_none && !helper)) {
+        if (process_one_established(ct, pkt, ctx, conn, zone, setmark,
+                                    setlabel, nat_action_info, now)) {
+            return;
         }
+        create_new_conn = true;
+    }
 
-    } else if (check_orig_tuple(ct, pkt, ctx, now, &conn, nat_action_info)) {
-        create_new_conn = conn_update_state(ct, pkt, ctx, conn, now);
-    } else {
-        if (ctx->icmp_related) {
-            /* An icmp related conn should always be found; no new
-               connection is created based on an icmp related packet. */
-            pkt->md.ct_state = CS_INVALID;
+    enum ct_alg_ctl_type ct_alg_ctl = CT_ALG_CTL_NONE;
+
+    if (!create_new_conn) {
+        ct_alg_ctl = get_alg_ctl_type(pkt, tp_src, tp_dst, helper);
+
+        if (OVS_LIKELY(conn)) {
+            if (OVS_LIKELY(!conn_update_state_alg(ct, pkt, ctx, conn,
+                                                  nat_action_info,
+                                                  ct_alg_ctl, now,
+                                                  &create_new_conn))) {
+                create_new_conn = conn_update_state(ct, pkt, ctx, conn, now);
+            }
+            if (nat_action_info && !create_new_conn) {
+                handle_nat(pkt, conn, zone, ctx->reply, ctx->icmp_related);
+            }
+
+        } else if (check_orig_tuple(ct, pkt, ctx, now, &conn,
+                                    nat_action_info)) {
+            create_new_conn = conn_update_state(ct, pkt, ctx, conn, now);
         } else {
-            create_new_conn = true;
+            if (ctx->icmp_related) {
+                /* An icmp related conn should always be found; no new
+                   connection is created based on an icmp related packet. */
+                pkt->md.ct_state = CS_INVALID;
+            } else {
+                create_new_conn = true;
+            }
         }
     }
 
@@ -1361,12 +1550,24 @@ process_one(struct conntrack *ct, struct dp_packet *pkt,
         }
         ovs_rwlock_unlock(&ct->resources_lock);
 
-        ovs_mutex_lock(&ct->ct_lock);
+        struct ct_bucket *bucket = ct_bucket(ct, ctx->hash);
+        bool nat = commit && nat_action_info;
+
+        /* NATed connection setup spans two buckets and must keep the
+         * selected NAT tuple unique, so it is serialized on 'nat_lock'.
+         * Connections without NAT only contend on their own bucket. */
+        if (nat) {
+            ovs_mutex_lock(&ct->nat_lock);
+        }
+        ovs_mutex_lock(&bucket->lock);
         if (!conn_lookup(ct, &ctx->key, now, NULL, NULL)) {
             conn = conn_not_found(ct, pkt, ctx, commit, now, nat_action_info,
                                   helper, alg_exp, ct_alg_ctl, tp_id);
         }
-        ovs_mutex_unlock(&ct->ct_lock);
+        ovs_mutex_unlock(&bucket->lock);
+        if (nat) {
+            ovs_mutex_unlock(&ct->nat_lock);
+        }
     }
 
     write_ct_md(pkt, zone, conn, &ctx->key, alg_exp);
@@ -1405,25 +1606,48 @@ conntrack_execute(struct conntrack *ct, struct dp_packet_batch *pkt_batch,
     ipf_preprocess_conntrack(ct->ipf, pkt_batch, now, dl_type, zone,
                              ct->hash_basis);
 
+    struct conn_lookup_ctx ctxs[NETDEV_MAX_BURST];
+    uint8_t ctx_idx[NETDEV_MAX_BURST];
     struct dp_packet *packet;
-    struct conn_lookup_ctx ctx;
+    size_t n_ctxs = 0;
 
+    /* First pass: handle the packets that do not need a connection lookup
+     * and extract the keys of the rest, prefetching the conntrack bucket
+     * each computed hash selects so that the (likely) cache misses of the
+     * lookups overlap with the parsing of the following packets. */
     DP_PACKET_BATCH_FOR_EACH (i, packet, pkt_batch) {
         struct conn *conn = packet->md.conn;
+        struct conn_lookup_ctx *ctx = &ctxs[n_ctxs];
+
+        ctx_idx[i] = UINT8_MAX;
         if (OVS_UNLIKELY(packet->md.ct_state == CS_INVALID)) {
             write_ct_md(packet, zone, NULL, NULL, NULL);
-        } else if (conn && conn->key.zone == zone && !force
+        } else if (conn && packet->md.ct_state
+                   && conn->key.zone == zone && !force
                    && !get_alg_ctl_type(packet, tp_src, tp_dst, helper)) {
+            /* 'ct_state' distinguishes a connection this packet has
+             * already been through from a cross-packet hint primed by
+             * conntrack_conn_ref_restore(), which still needs the full
+             * state update below. */
             process_one_fast(zone, setmark, setlabel, nat_action_info,
                              conn, packet);
-        } else if (OVS_UNLIKELY(!conn_key_extract(ct, packet, dl_type, &ctx,
+        } else if (OVS_UNLIKELY(!conn_key_extract(ct, packet, dl_type, ctx,
                                 zone))) {
             packet->md.ct_state = CS_INVALID;
             write_ct_md(packet, zone, NULL, NULL, NULL);
         } else {
-            process_one(ct, packet, &ctx, zone, force, commit, now, setmark,
-                        setlabel, nat_action_info, tp_src, tp_dst, helper,
-                        tp_id);
+            cmap_prefetch(&ct_bucket(ct, ctx->hash)->conns, ctx->hash);
+            ctx_idx[i] = n_ctxs++;
+        }
+    }
+
+    /* Second pass: full processing of the packets whose keys were
+     * extracted above, in their original order. */
+    DP_PACKET_BATCH_FOR_EACH (i, packet, pkt_batch) {
+        if (ctx_idx[i] != UINT8_MAX) {
+            process_one(ct, packet, &ctxs[ctx_idx[i]], zone, force, commit,
+                        now, setmark, setlabel, nat_action_info, tp_src,
+                        tp_dst, helper, tp_id);
         }
     }
 
@@ -1432,6 +1656,70 @@ conntrack_execute(struct conntrack *ct, struct dp_packet_batch *pkt_batch,
     return 0;
 }
 
+/* Caches in 'ref' the connection that conntrack_execute() left in 'pkt''s
+ * metadata, if any, so that the datapath's flow cache can carry it across
+ * packets.  The bucket's purge generation is read before re-checking that
+ * the connection is still in the bucket: as long as the generation stays
+ * unchanged no connection has been removed from the bucket since, so the
+ * pointer cannot have been freed and may be dereferenced again. */
+void
+conntrack_conn_ref_init(struct conntrack *ct, const struct dp_packet *pkt,
+                        struct conntrack_conn_ref *ref)
+{
+    struct conn *conn = pkt->md.conn;
+
+    ref->conn = NULL;
+    if (!conn || !pkt->md.ct_state || pkt->md.ct_state == CS_INVALID) {
+        return;
+    }
+
+    struct ct_bucket *bucket = ct_bucket(ct, conn->hash);
+    struct conn *found;
+    uint64_t gen;
+
+    atomic_read_explicit(&bucket->purge_gen, &gen, memory_order_acquire);
+    CMAP_FOR_EACH_WITH_HASH (found, cm_node, conn->hash, &bucket->conns) {
+        if (found == conn) {
+            ref->conn = conn;
+            ref->hash = conn->hash;
+            ref->purge_gen = gen;
+            ref->reply = pkt->md.reply;
+            ref->icmp_related = pkt->md.icmp_related;
+            return;
+        }
+    }
+}
+
+/* If 'ref' still names a live connection, primes 'pkt''s metadata with it
+ * and returns true; conntrack_execute() then validates the connection
+ * against the packet's extracted key instead of probing the hash table.
+ * Returns false without touching 'pkt' if the reference is empty, if the
+ * packet already carries connection state, or if any connection has been
+ * removed from the bucket since 'ref' was cached, in which case the cached
+ * pointer may be stale. */
+bool
+conntrack_conn_ref_restore(struct conntrack *ct,
+                           const struct conntrack_conn_ref *ref,
+                           struct dp_packet *pkt)
+{
+    uint64_t gen;
+
+    if (!ref->conn || pkt->md.conn || pkt->md.ct_state) {
+        return false;
+    }
+
+    atomic_read_explicit(&ct_bucket(ct, ref->hash)->purge_gen, &gen,
+                         memory_order_acquire);
+    if (gen != ref->purge_gen) {
+        return false;
+    }
+
+    pkt->md.conn = ref->conn;
+    pkt->md.reply = ref->reply;
+    pkt->md.icmp_related = ref->icmp_related;
+    return true;
+}
+
 void
 conntrack_clear(struct dp_packet *packet)
 {
@@ -1478,44 +1766,126 @@ set_label(struct dp_packet *pkt, struct conn *conn,
 }
 
 
-/* Delete the expired connections from 'ctb', up to 'limit'. Returns the
- * earliest expiration time among the remaining connections in 'ctb'.  Returns
- * LLONG_MAX if 'ctb' is empty.  The return value might be smaller than 'now',
+/* How many expired connections ct_sweep() collects under a bucket lock
+ * before releasing it to clean them. */
+enum { CT_SWEEP_BATCH = 32 };
+
+/* Tries to advance 'wheel' to 'target_tick', cascading higher level slots
+ * down as their windows open and collecting the connections that become
+ * due into the 'batch_size' elements of 'batch'.  Returns the number of
+ * collected connections; if 'batch' filled up before 'target_tick' was
+ * reached, 'wheel->tick' stays behind 'target_tick' and the rest of the
+ * work is picked up by the next call. */
+static size_t
+ct_wheel_advance(struct ct_exp_wheel *wheel, long long target_tick,
+                 struct conn **batch, size_t batch_size)
+{
+    size_t n = 0;
+
+    while (wheel->tick < target_tick) {
+        long long t = wheel->tick + 1;
+        struct ovs_list *slot;
+        struct conn *conn;
+
+        /* Cascade higher level slots whose window opens at 't' one level
+         * down.  Re-running a cascade after an early return below is a
+         * no-op, since the slot has already been drained. */
+        for (unsigned int level = CT_WHEEL_LEVELS - 1; level > 0; level--) {
+            if (!(t & (CT_WHEEL_HORIZON(level - 1) - 1))) {
+                slot = &wheel->slots[level]
+                    [(t >> (level * CT_WHEEL_SLOT_SHIFT)) & CT_WHEEL_MASK];
+                LIST_FOR_EACH_POP (conn, exp_node, slot) {
+                    wheel->n--;
+                    ct_wheel_insert(wheel, conn);
+                }
+            }
+        }
+
+        slot = &wheel->slots[0][t & CT_WHEEL_MASK];
+        LIST_FOR_EACH_POP (conn, exp_node, slot) {
+            ovs_list_init(&conn->exp_node);
+            wheel->n--;
+            batch[n++] = conn;
+            if (n == batch_size) {
+                return n;
+            }
+        }
+        wheel->tick = t;
+    }
+
+    return n;
+}
+
+/* Returns the time in msec at which the next connection on 'wheel' can
+ * expire, or LLONG_MAX if the wheel is empty.  The estimate is exact
+ * within the level 0 horizon and conservative beyond it. */
+static long long
+ct_wheel_next_due(const struct ct_exp_wheel *wheel)
+{
+    if (!wheel->n) {
+        return LLONG_MAX;
+    }
+    for (unsigned int i = 1; i < CT_WHEEL_SLOTS; i++) {
+        if (!ovs_list_is_empty(
+                &wheel->slots[0][(wheel->tick + i) & CT_WHEEL_MASK])) {
+            return (wheel->tick + i) * CT_WHEEL_TICK_MS;
+        }
+    }
+    return (wheel->tick + CT_WHEEL_SLOTS) * CT_WHEEL_TICK_MS;
+}
+
+/* Delete the expired connections from 'ct', up to 'limit'. Returns the
+ * earliest expiration time among the remaining connections in 'ct'.  Returns
+ * LLONG_MAX if 'ct' is empty.  The return value might be smaller than 'now',
  * if 'limit' is reached */
 static long long
 ct_sweep(struct conntrack *ct, long long now, size_t limit)
 {
-    struct conn *conn, *next;
-    long long min_expiration = LLONG_MAX;
+    long long next_exp = LLONG_MAX;
+    long long now_tick = now / CT_WHEEL_TICK_MS;
     size_t count = 0;
 
-    ovs_mutex_lock(&ct->ct_lock);
+    for (unsigned b = 0; b < CONNTRACK_BUCKETS; b++) {
+        struct ct_bucket *bucket = &ct->buckets[b];
+        struct ct_exp_wheel *wheel = &bucket->wheel;
+        bool more = true;
+
+        while (more) {
+            struct conn *batch[CT_SWEEP_BATCH];
+            size_t n;
+
+            /* Due connections are collected under the bucket lock and
+             * cleaned after releasing it, since conn_clean() takes the
+             * bucket locks it needs by itself.  A connection that is
+             * refreshed by a packet in between is evicted a moment before
+             * its (old) expiration; that is indistinguishable from the
+             * sweep having run slightly earlier. */
+            ovs_mutex_lock(&bucket->lock);
+            n = ct_wheel_advance(wheel, now_tick, batch,
+                                 MIN(ARRAY_SIZE(batch), limit - count));
+            more = wheel->tick < now_tick;
+            if (!more) {
+                next_exp = MIN(next_exp, ct_wheel_next_due(wheel));
+            }
+            ovs_mutex_unlock(&bucket->lock);
 
-    for (unsigned i = 0; i < N_CT_TM; i++) {
-        LIST_FOR_EACH_SAFE (conn, next, exp_node, &ct->exp_lists[i]) {
-            ovs_mutex_lock(&conn->lock);
-            if (now < conn->expiration || count >= limit) {
-                min_expiration = MIN(min_expiration, conn->expiration);
-                ovs_mutex_unlock(&conn->lock);
-                if (count >= limit) {
-                    /* Do not check other lists. */
-                    COVERAGE_INC(conntrack_long_cleanup);
-                    goto out;
-                }
-                break;
-            } else {
-                ovs_mutex_unlock(&conn->lock);
-                conn_clean(ct, conn);
+            for (size_t j = 0; j < n; j++) {
+                conn_clean(ct, batch[j]);
+            }
+            count += n;
+
+            if (count >= limit) {
+                /* Do not check other buckets. */
+                COVERAGE_INC(conntrack_long_cleanup);
+                goto out;
             }
-            count++;
         }
     }
 
 out:
     VLOG_DBG("conntrack cleanup %"PRIuSIZE" entries in %lld msec", count,
              time_msec() - now);
-    ovs_mutex_unlock(&ct->ct_lock);
-    return min_expiration;
+    return count >= limit ? now - 1 : next_exp;
 }
 
 /* Cleans up old connection entries from 'ct'.  Returns the time when the
@@ -2533,11 +2903,14 @@ conntrack_dump_next(struct conntrack_dump *dump, struct ct_dpif_entry *entry)
     struct conntrack *ct = dump->ct;
     long long now = time_msec();
 
-    for (;;) {
-        struct cmap_node *cm_node = cmap_next_position(&ct->conns,
-                                                       &dump->cm_pos);
+    while (dump->bucket < CONNTRACK_BUCKETS) {
+        struct cmap_node *cm_node =
+            cmap_next_position(&ct->buckets[dump->bucket].conns,
+                               &dump->cm_pos);
         if (!cm_node) {
-            break;
+            dump->bucket++;
+            memset(&dump->cm_pos, 0, sizeof dump->cm_pos);
+            continue;
         }
         struct conn *conn;
         INIT_CONTAINER(conn, cm_node, cm_node);
@@ -2560,15 +2933,32 @@ conntrack_dump_done(struct conntrack_dump *dump OVS_UNUSED)
 int
 conntrack_flush(struct conntrack *ct, const uint16_t *zone)
 {
-    struct conn *conn;
+    for (unsigned i = 0; i < CONNTRACK_BUCKETS; i++) {
+        struct ct_bucket *bucket = &ct->buckets[i];
+        struct conn **conns;
+        struct conn *conn;
+        size_t n = 0;
+
+        /* Collect the connections under the bucket lock, so that the
+         * iteration does not miss entries moved by concurrent writers,
+         * and clean them afterwards: conn_clean() takes the bucket locks
+         * it needs by itself.  Un-NAT entries are removed along with their
+         * master connection. */
+        ovs_mutex_lock(&bucket->lock);
+        conns = xmalloc(cmap_count(&bucket->conns) * sizeof *conns);
+        CMAP_FOR_EACH (conn, cm_node, &bucket->conns) {
+            if (conn->conn_type == CT_CONN_TYPE_DEFAULT
+                && (!zone || *zone == conn->key.zone)) {
+                conns[n++] = conn;
+            }
+        }
+        ovs_mutex_unlock(&bucket->lock);
 
-    ovs_mutex_lock(&ct->ct_lock);
-    CMAP_FOR_EACH (conn, cm_node, &ct->conns) {
-        if (!zone || *zone == conn->key.zone) {
-            conn_clean_one(ct, conn);
+        for (size_t j = 0; j < n; j++) {
+            conn_clean(ct, conns[j]);
         }
+        free(conns);
     }
-    ovs_mutex_unlock(&ct->ct_lock);
 
     return 0;
 }
@@ -2583,7 +2973,6 @@ conntrack_flush_tuple(struct conntrack *ct, const struct ct_dpif_tuple *tuple,
 
     memset(&key, 0, sizeof(key));
     tuple_to_conn_key(tuple, zone, &key);
-    ovs_mutex_lock(&ct->ct_lock);
     conn_lookup(ct, &key, time_msec(), &conn, NULL);
 
     if (conn && conn->conn_type == CT_CONN_TYPE_DEFAULT) {
@@ -2593,7 +2982,6 @@ conntrack_flush_tuple(struct conntrack *ct, const struct ct_dpif_tuple *tuple,
         error = ENOENT;
     }
 
-    ovs_mutex_unlock(&ct->ct_lock);
     return error;
 }
 
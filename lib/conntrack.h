@@ -88,6 +88,24 @@ struct nat_action_info_t {
 struct conntrack *conntrack_init(void);
 void conntrack_destroy(struct conntrack *);
 
+/* A connection reference cached outside the conntrack module, e.g. by the
+ * datapath's flow cache, so that packets of established flows can skip the
+ * connection hash-table probe.  'conn' may only be dereferenced after a
+ * successful conntrack_conn_ref_restore(). */
+struct conntrack_conn_ref {
+    struct conn *conn;
+    uint32_t hash;      /* Bucket-selecting hash of 'conn'. */
+    uint64_t purge_gen; /* Purge generation of the bucket at caching time. */
+    bool reply;         /* True if 'conn' was hit in the reply direction. */
+    bool icmp_related;
+};
+
+void conntrack_conn_ref_init(struct conntrack *, const struct dp_packet *,
+                             struct conntrack_conn_ref *);
+bool conntrack_conn_ref_restore(struct conntrack *,
+                                const struct conntrack_conn_ref *,
+                                struct dp_packet *);
+
 int conntrack_execute(struct conntrack *ct, struct dp_packet_batch *pkt_batch,
                       ovs_be16 dl_type, bool force, bool commit, uint16_t zone,
                       const uint32_t *setmark,
@@ -113,7 +131,7 @@ struct conntrack_zone_limit {
 };
 
 struct timeout_policy {
-    struct hmap_node node;
+    struct cmap_node node; /* In 'ct->timeout_policies'. */
     struct ct_dpif_timeout_policy policy;
 };
 
@@ -20,6 +20,7 @@
 #include <stdlib.h>
 #include "openvswitch/dynamic-string.h"
 #include "hash.h"
+#include "stats-shm.h"
 #include "svec.h"
 #include "timeval.h"
 #include "unixctl.h"
@@ -35,12 +36,46 @@ static size_t allocated_coverage_counters = 0;
 
 static struct ovs_mutex coverage_mutex = OVS_MUTEX_INITIALIZER;
 
-DEFINE_STATIC_PER_THREAD_DATA(long long int, coverage_clear_time, LLONG_MIN);
 static long long int coverage_run_time = LLONG_MIN;
 
 /* Index counter used to compute the moving average array's index. */
 static unsigned int idx_count = 0;
 
+/* Per-thread counter pages.
+ *
+ * Each thread that increments a counter gets its own page with one slot per
+ * registered counter, so an increment is a plain add on memory no other
+ * thread writes.  The pages stay readable by everyone, and the aggregation
+ * paths below sum them on demand; the unsynchronized loads can lag a slot's
+ * latest value but, with a single writer per slot, never produce garbage.
+ * When a thread exits, its page's counts move into 'coverage_orphaned'.
+ *
+ * Pages hold COVERAGE_MAX_COUNTERS slots rather than n_coverage_counters:
+ * registration happens in constructors, and a constructor that allocates
+ * (allocation itself is counted) can create the first page before the
+ * remaining counters have registered, so the final count is not known when
+ * a page is sized. */
+#define COVERAGE_MAX_COUNTERS 1024
+
+struct coverage_page {
+    struct ovs_list list_node OVS_GUARDED; /* In 'coverage_pages'. */
+    unsigned long long int *counts;      /* COVERAGE_MAX_COUNTERS slots. */
+};
+
+static struct ovs_list coverage_pages OVS_GUARDED_BY(coverage_mutex)
+    = OVS_LIST_INITIALIZER(&coverage_pages);
+
+/* Counts inherited from threads that have exited, or NULL if none has. */
+static unsigned long long int *coverage_orphaned
+    OVS_GUARDED_BY(coverage_mutex);
+
+DEFINE_EXTERN_PER_THREAD_DATA(coverage_page, NULL);
+
+static ovsthread_key_t coverage_page_key;
+
+/* True while the calling thread is inside coverage_page_create(). */
+DEFINE_STATIC_PER_THREAD_DATA(bool, coverage_page_creating, false);
+
 static void coverage_read(struct svec *);
 static unsigned int coverage_array_sum(const unsigned int *arr,
                                        const unsigned int len);
@@ -51,14 +86,99 @@ static bool coverage_read_counter(const char *name,
 void
 coverage_counter_register(struct coverage_counter* counter)
 {
+    ovs_assert(n_coverage_counters < COVERAGE_MAX_COUNTERS);
+
     if (n_coverage_counters >= allocated_coverage_counters) {
         coverage_counters = x2nrealloc(coverage_counters,
                                        &allocated_coverage_counters,
                                        sizeof(struct coverage_counter*));
     }
+    counter->index = n_coverage_counters;
     coverage_counters[n_coverage_counters++] = counter;
 }
 
+/* Folds an exiting thread's page into 'coverage_orphaned' and frees it. */
+static void
+coverage_page_destroy__(void *page_)
+{
+    struct coverage_page *page = page_;
+    size_t i;
+
+    ovs_mutex_lock(&coverage_mutex);
+    if (!coverage_orphaned) {
+        coverage_orphaned = xzalloc(n_coverage_counters
+                                    * sizeof *coverage_orphaned);
+    }
+    for (i = 0; i < n_coverage_counters; i++) {
+        coverage_orphaned[i] += page->counts[i];
+    }
+    ovs_list_remove(&page->list_node);
+    ovs_mutex_unlock(&coverage_mutex);
+
+    free_cacheline(page->counts);
+    free(page);
+}
+
+/* Creates the calling thread's counter page.  Called (through
+ * coverage_counter_add()) on a thread's first increment.
+ *
+ * Returns NULL, without creating a page, when invoked recursively.
+ * Everything below allocates memory, and allocating bumps a counter
+ * itself (see COVERAGE_INC(util_xalloc) in xmalloc()), which would lead
+ * straight back here while this thread's page is still unset: re-locking
+ * 'once' aborts with EDEADLK, and the nested allocations otherwise
+ * recurse without bound.  coverage_counter_add() drops the handful of
+ * increments made while the page is under construction instead. */
+unsigned long long int *
+coverage_page_create(void)
+{
+    static struct ovsthread_once once = OVSTHREAD_ONCE_INITIALIZER;
+    bool *creating = coverage_page_creating_get();
+    struct coverage_page *page;
+
+    if (*creating) {
+        return NULL;
+    }
+    *creating = true;
+
+    if (ovsthread_once_start(&once)) {
+        ovsthread_key_create(&coverage_page_key, coverage_page_destroy__);
+        ovsthread_once_done(&once);
+    }
+
+    page = xmalloc(sizeof *page);
+    page->counts = xzalloc_cacheline(COVERAGE_MAX_COUNTERS
+                                     * sizeof *page->counts);
+
+    ovs_mutex_lock(&coverage_mutex);
+    ovs_list_push_back(&coverage_pages, &page->list_node);
+    ovs_mutex_unlock(&coverage_mutex);
+
+    ovsthread_setspecific(coverage_page_key, page);
+    *coverage_page_get() = page->counts;
+    *creating = false;
+    return page->counts;
+}
+
+/* Recomputes every counter's 'total' from the live pages and the counts
+ * inherited from exited threads. */
+static void
+coverage_aggregate(void) OVS_REQUIRES(coverage_mutex)
+{
+    const struct coverage_page *page;
+    size_t i;
+
+    for (i = 0; i < n_coverage_counters; i++) {
+        coverage_counters[i]->total = coverage_orphaned
+                                      ? coverage_orphaned[i] : 0;
+    }
+    LIST_FOR_EACH (page, list_node, &coverage_pages) {
+        for (i = 0; i < n_coverage_counters; i++) {
+            coverage_counters[i]->total += page->counts[i];
+        }
+    }
+}
+
 static void
 coverage_unixctl_show(struct unixctl_conn *conn, int argc OVS_UNUSED,
                      const char *argv[] OVS_UNUSED, void *aux OVS_UNUSED)
@@ -128,6 +248,7 @@ coverage_hash(void)
     /* Sort coverage counters into groups with equal totals. */
     c = xmalloc(n_coverage_counters * sizeof *c);
     ovs_mutex_lock(&coverage_mutex);
+    coverage_aggregate();
     for (i = 0; i < n_coverage_counters; i++) {
         c[i] = coverage_counters[i];
     }
@@ -266,58 +387,39 @@ coverage_read(struct svec *lines)
     free(totals);
 }
 
-/* Runs approximately every COVERAGE_CLEAR_INTERVAL amount of time to
- * synchronize per-thread counters with global counters. Every thread maintains
- * a separate timer to ensure all counters are periodically aggregated.
- *
- * Uses 'ovs_mutex_trylock()' if 'trylock' is true.  This is to prevent
- * multiple performance-critical threads contending over the 'coverage_mutex'.
- *
- * */
+/* Mirrors the counter totals into the shared-memory statistics segment,
+ * if one is enabled, so telemetry agents can read them without a
+ * coverage/show round trip. */
 static void
-coverage_clear__(bool trylock)
+coverage_export_shm(void) OVS_REQUIRES(coverage_mutex)
 {
-    long long int now, *thread_time;
-
-    now = time_msec();
-    thread_time = coverage_clear_time_get();
+    struct stats_shm_coverage *out = stats_shm_coverage_start();
+    size_t i, n;
 
-    /* Initialize the coverage_clear_time. */
-    if (*thread_time == LLONG_MIN) {
-        *thread_time = now + COVERAGE_CLEAR_INTERVAL;
+    if (!out) {
+        return;
     }
-
-    if (now >= *thread_time) {
-        size_t i;
-
-        if (trylock) {
-            /* Returns if cannot acquire lock. */
-            if (ovs_mutex_trylock(&coverage_mutex)) {
-                return;
-            }
-        } else {
-            ovs_mutex_lock(&coverage_mutex);
-        }
-
-        for (i = 0; i < n_coverage_counters; i++) {
-            struct coverage_counter *c = coverage_counters[i];
-            c->total += c->count();
-        }
-        ovs_mutex_unlock(&coverage_mutex);
-        *thread_time = now + COVERAGE_CLEAR_INTERVAL;
+    n = MIN(n_coverage_counters, STATS_SHM_MAX_COVERAGE);
+    for (i = 0; i < n; i++) {
+        ovs_strlcpy(out[i].name, coverage_counters[i]->name,
+                    sizeof out[i].name);
+        out[i].total = coverage_counters[i]->total;
     }
+    stats_shm_coverage_commit(n);
 }
 
+/* Formerly flushed the calling thread's counts into the global totals.
+ * The totals are now aggregated from the per-thread pages by whoever reads
+ * them, so there is nothing for the counting threads to do; these remain
+ * as no-ops so that callers need not care. */
 void
 coverage_clear(void)
 {
-    coverage_clear__(false);
 }
 
 void
 coverage_try_clear(void)
 {
-    coverage_clear__(true);
 }
 
 /* Runs approximately every COVERAGE_RUN_INTERVAL amount of time to update the
@@ -339,6 +441,8 @@ coverage_run(void)
 
     if (now >= coverage_run_time) {
         size_t i, j;
+
+        coverage_aggregate();
         /* Computes the number of COVERAGE_RUN_INTERVAL slots, since
          * it is possible that the actual run interval is multiple of
          * COVERAGE_RUN_INTERVAL. */
@@ -378,6 +482,8 @@ coverage_run(void)
         idx_count = (idx_count + slots) % (MIN_AVG_LEN * HR_AVG_LEN);
         /* Updates the run time. */
         coverage_run_time = now + COVERAGE_RUN_INTERVAL;
+
+        coverage_export_shm();
     }
     ovs_mutex_unlock(&coverage_mutex);
 }
@@ -404,7 +510,7 @@ coverage_read_counter(const char *name, unsigned long long int *count)
 
         if (!strcmp(c->name, name)) {
             ovs_mutex_lock(&coverage_mutex);
-            c->total += c->count();
+            coverage_aggregate();
             *count = c->total;
             ovs_mutex_unlock(&coverage_mutex);
 
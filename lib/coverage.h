@@ -46,7 +46,7 @@ BUILD_ASSERT_DECL(COVERAGE_RUN_INTERVAL % COVERAGE_CLEAR_INTERVAL == 0);
 /* A coverage counter. */
 struct coverage_counter {
     const char *const name;            /* Textual name. */
-    unsigned int (*const count)(void); /* Gets, zeros this thread's count. */
+    unsigned int index;                /* Slot in each thread's counter page. */
     unsigned long long int total;      /* Total count. */
     unsigned long long int last_total;
     /* The moving average arrays. */
@@ -55,26 +55,39 @@ struct coverage_counter {
 };
 
 void coverage_counter_register(struct coverage_counter*);
+unsigned long long int *coverage_page_create(void);
+
+/* This thread's counter page: one slot per registered counter, on cache
+ * lines no other thread writes.  Created on a thread's first increment,
+ * read by whichever thread aggregates the totals. */
+DECLARE_EXTERN_PER_THREAD_DATA(unsigned long long int *, coverage_page);
+
+/* Adds 'n' to 'c': a single unsynchronized increment in this thread's
+ * counter page, cheap enough for per-packet paths.  Readers aggregate the
+ * pages lazily, tolerating the unsynchronized loads (see coverage.c). */
+static inline void
+coverage_counter_add(struct coverage_counter *c, unsigned int n)
+{
+    unsigned long long int *page = *coverage_page_get();
+
+    if (OVS_UNLIKELY(!page)) {
+        page = coverage_page_create();
+        if (OVS_UNLIKELY(!page)) {
+            /* Re-entered while this thread's page was being created
+             * (page creation allocates, and allocation is counted);
+             * drop the increment rather than recurse. */
+            return;
+        }
+    }
+    page[c->index] += n;
+}
 
 /* Defines COUNTER.  There must be exactly one such definition at file scope
  * within a program. */
 #define COVERAGE_DEFINE(COUNTER)                                        \
-        DEFINE_STATIC_PER_THREAD_DATA(unsigned int,                     \
-                                      counter_##COUNTER, 0);            \
-        static unsigned int COUNTER##_count(void)                       \
-        {                                                               \
-            unsigned int *countp = counter_##COUNTER##_get();           \
-            unsigned int count = *countp;                               \
-            *countp = 0;                                                \
-            return count;                                               \
-        }                                                               \
-        static inline void COUNTER##_add(unsigned int n)                \
-        {                                                               \
-            *counter_##COUNTER##_get() += n;                            \
-        }                                                               \
         extern struct coverage_counter counter_##COUNTER;               \
         struct coverage_counter counter_##COUNTER                       \
-            = { #COUNTER, COUNTER##_count, 0, 0, {0}, {0} };            \
+            = { #COUNTER, 0, 0, 0, {0}, {0} };                          \
         OVS_CONSTRUCTOR(COUNTER##_init_coverage) {                      \
             coverage_counter_register(&counter_##COUNTER);              \
         }
@@ -83,7 +96,8 @@ void coverage_counter_register(struct coverage_counter*);
 #define COVERAGE_INC(COUNTER) COVERAGE_ADD(COUNTER, 1)
 
 /* Adds AMOUNT to COUNTER. */
-#define COVERAGE_ADD(COUNTER, AMOUNT) COUNTER##_add(AMOUNT)
+#define COVERAGE_ADD(COUNTER, AMOUNT) \
+        coverage_counter_add(&counter_##COUNTER, AMOUNT)
 
 void coverage_init(void);
 void coverage_log(void);
@@ -16,9 +16,14 @@
 
 #include <config.h>
 #include "csum.h"
+#include "ovs-thread.h"
 #include "unaligned.h"
 #include <sys/types.h>
 #include <netinet/in.h>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define CSUM_USE_VECTOR 1
+#endif
 
 #ifndef __CHECKER__
 /* Returns the IP checksum of the 'n' bytes in 'data'.
@@ -33,15 +38,11 @@ csum(const void *data, size_t n)
     return csum_finish(csum_continue(0, data, n));
 }
 
-/* Adds the 'n' bytes in 'data' to the partial IP checksum 'partial' and
- * returns the updated checksum.  (To start a new checksum, pass 0 for
- * 'partial'.  To obtain the finished checksum, pass the return value to
- * csum_finish().) */
-uint32_t
-csum_continue(uint32_t partial, const void *data_, size_t n)
+/* The plain 16-bits-at-a-time accumulation loop, also used for the odd tail
+ * bytes left over by the vector kernels below. */
+static uint32_t
+csum_continue_scalar(uint32_t partial, const ovs_be16 *data, size_t n)
 {
-    const ovs_be16 *data = data_;
-
     for (; n > 1; n -= 2, data++) {
         partial = csum_add16(partial, get_unaligned_be16(data));
     }
@@ -55,6 +56,110 @@ csum_continue(uint32_t partial, const void *data_, size_t n)
     return partial;
 }
 
+#ifdef CSUM_USE_VECTOR
+/* The vector kernels sum blocks as native 16-bit words, widening into 32-bit
+ * accumulators.  The scalar loop also accumulates raw 16-bit loads, so both
+ * paths sum in the same byte order and the folded result joins 'partial'
+ * directly (a ones-complement sum is correct in any consistent byte order,
+ * RFC 1071).  The accumulators cannot overflow: that would take more than
+ * 2^16 blocks, far beyond any packet. */
+static uint32_t
+csum_vector_join(uint32_t partial, uint64_t sum)
+{
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return partial + sum;
+}
+
+/* 16-byte blocks using SSE2, which is x86_64 baseline. */
+static uint32_t
+csum_continue_sse2(uint32_t partial, const ovs_be16 *data, size_t n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i wide = zero;
+    uint32_t lanes[4];
+
+    do {
+        __m128i v = _mm_loadu_si128((const __m128i *) data);
+
+        wide = _mm_add_epi32(wide, _mm_unpacklo_epi16(v, zero));
+        wide = _mm_add_epi32(wide, _mm_unpackhi_epi16(v, zero));
+        data += sizeof v / sizeof *data;
+        n -= sizeof v;
+    } while (n >= sizeof(__m128i));
+
+    _mm_storeu_si128((__m128i *) lanes, wide);
+    partial = csum_vector_join(partial, (uint64_t) lanes[0] + lanes[1]
+                               + lanes[2] + lanes[3]);
+    return csum_continue_scalar(partial, data, n);
+}
+
+/* 32-byte blocks using AVX2.  Compiled with a target attribute so that a
+ * generic build still contains it; only ever called after a runtime CPU
+ * feature check. */
+static uint32_t __attribute__((__target__("avx2")))
+csum_continue_avx2(uint32_t partial, const ovs_be16 *data, size_t n)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i wide = zero;
+    uint64_t sum;
+
+    do {
+        __m256i v = _mm256_loadu_si256((const __m256i *) data);
+
+        wide = _mm256_add_epi32(wide, _mm256_unpacklo_epi16(v, zero));
+        wide = _mm256_add_epi32(wide, _mm256_unpackhi_epi16(v, zero));
+        data += sizeof v / sizeof *data;
+        n -= sizeof v;
+    } while (n >= sizeof(__m256i));
+
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(wide),
+                                 _mm256_extracti128_si256(wide, 1));
+    sum = (uint32_t) _mm_extract_epi32(half, 0);
+    sum += (uint32_t) _mm_extract_epi32(half, 1);
+    sum += (uint32_t) _mm_extract_epi32(half, 2);
+    sum += (uint32_t) _mm_extract_epi32(half, 3);
+
+    partial = csum_vector_join(partial, sum);
+    return csum_continue_scalar(partial, data, n);
+}
+
+static uint32_t
+csum_continue_vector(uint32_t partial, const ovs_be16 *data, size_t n)
+{
+    static struct ovsthread_once once = OVSTHREAD_ONCE_INITIALIZER;
+    static uint32_t (*impl)(uint32_t, const ovs_be16 *, size_t);
+
+    if (ovsthread_once_start(&once)) {
+        impl = (__builtin_cpu_supports("avx2")
+                ? csum_continue_avx2
+                : csum_continue_sse2);
+        ovsthread_once_done(&once);
+    }
+    return impl(partial, data, n);
+}
+#endif /* CSUM_USE_VECTOR */
+
+/* Adds the 'n' bytes in 'data' to the partial IP checksum 'partial' and
+ * returns the updated checksum.  (To start a new checksum, pass 0 for
+ * 'partial'.  To obtain the finished checksum, pass the return value to
+ * csum_finish().) */
+uint32_t
+csum_continue(uint32_t partial, const void *data_, size_t n)
+{
+    const ovs_be16 *data = data_;
+
+#ifdef CSUM_USE_VECTOR
+    /* The vector kernels pay off once there are a couple of blocks to sum;
+     * short runs (IPv4 headers, pseudoheaders) stay on the scalar path. */
+    if (n >= 2 * sizeof(__m256i)) {
+        return csum_continue_vector(partial, data, n);
+    }
+#endif
+    return csum_continue_scalar(partial, data, n);
+}
+
 /* Returns the IP checksum corresponding to 'partial', which is a value updated
  * by some combination of csum_add16(), csum_add32(), and csum_continue().
  *
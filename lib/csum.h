@@ -51,9 +51,39 @@ csum_add32(uint32_t partial, ovs_be32 new)
 {
     return partial + (new >> 16) + (new & 0xffff);
 }
+/* Adds to 'partial' the checksum delta caused by a 16-bit field changing
+ * from 'old_u16' to 'new_u16'.  The accumulated deltas of several field
+ * changes can be folded into a checksum at once with recalc_csum_delta(),
+ * instead of one recalc_csum16() per field.  See RFC 1624. */
+static inline uint32_t
+csum_delta16(uint32_t partial, ovs_be16 old_u16, ovs_be16 new_u16)
+{
+    return partial + (uint16_t) ~old_u16 + new_u16;
+}
+
+/* Adds to 'partial' the checksum delta caused by a 32-bit field changing
+ * from 'old_u32' to 'new_u32'. */
+static inline uint32_t
+csum_delta32(uint32_t partial, ovs_be32 old_u32, ovs_be32 new_u32)
+{
+    return csum_delta16(csum_delta16(partial, old_u32, new_u32),
+                        old_u32 >> 16, new_u32 >> 16);
+}
+
+/* Returns the new checksum for a packet in which the checksum field
+ * previously contained 'old_csum' and whose field changes have been
+ * accumulated into 'delta' with csum_delta16() and csum_delta32(). */
+static inline ovs_be16
+recalc_csum_delta(ovs_be16 old_csum, uint32_t delta)
+{
+    return csum_finish((uint16_t) ~old_csum + delta);
+}
 #else
 uint32_t csum_add16(uint32_t partial, ovs_be16);
 uint32_t csum_add32(uint32_t partial, ovs_be32);
+uint32_t csum_delta16(uint32_t partial, ovs_be16, ovs_be16);
+uint32_t csum_delta32(uint32_t partial, ovs_be32, ovs_be32);
+ovs_be16 recalc_csum_delta(ovs_be16 old_csum, uint32_t delta);
 #endif
 
 #endif /* csum.h */
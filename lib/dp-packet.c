@@ -19,6 +19,7 @@
 #include <string.h>
 
 #include "dp-packet.h"
+#include "malloc-cache.h"
 #include "netdev-afxdp.h"
 #include "netdev-dpdk.h"
 #include "openvswitch/dynamic-string.h"
@@ -37,6 +38,12 @@ dp_packet_init__(struct dp_packet *b, size_t allocated, enum dp_packet_source so
     dp_packet_init_specific(b);
     /* By default assume the packet type to be Ethernet. */
     b->packet_type = htonl(PT_ETH);
+    b->rx_cycles = 0;
+#ifndef DPDK_NETDEV
+    b->share_donor = NULL;
+    b->share_cnt = 0;
+    b->share_orphan = false;
+#endif
 }
 
 static void
@@ -123,7 +130,9 @@ dp_packet_init_dpdk(struct dp_packet *b)
 void
 dp_packet_init(struct dp_packet *b, size_t size)
 {
-    dp_packet_use(b, size ? xmalloc(size) : NULL, size);
+    void *base = size ? malloc_cache_alloc(&size) : NULL;
+
+    dp_packet_use(b, base, size);
 }
 
 /* Frees memory that 'b' points to. */
@@ -132,7 +141,7 @@ dp_packet_uninit(struct dp_packet *b)
 {
     if (b) {
         if (b->source == DPBUF_MALLOC) {
-            free(dp_packet_base(b));
+            malloc_cache_free(dp_packet_base(b), dp_packet_get_allocated(b));
         } else if (b->source == DPBUF_DPDK) {
 #ifdef DPDK_NETDEV
             /* If this dp_packet was allocated by DPDK it must have been
@@ -141,6 +150,18 @@ dp_packet_uninit(struct dp_packet *b)
 #endif
         } else if (b->source == DPBUF_AFXDP) {
             free_afxdp_buf(b);
+#ifndef DPDK_NETDEV
+        } else if (b->source == DPBUF_SHARED) {
+            struct dp_packet *donor = b->share_donor;
+
+            if (!--donor->share_cnt && donor->share_orphan) {
+                /* The buffer's owner was deleted while we borrowed it; we
+                 * are the last borrower, so free it now. */
+                malloc_cache_free(dp_packet_base(donor),
+                                  dp_packet_get_allocated(donor));
+                malloc_cache_free_fixed(donor, sizeof *donor);
+            }
+#endif
         }
     }
 }
@@ -150,7 +171,7 @@ dp_packet_uninit(struct dp_packet *b)
 struct dp_packet *
 dp_packet_new(size_t size)
 {
-    struct dp_packet *b = xmalloc(sizeof *b);
+    struct dp_packet *b = malloc_cache_alloc_fixed(sizeof *b);
     dp_packet_init(b, size);
     return b;
 }
@@ -174,33 +195,102 @@ dp_packet_clone(const struct dp_packet *buffer)
     return dp_packet_clone_with_headroom(buffer, 0);
 }
 
+/* Creates and returns a shallow clone of 'buffer': a new dp_packet that
+ * borrows 'buffer''s payload instead of copying it.  The owning packet is
+ * refcounted, so the buffer stays valid until both it and all of its clones
+ * have been passed to dp_packet_delete(), in whatever order.
+ *
+ * The clone is read-only and transmit-only: neither the clone nor the
+ * original may have its payload modified or reallocated while the other is
+ * live (per-packet metadata, including the cut length, stays independent).
+ * Refcounting is not thread safe, so the original and all of its clones must
+ * be deleted by the thread that created them.
+ *
+ * Falls back to a deep copy when the buffer cannot be shared, e.g. for
+ * DPDK mbufs or AF_XDP umem frames, whose buffers have their own lifetime
+ * rules. */
+struct dp_packet *
+dp_packet_clone_shared(struct dp_packet *buffer)
+{
+#ifdef DPDK_NETDEV
+    return dp_packet_clone(buffer);
+#else
+    struct dp_packet *donor = buffer;
+    struct dp_packet *clone;
+
+    if (donor->source == DPBUF_SHARED) {
+        /* Clones of clones borrow from the ultimate owner, so that chains
+         * cannot dangle. */
+        donor = donor->share_donor;
+    }
+    if (donor->source != DPBUF_MALLOC
+        || OVS_UNLIKELY(donor->share_cnt == UINT16_MAX)) {
+        return dp_packet_clone(buffer);
+    }
+
+    clone = malloc_cache_alloc_fixed(sizeof *clone);
+    *clone = *buffer;
+    clone->source = DPBUF_SHARED;
+    clone->share_donor = donor;
+    clone->share_cnt = 0;
+    clone->share_orphan = false;
+    donor->share_cnt++;
+
+    return clone;
+#endif
+}
+
 /* Creates and returns a new dp_packet whose data are copied from 'buffer'.
  * The returned dp_packet will additionally have 'headroom' bytes of
  * headroom. */
+static void
+dp_packet_clone_fields__(struct dp_packet *dst, const struct dp_packet *src)
+{
+    uint32_t mark;
+
+    /* Copy the following fields into 'dst': l2_pad_size, l2_5_ofs,
+     * l3_ofs, l4_ofs, cutlen, packet_type, rx_cycles and md. */
+    memcpy(&dst->l2_pad_size, &src->l2_pad_size,
+            sizeof(struct dp_packet) -
+            offsetof(struct dp_packet, l2_pad_size));
+
+    *dp_packet_ol_flags_ptr(dst) = *dp_packet_ol_flags_ptr(src);
+    *dp_packet_ol_flags_ptr(dst) &= DP_PACKET_OL_SUPPORTED_MASK;
+
+    if (dp_packet_rss_valid(src)) {
+        dp_packet_set_rss_hash(dst, dp_packet_get_rss_hash(src));
+    }
+    if (dp_packet_has_flow_mark(src, &mark)) {
+        dp_packet_set_flow_mark(dst, mark);
+    }
+}
+
 struct dp_packet *
 dp_packet_clone_with_headroom(const struct dp_packet *buffer, size_t headroom)
 {
     struct dp_packet *new_buffer;
-    uint32_t mark;
 
     new_buffer = dp_packet_clone_data_with_headroom(dp_packet_data(buffer),
                                                  dp_packet_size(buffer),
                                                  headroom);
-    /* Copy the following fields into the returned buffer: l2_pad_size,
-     * l2_5_ofs, l3_ofs, l4_ofs, cutlen, packet_type and md. */
-    memcpy(&new_buffer->l2_pad_size, &buffer->l2_pad_size,
-            sizeof(struct dp_packet) -
-            offsetof(struct dp_packet, l2_pad_size));
+    dp_packet_clone_fields__(new_buffer, buffer);
 
-    *dp_packet_ol_flags_ptr(new_buffer) = *dp_packet_ol_flags_ptr(buffer);
-    *dp_packet_ol_flags_ptr(new_buffer) &= DP_PACKET_OL_SUPPORTED_MASK;
+    return new_buffer;
+}
 
-    if (dp_packet_rss_valid(buffer)) {
-        dp_packet_set_rss_hash(new_buffer, dp_packet_get_rss_hash(buffer));
-    }
-    if (dp_packet_has_flow_mark(buffer, &mark)) {
-        dp_packet_set_flow_mark(new_buffer, mark);
-    }
+/* Creates and returns a new dp_packet whose data are copied from 'buffer'.
+ * The returned dp_packet will additionally have 'tailroom' bytes of
+ * tailroom, so that a caller that appends up to that much data does not
+ * force a reallocation and a second copy of 'buffer''s data. */
+struct dp_packet *
+dp_packet_clone_with_tailroom(const struct dp_packet *buffer, size_t tailroom)
+{
+    struct dp_packet *new_buffer;
+
+    new_buffer = dp_packet_new(dp_packet_size(buffer) + tailroom);
+    dp_packet_put(new_buffer, dp_packet_data(buffer),
+                  dp_packet_size(buffer));
+    dp_packet_clone_fields__(new_buffer, buffer);
 
     return new_buffer;
 }
@@ -257,9 +347,10 @@ dp_packet_resize(struct dp_packet *b, size_t new_headroom, size_t new_tailroom)
         if (new_headroom == dp_packet_headroom(b)) {
             new_base = xrealloc(dp_packet_base(b), new_allocated);
         } else {
-            new_base = xmalloc(new_allocated);
+            new_base = malloc_cache_alloc(&new_allocated);
             dp_packet_copy__(b, new_base, new_headroom, new_tailroom);
-            free(dp_packet_base(b));
+            malloc_cache_free(dp_packet_base(b),
+                              dp_packet_get_allocated(b));
         }
         break;
 
@@ -267,11 +358,12 @@ dp_packet_resize(struct dp_packet *b, size_t new_headroom, size_t new_tailroom)
         OVS_NOT_REACHED();
 
     case DPBUF_AFXDP:
+    case DPBUF_SHARED:
         OVS_NOT_REACHED();
 
     case DPBUF_STUB:
         b->source = DPBUF_MALLOC;
-        new_base = xmalloc(new_allocated);
+        new_base = malloc_cache_alloc(&new_allocated);
         dp_packet_copy__(b, new_base, new_headroom, new_tailroom);
         break;
 
@@ -455,13 +547,14 @@ dp_packet_steal_data(struct dp_packet *b)
     void *p;
     ovs_assert(b->source != DPBUF_DPDK);
     ovs_assert(b->source != DPBUF_AFXDP);
+    ovs_assert(b->source != DPBUF_SHARED);
 
     if (b->source == DPBUF_MALLOC && dp_packet_data(b) == dp_packet_base(b)) {
         p = dp_packet_data(b);
     } else {
         p = xmemdup(dp_packet_data(b), dp_packet_size(b));
         if (b->source == DPBUF_MALLOC) {
-            free(dp_packet_base(b));
+            malloc_cache_free(dp_packet_base(b), dp_packet_get_allocated(b));
         }
     }
     dp_packet_set_base(b, NULL);
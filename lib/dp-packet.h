@@ -25,6 +25,7 @@
 #include <rte_mbuf.h>
 #endif
 
+#include "malloc-cache.h"
 #include "netdev-afxdp.h"
 #include "netdev-dpdk.h"
 #include "openvswitch/list.h"
@@ -44,6 +45,8 @@ enum OVS_PACKED_ENUM dp_packet_source {
                                 * ref to dp_packet_init_dpdk() in dp-packet.c.
                                 */
     DPBUF_AFXDP,               /* Buffer data from XDP frame. */
+    DPBUF_SHARED,              /* Buffer borrowed from another dp_packet,
+                                * see dp_packet_clone_shared(). */
 };
 
 #define DP_PACKET_CONTEXT_SIZE 64
@@ -120,6 +123,11 @@ struct dp_packet {
     uint32_t ol_flags;          /* Offloading flags. */
     uint32_t rss_hash;          /* Packet hash. */
     uint32_t flow_mark;         /* Packet flow mark. */
+    struct dp_packet *share_donor; /* If 'source' is DPBUF_SHARED, the packet
+                                    * that owns 'base_'; otherwise NULL. */
+    uint16_t share_cnt;         /* Live shallow clones borrowing 'base_'. */
+    bool share_orphan;          /* Deleted while clones were live; the last
+                                 * clone frees this packet. */
 #endif
     enum dp_packet_source source;  /* Source of memory allocated as 'base'. */
 
@@ -134,6 +142,9 @@ struct dp_packet {
                                       or UINT16_MAX. */
     uint32_t cutlen;               /* length in bytes to cut from the end. */
     ovs_be32 packet_type;          /* Packet type as defined in OpenFlow */
+    uint64_t rx_cycles;            /* TSC value when the packet was received
+                                    * from its rxq, or 0.  Only stamped when
+                                    * detailed PMD metrics are enabled. */
     union {
         struct pkt_metadata md;
         uint64_t data[DP_PACKET_CONTEXT_SIZE / 8];
@@ -191,8 +202,11 @@ void dp_packet_uninit(struct dp_packet *);
 struct dp_packet *dp_packet_new(size_t);
 struct dp_packet *dp_packet_new_with_headroom(size_t, size_t headroom);
 struct dp_packet *dp_packet_clone(const struct dp_packet *);
+struct dp_packet *dp_packet_clone_shared(struct dp_packet *);
 struct dp_packet *dp_packet_clone_with_headroom(const struct dp_packet *,
                                                 size_t headroom);
+struct dp_packet *dp_packet_clone_with_tailroom(const struct dp_packet *,
+                                                size_t tailroom);
 struct dp_packet *dp_packet_clone_data(const void *, size_t);
 struct dp_packet *dp_packet_clone_data_with_headroom(const void *, size_t,
                                                      size_t headroom);
@@ -251,8 +265,16 @@ dp_packet_delete(struct dp_packet *b)
             return;
         }
 
+#ifndef DPDK_NETDEV
+        if (OVS_UNLIKELY(b->share_cnt)) {
+            /* Shallow clones still borrow our buffer; the last one to go
+             * away frees it, and us (see dp_packet_clone_shared()). */
+            b->share_orphan = true;
+            return;
+        }
+#endif
         dp_packet_uninit(b);
-        free(b);
+        malloc_cache_free_fixed(b, sizeof *b);
     }
 }
 
@@ -727,6 +749,10 @@ struct dp_packet_batch {
     size_t count;
     bool trunc; /* true if the batch needs truncate. */
     bool do_not_steal; /* Indicate that the packets should not be stolen. */
+    bool may_share_payload; /* Side copies of these packets may borrow their
+                             * payload instead of copying it, because none of
+                             * the actions still to be executed modifies it
+                             * (see odp-execute.c). */
     struct dp_packet *packets[NETDEV_MAX_BURST];
 };
 
@@ -736,6 +762,7 @@ dp_packet_batch_init(struct dp_packet_batch *batch)
     batch->count = 0;
     batch->trunc = false;
     batch->do_not_steal = false;
+    batch->may_share_payload = false;
 }
 
 static inline void
@@ -837,6 +864,22 @@ dp_packet_batch_clone(struct dp_packet_batch *dst,
     dst->trunc = src->trunc;
 }
 
+/* Like dp_packet_batch_clone(), but the clones borrow the originals' payload
+ * where possible instead of copying it.  Only safe if nothing will modify the
+ * originals' payload while any clone is live; see dp_packet_clone_shared(). */
+static inline void
+dp_packet_batch_clone_shared(struct dp_packet_batch *dst,
+                             struct dp_packet_batch *src)
+{
+    struct dp_packet *packet;
+
+    dp_packet_batch_init(dst);
+    DP_PACKET_BATCH_FOR_EACH (i, packet, src) {
+        dp_packet_batch_add(dst, dp_packet_clone_shared(packet));
+    }
+    dst->trunc = src->trunc;
+}
+
 static inline void
 dp_packet_delete_batch(struct dp_packet_batch *batch, bool should_steal)
 {
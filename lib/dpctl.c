@@ -41,6 +41,7 @@
 #include "netlink.h"
 #include "odp-util.h"
 #include "openvswitch/ofpbuf.h"
+#include "ovs-thread.h"
 #include "packets.h"
 #include "openvswitch/shash.h"
 #include "simap.h"
@@ -963,11 +964,85 @@ dpctl_free_portno_names(struct hmap *portno_names)
     }
 }
 
+/* Upper bound on the number of threads walking one flow dump in parallel.
+ * Past this point the threads mostly contend on the dump itself. */
+#define DUMP_FLOWS_MAX_THREADS 8
+
+struct dump_flows_thread_aux {
+    pthread_t thread;
+    struct dpif_flow_dump *flow_dump;
+    /* Shared, read-only while the threads run. */
+    const char *filter;
+    const struct flow *flow_filter;
+    const struct flow_wildcards *wc_filter;
+    struct dump_types *dump_types;
+    struct hmap *portno_names;
+    struct dpctl_params *dpctl_p;
+    /* Flows formatted by this thread, printed by the parent after the
+     * join so output from different threads does not interleave. */
+    struct ds output;
+};
+
+static void *
+dump_flows_thread_main(void *aux_)
+{
+    struct dump_flows_thread_aux *aux = aux_;
+    struct dpif_flow_dump_thread *flow_dump_thread;
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    int pmd_id = PMD_ID_NULL;
+    struct dpif_flow f;
+
+    memset(&f, 0, sizeof f);
+    flow_dump_thread = dpif_flow_dump_thread_create(aux->flow_dump);
+    while (dpif_flow_dump_next(flow_dump_thread, &f, 1)) {
+        if (aux->filter) {
+            struct flow flow;
+            struct flow_wildcards wc;
+            struct match match, match_filter;
+            struct minimatch minimatch;
+
+            odp_flow_key_to_flow(f.key, f.key_len, &flow, NULL);
+            odp_flow_key_to_mask(f.mask, f.mask_len, &wc, &flow, NULL);
+            match_init(&match, &flow, &wc);
+
+            match_init(&match_filter, aux->flow_filter, &wc);
+            match_init(&match_filter, &match_filter.flow, aux->wc_filter);
+            minimatch_init(&minimatch, &match_filter);
+
+            if (!minimatch_matches_flow(&minimatch, &match.flow)) {
+                minimatch_destroy(&minimatch);
+                continue;
+            }
+            minimatch_destroy(&minimatch);
+        }
+        ds_clear(&ds);
+        /* If 'pmd_id' is specified, overlapping flows could be dumped from
+         * different pmd threads.  So, separates dumps from different pmds
+         * by printing a title line.  Each dpif dump thread walks whole pmds
+         * at a time, so all of a pmd's flows stay in one output buffer. */
+        if (pmd_id != f.pmd_id) {
+            if (f.pmd_id == NON_PMD_CORE_ID) {
+                ds_put_format(&ds, "flow-dump from the main thread:\n");
+            } else {
+                ds_put_format(&ds, "flow-dump from pmd on cpu core: %d\n",
+                              f.pmd_id);
+            }
+            pmd_id = f.pmd_id;
+        }
+        if (flow_passes_type_filter(&f, aux->dump_types)) {
+            format_dpif_flow(&ds, &f, aux->portno_names, aux->dpctl_p);
+            ds_put_format(&aux->output, "%s\n", ds_cstr(&ds));
+        }
+    }
+    dpif_flow_dump_thread_destroy(flow_dump_thread);
+    ds_destroy(&ds);
+    return NULL;
+}
+
 static int
 dpctl_dump_flows(int argc, const char *argv[], struct dpctl_params *dpctl_p)
 {
     struct dpif *dpif;
-    struct ds ds;
 
     char *filter = NULL;
     struct flow flow_filter;
@@ -976,10 +1051,10 @@ dpctl_dump_flows(int argc, const char *argv[], struct dpctl_params *dpctl_p)
     struct dump_types dump_types;
     struct dpif_flow_dump_types dpif_dump_types;
 
-    struct dpif_flow_dump_thread *flow_dump_thread;
+    struct dump_flows_thread_aux *auxes;
     struct dpif_flow_dump *flow_dump;
-    struct dpif_flow f;
-    int pmd_id = PMD_ID_NULL;
+    unsigned int n_threads;
+    unsigned int i;
     int lastargc = 0;
     int error;
 
@@ -1041,56 +1116,49 @@ dpctl_dump_flows(int argc, const char *argv[], struct dpctl_params *dpctl_p)
      * in the userspace datapath */
     BUILD_ASSERT(PMD_ID_NULL != NON_PMD_CORE_ID);
 
-    ds_init(&ds);
-    memset(&f, 0, sizeof f);
     flow_dump = dpif_flow_dump_create(dpif, false, &dpif_dump_types);
-    flow_dump_thread = dpif_flow_dump_thread_create(flow_dump);
-    while (dpif_flow_dump_next(flow_dump_thread, &f, 1)) {
-        if (filter) {
-            struct flow flow;
-            struct flow_wildcards wc;
-            struct match match, match_filter;
-            struct minimatch minimatch;
 
-            odp_flow_key_to_flow(f.key, f.key_len, &flow, NULL);
-            odp_flow_key_to_mask(f.mask, f.mask_len, &wc, &flow, NULL);
-            match_init(&match, &flow, &wc);
-
-            match_init(&match_filter, &flow_filter, &wc);
-            match_init(&match_filter, &match_filter.flow, &wc_filter);
-            minimatch_init(&minimatch, &match_filter);
-
-            if (!minimatch_matches_flow(&minimatch, &match.flow)) {
-                minimatch_destroy(&minimatch);
-                continue;
-            }
-            minimatch_destroy(&minimatch);
-        }
-        ds_clear(&ds);
-        /* If 'pmd_id' is specified, overlapping flows could be dumped from
-         * different pmd threads.  So, separates dumps from different pmds
-         * by printing a title line. */
-        if (pmd_id != f.pmd_id) {
-            if (f.pmd_id == NON_PMD_CORE_ID) {
-                ds_put_format(&ds, "flow-dump from the main thread:\n");
-            } else {
-                ds_put_format(&ds, "flow-dump from pmd on cpu core: %d\n",
-                              f.pmd_id);
-            }
-            pmd_id = f.pmd_id;
+    /* Walk the dump with one thread per core (capped), each formatting
+     * into its own buffer.  The dpif layer hands out disjoint portions of
+     * the dump to each thread, so the buffers merge by concatenation. */
+    n_threads = MIN(count_cpu_cores(), DUMP_FLOWS_MAX_THREADS);
+    n_threads = MAX(n_threads, 1);
+    auxes = xmalloc(n_threads * sizeof *auxes);
+    for (i = 0; i < n_threads; i++) {
+        auxes[i].flow_dump = flow_dump;
+        auxes[i].filter = filter;
+        auxes[i].flow_filter = &flow_filter;
+        auxes[i].wc_filter = &wc_filter;
+        auxes[i].dump_types = &dump_types;
+        auxes[i].portno_names = portno_names;
+        auxes[i].dpctl_p = dpctl_p;
+        ds_init(&auxes[i].output);
+    }
+    if (n_threads == 1) {
+        dump_flows_thread_main(&auxes[0]);
+    } else {
+        for (i = 0; i < n_threads; i++) {
+            auxes[i].thread = ovs_thread_create("dump_flows",
+                                                dump_flows_thread_main,
+                                                &auxes[i]);
         }
-        if (flow_passes_type_filter(&f, &dump_types)) {
-            format_dpif_flow(&ds, &f, portno_names, dpctl_p);
-            dpctl_print(dpctl_p, "%s\n", ds_cstr(&ds));
+        for (i = 0; i < n_threads; i++) {
+            xpthread_join(auxes[i].thread, NULL);
         }
     }
-    dpif_flow_dump_thread_destroy(flow_dump_thread);
     error = dpif_flow_dump_destroy(flow_dump);
 
+    for (i = 0; i < n_threads; i++) {
+        if (auxes[i].output.length) {
+            dpctl_print(dpctl_p, "%s", ds_cstr(&auxes[i].output));
+        }
+        ds_destroy(&auxes[i].output);
+    }
+    free(auxes);
+
     if (error) {
         dpctl_error(dpctl_p, error, "Failed to dump flows from datapath");
     }
-    ds_destroy(&ds);
 
 out_dpifclose:
     dpctl_free_portno_names(portno_names);
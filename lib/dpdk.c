@@ -620,7 +620,7 @@ print_dpdk_version(void)
             int has_isa = rte_cpu_get_flag_enabled(RTE_CPUFLAG);        \
             VLOG_DBG("CPU flag %s, available %s\n", name_str,           \
                       has_isa ? "yes" : "no");                          \
-            return true;                                                \
+            return has_isa;                                             \
         }                                                               \
     } while (0)
 
@@ -635,6 +635,9 @@ dpdk_get_cpu_has_isa(const char *arch, const char *feature)
 #if __x86_64__
     /* CPU flags only defined for the architecture that support it. */
     CHECK_CPU_FEATURE(feature, "avx512f", RTE_CPUFLAG_AVX512F);
+    CHECK_CPU_FEATURE(feature, "avx512bw", RTE_CPUFLAG_AVX512BW);
+    CHECK_CPU_FEATURE(feature, "avx512vpopcntdq",
+                      RTE_CPUFLAG_AVX512VPOPCNTDQ);
     CHECK_CPU_FEATURE(feature, "bmi2", RTE_CPUFLAG_BMI2);
 #endif
 
@@ -0,0 +1,180 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef __x86_64__
+#if !defined(__CHECKER__)
+
+#include <config.h>
+
+#include "dpif-netdev-extract.h"
+
+#include "dp-packet.h"
+#include "dpdk.h"
+#include "flow.h"
+#include "packets.h"
+
+#include "immintrin.h"
+
+/* AVX-512 specialized miniflow extraction.
+ *
+ * A single masked byte-compare classifies the packet against a header
+ * profile (EtherType and IPv4 version/IHL); on a hit the miniflow map and
+ * value blocks are written with straight-line code in the exact layout
+ * the scalar miniflow_extract() produces, with no per-field branching.
+ * Anything outside the profiles - VLAN tags, IP options, fragments, or
+ * non-trivial packet metadata - falls back to the scalar code.
+ */
+
+/* Bytes validated by the profile compare: EtherType (12, 13) and the IPv4
+ * version/IHL byte (14). The masked load suppresses faults on all other
+ * bytes, so short packets near the end of a page are safe to probe. */
+#define MFEX_PROFILE_ETH_IPV4_KMASK 0x7000ULL
+
+static const uint8_t mfex_profile_eth_ipv4[64] = {
+    [12] = 0x08, [13] = 0x00,   /* EtherType: IPv4, no VLAN. */
+    [14] = 0x45,                /* IPv4, no options. */
+};
+
+static bool
+mfex_avx512_ipv4(struct dp_packet *packet, struct miniflow *mf)
+{
+    const struct pkt_metadata *md = &packet->md;
+    const uint8_t *data = dp_packet_data(packet);
+    size_t size = dp_packet_size(packet);
+
+    /* The profiles only cover packets with trivial metadata; tunnel,
+     * conntrack or recirculation state changes the miniflow layout and is
+     * handled by the scalar code. */
+    if (flow_tnl_dst_is_set(&md->tunnel) || md->skb_priority || md->pkt_mark
+        || md->ct_state || md->recirc_id
+        || packet->packet_type != htonl(PT_ETH)) {
+        return false;
+    }
+
+    if (OVS_UNLIKELY(size < ETH_HEADER_LEN + IP_HEADER_LEN
+                            + UDP_HEADER_LEN)) {
+        return false;
+    }
+
+    __m512i v_pkt = _mm512_maskz_loadu_epi8(MFEX_PROFILE_ETH_IPV4_KMASK,
+                                            data);
+    __m512i v_prof = _mm512_loadu_si512(mfex_profile_eth_ipv4);
+    if (_mm512_mask_cmpneq_epi8_mask(MFEX_PROFILE_ETH_IPV4_KMASK,
+                                     v_pkt, v_prof)) {
+        return false;
+    }
+
+    const struct ip_header *nh = (const void *) (data + ETH_HEADER_LEN);
+    uint8_t nw_proto = nh->ip_proto;
+    uint16_t tot_len = ntohs(nh->ip_tot_len);
+
+    if (nw_proto != IPPROTO_TCP && nw_proto != IPPROTO_UDP) {
+        return false;
+    }
+    /* Same sanity checks as ipv4_sanity_check(), with IHL fixed at 5 by
+     * the profile compare above. Fragments take the scalar path as their
+     * L4 handling differs. */
+    if (OVS_UNLIKELY(tot_len < IP_HEADER_LEN
+                     || size - ETH_HEADER_LEN < tot_len)) {
+        return false;
+    }
+    if (OVS_UNLIKELY(IP_IS_FRAGMENT(nh->ip_frag_off))) {
+        return false;
+    }
+    if (OVS_UNLIKELY(tot_len < IP_HEADER_LEN
+                     + (nw_proto == IPPROTO_TCP ? TCP_HEADER_LEN
+                                                : UDP_HEADER_LEN))) {
+        return false;
+    }
+
+    dp_packet_reset_offsets(packet);
+    dp_packet_set_l2_pad_size(packet, size - ETH_HEADER_LEN - tot_len);
+    packet->l3_ofs = ETH_HEADER_LEN;
+    packet->l4_ofs = ETH_HEADER_LEN + IP_HEADER_LEN;
+
+    /* Write the miniflow exactly as the scalar code lays it out for these
+     * profiles: each 8-byte block mirrors one uint64_t unit of struct
+     * flow, in ascending unit order. */
+    char *b = (char *) miniflow_values(mf);
+    uint32_t in_port = odp_to_u32(md->in_port.odp_port);
+    ovs_be32 packet_type = packet->packet_type;
+
+    flowmap_init(&mf->map);
+    FLOWMAP_SET(&mf->map, dp_hash);     /* Shares a unit with in_port. */
+    FLOWMAP_SET(&mf->map, packet_type);
+    FLOWMAP_SET(&mf->map, dl_dst);
+    FLOWMAP_SET(&mf->map, dl_type);     /* Unit with the dl_src tail. */
+    FLOWMAP_SET(&mf->map, nw_src);      /* Shares a unit with nw_dst. */
+    FLOWMAP_SET(&mf->map, ipv6_label);  /* Unit with nw_frag..nw_proto. */
+    FLOWMAP_SET(&mf->map, tp_src);      /* Unit with the ct ports. */
+
+    /* Block 0: dp_hash, in_port. */
+    memcpy(b, &md->dp_hash, sizeof md->dp_hash);
+    memcpy(b + 4, &in_port, sizeof in_port);
+    /* Block 1: zeroed ct_mark, packet_type. */
+    memset(b + 8, 0, 4);
+    memcpy(b + 12, &packet_type, sizeof packet_type);
+    /* Blocks 2 and 3: dl_dst, dl_src, dl_type and its zero padding. */
+    memcpy(b + 16, data, 12);
+    memcpy(b + 28, data + 12, 2);
+    memset(b + 30, 0, 2);
+    /* Block 4: nw_src, nw_dst. */
+    memcpy(b + 32, &nh->ip_src, 8);
+    /* Block 5: zero ipv6_label, nw_frag (zero), nw_tos, nw_ttl, nw_proto. */
+    memset(b + 40, 0, 5);
+    b[45] = nh->ip_tos;
+    b[46] = nh->ip_ttl;
+    b[47] = nw_proto;
+
+    if (nw_proto == IPPROTO_TCP) {
+        const struct tcp_header *tcp
+            = (const void *) (data + ETH_HEADER_LEN + IP_HEADER_LEN);
+        ovs_be16 tcp_flags = TCP_FLAGS_BE16(tcp->tcp_ctl);
+
+        FLOWMAP_SET(&mf->map, tcp_flags);  /* Unit with the arp_tha tail. */
+
+        /* Block 6: zeroed arp_tha tail, tcp_flags, zero pad2. */
+        memset(b + 48, 0, 4);
+        memcpy(b + 52, &tcp_flags, sizeof tcp_flags);
+        memset(b + 54, 0, 2);
+        /* Block 7: tp_src, tp_dst, zeroed ct ports. */
+        memcpy(b + 56, &tcp->tcp_src, 4);
+        memset(b + 60, 0, 4);
+    } else {
+        const struct udp_header *udp
+            = (const void *) (data + ETH_HEADER_LEN + IP_HEADER_LEN);
+
+        /* Block 6: tp_src, tp_dst, zeroed ct ports. */
+        memcpy(b + 48, &udp->udp_src, 4);
+        memset(b + 52, 0, 4);
+    }
+
+    return true;
+}
+
+miniflow_extract_func
+dp_mfex_avx512_ipv4_probe(void)
+{
+    int avx512f_available = dpdk_get_cpu_has_isa("x86_64", "avx512f");
+    int avx512bw_available = dpdk_get_cpu_has_isa("x86_64", "avx512bw");
+
+    if (!avx512f_available || !avx512bw_available) {
+        return NULL;
+    }
+
+    return mfex_avx512_ipv4;
+}
+
+#endif /* CHECKER */
+#endif /* __x86_64__ */
@@ -0,0 +1,197 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <string.h>
+
+#include "dpif-netdev-extract.h"
+
+#include "dp-packet.h"
+#include "flow.h"
+#include "openvswitch/vlog.h"
+#include "util.h"
+
+VLOG_DEFINE_THIS_MODULE(dpif_netdev_extract);
+
+static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 20);
+
+/* Actual list of implementations goes here */
+static struct dp_mfex_impl_info_t mfex_impls[] = {
+    /* The autovalidator implementation will not be used by default, the
+     * user may enable it at runtime using the normal "prio-set" command
+     * if desired.  It cross-checks every other implementation against the
+     * scalar code, so it is a debug tool, not a fast path.
+     */
+    { .prio = 0,
+      .probe = dp_mfex_autovalidator_probe,
+      .name = "autovalidator", },
+
+    /* The scalar miniflow_extract() in lib/flow.c.  A NULL probe stands
+     * for the direct call, so the default fast path pays no indirect call.
+     */
+    { .prio = 1,
+      .probe = NULL,
+      .name = "scalar", },
+
+#if (__x86_64__ && HAVE_AVX512F && HAVE_LD_AVX512_GOOD && __SSE4_2__)
+    /* Only available on x86_64 bit builds with SSE 4.2 used for OVS core.
+     * The same compile time requirements gate the dpcls AVX-512 lookup;
+     * see lib/dpif-netdev-lookup.c for the reasoning.
+     */
+    { .prio = 0,
+      .probe = dp_mfex_avx512_ipv4_probe,
+      .name = "avx512_ipv4", },
+#endif
+};
+
+int32_t
+dp_mfex_impl_info_get(struct dp_mfex_impl_info_t **out_ptr)
+{
+    if (out_ptr == NULL) {
+        return -1;
+    }
+
+    *out_ptr = mfex_impls;
+    return ARRAY_SIZE(mfex_impls);
+}
+
+/* sets the priority of the extract function with "name". */
+int32_t
+dp_mfex_set_prio(const char *name, uint8_t priority)
+{
+    for (int i = 0; i < ARRAY_SIZE(mfex_impls); i++) {
+        if (strcmp(name, mfex_impls[i].name) == 0) {
+                mfex_impls[i].prio = priority;
+                VLOG_INFO("Miniflow extract function '%s' set priority to "
+                          "%d\n", name, priority);
+                return 0;
+        }
+    }
+    VLOG_WARN("Miniflow extract function '%s' not found, failed to set "
+              "priority\n", name);
+    return -EINVAL;
+}
+
+miniflow_extract_func
+dp_mfex_get_best_impl(void)
+{
+    /* Iter over each extract impl, and get highest priority one. */
+    int32_t prio = -1;
+    const char *name = NULL;
+    miniflow_extract_func best_func = NULL;
+
+    for (int i = 0; i < ARRAY_SIZE(mfex_impls); i++) {
+        int32_t probed_prio = mfex_impls[i].prio;
+        if (probed_prio > prio) {
+            miniflow_extract_func probed_func;
+            if (mfex_impls[i].probe) {
+                probed_func = mfex_impls[i].probe();
+                if (!probed_func) {
+                    continue;
+                }
+            } else {
+                /* The scalar entry: always available, and represented as
+                 * a NULL function pointer so that callers invoke
+                 * miniflow_extract() directly. */
+                probed_func = NULL;
+            }
+            best_func = probed_func;
+            prio = probed_prio;
+            name = mfex_impls[i].name;
+        }
+    }
+
+    VLOG_DBG("Miniflow extract function '%s', priority %d\n", name, prio);
+
+    return best_func;
+}
+
+/* The autovalidator runs every probed implementation on the packet and
+ * compares the resulting miniflow and layer offsets against the scalar
+ * miniflow_extract().  Any mismatch is logged; the scalar result is what
+ * gets returned, so forwarding behaviour does not change.
+ */
+static bool
+dp_mfex_autovalidator(struct dp_packet *packet, struct miniflow *mf)
+{
+    struct dp_mfex_impl_info_t *impls = NULL;
+    int32_t count = dp_mfex_impl_info_get(&impls);
+    struct {
+        struct miniflow mf;
+        uint64_t buf[FLOW_U64S];
+    } good, test;
+    uint16_t good_l2_5_ofs, good_l3_ofs, good_l4_ofs;
+    uint8_t good_l2_pad_size;
+    size_t good_n_values;
+
+    miniflow_extract(packet, &good.mf);
+    good_n_values = miniflow_n_values(&good.mf);
+    good_l2_pad_size = dp_packet_l2_pad_size(packet);
+    good_l2_5_ofs = packet->l2_5_ofs;
+    good_l3_ofs = packet->l3_ofs;
+    good_l4_ofs = packet->l4_ofs;
+
+    for (int i = 0; i < count; i++) {
+        miniflow_extract_func func;
+
+        if (!impls[i].probe) {
+            continue;
+        }
+        func = impls[i].probe();
+        if (!func || func == dp_mfex_autovalidator) {
+            continue;
+        }
+
+        memset(&test, 0, sizeof test);
+        if (!func(packet, &test.mf)) {
+            /* Falling back to scalar is always a correct answer. */
+            continue;
+        }
+
+        if (memcmp(&test.mf.map, &good.mf.map, sizeof good.mf.map)
+            || memcmp(test.buf, good.buf,
+                      good_n_values * sizeof good.buf[0])) {
+            VLOG_ERR_RL(&rl, "miniflow extract implementation '%s' does not "
+                        "match the scalar miniflow_extract()", impls[i].name);
+        }
+        if (dp_packet_l2_pad_size(packet) != good_l2_pad_size
+            || packet->l2_5_ofs != good_l2_5_ofs
+            || packet->l3_ofs != good_l3_ofs
+            || packet->l4_ofs != good_l4_ofs) {
+            VLOG_ERR_RL(&rl, "miniflow extract implementation '%s' set "
+                        "layer offsets differing from the scalar "
+                        "miniflow_extract()", impls[i].name);
+        }
+    }
+
+    /* Leave the packet and 'mf' exactly as the scalar code built them. */
+    dp_packet_set_l2_pad_size(packet, good_l2_pad_size);
+    packet->l2_5_ofs = good_l2_5_ofs;
+    packet->l3_ofs = good_l3_ofs;
+    packet->l4_ofs = good_l4_ofs;
+    mf->map = good.mf.map;
+    memcpy(miniflow_values(mf), good.buf,
+           good_n_values * sizeof good.buf[0]);
+
+    return true;
+}
+
+miniflow_extract_func
+dp_mfex_autovalidator_probe(void)
+{
+    /* Degenerates to the scalar code when no other implementation probes
+     * successfully, so it is always available. */
+    return dp_mfex_autovalidator;
+}
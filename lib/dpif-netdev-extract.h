@@ -0,0 +1,79 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DPIF_NETDEV_EXTRACT_H
+#define DPIF_NETDEV_EXTRACT_H 1
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct dp_packet;
+struct miniflow;
+
+/* Optimized miniflow extraction function.  An implementation handles a
+ * small set of common traffic profiles; it returns true if 'packet'
+ * matched one of them and 'mf' and the packet layer offsets were fully
+ * populated, or false if the caller must fall back to the scalar
+ * miniflow_extract().
+ */
+typedef bool (*miniflow_extract_func)(struct dp_packet *packet,
+                                      struct miniflow *mf);
+
+/* Function to probe for an optimized extract implementation.  Returns NULL
+ * if the implementation is not usable on this CPU or build, or a valid
+ * function pointer to call per packet on success.
+ */
+typedef miniflow_extract_func (*dp_mfex_probe_func)(void);
+
+/* Probe function for the autovalidator, which cross-checks every probed
+ * implementation against the scalar code on each packet. */
+miniflow_extract_func dp_mfex_autovalidator_probe(void);
+
+/* Probe function for the AVX-512 IPv4 implementation, specialized for
+ * Ether/IPv4/TCP and Ether/IPv4/UDP (including the outer headers of
+ * VXLAN-encapsulated traffic). */
+miniflow_extract_func dp_mfex_avx512_ipv4_probe(void);
+
+
+/* Extract implementation registration and iteration helpers */
+struct dp_mfex_impl_info_t {
+    /* higher priority gets used over lower values. This allows deployments
+     * to select the best implementation for the use-case.
+     */
+    uint8_t prio;
+
+    /* Probe function: tests if the implementation can run on this CPU.
+     * A NULL probe stands for the scalar miniflow_extract() itself, which
+     * is always available and is represented to callers as a NULL
+     * miniflow_extract_func.
+     */
+    dp_mfex_probe_func probe;
+
+    /* Human readable name, used in setting extract priority commands */
+    const char *name;
+};
+
+int32_t dp_mfex_set_prio(const char *name, uint8_t priority);
+
+/* Returns the highest priority available implementation, or NULL if the
+ * scalar miniflow_extract() should be called directly. */
+miniflow_extract_func dp_mfex_get_best_impl(void);
+
+/* Retrieve the array of extract implementations for iteration.
+ * On error, returns a negative number.
+ * On success, returns the size of the array pointed to by the out parameter.
+ */
+int32_t dp_mfex_impl_info_get(struct dp_mfex_impl_info_t **out_ptr);
+
+#endif /* dpif-netdev-extract.h */
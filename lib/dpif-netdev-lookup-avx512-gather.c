@@ -63,6 +63,18 @@ _mm512_popcnt_epi64_manual(__m512i v_in)
     return _mm512_sad_epu8(v_u8_pop, _mm512_setzero_si512());
 }
 
+/* Wrapper function required to enable the AVX512-VPOPCNTDQ ISA for just
+ * the single instruction.  The compile time checks for the rest of this
+ * file do not include vpopcntdq, so the lookup functions that use it are
+ * only ever selected after a successful runtime probe.
+ */
+static inline __m512i
+__attribute__((__target__("avx512vpopcntdq")))
+_mm512_popcnt_epi64_wrapper(__m512i v_in)
+{
+    return _mm512_popcnt_epi64(v_in);
+}
+
 static inline uint64_t
 netdev_rule_matches_key(const struct dpcls_rule *rule,
                         const uint32_t mf_bits_total,
@@ -92,7 +104,8 @@ avx512_lookup_impl(struct dpcls_subtable *subtable,
                    const struct netdev_flow_key *keys[],
                    struct dpcls_rule **rules,
                    const uint32_t bit_count_u0,
-                   const uint32_t bit_count_u1)
+                   const uint32_t bit_count_u1,
+                   const bool use_vpop)
 {
     OVS_ALIGNED_VAR(CACHE_LINE_SIZE)uint64_t block_cache[BLOCKS_CACHE_SIZE];
 
@@ -131,8 +144,15 @@ avx512_lookup_impl(struct dpcls_subtable *subtable,
         /* Bitmask by pre-created masks. */
         __m512i v_masks = _mm512_and_si512(v_pkt_bits, v_mf_masks);
 
-        /* Manual AVX512 popcount for u64 lanes. */
-        __m512i v_popcnts = _mm512_popcnt_epi64_manual(v_masks);
+        /* AVX512 popcount for u64 lanes.  The hardware instruction is only
+         * used when the runtime probe found AVX512-VPOPCNTDQ; 'use_vpop' is
+         * a compile time constant here, so the other branch is dropped. */
+        __m512i v_popcnts;
+        if (use_vpop) {
+            v_popcnts = _mm512_popcnt_epi64_wrapper(v_masks);
+        } else {
+            v_popcnts = _mm512_popcnt_epi64_manual(v_masks);
+        }
 
         /* Offset popcounts for u1 with pre-created offset register. */
         __m512i v_indexes = _mm512_add_epi64(v_popcnts, v_idx_u0_offset);
@@ -204,7 +224,9 @@ avx512_lookup_impl(struct dpcls_subtable *subtable,
     return found_map;
 }
 
-/* Expand out specialized functions with U0 and U1 bit attributes. */
+/* Expand out specialized functions with U0 and U1 bit attributes.  Each
+ * combination is built twice, with and without the AVX512-VPOPCNTDQ
+ * popcount; the probe picks the vpop variant when the CPU supports it. */
 #define DECLARE_OPTIMIZED_LOOKUP_FUNCTION(U0, U1)                             \
     static uint32_t                                                           \
     dpcls_avx512_gather_mf_##U0##_##U1(struct dpcls_subtable *subtable,       \
@@ -212,9 +234,25 @@ avx512_lookup_impl(struct dpcls_subtable *subtable,
                                        const struct netdev_flow_key *keys[],  \
                                        struct dpcls_rule **rules)             \
     {                                                                         \
-        return avx512_lookup_impl(subtable, keys_map, keys, rules, U0, U1);   \
+        return avx512_lookup_impl(subtable, keys_map, keys, rules, U0, U1,    \
+                                  false);                                     \
+    }                                                                         \
+                                                                              \
+    static uint32_t                                                           \
+    __attribute__((__target__("avx512vpopcntdq")))                            \
+    dpcls_avx512_gather_mf_##U0##_##U1##_vpop(struct dpcls_subtable *subtable,\
+                                       uint32_t keys_map,                     \
+                                       const struct netdev_flow_key *keys[],  \
+                                       struct dpcls_rule **rules)             \
+    {                                                                         \
+        return avx512_lookup_impl(subtable, keys_map, keys, rules, U0, U1,    \
+                                  true);                                      \
     }                                                                         \
 
+DECLARE_OPTIMIZED_LOOKUP_FUNCTION(7, 1)
+DECLARE_OPTIMIZED_LOOKUP_FUNCTION(6, 2)
+DECLARE_OPTIMIZED_LOOKUP_FUNCTION(6, 1)
+DECLARE_OPTIMIZED_LOOKUP_FUNCTION(5, 3)
 DECLARE_OPTIMIZED_LOOKUP_FUNCTION(5, 1)
 DECLARE_OPTIMIZED_LOOKUP_FUNCTION(4, 1)
 DECLARE_OPTIMIZED_LOOKUP_FUNCTION(4, 0)
@@ -223,7 +261,14 @@ DECLARE_OPTIMIZED_LOOKUP_FUNCTION(4, 0)
 #define CHECK_LOOKUP_FUNCTION(U0, U1)                                         \
     ovs_assert((U0 + U1) <= NUM_U64_IN_ZMM_REG);                              \
     if (!f && u0_bits == U0 && u1_bits == U1) {                               \
-        f = dpcls_avx512_gather_mf_##U0##_##U1;                               \
+        if (vpop_available) {                                                 \
+            f = dpcls_avx512_gather_mf_##U0##_##U1##_vpop;                    \
+        } else {                                                              \
+            f = dpcls_avx512_gather_mf_##U0##_##U1;                           \
+        }                                                                     \
+        VLOG_INFO("Using avx512_gather_mf_%d_%d%s for subtable (%d,%d)\n",    \
+                  U0, U1, vpop_available ? "_vpop" : "",                      \
+                  u0_bits, u1_bits);                                          \
     }
 
 static uint32_t
@@ -233,7 +278,21 @@ dpcls_avx512_gather_mf_any(struct dpcls_subtable *subtable, uint32_t keys_map,
 {
     return avx512_lookup_impl(subtable, keys_map, keys, rules,
                               subtable->mf_bits_set_unit0,
-                              subtable->mf_bits_set_unit1);
+                              subtable->mf_bits_set_unit1,
+                              false);
+}
+
+static uint32_t
+__attribute__((__target__("avx512vpopcntdq")))
+dpcls_avx512_gather_mf_any_vpop(struct dpcls_subtable *subtable,
+                                uint32_t keys_map,
+                                const struct netdev_flow_key *keys[],
+                                struct dpcls_rule **rules)
+{
+    return avx512_lookup_impl(subtable, keys_map, keys, rules,
+                              subtable->mf_bits_set_unit0,
+                              subtable->mf_bits_set_unit1,
+                              true);
 }
 
 dpcls_subtable_lookup_func
@@ -243,18 +302,24 @@ dpcls_subtable_avx512_gather_probe(uint32_t u0_bits, uint32_t u1_bits)
 
     int avx512f_available = dpdk_get_cpu_has_isa("x86_64", "avx512f");
     int bmi2_available = dpdk_get_cpu_has_isa("x86_64", "bmi2");
+    int vpop_available = dpdk_get_cpu_has_isa("x86_64", "avx512vpopcntdq");
     if (!avx512f_available || !bmi2_available) {
         return NULL;
     }
 
+    CHECK_LOOKUP_FUNCTION(7, 1);
+    CHECK_LOOKUP_FUNCTION(6, 2);
+    CHECK_LOOKUP_FUNCTION(6, 1);
+    CHECK_LOOKUP_FUNCTION(5, 3);
     CHECK_LOOKUP_FUNCTION(5, 1);
     CHECK_LOOKUP_FUNCTION(4, 1);
     CHECK_LOOKUP_FUNCTION(4, 0);
 
     if (!f && (u0_bits + u1_bits) < NUM_U64_IN_ZMM_REG) {
-        f = dpcls_avx512_gather_mf_any;
-        VLOG_INFO("Using avx512_gather_mf_any for subtable (%d,%d)\n",
-                  u0_bits, u1_bits);
+        f = vpop_available ? dpcls_avx512_gather_mf_any_vpop
+                           : dpcls_avx512_gather_mf_any;
+        VLOG_INFO("Using avx512_gather_mf_any%s for subtable (%d,%d)\n",
+                  vpop_available ? "_vpop" : "", u0_bits, u1_bits);
     }
 
     return f;
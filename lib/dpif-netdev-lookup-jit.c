@@ -0,0 +1,403 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+#include "dpif-netdev.h"
+#include "dpif-netdev-private.h"
+#include "dpif-netdev-lookup.h"
+
+#include "bitmap.h"
+#include "cmap.h"
+#include "flow.h"
+#include "openvswitch/list.h"
+#include "ovs-thread.h"
+#include "util.h"
+
+VLOG_DEFINE_THIS_MODULE(dpif_lookup_jit);
+
+/* Runtime code-generation tier for dpcls subtable lookup
+ * ======================================================
+ *
+ * The hand-written specializations in dpif-netdev-lookup-generic.c cover
+ * a fixed set of (u0,u1) miniflow bit counts; a deployment whose heavy
+ * subtables fall outside that set is stuck with the generic loop.  This
+ * tier closes the gap at runtime: for the exact miniflow unit pattern of
+ * a subtable it emits a straight-line native flatten - the per-packet
+ * inner loop the static specializations exist to unroll - with the
+ * subtable's mf_masks baked in as immediates, so there is no loop
+ * control, no mask loads and no mispredicted per-block branches.
+ *
+ * The flatten depends only on the mask's flowmap bits ('mf_masks' is
+ * derived from them, see netdev_flow_key_gen_masks()), so compiled code
+ * is cached per mask shape and shared by every subtable - in any
+ * datapath - with that shape.  Compilation happens on first lookup;
+ * until the code is ready, or when another thread holds the compile
+ * lock, the call is served by the generic implementation, so warmup
+ * never stalls a PMD.  Blobs are a few hundred bytes and shapes are
+ * few, so the cache is never evicted.
+ *
+ * Hashing, the cmap probe and rule verification stay in C: they are
+ * shape-independent, and the verify loop's trip count is data-dependent
+ * per packet anyway. */
+
+/* Lookup functions below depend on the internal structure of flowmap. */
+BUILD_ASSERT_DECL(FLOWMAP_UNITS == 2);
+
+/* The generated code flattens one packet's miniflow into 'blocks':
+ * blocks[i] = pkt_blocks[popcount(mf_masks[i] & pkt_bits)]
+ *             & tbl_blocks[i]
+ *             & (packet has block i ? ~0 : 0)
+ * for every block the subtable matches on, unit 0 first.  'u0_pop' is
+ * count_1bits(pkt_bits_u0), the offset of unit 1's packet blocks. */
+typedef void (*dpcls_jit_flatten_func)(const uint64_t *pkt_blocks,
+                                       const uint64_t *tbl_blocks,
+                                       uint64_t *blocks,
+                                       uint64_t pkt_bits_u0,
+                                       uint64_t pkt_bits_u1,
+                                       uint32_t u0_pop);
+
+struct block_array_jit {
+    uint32_t count; /* Number of items allocated in 'blocks' */
+    uint64_t blocks[];
+};
+
+DEFINE_PER_THREAD_MALLOCED_DATA(struct block_array_jit *, block_array_jit);
+
+static inline uint64_t *
+get_blocks_scratch_jit(uint32_t required_count)
+{
+    struct block_array_jit *array = block_array_jit_get();
+
+    if (OVS_UNLIKELY(!array || array->count < required_count)) {
+        array = xrealloc(array, sizeof *array +
+                         (required_count * sizeof array->blocks[0]));
+        array->count = required_count;
+        block_array_jit_set_unsafe(array);
+        VLOG_DBG("Block array resized to %"PRIu32, required_count);
+    }
+
+    return &array->blocks[0];
+}
+
+/* Compares a rule and the blocks representing a key, returns 1 on a match. */
+static inline uint64_t
+netdev_rule_matches_key(const struct dpcls_rule *rule,
+                        const uint32_t mf_bits_total,
+                        const uint64_t *blocks)
+{
+    const uint64_t *keyp = miniflow_get_values(&rule->flow.mf);
+    const uint64_t *maskp = miniflow_get_values(&rule->mask->mf);
+    uint64_t not_match = 0;
+
+    for (int i = 0; i < mf_bits_total; i++) {
+        not_match |= (blocks[i] & maskp[i]) != keyp[i];
+    }
+
+    return !not_match;
+}
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+#include <sys/mman.h>
+#include <errno.h>
+
+#include "bpf/ubpf_jit_x86_64.h"
+
+/* Compiled flatten per mask shape.  Entries are only ever appended, under
+ * 'dpcls_jit_mutex', and never freed: readers cache the function pointer
+ * in their subtable and the set of shapes a deployment produces is small
+ * and stable. */
+struct dpcls_jit_shape {
+    struct ovs_list list_node;  /* In 'dpcls_jit_shapes'. */
+    uint64_t map_bits[FLOWMAP_UNITS];
+    dpcls_jit_flatten_func flatten;
+};
+
+static struct ovs_mutex dpcls_jit_mutex = OVS_MUTEX_INITIALIZER;
+static struct ovs_list dpcls_jit_shapes OVS_GUARDED_BY(dpcls_jit_mutex)
+    = OVS_LIST_INITIALIZER(&dpcls_jit_shapes);
+
+/* Code emission could only fail on mmap()/mprotect() trouble; once it
+ * does, stop trying and leave every subtable on the generic path. */
+static bool dpcls_jit_broken OVS_GUARDED_BY(dpcls_jit_mutex);
+
+/* lea (base,index,8), dst */
+static void
+emit_lea_index8(struct jit_state *state, int base, int index, int dst)
+{
+    emit_rex(state, 1, !!(dst & 8), !!(index & 8), !!(base & 8));
+    emit1(state, 0x8d);
+    emit_modrm(state, 0x00, dst, 0x04);
+    emit1(state, 0xc0 | ((index & 7) << 3) | (base & 7));
+}
+
+/* mov (base,index,8), dst.  'base' must not be RBP/R13: with mod=00 that
+ * encoding means disp32 instead. */
+static void
+emit_load_index8(struct jit_state *state, int base, int index, int dst)
+{
+    emit_rex(state, 1, !!(dst & 8), !!(index & 8), !!(base & 8));
+    emit1(state, 0x8b);
+    emit_modrm(state, 0x00, dst, 0x04);
+    emit1(state, 0xc0 | ((index & 7) << 3) | (base & 7));
+}
+
+/* popcnt src, dst */
+static void
+emit_popcnt(struct jit_state *state, int src, int dst)
+{
+    emit1(state, 0xf3);
+    emit_rex(state, 1, !!(dst & 8), 0, !!(src & 8));
+    emit1(state, 0x0f);
+    emit1(state, 0xb8);
+    emit_modrm_reg2reg(state, dst, src);
+}
+
+/* Emits the flatten of one subtable block: the branchless body of
+ * netdev_flow_key_flatten_unit() with 'mf_mask' as an immediate.
+ * 'bits_reg' holds the packet's flowmap bits for this unit, 'base_reg'
+ * the packet blocks for this unit; RDX and RSI index the output and the
+ * table blocks flat across both units via 'disp'.  Clobbers RAX, R10 and
+ * R11. */
+static void
+emit_flatten_block(struct jit_state *state, uint64_t mf_mask, int bits_reg,
+                   int base_reg, int32_t disp)
+{
+    emit_load_imm(state, R10, mf_mask);
+    emit_mov(state, R10, R11);
+    emit_alu64(state, 0x21, bits_reg, R11);     /* and bits, r11 */
+    emit_popcnt(state, R11, R11);               /* pkt_idx */
+    emit_load_index8(state, base_reg, R11, RAX); /* pkt_blocks[pkt_idx] */
+
+    /* and disp(%rsi), %rax: mask by the table block. */
+    emit_basic_rex(state, 1, RAX, RSI);
+    emit1(state, 0x23);
+    emit_modrm_and_displacement(state, RAX, RSI, disp);
+
+    /* no_bit = packet has this block ? ~0 : 0, without a branch:
+     * neg sets CF iff (mf_mask + 1) & bits is non-zero, sbb turns the
+     * carry into an all-ones or all-zeroes mask. */
+    emit_alu64_imm8(state, 0x83, 0, R10, 1);    /* add $1, r10 */
+    emit_alu64(state, 0x21, bits_reg, R10);     /* and bits, r10 */
+    emit_alu64(state, 0xf7, 3, R10);            /* neg r10 */
+    emit_alu64(state, 0x19, R11, R11);          /* sbb r11, r11 */
+
+    emit_alu64(state, 0x21, R11, RAX);          /* and r11, rax */
+    emit_store(state, S64, RAX, RDX, disp);
+}
+
+/* Emits a straight-line flatten for 'subtable''s mask shape and returns
+ * an executable mapping of it, or NULL on failure.  Arguments arrive per
+ * the SysV ABI: RDI pkt_blocks, RSI tbl_blocks, RDX blocks, RCX
+ * pkt_bits_u0, R8 pkt_bits_u1, R9D u0_pop. */
+static dpcls_jit_flatten_func
+dpcls_jit_compile(const struct dpcls_subtable *subtable)
+    OVS_REQUIRES(dpcls_jit_mutex)
+{
+    const uint32_t u0 = subtable->mf_bits_set_unit0;
+    const uint32_t u1 = subtable->mf_bits_set_unit1;
+    struct jit_state state;
+    void *jitted = NULL;
+    size_t jitted_size;
+    uint32_t i;
+
+    state.offset = 0;
+    state.size = (u0 + u1) * 64 + 16;
+    state.buf = xcalloc(state.size, 1);
+    state.pc_locs = NULL;
+    state.jumps = NULL;
+    state.num_jumps = 0;
+
+    for (i = 0; i < u0; i++) {
+        emit_flatten_block(&state, subtable->mf_masks[i], RCX, RDI, 8 * i);
+    }
+    if (u1) {
+        /* Rebase RDI onto unit 1's packet blocks.  R9D arrives as a
+         * 32-bit argument, so zero-extend it before using it as an
+         * index. */
+        emit_alu32(&state, 0x89, R9, R9);
+        emit_lea_index8(&state, RDI, R9, RDI);
+        for (i = 0; i < u1; i++) {
+            emit_flatten_block(&state, subtable->mf_masks[u0 + i], R8, RDI,
+                               8 * (u0 + i));
+        }
+    }
+    emit1(&state, 0xc3);                        /* ret */
+
+    jitted_size = state.offset;
+    jitted = mmap(NULL, jitted_size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (jitted == MAP_FAILED) {
+        VLOG_WARN("dpcls jit: mmap failed: %s", ovs_strerror(errno));
+        jitted = NULL;
+        goto out;
+    }
+    memcpy(jitted, state.buf, jitted_size);
+    if (mprotect(jitted, jitted_size, PROT_READ | PROT_EXEC) < 0) {
+        VLOG_WARN("dpcls jit: mprotect failed: %s", ovs_strerror(errno));
+        munmap(jitted, jitted_size);
+        jitted = NULL;
+    }
+
+out:
+    free(state.buf);
+    return (dpcls_jit_flatten_func) jitted;
+}
+
+/* Returns the compiled flatten for 'subtable''s mask shape, compiling
+ * and caching it on first use, or NULL when the caller should fall back
+ * to the generic path for this invocation.  Uses a trylock so a PMD
+ * never waits on another thread's compile. */
+static dpcls_jit_flatten_func
+dpcls_jit_flatten_get(struct dpcls_subtable *subtable)
+    OVS_NO_THREAD_SAFETY_ANALYSIS
+{
+    const uint64_t bits_u0 = subtable->mask.mf.map.bits[0];
+    const uint64_t bits_u1 = subtable->mask.mf.map.bits[1];
+    dpcls_jit_flatten_func flatten = NULL;
+    struct dpcls_jit_shape *shape;
+
+    if (ovs_mutex_trylock(&dpcls_jit_mutex)) {
+        return NULL;
+    }
+    if (dpcls_jit_broken) {
+        goto unlock;
+    }
+
+    LIST_FOR_EACH (shape, list_node, &dpcls_jit_shapes) {
+        if (shape->map_bits[0] == bits_u0 && shape->map_bits[1] == bits_u1) {
+            flatten = shape->flatten;
+            goto found;
+        }
+    }
+
+    flatten = dpcls_jit_compile(subtable);
+    if (!flatten) {
+        dpcls_jit_broken = true;
+        goto unlock;
+    }
+    shape = xmalloc(sizeof *shape);
+    shape->map_bits[0] = bits_u0;
+    shape->map_bits[1] = bits_u1;
+    shape->flatten = flatten;
+    ovs_list_push_back(&dpcls_jit_shapes, &shape->list_node);
+    VLOG_INFO("Compiled subtable lookup for shape %"PRIx64"/%"PRIx64
+              " (units %d,%d)", bits_u0, bits_u1,
+              subtable->mf_bits_set_unit0, subtable->mf_bits_set_unit1);
+
+found:
+    /* An aligned pointer store; readers either see it and take the
+     * compiled path or miss it and come back through here. */
+    subtable->jit_flatten = flatten;
+unlock:
+    ovs_mutex_unlock(&dpcls_jit_mutex);
+    return flatten;
+}
+
+static uint32_t
+dpcls_subtable_lookup_jit(struct dpcls_subtable *subtable,
+                          uint32_t keys_map,
+                          const struct netdev_flow_key *keys[],
+                          struct dpcls_rule **rules)
+{
+    dpcls_jit_flatten_func flatten = subtable->jit_flatten;
+
+    if (OVS_UNLIKELY(!flatten)) {
+        flatten = dpcls_jit_flatten_get(subtable);
+        if (!flatten) {
+            /* Warmup, a concurrent compile, or a broken jit: serve this
+             * call from the generic tier. */
+            return dpcls_subtable_generic_probe(subtable->mf_bits_set_unit0,
+                                                subtable->mf_bits_set_unit1)
+                       (subtable, keys_map, keys, rules);
+        }
+    }
+
+    const uint32_t n_pkts = count_1bits(keys_map);
+    ovs_assert(NETDEV_MAX_BURST >= n_pkts);
+    uint32_t hashes[NETDEV_MAX_BURST];
+
+    const uint32_t bit_count_total = subtable->mf_bits_set_unit0
+                                     + subtable->mf_bits_set_unit1;
+    const uint32_t block_count_required = bit_count_total * NETDEV_MAX_BURST;
+    const uint64_t *tbl_blocks = miniflow_get_values(&subtable->mask.mf);
+    int i;
+
+    uint64_t *blocks_scratch = get_blocks_scratch_jit(block_count_required);
+
+    /* Straight-line flatten of each packet's metadata, specialized to
+     * this subtable's exact mask shape. */
+    ULLONG_FOR_EACH_1 (i, keys_map) {
+        const struct netdev_flow_key *key = keys[i];
+
+        flatten(miniflow_get_values(&key->mf), tbl_blocks,
+                &blocks_scratch[i * bit_count_total],
+                key->mf.map.bits[0], key->mf.map.bits[1],
+                count_1bits(key->mf.map.bits[0]));
+    }
+
+    ULLONG_FOR_EACH_1 (i, keys_map) {
+        uint64_t *block_ptr = &blocks_scratch[i * bit_count_total];
+        uint32_t hash = hash_add_words64(0, block_ptr, bit_count_total);
+        hashes[i] = hash_finish(hash, bit_count_total * 8);
+    }
+
+    uint32_t found_map;
+    const struct cmap_node *nodes[NETDEV_MAX_BURST];
+
+    found_map = cmap_find_batch(&subtable->rules, keys_map, hashes, nodes);
+
+    ULLONG_FOR_EACH_1 (i, found_map) {
+        struct dpcls_rule *rule;
+
+        CMAP_NODE_FOR_EACH (rule, cmap_node, nodes[i]) {
+            const uint32_t cidx = i * bit_count_total;
+            uint32_t match = netdev_rule_matches_key(rule, bit_count_total,
+                                                     &blocks_scratch[cidx]);
+
+            if (OVS_LIKELY(match)) {
+                rules[i] = rule;
+                subtable->hit_cnt++;
+                goto next;
+            }
+        }
+
+        ULLONG_SET0(found_map, i);  /* Did not match. */
+    next:
+        ; /* Keep Sparse happy. */
+    }
+
+    return found_map;
+}
+
+dpcls_subtable_lookup_func
+dpcls_subtable_jit_probe(uint32_t u0_bits, uint32_t u1_bits)
+{
+    /* Any shape can be emitted; compilation itself is deferred to the
+     * first lookup, so nothing is generated for subtables that never
+     * see traffic. */
+    VLOG_DBG("Subtable using jit tier for u0 %d, u1 %d\n", u0_bits, u1_bits);
+    return dpcls_subtable_lookup_jit;
+}
+
+#else /* !(__x86_64__ || _M_X64) */
+
+dpcls_subtable_lookup_func
+dpcls_subtable_jit_probe(uint32_t u0_bits OVS_UNUSED,
+                         uint32_t u1_bits OVS_UNUSED)
+{
+    return NULL;
+}
+
+#endif /* __x86_64__ || _M_X64 */
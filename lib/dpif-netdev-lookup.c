@@ -43,6 +43,16 @@ static struct dpcls_subtable_lookup_info_t subtable_lookups[] = {
       .probe = dpcls_subtable_generic_probe,
       .name = "generic", },
 
+    /* Runtime code generation, specialized per subtable mask shape.  It
+     * covers every (u0,u1) pair rather than the fixed list of generic
+     * specializations, and hands calls to the generic implementation
+     * while code for a shape is still being compiled, so it defaults
+     * above "generic".  The probe returns NULL on architectures without
+     * an emitter. */
+    { .prio = 2,
+      .probe = dpcls_subtable_jit_probe,
+      .name = "jit", },
+
 #if (__x86_64__ && HAVE_AVX512F && HAVE_LD_AVX512_GOOD && __SSE4_2__)
     /* Only available on x86_64 bit builds with SSE 4.2 used for OVS core. */
     { .prio = 0,
@@ -114,8 +124,10 @@ dpcls_subtable_get_best_impl(uint32_t u0_bit_count, uint32_t u1_bit_count)
         }
     }
 
-    VLOG_DBG("Subtable lookup function '%s' with units (%d,%d), priority %d\n",
-             name, u0_bit_count, u1_bit_count, prio);
+    /* Report which implementation each subtable ends up using, so that
+     * deployments can verify their traffic stays on the intended path. */
+    VLOG_INFO("Subtable lookup function '%s' with units (%d,%d), priority "
+              "%d\n", name, u0_bit_count, u1_bit_count, prio);
 
     /* Programming error - we must always return a valid func ptr. */
     ovs_assert(best_func != NULL);
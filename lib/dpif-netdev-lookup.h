@@ -46,6 +46,13 @@ dpcls_subtable_generic_probe(uint32_t u0_bit_count, uint32_t u1_bit_count);
 dpcls_subtable_lookup_func
 dpcls_subtable_avx512_gather_probe(uint32_t u0_bit_cnt, uint32_t u1_bit_cnt);
 
+/* Probe function for the runtime code-generation tier, which compiles a
+ * lookup specialized to a subtable's exact mask shape on first use and
+ * serves calls from the generic implementation until it is ready.
+ * Accepts any (u0,u1) pair on x86-64; returns NULL elsewhere. */
+dpcls_subtable_lookup_func
+dpcls_subtable_jit_probe(uint32_t u0_bit_cnt, uint32_t u1_bit_cnt);
+
 
 /* Subtable registration and iteration helpers */
 struct dpcls_subtable_lookup_info_t {
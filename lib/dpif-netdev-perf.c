@@ -100,6 +100,14 @@ pmd_perf_estimate_tsc_frequency(void)
     VLOG_INFO("Estimated TSC frequency: %"PRIu64" KHz", tsc_hz / 1000);
 }
 
+/* Returns the measured or estimated TSC frequency in Hz, or 1 if the TSC
+ * is unavailable or unreliable. */
+uint64_t
+pmd_perf_tsc_hz(void)
+{
+    return tsc_hz;
+}
+
 /* Histogram functions. */
 
 static void
@@ -198,6 +206,13 @@ pmd_perf_stats_init(struct pmd_perf_stats *s)
      * descriptors (maximum configurable length in Qemu), with the
      * DPDK 17.11 virtio PMD in the guest. */
     histogram_walls_set_log(&s->max_vhost_qfill, 0, 512);
+    /* Logarithmic histogram for cycles/rx batch ranging from 500 to 24M
+     * (corresponding to 200 ns to 9.6 ms at 2.5 GHz TSC clock). */
+    histogram_walls_set_log(&s->cycles_per_batch, 500, 24000000);
+    /* Logarithmic histogram for rx-to-tx packet residency from 1000 to
+     * 240M cycles (400 ns to 96 ms at 2.5 GHz TSC clock), wide enough to
+     * cover packets held back by output batching. */
+    histogram_walls_set_log(&s->pkt_residency, 1000, 240000000);
     s->iteration_cnt = 0;
     s->start_ms = time_msec();
     s->log_susp_it = UINT32_MAX;
@@ -341,6 +356,72 @@ pmd_perf_format_histograms(struct ds *str, struct pmd_perf_stats *s)
     }
 }
 
+/* Returns the approximate value below which a fraction 'q' (0 < q < 1) of
+ * the samples in 'hist' fall, interpolating linearly within the matching
+ * bin.  Returns 0 for an empty histogram.  Samples in the unbounded
+ * overflow bin are reported at the highest finite wall. */
+static uint32_t
+histogram_quantile(const struct histogram *hist, double q)
+{
+    uint64_t samples = histogram_samples(hist);
+    uint64_t thresh, count = 0;
+    uint32_t lower = 0;
+    int i;
+
+    if (samples == 0) {
+        return 0;
+    }
+    thresh = ceil(q * samples);
+    for (i = 0; i < NUM_BINS - 1; i++) {
+        if (count + hist->bin[i] >= thresh) {
+            return lower + (uint32_t) ((hist->wall[i] - lower)
+                                       * (1.0 * (thresh - count)
+                                          / hist->bin[i]));
+        }
+        count += hist->bin[i];
+        lower = hist->wall[i];
+    }
+    return hist->wall[NUM_BINS - 2];
+}
+
+void
+pmd_perf_format_latency_histograms(struct ds *str, struct pmd_perf_stats *s)
+{
+    static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+    static const char *q_names[] = { "p50", "p90", "p99", "p99.9" };
+    double us_per_cycle = 1000000.0 / tsc_hz;
+    int i;
+
+    ds_put_cstr(str, "Latency histograms (TSC cycles)\n");
+    ds_put_format(str, "   %-21s  %-21s\n",
+                  "cycles/batch", "rx-to-tx cycles");
+    for (i = 0; i < NUM_BINS - 1; i++) {
+        ds_put_format(str,
+                      "   %-9d %-11"PRIu64"  %-9d %-11"PRIu64"\n",
+                      s->cycles_per_batch.wall[i], s->cycles_per_batch.bin[i],
+                      s->pkt_residency.wall[i], s->pkt_residency.bin[i]);
+    }
+    ds_put_format(str,
+                  "   %-9s %-11"PRIu64"  %-9s %-11"PRIu64"\n",
+                  ">", s->cycles_per_batch.bin[i],
+                  ">", s->pkt_residency.bin[i]);
+    ds_put_cstr(str,
+                "-----------------------------------------------\n");
+    ds_put_format(str, "   %-7s  %-21s  %-21s\n",
+                  "", "cycles/batch", "rx-to-tx");
+    for (i = 0; i < (int) ARRAY_SIZE(quantiles); i++) {
+        uint32_t batch_q = histogram_quantile(&s->cycles_per_batch,
+                                              quantiles[i]);
+        uint32_t res_q = histogram_quantile(&s->pkt_residency, quantiles[i]);
+
+        ds_put_format(str,
+                      "   %-7s  %-9"PRIu32" %8.1f us  %-9"PRIu32" %8.1f us\n",
+                      q_names[i],
+                      batch_q, batch_q * us_per_cycle,
+                      res_q, res_q * us_per_cycle);
+    }
+}
+
 void
 pmd_perf_format_iteration_history(struct ds *str, struct pmd_perf_stats *s,
                                   int n_iter)
@@ -452,6 +533,8 @@ pmd_perf_stats_clear_lock(struct pmd_perf_stats *s)
     histogram_clear(&s->cycles_per_upcall);
     histogram_clear(&s->pkts_per_batch);
     histogram_clear(&s->max_vhost_qfill);
+    histogram_clear(&s->cycles_per_batch);
+    histogram_clear(&s->pkt_residency);
     history_init(&s->iterations);
     history_init(&s->milliseconds);
     s->start_ms = time_msec();
@@ -173,6 +173,9 @@ struct pmd_perf_stats {
     struct histogram cycles_per_upcall;
     struct histogram pkts_per_batch;
     struct histogram max_vhost_qfill;
+    /* Latency histograms, only populated with detailed metrics enabled. */
+    struct histogram cycles_per_batch;
+    struct histogram pkt_residency;
     /* Iteration history buffer. */
     struct history iterations;
     /* Millisecond history buffer. */
@@ -238,6 +241,7 @@ cycles_counter_get(struct pmd_perf_stats *s)
 }
 
 void pmd_perf_estimate_tsc_frequency(void);
+uint64_t pmd_perf_tsc_hz(void);
 
 /* A nestable timer for measuring execution time in TSC cycles.
  *
@@ -412,6 +416,7 @@ pmd_perf_end_iteration(struct pmd_perf_stats *s, int rx_packets,
 struct pmd_perf_params {
     int command_type;
     bool histograms;
+    bool latency;
     size_t iter_hist_len;
     size_t ms_hist_len;
 };
@@ -419,6 +424,8 @@ struct pmd_perf_params {
 void pmd_perf_format_overall_stats(struct ds *str, struct pmd_perf_stats *s,
                                    double duration);
 void pmd_perf_format_histograms(struct ds *str, struct pmd_perf_stats *s);
+void pmd_perf_format_latency_histograms(struct ds *str,
+                                        struct pmd_perf_stats *s);
 void pmd_perf_format_iteration_history(struct ds *str,
                                        struct pmd_perf_stats *s,
                                        int n_iter);
@@ -31,6 +31,19 @@ extern "C" {
 /* Forward declaration for lookup_func typedef. */
 struct dpcls_subtable;
 struct dpcls_rule;
+struct dpcls_arena;
+struct dp_netdev_flow;
+
+/* Memory layer for the datapath's hot structures (per-PMD flow caches,
+ * classifier subtables and their rule slabs).  Large allocations are
+ * backed by huge pages where the platform provides them, and optionally
+ * locked into RAM, keeping TLB misses and reclaim out of the packet
+ * path; small ones fall through to the regular cache-aligned heap.  The
+ * memory is zeroed, and the 'size' passed to dp_netdev_huge_free() must
+ * equal the one passed to dp_netdev_huge_alloc(). */
+void *dp_netdev_huge_alloc(size_t size);
+void dp_netdev_huge_free(void *, size_t size);
+void dp_netdev_huge_set_mlock(bool mlock);
 
 /* Must be public as it is instantiated in subtable struct below. */
 struct netdev_flow_key {
@@ -40,10 +53,13 @@ struct netdev_flow_key {
     uint64_t buf[FLOW_MAX_PACKET_U64S];
 };
 
-/* A rule to be inserted to the classifier. */
+/* A rule to be inserted to the classifier.  Rules live in their subtable's
+ * arena, so that the rules probed on a hash collision are contiguous in
+ * memory, and carry a back-pointer to the flow that owns them. */
 struct dpcls_rule {
     struct cmap_node cmap_node;   /* Within struct dpcls_subtable 'rules'. */
     struct netdev_flow_key *mask; /* Subtable's mask. */
+    struct dp_netdev_flow *dp_flow; /* Flow that owns this rule. */
     struct netdev_flow_key flow;  /* Matching key. */
     /* 'flow' must be the last field, additional space is allocated here. */
 };
@@ -86,6 +102,16 @@ struct dpcls_subtable {
     /* Caches the masks to match a packet to, reducing runtime calculations. */
     uint64_t *mf_masks;
 
+    /* Flatten routine generated for this subtable's exact mask shape by
+     * the runtime code-generation tier, or NULL until it has compiled
+     * one (see dpif-netdev-lookup-jit.c).  Written once, with an
+     * aligned pointer store; the code itself is cached per shape and
+     * never freed, so this needs no cleanup. */
+    void *jit_flatten;
+
+    /* Slab arena that this subtable's rules are allocated from. */
+    struct dpcls_arena *arena;
+
     struct netdev_flow_key mask; /* Wildcards for fields (const). */
     /* 'mask' must be the last field, additional space is allocated here. */
 };
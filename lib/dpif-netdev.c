@@ -29,11 +29,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
 #include "bitmap.h"
+#include "bpf/ubpf_packetin.h"
 #include "cmap.h"
 #include "conntrack.h"
 #include "conntrack-tp.h"
@@ -52,6 +56,7 @@
 #include "id-pool.h"
 #include "ipf.h"
 #include "netdev.h"
+#include "netdev-dpdk.h"
 #include "netdev-offload.h"
 #include "netdev-provider.h"
 #include "netdev-vport.h"
@@ -75,10 +80,12 @@
 #include "seq.h"
 #include "smap.h"
 #include "sset.h"
+#include "stats-shm.h"
 #include "timeval.h"
 #include "tnl-neigh-cache.h"
 #include "tnl-ports.h"
 #include "unixctl.h"
+#include "userspace-tso.h"
 #include "util.h"
 #include "uuid.h"
 
@@ -109,6 +116,7 @@ COVERAGE_DEFINE(datapath_drop_invalid_port);
 COVERAGE_DEFINE(datapath_drop_invalid_bond);
 COVERAGE_DEFINE(datapath_drop_invalid_tnl_port);
 COVERAGE_DEFINE(datapath_drop_rx_invalid_packet);
+COVERAGE_DEFINE(datapath_tnl_responder);
 
 /* Protects against changes to 'dp_netdevs'. */
 static struct ovs_mutex dp_netdev_mutex = OVS_MUTEX_INITIALIZER;
@@ -162,6 +170,13 @@ static struct odp_support dp_netdev_support = {
 /* Time in microseconds to try RCU quiescing. */
 #define PMD_RCU_QUIESCE_INTERVAL 10000LL
 
+/* Number of consecutive empty polling rounds after which an idle PMD
+ * starts to sleep between rounds (see other_config:pmd-max-sleep). */
+#define PMD_SLEEP_AFTER_ITER 64
+
+/* Upper bound in microseconds on a single PMD idle sleep. */
+#define PMD_SLEEP_MAX_US 10000
+
 struct dpcls {
     struct cmap_node node;      /* Within dp_netdev_pmd_thread.classifiers */
     odp_port_t in_port;
@@ -180,8 +195,10 @@ static void dpcls_init(struct dpcls *);
 static void dpcls_destroy(struct dpcls *);
 static void dpcls_sort_subtable_vector(struct dpcls *);
 static uint32_t dpcls_subtable_lookup_reprobe(struct dpcls *cls);
-static void dpcls_insert(struct dpcls *, struct dpcls_rule *,
-                         const struct netdev_flow_key *mask);
+static struct dpcls_rule *dpcls_insert(struct dpcls *,
+                                       struct dp_netdev_flow *,
+                                       const struct flow *,
+                                       const struct netdev_flow_key *mask);
 static void dpcls_remove(struct dpcls *, struct dpcls_rule *);
 static bool dpcls_lookup(struct dpcls *cls,
                          const struct netdev_flow_key *keys[],
@@ -207,6 +224,9 @@ struct dp_meter {
     uint16_t flags;
     uint16_t n_bands;
     uint32_t max_delta_t;
+    uint64_t version;     /* Unique per allocation, so that per-PMD shards
+                           * can detect meter replacement (see
+                           * struct dp_meter_shard). */
     uint64_t used;
     uint64_t packet_count;
     uint64_t byte_count;
@@ -236,6 +256,9 @@ enum rxq_cycles_counter_type {
                                    interval. */
     RXQ_CYCLES_PROC_HIST,       /* Total cycles of all intervals that are used
                                    during rxq to pmd assignment. */
+    RXQ_CYCLES_PROC_EWMA,       /* Exponentially weighted moving average of
+                                   the interval cycles, updated incrementally
+                                   as each interval completes. */
     RXQ_N_CYCLES
 };
 
@@ -262,10 +285,14 @@ struct dp_flow_offload {
     pthread_cond_t cond;
 };
 
-static struct dp_flow_offload dp_flow_offload = {
-    .mutex = OVS_MUTEX_INITIALIZER,
-    .list  = OVS_LIST_INITIALIZER(&dp_flow_offload.list),
-};
+/* Flow offload requests are spread over a few worker threads so that slow
+ * rte_flow calls for one device do not hold up offloading on the others.
+ * Requests are keyed by the flow's input port, so all operations for a
+ * given port (and hence for a given megaflow) stay ordered on one worker
+ * and the offload provider never sees concurrent calls for one netdev. */
+#define DP_FLOW_OFFLOAD_THREADS 4
+
+static struct dp_flow_offload dp_flow_offload[DP_FLOW_OFFLOAD_THREADS];
 
 static struct ovsthread_once offload_thread_once
     = OVSTHREAD_ONCE_INITIALIZER;
@@ -283,6 +310,9 @@ struct dp_netdev_rxq {
     unsigned intrvl_idx;               /* Write index for 'cycles_intrvl'. */
     struct dp_netdev_pmd_thread *pmd;  /* pmd thread that polls this queue. */
     bool is_vhost;                     /* Is rxq of a vhost port. */
+    unsigned full_burst_streak;        /* Consecutive full receive bursts,
+                                          for work-stealing offload.  Only
+                                          touched by the polling thread. */
 
     /* Counters of cycles spent successfully polling and processing pkts. */
     atomic_ullong cycles[RXQ_N_CYCLES];
@@ -299,6 +329,20 @@ struct dp_netdev_flow_stats {
     atomic_uint16_t tcp_flags;     /* Bitwise-OR of seen tcp_flags values. */
 };
 
+/* Contained by struct dp_netdev_flow's 'pending_stats' member.
+ *
+ * Stats accumulated by the owning pmd thread since the last periodic fold
+ * into 'stats'.  Plain (non-atomic) fields: only the owning pmd thread
+ * reads or writes them, so the hot path does purely local stores and the
+ * shared 'stats' cache line is touched once per fold interval instead of
+ * once per batch. */
+struct dp_netdev_flow_pending_stats {
+    long long used;                /* Last used time, in monotonic msecs. */
+    unsigned long long packet_count; /* Packets matched since last fold. */
+    unsigned long long byte_count; /* Bytes matched since last fold. */
+    uint16_t tcp_flags;            /* Bitwise-OR of seen tcp_flags values. */
+};
+
 /* Contained by struct dp_netdev_flow's 'last_attrs' member.  */
 struct dp_netdev_flow_attrs {
     atomic_bool offloaded;         /* True if flow is offloaded to HW. */
@@ -365,6 +409,13 @@ struct dp_netdev_flow {
     /* Statistics. */
     struct dp_netdev_flow_stats stats;
 
+    /* Stats not yet folded into 'stats', and the flow's membership in the
+     * owning pmd thread's 'pending_stats_flows' list.  Both are used only
+     * by the owning pmd thread; 'pending_node' is self-linked while the
+     * flow has nothing pending. */
+    struct dp_netdev_flow_pending_stats pending_stats;
+    struct ovs_list pending_node;
+
     /* Statistics and attributes received from the netdev offload provider. */
     atomic_int netdev_flow_get_result;
     struct dp_netdev_flow_stats last_stats;
@@ -379,10 +430,16 @@ struct dp_netdev_flow {
      * packet_batch_per_flow_init() and packet_batch_per_flow_execute()). */
     struct packet_batch_per_flow *batch;
 
+    /* Connection cached by the last ct() action executed on this flow's
+     * packets, primed back into packet metadata on flow cache hits so
+     * established flows skip the conntrack hash-table probe.  Used only by
+     * the owning pmd thread. */
+    struct conntrack_conn_ref ct_ref;
+
     /* Packet classification. */
     char *dp_extra_info;         /* String to return in a flow dump/get. */
-    struct dpcls_rule cr;        /* In owning dp_netdev's 'cls'. */
-    /* 'cr' must be the last member. */
+    struct dpcls_rule *cr;       /* In owning dp_netdev's 'cls', allocated
+                                  * from the subtable's rule arena. */
 };
 
 static void dp_netdev_flow_unref(struct dp_netdev_flow *);
@@ -400,6 +457,7 @@ static int dpif_netdev_flow_from_nlattrs(const struct nlattr *, uint32_t,
 struct dp_netdev_actions {
     /* These members are immutable: they do not change during the struct's
      * lifetime.  */
+    struct odp_execute_prog *prog;  /* Compiled form of 'actions'. */
     unsigned int size;          /* Size of 'actions', in bytes. */
     struct nlattr actions[];    /* Sequence of OVS_ACTION_ATTR_* attributes. */
 };
@@ -409,6 +467,11 @@ struct dp_netdev_actions *dp_netdev_actions_create(const struct nlattr *,
 struct dp_netdev_actions *dp_netdev_flow_get_actions(
     const struct dp_netdev_flow *);
 static void dp_netdev_actions_free(struct dp_netdev_actions *);
+static void dp_netdev_execute_prog(struct dp_netdev_pmd_thread *pmd,
+                                   struct dp_packet_batch *,
+                                   bool should_steal, const struct flow *,
+                                   struct dp_netdev_flow *,
+                                   const struct odp_execute_prog *);
 
 struct polled_queue {
     struct dp_netdev_rxq *rxq;
@@ -492,6 +555,7 @@ static void reconfigure_datapath(struct dp_netdev *dp)
 static bool dp_netdev_pmd_try_ref(struct dp_netdev_pmd_thread *pmd);
 static void dp_netdev_pmd_unref(struct dp_netdev_pmd_thread *pmd);
 static void dp_netdev_pmd_flow_flush(struct dp_netdev_pmd_thread *pmd);
+static void dp_netdev_pmd_fold_flow_stats(struct dp_netdev_pmd_thread *pmd);
 static void pmd_load_cached_ports(struct dp_netdev_pmd_thread *pmd)
     OVS_REQUIRES(pmd->port_mutex);
 static inline void
@@ -528,6 +592,113 @@ pmd_perf_metrics_enabled(const struct dp_netdev_pmd_thread *pmd);
 static void queue_netdev_flow_del(struct dp_netdev_pmd_thread *pmd,
                                   struct dp_netdev_flow *flow);
 
+/* Memory backing for datapath hot structures
+ * ==========================================
+ *
+ * The EMC alone is several megabytes per PMD and a busy classifier adds
+ * megabytes more, all probed at packet rate; backed by 4 KB pages this
+ * costs a TLB miss on nearly every probe.  Allocations of at least
+ * DP_NETDEV_HUGE_THRESHOLD bytes therefore come from anonymous
+ * huge-page mappings: preallocated huge pages (MAP_HUGETLB) when the
+ * system has them, otherwise a huge-aligned region marked MADV_HUGEPAGE
+ * so the kernel can back it with transparent huge pages.  Smaller
+ * allocations are not worth a 2 MB page and take the regular
+ * cache-aligned heap path.
+ *
+ * With other_config:pmd-mem-mlock set, the huge regions are also locked
+ * into RAM, so reclaim under memory pressure cannot stall a PMD with a
+ * fault on its own flow tables. */
+
+#define DP_NETDEV_HUGE_PAGE_SIZE (2 * 1024 * 1024ull)
+#define DP_NETDEV_HUGE_THRESHOLD (256 * 1024)
+
+static atomic_bool dp_netdev_mem_mlock = ATOMIC_VAR_INIT(false);
+
+/* Enables or disables locking of huge allocations into RAM.  Only
+ * affects memory allocated from now on; the PMD structures are
+ * reallocated on datapath reconfiguration anyway. */
+void
+dp_netdev_huge_set_mlock(bool mlock_)
+{
+    bool cur;
+
+    atomic_read_relaxed(&dp_netdev_mem_mlock, &cur);
+    if (cur != mlock_) {
+        atomic_store_relaxed(&dp_netdev_mem_mlock, mlock_);
+        VLOG_INFO("Locking of datapath memory %s",
+                  mlock_ ? "enabled" : "disabled");
+    }
+}
+
+#ifdef __linux__
+static void *
+dp_netdev_huge_mmap(size_t size)
+{
+    bool mlock_;
+    void *p;
+
+    p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p == MAP_FAILED) {
+        /* No preallocated huge pages.  Map a huge-aligned region and let
+         * the kernel back it with transparent huge pages instead. */
+        char *q = mmap(NULL, size + DP_NETDEV_HUGE_PAGE_SIZE,
+                       PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        char *aligned;
+
+        if (q == MAP_FAILED) {
+            out_of_memory();
+        }
+        aligned = (char *) ROUND_UP((uintptr_t) q, DP_NETDEV_HUGE_PAGE_SIZE);
+        if (aligned > q) {
+            munmap(q, aligned - q);
+        }
+        munmap(aligned + size, q + DP_NETDEV_HUGE_PAGE_SIZE - aligned);
+#ifdef MADV_HUGEPAGE
+        madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+        p = aligned;
+    }
+
+    atomic_read_relaxed(&dp_netdev_mem_mlock, &mlock_);
+    if (mlock_ && mlock(p, size)) {
+        static struct vlog_rate_limit mlock_rl = VLOG_RATE_LIMIT_INIT(1, 5);
+
+        VLOG_WARN_RL(&mlock_rl, "mlock of %"PRIuSIZE" bytes of datapath "
+                     "memory failed (%s); check RLIMIT_MEMLOCK",
+                     size, ovs_strerror(errno));
+    }
+    return p;
+}
+#endif
+
+void *
+dp_netdev_huge_alloc(size_t size)
+{
+#ifdef __linux__
+    if (size >= DP_NETDEV_HUGE_THRESHOLD) {
+        return dp_netdev_huge_mmap(ROUND_UP(size, DP_NETDEV_HUGE_PAGE_SIZE));
+    }
+#endif
+    return xzalloc_cacheline(size);
+}
+
+void
+dp_netdev_huge_free(void *p, size_t size OVS_UNUSED)
+{
+    if (!p) {
+        return;
+    }
+#ifdef __linux__
+    if (size >= DP_NETDEV_HUGE_THRESHOLD) {
+        munmap(p, ROUND_UP(size, DP_NETDEV_HUGE_PAGE_SIZE));
+        return;
+    }
+#endif
+    free_cacheline(p);
+}
+
 static void
 emc_cache_init(struct emc_cache *flow_cache)
 {
@@ -543,21 +714,34 @@ emc_cache_init(struct emc_cache *flow_cache)
 }
 
 static void
-smc_cache_init(struct smc_cache *smc_cache)
+smc_cache_init(struct smc_cache *smc_cache, uint32_t n_entries)
 {
-    int i, j;
-    for (i = 0; i < SMC_BUCKET_CNT; i++) {
+    uint32_t bucket_cnt = n_entries / SMC_ENTRY_PER_BUCKET;
+    uint32_t i;
+    int j;
+
+    ovs_assert(IS_POW2(bucket_cnt));
+    smc_cache->buckets = dp_netdev_huge_alloc(bucket_cnt
+                                              * sizeof *smc_cache->buckets);
+    smc_cache->bucket_mask = bucket_cnt - 1;
+    for (i = 0; i < bucket_cnt; i++) {
         for (j = 0; j < SMC_ENTRY_PER_BUCKET; j++) {
-            smc_cache->buckets[i].flow_idx[j] = UINT16_MAX;
+            smc_cache->buckets[i].flow_idx[j] = SMC_ENTRY_NONE;
         }
     }
 }
 
+static uint32_t
+smc_cache_n_entries(const struct smc_cache *smc_cache)
+{
+    return (smc_cache->bucket_mask + 1) * SMC_ENTRY_PER_BUCKET;
+}
+
 static void
-dfc_cache_init(struct dfc_cache *flow_cache)
+dfc_cache_init(struct dfc_cache *flow_cache, uint32_t smc_entries)
 {
     emc_cache_init(&flow_cache->emc_cache);
-    smc_cache_init(&flow_cache->smc_cache);
+    smc_cache_init(&flow_cache->smc_cache, smc_entries);
 }
 
 static void
@@ -573,13 +757,27 @@ emc_cache_uninit(struct emc_cache *flow_cache)
 static void
 smc_cache_uninit(struct smc_cache *smc)
 {
-    int i, j;
+    uint32_t i;
+    int j;
 
-    for (i = 0; i < SMC_BUCKET_CNT; i++) {
+    for (i = 0; i <= smc->bucket_mask; i++) {
         for (j = 0; j < SMC_ENTRY_PER_BUCKET; j++) {
             smc_clear_entry(&(smc->buckets[i]), j);
         }
     }
+    dp_netdev_huge_free(smc->buckets,
+                        (smc->bucket_mask + 1) * sizeof *smc->buckets);
+    smc->buckets = NULL;
+    smc->bucket_mask = 0;
+}
+
+/* Drops all cached entries and reallocates the cache with 'n_entries'.
+ * Only the owning thread may call this; readers take no locks. */
+static void
+smc_cache_resize(struct smc_cache *smc, uint32_t n_entries)
+{
+    smc_cache_uninit(smc);
+    smc_cache_init(smc, n_entries);
 }
 
 static void
@@ -617,11 +815,51 @@ emc_cache_slow_sweep(struct emc_cache *flow_cache)
  *         - pmd_thread_main()
  *
  * 'pmd->ctx.now' should be used without update in all other cases if possible.
- */
+ *
+ * On PMD threads the time is derived from the TSC that dpif-netdev-perf
+ * already maintains, so the per-iteration updates cost no system or vDSO
+ * call.  The TSC-to-microseconds conversion is recalibrated against
+ * time_usec() a few times per second to bound drift. */
+
+/* How many times per second to recalibrate the TSC-derived clock against
+ * time_usec(). */
+#define PMD_CLOCK_CALIB_PER_SEC 100
+
+static void
+pmd_thread_ctx_clock_calibrate(struct dp_netdev_pmd_thread *pmd, uint64_t tsc)
+{
+    uint64_t tsc_hz = pmd_perf_tsc_hz();
+    long long int now = time_usec();
+
+    /* Extrapolation may overshoot the system clock by a hair.  Do not let
+     * the thread's notion of time move backwards. */
+    pmd->ctx.now = MAX(now, pmd->ctx.now);
+    pmd->ctx.clock_base_us = pmd->ctx.now;
+    pmd->ctx.clock_base_tsc = tsc;
+    if (tsc_hz > 1 && pmd->core_id != NON_PMD_CORE_ID) {
+        pmd->ctx.us_per_tsc_q32 = ((uint64_t) 1000000 << 32) / tsc_hz;
+        pmd->ctx.clock_check_tsc = tsc + tsc_hz / PMD_CLOCK_CALIB_PER_SEC;
+    } else {
+        /* Unreliable TSC, or a thread that may migrate between cores with
+         * unsynchronized TSCs: read the system clock every time. */
+        pmd->ctx.us_per_tsc_q32 = 0;
+    }
+}
+
 static inline void
 pmd_thread_ctx_time_update(struct dp_netdev_pmd_thread *pmd)
 {
-    pmd->ctx.now = time_usec();
+    uint64_t tsc = cycles_counter_update(&pmd->perf_stats);
+
+    if (OVS_LIKELY(pmd->ctx.us_per_tsc_q32
+                   && tsc >= pmd->ctx.clock_base_tsc
+                   && tsc < pmd->ctx.clock_check_tsc)) {
+        pmd->ctx.now = pmd->ctx.clock_base_us
+            + (((tsc - pmd->ctx.clock_base_tsc)
+                * pmd->ctx.us_per_tsc_q32) >> 32);
+    } else {
+        pmd_thread_ctx_clock_calibrate(pmd, tsc);
+    }
 }
 
 /* Returns true if 'dpif' is a netdev or dummy dpif, false otherwise. */
@@ -766,6 +1004,10 @@ pmd_info_show_perf(struct ds *reply,
                 ds_put_cstr(reply, "\n");
                 pmd_perf_format_histograms(reply, &pmd->perf_stats);
             }
+            if (par->latency) {
+                ds_put_cstr(reply, "\n");
+                pmd_perf_format_latency_histograms(reply, &pmd->perf_stats);
+            }
             if (par->iter_hist_len > 0) {
                 ds_put_cstr(reply, "\n");
                 pmd_perf_format_iteration_history(reply, &pmd->perf_stats,
@@ -1032,6 +1274,101 @@ dpif_netdev_subtable_lookup_set(struct unixctl_conn *conn, int argc,
     ds_destroy(&reply);
 }
 
+static void
+dpif_netdev_miniflow_extract_get(struct unixctl_conn *conn,
+                                 int argc OVS_UNUSED,
+                                 const char *argv[] OVS_UNUSED,
+                                 void *aux OVS_UNUSED)
+{
+    /* Get a list of all miniflow extract functions. */
+    struct dp_mfex_impl_info_t *mfex_funcs = NULL;
+    int32_t count = dp_mfex_impl_info_get(&mfex_funcs);
+    if (count < 0) {
+        unixctl_command_reply_error(conn, "error getting extract names");
+        return;
+    }
+
+    /* Add all extract functions to reply string. */
+    struct ds reply = DS_EMPTY_INITIALIZER;
+    ds_put_cstr(&reply, "Available miniflow extract functions "
+                        "(priority : name)\n");
+    for (int i = 0; i < count; i++) {
+        ds_put_format(&reply, "  %d : %s\n", mfex_funcs[i].prio,
+                      mfex_funcs[i].name);
+    }
+    unixctl_command_reply(conn, ds_cstr(&reply));
+    ds_destroy(&reply);
+}
+
+static void
+dpif_netdev_miniflow_extract_set(struct unixctl_conn *conn, int argc,
+                                 const char *argv[], void *aux OVS_UNUSED)
+{
+    /* This function requires 2 parameters (argv[1] and argv[2]) to execute.
+     *   argv[1] is the extract function name
+     *   argv[2] is priority
+     *   argv[3] is the datapath name (optional if only 1 datapath exists)
+     */
+    const char *func_name = argv[1];
+
+    errno = 0;
+    char *err_char;
+    uint32_t new_prio = strtoul(argv[2], &err_char, 10);
+    if (errno != 0 || new_prio > UINT8_MAX) {
+        unixctl_command_reply_error(conn,
+            "error converting priority, use integer in range 0-255\n");
+        return;
+    }
+
+    int32_t err = dp_mfex_set_prio(func_name, new_prio);
+    if (err) {
+        unixctl_command_reply_error(conn,
+            "error, miniflow extract function not found\n");
+        return;
+    }
+
+    /* argv[3] is optional datapath instance. If no datapath name is provided
+     * and only one datapath exists, the one existing datapath is updated.
+     */
+    ovs_mutex_lock(&dp_netdev_mutex);
+    struct dp_netdev *dp = NULL;
+
+    if (argc == 4) {
+        dp = shash_find_data(&dp_netdevs, argv[3]);
+    } else if (shash_count(&dp_netdevs) == 1) {
+        dp = shash_first(&dp_netdevs)->data;
+    }
+
+    if (!dp) {
+        ovs_mutex_unlock(&dp_netdev_mutex);
+        unixctl_command_reply_error(conn,
+                                    "please specify an existing datapath");
+        return;
+    }
+
+    /* Re-run the probes and publish the winner to every PMD thread.  The
+     * PMD threads pick the new function up at their next batch. */
+    miniflow_extract_func new_func = dp_mfex_get_best_impl();
+
+    size_t n;
+    struct dp_netdev_pmd_thread **pmd_list;
+    sorted_poll_thread_list(dp, &pmd_list, &n);
+    for (size_t i = 0; i < n; i++) {
+        atomic_store_relaxed(&pmd_list[i]->miniflow_extract_opt, new_func);
+    }
+    free(pmd_list);
+    ovs_mutex_unlock(&dp_netdev_mutex);
+
+    struct ds reply = DS_EMPTY_INITIALIZER;
+    ds_put_format(&reply,
+        "Miniflow extract priority change affected %"PRIuSIZE" threads.\n",
+        n);
+    const char *reply_str = ds_cstr(&reply);
+    unixctl_command_reply(conn, reply_str);
+    VLOG_INFO("%s", reply_str);
+    ds_destroy(&reply);
+}
+
 static void
 dpif_netdev_pmd_rebalance(struct unixctl_conn *conn, int argc,
                           const char *argv[], void *aux OVS_UNUSED)
@@ -1137,12 +1474,17 @@ pmd_perf_show_cmd(struct unixctl_conn *conn, int argc,
     struct pmd_perf_params par;
     long int it_hist = 0, ms_hist = 0;
     par.histograms = true;
+    par.latency = false;
 
     while (argc > 1) {
         if (!strcmp(argv[1], "-nh")) {
             par.histograms = false;
             argc -= 1;
             argv += 1;
+        } else if (!strcmp(argv[1], "-lat")) {
+            par.latency = true;
+            argc -= 1;
+            argv += 1;
         } else if (!strcmp(argv[1], "-it") && argc > 2) {
             it_hist = strtol(argv[2], NULL, 10);
             if (it_hist < 0) {
@@ -1231,10 +1573,10 @@ dpif_netdev_init(void)
                              0, 3, dpif_netdev_pmd_info,
                              (void *)&poll_aux);
     unixctl_command_register("dpif-netdev/pmd-perf-show",
-                             "[-nh] [-it iter-history-len]"
+                             "[-nh] [-lat] [-it iter-history-len]"
                              " [-ms ms-history-len]"
                              " [-pmd core] [dp]",
-                             0, 8, pmd_perf_show_cmd,
+                             0, 9, pmd_perf_show_cmd,
                              NULL);
     unixctl_command_register("dpif-netdev/pmd-rxq-rebalance", "[dp]",
                              0, 1, dpif_netdev_pmd_rebalance,
@@ -1254,6 +1596,13 @@ dpif_netdev_init(void)
     unixctl_command_register("dpif-netdev/subtable-lookup-prio-get", "",
                              0, 0, dpif_netdev_subtable_lookup_get,
                              NULL);
+    unixctl_command_register("dpif-netdev/miniflow-extract-prio-set",
+                             "[extract_func] [prio] [dp]",
+                             2, 3, dpif_netdev_miniflow_extract_set,
+                             NULL);
+    unixctl_command_register("dpif-netdev/miniflow-extract-prio-get", "",
+                             0, 0, dpif_netdev_miniflow_extract_get,
+                             NULL);
     return 0;
 }
 
@@ -1368,6 +1717,7 @@ construct_dp_netdev(const char *name, const struct dpif_class *class,
     dp->port_seq = seq_create();
     ovs_mutex_init(&dp->bond_mutex);
     cmap_init(&dp->tx_bonds);
+    cmap_init(&dp->tx_rings);
 
     fat_rwlock_init(&dp->upcall_rwlock);
 
@@ -1388,7 +1738,10 @@ construct_dp_netdev(const char *name, const struct dpif_class *class,
     dp->conntrack = conntrack_init();
 
     atomic_init(&dp->emc_insert_min, DEFAULT_EM_FLOW_INSERT_MIN);
+    atomic_init(&dp->emc_insert_auto, DEFAULT_EM_FLOW_INSERT_AUTO);
+    atomic_init(&dp->smc_n_entries, SMC_DEFAULT_ENTRIES);
     atomic_init(&dp->tx_flush_interval, DEFAULT_TX_FLUSH_INTERVAL);
+    atomic_init(&dp->pmd_max_sleep, 0);
 
     cmap_init(&dp->poll_threads);
     dp->pmd_rxq_assign_cyc = true;
@@ -1528,6 +1881,12 @@ dp_netdev_free(struct dp_netdev *dp)
     }
     ovs_mutex_unlock(&dp->port_mutex);
 
+    if (dp->tx_flusher_running) {
+        atomic_store_relaxed(&dp->tx_flusher_exit, true);
+        xpthread_join(dp->tx_flusher, NULL);
+        dp->tx_flusher_running = false;
+    }
+
     ovs_mutex_lock(&dp->bond_mutex);
     CMAP_FOR_EACH (bond, node, &dp->tx_bonds) {
         cmap_remove(&dp->tx_bonds, &bond->node, hash_bond_id(bond->bond_id));
@@ -1553,6 +1912,7 @@ dp_netdev_free(struct dp_netdev *dp)
     hmap_destroy(&dp->ports);
     ovs_mutex_destroy(&dp->port_mutex);
 
+    cmap_destroy(&dp->tx_rings);
     cmap_destroy(&dp->tx_bonds);
     ovs_mutex_destroy(&dp->bond_mutex);
 
@@ -1673,6 +2033,209 @@ hash_port_no(odp_port_t port_no)
     return hash_int(odp_to_u32(port_no), 0);
 }
 
+/* Per-port transmit ring for the tx flusher thread.
+ *
+ * When 'other_config:pmd-tx-flusher' is set and a port has fewer tx queues
+ * than there are threads, PMDs enqueue their output bursts here instead of
+ * sending under the shared XPS queue lock.  The ring is a bounded
+ * multi-producer, single-consumer queue: any thread may push, only the
+ * flusher thread pops.  Each slot carries a sequence number; a producer
+ * claims a slot by advancing 'tail' with a compare-and-swap and publishes
+ * the copied batch by bumping the slot's sequence, so a slow producer never
+ * blocks the others or the consumer. */
+#define DP_TX_RING_SIZE 32
+#define DP_TX_RING_MASK (DP_TX_RING_SIZE - 1)
+BUILD_ASSERT_DECL(IS_POW2(DP_TX_RING_SIZE));
+
+struct dp_tx_ring_slot {
+    atomic_uint32_t seq;        /* Slot state, Vyukov-style. */
+    struct dp_packet_batch batch;
+};
+
+struct dp_tx_ring {
+    struct cmap_node node;      /* In dp_netdev's 'tx_rings'. */
+    odp_port_t port_no;
+    struct netdev *netdev;      /* Owns a reference. */
+
+    OVS_ALIGNED_VAR(CACHE_LINE_SIZE) atomic_uint32_t tail; /* Producers. */
+    OVS_ALIGNED_VAR(CACHE_LINE_SIZE) uint32_t head; /* Flusher thread only. */
+    OVS_ALIGNED_VAR(CACHE_LINE_SIZE)
+        struct dp_tx_ring_slot slots[DP_TX_RING_SIZE];
+};
+
+/* Enqueues a copy of 'batch' for the flusher thread.  Returns false if the
+ * ring is full; the caller then transmits the batch itself. */
+static inline bool
+dp_tx_ring_push(struct dp_tx_ring *ring, const struct dp_packet_batch *batch)
+{
+    uint32_t pos;
+
+    atomic_read_relaxed(&ring->tail, &pos);
+    for (;;) {
+        struct dp_tx_ring_slot *slot = &ring->slots[pos & DP_TX_RING_MASK];
+        uint32_t seq;
+
+        atomic_read_explicit(&slot->seq, &seq, memory_order_acquire);
+        if (seq == pos) {
+            if (atomic_compare_exchange_strong(&ring->tail, &pos, pos + 1)) {
+                slot->batch = *batch;
+                atomic_store_explicit(&slot->seq, pos + 1,
+                                      memory_order_release);
+                return true;
+            }
+            /* 'pos' was refreshed by the failed exchange; retry. */
+        } else if ((int32_t) (seq - pos) < 0) {
+            /* The consumer has not released this slot yet. */
+            return false;
+        } else {
+            atomic_read_relaxed(&ring->tail, &pos);
+        }
+    }
+}
+
+/* Takes the oldest batch off 'ring'.  Only the flusher thread (or a thread
+ * that knows the flusher is stopped) may call this. */
+static inline bool
+dp_tx_ring_pop(struct dp_tx_ring *ring, struct dp_packet_batch *batch)
+{
+    struct dp_tx_ring_slot *slot = &ring->slots[ring->head & DP_TX_RING_MASK];
+    uint32_t seq;
+
+    atomic_read_explicit(&slot->seq, &seq, memory_order_acquire);
+    if (seq != ring->head + 1) {
+        return false;
+    }
+    *batch = slot->batch;
+    atomic_store_explicit(&slot->seq, ring->head + DP_TX_RING_SIZE,
+                          memory_order_release);
+    ring->head++;
+    return true;
+}
+
+/* Transmits everything queued on 'ring'.  Returns the number of packets
+ * sent. */
+static int
+dp_tx_ring_flush(struct dp_tx_ring *ring)
+{
+    struct dp_packet_batch batch;
+    int cnt = 0;
+
+    while (dp_tx_ring_pop(ring, &batch)) {
+        cnt += dp_packet_batch_size(&batch);
+        /* Queue 0 may still be used concurrently by non-pmd threads, so
+         * send with 'concurrent_txq' set. */
+        netdev_send(ring->netdev, 0, &batch, true);
+    }
+    return cnt;
+}
+
+static void
+dp_tx_ring_add(struct dp_netdev *dp, struct dp_netdev_port *port)
+    OVS_REQUIRES(dp->port_mutex)
+{
+    struct dp_tx_ring *ring;
+    int i;
+
+    ring = xzalloc(sizeof *ring);
+    ring->port_no = port->port_no;
+    ring->netdev = netdev_ref(port->netdev);
+    atomic_init(&ring->tail, 0);
+    for (i = 0; i < DP_TX_RING_SIZE; i++) {
+        atomic_init(&ring->slots[i].seq, i);
+    }
+    cmap_insert(&dp->tx_rings, &ring->node, hash_port_no(port->port_no));
+    port->tx_ring = ring;
+}
+
+static void
+dp_tx_ring_free(struct dp_tx_ring *ring)
+{
+    struct dp_packet_batch batch_;
+    struct dp_packet_batch *batch = &batch_;
+
+    /* The flusher can no longer reach the ring; drop whatever is left. */
+    while (dp_tx_ring_pop(ring, batch)) {
+        struct dp_packet *packet;
+
+        DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+            dp_packet_delete(packet);
+        }
+    }
+    netdev_close(ring->netdev);
+    free(ring);
+}
+
+static void
+dp_tx_ring_del(struct dp_netdev *dp, struct dp_netdev_port *port)
+    OVS_REQUIRES(dp->port_mutex)
+{
+    if (port->tx_ring) {
+        cmap_remove(&dp->tx_rings, &port->tx_ring->node,
+                    hash_port_no(port->port_no));
+        ovsrcu_postpone(dp_tx_ring_free, port->tx_ring);
+        port->tx_ring = NULL;
+    }
+}
+
+static void *
+tx_flusher_main(void *dp_)
+{
+    struct dp_netdev *dp = dp_;
+
+    for (;;) {
+        struct dp_tx_ring *ring;
+        int sent = 0;
+        bool exit;
+
+        atomic_read_relaxed(&dp->tx_flusher_exit, &exit);
+        if (exit) {
+            break;
+        }
+
+        CMAP_FOR_EACH (ring, node, &dp->tx_rings) {
+            sent += dp_tx_ring_flush(ring);
+        }
+
+        if (!sent) {
+            /* Nothing queued: let RCU make progress instead of spinning
+             * flat out. */
+            ovsrcu_quiesce();
+        } else {
+            ovsrcu_try_quiesce();
+        }
+    }
+
+    return NULL;
+}
+
+/* Starts or stops the tx flusher thread.  On stop, transmits anything the
+ * producers managed to queue before they saw the flag flip, so no packets
+ * are dropped. */
+static void
+dp_netdev_set_tx_flusher(struct dp_netdev *dp, bool enable)
+{
+    ovs_mutex_lock(&dp_netdev_mutex);
+    if (enable && !dp->tx_flusher_running) {
+        atomic_store_relaxed(&dp->tx_flusher_exit, false);
+        dp->tx_flusher = ovs_thread_create("tx_flush", tx_flusher_main, dp);
+        dp->tx_flusher_running = true;
+        atomic_store_relaxed(&dp->tx_flusher_enabled, true);
+        VLOG_INFO("Tx flusher thread started");
+    } else if (!enable && dp->tx_flusher_running) {
+        struct dp_tx_ring *ring;
+
+        atomic_store_relaxed(&dp->tx_flusher_enabled, false);
+        atomic_store_relaxed(&dp->tx_flusher_exit, true);
+        xpthread_join(dp->tx_flusher, NULL);
+        dp->tx_flusher_running = false;
+        CMAP_FOR_EACH (ring, node, &dp->tx_rings) {
+            dp_tx_ring_flush(ring);
+        }
+        VLOG_INFO("Tx flusher thread stopped");
+    }
+    ovs_mutex_unlock(&dp_netdev_mutex);
+}
+
 static int
 port_create(const char *devname, const char *type,
             odp_port_t port_no, struct dp_netdev_port **portp)
@@ -1737,6 +2300,7 @@ do_add_port(struct dp_netdev *dp, const char *devname, const char *type,
 
     hmap_insert(&dp->ports, &port->node, hash_port_no(port_no));
     seq_change(dp->port_seq);
+    dp_tx_ring_add(dp, port);
 
     reconfigure_datapath(dp);
 
@@ -1907,6 +2471,7 @@ do_del_port(struct dp_netdev *dp, struct dp_netdev_port *port)
 {
     hmap_remove(&dp->ports, &port->node);
     seq_change(dp->port_seq);
+    dp_tx_ring_del(dp, port);
 
     reconfigure_datapath(dp);
 
@@ -2037,27 +2602,35 @@ static struct flow_mark flow_mark = {
     .mark_to_flow = CMAP_INITIALIZER,
 };
 
+/* Serializes writers of the flow mark maps and the mark id pool above.
+ * Offload workers for different ports may manipulate marks concurrently,
+ * while lookups remain lockless cmap reads. */
+static struct ovs_mutex flow_mark_mutex = OVS_MUTEX_INITIALIZER;
+
 static uint32_t
 flow_mark_alloc(void)
 {
     uint32_t mark;
+    bool allocated;
 
+    ovs_mutex_lock(&flow_mark_mutex);
     if (!flow_mark.pool) {
         /* Haven't initiated yet, do it here */
         flow_mark.pool = id_pool_create(1, MAX_FLOW_MARK);
     }
 
-    if (id_pool_alloc_id(flow_mark.pool, &mark)) {
-        return mark;
-    }
+    allocated = id_pool_alloc_id(flow_mark.pool, &mark);
+    ovs_mutex_unlock(&flow_mark_mutex);
 
-    return INVALID_FLOW_MARK;
+    return allocated ? mark : INVALID_FLOW_MARK;
 }
 
 static void
 flow_mark_free(uint32_t mark)
 {
+    ovs_mutex_lock(&flow_mark_mutex);
     id_pool_free_id(flow_mark.pool, mark);
+    ovs_mutex_unlock(&flow_mark_mutex);
 }
 
 /* associate megaflow with a mark, which is a 1:1 mapping */
@@ -2070,8 +2643,10 @@ megaflow_to_mark_associate(const ovs_u128 *mega_ufid, uint32_t mark)
     data->mega_ufid = *mega_ufid;
     data->mark = mark;
 
+    ovs_mutex_lock(&flow_mark_mutex);
     cmap_insert(&flow_mark.megaflow_to_mark,
                 CONST_CAST(struct cmap_node *, &data->node), hash);
+    ovs_mutex_unlock(&flow_mark_mutex);
 }
 
 /* disassociate meagaflow with a mark */
@@ -2083,8 +2658,10 @@ megaflow_to_mark_disassociate(const ovs_u128 *mega_ufid)
 
     CMAP_FOR_EACH_WITH_HASH (data, node, hash, &flow_mark.megaflow_to_mark) {
         if (ovs_u128_equals(*mega_ufid, data->mega_ufid)) {
+            ovs_mutex_lock(&flow_mark_mutex);
             cmap_remove(&flow_mark.megaflow_to_mark,
                         CONST_CAST(struct cmap_node *, &data->node), hash);
+            ovs_mutex_unlock(&flow_mark_mutex);
             ovsrcu_postpone(free, data);
             return;
         }
@@ -2117,9 +2694,11 @@ mark_to_flow_associate(const uint32_t mark, struct dp_netdev_flow *flow)
 {
     dp_netdev_flow_ref(flow);
 
+    ovs_mutex_lock(&flow_mark_mutex);
     cmap_insert(&flow_mark.mark_to_flow,
                 CONST_CAST(struct cmap_node *, &flow->mark_node),
                 hash_int(mark, 0));
+    ovs_mutex_unlock(&flow_mark_mutex);
     flow->mark = mark;
 
     VLOG_DBG("Associated dp_netdev flow %p with mark %u mega_ufid "UUID_FMT,
@@ -2157,7 +2736,9 @@ mark_to_flow_disassociate(struct dp_netdev_pmd_thread *pmd,
         return EINVAL;
     }
 
+    ovs_mutex_lock(&flow_mark_mutex);
     cmap_remove(&flow_mark.mark_to_flow, mark_node, hash_int(mark, 0));
+    ovs_mutex_unlock(&flow_mark_mutex);
     flow->mark = INVALID_FLOW_MARK;
 
     /*
@@ -2170,11 +2751,10 @@ mark_to_flow_disassociate(struct dp_netdev_pmd_thread *pmd,
 
         port = netdev_ports_get(in_port, dpif_type_str);
         if (port) {
-            /* Taking a global 'port_mutex' to fulfill thread safety
-             * restrictions for the netdev-offload-dpdk module. */
-            ovs_mutex_lock(&pmd->dp->port_mutex);
+            /* All offload requests for 'in_port' are handled by this
+             * thread, so the netdev-offload-dpdk module never sees
+             * concurrent calls for one netdev. */
             ret = netdev_flow_del(port, &flow->mega_ufid, NULL);
-            ovs_mutex_unlock(&pmd->dp->port_mutex);
             netdev_close(port);
         }
 
@@ -2249,10 +2829,18 @@ dp_netdev_free_flow_offload(struct dp_flow_offload_item *offload)
 static void
 dp_netdev_append_flow_offload(struct dp_flow_offload_item *offload)
 {
-    ovs_mutex_lock(&dp_flow_offload.mutex);
-    ovs_list_push_back(&dp_flow_offload.list, &offload->node);
-    xpthread_cond_signal(&dp_flow_offload.cond);
-    ovs_mutex_unlock(&dp_flow_offload.mutex);
+    odp_port_t in_port = offload->flow->flow.in_port.odp_port;
+    struct dp_flow_offload *offload_queue;
+
+    /* Keying the queue by input port keeps all operations for a given
+     * port, and thus for a given megaflow, ordered on one worker. */
+    offload_queue = &dp_flow_offload[hash_int(odp_to_u32(in_port), 0)
+                                     % DP_FLOW_OFFLOAD_THREADS];
+
+    ovs_mutex_lock(&offload_queue->mutex);
+    ovs_list_push_back(&offload_queue->list, &offload->node);
+    xpthread_cond_signal(&offload_queue->cond);
+    ovs_mutex_unlock(&offload_queue->mutex);
 }
 
 static int
@@ -2321,14 +2909,13 @@ dp_netdev_flow_offload_put(struct dp_flow_offload_item *offload)
         netdev_close(port);
         goto err_free;
     }
-    /* Taking a global 'port_mutex' to fulfill thread safety restrictions for
-     * the netdev-offload-dpdk module. */
-    ovs_mutex_lock(&pmd->dp->port_mutex);
+    /* All offload requests for 'in_port' are handled by this thread, so the
+     * netdev-offload-dpdk module never sees concurrent calls for one
+     * netdev. */
     ret = netdev_flow_put(port, &offload->match,
                           CONST_CAST(struct nlattr *, offload->actions),
                           offload->actions_len, &flow->mega_ufid, &info,
                           NULL);
-    ovs_mutex_unlock(&pmd->dp->port_mutex);
     netdev_close(port);
 
     if (ret) {
@@ -2351,24 +2938,25 @@ err_free:
 }
 
 static void *
-dp_netdev_flow_offload_main(void *data OVS_UNUSED)
+dp_netdev_flow_offload_main(void *data)
 {
+    struct dp_flow_offload *offload_queue = data;
     struct dp_flow_offload_item *offload;
     struct ovs_list *list;
     const char *op;
     int ret;
 
     for (;;) {
-        ovs_mutex_lock(&dp_flow_offload.mutex);
-        if (ovs_list_is_empty(&dp_flow_offload.list)) {
+        ovs_mutex_lock(&offload_queue->mutex);
+        if (ovs_list_is_empty(&offload_queue->list)) {
             ovsrcu_quiesce_start();
-            ovs_mutex_cond_wait(&dp_flow_offload.cond,
-                                &dp_flow_offload.mutex);
+            ovs_mutex_cond_wait(&offload_queue->cond,
+                                &offload_queue->mutex);
             ovsrcu_quiesce_end();
         }
-        list = ovs_list_pop_front(&dp_flow_offload.list);
+        list = ovs_list_pop_front(&offload_queue->list);
         offload = CONTAINER_OF(list, struct dp_flow_offload_item, node);
-        ovs_mutex_unlock(&dp_flow_offload.mutex);
+        ovs_mutex_unlock(&offload_queue->mutex);
 
         switch (offload->op) {
         case DP_NETDEV_FLOW_OFFLOAD_OP_ADD:
@@ -2397,18 +2985,30 @@ dp_netdev_flow_offload_main(void *data OVS_UNUSED)
     return NULL;
 }
 
+static void
+dp_netdev_offload_threads_start(void)
+{
+    if (ovsthread_once_start(&offload_thread_once)) {
+        for (int i = 0; i < DP_FLOW_OFFLOAD_THREADS; i++) {
+            struct dp_flow_offload *offload_queue = &dp_flow_offload[i];
+
+            ovs_mutex_init(&offload_queue->mutex);
+            ovs_list_init(&offload_queue->list);
+            xpthread_cond_init(&offload_queue->cond, NULL);
+            ovs_thread_create("dp_netdev_flow_offload",
+                              dp_netdev_flow_offload_main, offload_queue);
+        }
+        ovsthread_once_done(&offload_thread_once);
+    }
+}
+
 static void
 queue_netdev_flow_del(struct dp_netdev_pmd_thread *pmd,
                       struct dp_netdev_flow *flow)
 {
     struct dp_flow_offload_item *offload;
 
-    if (ovsthread_once_start(&offload_thread_once)) {
-        xpthread_cond_init(&dp_flow_offload.cond, NULL);
-        ovs_thread_create("dp_netdev_flow_offload",
-                          dp_netdev_flow_offload_main, NULL);
-        ovsthread_once_done(&offload_thread_once);
-    }
+    dp_netdev_offload_threads_start();
 
     offload = dp_netdev_alloc_flow_offload(pmd, flow,
                                            DP_NETDEV_FLOW_OFFLOAD_OP_DEL);
@@ -2427,12 +3027,7 @@ queue_netdev_flow_put(struct dp_netdev_pmd_thread *pmd,
         return;
     }
 
-    if (ovsthread_once_start(&offload_thread_once)) {
-        xpthread_cond_init(&dp_flow_offload.cond, NULL);
-        ovs_thread_create("dp_netdev_flow_offload",
-                          dp_netdev_flow_offload_main, NULL);
-        ovsthread_once_done(&offload_thread_once);
-    }
+    dp_netdev_offload_threads_start();
 
     if (flow->mark != INVALID_FLOW_MARK) {
         op = DP_NETDEV_FLOW_OFFLOAD_OP_MOD;
@@ -2459,7 +3054,7 @@ dp_netdev_pmd_remove_flow(struct dp_netdev_pmd_thread *pmd,
 
     cls = dp_netdev_pmd_lookup_dpcls(pmd, in_port);
     ovs_assert(cls != NULL);
-    dpcls_remove(cls, &flow->cr);
+    dpcls_remove(cls, flow->cr);
     cmap_remove(&pmd->flow_table, node, dp_netdev_flow_hash(&flow->ufid));
     if (flow->mark != INVALID_FLOW_MARK) {
         queue_netdev_flow_del(pmd, flow);
@@ -2570,7 +3165,7 @@ dpif_netdev_port_poll_wait(const struct dpif *dpif_)
 static struct dp_netdev_flow *
 dp_netdev_flow_cast(const struct dpcls_rule *cr)
 {
-    return cr ? CONTAINER_OF(cr, struct dp_netdev_flow, cr) : NULL;
+    return cr ? cr->dp_flow : NULL;
 }
 
 static bool dp_netdev_flow_ref(struct dp_netdev_flow *flow)
@@ -2660,6 +3255,27 @@ netdev_flow_mask_init(struct netdev_flow_key *mask,
     mask->len = netdev_flow_key_size(n);
 }
 
+/* Initializes 'key' as a copy of the full 'flow', the way a packet's key
+ * would look after miniflow extraction. */
+static inline void
+netdev_flow_key_init(struct netdev_flow_key *key, const struct flow *flow)
+{
+    uint64_t *values;
+    uint32_t hash = 0;
+    size_t n;
+
+    miniflow_map_init(&key->mf, flow);
+    miniflow_init(&key->mf, flow);
+
+    values = miniflow_values(&key->mf);
+    n = miniflow_n_values(&key->mf);
+    for (size_t i = 0; i < n; i++) {
+        hash = hash_add64(hash, values[i]);
+    }
+    key->hash = hash_finish(hash, n * 8);
+    key->len = netdev_flow_key_size(n);
+}
+
 /* Initializes 'dst' as a copy of 'flow' masked with 'mask'. */
 static inline void
 netdev_flow_key_init_masked(struct netdev_flow_key *dst,
@@ -2762,8 +3378,59 @@ emc_probabilistic_insert(struct dp_netdev_pmd_thread *pmd,
     }
 }
 
-static inline struct dp_netdev_flow *
-emc_lookup(struct emc_cache *cache, const struct netdev_flow_key *key)
+/* Minimum packets in a housekeeping interval for the EMC hit rate to be
+ * worth acting on. */
+#define EMC_TUNE_MIN_PKTS 10000
+/* Bounds of the self-tuned insertion threshold: between always inserting
+ * and inserting with probability ~1/4096, so that under heavy churn new
+ * elephants can still work their way into the cache. */
+#define EMC_TUNE_FLOOR (UINT32_MAX / 4096)
+/* Hit rate regressions smaller than this are treated as noise. */
+#define EMC_TUNE_TOLERANCE 0.01
+
+/* Adjusts the self-tuned EMC insertion threshold of 'pmd' by one step.
+ *
+ * This is a greedy hill climb on the measured EMC hit rate: the threshold
+ * keeps doubling or halving in the direction of the last adjustment while
+ * the hit rate improves, and reverses when it drops.  Elephant-dominated
+ * traffic converges towards frequent insertion, while high-churn mice
+ * traffic backs off before insertions start to thrash the cache.  Called
+ * from the housekeeping path, not per packet. */
+static void
+pmd_emc_insert_autotune(struct dp_netdev_pmd_thread *pmd)
+{
+    struct pmd_perf_stats *s = &pmd->perf_stats;
+    uint64_t hits, pkts, d_hits, d_pkts;
+    double hit_rate;
+
+    atomic_read_relaxed(&s->counters.n[PMD_STAT_EXACT_HIT], &hits);
+    atomic_read_relaxed(&s->counters.n[PMD_STAT_RECV], &pkts);
+    d_hits = hits - pmd->emc_tuner.last_hits;
+    d_pkts = pkts - pmd->emc_tuner.last_pkts;
+    if (d_pkts < EMC_TUNE_MIN_PKTS) {
+        /* Not enough traffic to measure; keep the current threshold. */
+        return;
+    }
+    pmd->emc_tuner.last_hits = hits;
+    pmd->emc_tuner.last_pkts = pkts;
+
+    hit_rate = (double) d_hits / d_pkts;
+    if (hit_rate + EMC_TUNE_TOLERANCE < pmd->emc_tuner.last_hit_rate) {
+        pmd->emc_tuner.increasing = !pmd->emc_tuner.increasing;
+    }
+    if (pmd->emc_tuner.increasing) {
+        uint32_t min = pmd->emc_tuner.min;
+
+        pmd->emc_tuner.min = min >= UINT32_MAX / 2 ? UINT32_MAX
+                             : MAX(2 * min, EMC_TUNE_FLOOR);
+    } else {
+        pmd->emc_tuner.min = MAX(pmd->emc_tuner.min / 2, EMC_TUNE_FLOOR);
+    }
+    pmd->emc_tuner.last_hit_rate = hit_rate;
+}
+
+static inline struct dp_netdev_flow *
+emc_lookup(struct emc_cache *cache, const struct netdev_flow_key *key)
 {
     struct emc_entry *current_entry;
 
@@ -2780,34 +3447,51 @@ emc_lookup(struct emc_cache *cache, const struct netdev_flow_key *key)
     return NULL;
 }
 
-static inline const struct cmap_node *
-smc_entry_get(struct dp_netdev_pmd_thread *pmd, const uint32_t hash)
+/* Issues prefetches for every entry emc_lookup() will probe for 'hash'.
+ * Doing this for a whole batch before the first probe hides the entry
+ * cache misses behind the remaining miniflow extractions. */
+static inline void
+emc_prefetch(struct emc_cache *cache, uint32_t hash)
+{
+    struct emc_entry *current_entry;
+
+    EMC_FOR_EACH_POS_WITH_HASH (cache, current_entry, hash) {
+        OVS_PREFETCH(current_entry);
+    }
+}
+
+static inline uint32_t
+smc_entry_get_index(const struct smc_cache *cache, const uint32_t hash)
 {
-    struct smc_cache *cache = &(pmd->flow_cache).smc_cache;
-    struct smc_bucket *bucket = &cache->buckets[hash & SMC_MASK];
+    const struct smc_bucket *bucket
+        = &cache->buckets[hash & cache->bucket_mask];
     uint16_t sig = hash >> 16;
-    uint16_t index = UINT16_MAX;
 
     for (int i = 0; i < SMC_ENTRY_PER_BUCKET; i++) {
         if (bucket->sig[i] == sig) {
-            index = bucket->flow_idx[i];
-            break;
+            return bucket->flow_idx[i];
         }
     }
-    if (index != UINT16_MAX) {
-        return cmap_find_by_index(&pmd->flow_table, index);
-    }
-    return NULL;
+    return SMC_ENTRY_NONE;
+}
+
+static inline const struct cmap_node *
+smc_entry_get(struct dp_netdev_pmd_thread *pmd, const uint32_t hash)
+{
+    uint32_t index = smc_entry_get_index(&pmd->flow_cache.smc_cache, hash);
+
+    return index != SMC_ENTRY_NONE
+           ? cmap_find_by_index(&pmd->flow_table, index) : NULL;
 }
 
 static void
 smc_clear_entry(struct smc_bucket *b, int idx)
 {
-    b->flow_idx[idx] = UINT16_MAX;
+    b->flow_idx[idx] = SMC_ENTRY_NONE;
 }
 
 /* Insert the flow_table index into SMC. Insertion may fail when 1) SMC is
- * turned off, 2) the flow_table index is larger than uint16_t can handle.
+ * turned off, 2) the flow is not in the flow table.
  * If there is already an SMC entry having same signature, the index will be
  * updated. If there is no existing entry, but an empty entry is available,
  * the empty entry will be taken. If no empty entry or existing same signature,
@@ -2818,9 +3502,9 @@ smc_insert(struct dp_netdev_pmd_thread *pmd,
            uint32_t hash)
 {
     struct smc_cache *smc_cache = &(pmd->flow_cache).smc_cache;
-    struct smc_bucket *bucket = &smc_cache->buckets[key->hash & SMC_MASK];
-    uint16_t index;
-    uint32_t cmap_index;
+    struct smc_bucket *bucket
+        = &smc_cache->buckets[key->hash & smc_cache->bucket_mask];
+    uint32_t index;
     bool smc_enable_db;
     int i;
 
@@ -2829,12 +3513,8 @@ smc_insert(struct dp_netdev_pmd_thread *pmd,
         return;
     }
 
-    cmap_index = cmap_find_index(&pmd->flow_table, hash);
-    index = (cmap_index >= UINT16_MAX) ? UINT16_MAX : (uint16_t)cmap_index;
-
-    /* If the index is larger than SMC can handle (uint16_t), we don't
-     * insert */
-    if (index == UINT16_MAX) {
+    index = cmap_find_index(&pmd->flow_table, hash);
+    if (index == SMC_ENTRY_NONE) {
         return;
     }
 
@@ -2848,7 +3528,7 @@ smc_insert(struct dp_netdev_pmd_thread *pmd,
     }
     /* If there is an empty entry, occupy it. */
     for (i = 0; i < SMC_ENTRY_PER_BUCKET; i++) {
-        if (bucket->flow_idx[i] == UINT16_MAX) {
+        if (bucket->flow_idx[i] == SMC_ENTRY_NONE) {
             bucket->sig[i] = sig;
             bucket->flow_idx[i] = index;
             return;
@@ -2978,8 +3658,10 @@ dpif_netdev_get_flow_offload_status(const struct dp_netdev *dp,
         return false;
     }
     ofpbuf_use_stack(&buf, &act_buf, sizeof act_buf);
-    /* Taking a global 'port_mutex' to fulfill thread safety
-     * restrictions for the netdev-offload-dpdk module.
+    /* Taking a global 'port_mutex' so that 'netdev' is not reconfigured
+     * underneath the query.  The netdev-offload-dpdk module serializes
+     * calls for a single netdev internally, so this no longer needs to
+     * exclude the offload threads.
      *
      * XXX: Main thread will try to pause/stop all revalidators during datapath
      *      reconfiguration via datapath purge callback (dp_purge_cb) while
@@ -3074,11 +3756,23 @@ dp_netdev_flow_to_dpif_flow(const struct dp_netdev *dp,
             .support = dp_netdev_support,
         };
 
-        miniflow_expand(&netdev_flow->cr.mask->mf, &wc.masks);
+        miniflow_expand(&netdev_flow->cr->mask->mf, &wc.masks);
         /* in_port is exact matched, but we have left it out from the mask for
          * optimnization reasons. Add in_port back to the mask. */
         wc.masks.in_port.odp_port = ODPP_NONE;
 
+        /* Reserve space for both the key and the mask before taking tail
+         * pointers into the buffers, so that encoding the attributes in
+         * place cannot reallocate the buffers and leave 'flow->key' or
+         * 'flow->mask' dangling.  ('key_buf' and 'mask_buf' may be the same
+         * buffer.) */
+        if (key_buf == mask_buf) {
+            ofpbuf_prealloc_tailroom(key_buf, 2 * ODPUTIL_FLOW_KEY_BYTES);
+        } else {
+            ofpbuf_prealloc_tailroom(key_buf, ODPUTIL_FLOW_KEY_BYTES);
+            ofpbuf_prealloc_tailroom(mask_buf, ODPUTIL_FLOW_KEY_BYTES);
+        }
+
         /* Key */
         offset = key_buf->size;
         flow->key = ofpbuf_tail(key_buf);
@@ -3269,14 +3963,16 @@ dp_netdev_flow_add(struct dp_netdev_pmd_thread *pmd,
     ovs_assert(!FLOWMAP_HAS_FIELD(&mask.mf.map, metadata)
                && !FLOWMAP_HAS_FIELD(&mask.mf.map, regs));
 
-    /* Do not allocate extra space. */
-    flow = xmalloc(sizeof *flow - sizeof flow->cr.flow.mf + mask.len);
+    flow = xmalloc(sizeof *flow);
     memset(&flow->stats, 0, sizeof flow->stats);
+    memset(&flow->pending_stats, 0, sizeof flow->pending_stats);
+    ovs_list_init(&flow->pending_node);
     atomic_init(&flow->netdev_flow_get_result, 0);
     memset(&flow->last_stats, 0, sizeof flow->last_stats);
     memset(&flow->last_attrs, 0, sizeof flow->last_attrs);
     flow->dead = false;
     flow->batch = NULL;
+    flow->ct_ref.conn = NULL;
     flow->mark = INVALID_FLOW_MARK;
     *CONST_CAST(unsigned *, &flow->pmd_id) = pmd->core_id;
     *CONST_CAST(struct flow *, &flow->flow) = match->flow;
@@ -3285,11 +3981,10 @@ dp_netdev_flow_add(struct dp_netdev_pmd_thread *pmd,
     ovsrcu_set(&flow->actions, dp_netdev_actions_create(actions, actions_len));
 
     dp_netdev_get_mega_ufid(match, CONST_CAST(ovs_u128 *, &flow->mega_ufid));
-    netdev_flow_key_init_masked(&flow->cr.flow, &match->flow, &mask);
 
     /* Select dpcls for in_port. Relies on in_port to be exact match. */
     cls = dp_netdev_pmd_find_dpcls(pmd, in_port);
-    dpcls_insert(cls, &flow->cr, &mask);
+    flow->cr = dpcls_insert(cls, flow, &match->flow, &mask);
 
     ds_put_cstr(&extra_info, "miniflow_bits(");
     FLOWMAP_FOR_EACH_UNIT (unit) {
@@ -3297,7 +3992,7 @@ dp_netdev_flow_add(struct dp_netdev_pmd_thread *pmd,
             ds_put_char(&extra_info, ',');
         }
         ds_put_format(&extra_info, "%d",
-                      count_1bits(flow->cr.mask->mf.map.bits[unit]));
+                      count_1bits(flow->cr->mask->mf.map.bits[unit]));
     }
     ds_put_char(&extra_info, ')');
     flow->dp_extra_info = ds_steal_cstr(&extra_info);
@@ -3344,8 +4039,8 @@ dp_netdev_flow_add(struct dp_netdev_pmd_thread *pmd,
         struct match m;
         ds_clear(&ds);
         ds_put_cstr(&ds, "flow match: ");
-        miniflow_expand(&flow->cr.flow.mf, &m.flow);
-        miniflow_expand(&flow->cr.mask->mf, &m.wc.masks);
+        miniflow_expand(&flow->cr->flow.mf, &m.flow);
+        miniflow_expand(&flow->cr->mask->mf, &m.wc.masks);
         memset(&m.tun_md, 0, sizeof m.tun_md);
         match_format(&m, NULL, &ds, OFP_DEFAULT_PRIORITY);
 
@@ -3427,7 +4122,7 @@ static int
 dpif_netdev_flow_put(struct dpif *dpif, const struct dpif_flow_put *put)
 {
     struct dp_netdev *dp = get_dp_netdev(dpif);
-    struct netdev_flow_key key, mask;
+    struct netdev_flow_key key;
     struct dp_netdev_pmd_thread *pmd;
     struct match match;
     ovs_u128 ufid;
@@ -3465,11 +4160,12 @@ dpif_netdev_flow_put(struct dpif *dpif, const struct dpif_flow_put *put)
         match.wc.masks.vlans[0].tci = htons(0xffff);
     }
 
-    /* Must produce a netdev_flow_key for lookup.
-     * Use the same method as employed to create the key when adding
-     * the flow to the dplcs to make sure they match. */
-    netdev_flow_mask_init(&mask, &match);
-    netdev_flow_key_init_masked(&key, &match.flow, &mask);
+    /* Must produce a netdev_flow_key for lookup.  The key carries the full
+     * flow, the way a packet's key would: the flow may have been installed
+     * under a wider subtable mask than its own (see
+     * dpcls_find_adoptable_subtable()), in which case a key masked with only
+     * the flow's own mask would fail to match it. */
+    netdev_flow_key_init(&key, &match.flow);
 
     if (put->pmd_id == PMD_ID_NULL) {
         if (cmap_count(&dp->poll_threads) == 0) {
@@ -3526,6 +4222,35 @@ flow_del_on_pmd(struct dp_netdev_pmd_thread *pmd,
     return error;
 }
 
+/* Deletes a run of flows that all live on 'pmd', taking the flow table
+ * lock once for the whole run.  Fills in each op's error and stats. */
+static void
+flow_del_batch_on_pmd(struct dp_netdev_pmd_thread *pmd,
+                      struct dpif_op **ops, size_t n_ops)
+{
+    ovs_mutex_lock(&pmd->flow_mutex);
+    for (size_t i = 0; i < n_ops; i++) {
+        struct dpif_flow_del *del = &ops[i]->flow_del;
+        struct dp_netdev_flow *netdev_flow;
+
+        if (del->stats) {
+            memset(del->stats, 0, sizeof *del->stats);
+        }
+        netdev_flow = dp_netdev_pmd_find_flow(pmd, del->ufid, del->key,
+                                              del->key_len);
+        if (netdev_flow) {
+            if (del->stats) {
+                get_dpif_flow_status(pmd->dp, netdev_flow, del->stats, NULL);
+            }
+            dp_netdev_pmd_remove_flow(pmd, netdev_flow);
+            ops[i]->error = 0;
+        } else {
+            ops[i]->error = ENOENT;
+        }
+    }
+    ovs_mutex_unlock(&pmd->flow_mutex);
+}
+
 static int
 dpif_netdev_flow_del(struct dpif *dpif, const struct dpif_flow_del *del)
 {
@@ -3570,9 +4295,10 @@ dpif_netdev_flow_del(struct dpif *dpif, const struct dpif_flow_del *del)
 
 struct dpif_netdev_flow_dump {
     struct dpif_flow_dump up;
+    /* Hands out pmd threads to dump threads.  The dump threads themselves
+     * walk their pmd's flow table without taking 'mutex', so dumps scale
+     * with the number of dump threads. */
     struct cmap_position poll_thread_pos;
-    struct cmap_position flow_pos;
-    struct dp_netdev_pmd_thread *cur_pmd;
     int status;
     struct ovs_mutex mutex;
 };
@@ -3610,6 +4336,11 @@ dpif_netdev_flow_dump_destroy(struct dpif_flow_dump *dump_)
 struct dpif_netdev_flow_dump_thread {
     struct dpif_flow_dump_thread up;
     struct dpif_netdev_flow_dump *dump;
+    /* The pmd whose flow table this thread is currently walking, and the
+     * iteration position within it.  Private to this thread, so iteration
+     * does not serialize on the dump's mutex. */
+    struct dp_netdev_pmd_thread *cur_pmd;
+    struct cmap_position flow_pos;
     struct odputil_keybuf keybuf[FLOW_DUMP_MAX_BATCH];
     struct odputil_keybuf maskbuf[FLOW_DUMP_MAX_BATCH];
 };
@@ -3629,6 +4360,8 @@ dpif_netdev_flow_dump_thread_create(struct dpif_flow_dump *dump_)
     thread = xmalloc(sizeof *thread);
     dpif_flow_dump_thread_init(&thread->up, &dump->up);
     thread->dump = dump;
+    thread->cur_pmd = NULL;
+    memset(&thread->flow_pos, 0, sizeof thread->flow_pos);
     return &thread->up;
 }
 
@@ -3638,6 +4371,10 @@ dpif_netdev_flow_dump_thread_destroy(struct dpif_flow_dump_thread *thread_)
     struct dpif_netdev_flow_dump_thread *thread
         = dpif_netdev_flow_dump_thread_cast(thread_);
 
+    if (thread->cur_pmd) {
+        /* The dump was cut short while this thread still held a pmd. */
+        dp_netdev_pmd_unref(thread->cur_pmd);
+    }
     free(thread);
 }
 
@@ -3651,57 +4388,58 @@ dpif_netdev_flow_dump_next(struct dpif_flow_dump_thread *thread_,
     struct dp_netdev_flow *netdev_flows[FLOW_DUMP_MAX_BATCH];
     struct dpif_netdev *dpif = dpif_netdev_cast(thread->up.dpif);
     struct dp_netdev *dp = get_dp_netdev(&dpif->dpif);
+    struct dp_netdev_pmd_thread *pmd = thread->cur_pmd;
+    int flow_limit = MIN(max_flows, FLOW_DUMP_MAX_BATCH);
     int n_flows = 0;
     int i;
 
-    ovs_mutex_lock(&dump->mutex);
-    if (!dump->status) {
-        struct dp_netdev_pmd_thread *pmd = dump->cur_pmd;
-        int flow_limit = MIN(max_flows, FLOW_DUMP_MAX_BATCH);
-
-        /* First call to dump_next(), extracts the first pmd thread.
-         * If there is no pmd thread, returns immediately. */
+    /* Each dump thread walks one pmd's flow table at a time with private
+     * iteration state; the dump's mutex is taken only to hand out the next
+     * pmd thread.  With several dump threads the pmds are thus dumped in
+     * parallel. */
+    for (;;) {
         if (!pmd) {
-            pmd = dp_netdev_pmd_get_next(dp, &dump->poll_thread_pos);
+            ovs_mutex_lock(&dump->mutex);
+            if (!dump->status) {
+                pmd = dp_netdev_pmd_get_next(dp, &dump->poll_thread_pos);
+                if (!pmd) {
+                    dump->status = EOF;
+                }
+            }
+            ovs_mutex_unlock(&dump->mutex);
             if (!pmd) {
-                ovs_mutex_unlock(&dump->mutex);
-                return n_flows;
-
+                break;
             }
+            memset(&thread->flow_pos, 0, sizeof thread->flow_pos);
         }
 
-        do {
-            for (n_flows = 0; n_flows < flow_limit; n_flows++) {
-                struct cmap_node *node;
+        for (; n_flows < flow_limit; n_flows++) {
+            struct cmap_node *node;
 
-                node = cmap_next_position(&pmd->flow_table, &dump->flow_pos);
-                if (!node) {
-                    break;
-                }
-                netdev_flows[n_flows] = CONTAINER_OF(node,
-                                                     struct dp_netdev_flow,
-                                                     node);
-            }
-            /* When finishing dumping the current pmd thread, moves to
-             * the next. */
-            if (n_flows < flow_limit) {
-                memset(&dump->flow_pos, 0, sizeof dump->flow_pos);
-                dp_netdev_pmd_unref(pmd);
-                pmd = dp_netdev_pmd_get_next(dp, &dump->poll_thread_pos);
-                if (!pmd) {
-                    dump->status = EOF;
-                    break;
-                }
+            node = cmap_next_position(&pmd->flow_table, &thread->flow_pos);
+            if (!node) {
+                break;
             }
-            /* Keeps the reference to next caller. */
-            dump->cur_pmd = pmd;
+            netdev_flows[n_flows] = CONTAINER_OF(node,
+                                                 struct dp_netdev_flow,
+                                                 node);
+        }
 
-            /* If the current dump is empty, do not exit the loop, since the
-             * remaining pmds could have flows to be dumped.  Just dumps again
-             * on the new 'pmd'. */
-        } while (!n_flows);
+        if (n_flows == flow_limit) {
+            /* Batch is full; keep the pmd for the next call. */
+            break;
+        }
+
+        /* This pmd is exhausted.  Return what we have, but if the batch is
+         * still empty keep going, since the remaining pmds could have flows
+         * to be dumped. */
+        dp_netdev_pmd_unref(pmd);
+        pmd = NULL;
+        if (n_flows) {
+            break;
+        }
     }
-    ovs_mutex_unlock(&dump->mutex);
+    thread->cur_pmd = pmd;
 
     for (i = 0; i < n_flows; i++) {
         struct odputil_keybuf *maskbuf = &thread->maskbuf[i];
@@ -3775,7 +4513,7 @@ dpif_netdev_execute(struct dpif *dpif, struct dpif_execute *execute)
 
     dp_packet_batch_init_packet(&pp, execute->packet);
     pp.do_not_steal = true;
-    dp_netdev_execute_actions(pmd, &pp, false, execute->flow,
+    dp_netdev_execute_actions(pmd, &pp, false, execute->flow, NULL,
                               execute->actions, execute->actions_len);
     dp_netdev_pmd_flush_output_packets(pmd, true);
 
@@ -3801,9 +4539,36 @@ dpif_netdev_operate(struct dpif *dpif, struct dpif_op **ops, size_t n_ops,
             op->error = dpif_netdev_flow_put(dpif, &op->flow_put);
             break;
 
-        case DPIF_OP_FLOW_DEL:
-            op->error = dpif_netdev_flow_del(dpif, &op->flow_del);
+        case DPIF_OP_FLOW_DEL: {
+            /* Revalidator sweeps order deletions so that those bound for
+             * the same PMD are adjacent; service such a run under a single
+             * acquisition of that PMD's flow table lock. */
+            size_t run = 1;
+
+            while (i + run < n_ops
+                   && ops[i + run]->type == DPIF_OP_FLOW_DEL
+                   && ops[i + run]->flow_del.pmd_id == op->flow_del.pmd_id) {
+                run++;
+            }
+            if (run > 1 && op->flow_del.pmd_id != PMD_ID_NULL) {
+                struct dp_netdev_pmd_thread *pmd
+                    = dp_netdev_get_pmd(get_dp_netdev(dpif),
+                                        op->flow_del.pmd_id);
+
+                if (pmd) {
+                    flow_del_batch_on_pmd(pmd, &ops[i], run);
+                    dp_netdev_pmd_unref(pmd);
+                } else {
+                    for (size_t j = i; j < i + run; j++) {
+                        ops[j]->error = EINVAL;
+                    }
+                }
+                i += run - 1;
+            } else {
+                op->error = dpif_netdev_flow_del(dpif, &op->flow_del);
+            }
             break;
+        }
 
         case DPIF_OP_EXECUTE:
             op->error = dpif_netdev_execute(dpif, &op->execute);
@@ -3912,6 +4677,16 @@ dpif_netdev_set_config(struct dpif *dpif, const struct smap *other_config)
         }
     }
 
+    bool insert_auto = smap_get_bool(other_config, "emc-insert-auto",
+                                     DEFAULT_EM_FLOW_INSERT_AUTO);
+    bool cur_insert_auto;
+    atomic_read_relaxed(&dp->emc_insert_auto, &cur_insert_auto);
+    if (insert_auto != cur_insert_auto) {
+        atomic_store_relaxed(&dp->emc_insert_auto, insert_auto);
+        VLOG_INFO("EMC insertion probability auto-tuning %s",
+                  insert_auto ? "enabled" : "disabled");
+    }
+
     bool perf_enabled = smap_get_bool(other_config, "pmd-perf-metrics", false);
     bool cur_perf_enabled;
     atomic_read_relaxed(&dp->pmd_perf_metrics, &cur_perf_enabled);
@@ -3936,6 +4711,112 @@ dpif_netdev_set_config(struct dpif *dpif, const struct smap *other_config)
         }
     }
 
+    bool gro_enable = smap_get_bool(other_config, "gro-enable", false);
+    bool cur_gro;
+    atomic_read_relaxed(&dp->gro_enable, &cur_gro);
+    if (gro_enable && !userspace_tso_enabled()) {
+        VLOG_WARN_ONCE("Software GRO requires userspace TSO support "
+                       "(userspace-tso-enable), keeping it disabled");
+        gro_enable = false;
+    }
+    if (gro_enable != cur_gro) {
+        atomic_store_relaxed(&dp->gro_enable, gro_enable);
+        if (gro_enable) {
+            VLOG_INFO("Software GRO is enabled");
+        } else {
+            VLOG_INFO("Software GRO is disabled");
+        }
+    }
+
+    bool tnl_responder = smap_get_bool(other_config, "tnl-neigh-responder",
+                                       false);
+    bool cur_tnl_responder;
+    atomic_read_relaxed(&dp->tnl_neigh_responder, &cur_tnl_responder);
+    if (tnl_responder != cur_tnl_responder) {
+        atomic_store_relaxed(&dp->tnl_neigh_responder, tnl_responder);
+        if (tnl_responder) {
+            VLOG_INFO("Tunnel neighbor responder is enabled");
+        } else {
+            VLOG_INFO("Tunnel neighbor responder is disabled");
+        }
+    }
+
+    bool tx_flusher = smap_get_bool(other_config, "pmd-tx-flusher", false);
+    bool cur_tx_flusher;
+    atomic_read_relaxed(&dp->tx_flusher_enabled, &cur_tx_flusher);
+    if (tx_flusher != cur_tx_flusher) {
+        dp_netdev_set_tx_flusher(dp, tx_flusher);
+    }
+
+    bool work_stealing = smap_get_bool(other_config, "pmd-work-stealing",
+                                       false);
+    bool cur_work_stealing;
+    atomic_read_relaxed(&dp->pmd_work_stealing, &cur_work_stealing);
+    if (work_stealing != cur_work_stealing) {
+        atomic_store_relaxed(&dp->pmd_work_stealing, work_stealing);
+        if (work_stealing) {
+            VLOG_INFO("Cross-PMD work stealing is enabled");
+        } else {
+            VLOG_INFO("Cross-PMD work stealing is disabled");
+        }
+    }
+
+    bool distributor = smap_get_bool(other_config, "pmd-distributor", false);
+    bool cur_distributor;
+    atomic_read_relaxed(&dp->pmd_distributor, &cur_distributor);
+    if (distributor != cur_distributor) {
+        atomic_store_relaxed(&dp->pmd_distributor, distributor);
+        if (distributor) {
+            VLOG_INFO("Flow-hash PMD distributor is enabled");
+        } else {
+            VLOG_INFO("Flow-hash PMD distributor is disabled");
+        }
+    }
+
+    uint64_t req_smc_entries = smap_get_ullong(other_config, "smc-entries",
+                                               SMC_DEFAULT_ENTRIES);
+    uint32_t smc_entries, cur_smc_entries;
+
+    req_smc_entries = MAX(req_smc_entries, SMC_MIN_ENTRIES);
+    req_smc_entries = MIN(req_smc_entries, SMC_MAX_ENTRIES);
+    smc_entries = UINT32_C(1) << log_2_ceil(req_smc_entries);
+
+    atomic_read_relaxed(&dp->smc_n_entries, &cur_smc_entries);
+    if (smc_entries != cur_smc_entries) {
+        atomic_store_relaxed(&dp->smc_n_entries, smc_entries);
+        VLOG_INFO("SMC cache size set to %"PRIu32" entries per thread",
+                  smc_entries);
+
+        /* PMD threads notice the change and resize their own cache; the
+         * non-PMD thread's cache is resized here under its mutex. */
+        struct dp_netdev_pmd_thread *non_pmd
+            = dp_netdev_get_pmd(dp, NON_PMD_CORE_ID);
+        if (non_pmd) {
+            ovs_mutex_lock(&dp->non_pmd_mutex);
+            smc_cache_resize(&non_pmd->flow_cache.smc_cache, smc_entries);
+            ovs_mutex_unlock(&dp->non_pmd_mutex);
+            dp_netdev_pmd_unref(non_pmd);
+        }
+    }
+
+    uint64_t max_sleep = smap_get_ullong(other_config, "pmd-max-sleep", 0);
+    uint64_t cur_max_sleep;
+
+    max_sleep = MIN(max_sleep, PMD_SLEEP_MAX_US);
+    atomic_read_relaxed(&dp->pmd_max_sleep, &cur_max_sleep);
+    if (max_sleep != cur_max_sleep) {
+        atomic_store_relaxed(&dp->pmd_max_sleep, max_sleep);
+        if (max_sleep) {
+            VLOG_INFO("PMD idle sleeping enabled, up to %"PRIu64" us "
+                      "between polling rounds", max_sleep);
+        } else {
+            VLOG_INFO("PMD idle sleeping disabled");
+        }
+    }
+
+    dp_netdev_huge_set_mlock(smap_get_bool(other_config, "pmd-mem-mlock",
+                                           false));
+
     bool pmd_rxq_assign_cyc = !strcmp(pmd_rxq_assign, "cycles");
     if (!pmd_rxq_assign_cyc && strcmp(pmd_rxq_assign, "roundrobin")) {
         VLOG_WARN("Unsupported Rxq to PMD assignment mode in pmd-rxq-assign. "
@@ -4138,6 +5019,7 @@ dp_netdev_actions_create(const struct nlattr *actions, size_t size)
     netdev_actions = xmalloc(sizeof *netdev_actions + size);
     memcpy(netdev_actions->actions, actions, size);
     netdev_actions->size = size;
+    netdev_actions->prog = odp_execute_compile(netdev_actions->actions, size);
 
     return netdev_actions;
 }
@@ -4151,6 +5033,7 @@ dp_netdev_flow_get_actions(const struct dp_netdev_flow *flow)
 static void
 dp_netdev_actions_free(struct dp_netdev_actions *actions)
 {
+    odp_execute_prog_destroy(actions->prog);
     free(actions);
 }
 
@@ -4184,7 +5067,17 @@ dp_netdev_rxq_set_intrvl_cycles(struct dp_netdev_rxq *rx,
                                 unsigned long long cycles)
 {
     unsigned int idx = rx->intrvl_idx++ % PMD_RXQ_INTERVAL_MAX;
+    unsigned long long ewma;
+
     atomic_store_relaxed(&rx->cycles_intrvl[idx], cycles);
+
+    /* Fold the completed interval into a moving average that weights it at
+     * one quarter.  This keeps a per-queue load figure up to date
+     * incrementally, so that rebalancing decisions do not have to walk and
+     * sum the interval history of every queue. */
+    atomic_read_relaxed(&rx->cycles[RXQ_CYCLES_PROC_EWMA], &ewma);
+    ewma = ewma ? (3 * ewma + cycles) / 4 : cycles;
+    atomic_store_relaxed(&rx->cycles[RXQ_CYCLES_PROC_EWMA], ewma);
 }
 
 static uint64_t
@@ -4228,17 +5121,45 @@ dp_netdev_pmd_flush_output_on_port(struct dp_netdev_pmd_thread *pmd,
 
     cycle_timer_start(&pmd->perf_stats, &timer);
 
+    output_cnt = dp_packet_batch_size(&p->output_pkts);
+    ovs_assert(output_cnt > 0);
+
+    if (pmd_perf_metrics_enabled(pmd)) {
+        struct pmd_perf_stats *s = &pmd->perf_stats;
+        struct dp_packet_batch *batch = &p->output_pkts;
+        uint64_t now = s->last_tsc;
+        struct dp_packet *packet;
+
+        /* Sample the rx-to-tx residency of each stamped packet before the
+         * batch is handed to the netdev, which may free the packets. */
+        DP_PACKET_BATCH_FOR_EACH (j, packet, batch) {
+            if (packet->rx_cycles && now > packet->rx_cycles) {
+                histogram_add_sample(&s->pkt_residency,
+                                     MIN(now - packet->rx_cycles,
+                                         UINT32_MAX));
+            }
+        }
+    }
+
     dynamic_txqs = p->port->dynamic_txqs;
     if (dynamic_txqs) {
+        bool tx_flusher;
+
+        /* With the tx flusher enabled, hand the burst off instead of
+         * contending on the XPS queue lock with other threads.  A full
+         * ring falls back to the locked send below. */
+        atomic_read_relaxed(&pmd->dp->tx_flusher_enabled, &tx_flusher);
+        if (tx_flusher && p->port->tx_ring
+            && dp_tx_ring_push(p->port->tx_ring, &p->output_pkts)) {
+            goto sent;
+        }
         tx_qid = dpif_netdev_xps_get_tx_qid(pmd, p);
     } else {
         tx_qid = pmd->static_tx_qid;
     }
 
-    output_cnt = dp_packet_batch_size(&p->output_pkts);
-    ovs_assert(output_cnt > 0);
-
     netdev_send(p->port->netdev, tx_qid, &p->output_pkts, dynamic_txqs);
+sent:
     dp_packet_batch_init(&p->output_pkts);
 
     /* Update time of the next flush. */
@@ -4284,6 +5205,417 @@ dp_netdev_pmd_flush_output_packets(struct dp_netdev_pmd_thread *pmd,
     return output_cnt;
 }
 
+/* Publishes 'batch' on 'ring' for an idle PMD to take over.  Returns false
+ * if the ring is full; the caller then processes the batch itself. */
+static inline bool
+pmd_steal_ring_push(struct pmd_steal_ring *ring,
+                    const struct dp_packet_batch *batch, odp_port_t port_no)
+{
+    struct pmd_steal_slot *slot;
+    uint32_t head, tail;
+
+    atomic_read_explicit(&ring->head, &head, memory_order_acquire);
+    atomic_read_relaxed(&ring->tail, &tail);
+    if (tail - head >= PMD_STEAL_RING_SIZE) {
+        return false;
+    }
+
+    slot = &ring->slots[tail & PMD_STEAL_RING_MASK];
+    slot->batch = *batch;
+    slot->port_no = port_no;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+
+    return true;
+}
+
+/* Takes one burst from 'ring' into 'slot'.  Safe to call from any PMD
+ * concurrently with the owner and with other consumers. */
+static inline bool
+pmd_steal_ring_pop(struct pmd_steal_ring *ring, struct pmd_steal_slot *slot)
+{
+    uint32_t head, tail;
+
+    atomic_read_relaxed(&ring->head, &head);
+    for (;;) {
+        atomic_read_explicit(&ring->tail, &tail, memory_order_acquire);
+        if (head == tail) {
+            return false;
+        }
+        /* Copy the slot out before claiming it: the producer will not
+         * reuse it until 'head' moves past it, and the CAS below orders
+         * the copy before the claim.  On CAS failure another consumer won
+         * the slot and 'head' has been refreshed, so retry. */
+        *slot = ring->slots[head & PMD_STEAL_RING_MASK];
+        if (atomic_compare_exchange_strong(&ring->head, &head, head + 1)) {
+            return true;
+        }
+    }
+}
+
+/* Frees any bursts still sitting in this PMD's steal ring.  Called by the
+ * owning thread when it stops polling. */
+static void
+pmd_steal_ring_drain(struct pmd_steal_ring *ring)
+{
+    struct pmd_steal_slot slot;
+
+    while (pmd_steal_ring_pop(ring, &slot)) {
+        struct dp_packet_batch *batch = &slot.batch;
+        struct dp_packet *packet;
+
+        DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+            dp_packet_delete(packet);
+        }
+    }
+}
+
+/* Decides whether the freshly received 'batch' should be handed to an idle
+ * PMD instead of being processed here.  Only queues that have delivered
+ * PMD_STEAL_BURST_THRESHOLD full bursts in a row offload, so lightly
+ * loaded queues keep their packets (and their ordering) local. */
+static inline bool
+pmd_steal_offload(struct dp_netdev_pmd_thread *pmd, struct dp_netdev_rxq *rxq,
+                  struct dp_packet_batch *batch, odp_port_t port_no)
+{
+    bool stealing, distributing;
+
+    atomic_read_relaxed(&pmd->dp->pmd_work_stealing, &stealing);
+    if (OVS_LIKELY(!stealing) || pmd->core_id == NON_PMD_CORE_ID) {
+        return false;
+    }
+
+    /* The distributor owns the burst-streak trigger while it is enabled. */
+    atomic_read_relaxed(&pmd->dp->pmd_distributor, &distributing);
+    if (OVS_UNLIKELY(distributing)) {
+        return false;
+    }
+
+    if (dp_packet_batch_size(batch) < NETDEV_MAX_BURST) {
+        rxq->full_burst_streak = 0;
+        return false;
+    }
+    if (rxq->full_burst_streak < PMD_STEAL_BURST_THRESHOLD) {
+        rxq->full_burst_streak++;
+        return false;
+    }
+
+    return pmd_steal_ring_push(&pmd->steal_ring, batch, port_no);
+}
+
+/* Processes one burst offered up by another PMD, if there is one.
+ * Returns the number of packets processed. */
+static int
+pmd_steal_work(struct dp_netdev_pmd_thread *pmd)
+{
+    struct dp_netdev_pmd_thread *other;
+    struct pmd_steal_slot slot;
+    bool stealing;
+
+    atomic_read_relaxed(&pmd->dp->pmd_work_stealing, &stealing);
+    if (OVS_LIKELY(!stealing)) {
+        return 0;
+    }
+
+    CMAP_FOR_EACH (other, node, &pmd->dp->poll_threads) {
+        if (other == pmd || other->core_id == NON_PMD_CORE_ID) {
+            continue;
+        }
+        if (pmd_steal_ring_pop(&other->steal_ring, &slot)) {
+            int batch_cnt = dp_packet_batch_size(&slot.batch);
+
+            *recirc_depth_get() = 0;
+            pmd_thread_ctx_time_update(pmd);
+            dp_netdev_input(pmd, &slot.batch, slot.port_no);
+            dp_netdev_pmd_flush_output_packets(pmd, false);
+
+            return batch_cnt;
+        }
+    }
+
+    return 0;
+}
+
+/* Spreads the freshly received 'batch' over this PMD's distributor rings
+ * by flow hash, compacting the class 0 remainder (and anything without a
+ * valid RSS hash) to the front of 'batch' for local processing.  Returns
+ * the number of packets handed off.  Uses the same sustained-pressure
+ * trigger as work stealing, so lightly loaded queues keep their packets
+ * local. */
+static inline int
+pmd_dist_offload(struct dp_netdev_pmd_thread *pmd, struct dp_netdev_rxq *rxq,
+                 struct dp_packet_batch *batch, odp_port_t port_no)
+{
+    struct dp_packet_batch classes[PMD_DIST_CLASSES];
+    struct dp_packet *packet;
+    bool distributing;
+    size_t n_local = 0;
+    int handed_off = 0;
+    int c;
+
+    atomic_read_relaxed(&pmd->dp->pmd_distributor, &distributing);
+    if (OVS_LIKELY(!distributing) || pmd->core_id == NON_PMD_CORE_ID) {
+        return 0;
+    }
+
+    if (dp_packet_batch_size(batch) < NETDEV_MAX_BURST) {
+        rxq->full_burst_streak = 0;
+        return 0;
+    }
+    if (rxq->full_burst_streak < PMD_STEAL_BURST_THRESHOLD) {
+        rxq->full_burst_streak++;
+        return 0;
+    }
+
+    for (c = 1; c < PMD_DIST_CLASSES; c++) {
+        dp_packet_batch_init(&classes[c]);
+    }
+    DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+        c = dp_packet_rss_valid(packet)
+            ? dp_packet_get_rss_hash(packet) & (PMD_DIST_CLASSES - 1)
+            : 0;
+        if (c) {
+            dp_packet_batch_add(&classes[c], packet);
+        } else {
+            batch->packets[n_local++] = packet;
+        }
+    }
+    for (c = 1; c < PMD_DIST_CLASSES; c++) {
+        struct dp_packet_batch *cb = &classes[c];
+
+        if (dp_packet_batch_is_empty(cb)) {
+            continue;
+        }
+        if (pmd_steal_ring_push(&pmd->dist_rings[c].ring, cb, port_no)) {
+            handed_off += dp_packet_batch_size(cb);
+        } else {
+            /* Ring full: keep the class local.  This can reorder the class
+             * against bursts already queued on its ring, but only under
+             * backpressure deeper than the ring itself. */
+            struct dp_packet *p;
+
+            DP_PACKET_BATCH_FOR_EACH (j, p, cb) {
+                batch->packets[n_local++] = p;
+            }
+        }
+    }
+    batch->count = n_local;
+
+    return handed_off;
+}
+
+/* Drains one distributor class published by another PMD, if there is one.
+ * The class is claimed for the whole drain so its bursts stay in order.
+ * Returns the number of packets processed. */
+static int
+pmd_dist_work(struct dp_netdev_pmd_thread *pmd)
+{
+    struct dp_netdev_pmd_thread *other;
+    bool distributing;
+    int processed = 0;
+
+    atomic_read_relaxed(&pmd->dp->pmd_distributor, &distributing);
+    if (OVS_LIKELY(!distributing)) {
+        return 0;
+    }
+
+    CMAP_FOR_EACH (other, node, &pmd->dp->poll_threads) {
+        int c;
+
+        if (other == pmd || other->core_id == NON_PMD_CORE_ID) {
+            continue;
+        }
+        for (c = 1; c < PMD_DIST_CLASSES; c++) {
+            struct pmd_dist_ring *dr = &other->dist_rings[c];
+            struct pmd_steal_slot slot;
+            void *expected = NULL;
+
+            if (!atomic_compare_exchange_strong(&dr->consumer, &expected,
+                                                pmd)) {
+                continue;
+            }
+            while (pmd_steal_ring_pop(&dr->ring, &slot)) {
+                *recirc_depth_get() = 0;
+                pmd_thread_ctx_time_update(pmd);
+                processed += dp_packet_batch_size(&slot.batch);
+                dp_netdev_input(pmd, &slot.batch, slot.port_no);
+                dp_netdev_pmd_flush_output_packets(pmd, false);
+            }
+            atomic_store_explicit(&dr->consumer, NULL, memory_order_release);
+            if (processed) {
+                return processed;
+            }
+        }
+    }
+
+    return processed;
+}
+
+/* Software GRO (see other_config:gro-enable).
+ *
+ * Coalesces in-order TCP/IPv4 segments of the same connection within a
+ * received batch into one oversized packet before the batch enters the
+ * pipeline, so classification and action execution run once per burst of
+ * a stream instead of once per MTU-sized segment.  Merged packets are
+ * flagged for TSO and TCP checksum offload; the egress paths already
+ * handle such packets when userspace TSO is enabled, which is the only
+ * configuration in which this stage runs.
+ *
+ * The merge rules mirror the kernel's GRO: segments must agree on
+ * everything (addresses, ports, ack, window, ToS, TTL and the raw TCP
+ * option bytes) except the sequence number, which must be exactly
+ * adjacent, and PSH on a trailing segment carries over to the head. */
+
+struct gro_head {
+    struct dp_packet *pkt;
+    struct ip_header *nh;
+    struct tcp_header *th;
+    uint32_t next_seq;      /* Host order; expected from the next segment. */
+    uint16_t tcp_hdr_len;
+};
+
+/* Fills '*gh' from 'pkt' and returns true if 'pkt' is a TCP/IPv4 data
+ * segment that GRO can work with, false otherwise. */
+static bool
+gro_parse(struct dp_packet *pkt, struct gro_head *gh)
+{
+    struct eth_header *eth = dp_packet_data(pkt);
+    size_t size = dp_packet_size(pkt);
+    struct ip_header *nh;
+    struct tcp_header *th;
+    uint16_t tcp_hdr_len;
+    uint16_t tot_len;
+    uint16_t payload;
+    uint16_t flags;
+
+    if (size < ETH_HEADER_LEN + IP_HEADER_LEN + TCP_HEADER_LEN
+        || eth->eth_type != htons(ETH_TYPE_IP)) {
+        return false;
+    }
+
+    nh = (struct ip_header *) (eth + 1);
+    if (nh->ip_ihl_ver != IP_IHL_VER(5, 4)
+        || nh->ip_proto != IPPROTO_TCP
+        || IP_IS_FRAGMENT(nh->ip_frag_off)) {
+        return false;
+    }
+
+    tot_len = ntohs(nh->ip_tot_len);
+    if (tot_len != size - ETH_HEADER_LEN) {
+        /* Undersized or padded frame: leave it alone. */
+        return false;
+    }
+
+    th = (struct tcp_header *) (nh + 1);
+    tcp_hdr_len = TCP_OFFSET(th->tcp_ctl) * 4;
+    if (tcp_hdr_len < TCP_HEADER_LEN
+        || tot_len < IP_HEADER_LEN + tcp_hdr_len) {
+        return false;
+    }
+
+    flags = TCP_FLAGS(th->tcp_ctl);
+    payload = tot_len - IP_HEADER_LEN - tcp_hdr_len;
+    if (!payload || !(flags & TCP_ACK) || flags & ~(TCP_ACK | TCP_PSH)) {
+        return false;
+    }
+
+    gh->pkt = pkt;
+    gh->nh = nh;
+    gh->th = th;
+    gh->tcp_hdr_len = tcp_hdr_len;
+    gh->next_seq = ntohl(get_16aligned_be32(&th->tcp_seq)) + payload;
+    return true;
+}
+
+/* Appends the payload of the segment described by 'gh' to a matching head
+ * among 'heads', if any.  Returns true if it was merged, in which case the
+ * caller owns (and should free) the now redundant 'gh->pkt'. */
+static bool
+gro_try_merge(struct gro_head *heads, int n_heads, const struct gro_head *gh)
+{
+    const struct tcp_header *th = gh->th;
+    uint32_t seq = ntohl(get_16aligned_be32(&th->tcp_seq));
+    uint16_t payload = gh->next_seq - seq;
+    int i;
+
+    for (i = 0; i < n_heads; i++) {
+        struct gro_head *h = &heads[i];
+        ovs_be16 old_tot_len;
+
+        if (h->tcp_hdr_len != gh->tcp_hdr_len
+            || h->th->tcp_src != th->tcp_src
+            || h->th->tcp_dst != th->tcp_dst
+            || get_16aligned_be32(&h->nh->ip_src)
+               != get_16aligned_be32(&gh->nh->ip_src)
+            || get_16aligned_be32(&h->nh->ip_dst)
+               != get_16aligned_be32(&gh->nh->ip_dst)) {
+            continue;
+        }
+
+        if (seq != h->next_seq
+            || get_16aligned_be32(&h->th->tcp_ack)
+               != get_16aligned_be32(&th->tcp_ack)
+            || h->th->tcp_winsz != th->tcp_winsz
+            || h->nh->ip_tos != gh->nh->ip_tos
+            || h->nh->ip_ttl != gh->nh->ip_ttl
+            || memcmp(h->th + 1, th + 1, gh->tcp_hdr_len - TCP_HEADER_LEN)
+            || ntohs(h->nh->ip_tot_len) + payload > UINT16_MAX) {
+            /* Same connection but not mergeable: stop so that segments
+             * are never reordered within the stream. */
+            return false;
+        }
+
+        dp_packet_put(h->pkt, (const char *) th + gh->tcp_hdr_len, payload);
+
+        /* The put may have reallocated the head's buffer. */
+        h->nh = (struct ip_header *)
+            ((struct eth_header *) dp_packet_data(h->pkt) + 1);
+        h->th = (struct tcp_header *) (h->nh + 1);
+
+        old_tot_len = h->nh->ip_tot_len;
+        h->nh->ip_tot_len = htons(ntohs(old_tot_len) + payload);
+        h->nh->ip_csum = recalc_csum16(h->nh->ip_csum, old_tot_len,
+                                       h->nh->ip_tot_len);
+        h->th->tcp_ctl |= th->tcp_ctl & htons(TCP_PSH);
+        h->next_seq += payload;
+
+        if (!dp_packet_hwol_is_tso(h->pkt)) {
+            dp_packet_hwol_set_tx_ipv4(h->pkt);
+            dp_packet_hwol_set_csum_tcp(h->pkt);
+            dp_packet_hwol_set_tcp_seg(h->pkt);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+static void
+dp_netdev_gro(struct dp_packet_batch *batch)
+{
+    struct gro_head heads[NETDEV_MAX_BURST];
+    const size_t cnt = dp_packet_batch_size(batch);
+    struct dp_packet *packet;
+    int n_heads = 0;
+    size_t i;
+
+    DP_PACKET_BATCH_REFILL_FOR_EACH (i, cnt, packet, batch) {
+        struct gro_head gh;
+
+        if (gro_parse(packet, &gh)) {
+            if (gro_try_merge(heads, n_heads, &gh)) {
+                dp_packet_delete(packet);
+                continue;
+            }
+            if (packet->source == DPBUF_MALLOC) {
+                /* Only malloc-backed packets can grow in place, so only
+                 * they may serve as coalescing heads. */
+                heads[n_heads++] = gh;
+            }
+        }
+        dp_packet_batch_refill(batch, packet, i);
+    }
+}
+
 static int
 dp_netdev_process_rxq_port(struct dp_netdev_pmd_thread *pmd,
                            struct dp_netdev_rxq *rxq,
@@ -4315,9 +5647,17 @@ dp_netdev_process_rxq_port(struct dp_netdev_pmd_thread *pmd,
         pmd_thread_ctx_time_update(pmd);
         batch_cnt = dp_packet_batch_size(&batch);
         if (pmd_perf_metrics_enabled(pmd)) {
+            struct dp_packet_batch *b = &batch;
+            struct dp_packet *packet;
+
             /* Update batch histogram. */
             s->current.batches++;
             histogram_add_sample(&s->pkts_per_batch, batch_cnt);
+            /* Stamp the rx time for the residency histogram, using the
+             * TSC value taken when the cycle timer was started above. */
+            DP_PACKET_BATCH_FOR_EACH (i, packet, b) {
+                packet->rx_cycles = s->last_tsc;
+            }
             /* Update the maximum vhost rx queue fill level. */
             if (rxq->is_vhost && rem_qlen >= 0) {
                 uint32_t qfill = batch_cnt + rem_qlen;
@@ -4326,13 +5666,39 @@ dp_netdev_process_rxq_port(struct dp_netdev_pmd_thread *pmd,
                 }
             }
         }
-        /* Process packet batch. */
-        dp_netdev_input(pmd, &batch, port_no);
+        bool gro_enable;
 
-        /* Assign processing cycles to rx queue. */
-        cycles = cycle_timer_stop(&pmd->perf_stats, &timer);
-        dp_netdev_rxq_add_cycles(rxq, RXQ_CYCLES_PROC_CURR, cycles);
-        dp_netdev_pmd_flush_output_packets(pmd, false);
+        atomic_read_relaxed(&pmd->dp->gro_enable, &gro_enable);
+        if (gro_enable && batch_cnt > 1) {
+            dp_netdev_gro(&batch);
+        }
+
+        /* Spread a pressured queue's burst over the distributor rings by
+         * flow hash; the local remainder (if any) is processed below. */
+        pmd_dist_offload(pmd, rxq, &batch, port_no);
+
+        if (OVS_UNLIKELY(dp_packet_batch_is_empty(&batch))) {
+            /* Whole burst handed to worker PMDs. */
+            cycles = cycle_timer_stop(&pmd->perf_stats, &timer);
+            dp_netdev_rxq_add_cycles(rxq, RXQ_CYCLES_PROC_CURR, cycles);
+        } else if (OVS_UNLIKELY(pmd_steal_offload(pmd, rxq, &batch,
+                                                  port_no))) {
+            /* Burst handed to an idle PMD through the steal ring. */
+            cycles = cycle_timer_stop(&pmd->perf_stats, &timer);
+            dp_netdev_rxq_add_cycles(rxq, RXQ_CYCLES_PROC_CURR, cycles);
+        } else {
+            /* Process packet batch. */
+            dp_netdev_input(pmd, &batch, port_no);
+
+            /* Assign processing cycles to rx queue. */
+            cycles = cycle_timer_stop(&pmd->perf_stats, &timer);
+            dp_netdev_rxq_add_cycles(rxq, RXQ_CYCLES_PROC_CURR, cycles);
+            if (pmd_perf_metrics_enabled(pmd)) {
+                histogram_add_sample(&s->cycles_per_batch,
+                                     MIN(cycles, UINT32_MAX));
+            }
+            dp_netdev_pmd_flush_output_packets(pmd, false);
+        }
     } else {
         /* Discard cycles. */
         cycle_timer_stop(&pmd->perf_stats, &timer);
@@ -4591,6 +5957,31 @@ compare_rxq_cycles(const void *a, const void *b)
     }
 }
 
+/* Partially sorts the 'n' queues in 'rxqs' so that the 'k' heaviest ones,
+ * in compare_rxq_cycles() order, occupy the first 'k' slots.  Past the first
+ * couple of rounds of round-robin assignment the ordering of the remaining,
+ * lighter queues barely affects the resulting balance, so sorting them all
+ * is wasted work. */
+static void
+sort_heaviest_rxqs(struct dp_netdev_rxq **rxqs, int n, int k)
+{
+    for (int i = 0; i < k && i < n - 1; i++) {
+        int heaviest = i;
+
+        for (int j = i + 1; j < n; j++) {
+            if (compare_rxq_cycles(&rxqs[j], &rxqs[heaviest]) < 0) {
+                heaviest = j;
+            }
+        }
+        if (heaviest != i) {
+            struct dp_netdev_rxq *tmp = rxqs[i];
+
+            rxqs[i] = rxqs[heaviest];
+            rxqs[heaviest] = tmp;
+        }
+    }
+}
+
 /* Assign pmds to queues.  If 'pinned' is true, assign pmds to pinned
  * queues and marks the pmds as isolated.  Otherwise, assign non isolated
  * pmds to unpinned queues.
@@ -4689,6 +6080,12 @@ rxq_scheduling(struct dp_netdev *dp, bool pinned) OVS_REQUIRES(dp->port_mutex)
                       numa_id, netdev_rxq_get_queue_id(rxqs[i]->rx),
                       netdev_rxq_get_name(rxqs[i]->rx),
                       rxqs[i]->pmd->core_id, rxqs[i]->pmd->numa_id);
+            /* Every thread polling this port is on a remote node, so ask
+             * the netdev to move its packet buffers to the consuming node:
+             * better that only the NIC's DMA crosses the interconnect than
+             * every read the pmd makes. */
+            netdev_dpdk_set_preferred_numa_id(rxqs[i]->port->netdev,
+                                              rxqs[i]->pmd->numa_id);
         } else {
             rxqs[i]->pmd = rr_numa_get_pmd(numa, assign_cyc);
             if (assign_cyc) {
@@ -4807,7 +6204,7 @@ reconfigure_pmd_threads(struct dp_netdev *dp)
         if (!pmd) {
             struct ds name = DS_EMPTY_INITIALIZER;
 
-            pmd = xzalloc(sizeof *pmd);
+            pmd = dp_netdev_huge_alloc(sizeof *pmd);
             dp_netdev_configure_pmd(pmd, dp, core->core_id, core->numa_id);
 
             ds_put_format(&name, "pmd-c%02d/id:", core->core_id);
@@ -5129,7 +6526,6 @@ get_dry_run_variance(struct dp_netdev *dp, uint32_t *core_list,
 
         for (int qid = 0; qid < port->n_rxq; qid++) {
             struct dp_netdev_rxq *q = &port->rxqs[qid];
-            uint64_t cycle_hist = 0;
 
             if (q->pmd->isolated) {
                 continue;
@@ -5141,20 +6537,21 @@ get_dry_run_variance(struct dp_netdev *dp, uint32_t *core_list,
                 rxqs = xrealloc(rxqs, sizeof *rxqs * (n_rxqs + 1));
             }
 
-            /* Sum the queue intervals and store the cycle history. */
-            for (unsigned i = 0; i < PMD_RXQ_INTERVAL_MAX; i++) {
-                cycle_hist += dp_netdev_rxq_get_intrvl_cycles(q, i);
-            }
+            /* Estimate the cycle history from the incrementally maintained
+             * per-queue load average instead of summing all intervals. */
             dp_netdev_rxq_set_cycles(q, RXQ_CYCLES_PROC_HIST,
-                                         cycle_hist);
+                                     dp_netdev_rxq_get_cycles(
+                                         q, RXQ_CYCLES_PROC_EWMA)
+                                     * PMD_RXQ_INTERVAL_MAX);
             /* Store the queue. */
             rxqs[n_rxqs++] = q;
         }
     }
     if (n_rxqs > 1) {
-        /* Sort the queues in order of the processing cycles
-         * they consumed during their last pmd interval. */
-        qsort(rxqs, n_rxqs, sizeof *rxqs, compare_rxq_cycles);
+        /* Order the heaviest queues first.  The dry run only needs enough
+         * ordering for the round-robin assignment below, so a partial
+         * selection is cheaper than a full sort at high queue counts. */
+        sort_heaviest_rxqs(rxqs, n_rxqs, num_pmds * 2);
     }
     rr_numa_list_populate(dp, &rr);
 
@@ -5259,9 +6656,9 @@ pmd_rebalance_dry_run(struct dp_netdev *dp)
 
         ovs_mutex_lock(&pmd->port_mutex);
         HMAP_FOR_EACH (poll, node, &pmd->poll_list) {
-            for (unsigned i = 0; i < PMD_RXQ_INTERVAL_MAX; i++) {
-                total_proc += dp_netdev_rxq_get_intrvl_cycles(poll->rxq, i);
-            }
+            total_proc += dp_netdev_rxq_get_cycles(poll->rxq,
+                                                   RXQ_CYCLES_PROC_EWMA)
+                          * PMD_RXQ_INTERVAL_MAX;
         }
         ovs_mutex_unlock(&pmd->port_mutex);
 
@@ -5535,6 +6932,11 @@ pmd_thread_main(void *f_)
     bool reload_tx_qid;
     bool exiting;
     bool reload;
+    bool insert_auto;
+    uint32_t smc_entries;
+    uint64_t idle_streak = 0;
+    uint64_t sleep_us = 0;
+    uint64_t max_sleep;
     int poll_cnt;
     int i;
     int process_packets = 0;
@@ -5546,7 +6948,8 @@ pmd_thread_main(void *f_)
     ovs_numa_thread_setaffinity_core(pmd->core_id);
     dpdk_set_lcore_id(pmd->core_id);
     poll_cnt = pmd_load_queues_and_ports(pmd, &poll_list);
-    dfc_cache_init(&pmd->flow_cache);
+    atomic_read_relaxed(&pmd->dp->smc_n_entries, &smc_entries);
+    dfc_cache_init(&pmd->flow_cache, smc_entries);
     pmd_alloc_static_tx_qid(pmd);
 
 reload:
@@ -5596,8 +6999,13 @@ reload:
             }
 
             if (poll_list[i].emc_enabled) {
-                atomic_read_relaxed(&pmd->dp->emc_insert_min,
-                                    &pmd->ctx.emc_insert_min);
+                atomic_read_relaxed(&pmd->dp->emc_insert_auto, &insert_auto);
+                if (insert_auto) {
+                    pmd->ctx.emc_insert_min = pmd->emc_tuner.min;
+                } else {
+                    atomic_read_relaxed(&pmd->dp->emc_insert_min,
+                                        &pmd->ctx.emc_insert_min);
+                }
             } else {
                 pmd->ctx.emc_insert_min = 0;
             }
@@ -5610,8 +7018,16 @@ reload:
         }
 
         if (!rx_packets) {
-            /* We didn't receive anything in the process loop.
-             * Check if we need to send something.
+            /* We didn't receive anything in the process loop.  See if an
+             * overloaded PMD has a burst to take over. */
+            rx_packets = pmd_dist_work(pmd);
+            if (!rx_packets) {
+                rx_packets = pmd_steal_work(pmd);
+            }
+        }
+
+        if (!rx_packets) {
+            /* Check if we need to send something.
              * There was no time updates on current iteration. */
             pmd_thread_ctx_time_update(pmd);
             tx_packets = dp_netdev_pmd_flush_output_packets(pmd, false);
@@ -5630,6 +7046,36 @@ reload:
         if (lc++ > 1024) {
             lc = 0;
 
+            /* Resize the signature match cache if its configured size
+             * changed.  The cache belongs to this thread, so this is the
+             * only safe place to reallocate it. */
+            atomic_read_relaxed(&pmd->dp->smc_n_entries, &smc_entries);
+            if (OVS_UNLIKELY(smc_entries
+                             != smc_cache_n_entries(
+                                    &pmd->flow_cache.smc_cache))) {
+                smc_cache_resize(&pmd->flow_cache.smc_cache, smc_entries);
+            }
+
+            /* Push locally accumulated flow stats to the shared per-flow
+             * counters, so flow dumps and expiry see fresh numbers. */
+            dp_netdev_pmd_fold_flow_stats(pmd);
+
+            /* Walk the EMC insertion threshold towards the hit-rate
+             * optimum for the current traffic mix. */
+            atomic_read_relaxed(&pmd->dp->emc_insert_auto, &insert_auto);
+            if (insert_auto) {
+                pmd_emc_insert_autotune(pmd);
+            }
+
+            /* Mirror the PMD counters into the shared-memory statistics
+             * segment, if a telemetry agent asked for one. */
+            if (stats_shm_is_enabled()) {
+                uint64_t shm_stats[PMD_N_STATS];
+
+                pmd_perf_read_counters(&pmd->perf_stats, shm_stats);
+                stats_shm_publish_pmd(pmd->core_id, shm_stats, PMD_N_STATS);
+            }
+
             coverage_try_clear();
             dp_netdev_pmd_try_optimize(pmd, poll_list, poll_cnt);
             if (!ovsrcu_try_quiesce()) {
@@ -5656,6 +7102,25 @@ reload:
 
         pmd_perf_end_iteration(s, rx_packets, tx_packets,
                                pmd_perf_metrics_enabled(pmd));
+
+        /* Adaptive idle backoff.  After PMD_SLEEP_AFTER_ITER consecutive
+         * empty polling rounds, start sleeping between rounds, doubling
+         * from 1 us up to the configured bound so the core can drop into a
+         * low-power state.  Any traffic snaps straight back to full-rate
+         * polling; the first burst after a sleep pays at most one sleep
+         * period of added latency. */
+        atomic_read_relaxed(&pmd->dp->pmd_max_sleep, &max_sleep);
+        if (OVS_UNLIKELY(max_sleep)) {
+            if (rx_packets || tx_packets) {
+                idle_streak = 0;
+                sleep_us = 0;
+            } else if (idle_streak < PMD_SLEEP_AFTER_ITER) {
+                idle_streak++;
+            } else {
+                sleep_us = sleep_us ? MIN(sleep_us * 2, max_sleep) : 1;
+                xnanosleep(sleep_us * 1000);
+            }
+        }
     }
     ovs_mutex_unlock(&pmd->perf_stats.stats_mutex);
 
@@ -5677,6 +7142,12 @@ reload:
     }
 
     pmd_free_static_tx_qid(pmd);
+    pmd_steal_ring_drain(&pmd->steal_ring);
+    for (i = 0; i < PMD_DIST_CLASSES; i++) {
+        pmd_steal_ring_drain(&pmd->dist_rings[i].ring);
+    }
+    dp_netdev_pmd_fold_flow_stats(pmd);
+    stats_shm_retire_pmd(pmd->core_id);
     dfc_cache_uninit(&pmd->flow_cache);
     free(poll_list);
     pmd_free_cached_ports(pmd);
@@ -5687,28 +7158,88 @@ static void
 dp_netdev_disable_upcall(struct dp_netdev *dp)
     OVS_ACQUIRES(dp->upcall_rwlock)
 {
-    fat_rwlock_wrlock(&dp->upcall_rwlock);
+    fat_rwlock_wrlock(&dp->upcall_rwlock);
+}
+
+
+/* Meters */
+static void
+dpif_netdev_meter_get_features(const struct dpif * dpif OVS_UNUSED,
+                               struct ofputil_meter_features *features)
+{
+    features->max_meters = MAX_METERS;
+    features->band_types = DP_SUPPORTED_METER_BAND_TYPES;
+    features->capabilities = DP_SUPPORTED_METER_FLAGS_MASK;
+    features->max_bands = MAX_BANDS;
+    features->max_color = 0;
+}
+
+/* How long a per-PMD meter shard may go without reconciling with the
+ * shared meter, in microseconds.  Bounds the lag of meter statistics and
+ * how long a deleted or reconfigured meter can go unnoticed. */
+#define METER_SHARD_SYNC_INTERVAL 100000LL
+
+/* Per-PMD shard of a meter's token buckets.
+ *
+ * Instead of charging every batch to the shared meter under its lock, each
+ * PMD borrows a chunk of tokens from every band into a private shard and
+ * admits whole batches against the shard locklessly: one clock comparison
+ * and one cost subtraction per band.  The shard is reconciled with the
+ * shared meter - unused tokens returned, local statistics flushed, a fresh
+ * chunk borrowed - whenever a band runs dry or the sync deadline passes.
+ * Exact per-packet band accounting still happens under the meter lock, so
+ * drops are decided against the full shared state.  The cost is that the
+ * instantaneous burst a meter can admit is relaxed by up to the chunks
+ * outstanding in other PMDs' shards. */
+struct dp_meter_shard {
+    struct hmap_node node;        /* In dp_netdev_pmd_thread 'meter_shards'. */
+    uint32_t meter_id;
+    uint16_t flags;               /* Copy of the meter's OFPMF13_* flags. */
+    uint16_t n_bands;
+    uint64_t version;             /* Detects meter replacement. */
+    long long int next_sync;      /* Next forced reconciliation, in usec. */
+    uint64_t packet_count;        /* Admitted locally since the last sync. */
+    uint64_t byte_count;
+    uint32_t buckets[MAX_BANDS];  /* Borrowed tokens, in band units. */
+};
+
+static struct dp_meter_shard *
+dp_meter_shard_lookup(struct dp_netdev_pmd_thread *pmd, uint32_t meter_id)
+{
+    struct dp_meter_shard *shard;
+
+    HMAP_FOR_EACH_WITH_HASH (shard, node, hash_int(meter_id, 0),
+                             &pmd->meter_shards) {
+        if (shard->meter_id == meter_id) {
+            return shard;
+        }
+    }
+    return NULL;
 }
 
-
-/* Meters */
+/* (Re)binds 'shard' to 'meter', discarding any tokens and statistics from
+ * a previous incarnation of the meter, which may use different units. */
 static void
-dpif_netdev_meter_get_features(const struct dpif * dpif OVS_UNUSED,
-                               struct ofputil_meter_features *features)
+dp_meter_shard_bind(struct dp_meter_shard *shard, const struct dp_meter *meter)
 {
-    features->max_meters = MAX_METERS;
-    features->band_types = DP_SUPPORTED_METER_BAND_TYPES;
-    features->capabilities = DP_SUPPORTED_METER_FLAGS_MASK;
-    features->max_bands = MAX_BANDS;
-    features->max_color = 0;
+    shard->version = meter->version;
+    shard->flags = meter->flags;
+    shard->n_bands = meter->n_bands;
+    shard->packet_count = 0;
+    shard->byte_count = 0;
+    memset(shard->buckets, 0, sizeof shard->buckets);
 }
 
-/* Applies the meter identified by 'meter_id' to 'packets_'.  Packets
- * that exceed a band are dropped in-place. */
+/* Applies the meter identified by 'meter_id' to 'packets_' against the
+ * shared meter state, reconciling 'pmd''s shard (if any) with it under the
+ * meter lock.  Packets that exceed a band are dropped in-place. */
 static void
-dp_netdev_run_meter(struct dp_netdev *dp, struct dp_packet_batch *packets_,
-                    uint32_t meter_id, long long int now)
+dp_netdev_run_meter__(struct dp_netdev_pmd_thread *pmd,
+                      struct dp_meter_shard *shard,
+                      struct dp_packet_batch *packets_,
+                      uint32_t meter_id, long long int now)
 {
+    struct dp_netdev *dp = pmd->dp;
     struct dp_meter *meter;
     struct dp_meter_band *band;
     struct dp_packet *packet;
@@ -5720,16 +7251,37 @@ dp_netdev_run_meter(struct dp_netdev *dp, struct dp_packet_batch *packets_,
     uint32_t exceeded_rate[NETDEV_MAX_BURST];
     int exceeded_pkt = cnt; /* First packet that exceeded a band rate. */
 
-    if (meter_id >= MAX_METERS) {
-        return;
-    }
-
     meter_lock(dp, meter_id);
     meter = dp->meters[meter_id];
     if (!meter) {
+        if (shard) {
+            hmap_remove(&pmd->meter_shards, &shard->node);
+            free(shard);
+        }
         goto out;
     }
 
+    if (shard) {
+        if (shard->version != meter->version) {
+            dp_meter_shard_bind(shard, meter);
+        } else {
+            /* Return unused tokens and flush locally accumulated statistics
+             * before refilling, so the shared accounting below is exact. */
+            for (int m = 0; m < meter->n_bands; ++m) {
+                band = &meter->bands[m];
+                band->bucket += shard->buckets[m];
+                if (band->bucket > band->up.burst_size) {
+                    band->bucket = band->up.burst_size;
+                }
+                shard->buckets[m] = 0;
+            }
+            meter->packet_count += shard->packet_count;
+            meter->byte_count += shard->byte_count;
+            shard->packet_count = 0;
+            shard->byte_count = 0;
+        }
+    }
+
     /* Initialize as negative values. */
     memset(exceeded_band, 0xff, cnt * sizeof *exceeded_band);
     /* Initialize as zeroes. */
@@ -5848,10 +7400,82 @@ dp_netdev_run_meter(struct dp_netdev *dp, struct dp_packet_batch *packets_,
             dp_packet_batch_refill(packets_, packet, j);
         }
     }
+
+    /* Borrow a chunk of every band into the shard so the coming batches can
+     * be admitted without the lock.  A chunk too small to cover a batch
+     * simply sends the next batch back here, which is no worse than the
+     * fully locked behavior. */
+    if (!shard) {
+        shard = xzalloc(sizeof *shard);
+        shard->meter_id = meter_id;
+        hmap_insert(&pmd->meter_shards, &shard->node, hash_int(meter_id, 0));
+        dp_meter_shard_bind(shard, meter);
+    }
+    for (int m = 0; m < meter->n_bands; ++m) {
+        uint32_t chunk;
+
+        band = &meter->bands[m];
+        chunk = MIN(band->bucket, band->up.burst_size / 4);
+        shard->buckets[m] = chunk;
+        band->bucket -= chunk;
+    }
+    shard->next_sync = now + METER_SHARD_SYNC_INTERVAL;
+
  out:
     meter_unlock(dp, meter_id);
 }
 
+/* Applies the meter identified by 'meter_id' to 'packets_'.  Packets that
+ * exceed a band are dropped in-place.
+ *
+ * The whole batch is first charged against 'pmd''s private shard of the
+ * meter in a single lockless pass; only when a shard band cannot cover the
+ * batch, or the shard's sync deadline has passed, does the thread fall back
+ * to the shared meter under its lock. */
+static void
+dp_netdev_run_meter(struct dp_netdev_pmd_thread *pmd,
+                    struct dp_packet_batch *packets_,
+                    uint32_t meter_id, long long int now)
+{
+    const size_t cnt = dp_packet_batch_size(packets_);
+    struct dp_meter_shard *shard;
+    struct dp_packet *packet;
+    uint32_t bytes, volume;
+
+    if (meter_id >= MAX_METERS) {
+        return;
+    }
+
+    shard = dp_meter_shard_lookup(pmd, meter_id);
+    if (OVS_LIKELY(shard && now < shard->next_sync)) {
+        bytes = 0;
+        DP_PACKET_BATCH_FOR_EACH (i, packet, packets_) {
+            bytes += dp_packet_size(packet);
+        }
+        /* Packets/second meters count in 1/1000 packets, kbps meters in
+         * bits; same units as the shared buckets. */
+        volume = shard->flags & OFPMF13_PKTPS ? cnt * 1000 : bytes * 8;
+
+        bool covered = true;
+        for (int m = 0; m < shard->n_bands; ++m) {
+            if (shard->buckets[m] < volume) {
+                covered = false;
+                break;
+            }
+        }
+        if (OVS_LIKELY(covered)) {
+            for (int m = 0; m < shard->n_bands; ++m) {
+                shard->buckets[m] -= volume;
+            }
+            shard->packet_count += cnt;
+            shard->byte_count += bytes;
+            return;
+        }
+    }
+
+    dp_netdev_run_meter__(pmd, shard, packets_, meter_id, now);
+}
+
 /* Meter set/get/del processing is still single-threaded. */
 static int
 dpif_netdev_meter_set(struct dpif *dpif, ofproto_meter_id meter_id,
@@ -5892,6 +7516,11 @@ dpif_netdev_meter_set(struct dpif *dpif, ofproto_meter_id meter_id,
     meter->max_delta_t = 0;
     meter->used = time_usec();
 
+    /* Meter set is single-threaded (see below), so a plain counter suffices
+     * to give every allocation a version the per-PMD shards can compare. */
+    static uint64_t next_meter_version = 1;
+    meter->version = next_meter_version++;
+
     /* set up bands */
     for (i = 0; i < config->n_bands; ++i) {
         uint32_t band_max_delta_t;
@@ -6041,7 +7670,7 @@ dp_netdev_set_nonpmd(struct dp_netdev *dp)
 {
     struct dp_netdev_pmd_thread *non_pmd;
 
-    non_pmd = xzalloc(sizeof *non_pmd);
+    non_pmd = dp_netdev_huge_alloc(sizeof *non_pmd);
     dp_netdev_configure_pmd(non_pmd, dp, NON_PMD_CORE_ID, OVS_NUMA_UNSPEC);
 }
 
@@ -6099,10 +7728,29 @@ dp_netdev_configure_pmd(struct dp_netdev_pmd_thread *pmd, struct dp_netdev *dp,
     ovs_mutex_init(&pmd->flow_mutex);
     ovs_mutex_init(&pmd->port_mutex);
     cmap_init(&pmd->action_table);
+    pmd->ubpf_emc = NULL;
+    pmd->ubpf_packetin = NULL;
+    memset(pmd->ubpf_prog_cache, 0, sizeof pmd->ubpf_prog_cache);
+    atomic_init(&pmd->miniflow_extract_opt, dp_mfex_get_best_impl());
+    atomic_init(&pmd->steal_ring.head, 0);
+    atomic_init(&pmd->steal_ring.tail, 0);
+    for (int c = 0; c < PMD_DIST_CLASSES; c++) {
+        atomic_init(&pmd->dist_rings[c].ring.head, 0);
+        atomic_init(&pmd->dist_rings[c].ring.tail, 0);
+        atomic_init(&pmd->dist_rings[c].consumer, NULL);
+    }
+    ovs_list_init(&pmd->pending_stats_flows);
+    hmap_init(&pmd->meter_shards);
     ovs_mutex_init(&pmd->bond_mutex);
     cmap_init(&pmd->flow_table);
     cmap_init(&pmd->classifiers);
     pmd->ctx.last_rxq = NULL;
+    atomic_read_relaxed(&dp->emc_insert_min, &pmd->emc_tuner.min);
+    pmd->emc_tuner.min = MAX(pmd->emc_tuner.min, EMC_TUNE_FLOOR);
+    pmd->emc_tuner.last_hits = 0;
+    pmd->emc_tuner.last_pkts = 0;
+    pmd->emc_tuner.last_hit_rate = 0;
+    pmd->emc_tuner.increasing = true;
     pmd_thread_ctx_time_update(pmd);
     pmd->next_optimization = pmd->ctx.now + DPCLS_OPTIMIZATION_INTERVAL;
     pmd->next_rcu_quiesce = pmd->ctx.now + PMD_RCU_QUIESCE_INTERVAL;
@@ -6115,7 +7763,10 @@ dp_netdev_configure_pmd(struct dp_netdev_pmd_thread *pmd, struct dp_netdev *dp,
     /* init the 'flow_cache' since there is no
      * actual thread created for NON_PMD_CORE_ID. */
     if (core_id == NON_PMD_CORE_ID) {
-        dfc_cache_init(&pmd->flow_cache);
+        uint32_t smc_entries;
+
+        atomic_read_relaxed(&dp->smc_n_entries, &smc_entries);
+        dfc_cache_init(&pmd->flow_cache, smc_entries);
         pmd_alloc_static_tx_qid(pmd);
     }
     pmd_perf_stats_init(&pmd->perf_stats);
@@ -6126,9 +7777,16 @@ dp_netdev_configure_pmd(struct dp_netdev_pmd_thread *pmd, struct dp_netdev *dp,
 static void
 dp_netdev_destroy_pmd(struct dp_netdev_pmd_thread *pmd)
 {
+    struct dp_meter_shard *shard, *next_shard;
     struct dpcls *cls;
 
     dp_netdev_pmd_flow_flush(pmd);
+    /* Borrowed tokens die with the shards; the shared buckets regain them
+     * through ordinary refill within one burst interval. */
+    HMAP_FOR_EACH_SAFE (shard, next_shard, node, &pmd->meter_shards) {
+        free(shard);
+    }
+    hmap_destroy(&pmd->meter_shards);
     hmap_destroy(&pmd->send_port_cache);
     hmap_destroy(&pmd->tnl_port_cache);
     hmap_destroy(&pmd->tx_ports);
@@ -6142,11 +7800,13 @@ dp_netdev_destroy_pmd(struct dp_netdev_pmd_thread *pmd)
     cmap_destroy(&pmd->classifiers);
     cmap_destroy(&pmd->flow_table);
     cmap_destroy(&pmd->action_table);
+    free(pmd->ubpf_emc);
+    ubpf_packetin_ring_destroy(pmd->ubpf_packetin);
     ovs_mutex_destroy(&pmd->flow_mutex);
     seq_destroy(pmd->reload_seq);
     ovs_mutex_destroy(&pmd->port_mutex);
     ovs_mutex_destroy(&pmd->bond_mutex);
-    free(pmd);
+    dp_netdev_huge_free(pmd, sizeof *pmd);
 }
 
 /* Stops the pmd thread, removes it from the 'dp->poll_threads',
@@ -6371,17 +8031,67 @@ dpif_netdev_get_datapath_version(void)
 }
 
 static void
-dp_netdev_flow_used(struct dp_netdev_flow *netdev_flow, int cnt, int size,
+dp_netdev_flow_used(struct dp_netdev_pmd_thread *pmd,
+                    struct dp_netdev_flow *netdev_flow, int cnt, int size,
                     uint16_t tcp_flags, long long now)
 {
-    uint16_t flags;
+    struct dp_netdev_flow_pending_stats *pending;
 
-    atomic_store_relaxed(&netdev_flow->stats.used, now);
-    non_atomic_ullong_add(&netdev_flow->stats.packet_count, cnt);
-    non_atomic_ullong_add(&netdev_flow->stats.byte_count, size);
-    atomic_read_relaxed(&netdev_flow->stats.tcp_flags, &flags);
-    flags |= tcp_flags;
-    atomic_store_relaxed(&netdev_flow->stats.tcp_flags, flags);
+    if (OVS_UNLIKELY(pmd->core_id == NON_PMD_CORE_ID)) {
+        uint16_t flags;
+
+        /* Non-pmd threads never run the periodic fold, so they update the
+         * shared counters directly. */
+        atomic_store_relaxed(&netdev_flow->stats.used, now);
+        non_atomic_ullong_add(&netdev_flow->stats.packet_count, cnt);
+        non_atomic_ullong_add(&netdev_flow->stats.byte_count, size);
+        atomic_read_relaxed(&netdev_flow->stats.tcp_flags, &flags);
+        flags |= tcp_flags;
+        atomic_store_relaxed(&netdev_flow->stats.tcp_flags, flags);
+        return;
+    }
+
+    /* Accumulate locally; dp_netdev_pmd_fold_flow_stats() pushes the
+     * totals to the shared counters on the pmd's housekeeping tick. */
+    if (ovs_list_is_empty(&netdev_flow->pending_node)) {
+        dp_netdev_flow_ref(netdev_flow);
+        ovs_list_push_back(&pmd->pending_stats_flows,
+                           &netdev_flow->pending_node);
+    }
+    pending = &netdev_flow->pending_stats;
+    pending->used = now;
+    pending->packet_count += cnt;
+    pending->byte_count += size;
+    pending->tcp_flags |= tcp_flags;
+}
+
+/* Folds the stats 'pmd' has accumulated locally into the shared per-flow
+ * counters and drops the references pinning the pending flows.  Flows
+ * already removed from the classifier just get their final counts
+ * recorded before the last reference goes away. */
+static void
+dp_netdev_pmd_fold_flow_stats(struct dp_netdev_pmd_thread *pmd)
+{
+    struct dp_netdev_flow *netdev_flow;
+
+    LIST_FOR_EACH_POP (netdev_flow, pending_node, &pmd->pending_stats_flows) {
+        struct dp_netdev_flow_pending_stats *pending;
+        uint16_t flags;
+
+        pending = &netdev_flow->pending_stats;
+        atomic_store_relaxed(&netdev_flow->stats.used, pending->used);
+        non_atomic_ullong_add(&netdev_flow->stats.packet_count,
+                              pending->packet_count);
+        non_atomic_ullong_add(&netdev_flow->stats.byte_count,
+                              pending->byte_count);
+        atomic_read_relaxed(&netdev_flow->stats.tcp_flags, &flags);
+        flags |= pending->tcp_flags;
+        atomic_store_relaxed(&netdev_flow->stats.tcp_flags, flags);
+
+        memset(pending, 0, sizeof *pending);
+        ovs_list_init(&netdev_flow->pending_node);
+        dp_netdev_flow_unref(netdev_flow);
+    }
 }
 
 static int
@@ -6500,14 +8210,14 @@ packet_batch_per_flow_execute(struct packet_batch_per_flow *batch,
     struct dp_netdev_actions *actions;
     struct dp_netdev_flow *flow = batch->flow;
 
-    dp_netdev_flow_used(flow, dp_packet_batch_size(&batch->array),
+    dp_netdev_flow_used(pmd, flow, dp_packet_batch_size(&batch->array),
                         batch->byte_count,
                         batch->tcp_flags, pmd->ctx.now / 1000);
 
     actions = dp_netdev_flow_get_actions(flow);
 
-    dp_netdev_execute_actions(pmd, &batch->array, true, &flow->flow,
-                              actions->actions, actions->size);
+    dp_netdev_execute_prog(pmd, &batch->array, true, &flow->flow, flow,
+                           actions->prog);
 }
 
 static inline void
@@ -6545,7 +8255,6 @@ packet_enqueue_to_flow_map(struct dp_packet *packet,
  */
 static inline void
 smc_lookup_batch(struct dp_netdev_pmd_thread *pmd,
-            struct netdev_flow_key *keys,
             struct netdev_flow_key **missed_keys,
             struct dp_packet_batch *packets_,
             const int cnt,
@@ -6563,12 +8272,26 @@ smc_lookup_batch(struct dp_netdev_pmd_thread *pmd,
 
     /* Prefetch buckets for all packets */
     for (i = 0; i < cnt; i++) {
-        OVS_PREFETCH(&smc_cache->buckets[keys[i].hash & SMC_MASK]);
+        OVS_PREFETCH(&smc_cache->buckets[missed_keys[i]->hash
+                                         & smc_cache->bucket_mask]);
+    }
+
+    /* The SMC buckets resolve to flow table indexes; prefetch the flow
+     * table buckets those indexes point at before any of them is probed,
+     * so their (likely) cache misses overlap instead of serializing. */
+    for (i = 0; i < cnt; i++) {
+        uint32_t index = smc_entry_get_index(smc_cache,
+                                             missed_keys[i]->hash);
+
+        if (index != SMC_ENTRY_NONE) {
+            cmap_prefetch_index(&pmd->flow_table, index);
+        }
     }
 
     DP_PACKET_BATCH_REFILL_FOR_EACH (i, cnt, packet, packets_) {
         struct dp_netdev_flow *flow = NULL;
-        flow_node = smc_entry_get(pmd, keys[i].hash);
+        struct netdev_flow_key *key = missed_keys[i];
+        flow_node = smc_entry_get(pmd, key->hash);
         bool hit = false;
         /* Get the original order of this packet in received batch. */
         recv_idx = index_map[i];
@@ -6577,14 +8300,14 @@ smc_lookup_batch(struct dp_netdev_pmd_thread *pmd,
             CMAP_NODE_FOR_EACH (flow, node, flow_node) {
                 /* Since we dont have per-port megaflow to check the port
                  * number, we need to  verify that the input ports match. */
-                if (OVS_LIKELY(dpcls_rule_matches_key(&flow->cr, &keys[i]) &&
+                if (OVS_LIKELY(dpcls_rule_matches_key(flow->cr, key) &&
                 flow->flow.in_port.odp_port == packet->md.in_port.odp_port)) {
-                    tcp_flags = miniflow_get_tcp_flags(&keys[i].mf);
+                    tcp_flags = miniflow_get_tcp_flags(&key->mf);
 
                     /* SMC hit and emc miss, we insert into EMC */
-                    keys[i].len =
-                        netdev_flow_key_size(miniflow_n_values(&keys[i].mf));
-                    emc_probabilistic_insert(pmd, &keys[i], flow);
+                    key->len =
+                        netdev_flow_key_size(miniflow_n_values(&key->mf));
+                    emc_probabilistic_insert(pmd, key, flow);
                     /* Add these packets into the flow map in the same order
                      * as received.
                      */
@@ -6607,8 +8330,9 @@ smc_lookup_batch(struct dp_netdev_pmd_thread *pmd,
         /* Preserve the order of packet for flow batching. */
         index_map[n_missed] = recv_idx;
 
-        /* Put missed keys to the pointer arrays return to the caller */
-        missed_keys[n_missed++] = &keys[i];
+        /* Compact the keys that missed both caches to the front of the
+         * pointer array returned to the caller. */
+        missed_keys[n_missed++] = key;
     }
 
     pmd_perf_update_counter(&pmd->perf_stats, PMD_STAT_SMC_HIT, n_smc_hit);
@@ -6639,38 +8363,52 @@ dfc_processing(struct dp_netdev_pmd_thread *pmd,
                size_t *n_flows, uint8_t *index_map,
                bool md_is_valid, odp_port_t port_no)
 {
-    struct netdev_flow_key *key = &keys[0];
+    struct dp_netdev_flow *mark_flows[NETDEV_MAX_BURST];
+    uint8_t probe_idx[NETDEV_MAX_BURST];
     size_t n_missed = 0, n_emc_hit = 0;
     struct dfc_cache *cache = &pmd->flow_cache;
     struct dp_packet *packet;
     const size_t cnt = dp_packet_batch_size(packets_);
     uint32_t cur_min = pmd->ctx.emc_insert_min;
+    size_t n_keys = 0;
     int i;
     uint16_t tcp_flags;
     bool smc_enable_db;
     size_t map_cnt = 0;
     bool batch_enable = true;
+    miniflow_extract_func mfex_func;
 
     atomic_read_relaxed(&pmd->dp->smc_enable_db, &smc_enable_db);
+    atomic_read_relaxed(&pmd->miniflow_extract_opt, &mfex_func);
     pmd_perf_update_counter(&pmd->perf_stats,
                             md_is_valid ? PMD_STAT_RECIRC : PMD_STAT_RECV,
                             cnt);
 
-    DP_PACKET_BATCH_REFILL_FOR_EACH (i, cnt, packet, packets_) {
+    /* First pass over the batch: drop runts, initialize metadata, resolve
+     * flow marks, and extract miniflows and hashes.  For every packet that
+     * will probe the caches, prefetch the EMC entries (and SMC bucket) it
+     * will touch; by the time the second pass probes, the entries for the
+     * whole batch are on their way into cache, instead of each probe eating
+     * its miss inline. */
+    DP_PACKET_BATCH_FOR_EACH (j, packet, packets_) {
+        struct netdev_flow_key *key;
         struct dp_netdev_flow *flow;
         uint32_t mark;
 
+        mark_flows[j] = NULL;
+        probe_idx[j] = UINT8_MAX;
+
         if (OVS_UNLIKELY(dp_packet_size(packet) < ETH_HEADER_LEN)) {
             dp_packet_delete(packet);
             COVERAGE_INC(datapath_drop_rx_invalid_packet);
             continue;
         }
 
-        if (i != cnt - 1) {
+        if (j != cnt - 1) {
             struct dp_packet **packets = packets_->packets;
             /* Prefetch next packet data and metadata. */
-            OVS_PREFETCH(dp_packet_data(packets[i+1]));
-            pkt_metadata_prefetch_init(&packets[i+1]->md);
+            OVS_PREFETCH(dp_packet_data(packets[j+1]));
+            pkt_metadata_prefetch_init(&packets[j+1]->md);
         }
 
         if (!md_is_valid) {
@@ -6681,34 +8419,67 @@ dfc_processing(struct dp_netdev_pmd_thread *pmd,
             dp_packet_has_flow_mark(packet, &mark)) {
             flow = mark_to_flow_find(pmd, mark);
             if (OVS_LIKELY(flow)) {
-                tcp_flags = parse_tcp_flags(packet);
-                if (OVS_LIKELY(batch_enable)) {
-                    dp_netdev_queue_batches(packet, flow, tcp_flags, batches,
-                                            n_batches);
-                } else {
-                    /* Flow batching should be performed only after fast-path
-                     * processing is also completed for packets with emc miss
-                     * or else it will result in reordering of packets with
-                     * same datapath flows. */
-                    packet_enqueue_to_flow_map(packet, flow, tcp_flags,
-                                               flow_map, map_cnt++);
-                }
+                mark_flows[j] = flow;
                 continue;
             }
         }
 
-        miniflow_extract(packet, &key->mf);
+        key = &keys[n_keys];
+        if (OVS_LIKELY(!mfex_func) || !mfex_func(packet, &key->mf)) {
+            miniflow_extract(packet, &key->mf);
+        }
         key->len = 0; /* Not computed yet. */
         key->hash =
                 (md_is_valid == false)
                 ? dpif_netdev_packet_get_rss_hash_orig_pkt(packet, &key->mf)
                 : dpif_netdev_packet_get_rss_hash(packet, &key->mf);
+        if (cur_min != 0) {
+            emc_prefetch(&cache->emc_cache, key->hash);
+        }
+        if (smc_enable_db) {
+            OVS_PREFETCH(&cache->smc_cache.buckets[key->hash
+                                            & cache->smc_cache.bucket_mask]);
+        }
+        probe_idx[j] = n_keys++;
+    }
+
+    /* Second pass: probe the caches in the original packet order. */
+    DP_PACKET_BATCH_REFILL_FOR_EACH (i, cnt, packet, packets_) {
+        struct dp_netdev_flow *flow;
+
+        if (mark_flows[i]) {
+            flow = mark_flows[i];
+            tcp_flags = parse_tcp_flags(packet);
+            if (OVS_LIKELY(batch_enable)) {
+                dp_netdev_queue_batches(packet, flow, tcp_flags, batches,
+                                        n_batches);
+            } else {
+                /* Flow batching should be performed only after fast-path
+                 * processing is also completed for packets with emc miss
+                 * or else it will result in reordering of packets with
+                 * same datapath flows. */
+                packet_enqueue_to_flow_map(packet, flow, tcp_flags,
+                                           flow_map, map_cnt++);
+            }
+            continue;
+        }
+
+        if (OVS_UNLIKELY(probe_idx[i] == UINT8_MAX)) {
+            /* Dropped in the first pass. */
+            continue;
+        }
+
+        struct netdev_flow_key *key = &keys[probe_idx[i]];
 
         /* If EMC is disabled skip emc_lookup */
         flow = (cur_min != 0) ? emc_lookup(&cache->emc_cache, key) : NULL;
         if (OVS_LIKELY(flow)) {
             tcp_flags = miniflow_get_tcp_flags(&key->mf);
             n_emc_hit++;
+            if (flow->ct_ref.conn) {
+                conntrack_conn_ref_restore(pmd->dp->conntrack, &flow->ct_ref,
+                                           packet);
+            }
             if (OVS_LIKELY(batch_enable)) {
                 dp_netdev_queue_batches(packet, flow, tcp_flags, batches,
                                         n_batches);
@@ -6729,13 +8500,10 @@ dfc_processing(struct dp_netdev_pmd_thread *pmd,
             index_map[n_missed] = map_cnt;
             flow_map[map_cnt++].flow = NULL;
 
-            /* 'key[n_missed]' contains the key of the current packet and it
-             * will be passed to SMC lookup. The next key should be extracted
-             * to 'keys[n_missed + 1]'.
-             * We also maintain a pointer array to keys missed both SMC and EMC
-             * which will be returned to the caller for future processing. */
-            missed_keys[n_missed] = key;
-            key = &keys[++n_missed];
+            /* Keys that missed the EMC stay where the first pass extracted
+             * them; the pointer array compacts them for SMC lookup and for
+             * the caller. */
+            missed_keys[n_missed++] = key;
 
             /* Skip batching for subsequent packets to avoid reordering. */
             batch_enable = false;
@@ -6751,12 +8519,78 @@ dfc_processing(struct dp_netdev_pmd_thread *pmd,
     }
 
     /* Packets miss EMC will do a batch lookup in SMC if enabled */
-    smc_lookup_batch(pmd, keys, missed_keys, packets_,
+    smc_lookup_batch(pmd, missed_keys, packets_,
                      n_missed, flow_map, index_map);
 
     return dp_packet_batch_size(packets_);
 }
 
+static bool dp_execute_output_action(struct dp_netdev_pmd_thread *pmd,
+                                     struct dp_packet_batch *packets_,
+                                     bool should_steal, odp_port_t port_no);
+
+/* ARP requests and neighbor solicitations for a local tunnel endpoint
+ * address rarely match an installed flow, so each one takes the upcall path
+ * and a broadcast burst of them can flood the handler threads.  If 'packet'
+ * is such a request, synthesizes the reply in place and sends it back out
+ * the ingress port, never leaving the PMD thread, and returns true.
+ * Otherwise returns false and leaves 'packet' untouched.
+ *
+ * The reply bypasses the OpenFlow pipeline entirely, so this only runs
+ * when other_config:tnl-neigh-responder is set; by default such requests
+ * take the ordinary upcall path. */
+static bool
+dp_netdev_tnl_responder(struct dp_netdev_pmd_thread *pmd,
+                        struct dp_packet *packet, const struct flow *flow)
+{
+    struct dp_packet_batch b;
+    struct eth_addr mac;
+    bool enabled;
+
+    atomic_read_relaxed(&pmd->dp->tnl_neigh_responder, &enabled);
+    if (!enabled) {
+        return false;
+    }
+
+    if (flow->vlans[0].tci & htons(VLAN_CFI)) {
+        return false;
+    }
+
+    if (flow->dl_type == htons(ETH_TYPE_ARP)
+        && flow->nw_proto == ARP_OP_REQUEST && flow->nw_dst) {
+        struct in6_addr target;
+
+        in6_addr_set_mapped_ipv4(&target, flow->nw_dst);
+        if (!tnl_port_endpoint_lookup(&target, &mac)) {
+            return false;
+        }
+        compose_arp(packet, ARP_OP_REPLY, mac, flow->arp_sha, false,
+                    flow->nw_dst, flow->nw_src);
+    } else if (flow->dl_type == htons(ETH_TYPE_IPV6)
+               && flow->nw_proto == IPPROTO_ICMPV6
+               && flow->tp_src == htons(ND_NEIGHBOR_SOLICIT)
+               && ipv6_addr_is_set(&flow->nd_target)) {
+        if (!ipv6_addr_is_set(&flow->ipv6_src)) {
+            /* An unspecified source means duplicate address detection;
+             * leave that to the stack that owns the address. */
+            return false;
+        }
+        if (!tnl_port_endpoint_lookup(&flow->nd_target, &mac)) {
+            return false;
+        }
+        compose_nd_na(packet, mac, flow->dl_src, &flow->nd_target,
+                      &flow->ipv6_src,
+                      htonl(ND_RSO_SOLICITED | ND_RSO_OVERRIDE));
+    } else {
+        return false;
+    }
+
+    COVERAGE_INC(datapath_tnl_responder);
+    dp_packet_batch_init_packet(&b, packet);
+    dp_execute_output_action(pmd, &b, true, flow->in_port.odp_port);
+    return true;
+}
+
 static inline int
 handle_packet_upcall(struct dp_netdev_pmd_thread *pmd,
                      struct dp_packet *packet,
@@ -6774,6 +8608,10 @@ handle_packet_upcall(struct dp_netdev_pmd_thread *pmd,
     miniflow_expand(&key->mf, &match.flow);
     memset(&match.wc, 0, sizeof match.wc);
 
+    if (OVS_UNLIKELY(dp_netdev_tnl_responder(pmd, packet, &match.flow))) {
+        return 0;
+    }
+
     ofpbuf_clear(actions);
     ofpbuf_clear(put_actions);
 
@@ -6801,7 +8639,7 @@ handle_packet_upcall(struct dp_netdev_pmd_thread *pmd,
      * the actions.  Otherwise, if there are any slow path actions,
      * we'll send the packet up twice. */
     dp_packet_batch_init_packet(&b, packet);
-    dp_netdev_execute_actions(pmd, &b, true, &match.flow,
+    dp_netdev_execute_actions(pmd, &b, true, &match.flow, NULL,
                               actions->data, actions->size);
 
     add_actions = put_actions->size ? put_actions : actions;
@@ -6893,7 +8731,7 @@ fast_path_processing(struct dp_netdev_pmd_thread *pmd,
                                                     &add_lookup_cnt);
             if (netdev_flow) {
                 lookup_cnt += add_lookup_cnt;
-                rules[i] = &netdev_flow->cr;
+                rules[i] = netdev_flow->cr;
                 continue;
             }
 
@@ -7037,6 +8875,9 @@ dp_netdev_recirculate(struct dp_netdev_pmd_thread *pmd,
 struct dp_netdev_execute_aux {
     struct dp_netdev_pmd_thread *pmd;
     const struct flow *flow;
+    struct dp_netdev_flow *dp_flow; /* Datapath flow the actions belong to,
+                                     * or NULL if not executed on behalf of
+                                     * an installed flow. */
 };
 
 static void
@@ -7180,7 +9021,7 @@ dp_execute_userspace_action(struct dp_netdev_pmd_thread *pmd,
                              NULL);
     if (!error || error == ENOSPC) {
         dp_packet_batch_init_packet(&b, packet);
-        dp_netdev_execute_actions(pmd, &b, should_steal, flow,
+        dp_netdev_execute_actions(pmd, &b, should_steal, flow, NULL,
                                   actions->data, actions->size);
     } else if (should_steal) {
         dp_packet_delete(packet);
@@ -7203,7 +9044,15 @@ dp_execute_output_action(struct dp_netdev_pmd_thread *pmd,
         return false;
     }
     if (!should_steal) {
-        dp_packet_batch_clone(&out, packets_);
+        /* A non-final output (e.g. for a mirror) keeps a copy of the batch.
+         * When the remaining actions cannot modify packet payload, the copy
+         * borrows the originals' buffers instead of duplicating them (see
+         * odp_actions_preserve_payload()). */
+        if (packets_->may_share_payload) {
+            dp_packet_batch_clone_shared(&out, packets_);
+        } else {
+            dp_packet_batch_clone(&out, packets_);
+        }
         dp_packet_batch_reset_cutlen(packets_);
         packets_ = &out;
     }
@@ -7252,7 +9101,11 @@ dp_execute_lb_output_action(struct dp_netdev_pmd_thread *pmd,
         return;
     }
     if (!should_steal) {
-        dp_packet_batch_clone(&out, packets_);
+        if (packets_->may_share_payload) {
+            dp_packet_batch_clone_shared(&out, packets_);
+        } else {
+            dp_packet_batch_clone(&out, packets_);
+        }
         dp_packet_batch_reset_cutlen(packets_);
         packets_ = &out;
     }
@@ -7569,11 +9422,17 @@ dp_execute_cb(void *aux_, struct dp_packet_batch *packets_,
                           commit, zone, setmark, setlabel, aux->flow->tp_src,
                           aux->flow->tp_dst, helper, nat_action_info_ref,
                           pmd->ctx.now / 1000, tp_id);
+        if (aux->dp_flow && dp_packet_batch_size(packets_)) {
+            /* Remember the connection this batch resolved to on its flow,
+             * so later flow cache hits can skip the conntrack probe. */
+            conntrack_conn_ref_init(dp->conntrack, packets_->packets[0],
+                                    &aux->dp_flow->ct_ref);
+        }
         break;
     }
 
     case OVS_ACTION_ATTR_METER:
-        dp_netdev_run_meter(pmd->dp, packets_, nl_attr_get_u32(a),
+        dp_netdev_run_meter(pmd, packets_, nl_attr_get_u32(a),
                             pmd->ctx.now);
         break;
 
@@ -7595,6 +9454,8 @@ dp_execute_cb(void *aux_, struct dp_packet_batch *packets_,
     case OVS_ACTION_ATTR_CT_CLEAR:
     case OVS_ACTION_ATTR_CHECK_PKT_LEN:
     case OVS_ACTION_ATTR_DROP:
+    case OVS_ACTION_ATTR_STICKY_LEARN:
+    case OVS_ACTION_ATTR_STICKY_LOOKUP:
     case __OVS_ACTION_ATTR_MAX:
         OVS_NOT_REACHED();
     }
@@ -7606,14 +9467,29 @@ void
 dp_netdev_execute_actions(struct dp_netdev_pmd_thread *pmd,
                           struct dp_packet_batch *packets,
                           bool should_steal, const struct flow *flow,
+                          struct dp_netdev_flow *dp_flow,
                           const struct nlattr *actions, size_t actions_len)
 {
-    struct dp_netdev_execute_aux aux = { pmd, flow };
+    struct dp_netdev_execute_aux aux = { pmd, flow, dp_flow };
 
     odp_execute_actions(&aux, packets, should_steal, actions,
                         actions_len, dp_execute_cb);
 }
 
+/* As dp_netdev_execute_actions(), but runs actions compiled into 'prog' by
+ * odp_execute_compile(), skipping the per-batch netlink parsing. */
+static void
+dp_netdev_execute_prog(struct dp_netdev_pmd_thread *pmd,
+                       struct dp_packet_batch *packets,
+                       bool should_steal, const struct flow *flow,
+                       struct dp_netdev_flow *dp_flow,
+                       const struct odp_execute_prog *prog)
+{
+    struct dp_netdev_execute_aux aux = { pmd, flow, dp_flow };
+
+    odp_execute_prog_run(&aux, packets, should_steal, prog, dp_execute_cb);
+}
+
 struct dp_netdev_ct_dump {
     struct ct_dpif_dump_state up;
     struct conntrack_dump dump;
@@ -8087,6 +9963,14 @@ const struct dpif_class dpif_netdev_class = {
     NULL,
     NULL,
     NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
 };
 
 static void
@@ -8192,12 +10076,140 @@ dpif_dummy_register(enum dummy_level level)
 
 /* Datapath Classifier. */
 
+/* Rule arena.
+ *
+ * All rules in a subtable share the subtable's mask and thus have the same
+ * size, so they can be carved out of fixed-size slabs instead of being
+ * allocated individually.  This keeps the rules that a lookup probes on a
+ * hash collision within a few contiguous slabs rather than scattered across
+ * the heap, which matters once a classifier accumulates tens of subtables.
+ *
+ * Allocation happens on the writer side only (under the pmd's flow_mutex),
+ * but slots are returned from RCU callbacks, so the free list needs its own
+ * lock. */
+
+/* Number of rules carved out of each slab. */
+#define DPCLS_ARENA_SLAB_RULES 32
+
+struct dpcls_slab {
+    struct ovs_list list_node;  /* In dpcls_arena's 'slabs'. */
+    char rules[];               /* DPCLS_ARENA_SLAB_RULES rules of the
+                                 * arena's 'rule_size' bytes each. */
+};
+
+/* A free rule slot, linked through its own first bytes. */
+struct dpcls_free_rule {
+    struct dpcls_free_rule *next;
+};
+
+struct dpcls_arena {
+    struct ovs_mutex mutex;
+    size_t rule_size;           /* Bytes per rule, masked key included. */
+    size_t slab_size;           /* Bytes per slab, header included. */
+    struct ovs_list slabs;      /* Contains "struct dpcls_slab"s. */
+    struct dpcls_free_rule *free_rules OVS_GUARDED;
+};
+
+static struct dpcls_arena *
+dpcls_arena_create(size_t rule_size)
+{
+    struct dpcls_arena *arena = xmalloc(sizeof *arena);
+
+    ovs_mutex_init(&arena->mutex);
+    arena->rule_size = ROUND_UP(rule_size, sizeof(struct dpcls_free_rule));
+    arena->slab_size = sizeof(struct dpcls_slab)
+                       + DPCLS_ARENA_SLAB_RULES * arena->rule_size;
+    ovs_list_init(&arena->slabs);
+    arena->free_rules = NULL;
+    return arena;
+}
+
+/* Frees 'arena' and its slabs.  All rules allocated from 'arena' must have
+ * been freed back to it and a grace period must have passed since then. */
+static void
+dpcls_arena_destroy(struct dpcls_arena *arena)
+{
+    struct dpcls_slab *slab;
+
+    LIST_FOR_EACH_POP (slab, list_node, &arena->slabs) {
+        dp_netdev_huge_free(slab, arena->slab_size);
+    }
+    ovs_mutex_destroy(&arena->mutex);
+    free(arena);
+}
+
+static struct dpcls_rule *
+dpcls_arena_alloc(struct dpcls_arena *arena)
+{
+    struct dpcls_free_rule *slot;
+
+    ovs_mutex_lock(&arena->mutex);
+    if (!arena->free_rules) {
+        struct dpcls_slab *slab = dp_netdev_huge_alloc(arena->slab_size);
+        int i;
+
+        ovs_list_push_back(&arena->slabs, &slab->list_node);
+        /* Thread the slab in reverse so that allocation proceeds from low
+         * addresses to high. */
+        for (i = DPCLS_ARENA_SLAB_RULES - 1; i >= 0; i--) {
+            slot = ALIGNED_CAST(struct dpcls_free_rule *,
+                                &slab->rules[i * arena->rule_size]);
+            slot->next = arena->free_rules;
+            arena->free_rules = slot;
+        }
+    }
+    slot = arena->free_rules;
+    arena->free_rules = slot->next;
+    ovs_mutex_unlock(&arena->mutex);
+
+    return (struct dpcls_rule *) slot;
+}
+
+/* Returns 'rule' to its arena.  Runs as an RCU callback, a grace period
+ * after the rule was removed from its subtable, so no reader can still be
+ * probing the slot when it becomes reusable. */
+static void
+dpcls_arena_free_cb(struct dpcls_rule *rule)
+{
+    struct dpcls_free_rule *slot = (struct dpcls_free_rule *) rule;
+    struct dpcls_subtable *subtable;
+    struct dpcls_arena *arena;
+
+    /* Get subtable from reference in rule->mask.  The subtable cannot have
+     * been freed yet: its destruction is postponed after the frees of any
+     * rules still pending for it, and callbacks run in that order. */
+    INIT_CONTAINER(subtable, rule->mask, mask);
+    arena = subtable->arena;
+
+    ovs_mutex_lock(&arena->mutex);
+    slot->next = arena->free_rules;
+    arena->free_rules = slot;
+    ovs_mutex_unlock(&arena->mutex);
+}
+
+/* Bytes to allocate for a subtable whose mask's miniflow is 'mask_len'
+ * bytes long. */
+static size_t
+dpcls_subtable_alloc_size(uint32_t mask_len)
+{
+    return sizeof(struct dpcls_subtable)
+           - MEMBER_SIZEOF(struct netdev_flow_key, mf) + mask_len;
+}
+
+static void
+dpcls_subtable_free_cb(struct dpcls_subtable *subtable)
+{
+    dp_netdev_huge_free(subtable,
+                        dpcls_subtable_alloc_size(subtable->mask.len));
+}
+
 static void
 dpcls_subtable_destroy_cb(struct dpcls_subtable *subtable)
 {
     cmap_destroy(&subtable->rules);
+    dpcls_arena_destroy(subtable->arena);
     ovsrcu_postpone(free, subtable->mf_masks);
-    ovsrcu_postpone(free, subtable);
+    ovsrcu_postpone(dpcls_subtable_free_cb, subtable);
 }
 
 /* Initializes 'cls' as a classifier that initially contains no classification
@@ -8243,8 +10255,7 @@ dpcls_create_subtable(struct dpcls *cls, const struct netdev_flow_key *mask)
     struct dpcls_subtable *subtable;
 
     /* Need to add one. */
-    subtable = xmalloc(sizeof *subtable
-                       - sizeof subtable->mask.mf + mask->len);
+    subtable = dp_netdev_huge_alloc(dpcls_subtable_alloc_size(mask->len));
     cmap_init(&subtable->rules);
     subtable->hit_cnt = 0;
     netdev_flow_key_clone(&subtable->mask, mask);
@@ -8258,6 +10269,12 @@ dpcls_create_subtable(struct dpcls *cls, const struct netdev_flow_key *mask)
     subtable->mf_bits_set_unit1 = unit1;
     subtable->mf_masks = xmalloc(sizeof(uint64_t) * (unit0 + unit1));
     netdev_flow_key_gen_masks(mask, subtable->mf_masks, unit0, unit1);
+    subtable->jit_flatten = NULL; /* Compiled on first lookup, if at all. */
+
+    /* Every rule in this subtable needs room for a masked key of exactly
+     * 'mask->len' bytes, so the arena can pack them back to back. */
+    subtable->arena = dpcls_arena_create(offsetof(struct dpcls_rule, flow.mf)
+                                         + mask->len);
 
     /* Get the preferred subtable search function for this (u0,u1) subtable.
      * The function is guaranteed to always return a valid implementation, and
@@ -8275,6 +10292,77 @@ dpcls_create_subtable(struct dpcls *cls, const struct netdev_flow_key *mask)
     return subtable;
 }
 
+/* Returns true if every bit that 'sub' matches on is also matched on by
+ * 'super'. */
+static bool
+netdev_flow_key_is_submask(const struct netdev_flow_key *sub,
+                           const struct netdev_flow_key *super)
+{
+    const uint64_t *sub_u64 = miniflow_get_values(&sub->mf);
+    size_t idx;
+
+    FLOWMAP_FOR_EACH_INDEX (idx, sub->mf.map) {
+        if (*sub_u64++ & ~miniflow_get(&super->mf, idx)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Returns the number of bits that mask 'key' matches on. */
+static uint32_t
+netdev_flow_key_count_bits(const struct netdev_flow_key *key)
+{
+    const uint64_t *values = miniflow_get_values(&key->mf);
+    size_t n = miniflow_n_values(&key->mf);
+    uint32_t bits = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        bits += count_1bits(values[i]);
+    }
+    return bits;
+}
+
+/* Limit on how many extra exact-match bits a flow may take on when it is
+ * installed under an existing subtable's wider mask instead of a subtable of
+ * its own.  Each extra bit narrows the megaflow and thus costs upcalls,
+ * while every distinct mask costs a subtable that all lookups in this
+ * classifier must probe. */
+#define DPCLS_SUBTABLE_ADOPT_MAX_BITS 16
+
+/* Looks for an existing subtable whose mask matches on every bit that 'mask'
+ * does, plus at most DPCLS_SUBTABLE_ADOPT_MAX_BITS more, preferring the
+ * candidate with the fewest extra bits.  Returns NULL if there is none.
+ *
+ * Installing a flow under such a wider mask only makes the resulting
+ * megaflow more specific, which is correct for any actions: packets the
+ * narrower flow no longer covers miss and take the upcall path again.  In
+ * exchange the classifier is not fragmented into subtables whose masks
+ * differ in a handful of bits, e.g. a full nw_tos next to an ECN-only
+ * match. */
+static struct dpcls_subtable *
+dpcls_find_adoptable_subtable(struct dpcls *cls,
+                              const struct netdev_flow_key *mask)
+{
+    uint32_t mask_bits = netdev_flow_key_count_bits(mask);
+    uint32_t best_extra = DPCLS_SUBTABLE_ADOPT_MAX_BITS + 1;
+    struct dpcls_subtable *best = NULL;
+    struct dpcls_subtable *subtable;
+
+    CMAP_FOR_EACH (subtable, cmap_node, &cls->subtables_map) {
+        if (netdev_flow_key_is_submask(mask, &subtable->mask)) {
+            uint32_t extra = netdev_flow_key_count_bits(&subtable->mask)
+                             - mask_bits;
+
+            if (extra < best_extra) {
+                best = subtable;
+                best_extra = extra;
+            }
+        }
+    }
+    return best;
+}
+
 static inline struct dpcls_subtable *
 dpcls_find_subtable(struct dpcls *cls, const struct netdev_flow_key *mask)
 {
@@ -8286,6 +10374,11 @@ dpcls_find_subtable(struct dpcls *cls, const struct netdev_flow_key *mask)
             return subtable;
         }
     }
+
+    subtable = dpcls_find_adoptable_subtable(cls, mask);
+    if (subtable) {
+        return subtable;
+    }
     return dpcls_create_subtable(cls, mask);
 }
 
@@ -8312,18 +10405,31 @@ dpcls_subtable_lookup_reprobe(struct dpcls *cls)
     return subtables_changed;
 }
 
-/* Periodically sort the dpcls subtable vectors according to hit counts */
+/* Decay callback for pvector_reprioritize(): halves the previous priority
+ * and folds in the hits taken since the last decay, so the ordering tracks
+ * current traffic with an exponentially aged history instead of being
+ * rebuilt from a single interval's counts. */
+static int
+dpcls_subtable_decay_priority(void *subtable_, int priority,
+                              void *aux OVS_UNUSED)
+{
+    struct dpcls_subtable *subtable = subtable_;
+    uint32_t hit_cnt = MIN(subtable->hit_cnt, INT_MAX / 2);
+
+    subtable->hit_cnt = 0;
+    return priority / 2 + hit_cnt;
+}
+
+/* Periodically decay subtable hit counts into priorities.  The reordering
+ * itself is incremental: this and the much more frequent bubble passes in
+ * dp_netdev_pmd_try_optimize() swap adjacent subtables in place, so the
+ * vector follows the traffic continuously and there is no periodic full
+ * sort (or vector copy) to cause a lookup-cost spike. */
 static void
 dpcls_sort_subtable_vector(struct dpcls *cls)
 {
-    struct pvector *pvec = &cls->subtables;
-    struct dpcls_subtable *subtable;
-
-    PVECTOR_FOR_EACH (subtable, pvec) {
-        pvector_change_priority(pvec, subtable, subtable->hit_cnt);
-        subtable->hit_cnt = 0;
-    }
-    pvector_publish(pvec);
+    pvector_reprioritize(&cls->subtables, dpcls_subtable_decay_priority,
+                         NULL);
 }
 
 static inline void
@@ -8396,19 +10502,37 @@ dp_netdev_pmd_try_optimize(struct dp_netdev_pmd_thread *pmd,
             pmd->next_optimization = pmd->ctx.now
                                      + DPCLS_OPTIMIZATION_INTERVAL;
         }
+    } else if (!ovs_mutex_trylock(&pmd->flow_mutex)) {
+        /* Between decays, keep bubbling subtables towards their slot one
+         * adjacent swap at a time.  Each pass is a cheap linear walk, so
+         * freshly decayed priorities take effect within a few housekeeping
+         * ticks rather than after the next full interval. */
+        CMAP_FOR_EACH (cls, node, &pmd->classifiers) {
+            pvector_reprioritize(&cls->subtables, NULL, NULL);
+        }
+        ovs_mutex_unlock(&pmd->flow_mutex);
     }
 }
 
-/* Insert 'rule' into 'cls'. */
-static void
-dpcls_insert(struct dpcls *cls, struct dpcls_rule *rule,
-             const struct netdev_flow_key *mask)
+/* Allocates a rule in 'cls' for 'dp_flow', masking 'flow' with 'mask', and
+ * inserts it into the matching subtable.  Returns the new rule, which lives
+ * in the subtable's arena and is owned by the classifier until
+ * dpcls_remove(). */
+static struct dpcls_rule *
+dpcls_insert(struct dpcls *cls, struct dp_netdev_flow *dp_flow,
+             const struct flow *flow, const struct netdev_flow_key *mask)
 {
     struct dpcls_subtable *subtable = dpcls_find_subtable(cls, mask);
+    struct dpcls_rule *rule = dpcls_arena_alloc(subtable->arena);
 
-    /* Refer to subtable's mask, also for later removal. */
+    /* Refer to subtable's mask, also for later removal.  The subtable's
+     * mask may match on more bits than 'mask' if the flow was adopted into
+     * an existing wider subtable, so the key is masked with the former. */
     rule->mask = &subtable->mask;
+    rule->dp_flow = dp_flow;
+    netdev_flow_key_init_masked(&rule->flow, flow, &subtable->mask);
     cmap_insert(&subtable->rules, &rule->cmap_node, rule->flow.hash);
+    return rule;
 }
 
 /* Removes 'rule' from 'cls', also destructing the 'rule'. */
@@ -8416,13 +10540,22 @@ static void
 dpcls_remove(struct dpcls *cls, struct dpcls_rule *rule)
 {
     struct dpcls_subtable *subtable;
+    bool empty;
 
     ovs_assert(rule->mask);
 
     /* Get subtable from reference in rule->mask. */
     INIT_CONTAINER(subtable, rule->mask, mask);
-    if (cmap_remove(&subtable->rules, &rule->cmap_node, rule->flow.hash)
-        == 0) {
+    empty = cmap_remove(&subtable->rules, &rule->cmap_node, rule->flow.hash)
+            == 0;
+
+    /* Readers may still be probing 'rule', so its arena slot may be reused
+     * only after they have quiesced.  Postponed before the possible subtable
+     * destruction below so that the slot is returned before its arena can go
+     * away. */
+    ovsrcu_postpone(dpcls_arena_free_cb, rule);
+
+    if (empty) {
         /* Delete empty subtable. */
         dpcls_destroy_subtable(cls, subtable);
         pvector_publish(&cls->subtables);
@@ -23,9 +23,11 @@
 
 #include "cmap.h"
 #include "dpif.h"
+#include "dpif-netdev-extract.h"
 #include "dpif-netdev-perf.h"
 #include "dpif-netdev-private.h"
 #include "dpif-provider.h"
+#include "openvswitch/list.h"
 #include "openvswitch/types.h"
 #include "dp-packet.h"
 #include "fat-rwlock.h"
@@ -68,12 +70,13 @@ struct pmd_auto_lb {
  * Signature match cache (SMC)
  *
  * This cache stores a 16-bit signature for each flow without storing keys, and
- * stores the corresponding 16-bit flow_table index to the 'dp_netdev_flow'.
- * Each flow thus occupies 32bit which is much more memory efficient than EMC.
+ * stores the corresponding 32-bit flow_table index to the 'dp_netdev_flow'.
+ * Each flow thus occupies 48bit which is much more memory efficient than EMC.
  * SMC uses a set-associative design that each bucket contains
  * SMC_ENTRY_PER_BUCKET number of entries.
- * Since 16-bit flow_table index is used, if there are more than 2^16
- * dp_netdev_flow, SMC will miss them that cannot be indexed by a 16-bit value.
+ * The number of entries defaults to SMC_DEFAULT_ENTRIES and can be set per
+ * datapath with other_config:smc-entries, so that PMDs carrying millions of
+ * megaflows can keep their hit rate instead of thrashing a fixed table.
  *
  *
  * Thread-safety
@@ -92,14 +95,18 @@ struct pmd_auto_lb {
  * a flow item can occupy. For now, it uses one hash function rather than two
  * as for the EMC design. */
 #define SMC_ENTRY_PER_BUCKET 4
-#define SMC_ENTRIES (1u << 20)
-#define SMC_BUCKET_CNT (SMC_ENTRIES / SMC_ENTRY_PER_BUCKET)
-#define SMC_MASK (SMC_BUCKET_CNT - 1)
+#define SMC_DEFAULT_ENTRIES (1u << 20)
+#define SMC_MIN_ENTRIES (1u << 14)
+#define SMC_MAX_ENTRIES (1u << 26)
+#define SMC_ENTRY_NONE UINT32_MAX
 
 /* Default EMC insert probability is 1 / DEFAULT_EM_FLOW_INSERT_INV_PROB */
 #define DEFAULT_EM_FLOW_INSERT_INV_PROB 100
 #define DEFAULT_EM_FLOW_INSERT_MIN (UINT32_MAX /                     \
                                     DEFAULT_EM_FLOW_INSERT_INV_PROB)
+/* Self-tune the insertion probability per PMD by default; the static
+ * emc-insert-inv-prob knob applies when auto-tuning is disabled. */
+#define DEFAULT_EM_FLOW_INSERT_AUTO true
 
 struct emc_entry {
     struct dp_netdev_flow *flow;
@@ -113,12 +120,13 @@ struct emc_cache {
 
 struct smc_bucket {
     uint16_t sig[SMC_ENTRY_PER_BUCKET];
-    uint16_t flow_idx[SMC_ENTRY_PER_BUCKET];
+    uint32_t flow_idx[SMC_ENTRY_PER_BUCKET]; /* SMC_ENTRY_NONE if free. */
 };
 
 /* Signature match cache, differentiate from EMC cache */
 struct smc_cache {
-    struct smc_bucket buckets[SMC_BUCKET_CNT];
+    struct smc_bucket *buckets;
+    uint32_t bucket_mask;       /* Number of buckets minus one. */
 };
 
 struct dfc_cache {
@@ -126,6 +134,116 @@ struct dfc_cache {
     struct smc_cache smc_cache;
 };
 
+/* Cross-PMD work stealing
+ * =======================
+ *
+ * With other_config:pmd-work-stealing enabled, a PMD whose receive queue
+ * is under sustained pressure publishes full receive bursts on a ring
+ * that idle PMDs drain, so a microburst is absorbed by the sibling
+ * threads instead of queueing behind one saturated core.
+ *
+ * Each PMD owns one ring.  Only the owner produces into it; any other
+ * PMD may consume.  Consumers copy a slot out and then claim it with a
+ * compare-and-swap on 'head', so no locks are taken on either side. */
+
+#define PMD_STEAL_RING_SIZE 16  /* Slots per PMD; must be a power of two. */
+#define PMD_STEAL_RING_MASK (PMD_STEAL_RING_SIZE - 1)
+/* Consecutive full bursts received from one rxq before its PMD starts
+ * offloading further bursts. */
+#define PMD_STEAL_BURST_THRESHOLD 4
+
+struct pmd_steal_slot {
+    struct dp_packet_batch batch;
+    odp_port_t port_no;
+};
+
+struct pmd_steal_ring {
+    /* Next slot to consume; advanced by consumers with CAS. */
+    OVS_ALIGNED_VAR(CACHE_LINE_SIZE) atomic_uint32_t head;
+    /* Next slot to produce; written only by the owning PMD. */
+    OVS_ALIGNED_VAR(CACHE_LINE_SIZE) atomic_uint32_t tail;
+    OVS_ALIGNED_VAR(CACHE_LINE_SIZE)
+        struct pmd_steal_slot slots[PMD_STEAL_RING_SIZE];
+};
+
+/* Flow-hash distributor
+ * =====================
+ *
+ * With other_config:pmd-distributor enabled, a PMD whose receive queue is
+ * under sustained pressure acts as a distributor for that queue: it spreads
+ * each burst over PMD_DIST_CLASSES hash classes by packet RSS hash, keeps
+ * class 0 for itself and publishes the other classes on per-class rings
+ * that worker PMDs drain.  A single heavy flow then occupies at most one
+ * class, so mice sharing its receive queue no longer wait behind it.
+ *
+ * Packets of one flow always map to the same class, and a class ring is
+ * drained by one worker at a time ('consumer' is held for the whole
+ * pop-and-process cycle), so per-flow ordering is preserved without a
+ * reordering stage; only flows in different classes pass each other. */
+
+#define PMD_DIST_CLASSES 4      /* Hash classes; must be a power of two. */
+
+struct pmd_dist_ring {
+    struct pmd_steal_ring ring;
+    /* The PMD currently draining this class, or NULL.  Claimed with CAS
+     * and released only when the claimed bursts are fully processed. */
+    ATOMIC(void *) consumer;
+};
+
+/* uBPF action cache
+ * =================
+ *
+ * Packets handed to a P4 program by dpif-ubpf do not go through the
+ * EMC/SMC above, so dpif-ubpf memoizes the program's verdict per header
+ * vector instead.  An entry only matches if a prefix of the packet, the
+ * packet length, the input port and the program that produced the
+ * verdict are identical - a port running a canary program next to its
+ * production one has two pipelines that may disagree on the same header
+ * vector - so programs whose verdict depends purely on headers skip VM
+ * execution entirely for established flows.  The prefix covers the bytes the program can
+ * actually read - its parse depth proven at load time - and falls back
+ * to UBPF_EMC_KEY_LEN bytes when no bound is known, so an L2/MPLS
+ * pipeline hashes and compares only its few header bytes rather than
+ * the full prefix.  'version' ties an entry to the table state it was
+ * learned from; every control-plane write bumps a global version, which
+ * implicitly invalidates all cached verdicts. */
+
+#define UBPF_EMC_KEY_LEN 128
+#define UBPF_EMC_ENTRIES (1u << EM_FLOW_HASH_SHIFT)
+#define UBPF_EMC_MASK (UBPF_EMC_ENTRIES - 1)
+
+struct ubpf_emc_entry {
+    uint32_t hash;
+    uint32_t version;
+    uint32_t prog_id;             /* Program whose verdict this is. */
+    uint32_t input_port;
+    uint32_t output_port;
+    uint32_t clone_session_id;
+    uint32_t pkt_len;             /* Full packet length, which the program
+                                   * can observe beyond the stored prefix. */
+    uint16_t output_action;
+    uint16_t key_len;             /* 0 if the entry is unused. */
+    uint8_t key[UBPF_EMC_KEY_LEN];
+};
+
+struct ubpf_emc_cache {
+    struct ubpf_emc_entry entries[UBPF_EMC_ENTRIES];
+};
+
+/* Per-PMD cache of the port to P4 program resolution, so that per-batch
+ * dispatch is a direct pointer dereference instead of a cmap walk.  A
+ * PMD polls only a handful of ports, so a tiny direct-mapped table
+ * suffices; entries are revalidated against a global generation counter
+ * that dpif-ubpf bumps whenever any port-to-program binding changes. */
+#define UBPF_PROG_CACHE_SIZE 4
+struct ubpf_prog_cache_entry {
+    uint32_t version;           /* 0 if the slot is empty. */
+    uint32_t port_no;
+    void *prog;                 /* struct dp_prog pointer, may be NULL. */
+    void *canary_prog;          /* Canary program sharing the port, or NULL. */
+    uint8_t canary_pct;         /* Share of traffic for 'canary_prog'. */
+};
+
 /* A set of properties for the current processing loop that is not directly
  * associated with the pmd thread itself, but with the packets being
  * processed or the short-term system configuration (for example, time).
@@ -137,6 +255,13 @@ struct dp_netdev_pmd_thread_ctx {
     struct dp_netdev_rxq *last_rxq;
     /* EMC insertion probability context for the current processing cycle. */
     uint32_t emc_insert_min;
+    /* TSC-derived clock state; see pmd_thread_ctx_time_update(). */
+    uint64_t clock_base_tsc;    /* TSC value at the last calibration. */
+    long long clock_base_us;    /* time_usec() at the last calibration. */
+    uint64_t clock_check_tsc;   /* Recalibrate once the TSC passes this. */
+    uint64_t us_per_tsc_q32;    /* Microseconds per TSC tick in Q32 fixed
+                                 * point, or zero to fall back to reading
+                                 * the system clock on every update. */
 };
 
 /* PMD: Poll modes drivers.  PMD accesses devices via polling to eliminate
@@ -157,6 +282,8 @@ struct dp_netdev_pmd_thread_ctx {
  * corresponding classifier of port.  Packets are executed with the found
  * actions in either case.
  * */
+struct ubpf_packetin_ring;
+
 struct dp_netdev_pmd_thread {
     struct dp_netdev *dp;
     struct ovs_refcount ref_cnt;    /* Every reference must be refcount'ed. */
@@ -183,6 +310,41 @@ struct dp_netdev_pmd_thread {
     struct ovs_mutex action_mutex;
     struct cmap action_table OVS_GUARDED;
 
+    /* Memoized uBPF program verdicts.  Allocated by dpif-ubpf on first
+     * use, so OpenFlow-only datapaths do not pay for it. */
+    struct ubpf_emc_cache *ubpf_emc;
+
+    /* Per-port program dispatch cache, maintained by dpif-ubpf. */
+    struct ubpf_prog_cache_entry ubpf_prog_cache[UBPF_PROG_CACHE_SIZE];
+
+    /* Ring of packets punted toward the controller, created by dpif-ubpf
+     * on the first PacketIn this thread produces (see ubpf_packetin.h). */
+    struct ubpf_packetin_ring *ubpf_packetin;
+
+    /* Optimized miniflow extraction implementation for this thread, or
+     * NULL to call the scalar miniflow_extract() directly.  Written by the
+     * main thread, read by the pmd thread. */
+    ATOMIC(miniflow_extract_func) miniflow_extract_opt;
+
+    /* Receive bursts offered up to idle PMDs when work stealing is
+     * enabled.  Produced into only by this thread. */
+    struct pmd_steal_ring steal_ring;
+
+    /* Per-hash-class bursts offered to worker PMDs when this thread acts
+     * as a distributor (pmd-distributor).  Class 0 is processed locally
+     * and has no ring; produced into only by this thread. */
+    struct pmd_dist_ring dist_rings[PMD_DIST_CLASSES];
+
+    /* Flows whose stats this thread has accumulated locally but not yet
+     * folded into the shared per-flow counters.  Only this thread touches
+     * the list; each flow on it holds a reference. */
+    struct ovs_list pending_stats_flows;
+
+    /* Per-meter token shards ("struct dp_meter_shard"s), keyed on meter id.
+     * Only this thread touches the map; the shards borrow tokens from the
+     * shared meters and are reconciled with them under the meter locks. */
+    struct hmap meter_shards;
+
     /* One classifier per in_port polled by the pmd */
     struct cmap classifiers;
     /* Periodically sort subtable vectors according to hit frequencies */
@@ -196,6 +358,17 @@ struct dp_netdev_pmd_thread {
     /* Last interval cycles. */
     atomic_ullong intrvl_cycles;
 
+    /* Self-tuned EMC insertion threshold (see emc-insert-auto).  Adjusted
+     * by the PMD thread itself from the measured EMC hit rate and copied
+     * into 'ctx.emc_insert_min' each iteration while auto-tuning is on. */
+    struct {
+        uint32_t min;           /* Current insertion threshold. */
+        uint64_t last_hits;     /* PMD_STAT_EXACT_HIT at last adjustment. */
+        uint64_t last_pkts;     /* PMD_STAT_RECV at last adjustment. */
+        double last_hit_rate;   /* EMC hit rate over the last interval. */
+        bool increasing;        /* Direction of the last adjustment. */
+    } emc_tuner;
+
     /* Current context of the PMD thread. */
     struct dp_netdev_pmd_thread_ctx ctx;
 
@@ -340,10 +513,43 @@ struct dp_netdev {
 
     /* Probability of EMC insertions is a factor of 'emc_insert_min'.*/
     OVS_ALIGNED_VAR(CACHE_LINE_SIZE) atomic_uint32_t emc_insert_min;
+    /* Self-tune the insertion probability per PMD from the measured EMC
+     * hit rate instead of using 'emc_insert_min' (emc-insert-auto). */
+    atomic_bool emc_insert_auto;
     /* Enable collection of PMD performance metrics. */
     atomic_bool pmd_perf_metrics;
     /* Enable the SMC cache from ovsdb config */
     atomic_bool smc_enable_db;
+    /* Number of SMC entries per PMD thread, from ovsdb config.  PMD
+     * threads resize their cache when they notice a change. */
+    atomic_uint32_t smc_n_entries;
+    /* Enable cross-PMD work stealing from ovsdb config */
+    atomic_bool pmd_work_stealing;
+    /* Spread pressured receive queues over worker PMDs by flow hash
+     * (other_config:pmd-distributor). */
+    atomic_bool pmd_distributor;
+    /* Enable software GRO on received batches from ovsdb config.  Only
+     * honored when userspace TSO is enabled, since coalesced packets rely
+     * on the egress paths segmenting them again. */
+    atomic_bool gro_enable;
+    /* Answer ARP requests and neighbor solicitations for local tunnel
+     * endpoint addresses directly on the PMD instead of taking the upcall
+     * path (other_config:tnl-neigh-responder). */
+    atomic_bool tnl_neigh_responder;
+
+    /* Longest time in microseconds an idle PMD may sleep between polling
+     * rounds (other_config:pmd-max-sleep).  Zero keeps PMDs busy-polling. */
+    atomic_uint64_t pmd_max_sleep;
+
+    /* Tx flusher thread (see other_config:pmd-tx-flusher).  When enabled,
+     * PMDs hand transmit bursts for ports with fewer tx queues than
+     * threads to per-port rings instead of contending on the XPS queue
+     * lock; the flusher thread drains the rings. */
+    atomic_bool tx_flusher_enabled;
+    struct cmap tx_rings;       /* Contains "struct dp_tx_ring"s. */
+    pthread_t tx_flusher;       /* Only valid if 'tx_flusher_running'. */
+    bool tx_flusher_running;    /* Protected by dp_netdev_mutex. */
+    atomic_bool tx_flusher_exit;
 
     /* Protects access to ofproto-dpif-upcall interface during revalidator
      * thread synchronization. */
@@ -397,10 +603,13 @@ struct dpif_netdev {
     uint64_t last_port_seq;
 };
 
+struct dp_tx_ring;
+
 /* A port in a netdev-based datapath. */
 struct dp_netdev_port {
     odp_port_t port_no;
     bool dynamic_txqs;          /* If true XPS will be used. */
+    struct dp_tx_ring *tx_ring; /* Tx ring in dp's 'tx_rings', or NULL. */
     bool need_reconfigure;      /* True if we should reconfigure netdev. */
     struct netdev *netdev;
     struct hmap_node node;      /* Node in dp_netdev's 'ports'. */
@@ -484,6 +693,7 @@ int construct_dp_netdev(const char *name, const struct dpif_class *class,
 void dp_netdev_execute_actions(struct dp_netdev_pmd_thread *pmd,
                           struct dp_packet_batch *packets,
                           bool should_steal, const struct flow *flow,
+                          struct dp_netdev_flow *dp_flow,
                           const struct nlattr *actions, size_t actions_len);
 
 
@@ -1526,6 +1526,14 @@ dpif_netlink_flow_dump_destroy(struct dpif_flow_dump *dump_)
     return dump_status ? dump_status : nl_status;
 }
 
+/* The kernel sizes each flow dump chunk up to the reader's receive buffer,
+ * so a single chunk can span several pages.  Sizing the per-thread reply
+ * buffer to nl_sock_recv__()'s maximum message length lets every recv under
+ * the shared nl_dump land a whole chunk directly in this buffer, instead of
+ * growing it with a copy through a stack bounce buffer, and hands each
+ * dumping thread a few hundred flows to parse per socket access. */
+#define FLOW_DUMP_BUFSIZE (64 * 1024)
+
 struct dpif_netlink_flow_dump_thread {
     struct dpif_flow_dump_thread up;
     struct dpif_netlink_flow_dump *dump;
@@ -1557,7 +1565,7 @@ dpif_netlink_flow_dump_thread_create(struct dpif_flow_dump *dump_)
     thread = xmalloc(sizeof *thread);
     dpif_flow_dump_thread_init(&thread->up, &dump->up);
     thread->dump = dump;
-    ofpbuf_init(&thread->nl_flows, NL_DUMP_BUFSIZE);
+    ofpbuf_init(&thread->nl_flows, FLOW_DUMP_BUFSIZE);
     thread->nl_actions = NULL;
     thread->netdev_dump_idx = 0;
     thread->netdev_done = !(thread->netdev_dump_idx < dump->netdev_dumps_num);
@@ -1662,6 +1670,17 @@ dpif_netlink_netdev_match_to_dpif_flow(struct match *match,
         };
         size_t offset;
 
+        /* Reserve space for the key and the mask before taking tail pointers
+         * into the buffers, so that encoding the attributes in place cannot
+         * reallocate the buffers and leave 'flow->key' or 'flow->mask'
+         * dangling. */
+        if (key_buf == mask_buf) {
+            ofpbuf_prealloc_tailroom(key_buf, 2 * ODPUTIL_FLOW_KEY_BYTES);
+        } else {
+            ofpbuf_prealloc_tailroom(key_buf, ODPUTIL_FLOW_KEY_BYTES);
+            ofpbuf_prealloc_tailroom(mask_buf, ODPUTIL_FLOW_KEY_BYTES);
+        }
+
         /* Key */
         offset = key_buf->size;
         flow->key = ofpbuf_tail(key_buf);
@@ -4064,6 +4083,14 @@ const struct dpif_class dpif_netlink_class = {
     NULL,
     NULL,
     NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
 };
 
 static int
@@ -640,7 +640,7 @@ struct dpif_class {
 
     int (*dp_table_entry_add)(struct dpif *, uint32_t prog_id,
                               uint32_t table_id,
-                              uint32_t action_id,
+                              uint32_t action_id, uint32_t priority,
                               const char *match_key, size_t key_size,
                               const char *action_data, size_t data_size);
 
@@ -660,9 +660,51 @@ struct dpif_class {
                           struct ovs_list *entries);
 
     int (*dp_table_entry_del)(struct dpif *, uint32_t prog_id,
-                               uint32_t table_id,
+                               uint32_t table_id, uint32_t priority,
                                const char *match_key,
                                size_t key_size);
+
+    /* Installs every 'struct p4rtutil_table_entry' on 'entries' in one
+     * call, so loading a large table costs one descent into the datapath
+     * instead of one per entry.  Stops at the first entry that fails and
+     * returns its error.  Optional; callers fall back to per-entry
+     * dp_table_entry_add() when NULL. */
+    int (*dp_table_entry_add_batch)(struct dpif *, uint32_t prog_id,
+                                    struct ovs_list *entries);
+
+    /* Snapshots every value of counter 'counter_id' (a P4Info id) of
+     * program 'prog_id' in a single pass, so that polling a full
+     * counter array costs one traversal instead of one datapath round
+     * trip per index.  On success, '*valuesp' points to a malloc'd
+     * array of '*n_valuesp' counts widened to 64 bits, indexed by
+     * counter index; the caller takes ownership.  Optional. */
+    int (*dp_counter_query)(struct dpif *, uint32_t prog_id,
+                            uint32_t counter_id, uint64_t **valuesp,
+                            size_t *n_valuesp);
+
+    /* Action profile operations backing P4 action selectors.  A member
+     * carries one action; a group selects among its members per packet.
+     * Member and group handles are allocated by the datapath and
+     * returned through the out parameters.  Optional as a set. */
+    int (*dp_act_prof_member_create)(struct dpif *, uint32_t prog_id,
+                                     uint32_t act_prof_id, uint32_t action_id,
+                                     const char *action_data,
+                                     size_t data_size, uint32_t *mbr_handle);
+    int (*dp_act_prof_member_modify)(struct dpif *, uint32_t prog_id,
+                                     uint32_t act_prof_id,
+                                     uint32_t mbr_handle, uint32_t action_id,
+                                     const char *action_data,
+                                     size_t data_size);
+    int (*dp_act_prof_member_del)(struct dpif *, uint32_t prog_id,
+                                  uint32_t act_prof_id, uint32_t mbr_handle);
+    int (*dp_act_prof_group_create)(struct dpif *, uint32_t prog_id,
+                                    uint32_t act_prof_id,
+                                    uint32_t *grp_handle);
+    int (*dp_act_prof_group_set)(struct dpif *, uint32_t prog_id,
+                                 uint32_t act_prof_id, uint32_t grp_handle,
+                                 const uint32_t *mbr_handles, size_t n_mbrs);
+    int (*dp_act_prof_group_del)(struct dpif *, uint32_t prog_id,
+                                 uint32_t act_prof_id, uint32_t grp_handle);
 };
 
 extern const struct dpif_class dpif_netlink_class;
@@ -16,16 +16,28 @@
 #include <errno.h>
 
 #include "bpf.h"
+#include "bpf/ubpf_act_prof.h"
+#include "bpf/ubpf_expiry.h"
+#include "bpf/ubpf_packetin.h"
+#include "bpf/ubpf_range.h"
+#include "bpf/ubpf_ternary.h"
 #include "dpif-netdev.h"
 #include "dpif-provider.h"
 #include "netdev-vport.h"
 #include "odp-util.h"
+#include "openvswitch/dynamic-string.h"
 #include "openvswitch/shash.h"
 #include "openvswitch/util.h"
 #include "openvswitch/vlog.h"
 #include "ovs-atomic.h"
 #include "p4rt-objects.h"
+#include "p4rt-arena.h"
+#include "p4rt-offload.h"
+#include "p4rt-pre.h"
+#include "sha1.h"
 #include "smap.h"
+#include "unixctl.h"
+#include "util.h"
 
 VLOG_DEFINE_THIS_MODULE(dpif_ubpf);
 
@@ -34,17 +46,41 @@ VLOG_DEFINE_THIS_MODULE(dpif_ubpf);
 /* ## --------------------------------------- ## */
 
 struct dp_prog {
-    struct cmap_node cmap_node; /* Within dp_ubpf.dp_progs_port_map */
-
     uint32_t id;
     struct ubpf_vm *vm;
+    uint8_t elf_sha1[SHA1_DIGEST_SIZE]; /* Of the ELF 'vm' was built from. */
 
     const pi_p4info_t *p4info;
 
     struct hmap table_ids;   /* Provide mapping between table IDs used by Control Plane API and uBPF */
     struct hmap action_ids;  /* Provide mapping between action IDs used by Control Plane API and uBPF */
+    struct hmap action_ids_by_dp; /* Same nodes as 'action_ids', indexed by
+                                   * the uBPF action id for reverse lookup. */
 
     bool default_action_set; /* Indicate if default action has been set. */
+
+    /* Datapath cost of this pipeline, for A/B comparison between the
+     * programs sharing a port: packets that actually ran through the VM
+     * (action-cache hits are excluded, they cost the same for every
+     * program) and the TSC cycles those runs took. */
+    atomic_uint64_t n_vm_packets;
+    atomic_uint64_t n_vm_cycles;
+};
+
+/* Binds a port to its P4 program.  PMD threads follow 'prog' locklessly,
+ * so replacing a program is a single RCU pointer store and the old
+ * program is destroyed only after all readers have quiesced. */
+struct dp_prog_mapping {
+    struct cmap_node cmap_node; /* Within dp_ubpf.dp_progs_port_map. */
+    odp_port_t port_no;
+    OVSRCU_TYPE(struct dp_prog *) prog;
+
+    /* Candidate program taking a hash-selected slice of this port's
+     * traffic for A/B testing, or NULL.  'canary_pct' is the share of
+     * packets, 0-100; PMDs read it locklessly, so it only ever holds a
+     * value that is valid on its own. */
+    OVSRCU_TYPE(struct dp_prog *) canary_prog;
+    uint8_t canary_pct;
 };
 
 struct dp_ubpf {
@@ -81,7 +117,8 @@ struct dpif_table_id {
 };
 
 struct dpif_action_id {
-    struct hmap_node hmap_node;
+    struct hmap_node hmap_node;    /* In dp_prog's 'action_ids'. */
+    struct hmap_node dp_hmap_node; /* In dp_prog's 'action_ids_by_dp'. */
     uint32_t action_id;
     uint32_t dp_action_id;
 };
@@ -104,6 +141,27 @@ static struct ovs_mutex dp_prog_mutex = OVS_MUTEX_INITIALIZER;
  * According to PI library 256 is the maximum number of P4 devices. */
 static struct dp_prog *dp_progs[256] = { };
 
+/* Set to false through other_config:ubpf-emc-enable to bypass the per-PMD
+ * uBPF action cache, e.g. for P4 programs whose verdict depends on packet
+ * payload or on per-packet state such as registers. */
+static atomic_bool ubpf_emc_enabled = ATOMIC_VAR_INIT(true);
+
+/* Scratch space for staging table entries on their way into a map.  The
+ * translated key and packed value live only until ubpf_map_update() has
+ * copied them, so they come from an arena that is reset wholesale after
+ * each install: in steady state a write burst never touches malloc. */
+static struct ovs_mutex dp_staging_mutex = OVS_MUTEX_INITIALIZER;
+static struct p4rt_arena dp_staging_arena OVS_GUARDED_BY(dp_staging_mutex)
+    = P4RT_ARENA_INITIALIZER;
+
+/* Bumped on every control-plane write so that memoized program verdicts
+ * from before the write no longer match. */
+static atomic_count ubpf_tables_version = ATOMIC_COUNT_INIT(1);
+
+/* Bumped whenever a port-to-program binding changes; PMD dispatch
+ * caches revalidate against it. */
+static atomic_count ubpf_progs_version = ATOMIC_COUNT_INIT(1);
+
 /* ## ------------------------- ## */
 /* ## Prototypes for functions. ## */
 /* ## ------------------------- ## */
@@ -136,6 +194,7 @@ translate_table_id(struct dp_prog *prog, uint32_t *table_id)
                              &prog->table_ids) {
         if (tbl->table_id == id) {
             *table_id = tbl->dp_table_id;
+            break;
         }
     }
 
@@ -152,6 +211,7 @@ translate_action_id(struct dp_prog *prog, uint32_t *action_id)
                              &prog->action_ids) {
         if (act->action_id == id) {
             *action_id = act->dp_action_id;
+            break;
         }
     }
 
@@ -163,7 +223,8 @@ get_p4info_action_id(struct dp_prog *prog, uint32_t action_id)
 {
     struct dpif_action_id *act;
 
-    HMAP_FOR_EACH (act, hmap_node, &prog->action_ids) {
+    HMAP_FOR_EACH_WITH_HASH (act, dp_hmap_node, hash_int(action_id, 0),
+                             &prog->action_ids_by_dp) {
         if (act->dp_action_id == action_id) {
             return act->action_id;
         }
@@ -172,6 +233,22 @@ get_p4info_action_id(struct dp_prog *prog, uint32_t action_id)
     return 0;
 }
 
+/* Invalidates all memoized uBPF program verdicts.  Must be called after
+ * every write that can change what a program does with a packet. */
+static void
+ubpf_emc_invalidate(void)
+{
+    atomic_count_inc(&ubpf_tables_version);
+}
+
+/* Invalidates every PMD's port-to-program dispatch cache.  Must be
+ * called after every change to a port binding or installed program. */
+static void
+ubpf_progs_invalidate(void)
+{
+    atomic_count_inc(&ubpf_progs_version);
+}
+
 static const char*
 replace_char(const char* str, char find, char replace){
     char *current_pos = strchr(str,find);
@@ -274,57 +351,408 @@ packet_batch_per_action_execute(struct packet_batch_per_action *batch,
         return;
     }
 
-    dp_netdev_execute_actions(pmd, &batch->output_batch, false, NULL,
+    dp_netdev_execute_actions(pmd, &batch->output_batch, false, NULL, NULL,
                               act, act->nla_len);
     dp_packet_batch_init(&batch->output_batch);
 }
 
+/* Probes the uBPF action cache for 'packet'.  Returns the candidate slot
+ * and sets '*hit' to true if it holds a verdict for this header vector
+ * learned from the current table version.  'key_cap' is the program's
+ * parse depth, so the probe hashes and compares only the bytes the
+ * program can read; the packet length is matched separately since the
+ * program observes it through the standard metadata.  'prog_id' is
+ * matched too: a port carrying a canary split runs two programs whose
+ * verdicts for the same header vector may differ.  On a miss the
+ * computed hash is left in the slot for ubpf_emc_insert() to complete
+ * after the program has run. */
+static inline struct ubpf_emc_entry *
+ubpf_emc_probe(struct ubpf_emc_cache *cache, struct dp_packet *packet,
+               odp_port_t in_port, uint32_t version, uint16_t key_cap,
+               uint32_t prog_id, bool *hit)
+{
+    uint16_t key_len = MIN(dp_packet_size(packet), key_cap);
+    const void *data = dp_packet_data(packet);
+    uint32_t hash = hash_bytes(data, key_len, odp_to_u32(in_port));
+    struct ubpf_emc_entry *entry = &cache->entries[hash & UBPF_EMC_MASK];
+
+    *hit = entry->key_len == key_len
+           && entry->hash == hash
+           && entry->version == version
+           && entry->prog_id == prog_id
+           && entry->input_port == odp_to_u32(in_port)
+           && entry->pkt_len == dp_packet_size(packet)
+           && !memcmp(entry->key, data, key_len);
+    if (!*hit) {
+        entry->hash = hash;
+    }
+    return entry;
+}
+
+static inline void
+ubpf_emc_insert(struct ubpf_emc_entry *entry, struct dp_packet *packet,
+                odp_port_t in_port, const struct standard_metadata *std_meta,
+                uint32_t version, uint16_t key_cap, uint32_t prog_id)
+{
+    entry->key_len = MIN(dp_packet_size(packet), key_cap);
+    entry->pkt_len = dp_packet_size(packet);
+    memcpy(entry->key, dp_packet_data(packet), entry->key_len);
+    entry->version = version;
+    entry->prog_id = prog_id;
+    entry->input_port = odp_to_u32(in_port);
+    entry->output_port = std_meta->output_port;
+    entry->output_action = std_meta->output_action;
+    entry->clone_session_id = std_meta->clone_session_id;
+}
+
+/* Replicates 'packet' to every egress port of multicast group 'grp_id'
+ * and consumes it.  Each replica joins the same per-port output batch
+ * that unicast REDIRECT verdicts use, so a 16-way multicast adds 16
+ * packets to (at most) 16 batches rather than 16 separate sends.  The
+ * original buffer is reused for the final replica, so a group of N
+ * ports costs N - 1 copies; an empty or unknown group drops the
+ * packet. */
+static inline void
+ubpf_multicast_replicate(struct dp_netdev_pmd_thread *pmd,
+                         struct dp_packet *packet, uint32_t grp_id)
+{
+    const struct p4rt_pre_ports *grp = p4rt_pre_group_lookup(grp_id);
+    size_t n = grp ? grp->n_ports : 0;
+
+    if (OVS_UNLIKELY(!n)) {
+        dp_packet_delete(packet);
+        return;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        struct dp_packet *copy
+            = i < n - 1
+              ? dp_packet_clone_with_headroom(packet,
+                                              dp_packet_headroom(packet))
+              : packet;
+        uint32_t port = grp->ports[i];
+        uint32_t hash = hash_2words(REDIRECT, port);
+        struct dp_netdev_action_flow *act_flow;
+
+        act_flow = get_dp_netdev_action_flow(pmd, hash);
+        if (OVS_UNLIKELY(!act_flow)) {
+            act_flow = dp_netdev_action_flow_init(pmd, REDIRECT, &port, hash);
+        }
+        dp_netdev_queue_action_batches(copy, act_flow);
+    }
+}
+
+/* Mirrors 'packet' to every egress port of clone session 'session_id'.
+ * Unlike multicast the original is not consumed: it continues along its
+ * own verdict.  The mirrors inherit the verdict already computed for
+ * the original, so a clone session never re-enters the VM - no second
+ * parse, no second table walk. */
+static inline void
+ubpf_clone_replicate(struct dp_netdev_pmd_thread *pmd,
+                     struct dp_packet *packet, uint32_t session_id)
+{
+    const struct p4rt_pre_ports *session;
+
+    session = p4rt_pre_clone_session_lookup(session_id);
+    if (OVS_UNLIKELY(!session)) {
+        return;
+    }
+
+    for (size_t i = 0; i < session->n_ports; i++) {
+        struct dp_packet *copy
+            = dp_packet_clone_with_headroom(packet,
+                                            dp_packet_headroom(packet));
+        uint32_t port = session->ports[i];
+        uint32_t hash = hash_2words(REDIRECT, port);
+        struct dp_netdev_action_flow *act_flow;
+
+        act_flow = get_dp_netdev_action_flow(pmd, hash);
+        if (OVS_UNLIKELY(!act_flow)) {
+            act_flow = dp_netdev_action_flow_init(pmd, REDIRECT, &port, hash);
+        }
+        dp_netdev_queue_action_batches(copy, act_flow);
+    }
+}
+
+/* Punts 'packet' toward the controller as a P4Runtime PacketIn and
+ * consumes it.  A malloc-backed copy goes on this PMD's ring, so the
+ * delivery thread never frees into a PMD's mbuf pool; a full ring drops
+ * the copy rather than stall the datapath. */
+static inline void
+ubpf_packet_in_punt(struct dp_netdev_pmd_thread *pmd,
+                    struct dp_packet *packet, odp_port_t in_port,
+                    uint32_t prog_id)
+{
+    if (OVS_UNLIKELY(!pmd->ubpf_packetin)) {
+        pmd->ubpf_packetin = ubpf_packetin_ring_create();
+    }
+    ubpf_packetin_push(pmd->ubpf_packetin, prog_id, odp_to_u32(in_port),
+                       dp_packet_clone(packet));
+    dp_packet_delete(packet);
+}
+
 static struct dp_prog *
-get_dp_prog(struct dp_ubpf *dp, odp_port_t in_port)
+get_dp_prog(struct dp_netdev_pmd_thread *pmd, struct dp_ubpf *dp,
+            odp_port_t in_port, struct dp_prog **canaryp,
+            uint8_t *canary_pctp)
 {
-    struct dp_prog *prog;
-    const struct cmap_node *node;
+    struct ubpf_prog_cache_entry *entry;
+    struct dp_prog_mapping *mapping;
+    struct dp_prog *prog = NULL;
+    struct dp_prog *canary = NULL;
+    uint8_t canary_pct = 0;
+    uint32_t port = odp_to_u32(in_port);
+    uint32_t version = atomic_count_get(&ubpf_progs_version);
+    uint32_t hash;
 
-    uint32_t hash = hash_int(odp_to_u32(in_port), 0);
-    node = cmap_find(&dp->dp_progs_port_map, hash);
-    if (!node) {
-        return NULL;
+    /* A PMD polls the same few ports over and over, so nearly every
+     * batch resolves from this direct-mapped cache without touching the
+     * shared cmap.  The cached pointers are safe to use for as long as
+     * the version matches: any program swap bumps the version before
+     * the old program is put on the RCU free list. */
+    entry = &pmd->ubpf_prog_cache[port & (UBPF_PROG_CACHE_SIZE - 1)];
+    if (OVS_LIKELY(entry->version == version && entry->port_no == port)) {
+        *canaryp = entry->canary_prog;
+        *canary_pctp = entry->canary_pct;
+        return entry->prog;
     }
 
-    prog = CONTAINER_OF(node, struct dp_prog, cmap_node);
+    hash = hash_int(port, 0);
+    CMAP_FOR_EACH_WITH_HASH (mapping, cmap_node, hash,
+                             &dp->dp_progs_port_map) {
+        if (mapping->port_no == in_port) {
+            prog = ovsrcu_get(struct dp_prog *, &mapping->prog);
+            canary = ovsrcu_get(struct dp_prog *, &mapping->canary_prog);
+            canary_pct = mapping->canary_pct;
+            break;
+        }
+    }
+    if (!canary || !canary_pct || canary == prog) {
+        canary = NULL;
+        canary_pct = 0;
+    }
 
+    entry->port_no = port;
+    entry->prog = prog;
+    entry->canary_prog = canary;
+    entry->canary_pct = canary_pct;
+    entry->version = version;
+
+    *canaryp = canary;
+    *canary_pctp = canary_pct;
     return prog;
 }
 
+/* Places the P4 standard metadata for 'packet' inside the packet's own
+ * headroom, just ahead of the frame, so the VM reads and mutates it in
+ * the buffer it already owns - no copy in, no copy of the verdict back
+ * out.  Rounded down so the uint32_t members stay naturally aligned.
+ * Only usable for programs that never call ubpf_adjust_head(): an encap
+ * push grows the frame into the headroom (and may even reallocate the
+ * buffer), which would clobber or dangle the metadata.  Packets without
+ * enough headroom fall back to 'fallback'. */
+static inline struct standard_metadata *
+ubpf_std_meta(struct dp_packet *packet, bool meta_in_buf,
+              struct standard_metadata *fallback)
+{
+    void *data = dp_packet_data(packet);
+    uintptr_t p = (uintptr_t) data;
+
+    if (OVS_LIKELY(meta_in_buf
+                   && dp_packet_headroom(packet)
+                      >= sizeof(struct standard_metadata) + 3)) {
+        return (void *) ROUND_DOWN(p - sizeof(struct standard_metadata), 4);
+    }
+    return fallback;
+}
+
+/* Decides whether 'packet' goes to the port's canary program.  The
+ * split is a deterministic function of the flow - the NIC's RSS hash
+ * when there is one, a hash over the start of the frame otherwise - so
+ * every packet of a flow hits the same pipeline: per-flow ordering is
+ * preserved across the split and stateful pipelines never see half a
+ * flow. */
+static inline bool
+ubpf_canary_select(struct dp_packet *packet, uint8_t pct)
+{
+    uint32_t hash;
+
+    if (OVS_LIKELY(dp_packet_rss_valid(packet))) {
+        hash = dp_packet_get_rss_hash(packet);
+    } else {
+        hash = hash_bytes(dp_packet_data(packet),
+                          MIN(dp_packet_size(packet), 64), 0);
+    }
+    return hash % 100 < pct;
+}
+
+/* Runs 'n' action-cache misses through 'prog' and charges the cost to
+ * the program's A/B counters.  One TSC read brackets each side of the
+ * whole sub-batch, so the accounting costs two reads per batch, not two
+ * per packet. */
+static inline void
+ubpf_run_prog_batch(struct dp_netdev_pmd_thread *pmd, struct dp_prog *prog,
+                    struct ubpf_batch_entry *entries, size_t n)
+{
+    uint64_t start = cycles_counter_update(&pmd->perf_stats);
+    uint64_t orig;
+
+    ubpf_handle_packet_batch(prog->vm, entries, n);
+
+    atomic_add_relaxed(&prog->n_vm_cycles,
+                       cycles_counter_update(&pmd->perf_stats) - start,
+                       &orig);
+    atomic_add_relaxed(&prog->n_vm_packets, (uint64_t) n, &orig);
+}
+
 static inline void
 protocol_independent_processing(struct dp_netdev_pmd_thread *pmd,
                                 struct dp_packet_batch *packets_,
                                 odp_port_t in_port)
 {
     struct dp_ubpf *dp = dp_ubpf_cast(pmd->dp);
+    struct dp_prog *canary;
+    uint8_t canary_pct;
 
-    struct dp_prog *prog = get_dp_prog(dp, in_port);
+    struct dp_prog *prog = get_dp_prog(pmd, dp, in_port, &canary,
+                                       &canary_pct);
     if (OVS_LIKELY(prog)) {
+        struct standard_metadata fallback_metas[NETDEV_MAX_BURST];
+        struct standard_metadata *std_metas[NETDEV_MAX_BURST];
+        struct ubpf_batch_entry entries[NETDEV_MAX_BURST];
+        struct ubpf_emc_entry *emc_entries[NETDEV_MAX_BURST];
+        struct ubpf_batch_entry canary_entries[NETDEV_MAX_BURST];
+        struct ubpf_emc_entry *canary_emc_entries[NETDEV_MAX_BURST];
+        uint32_t version = atomic_count_get(&ubpf_tables_version);
+        size_t n_misses = 0;
+        size_t n_canary = 0;
         struct dp_packet *packet;
+        bool use_emc;
+
+        atomic_read_relaxed(&ubpf_emc_enabled, &use_emc);
+        if (OVS_UNLIKELY(use_emc && !pmd->ubpf_emc)) {
+            pmd->ubpf_emc = xzalloc(sizeof *pmd->ubpf_emc);
+        }
+
+        /* Resolve what we can from the action cache; hand the remaining
+         * packets to the VM in one invocation per program so that the
+         * entry/exit cost is paid once per batch rather than per packet.
+         * The cache key only needs to cover the bytes the program can
+         * read, so a program with a proven parse depth hashes and
+         * compares just that prefix; with a canary split the two
+         * programs carry their own parse depths. */
+        bool meta_in_buf = !prog->vm->uses_adjust_head
+                           && !(canary && canary->vm->uses_adjust_head);
+        uint16_t emc_key_cap = prog->vm->parse_depth
+                               ? MIN(prog->vm->parse_depth, UBPF_EMC_KEY_LEN)
+                               : UBPF_EMC_KEY_LEN;
+        uint16_t canary_key_cap
+            = canary && canary->vm->parse_depth
+              ? MIN(canary->vm->parse_depth, UBPF_EMC_KEY_LEN)
+              : UBPF_EMC_KEY_LEN;
 
         DP_PACKET_BATCH_FOR_EACH (i, packet, packets_) {
+            bool to_canary = OVS_UNLIKELY(canary != NULL)
+                             && ubpf_canary_select(packet, canary_pct);
 
-            struct standard_metadata std_meta = {
+            std_metas[i] = ubpf_std_meta(packet, meta_in_buf,
+                                         &fallback_metas[i]);
+            *std_metas[i] = (struct standard_metadata) {
                     .input_port = odp_to_u32(in_port),
+                    .packet_length = dp_packet_size(packet),
                     .output_action = ABORT,  /* ABORT packet by default. */
                     .output_port = 0,
+                    .clone_session_id = 0,
             };
 
-            ubpf_handle_packet(prog->vm, &std_meta, packet);
+            if (use_emc) {
+                bool hit;
+                struct ubpf_emc_entry *entry;
+
+                entry = ubpf_emc_probe(pmd->ubpf_emc, packet, in_port,
+                                       version,
+                                       to_canary ? canary_key_cap
+                                                 : emc_key_cap,
+                                       to_canary ? canary->id : prog->id,
+                                       &hit);
+                if (OVS_LIKELY(hit)) {
+                    std_metas[i]->output_action = entry->output_action;
+                    std_metas[i]->output_port = entry->output_port;
+                    std_metas[i]->clone_session_id = entry->clone_session_id;
+                    continue;
+                }
+                if (to_canary) {
+                    canary_emc_entries[n_canary] = entry;
+                } else {
+                    emc_entries[n_misses] = entry;
+                }
+            }
+            if (to_canary) {
+                canary_entries[n_canary].mem = packet;
+                canary_entries[n_canary].md = std_metas[i];
+                n_canary++;
+            } else {
+                entries[n_misses].mem = packet;
+                entries[n_misses].md = std_metas[i];
+                n_misses++;
+            }
+        }
+
+        if (n_misses) {
+            ubpf_run_prog_batch(pmd, prog, entries, n_misses);
+
+            if (use_emc) {
+                for (size_t j = 0; j < n_misses; j++) {
+                    ubpf_emc_insert(emc_entries[j], entries[j].mem, in_port,
+                                    entries[j].md, version, emc_key_cap,
+                                    prog->id);
+                }
+            }
+        }
+        if (OVS_UNLIKELY(n_canary)) {
+            ubpf_run_prog_batch(pmd, canary, canary_entries, n_canary);
+
+            if (use_emc) {
+                for (size_t j = 0; j < n_canary; j++) {
+                    ubpf_emc_insert(canary_emc_entries[j],
+                                    canary_entries[j].mem, in_port,
+                                    canary_entries[j].md, version,
+                                    canary_key_cap, canary->id);
+                }
+            }
+        }
+
+        DP_PACKET_BATCH_FOR_EACH (i, packet, packets_) {
+            struct standard_metadata *std_meta = std_metas[i];
+
+            if (OVS_UNLIKELY(std_meta->clone_session_id)) {
+                ubpf_clone_replicate(pmd, packet, std_meta->clone_session_id);
+            }
+
+            if (OVS_UNLIKELY(std_meta->output_action == MULTICAST)) {
+                ubpf_multicast_replicate(pmd, packet, std_meta->output_port);
+                continue;
+            }
+
+            if (OVS_UNLIKELY(std_meta->output_action == PASS)) {
+                /* The split is deterministic, so re-selecting here
+                 * attributes the PacketIn to the program that actually
+                 * punted it. */
+                ubpf_packet_in_punt(pmd, packet, in_port,
+                                    canary
+                                    && ubpf_canary_select(packet, canary_pct)
+                                    ? canary->id : prog->id);
+                continue;
+            }
 
             /* To simplify we hash two words (output_action, output_port) regardless of the action. */
-            uint32_t hash = hash_2words(std_meta.output_action,
-                                        std_meta.output_port);
+            uint32_t hash = hash_2words(std_meta->output_action,
+                                        std_meta->output_port);
             struct dp_netdev_action_flow *act_flow;
             act_flow = get_dp_netdev_action_flow(pmd, hash);
             if (OVS_UNLIKELY(!act_flow)) {
                 act_flow = dp_netdev_action_flow_init(pmd,
-                      std_meta.output_action, &std_meta.output_port, hash);
+                      std_meta->output_action, &std_meta->output_port, hash);
             }
             dp_netdev_queue_action_batches(packet, act_flow);
         }
@@ -347,6 +775,358 @@ process_ubpf(struct dp_netdev_pmd_thread *pmd,
 }
 
 
+/* ## ---------------------------------- ## */
+/* ## uBPF execution profiler interface. ## */
+/* ## ---------------------------------- ## */
+
+/* Parses argv[1] as a P4 program id and returns the matching program, or
+ * NULL after replying with an error.  Caller holds 'dp_prog_mutex'. */
+static struct dp_prog *
+profile_command_get_prog(struct unixctl_conn *conn, const char *arg)
+    OVS_REQUIRES(dp_prog_mutex)
+{
+    unsigned int prog_id;
+
+    if (!str_to_uint(arg, 10, &prog_id)
+        || prog_id >= ARRAY_SIZE(dp_progs)) {
+        unixctl_command_reply_error(conn, "invalid program id");
+        return NULL;
+    }
+
+    struct dp_prog *prog = dp_progs[prog_id];
+    if (!prog) {
+        unixctl_command_reply_error(conn, "no such program");
+    }
+    return prog;
+}
+
+static void
+ubpf_profile_start_command(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                           const char *argv[], void *aux OVS_UNUSED)
+{
+    ovs_mutex_lock(&dp_prog_mutex);
+    struct dp_prog *prog = profile_command_get_prog(conn, argv[1]);
+    if (prog) {
+        if (ubpf_profile_start(prog->vm)) {
+            unixctl_command_reply_error(conn, "profiling already enabled");
+        } else {
+            unixctl_command_reply(conn, NULL);
+        }
+    }
+    ovs_mutex_unlock(&dp_prog_mutex);
+}
+
+static void
+ubpf_profile_stop_command(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                          const char *argv[], void *aux OVS_UNUSED)
+{
+    ovs_mutex_lock(&dp_prog_mutex);
+    struct dp_prog *prog = profile_command_get_prog(conn, argv[1]);
+    if (prog) {
+        ubpf_profile_stop(prog->vm);
+        unixctl_command_reply(conn, NULL);
+    }
+    ovs_mutex_unlock(&dp_prog_mutex);
+}
+
+static void
+ubpf_profile_show_command(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                          const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ds reply = DS_EMPTY_INITIALIZER;
+
+    ovs_mutex_lock(&dp_prog_mutex);
+    struct dp_prog *prog = profile_command_get_prog(conn, argv[1]);
+    if (!prog) {
+        goto out;
+    }
+
+    struct ubpf_vm *vm = prog->vm;
+    struct ubpf_profile *profile = ovsrcu_get(struct ubpf_profile *,
+                                              &vm->profile);
+    if (!profile) {
+        unixctl_command_reply_error(conn, "profiling not enabled");
+        goto out;
+    }
+
+    ds_put_format(&reply, "Program %"PRIu32" helper calls:\n", prog->id);
+    for (size_t i = 0; i < UBPF_PROFILE_MAX_HELPERS; i++) {
+        uint64_t count;
+
+        atomic_read_relaxed(&profile->helper_calls[i], &count);
+        if (count) {
+            const char *name = vm->ext_func_names[i];
+            ds_put_format(&reply, "  %-24s %"PRIu64"\n",
+                          name ? name : "<unregistered>", count);
+        }
+    }
+
+    ds_put_format(&reply, "Instruction samples (1/%d instructions):\n",
+                  UBPF_PROFILE_SAMPLE_INTERVAL);
+    for (size_t pc = 0; pc < profile->num_insts; pc++) {
+        uint64_t count;
+
+        atomic_read_relaxed(&profile->insn_samples[pc], &count);
+        if (count) {
+            ds_put_format(&reply, "  pc %5"PRIuSIZE" %"PRIu64"\n", pc, count);
+        }
+    }
+
+    unixctl_command_reply(conn, ds_cstr(&reply));
+out:
+    ovs_mutex_unlock(&dp_prog_mutex);
+    ds_destroy(&reply);
+}
+
+/* ovs-appctl p4rt/table-replace PROG TABLE begin|commit|abort.
+ *
+ * Double-buffered full-table refresh: "begin" opens a transaction on the
+ * table, after which controller writes build the next version aside
+ * while the datapath keeps matching on the current one; "commit" goes
+ * live in a single pointer flip and "abort" discards the staged version.
+ * Meant for workloads that periodically replace a whole table, such as a
+ * FIB refresh, which entry-by-entry updates would leave visibly
+ * half-installed in the interim. */
+static void
+ubpf_table_replace_command(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                           const char *argv[], void *aux OVS_UNUSED)
+{
+    struct dp_prog *prog;
+    struct ubpf_map *map;
+    const char *op = argv[3];
+    int error;
+
+    ovs_mutex_lock(&dp_prog_mutex);
+    prog = profile_command_get_prog(conn, argv[1]);
+    ovs_mutex_unlock(&dp_prog_mutex);
+    if (!prog) {
+        return;
+    }
+
+    map = ubpf_lookup_registered_map(prog->vm, argv[2]);
+    if (!map) {
+        unixctl_command_reply_error(conn, "no such table");
+        return;
+    }
+
+    /* Controller writes stage their keys under the same mutex, so a
+     * transaction cannot open or flip in the middle of one. */
+    ovs_mutex_lock(&dp_staging_mutex);
+    if (!strcmp(op, "begin")) {
+        error = ubpf_map_replace_begin(map);
+    } else if (!strcmp(op, "commit")) {
+        error = ubpf_map_replace_commit(map);
+        if (!error) {
+            ubpf_emc_invalidate();
+        }
+    } else if (!strcmp(op, "abort")) {
+        error = ubpf_map_replace_abort(map);
+    } else {
+        error = INT_MIN;
+    }
+    ovs_mutex_unlock(&dp_staging_mutex);
+
+    if (!error) {
+        unixctl_command_reply(conn, NULL);
+    } else if (error == INT_MIN) {
+        unixctl_command_reply_error(conn,
+                                    "operation must be begin, commit or abort");
+    } else if (error == -2) {
+        unixctl_command_reply_error(conn,
+                                    "table type does not support replace");
+    } else if (error == -3) {
+        unixctl_command_reply_error(conn, !strcmp(op, "begin")
+                                          ? "a replace is already open"
+                                          : "no replace is open");
+    } else {
+        unixctl_command_reply_error(conn, "replace operation failed");
+    }
+}
+
+/* ovs-appctl p4rt/set-idle-timeout PROG TABLE SECONDS.
+ *
+ * Ages out entries of the table that go SECONDS without a lookup hit,
+ * 0 to turn aging back off.  P4Runtime defines idle_timeout_ns per
+ * entry, but it is not plumbed through the PI frontend here, so the
+ * timeout is per table - which is how MAC-learning programs use it
+ * anyway. */
+static void
+ubpf_set_idle_timeout_command(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                              const char *argv[], void *aux OVS_UNUSED)
+{
+    struct dp_prog *prog;
+    struct ubpf_map *map;
+    unsigned int secs;
+    int error;
+
+    ovs_mutex_lock(&dp_prog_mutex);
+    prog = profile_command_get_prog(conn, argv[1]);
+    ovs_mutex_unlock(&dp_prog_mutex);
+    if (!prog) {
+        return;
+    }
+
+    map = ubpf_lookup_registered_map(prog->vm, argv[2]);
+    if (!map) {
+        unixctl_command_reply_error(conn, "no such table");
+        return;
+    }
+    if (!str_to_uint(argv[3], 10, &secs)) {
+        unixctl_command_reply_error(conn, "invalid timeout");
+        return;
+    }
+
+    error = ubpf_map_set_idle_timeout(map, secs, prog->id);
+    if (error == -2) {
+        unixctl_command_reply_error(conn,
+                                    "table type does not support aging");
+    } else if (error) {
+        unixctl_command_reply_error(conn, "failed to set idle timeout");
+    } else {
+        unixctl_command_reply(conn, NULL);
+    }
+}
+
+/* ovs-appctl p4rt/set-numa-replication PROG TABLE on|off.
+ *
+ * Mirrors the table onto every NUMA node: each PMD then reads the clone
+ * local to its node instead of paying remote-node latency on every
+ * lookup, and controller writes are fanned out to all clones.  Worth it
+ * for read-mostly tables (a FIB) polled from both sockets; a
+ * write-heavy table pays the fan-out on every update. */
+static void
+ubpf_set_numa_replication_command(struct unixctl_conn *conn,
+                                  int argc OVS_UNUSED, const char *argv[],
+                                  void *aux OVS_UNUSED)
+{
+    struct dp_prog *prog;
+    struct ubpf_map *map;
+    bool enable;
+    int error;
+
+    ovs_mutex_lock(&dp_prog_mutex);
+    prog = profile_command_get_prog(conn, argv[1]);
+    ovs_mutex_unlock(&dp_prog_mutex);
+    if (!prog) {
+        return;
+    }
+
+    map = ubpf_lookup_registered_map(prog->vm, argv[2]);
+    if (!map) {
+        unixctl_command_reply_error(conn, "no such table");
+        return;
+    }
+    if (!strcmp(argv[3], "on")) {
+        enable = true;
+    } else if (!strcmp(argv[3], "off")) {
+        enable = false;
+    } else {
+        unixctl_command_reply_error(conn, "operation must be on or off");
+        return;
+    }
+
+    /* Controller writes fan out to the clones under this mutex, so the
+     * set of clones cannot change in the middle of one. */
+    ovs_mutex_lock(&dp_staging_mutex);
+    error = ubpf_map_set_numa_replication(map, enable);
+    ovs_mutex_unlock(&dp_staging_mutex);
+
+    if (!error) {
+        unixctl_command_reply(conn, NULL);
+    } else if (error == -2) {
+        unixctl_command_reply_error(conn,
+                                    "table type does not support "
+                                    "replication");
+    } else if (error == -3) {
+        unixctl_command_reply_error(conn,
+                                    "table has a replace open or aging "
+                                    "enabled");
+    } else if (error == -4) {
+        unixctl_command_reply_error(conn, "only one NUMA node");
+    } else {
+        unixctl_command_reply_error(conn, "failed to set replication");
+    }
+}
+
+/* Dumps hit/miss counters and occupancy for every map of every
+ * installed P4 program.  The counters come from the map dispatch layer,
+ * so an action-cache hit that short-circuits the program does not count
+ * as a table lookup. */
+static void
+ubpf_dump_table_stats_command(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                              const char *argv[] OVS_UNUSED,
+                              void *aux OVS_UNUSED)
+{
+    struct ds reply = DS_EMPTY_INITIALIZER;
+
+    ovs_mutex_lock(&dp_prog_mutex);
+    for (size_t i = 0; i < ARRAY_SIZE(dp_progs); i++) {
+        struct dp_prog *prog = dp_progs[i];
+
+        if (!prog) {
+            continue;
+        }
+        ds_put_format(&reply, "Program %"PRIu32":\n", prog->id);
+        for (uint16_t j = 0; j < prog->vm->nb_maps; j++) {
+            struct ubpf_map *map = prog->vm->ext_maps[j];
+            uint64_t hits = 0, misses = 0;
+
+            for (int s = 0; s < UBPF_MAP_STATS_SHARDS; s++) {
+                hits += map->stats[s].hits;
+                misses += map->stats[s].misses;
+            }
+
+            ds_put_format(&reply, "  %s: hits:%"PRIu64" misses:%"PRIu64,
+                          map->name, hits, misses);
+            if (hits + misses) {
+                ds_put_format(&reply, " hit-rate:%.2f%%",
+                              100.0 * hits / (hits + misses));
+            }
+            ds_put_format(&reply, " entries:%u/%u\n",
+                          ubpf_map_size(map), map->max_entries);
+        }
+    }
+    ovs_mutex_unlock(&dp_prog_mutex);
+    unixctl_command_reply(conn, ds_cstr(&reply));
+    ds_destroy(&reply);
+}
+
+/* Dumps per-program datapath cost counters: packets run through each
+ * VM and the cycles those runs took.  With a canary split configured on
+ * a port this is the A/B comparison - the two programs see slices of
+ * the same traffic, so cycles/packet is directly comparable.  Counters
+ * reset when a program is (re)installed. */
+static void
+ubpf_dump_program_stats_command(struct unixctl_conn *conn,
+                                int argc OVS_UNUSED,
+                                const char *argv[] OVS_UNUSED,
+                                void *aux OVS_UNUSED)
+{
+    struct ds reply = DS_EMPTY_INITIALIZER;
+
+    ovs_mutex_lock(&dp_prog_mutex);
+    for (size_t i = 0; i < ARRAY_SIZE(dp_progs); i++) {
+        struct dp_prog *prog = dp_progs[i];
+        uint64_t packets, cycles;
+
+        if (!prog) {
+            continue;
+        }
+        atomic_read_relaxed(&prog->n_vm_packets, &packets);
+        atomic_read_relaxed(&prog->n_vm_cycles, &cycles);
+        ds_put_format(&reply, "Program %"PRIu32": packets:%"PRIu64
+                      " cycles:%"PRIu64, prog->id, packets, cycles);
+        if (packets) {
+            ds_put_format(&reply, " cycles/packet:%.0f",
+                          (double) cycles / packets);
+        }
+        ds_put_char(&reply, '\n');
+    }
+    ovs_mutex_unlock(&dp_prog_mutex);
+    unixctl_command_reply(conn, ds_cstr(&reply));
+    ds_destroy(&reply);
+}
+
 /* ## -------------------------------------------- ## */
 /* ## Functions implementing dpif_class interface. ## */
 /* ## -------------------------------------------- ## */
@@ -354,7 +1134,27 @@ process_ubpf(struct dp_netdev_pmd_thread *pmd,
 static int
 dpif_ubpf_init(void)
 {
-    /* Some uBPF specific objects may be initialized here. */
+    unixctl_command_register("p4rt/dump-table-stats", "", 0, 0,
+                             ubpf_dump_table_stats_command, NULL);
+    unixctl_command_register("p4rt/dump-program-stats", "", 0, 0,
+                             ubpf_dump_program_stats_command, NULL);
+    unixctl_command_register("p4rt/table-replace",
+                             "prog table begin|commit|abort", 3, 3,
+                             ubpf_table_replace_command, NULL);
+    unixctl_command_register("p4rt/set-idle-timeout", "prog table seconds",
+                             3, 3, ubpf_set_idle_timeout_command, NULL);
+    unixctl_command_register("p4rt/set-numa-replication", "prog table on|off",
+                             3, 3, ubpf_set_numa_replication_command, NULL);
+
+    /* Idle-timeout evictions change verdicts just like controller
+     * deletes do, so have the sweeper invalidate the action cache. */
+    ubpf_expiry_set_evict_hook(ubpf_emc_invalidate);
+    unixctl_command_register("ubpf/profile-start", "prog-id", 1, 1,
+                             ubpf_profile_start_command, NULL);
+    unixctl_command_register("ubpf/profile-stop", "prog-id", 1, 1,
+                             ubpf_profile_stop_command, NULL);
+    unixctl_command_register("ubpf/profile-show", "prog-id", 1, 1,
+                             ubpf_profile_show_command, NULL);
 
     /* initialize dpif-netdev too. */
     dpif_netdev_init();
@@ -427,9 +1227,17 @@ dpif_ubpf_close(struct dpif *dpif)
     struct dpif_ubpf *dpif_ubpf = dpif_ubpf_cast(dpif);
     struct dp_ubpf *dp = dpif_ubpf->dp;
 
+    struct dp_prog_mapping *mapping;
+
     ovs_mutex_lock(&dp_prog_mutex);
+    CMAP_FOR_EACH (mapping, cmap_node, &dp->dp_progs_port_map) {
+        cmap_remove(&dp->dp_progs_port_map, &mapping->cmap_node,
+                    hash_int(odp_to_u32(mapping->port_no), 0));
+        ovsrcu_postpone(free, mapping);
+    }
     cmap_destroy(&dp->dp_progs_port_map);
     ovs_mutex_unlock(&dp_prog_mutex);
+    ubpf_progs_invalidate();
     shash_find_and_delete(&dp_ubpfs, dp->name);
     free(CONST_CAST(char *, dp->name));
 
@@ -437,9 +1245,16 @@ dpif_ubpf_close(struct dpif *dpif)
 }
 
 static int
-dpif_ubpf_set_config(struct dpif *dpif OVS_UNUSED, const struct smap *other_config OVS_UNUSED)
+dpif_ubpf_set_config(struct dpif *dpif OVS_UNUSED, const struct smap *other_config)
 {
-    /* TODO: Set uBPF-specific and netdev configuration. */
+    bool enable = smap_get_bool(other_config, "ubpf-emc-enable", true);
+    bool cur_enable;
+
+    atomic_read_relaxed(&ubpf_emc_enabled, &cur_enable);
+    if (enable != cur_enable) {
+        atomic_store_relaxed(&ubpf_emc_enabled, enable);
+        VLOG_INFO("uBPF action cache %s.", enable ? "enabled" : "disabled");
+    }
     return 0;
 }
 
@@ -453,14 +1268,49 @@ dpif_ubpf_port_set_config(struct dpif *dpif, odp_port_t port_no,
 {
     struct dp_ubpf *dp_ubpf = dpif_ubpf_cast(dpif)->dp;
     int prog_no = smap_get_int(cfg, "program", -1);
+    int canary_no = smap_get_int(cfg, "canary-program", -1);
+    int canary_pct = smap_get_int(cfg, "canary-percent", 0);
+    struct dp_prog_mapping *mapping;
+    uint32_t hash = hash_int(odp_to_u32(port_no), 0);
 
     VLOG_INFO("Setting prog %d for port %d", prog_no, port_no);
 
+    canary_pct = canary_pct < 0 ? 0 : MIN(canary_pct, 100);
+
     ovs_mutex_lock(&dp_prog_mutex);
     struct dp_prog *prog = dp_progs[prog_no];
-    cmap_insert(&dp_ubpf->dp_progs_port_map, &prog->cmap_node,
-                hash_int(odp_to_u32(port_no), 0));
+    struct dp_prog *canary
+        = canary_no >= 0 && canary_no < (int) ARRAY_SIZE(dp_progs)
+          ? dp_progs[canary_no] : NULL;
+
+    if (canary && canary_pct) {
+        VLOG_INFO("Setting canary prog %d (%d%% of traffic) for port %d",
+                  canary_no, canary_pct, port_no);
+    } else {
+        canary = NULL;
+        canary_pct = 0;
+    }
+
+    CMAP_FOR_EACH_WITH_HASH (mapping, cmap_node, hash,
+                             &dp_ubpf->dp_progs_port_map) {
+        if (mapping->port_no == port_no) {
+            ovsrcu_set(&mapping->prog, prog);
+            ovsrcu_set(&mapping->canary_prog, canary);
+            mapping->canary_pct = canary_pct;
+            ovs_mutex_unlock(&dp_prog_mutex);
+            ubpf_progs_invalidate();
+            return 0;
+        }
+    }
+
+    mapping = xzalloc(sizeof *mapping);
+    mapping->port_no = port_no;
+    ovsrcu_init(&mapping->prog, prog);
+    ovsrcu_init(&mapping->canary_prog, canary);
+    mapping->canary_pct = canary_pct;
+    cmap_insert(&dp_ubpf->dp_progs_port_map, &mapping->cmap_node, hash);
     ovs_mutex_unlock(&dp_prog_mutex);
+    ubpf_progs_invalidate();
     return 0;
 }
 
@@ -496,47 +1346,130 @@ dp_prog_set_mappings(struct dp_prog *prog, const pi_p4info_t *p4info)
             action_id->action_id = action;
             action_id->dp_action_id = act_id;
             hmap_insert(&prog->action_ids, &action_id->hmap_node, hash_int(action, 0));
+            hmap_insert(&prog->action_ids_by_dp, &action_id->dp_hmap_node,
+                        hash_int(act_id, 0));
             VLOG_INFO("Action ID mapping inserted %u <-> %d", action, act_id);
             act_id++;
         }
     }
 
+    for (pi_p4_id_t id = pi_p4info_act_prof_begin(p4info);
+         id != pi_p4info_act_prof_end(p4info);
+         id = pi_p4info_act_prof_next(p4info, id)) {
+        const char *ap_name = pi_p4info_act_prof_name_from_id(p4info, id);
+        const char *ap = replace_char(ap_name, '.', '_');
+
+        struct ubpf_map *map = ubpf_lookup_registered_map(vm, ap);
+        if (!map) {
+            VLOG_WARN("Action profile '%s' has no selector map in the uBPF "
+                      "program.", ap);
+            continue;
+        }
+
+        struct dpif_table_id *tbl_id = xzalloc(sizeof *tbl_id);
+        tbl_id->table_id = id;
+        tbl_id->dp_table_id = map->id;
+        hmap_insert(&prog->table_ids, &tbl_id->hmap_node, hash_int(id, 0));
+        VLOG_INFO("Action profile '%s' ID mapping inserted %u <-> %d",
+                  ap, id, map->id);
+    }
+
     return 0;
 }
 
+/* Repoints every port binding at 'old' in every ubpf datapath to 'new',
+ * which may be NULL.  Each binding changes with a single RCU pointer
+ * store, so PMDs switch programs between packets, never during one.
+ * Canary bindings follow along: a reinstalled program keeps its slice
+ * of the port's traffic. */
+static void
+dp_prog_repoint_mappings(struct dp_prog *old, struct dp_prog *new)
+{
+    struct shash_node *node;
+
+    ovs_mutex_lock(&dp_ubpf_mutex);
+    SHASH_FOR_EACH (node, &dp_ubpfs) {
+        struct dp_ubpf *dp = node->data;
+        struct dp_prog_mapping *mapping;
+
+        CMAP_FOR_EACH (mapping, cmap_node, &dp->dp_progs_port_map) {
+            if (ovsrcu_get_protected(struct dp_prog *,
+                                     &mapping->prog) == old) {
+                ovsrcu_set(&mapping->prog, new);
+            }
+            if (ovsrcu_get_protected(struct dp_prog *,
+                                     &mapping->canary_prog) == old) {
+                ovsrcu_set(&mapping->canary_prog, new);
+            }
+        }
+    }
+    ovs_mutex_unlock(&dp_ubpf_mutex);
+}
+
 static int
 dp_prog_set(struct dpif *dpif OVS_UNUSED, struct dpif_prog prog)
 {
-    struct dp_prog *dp_prog;
-
+    struct dp_prog *dp_prog, *old_prog;
+    uint8_t elf_sha1[SHA1_DIGEST_SIZE];
+    struct ubpf_vm *vm;
+    bool reuse_vm;
+
+    /* A pipeline push with an unchanged ELF does not need the expensive
+     * ubpf_load_elf() + ubpf_compile() round trip: reuse the already
+     * compiled VM, maps and all.  The JIT image embeds absolute map and
+     * helper addresses, so compiled code can only be reused within this
+     * process; a persistent on-disk code cache would need those
+     * addresses relocated on load. */
+    sha1_bytes(prog.data, prog.data_len, elf_sha1);
     ovs_mutex_lock(&dp_prog_mutex);
-    dp_prog = dp_progs[prog.id];
-
-    if (dp_prog) {
-        /* P4 program with a given ID exists. */
-        ovs_mutex_unlock(&dp_prog_mutex);
-        return EEXIST;
-    }
+    old_prog = dp_progs[prog.id];
+    reuse_vm = old_prog && !memcmp(old_prog->elf_sha1, elf_sha1,
+                                   SHA1_DIGEST_SIZE);
+    ovs_mutex_unlock(&dp_prog_mutex);
 
-    struct ubpf_vm *vm = create_ubpf_vm((OVS_FORCE const ovs_be16) prog.id);
-    if (!load_bpf_prog(vm, prog.data_len, prog.data)) {
-        ubpf_destroy(vm);
-        ovs_mutex_unlock(&dp_prog_mutex);
-        return -1; /* FIXME: not sure what to return. */
+    if (reuse_vm) {
+        VLOG_INFO("program %"PRIu32": ELF unchanged, reusing compiled code",
+                  prog.id);
+        vm = old_prog->vm;
+    } else {
+        vm = create_ubpf_vm((OVS_FORCE const ovs_be16) prog.id);
+        if (!load_bpf_prog(vm, prog.data_len, prog.data)) {
+            ubpf_destroy(vm);
+            return -1; /* FIXME: not sure what to return. */
+        }
     }
 
     dp_prog = xzalloc(sizeof *dp_prog);
     dp_prog->id = prog.id;
     dp_prog->vm = vm;
+    memcpy(dp_prog->elf_sha1, elf_sha1, SHA1_DIGEST_SIZE);
     dp_prog->p4info = prog.p4info;
     hmap_init(&dp_prog->table_ids);
     hmap_init(&dp_prog->action_ids);
-    dp_prog->default_action_set = false;
+    hmap_init(&dp_prog->action_ids_by_dp);
+    dp_prog->default_action_set = reuse_vm ? old_prog->default_action_set
+                                           : false;
+
+    dp_prog_set_mappings(dp_prog, prog.p4info);
 
+    ovs_mutex_lock(&dp_prog_mutex);
+    old_prog = dp_progs[prog.id];
     dp_progs[prog.id] = dp_prog;
     ovs_mutex_unlock(&dp_prog_mutex);
 
-    dp_prog_set_mappings(dp_prog, prog.p4info);
+    if (old_prog) {
+        if (reuse_vm) {
+            old_prog->vm = NULL; /* 'dp_prog' took ownership of the VM. */
+        }
+        /* Hitless upgrade: publish the new program to the ports, then
+         * tear the old one down only after all readers have quiesced.
+         * The dispatch caches must be invalidated before the old
+         * program goes on the RCU free list. */
+        dp_prog_repoint_mappings(old_prog, dp_prog);
+        ubpf_progs_invalidate();
+        ovsrcu_postpone(dp_prog_destroy_, old_prog);
+    }
+    ubpf_emc_invalidate();
 
     return 0;
 }
@@ -545,7 +1478,24 @@ static void
 dp_prog_destroy_(struct dp_prog *prog)
 {
     if (prog) {
-        ubpf_destroy(prog->vm);
+        struct dpif_table_id *table_id, *next;
+        HMAP_FOR_EACH_SAFE (table_id, next, hmap_node, &prog->table_ids) {
+            free(table_id);
+        }
+        hmap_destroy(&prog->table_ids);
+
+        struct dpif_action_id *action_id, *next_act;
+        HMAP_FOR_EACH_SAFE (action_id, next_act, hmap_node,
+                            &prog->action_ids) {
+            free(action_id);
+        }
+        hmap_destroy(&prog->action_ids);
+        /* Holds the same nodes as 'action_ids', already freed above. */
+        hmap_destroy(&prog->action_ids_by_dp);
+
+        if (prog->vm) {
+            ubpf_destroy(prog->vm);
+        }
         free(prog);
     }
 }
@@ -557,6 +1507,7 @@ dp_prog_unset(struct dpif *dpif OVS_UNUSED, uint32_t prog_id)
 
     ovs_mutex_lock(&dp_prog_mutex);
     prog = dp_progs[prog_id];
+    dp_progs[prog_id] = NULL;
     ovs_mutex_unlock(&dp_prog_mutex);
 
     if (!prog) {
@@ -564,21 +1515,10 @@ dp_prog_unset(struct dpif *dpif OVS_UNUSED, uint32_t prog_id)
         return;
     }
 
-    ovs_mutex_lock(&dp_prog_mutex);
-    struct dpif_table_id *table_id, *next;
-    HMAP_FOR_EACH_SAFE (table_id, next, hmap_node, &prog->table_ids) {
-        free(table_id);
-    }
-    hmap_destroy(&prog->table_ids);
-
-    struct dpif_action_id *action_id, *next_act;
-    HMAP_FOR_EACH_SAFE (action_id, next_act, hmap_node, &prog->action_ids) {
-        free(action_id);
-    }
-    hmap_destroy(&prog->action_ids);
-    dp_prog_destroy_(prog);
-    dp_progs[prog_id] = NULL;
-    ovs_mutex_unlock(&dp_prog_mutex);
+    dp_prog_repoint_mappings(prog, NULL);
+    ubpf_progs_invalidate();
+    ovsrcu_postpone(dp_prog_destroy_, prog);
+    ubpf_emc_invalidate();
 }
 
 static bool
@@ -595,19 +1535,141 @@ isLPM(const pi_p4info_t *p4info, uint32_t table_id)
     return false;
 }
 
-/*
- * TODO: prepare description
- */
+/* Size of the key blob build_key() produces for 'map'.  For ternary and
+ * range maps that is a priority-carrying control key twice the width of
+ * the lookup key the data path uses. */
+static size_t
+map_control_key_size(const struct ubpf_map *map)
+{
+    switch (map->type) {
+    case UBPF_MAP_TYPE_TERNARY:
+        return sizeof(struct ubpf_ternary_key) + 2 * (size_t) map->key_size;
+    case UBPF_MAP_TYPE_RANGE:
+        return sizeof(struct ubpf_range_key) + 2 * (size_t) map->key_size;
+    case UBPF_MAP_TYPE_ARRAY:
+    case UBPF_MAP_TYPE_BLOOMFILTER:
+    case UBPF_MAP_TYPE_COUNTMIN:
+    case UBPF_MAP_TYPE_HASHMAP:
+    case UBPF_MAP_TYPE_LPM_TRIE:
+    case UBPF_MAP_TYPE_LPM_DIR24:
+    case UBPF_MAP_TYPE_PERCPU_ARRAY:
+    case UBPF_MAP_TYPE_PERCPU_HASHMAP:
+    case UBPF_MAP_TYPE_METER:
+    case UBPF_MAP_TYPE_ACT_SELECTOR:
+    default:
+        return map->key_size;
+    }
+}
+
+/* Translates the PI-serialized 'match_key' into the key layout 'map''s
+ * update and delete operations expect.  PI hands over each field in network
+ * byte order as its value, followed by a same-width mask for a ternary
+ * field or a 4-byte prefix length for an LPM field. */
 static char *
-build_key(const pi_p4info_t *p4info, uint32_t table_id, struct ubpf_map *map, const char *match_key)
+build_key(const pi_p4info_t *p4info, uint32_t table_id, struct ubpf_map *map,
+          const char *match_key, uint32_t priority, struct p4rt_arena *arena)
 {
     bool lpm_type = isLPM(p4info, table_id);
     size_t num_match_fields = pi_p4info_table_num_match_fields(p4info, table_id);
 
+    if (map->type == UBPF_MAP_TYPE_TERNARY) {
+        /* Ternary maps are keyed by (priority, value, mask); the value and
+         * mask images use the same per-field layout as an exact-match key:
+         * each field reversed into host byte order and padded out to its
+         * 4-byte-rounded width, with the padding masked don't-care. */
+        struct ubpf_ternary_key *tkey =
+            p4rt_arena_zalloc(arena, map_control_key_size(map));
+        uint8_t *value_ptr = tkey->data;
+        uint8_t *mask_ptr = tkey->data + map->key_size;
+
+        tkey->priority = priority;
+        for (size_t i = 0; i < num_match_fields; i++) {
+            const pi_p4info_match_field_info_t *finfo =
+                    pi_p4info_table_match_field_info(p4info, table_id, i);
+            size_t key_size = (finfo->bitwidth + 7) / 8;
+            size_t bpf_key_size = ROUND_UP(key_size, 4);
+
+            for (size_t k = 0; k < key_size; k++) {
+                value_ptr[key_size - 1 - k] = match_key[k];
+            }
+            match_key += key_size;
+
+            if (finfo->match_type == PI_P4INFO_MATCH_TYPE_TERNARY) {
+                for (size_t k = 0; k < key_size; k++) {
+                    mask_ptr[key_size - 1 - k] = match_key[k];
+                }
+                match_key += key_size;
+            } else if (finfo->match_type == PI_P4INFO_MATCH_TYPE_LPM) {
+                uint32_t prefix_len;
+
+                memcpy(&prefix_len, match_key, 4);
+                match_key += 4;
+
+                /* In the reversed image byte 'k' carries the field's bits
+                 * [8k, 8k + 8); a prefix of 'prefix_len' bits wildcards
+                 * the low 'bitwidth - prefix_len' of them. */
+                uint32_t free_bits = finfo->bitwidth - prefix_len;
+                for (size_t k = 0; k < key_size; k++) {
+                    if (free_bits <= 8 * k) {
+                        mask_ptr[k] = 0xff;
+                    } else if (free_bits >= 8 * k + 8) {
+                        mask_ptr[k] = 0;
+                    } else {
+                        mask_ptr[k] = 0xff << (free_bits - 8 * k);
+                    }
+                }
+            } else {
+                /* Exact field: every value byte matters. */
+                memset(mask_ptr, 0xff, key_size);
+            }
+            value_ptr += bpf_key_size;
+            mask_ptr += bpf_key_size;
+        }
+
+        return (char *) tkey;
+    }
+
+    if (map->type == UBPF_MAP_TYPE_RANGE) {
+        /* Range maps are keyed by (priority, low, high); the bound images
+         * use the same per-field layout as an exact-match key.  PI hands a
+         * range field over as its low bound followed by its high bound;
+         * any other field matches exactly, so both bounds carry its
+         * value. */
+        struct ubpf_range_key *rkey =
+            p4rt_arena_zalloc(arena, map_control_key_size(map));
+        uint8_t *lo_ptr = rkey->data;
+        uint8_t *hi_ptr = rkey->data + map->key_size;
+
+        rkey->priority = priority;
+        for (size_t i = 0; i < num_match_fields; i++) {
+            const pi_p4info_match_field_info_t *finfo =
+                    pi_p4info_table_match_field_info(p4info, table_id, i);
+            size_t key_size = (finfo->bitwidth + 7) / 8;
+            size_t bpf_key_size = ROUND_UP(key_size, 4);
+
+            for (size_t k = 0; k < key_size; k++) {
+                lo_ptr[key_size - 1 - k] = match_key[k];
+            }
+            match_key += key_size;
+
+            if (finfo->match_type == PI_P4INFO_MATCH_TYPE_RANGE) {
+                for (size_t k = 0; k < key_size; k++) {
+                    hi_ptr[key_size - 1 - k] = match_key[k];
+                }
+                match_key += key_size;
+            } else {
+                memcpy(hi_ptr, lo_ptr, key_size);
+            }
+            lo_ptr += bpf_key_size;
+            hi_ptr += bpf_key_size;
+        }
+
+        return (char *) rkey;
+    }
+
     size_t buf_size = !lpm_type ? map->key_size : map->key_size + (4 * num_match_fields);
-    char *key = xzalloc(buf_size);
+    char *key = p4rt_arena_zalloc(arena, buf_size);
     char *key_ptr = key;
-    memset(key, 0, buf_size);
     for (int i = 0; i < num_match_fields; i++) {
         const pi_p4info_match_field_info_t *finfo =
                 pi_p4info_table_match_field_info(p4info, table_id, i);
@@ -655,11 +1717,12 @@ build_key(const pi_p4info_t *p4info, uint32_t table_id, struct ubpf_map *map, co
  * The total width is stored in `map->value_size'.
  * */
 static uint8_t *
-construct_map_value(struct dp_prog *prog, struct ubpf_map *map, uint32_t action_id, const char *action_data, size_t data_size)
+construct_map_value(struct dp_prog *prog, struct ubpf_map *map,
+                    uint32_t action_id, const char *action_data,
+                    size_t data_size, struct p4rt_arena *arena)
 {
     const pi_p4info_t *p4info = prog->p4info;
-    uint8_t *value = xzalloc(map->value_size);
-    memset(value, 0, map->value_size);
+    uint8_t *value = p4rt_arena_zalloc(arena, map->value_size);
 
     if (data_size > 0) {
         int v_idx = 4; /* First 4 bytes are allocated for "action_id". */
@@ -694,7 +1757,7 @@ construct_map_value(struct dp_prog *prog, struct ubpf_map *map, uint32_t action_
 static int
 dp_table_entry_add(struct dpif *dpif OVS_UNUSED, uint32_t prog_id,
                    uint32_t table_id,
-                   uint32_t action_id,
+                   uint32_t action_id, uint32_t priority,
                    const char *match_key, size_t key_size OVS_UNUSED,
                    const char *action_data, size_t data_size)
 {
@@ -725,8 +1788,12 @@ dp_table_entry_add(struct dpif *dpif OVS_UNUSED, uint32_t prog_id,
         return EEXIST;
     }
 
-    void *key = (void *) build_key(prog->p4info, p4info_table_id, map, match_key);
-    void *value = (void *) construct_map_value(prog, map, action_id, action_data, data_size);
+    ovs_mutex_lock(&dp_staging_mutex);
+    void *key = (void *) build_key(prog->p4info, p4info_table_id, map,
+                                   match_key, priority, &dp_staging_arena);
+    void *value = (void *) construct_map_value(prog, map, action_id,
+                                               action_data, data_size,
+                                               &dp_staging_arena);
     error = ubpf_map_update(map, key, value);
     if (error) {
         VLOG_WARN("ubpf: the update_map() operation failed (status=%d).", error);
@@ -734,14 +1801,357 @@ dp_table_entry_add(struct dpif *dpif OVS_UNUSED, uint32_t prog_id,
         error = -1;
         goto out;
     }
+    ubpf_emc_invalidate();
+
+    p4rt_offload_entry_add(&(struct p4rt_offload_entry) {
+        .prog_id = prog_id,
+        .table_id = table_id,
+        .match_type = map->type,
+        .key = key,
+        .key_size = map_control_key_size(map),
+        .action_id = action_id,
+        .data = value,
+        .data_size = map->value_size,
+    });
 
 out:
-    free(key);
-    free(value);
+    p4rt_arena_reset(&dp_staging_arena);
+    ovs_mutex_unlock(&dp_staging_mutex);
+
+    return error;
+}
+
+/* Installs all entries on 'entries' in one descent into the datapath.
+ * The resolved table is cached between consecutive entries, and the
+ * memoized verdicts are invalidated once at the end rather than per
+ * entry, so bulk loads scale with the number of entries instead of the
+ * per-write overhead. */
+static int
+dp_table_entry_add_batch(struct dpif *dpif OVS_UNUSED, uint32_t prog_id,
+                         struct ovs_list *entries)
+{
+    struct p4rtutil_table_entry *entry;
+    uint32_t cur_table_id = UINT32_MAX;
+    uint32_t cur_ubpf_table_id = UINT32_MAX;
+    struct ubpf_map *map = NULL;
+    bool any_installed = false;
+    struct dp_prog *prog;
+    int error = 0;
+
+    ovs_mutex_lock(&dp_prog_mutex);
+    prog = dp_progs[prog_id];
+    ovs_mutex_unlock(&dp_prog_mutex);
+
+    if (!prog) {
+        /* uBPF program is not installed. */
+        return EEXIST;
+    }
+
+    ovs_mutex_lock(&dp_staging_mutex);
+    LIST_FOR_EACH (entry, list_node, entries) {
+        if (entry->table_id != cur_table_id) {
+            uint32_t table_id = entry->table_id;
+
+            cur_table_id = entry->table_id;
+            error = translate_table_id(prog, &table_id);
+            if (error) {
+                VLOG_WARN("Datapath cannot translate table ID.");
+                error = EEXIST;
+                break;
+            }
+
+            map = prog->vm->ext_maps[table_id];
+            if (!map) {
+                VLOG_WARN("Table %d does not exist.", table_id);
+                error = EEXIST;
+                break;
+            }
+            cur_ubpf_table_id = table_id;
+        }
+
+        void *key = (void *) build_key(prog->p4info, entry->table_id, map,
+                                       entry->match_key, entry->priority,
+                                       &dp_staging_arena);
+        void *value = (void *) construct_map_value(prog, map,
+                                                   entry->action_id,
+                                                   entry->action_data,
+                                                   entry->data_size,
+                                                   &dp_staging_arena);
+        error = ubpf_map_update(map, key, value);
+        if (!error) {
+            p4rt_offload_entry_add(&(struct p4rt_offload_entry) {
+                .prog_id = prog_id,
+                .table_id = cur_ubpf_table_id,
+                .match_type = map->type,
+                .key = key,
+                .key_size = map_control_key_size(map),
+                .action_id = entry->action_id,
+                .data = value,
+                .data_size = map->value_size,
+            });
+        }
+        if (error) {
+            VLOG_WARN("ubpf: the update_map() operation failed (status=%d).",
+                      error);
+            /* FIXME: not sure what to return. */
+            error = -1;
+            break;
+        }
+        any_installed = true;
+    }
+    p4rt_arena_reset(&dp_staging_arena);
+    ovs_mutex_unlock(&dp_staging_mutex);
+
+    if (any_installed) {
+        ubpf_emc_invalidate();
+    }
 
     return error;
 }
 
+/* Snapshots all values of counter 'counter_id' in one pass over the
+ * backing map, instead of one map access per index.  Counter maps are
+ * plain or per-CPU arrays, so the snapshot is a sequential copy of
+ * contiguous memory; PMD threads keep counting while it is taken, so
+ * each index is a point-in-time sample but the pass never blocks
+ * them. */
+static int
+dp_counter_query(struct dpif *dpif OVS_UNUSED, uint32_t prog_id,
+                 uint32_t counter_id, uint64_t **valuesp, size_t *n_valuesp)
+{
+    struct dp_prog *prog;
+    struct ubpf_map *map;
+    const char *name;
+    uint64_t *values;
+    size_t n;
+
+    ovs_mutex_lock(&dp_prog_mutex);
+    prog = dp_progs[prog_id];
+    ovs_mutex_unlock(&dp_prog_mutex);
+
+    if (!prog) {
+        /* uBPF program is not installed. */
+        return EEXIST;
+    }
+
+    name = pi_p4info_counter_name_from_id(prog->p4info, counter_id);
+    if (!name) {
+        return ENOENT;
+    }
+
+    map = ubpf_lookup_registered_map(prog->vm, replace_char(name, '.', '_'));
+    if (!map) {
+        VLOG_WARN("Counter %"PRIu32" does not exist.", counter_id);
+        return ENOENT;
+    }
+    if ((map->type != UBPF_MAP_TYPE_ARRAY
+         && map->type != UBPF_MAP_TYPE_PERCPU_ARRAY)
+        || (map->value_size != sizeof(uint32_t)
+            && map->value_size != sizeof(uint64_t))) {
+        return EOPNOTSUPP;
+    }
+
+    n = map->max_entries;
+    values = xmalloc(n * sizeof *values);
+
+    if (map->type == UBPF_MAP_TYPE_ARRAY) {
+        if (map->value_size == sizeof(uint64_t)) {
+            memcpy(values, map->data, n * sizeof *values);
+        } else {
+            const uint32_t *src = map->data;
+
+            for (size_t i = 0; i < n; i++) {
+                values[i] = src[i];
+            }
+        }
+    } else {
+        /* The per-CPU dump already folds all replicas into one value
+         * per index. */
+        char *raw = xmalloc(n * map->value_size);
+
+        ubpf_map_dump(map, raw);
+        for (size_t i = 0; i < n; i++) {
+            values[i] = map->value_size == sizeof(uint64_t)
+                        ? ALIGNED_CAST(uint64_t *, raw)[i]
+                        : ALIGNED_CAST(uint32_t *, raw)[i];
+        }
+        free(raw);
+    }
+
+    *valuesp = values;
+    *n_valuesp = n;
+    return 0;
+}
+
+/* Resolves action profile 'act_prof_id' of program 'prog_id' to its
+ * selector map, storing the program in '*progp'.  Action profile ids
+ * share the translation table with match tables; the id spaces cannot
+ * collide because P4Info ids encode the resource type. */
+static struct ubpf_map *
+dp_act_prof_resolve(uint32_t prog_id, uint32_t act_prof_id,
+                    struct dp_prog **progp)
+{
+    struct dp_prog *prog;
+    struct ubpf_map *map;
+    uint32_t table_id = act_prof_id;
+
+    ovs_mutex_lock(&dp_prog_mutex);
+    prog = dp_progs[prog_id];
+    ovs_mutex_unlock(&dp_prog_mutex);
+
+    if (!prog || translate_table_id(prog, &table_id)) {
+        return NULL;
+    }
+
+    map = prog->vm->ext_maps[table_id];
+    if (!map || map->type != UBPF_MAP_TYPE_ACT_SELECTOR) {
+        return NULL;
+    }
+    *progp = prog;
+    return map;
+}
+
+static int
+dp_act_prof_member_create(struct dpif *dpif OVS_UNUSED, uint32_t prog_id,
+                          uint32_t act_prof_id, uint32_t action_id,
+                          const char *action_data, size_t data_size,
+                          uint32_t *mbr_handle)
+{
+    struct dp_prog *prog;
+    struct ubpf_map *map = dp_act_prof_resolve(prog_id, act_prof_id, &prog);
+    int error;
+
+    if (!map) {
+        return EEXIST;
+    }
+
+    ovs_mutex_lock(&dp_staging_mutex);
+    void *value = construct_map_value(prog, map, action_id, action_data,
+                                      data_size, &dp_staging_arena);
+    error = ubpf_act_prof_member_create(map, value, mbr_handle);
+    p4rt_arena_reset(&dp_staging_arena);
+    ovs_mutex_unlock(&dp_staging_mutex);
+
+    if (error) {
+        VLOG_WARN("ubpf: creating action profile member failed (status=%d).",
+                  error);
+        return -1;
+    }
+    return 0;
+}
+
+static int
+dp_act_prof_member_modify(struct dpif *dpif OVS_UNUSED, uint32_t prog_id,
+                          uint32_t act_prof_id, uint32_t mbr_handle,
+                          uint32_t action_id,
+                          const char *action_data, size_t data_size)
+{
+    struct dp_prog *prog;
+    struct ubpf_map *map = dp_act_prof_resolve(prog_id, act_prof_id, &prog);
+    int error;
+
+    if (!map) {
+        return EEXIST;
+    }
+
+    ovs_mutex_lock(&dp_staging_mutex);
+    void *value = construct_map_value(prog, map, action_id, action_data,
+                                      data_size, &dp_staging_arena);
+    error = ubpf_act_prof_member_modify(map, mbr_handle, value);
+    p4rt_arena_reset(&dp_staging_arena);
+    ovs_mutex_unlock(&dp_staging_mutex);
+
+    if (error) {
+        VLOG_WARN("ubpf: modifying action profile member failed (status=%d).",
+                  error);
+        return -1;
+    }
+    ubpf_emc_invalidate();
+    return 0;
+}
+
+static int
+dp_act_prof_member_del(struct dpif *dpif OVS_UNUSED, uint32_t prog_id,
+                       uint32_t act_prof_id, uint32_t mbr_handle)
+{
+    struct dp_prog *prog;
+    struct ubpf_map *map = dp_act_prof_resolve(prog_id, act_prof_id, &prog);
+    int error;
+
+    if (!map) {
+        return EEXIST;
+    }
+
+    error = ubpf_act_prof_member_delete(map, mbr_handle);
+    if (error) {
+        VLOG_WARN("ubpf: deleting action profile member failed (status=%d).",
+                  error);
+        return -1;
+    }
+    ubpf_emc_invalidate();
+    return 0;
+}
+
+static int
+dp_act_prof_group_create(struct dpif *dpif OVS_UNUSED, uint32_t prog_id,
+                         uint32_t act_prof_id, uint32_t *grp_handle)
+{
+    struct dp_prog *prog;
+    struct ubpf_map *map = dp_act_prof_resolve(prog_id, act_prof_id, &prog);
+
+    if (!map) {
+        return EEXIST;
+    }
+
+    return ubpf_act_prof_group_create(map, grp_handle) ? -1 : 0;
+}
+
+static int
+dp_act_prof_group_set(struct dpif *dpif OVS_UNUSED, uint32_t prog_id,
+                      uint32_t act_prof_id, uint32_t grp_handle,
+                      const uint32_t *mbr_handles, size_t n_mbrs)
+{
+    struct dp_prog *prog;
+    struct ubpf_map *map = dp_act_prof_resolve(prog_id, act_prof_id, &prog);
+    int error;
+
+    if (!map) {
+        return EEXIST;
+    }
+
+    error = ubpf_act_prof_group_set_members(map, grp_handle, mbr_handles,
+                                            n_mbrs);
+    if (error) {
+        VLOG_WARN("ubpf: setting action profile group members failed "
+                  "(status=%d).", error);
+        return -1;
+    }
+    ubpf_emc_invalidate();
+    return 0;
+}
+
+static int
+dp_act_prof_group_del(struct dpif *dpif OVS_UNUSED, uint32_t prog_id,
+                      uint32_t act_prof_id, uint32_t grp_handle)
+{
+    struct dp_prog *prog;
+    struct ubpf_map *map = dp_act_prof_resolve(prog_id, act_prof_id, &prog);
+    int error;
+
+    if (!map) {
+        return EEXIST;
+    }
+
+    error = ubpf_act_prof_group_delete(map, grp_handle);
+    if (error) {
+        VLOG_WARN("ubpf: deleting action profile group failed (status=%d).",
+                  error);
+        return -1;
+    }
+    ubpf_emc_invalidate();
+    return 0;
+}
+
 static int
 dp_table_entry_set_default(struct dpif *dpif OVS_UNUSED, uint32_t prog_id,
                            uint32_t table_id,
@@ -777,7 +2187,10 @@ dp_table_entry_set_default(struct dpif *dpif OVS_UNUSED, uint32_t prog_id,
     }
 
     uint32_t zero_key = 0;
-    void *value = (void *) construct_map_value(prog, map, action_id, action_data, data_size);
+    ovs_mutex_lock(&dp_staging_mutex);
+    void *value = (void *) construct_map_value(prog, map, action_id,
+                                               action_data, data_size,
+                                               &dp_staging_arena);
     error = ubpf_map_update(map, &zero_key, value);
 
     if (error) {
@@ -786,10 +2199,12 @@ dp_table_entry_set_default(struct dpif *dpif OVS_UNUSED, uint32_t prog_id,
         error = -1;
         goto out;
     }
+    ubpf_emc_invalidate();
 
 out:
     prog->default_action_set = true;
-    free(value);
+    p4rt_arena_reset(&dp_staging_arena);
+    ovs_mutex_unlock(&dp_staging_mutex);
     return error;
 }
 
@@ -799,7 +2214,7 @@ out:
  * 'key_size' number of bytes.
  */
 static char *
-alloc_and_swap(char *data, size_t size, int offset)
+alloc_and_swap(const char *data, size_t size, int offset)
 {
     char *buf = xzalloc(size);
     for (int i=0; i<size; i++) {
@@ -856,6 +2271,46 @@ dp_table_entry_get_default(struct dpif *dpif OVS_UNUSED, uint32_t prog_id,
 }
 
 
+/* Converts one dumped (key, value) pair at 'datap' into a
+ * p4rtutil_table_entry on 'entries' and returns the position just past
+ * it. */
+static const char *
+dp_table_query_entry__(struct dp_prog *prog, struct ubpf_map *map,
+                       uint32_t p4info_table_id, const char *datap,
+                       struct ovs_list *entries)
+{
+    struct p4rtutil_table_entry *entry = xmalloc(sizeof *entry);
+
+    char *key = alloc_and_swap(datap, map->key_size, map->key_size
+                               - pi_p4info_table_match_key_size(
+                                     prog->p4info, p4info_table_id));
+    datap = datap + map->key_size;
+
+    // TODO: do we need to allocate new memory for action_id?
+    uint32_t *action_id = ALIGNED_CAST(uint32_t *,
+                                       alloc_and_swap(datap,
+                                                      sizeof(uint32_t), 0));
+    datap = datap + sizeof(*action_id);
+
+    char *action_data = alloc_and_swap(datap, map->value_size - sizeof *action_id, 0);
+    datap = datap + (map->value_size - sizeof *action_id);
+
+    entry->handle_id = 0; /* don't define any */
+    entry->priority = 0; /* set 0 by default */
+    entry->match_key = key;
+    entry->table_id = p4info_table_id;
+    entry->action_id = get_p4info_action_id(prog, *action_id);
+    entry->action_data = action_data;
+
+    ovs_list_push_back(entries, &entry->list_node);
+    free(action_id);
+
+    return datap;
+}
+
+/* Entries per ubpf_map_dump_next() call when streaming a table read. */
+#define DP_TABLE_DUMP_CHUNK 256
+
 static int
 dp_table_query(struct dpif *dpif OVS_UNUSED, uint32_t prog_id,
                uint32_t table_id,
@@ -888,33 +2343,43 @@ dp_table_query(struct dpif *dpif OVS_UNUSED, uint32_t prog_id,
         return EEXIST;
     }
 
+    /* Hash-backed tables stream out in bounded chunks: each call copies
+     * at most DP_TABLE_DUMP_CHUNK entries out of an RCU view of the map,
+     * so a big table costs one chunk's worth of memory instead of a
+     * full-map allocation and writers are never paused.  Entries added
+     * or removed while the dump runs may be missed or seen twice, which
+     * a controller read tolerates. */
+    if (map->ops.map_dump_next) {
+        struct ubpf_map_cursor cursor;
+        char *data = xmalloc((size_t) DP_TABLE_DUMP_CHUNK
+                             * (map->key_size + map->value_size));
+        int n;
+
+        memset(&cursor, 0, sizeof cursor);
+        do {
+            const char *datap = data;
+
+            n = ubpf_map_dump_next(map, &cursor, DP_TABLE_DUMP_CHUNK, data);
+            for (int i = 0; i < n; i++) {
+                datap = dp_table_query_entry__(prog, map, p4info_table_id,
+                                               datap, entries);
+            }
+            /* Let RCU make progress in the middle of a long dump. */
+            ovsrcu_quiesce();
+        } while (n == DP_TABLE_DUMP_CHUNK);
+        free(data);
+
+        return 0;
+    }
+
     unsigned int data_size = ubpf_map_size(map) * (map->key_size + map->value_size);
     char *data = xzalloc(data_size);
-    char *datap = data;
+    const char *datap = data;
     int nr_entries = ubpf_map_dump(map, data);
 
     for (int i = 0; i < nr_entries; i++) {
-        struct p4rtutil_table_entry *entry = xmalloc(sizeof *entry);
-
-        char *key = alloc_and_swap(datap, map->key_size, map->key_size - pi_p4info_table_match_key_size(prog->p4info, p4info_table_id));
-        datap = datap + map->key_size;
-
-        // TODO: do we need to allocate new memory for action_id?
-        uint32_t *action_id = (uint32_t *) alloc_and_swap(datap, sizeof(uint32_t), 0);
-        datap = datap + sizeof(*action_id);
-
-        char *action_data = alloc_and_swap(datap, map->value_size - sizeof *action_id, 0);
-        datap = datap + (map->value_size - sizeof *action_id);
-
-        entry->handle_id = 0; /* don't define any */
-        entry->priority = 0; /* set 0 by default */
-        entry->match_key = key;
-        entry->table_id = p4info_table_id;
-        entry->action_id = get_p4info_action_id(prog, *action_id);
-        entry->action_data = action_data;
-
-        ovs_list_push_back(entries, &entry->list_node);
-        free(action_id);
+        datap = dp_table_query_entry__(prog, map, p4info_table_id, datap,
+                                       entries);
     }
 
     free(data);
@@ -924,7 +2389,7 @@ dp_table_query(struct dpif *dpif OVS_UNUSED, uint32_t prog_id,
 
 static int
 dp_table_entry_del(struct dpif *dpif OVS_UNUSED, uint32_t prog_id,
-                   uint32_t table_id,
+                   uint32_t table_id, uint32_t priority,
                    const char *match_key,
                    size_t key_size OVS_UNUSED)
 {
@@ -955,14 +2420,28 @@ dp_table_entry_del(struct dpif *dpif OVS_UNUSED, uint32_t prog_id,
         return EEXIST;
     }
 
-    void *key = (void *) build_key(prog->p4info, p4info_table_id, map, match_key);
+    ovs_mutex_lock(&dp_staging_mutex);
+    void *key = (void *) build_key(prog->p4info, p4info_table_id, map,
+                                   match_key, priority, &dp_staging_arena);
     error = ubpf_map_delete(map, key);
-    free(key);
     if (error) {
+        p4rt_arena_reset(&dp_staging_arena);
+        ovs_mutex_unlock(&dp_staging_mutex);
         VLOG_ERR("ubpf: the delete_map() operation failed (status=%d).", error);
         /* FIXME: not sure what to return. */
         return -1;
     }
+    ubpf_emc_invalidate();
+
+    p4rt_offload_entry_del(&(struct p4rt_offload_entry) {
+        .prog_id = prog_id,
+        .table_id = table_id,
+        .match_type = map->type,
+        .key = key,
+        .key_size = map_control_key_size(map),
+    });
+    p4rt_arena_reset(&dp_staging_arena);
+    ovs_mutex_unlock(&dp_staging_mutex);
 
     return 0;
 }
@@ -1050,4 +2529,12 @@ const struct dpif_class dpif_ubpf_class = {
         dp_table_entry_get_default,
         dp_table_query,
         dp_table_entry_del,
+        dp_table_entry_add_batch,
+        dp_counter_query,
+        dp_act_prof_member_create,
+        dp_act_prof_member_modify,
+        dp_act_prof_member_del,
+        dp_act_prof_group_create,
+        dp_act_prof_group_set,
+        dp_act_prof_group_del,
 };
@@ -1273,6 +1273,8 @@ dpif_execute_helper_cb(void *aux_, struct dp_packet_batch *packets_,
     case OVS_ACTION_ATTR_UNSPEC:
     case OVS_ACTION_ATTR_CHECK_PKT_LEN:
     case OVS_ACTION_ATTR_DROP:
+    case OVS_ACTION_ATTR_STICKY_LEARN:
+    case OVS_ACTION_ATTR_STICKY_LOOKUP:
     case __OVS_ACTION_ATTR_MAX:
         OVS_NOT_REACHED();
     }
@@ -1374,6 +1376,8 @@ dpif_operate(struct dpif *dpif, struct dpif_op **ops, size_t n_ops,
                     struct dpif_flow_put *put = &op->flow_put;
 
                     COVERAGE_INC(dpif_flow_put);
+                    OVS_USDT_PROBE(dpif_operate, flow_put, dpif, put,
+                                   put->ufid, error);
                     log_flow_put_message(dpif, &this_module, put, error);
                     if (error && put->stats) {
                         memset(put->stats, 0, sizeof *put->stats);
@@ -18,6 +18,23 @@
 #include <string.h>
 #include "unaligned.h"
 
+/* On x86-64 builds that were not compiled with -msse4.2, hash_words() and
+ * hash_words64() below dispatch at run time to CRC32-based implementations
+ * when the CPU supports SSE4.2.  The choice is made in a constructor,
+ * before any thread exists, so every thread in the process hashes the same
+ * way.  Builds compiled with -msse4.2 inline the CRC32 code from hash.h
+ * directly into these functions and skip the indirection.
+ *
+ * hash_bytes() is deliberately left out of the dispatch: it feeds
+ * externally visible orderings (ovsdb string and row hashing, for one), so
+ * its values must depend only on how the tree was built, never on the CPU
+ * the binary happens to run on. */
+#if defined(__x86_64__) && !defined(__SSE4_2__) \
+    && (defined(__clang__) || __GNUC__ >= 5)
+#define HASH_RUNTIME_DISPATCH 1
+#include <nmmintrin.h>
+#endif
+
 /* Returns the hash of 'a', 'b', and 'c'. */
 uint32_t
 hash_3words(uint32_t a, uint32_t b, uint32_t c)
@@ -26,8 +43,8 @@ hash_3words(uint32_t a, uint32_t b, uint32_t c)
 }
 
 /* Returns the hash of the 'n' bytes at 'p', starting from 'basis'. */
-uint32_t
-hash_bytes(const void *p_, size_t n, uint32_t basis)
+static uint32_t
+hash_bytes_generic(const void *p_, size_t n, uint32_t basis)
 {
     const uint32_t *p = p_;
     size_t orig_n = n;
@@ -50,6 +67,70 @@ hash_bytes(const void *p_, size_t n, uint32_t basis)
     return hash_finish(hash, orig_n);
 }
 
+#ifdef HASH_RUNTIME_DISPATCH
+
+/* CRC32 versions of the out-of-line hash functions.  These match the
+ * values the hash.h inline code produces on an -msse4.2 build: hash_add()
+ * per word and then hash_finish() against the byte count. */
+
+static uint32_t __attribute__((__target__("sse4.2")))
+hash_words_crc32(const uint32_t p[], size_t n_words, uint32_t basis)
+{
+    uint32_t hash = basis;
+    size_t i;
+
+    for (i = 0; i < n_words; i++) {
+        hash = _mm_crc32_u32(hash, p[i]);
+    }
+
+    return _mm_crc32_u64(hash, n_words * 4) * 0x805204f3;
+}
+
+static uint32_t __attribute__((__target__("sse4.2")))
+hash_words64_crc32(const uint64_t p[], size_t n_words, uint32_t basis)
+{
+    uint32_t hash = basis;
+    size_t i;
+
+    for (i = 0; i < n_words; i++) {
+        hash = _mm_crc32_u64(hash, p[i]);
+    }
+
+    return _mm_crc32_u64(hash, n_words * 8) * 0x805204f3;
+}
+
+static uint32_t
+hash_words_generic(const uint32_t p[], size_t n_words, uint32_t basis)
+{
+    return hash_words_inline(p, n_words, basis);
+}
+
+static uint32_t
+hash_words64_generic(const uint64_t p[], size_t n_words, uint32_t basis)
+{
+    return hash_words64_inline(p, n_words, basis);
+}
+
+static uint32_t (*hash_words_impl)(const uint32_t[], size_t, uint32_t)
+    = hash_words_generic;
+static uint32_t (*hash_words64_impl)(const uint64_t[], size_t, uint32_t)
+    = hash_words64_generic;
+
+OVS_CONSTRUCTOR(hash_select_impl) {
+    if (__builtin_cpu_supports("sse4.2")) {
+        hash_words_impl = hash_words_crc32;
+        hash_words64_impl = hash_words64_crc32;
+    }
+}
+
+#endif /* HASH_RUNTIME_DISPATCH */
+
+uint32_t
+hash_bytes(const void *p_, size_t n, uint32_t basis)
+{
+    return hash_bytes_generic(p_, n, basis);
+}
+
 uint32_t
 hash_double(double x, uint32_t basis)
 {
@@ -63,13 +144,21 @@ hash_double(double x, uint32_t basis)
 uint32_t
 hash_words__(const uint32_t p[], size_t n_words, uint32_t basis)
 {
+#ifdef HASH_RUNTIME_DISPATCH
+    return hash_words_impl(p, n_words, basis);
+#else
     return hash_words_inline(p, n_words, basis);
+#endif
 }
 
 uint32_t
 hash_words64__(const uint64_t p[], size_t n_words, uint32_t basis)
 {
+#ifdef HASH_RUNTIME_DISPATCH
+    return hash_words64_impl(p, n_words, basis);
+#else
     return hash_words64_inline(p, n_words, basis);
+#endif
 }
 
 #if !(defined(__x86_64__)) && !(defined(__aarch64__))
@@ -406,14 +406,18 @@ ipf_reassemble_v4_frags(struct ipf_list *ipf_list)
     /* OVS_REQUIRES(ipf_lock) */
 {
     struct ipf_frag *frag_list = ipf_list->frag_list;
-    struct dp_packet *pkt = dp_packet_clone(frag_list[0].pkt);
+    int rest_len = frag_list[ipf_list->last_inuse_idx].end_data_byte -
+                   frag_list[1].start_data_byte + 1;
+
+    /* Clone the first fragment into a buffer already sized for the whole
+     * datagram, so that its bytes are copied only once; growing a plain
+     * clone would copy them a second time on reallocation. */
+    struct dp_packet *pkt = dp_packet_clone_with_tailroom(frag_list[0].pkt,
+                                                          rest_len);
     dp_packet_set_size(pkt, dp_packet_size(pkt) - dp_packet_l2_pad_size(pkt));
     struct ip_header *l3 = dp_packet_l3(pkt);
     int len = ntohs(l3->ip_tot_len);
 
-    int rest_len = frag_list[ipf_list->last_inuse_idx].end_data_byte -
-                   frag_list[1].start_data_byte + 1;
-
     if (len + rest_len > IPV4_PACKET_MAX_SIZE) {
         ipf_print_reass_packet(
             "Unsupported big reassembled v4 packet; v4 hdr:", l3);
@@ -421,8 +425,6 @@ ipf_reassemble_v4_frags(struct ipf_list *ipf_list)
         return NULL;
     }
 
-    dp_packet_prealloc_tailroom(pkt, rest_len);
-
     for (int i = 1; i <= ipf_list->last_inuse_idx; i++) {
         size_t add_len = frag_list[i].end_data_byte -
                          frag_list[i].start_data_byte + 1;
@@ -453,14 +455,18 @@ ipf_reassemble_v6_frags(struct ipf_list *ipf_list)
     /* OVS_REQUIRES(ipf_lock) */
 {
     struct ipf_frag *frag_list = ipf_list->frag_list;
-    struct dp_packet *pkt = dp_packet_clone(frag_list[0].pkt);
+    int rest_len = frag_list[ipf_list->last_inuse_idx].end_data_byte -
+                   frag_list[1].start_data_byte + 1;
+
+    /* Clone the first fragment into a buffer already sized for the whole
+     * datagram, so that its bytes are copied only once; growing a plain
+     * clone would copy them a second time on reallocation. */
+    struct dp_packet *pkt = dp_packet_clone_with_tailroom(frag_list[0].pkt,
+                                                          rest_len);
     dp_packet_set_size(pkt, dp_packet_size(pkt) - dp_packet_l2_pad_size(pkt));
     struct  ovs_16aligned_ip6_hdr *l3 = dp_packet_l3(pkt);
     int pl = ntohs(l3->ip6_plen) - sizeof(struct ovs_16aligned_ip6_frag);
 
-    int rest_len = frag_list[ipf_list->last_inuse_idx].end_data_byte -
-                   frag_list[1].start_data_byte + 1;
-
     if (pl + rest_len > IPV6_PACKET_MAX_DATA) {
         ipf_print_reass_packet(
              "Unsupported big reassembled v6 packet; v6 hdr:", l3);
@@ -468,8 +474,6 @@ ipf_reassemble_v6_frags(struct ipf_list *ipf_list)
         return NULL;
     }
 
-    dp_packet_prealloc_tailroom(pkt, rest_len);
-
     for (int i = 1; i <= ipf_list->last_inuse_idx; i++) {
         size_t add_len = frag_list[i].end_data_byte -
                           frag_list[i].start_data_byte + 1;
@@ -23,6 +23,9 @@
 #include <float.h>
 #include <limits.h>
 #include <string.h>
+#if __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "openvswitch/dynamic-string.h"
 #include "hash.h"
@@ -965,6 +968,73 @@ json_lex_string(struct json_parser *p)
     }
 }
 
+/* Returns the number of bytes at the start of the 'n' bytes in 'p' that are
+ * literal quoted-string content, that is, the length of the prefix that
+ * contains no '"', no '\', and no control character.  Any of those must be
+ * examined by the lexer state machine itself; everything before them can be
+ * consumed in bulk.
+ *
+ * This is the scanning half of the lexer's fast path: OVSDB messages are
+ * dominated by string content, so classifying 16 (or 8) bytes at a time here
+ * is much cheaper than pushing every byte through json_lex_input(). */
+static size_t
+json_scan_string_span(const char *s_, size_t n)
+{
+    const unsigned char *s = (const unsigned char *) s_;
+    size_t i = 0;
+
+#if __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i max_ctrl = _mm_set1_epi8(0x1f);
+
+    while (i + 16 <= n) {
+        __m128i w = _mm_loadu_si128((const __m128i *) (s + i));
+        __m128i hit = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(w, quote),
+                         _mm_cmpeq_epi8(w, backslash)),
+            _mm_cmpeq_epi8(_mm_min_epu8(w, max_ctrl), w));
+        int mask = _mm_movemask_epi8(hit);
+        if (mask) {
+            return i + ctz32(mask);
+        }
+        i += 16;
+    }
+#elif !defined(__CHECKER__)
+    /* SWAR fallback: the classic "haszero"/"hasless" classifiers flag each
+     * interesting byte with 0x80.  Borrows in the subtractions can only smear
+     * flags upward past a real hit, so the lowest flagged byte is always a
+     * true hit. */
+    const uint64_t ones = UINT64_C(0x0101010101010101);
+    const uint64_t highs = UINT64_C(0x8080808080808080);
+
+    while (i + 8 <= n) {
+        uint64_t w;
+        memcpy(&w, s + i, sizeof w);
+
+        uint64_t quotes = w ^ (ones * '"');
+        uint64_t backslashes = w ^ (ones * '\\');
+        uint64_t found = ((((quotes - ones) & ~quotes)
+                           | ((backslashes - ones) & ~backslashes)
+                           | ((w - ones * 0x20) & ~w))
+                          & highs);
+        if (found) {
+            return i + ctz64(found) / 8;
+        }
+        i += 8;
+    }
+#endif
+
+    while (i < n) {
+        unsigned char c = s[i];
+        if (c == '"' || c == '\\' || c < 0x20) {
+            break;
+        }
+        i++;
+    }
+    return i;
+}
+
 static bool
 json_lex_input(struct json_parser *p, unsigned char c)
 {
@@ -1146,6 +1216,20 @@ json_parser_feed(struct json_parser *p, const char *input, size_t n)
 {
     size_t i;
     for (i = 0; !p->done && i < n; ) {
+        if (p->lex_state == JSON_LEX_STRING) {
+            /* Bulk-consume literal string content, leaving quotes,
+             * backslashes, and control characters to the state machine.  A
+             * valid span cannot contain a new-line (it would have to be
+             * escaped), so only the column counter advances. */
+            size_t span = json_scan_string_span(input + i, n - i);
+            if (span) {
+                ds_put_buffer(&p->buffer, input + i, span);
+                p->byte_number += span;
+                p->column_number += span;
+                i += span;
+                continue;
+            }
+        }
         if (json_lex_input(p, input[i])) {
             p->byte_number++;
             if (input[i] == '\n') {
@@ -1513,6 +1597,57 @@ json_to_string(const struct json *json, int flags)
     return ds_steal_cstr(&ds);
 }
 
+/* Returns an estimate of the number of bytes that json_to_ds() would produce
+ * for 'json' without JSSF_PRETTY.  The estimate is cheap and usually a slight
+ * underestimate (escape sequences and long numbers take more room), so it is
+ * suitable for pre-sizing an output buffer, not for allocating an exact
+ * one. */
+size_t
+json_serialized_length(const struct json *json)
+{
+    switch (json->type) {
+    case JSON_NULL:
+    case JSON_TRUE:
+        return 4;
+
+    case JSON_FALSE:
+        return 5;
+
+    case JSON_OBJECT: {
+        const struct shash_node *node;
+        size_t n = 2;
+
+        SHASH_FOR_EACH (node, json->object) {
+            /* Quotes and colon around the member name, plus a comma. */
+            n += strlen(node->name) + 4;
+            n += json_serialized_length(node->data);
+        }
+        return n;
+    }
+
+    case JSON_ARRAY: {
+        size_t n = 2 + json->array.n;
+        size_t i;
+
+        for (i = 0; i < json->array.n; i++) {
+            n += json_serialized_length(json->array.elems[i]);
+        }
+        return n;
+    }
+
+    case JSON_INTEGER:
+    case JSON_REAL:
+        return 20;
+
+    case JSON_STRING:
+        return strlen(json->string) + 2;
+
+    case JSON_N_TYPES:
+    default:
+        OVS_NOT_REACHED();
+    }
+}
+
 /* Same as json_to_string(), but the output is appended to 'ds'. */
 void
 json_to_ds(const struct json *json, int flags, struct ds *ds)
@@ -1694,13 +1829,24 @@ static const char *chars_escaping[256] = {
 static void
 json_serialize_string(const char *string, struct ds *ds)
 {
-    uint8_t c;
+    size_t n = strlen(string);
+    size_t i = 0;
     uint8_t c2;
     const char *escape;
 
     ds_put_char(ds, '"');
-    while ((c = *string++) != '\0') {
-        escape = chars_escaping[c];
+    while (i < n) {
+        /* The bytes that need escaping are exactly the ones that the lexer's
+         * bulk classifier stops at, so reuse it to copy clean spans
+         * wholesale. */
+        size_t span = json_scan_string_span(string + i, n - i);
+        if (span) {
+            ds_put_buffer(ds, string + i, span);
+            i += span;
+            continue;
+        }
+
+        escape = chars_escaping[(uint8_t) string[i++]];
         while ((c2 = *escape++) != '\0') {
             ds_put_char(ds, c2);
         }
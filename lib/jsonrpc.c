@@ -19,19 +19,24 @@
 #include "jsonrpc.h"
 
 #include <errno.h>
+#include <sys/uio.h>
 
 #include "byteq.h"
 #include "openvswitch/dynamic-string.h"
 #include "fatal-signal.h"
 #include "openvswitch/json.h"
 #include "openvswitch/list.h"
+#include "malloc-cache.h"
 #include "openvswitch/ofpbuf.h"
+#include "ovs-rcu.h"
 #include "ovs-thread.h"
 #include "openvswitch/poll-loop.h"
 #include "reconnect.h"
+#include "seq.h"
 #include "stream.h"
 #include "svec.h"
 #include "timeval.h"
+#include "uuid.h"
 #include "openvswitch/vlog.h"
 
 VLOG_DEFINE_THIS_MODULE(jsonrpc);
@@ -45,20 +50,590 @@ struct jsonrpc {
     struct byteq input;
     uint8_t input_buffer[4096];
     struct json_parser *parser;
+    struct ofpbuf *bin_input;   /* Binary frame being reassembled, if any. */
+    size_t bin_length;          /* Its payload length, once the header is
+                                 * complete. */
 
     /* Output. */
     struct ovs_list output;     /* Contains "struct ofpbuf"s. */
     size_t output_count;        /* Number of elements in "output". */
     size_t backlog;
+
+    /* Threaded serialization (see jsonrpc_set_threaded()). */
+    bool threaded;
+    struct ovs_list ser_queue;  /* Contains "struct jsonrpc_ser_task"s in
+                                 * submission order. */
+
+    /* Binary encoding (see jsonrpc_set_binary()). */
+    bool binary;                /* Send messages in binary frames? */
 };
 
 /* Rate limit for error messages. */
 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 5);
 
 static struct jsonrpc_msg *jsonrpc_parse_received_message(struct jsonrpc *);
+static int jsonrpc_send__(struct jsonrpc *, struct jsonrpc_msg *, bool prio);
+static void jsonrpc_bin_frame_to_ds(const struct json *, struct ds *);
+static size_t jsonrpc_bin_input(struct jsonrpc *, const uint8_t *, size_t,
+                                struct jsonrpc_msg **);
 static void jsonrpc_cleanup(struct jsonrpc *);
 static void jsonrpc_error(struct jsonrpc *, int error);
 
+/* Threaded serialization.
+ *
+ * Serializing an outbound message is pure CPU work on immutable data, so a
+ * connection can optionally hand it to a small shared pool of worker threads.
+ * This pays off for servers that fan large messages out to many connections,
+ * such as ovsdb-server sending monitor updates, where otherwise one big
+ * serialization delays every other session.  Per-connection message order is
+ * preserved by completing each connection's queue strictly from the head.
+ * Database access and everything else stays on the caller's thread. */
+struct jsonrpc_ser_task {
+    struct ovs_list queue_node;   /* In 'rpc->ser_queue'. */
+    struct ovs_list pool_node;    /* In 'ser_pool_queue' until taken. */
+    struct json *json;            /* Message to serialize; owned by task. */
+    bool binary;                  /* Serialize as a binary frame? */
+    size_t estimate;              /* Backlog charged when submitted. */
+    struct ds output;             /* Result, valid once state is DONE. */
+    enum {
+        SER_TASK_QUEUED,          /* Waiting for a worker. */
+        SER_TASK_RUNNING,         /* A worker is serializing it. */
+        SER_TASK_DONE             /* 'output' is ready. */
+    } state;
+};
+
+static struct ovs_mutex ser_pool_mutex = OVS_MUTEX_INITIALIZER;
+static struct ovs_list ser_pool_queue OVS_GUARDED_BY(ser_pool_mutex)
+    = OVS_LIST_INITIALIZER(&ser_pool_queue);
+static pthread_cond_t ser_pool_work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t ser_pool_done_cond = PTHREAD_COND_INITIALIZER;
+static struct seq *ser_pool_done_seq;
+
+static void *
+jsonrpc_ser_thread(void *arg OVS_UNUSED)
+{
+    /* The workers only touch their own tasks' data, so they can remain
+     * quiescent for their whole lifetime. */
+    ovsrcu_quiesce_start();
+
+    for (;;) {
+        struct jsonrpc_ser_task *task;
+
+        ovs_mutex_lock(&ser_pool_mutex);
+        while (ovs_list_is_empty(&ser_pool_queue)) {
+            ovs_mutex_cond_wait(&ser_pool_work_cond, &ser_pool_mutex);
+        }
+        task = CONTAINER_OF(ovs_list_pop_front(&ser_pool_queue),
+                            struct jsonrpc_ser_task, pool_node);
+        task->state = SER_TASK_RUNNING;
+        ovs_mutex_unlock(&ser_pool_mutex);
+
+        ds_reserve(&task->output, task->estimate);
+        if (task->binary) {
+            jsonrpc_bin_frame_to_ds(task->json, &task->output);
+        } else {
+            json_to_ds(task->json, 0, &task->output);
+        }
+
+        ovs_mutex_lock(&ser_pool_mutex);
+        task->state = SER_TASK_DONE;
+        xpthread_cond_broadcast(&ser_pool_done_cond);
+        ovs_mutex_unlock(&ser_pool_mutex);
+        seq_change(ser_pool_done_seq);
+    }
+    return NULL;
+}
+
+static void
+jsonrpc_ser_pool_init(void)
+{
+    static struct ovsthread_once once = OVSTHREAD_ONCE_INITIALIZER;
+
+    if (ovsthread_once_start(&once)) {
+        int n_threads = MIN(4, MAX(2, count_cpu_cores() / 2));
+
+        ser_pool_done_seq = seq_create();
+        for (int i = 0; i < n_threads; i++) {
+            ovs_thread_create("jsonrpc_ser", jsonrpc_ser_thread, NULL);
+        }
+        ovsthread_once_done(&once);
+    }
+}
+
+static void
+jsonrpc_ser_submit(struct jsonrpc *rpc, struct json *json)
+{
+    struct jsonrpc_ser_task *task = xzalloc(sizeof *task);
+    task->json = json;
+    task->binary = rpc->binary;
+    task->estimate = json_serialized_length(json);
+    ds_init(&task->output);
+    task->state = SER_TASK_QUEUED;
+    ovs_list_push_back(&rpc->ser_queue, &task->queue_node);
+    rpc->backlog += task->estimate;
+
+    ovs_mutex_lock(&ser_pool_mutex);
+    ovs_list_push_back(&ser_pool_queue, &task->pool_node);
+    xpthread_cond_signal(&ser_pool_work_cond);
+    ovs_mutex_unlock(&ser_pool_mutex);
+}
+
+/* Moves 'rpc''s finished serializations, in order, onto its output queue,
+ * stopping at the first task that is still in progress. */
+static void
+jsonrpc_ser_reap(struct jsonrpc *rpc)
+{
+    if (ovs_list_is_empty(&rpc->ser_queue)) {
+        return;
+    }
+
+    ovs_mutex_lock(&ser_pool_mutex);
+    while (!ovs_list_is_empty(&rpc->ser_queue)) {
+        struct jsonrpc_ser_task *task
+            = CONTAINER_OF(rpc->ser_queue.next, struct jsonrpc_ser_task,
+                           queue_node);
+        if (task->state != SER_TASK_DONE) {
+            break;
+        }
+        ovs_list_remove(&task->queue_node);
+        ovs_mutex_unlock(&ser_pool_mutex);
+
+        rpc->backlog += task->output.length;
+        rpc->backlog -= task->estimate;
+        json_destroy(task->json);
+
+        struct ofpbuf *buf = malloc_cache_alloc_fixed(sizeof *buf);
+        ofpbuf_use_ds(buf, &task->output);
+        ovs_list_push_back(&rpc->output, &buf->list_node);
+        rpc->output_count++;
+        free(task);
+
+        ovs_mutex_lock(&ser_pool_mutex);
+    }
+    ovs_mutex_unlock(&ser_pool_mutex);
+}
+
+/* Discards 'rpc''s outstanding serializations, waiting out any that a worker
+ * has already picked up. */
+static void
+jsonrpc_ser_drain(struct jsonrpc *rpc)
+{
+    struct jsonrpc_ser_task *task, *next;
+
+    if (ovs_list_is_empty(&rpc->ser_queue)) {
+        return;
+    }
+
+    ovs_mutex_lock(&ser_pool_mutex);
+    LIST_FOR_EACH (task, queue_node, &rpc->ser_queue) {
+        if (task->state == SER_TASK_QUEUED) {
+            ovs_list_remove(&task->pool_node);
+            task->state = SER_TASK_DONE;
+        }
+    }
+    for (;;) {
+        bool busy = false;
+        LIST_FOR_EACH (task, queue_node, &rpc->ser_queue) {
+            if (task->state == SER_TASK_RUNNING) {
+                busy = true;
+                break;
+            }
+        }
+        if (!busy) {
+            break;
+        }
+        ovs_mutex_cond_wait(&ser_pool_done_cond, &ser_pool_mutex);
+    }
+    ovs_mutex_unlock(&ser_pool_mutex);
+
+    LIST_FOR_EACH_SAFE (task, next, queue_node, &rpc->ser_queue) {
+        ovs_list_remove(&task->queue_node);
+        json_destroy(task->json);
+        ds_destroy(&task->output);
+        free(task);
+    }
+}
+
+/* Makes 'rpc' serialize outbound messages in a shared pool of worker threads
+ * instead of inline in jsonrpc_send().  Message order and the wire format are
+ * unchanged. */
+void
+jsonrpc_set_threaded(struct jsonrpc *rpc)
+{
+    jsonrpc_ser_pool_init();
+    rpc->threaded = true;
+}
+
+/* Binary message encoding.
+ *
+ * A peer that has negotiated it (see jsonrpc_set_binary()) may send a message
+ * as a binary frame instead of text JSON: one JSONRPC_BINARY_TAG byte, a
+ * 32-bit big-endian payload length, and a compact type-tagged encoding of the
+ * message's JSON.  Text JSON always begins with '{', so the tag byte lets a
+ * receiver tell the two formats apart at every message boundary, and binary
+ * frames are therefore always accepted, whether or not they were negotiated.
+ * The encoding avoids the quoting, escaping, and number formatting that
+ * dominate the cost of text JSON, and sends UUID-formatted strings, which
+ * make up much of OVSDB traffic, as 16 raw bytes. */
+
+#define JSONRPC_BINARY_TAG 0x01 /* First byte of a binary frame. */
+#define JSONRPC_BINARY_HEADER 5 /* Tag byte plus 32-bit payload length. */
+
+enum bin_json_tag {
+    BIN_JSON_NULL,              /* No payload. */
+    BIN_JSON_FALSE,             /* No payload. */
+    BIN_JSON_TRUE,              /* No payload. */
+    BIN_JSON_INTEGER,           /* Zigzag varint. */
+    BIN_JSON_REAL,              /* 8 bytes, IEEE 754 double, big-endian. */
+    BIN_JSON_STRING,            /* Varint length followed by bytes. */
+    BIN_JSON_UUID,              /* 16 bytes, a string in UUID format. */
+    BIN_JSON_ARRAY,             /* Varint count followed by elements. */
+    BIN_JSON_OBJECT             /* Varint count followed by pairs of varint
+                                 * length plus bytes (the key) and value. */
+};
+
+/* Nesting deeper than this is rejected, as in the text parser, to bound the
+ * decoder's recursion. */
+#define BIN_JSON_MAX_DEPTH 1000
+
+static void
+bin_json_put_varint(struct ds *ds, uint64_t x)
+{
+    while (x >= 0x80) {
+        ds_put_char(ds, (x & 0x7f) | 0x80);
+        x >>= 7;
+    }
+    ds_put_char(ds, x);
+}
+
+static void
+bin_json_put_u32(struct ds *ds, uint32_t x)
+{
+    uint8_t b[4] = { x >> 24, x >> 16, x >> 8, x };
+    ds_put_buffer(ds, (const char *) b, sizeof b);
+}
+
+static void
+bin_json_put_string(struct ds *ds, enum bin_json_tag tag, const char *s)
+{
+    size_t length = strlen(s);
+
+    ds_put_char(ds, tag);
+    bin_json_put_varint(ds, length);
+    ds_put_buffer(ds, s, length);
+}
+
+static void
+bin_json_to_ds(const struct json *json, struct ds *ds)
+{
+    switch (json->type) {
+    case JSON_NULL:
+        ds_put_char(ds, BIN_JSON_NULL);
+        break;
+
+    case JSON_FALSE:
+        ds_put_char(ds, BIN_JSON_FALSE);
+        break;
+
+    case JSON_TRUE:
+        ds_put_char(ds, BIN_JSON_TRUE);
+        break;
+
+    case JSON_INTEGER: {
+        uint64_t v = json_integer(json);
+
+        ds_put_char(ds, BIN_JSON_INTEGER);
+        bin_json_put_varint(ds, (v << 1) ^ (uint64_t) (json_integer(json)
+                                                       >> 63));
+        break;
+    }
+
+    case JSON_REAL: {
+        double real = json_real(json);
+        uint64_t bits;
+
+        memcpy(&bits, &real, sizeof bits);
+        ds_put_char(ds, BIN_JSON_REAL);
+        bin_json_put_u32(ds, bits >> 32);
+        bin_json_put_u32(ds, bits);
+        break;
+    }
+
+    case JSON_STRING: {
+        const char *s = json_string(json);
+        struct uuid uuid;
+
+        if (strlen(s) == UUID_LEN && uuid_from_string(&uuid, s)) {
+            ds_put_char(ds, BIN_JSON_UUID);
+            for (size_t i = 0; i < 4; i++) {
+                bin_json_put_u32(ds, uuid.parts[i]);
+            }
+        } else {
+            bin_json_put_string(ds, BIN_JSON_STRING, s);
+        }
+        break;
+    }
+
+    case JSON_ARRAY: {
+        const struct json_array *array = json_array(json);
+
+        ds_put_char(ds, BIN_JSON_ARRAY);
+        bin_json_put_varint(ds, array->n);
+        for (size_t i = 0; i < array->n; i++) {
+            bin_json_to_ds(array->elems[i], ds);
+        }
+        break;
+    }
+
+    case JSON_OBJECT: {
+        const struct shash *object = json_object(json);
+        const struct shash_node *node;
+
+        ds_put_char(ds, BIN_JSON_OBJECT);
+        bin_json_put_varint(ds, shash_count(object));
+        SHASH_FOR_EACH (node, object) {
+            size_t length = strlen(node->name);
+
+            bin_json_put_varint(ds, length);
+            ds_put_buffer(ds, node->name, length);
+            bin_json_to_ds(node->data, ds);
+        }
+        break;
+    }
+
+    case JSON_N_TYPES:
+    default:
+        OVS_NOT_REACHED();
+    }
+}
+
+/* Appends 'json' to 'ds' as a complete binary frame. */
+static void
+jsonrpc_bin_frame_to_ds(const struct json *json, struct ds *ds)
+{
+    size_t start = ds->length;
+
+    ds_put_char(ds, JSONRPC_BINARY_TAG);
+    bin_json_put_u32(ds, 0);
+    bin_json_to_ds(json, ds);
+
+    uint32_t length = ds->length - start - JSONRPC_BINARY_HEADER;
+    uint8_t *header = (uint8_t *) &ds->string[start + 1];
+    header[0] = length >> 24;
+    header[1] = length >> 16;
+    header[2] = length >> 8;
+    header[3] = length;
+}
+
+struct bin_json_decoder {
+    const uint8_t *p;           /* Next byte to decode. */
+    const uint8_t *end;         /* One past the last byte. */
+    const char *error;          /* First error, or NULL. */
+};
+
+static struct json *bin_json_decode(struct bin_json_decoder *, int depth);
+
+static bool
+bin_json_get_varint(struct bin_json_decoder *d, uint64_t *x)
+{
+    int shift = 0;
+
+    *x = 0;
+    while (d->p < d->end) {
+        uint8_t b = *d->p++;
+
+        if (shift >= 64 || (shift == 63 && b > 1)) {
+            d->error = "varint overflow";
+            return false;
+        }
+        *x |= (uint64_t) (b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            return true;
+        }
+        shift += 7;
+    }
+    d->error = "truncated varint";
+    return false;
+}
+
+static bool
+bin_json_get_u32(struct bin_json_decoder *d, uint32_t *x)
+{
+    if (d->end - d->p < 4) {
+        d->error = "truncated value";
+        return false;
+    }
+    *x = ((uint32_t) d->p[0] << 24 | (uint32_t) d->p[1] << 16
+          | (uint32_t) d->p[2] << 8 | d->p[3]);
+    d->p += 4;
+    return true;
+}
+
+static char *
+bin_json_get_string(struct bin_json_decoder *d)
+{
+    uint64_t length;
+
+    if (!bin_json_get_varint(d, &length)) {
+        return NULL;
+    }
+    if (length > (uint64_t) (d->end - d->p)) {
+        d->error = "truncated string";
+        return NULL;
+    }
+
+    char *s = xmemdup0((const char *) d->p, length);
+    d->p += length;
+    return s;
+}
+
+static struct json *
+bin_json_decode(struct bin_json_decoder *d, int depth)
+{
+    if (d->p >= d->end) {
+        d->error = "truncated value";
+        return NULL;
+    }
+
+    uint8_t tag = *d->p++;
+    switch ((enum bin_json_tag) tag) {
+    case BIN_JSON_NULL:
+        return json_null_create();
+
+    case BIN_JSON_FALSE:
+        return json_boolean_create(false);
+
+    case BIN_JSON_TRUE:
+        return json_boolean_create(true);
+
+    case BIN_JSON_INTEGER: {
+        uint64_t zigzag;
+
+        if (!bin_json_get_varint(d, &zigzag)) {
+            return NULL;
+        }
+        return json_integer_create((int64_t) (zigzag >> 1)
+                                   ^ -(int64_t) (zigzag & 1));
+    }
+
+    case BIN_JSON_REAL: {
+        uint32_t hi, lo;
+        uint64_t bits;
+        double real;
+
+        if (!bin_json_get_u32(d, &hi) || !bin_json_get_u32(d, &lo)) {
+            return NULL;
+        }
+        bits = (uint64_t) hi << 32 | lo;
+        memcpy(&real, &bits, sizeof real);
+        return json_real_create(real);
+    }
+
+    case BIN_JSON_STRING: {
+        char *s = bin_json_get_string(d);
+
+        return s ? json_string_create_nocopy(s) : NULL;
+    }
+
+    case BIN_JSON_UUID: {
+        struct uuid uuid;
+
+        for (size_t i = 0; i < 4; i++) {
+            if (!bin_json_get_u32(d, &uuid.parts[i])) {
+                return NULL;
+            }
+        }
+        return json_string_create_nocopy(xasprintf(UUID_FMT,
+                                                   UUID_ARGS(&uuid)));
+    }
+
+    case BIN_JSON_ARRAY: {
+        uint64_t n;
+
+        if (depth >= BIN_JSON_MAX_DEPTH) {
+            d->error = "too deeply nested";
+            return NULL;
+        }
+        if (!bin_json_get_varint(d, &n)) {
+            return NULL;
+        }
+
+        struct json *array = json_array_create_empty();
+        for (uint64_t i = 0; i < n; i++) {
+            struct json *elem = bin_json_decode(d, depth + 1);
+
+            if (!elem) {
+                json_destroy(array);
+                return NULL;
+            }
+            json_array_add(array, elem);
+        }
+        return array;
+    }
+
+    case BIN_JSON_OBJECT: {
+        uint64_t n;
+
+        if (depth >= BIN_JSON_MAX_DEPTH) {
+            d->error = "too deeply nested";
+            return NULL;
+        }
+        if (!bin_json_get_varint(d, &n)) {
+            return NULL;
+        }
+
+        struct json *object = json_object_create();
+        for (uint64_t i = 0; i < n; i++) {
+            char *key = bin_json_get_string(d);
+            struct json *value = key ? bin_json_decode(d, depth + 1) : NULL;
+
+            if (!value) {
+                free(key);
+                json_destroy(object);
+                return NULL;
+            }
+            json_object_put(object, key, value);
+            free(key);
+        }
+        return object;
+    }
+
+    default:
+        d->error = "unknown type tag";
+        return NULL;
+    }
+}
+
+/* Decodes the 'length' bytes of binary frame payload in 'p'.  Returns the
+ * decoded JSON on success, a JSON_STRING describing the problem on failure,
+ * following the json_parser_finish() convention. */
+static struct json *
+bin_json_from_buffer(const void *p, size_t length)
+{
+    struct bin_json_decoder d = {
+        .p = p,
+        .end = (const uint8_t *) p + length,
+    };
+
+    struct json *json = bin_json_decode(&d, 0);
+    if (json && d.p != d.end) {
+        json_destroy(json);
+        json = NULL;
+        d.error = "trailing garbage in binary frame";
+    }
+    return json ? json : json_string_create(d.error);
+}
+
+/* Configures 'rpc' to send its messages as binary frames.  The peer must have
+ * agreed to this in advance, e.g. with the OVSDB "binary_json" request, since
+ * a peer that predates the format would fail to parse the frames.  Reception
+ * needs no configuration: both formats are always accepted. */
+void
+jsonrpc_set_binary(struct jsonrpc *rpc)
+{
+    rpc->binary = true;
+}
+
 /* This is just the same as stream_open() except that it uses the default
  * JSONRPC port if none is specified. */
 int
@@ -89,6 +664,7 @@ jsonrpc_open(struct stream *stream)
     rpc->stream = stream;
     byteq_init(&rpc->input, rpc->input_buffer, sizeof rpc->input_buffer);
     ovs_list_init(&rpc->output);
+    ovs_list_init(&rpc->ser_queue);
 
     return rpc;
 }
@@ -113,19 +689,40 @@ jsonrpc_run(struct jsonrpc *rpc)
         return;
     }
 
+    jsonrpc_ser_reap(rpc);
+
     stream_run(rpc->stream);
     while (!ovs_list_is_empty(&rpc->output)) {
-        struct ofpbuf *buf = ofpbuf_from_list(rpc->output.next);
+        struct iovec iov[16];
+        size_t n_iov = 0;
+        struct ofpbuf *buf;
         int retval;
 
-        retval = stream_send(rpc->stream, buf->data, buf->size);
+        /* Gather a burst of queued messages, so that they leave in a single
+         * system call where the stream supports scatter/gather output. */
+        LIST_FOR_EACH (buf, list_node, &rpc->output) {
+            iov[n_iov].iov_base = buf->data;
+            iov[n_iov].iov_len = buf->size;
+            if (++n_iov >= ARRAY_SIZE(iov)) {
+                break;
+            }
+        }
+
+        retval = stream_sendv(rpc->stream, iov, n_iov);
         if (retval >= 0) {
             rpc->backlog -= retval;
-            ofpbuf_pull(buf, retval);
-            if (!buf->size) {
-                ovs_list_remove(&buf->list_node);
-                rpc->output_count--;
-                ofpbuf_delete(buf);
+            while (retval > 0) {
+                size_t sent;
+
+                buf = ofpbuf_from_list(rpc->output.next);
+                sent = MIN((size_t) retval, buf->size);
+                ofpbuf_pull(buf, sent);
+                retval -= sent;
+                if (!buf->size) {
+                    ovs_list_remove(&buf->list_node);
+                    rpc->output_count--;
+                    ofpbuf_delete(buf);
+                }
             }
         } else {
             if (retval != -EAGAIN) {
@@ -148,6 +745,25 @@ jsonrpc_wait(struct jsonrpc *rpc)
         if (!ovs_list_is_empty(&rpc->output)) {
             stream_send_wait(rpc->stream);
         }
+        if (!ovs_list_is_empty(&rpc->ser_queue)) {
+            /* Read the sequence number before checking the head task: if the
+             * task completes in between, the sequence change wakes us. */
+            uint64_t seq = seq_read(ser_pool_done_seq);
+            struct jsonrpc_ser_task *head;
+            bool done;
+
+            ovs_mutex_lock(&ser_pool_mutex);
+            head = CONTAINER_OF(rpc->ser_queue.next, struct jsonrpc_ser_task,
+                                queue_node);
+            done = head->state == SER_TASK_DONE;
+            ovs_mutex_unlock(&ser_pool_mutex);
+
+            if (done) {
+                poll_immediate_wake();
+            } else {
+                seq_wait(ser_pool_done_seq, seq);
+            }
+        }
     }
 }
 
@@ -236,6 +852,18 @@ jsonrpc_log_msg(const struct jsonrpc *rpc, const char *title,
  * Always takes ownership of 'msg', regardless of success. */
 int
 jsonrpc_send(struct jsonrpc *rpc, struct jsonrpc_msg *msg)
+{
+    return jsonrpc_send__(rpc, msg, false);
+}
+
+/* Implements jsonrpc_send().  If 'prio' is true, the message is serialized
+ * inline and inserted ahead of all queued output that has not yet reached
+ * the wire, and a transmission attempt is made immediately.  This is for
+ * inactivity probes and their replies: a connection busy sending a giant
+ * message backlog must still answer probes promptly, or the peer declares
+ * it dead and reconnects, making the overload worse. */
+static int
+jsonrpc_send__(struct jsonrpc *rpc, struct jsonrpc_msg *msg, bool prio)
 {
     struct ofpbuf *buf;
     struct json *json;
@@ -250,13 +878,43 @@ jsonrpc_send(struct jsonrpc *rpc, struct jsonrpc_msg *msg)
     jsonrpc_log_msg(rpc, "send", msg);
 
     json = jsonrpc_msg_to_json(msg);
-    json_to_ds(json, 0, &ds);
+
+    if (rpc->threaded && !prio) {
+        /* A worker thread serializes the message; jsonrpc_run() moves the
+         * result onto the output queue in submission order. */
+        jsonrpc_ser_submit(rpc, json);
+        return rpc->status;
+    }
+
+    /* Pre-sizing the buffer avoids copying a large message several times as
+     * the buffer doubles; the ofpbuf below then takes over the buffer without
+     * a further copy.  (The text length is an upper bound for the binary
+     * encoding too.) */
+    ds_reserve(&ds, json_serialized_length(json));
+    if (rpc->binary) {
+        jsonrpc_bin_frame_to_ds(json, &ds);
+    } else {
+        json_to_ds(json, 0, &ds);
+    }
     length = ds.length;
     json_destroy(json);
 
-    buf = xmalloc(sizeof *buf);
+    buf = malloc_cache_alloc_fixed(sizeof *buf);
     ofpbuf_use_ds(buf, &ds);
-    ovs_list_push_back(&rpc->output, &buf->list_node);
+    if (prio && !ovs_list_is_empty(&rpc->output)) {
+        /* A partially transmitted buffer at the head of the queue cannot be
+         * preempted without corrupting the stream, so slot in right after it;
+         * otherwise go to the very front. */
+        struct ofpbuf *head = ofpbuf_from_list(rpc->output.next);
+
+        if (ofpbuf_headroom(head)) {
+            ovs_list_insert(rpc->output.next->next, &buf->list_node);
+        } else {
+            ovs_list_push_front(&rpc->output, &buf->list_node);
+        }
+    } else {
+        ovs_list_push_back(&rpc->output, &buf->list_node);
+    }
     rpc->output_count++;
     rpc->backlog += length;
 
@@ -266,7 +924,7 @@ jsonrpc_send(struct jsonrpc *rpc, struct jsonrpc_msg *msg)
                      rpc->output_count, rpc->backlog);
     }
 
-    if (rpc->backlog == length) {
+    if (rpc->backlog == length || prio) {
         jsonrpc_run(rpc);
     }
     return rpc->status;
@@ -324,11 +982,28 @@ jsonrpc_recv(struct jsonrpc *rpc, struct jsonrpc_msg **msgp)
             byteq_advance_head(&rpc->input, retval);
         }
 
-        /* We have some input.  Feed it into the JSON parser. */
+        /* We have some input.  A binary frame announces itself in its first
+         * byte, which could never start text JSON, so check for one at every
+         * message boundary. */
+        n = byteq_tailroom(&rpc->input);
+        if (rpc->bin_input
+            || (!rpc->parser
+                && *byteq_tail(&rpc->input) == JSONRPC_BINARY_TAG)) {
+            used = jsonrpc_bin_input(rpc, byteq_tail(&rpc->input), n, msgp);
+            byteq_advance_tail(&rpc->input, used);
+            if (*msgp) {
+                return 0;
+            }
+            if (rpc->status) {
+                return rpc->status;
+            }
+            continue;
+        }
+
+        /* Feed it into the JSON parser. */
         if (!rpc->parser) {
             rpc->parser = json_parser_create(0);
         }
-        n = byteq_tailroom(&rpc->input);
         used = json_parser_feed(rpc->parser,
                                 (char *) byteq_tail(&rpc->input), n);
         byteq_advance_tail(&rpc->input, used);
@@ -449,18 +1124,15 @@ jsonrpc_transact_block(struct jsonrpc *rpc, struct jsonrpc_msg *request,
     return error;
 }
 
-/* Attempts to parse the content of 'rpc->parser' (which is complete JSON) as a
- * JSON-RPC message.  If successful, returns the JSON-RPC message.  On failure,
- * signals an error on 'rpc' with jsonrpc_error() and returns NULL. */
+/* Attempts to parse 'json' (of which it takes ownership) as a JSON-RPC
+ * message.  If successful, returns the JSON-RPC message.  On failure, signals
+ * an error on 'rpc' with jsonrpc_error() and returns NULL. */
 static struct jsonrpc_msg *
-jsonrpc_parse_received_message(struct jsonrpc *rpc)
+jsonrpc_parse_received_json(struct jsonrpc *rpc, struct json *json)
 {
     struct jsonrpc_msg *msg;
-    struct json *json;
     char *error;
 
-    json = json_parser_finish(rpc->parser);
-    rpc->parser = NULL;
     if (json->type == JSON_STRING) {
         VLOG_WARN_RL(&rl, "%s: error parsing stream: %s",
                      rpc->name, json_string(json));
@@ -482,6 +1154,68 @@ jsonrpc_parse_received_message(struct jsonrpc *rpc)
     return msg;
 }
 
+/* Attempts to parse the content of 'rpc->parser' (which is complete JSON) as a
+ * JSON-RPC message.  If successful, returns the JSON-RPC message.  On failure,
+ * signals an error on 'rpc' with jsonrpc_error() and returns NULL. */
+static struct jsonrpc_msg *
+jsonrpc_parse_received_message(struct jsonrpc *rpc)
+{
+    struct json *json = json_parser_finish(rpc->parser);
+
+    rpc->parser = NULL;
+    return jsonrpc_parse_received_json(rpc, json);
+}
+
+/* Consumes up to 'n' bytes from 'p' into the binary frame that 'rpc' is
+ * reassembling, completing a message into '*msgp' if they finish the frame.
+ * Returns the number of bytes consumed. */
+static size_t
+jsonrpc_bin_input(struct jsonrpc *rpc, const uint8_t *p, size_t n,
+                  struct jsonrpc_msg **msgp)
+{
+    size_t used = 0;
+
+    if (!rpc->bin_input) {
+        rpc->bin_input = ofpbuf_new(JSONRPC_BINARY_HEADER);
+    }
+
+    struct ofpbuf *b = rpc->bin_input;
+    if (b->size < JSONRPC_BINARY_HEADER) {
+        size_t take = MIN(JSONRPC_BINARY_HEADER - b->size, n);
+
+        ofpbuf_put(b, p, take);
+        used += take;
+        p += take;
+        n -= take;
+        if (b->size < JSONRPC_BINARY_HEADER) {
+            return used;
+        }
+
+        const uint8_t *header = b->data;
+        rpc->bin_length = ((uint32_t) header[1] << 24
+                           | (uint32_t) header[2] << 16
+                           | (uint32_t) header[3] << 8
+                           | header[4]);
+        ofpbuf_prealloc_tailroom(b, rpc->bin_length);
+    }
+
+    size_t total = JSONRPC_BINARY_HEADER + rpc->bin_length;
+    size_t take = MIN(total - b->size, n);
+    ofpbuf_put(b, p, take);
+    used += take;
+
+    if (b->size == total) {
+        struct json *json
+            = bin_json_from_buffer((uint8_t *) b->data + JSONRPC_BINARY_HEADER,
+                                   rpc->bin_length);
+
+        ofpbuf_delete(b);
+        rpc->bin_input = NULL;
+        *msgp = jsonrpc_parse_received_json(rpc, json);
+    }
+    return used;
+}
+
 static void
 jsonrpc_error(struct jsonrpc *rpc, int error)
 {
@@ -495,12 +1229,17 @@ jsonrpc_error(struct jsonrpc *rpc, int error)
 static void
 jsonrpc_cleanup(struct jsonrpc *rpc)
 {
+    jsonrpc_ser_drain(rpc);
+
     stream_close(rpc->stream);
     rpc->stream = NULL;
 
     json_parser_abort(rpc->parser);
     rpc->parser = NULL;
 
+    ofpbuf_delete(rpc->bin_input);
+    rpc->bin_input = NULL;
+
     ofpbuf_list_delete(&rpc->output);
     rpc->backlog = 0;
     rpc->output_count = 0;
@@ -787,6 +1526,7 @@ struct jsonrpc_session {
     int last_error;
     unsigned int seqno;
     uint8_t dscp;
+    bool threaded;              /* Apply jsonrpc_set_threaded() to 'rpc'? */
 };
 
 static void
@@ -841,6 +1581,7 @@ jsonrpc_session_open_multiple(const struct svec *remotes, bool retry)
     s->seqno = 0;
     s->dscp = 0;
     s->last_error = 0;
+    s->threaded = false;
 
     const char *name = reconnect_get_name(s->reconnect);
     if (!pstream_verify_name(name)) {
@@ -881,6 +1622,7 @@ jsonrpc_session_open_unreliably(struct jsonrpc *jsonrpc, uint8_t dscp)
     s->stream = NULL;
     s->pstream = NULL;
     s->seqno = 1;
+    s->threaded = false;
 
     return s;
 }
@@ -970,6 +1712,9 @@ jsonrpc_session_run(struct jsonrpc_session *s)
             }
             reconnect_connected(s->reconnect, time_msec());
             s->rpc = jsonrpc_open(stream);
+            if (s->threaded) {
+                jsonrpc_set_threaded(s->rpc);
+            }
             s->seqno++;
         } else if (error != EAGAIN) {
             reconnect_listen_error(s->reconnect, time_msec(), error);
@@ -1010,6 +1755,9 @@ jsonrpc_session_run(struct jsonrpc_session *s)
         if (!error) {
             reconnect_connected(s->reconnect, time_msec());
             s->rpc = jsonrpc_open(s->stream);
+            if (s->threaded) {
+                jsonrpc_set_threaded(s->rpc);
+            }
             s->stream = NULL;
             s->seqno++;
         } else if (error != EAGAIN) {
@@ -1040,7 +1788,7 @@ jsonrpc_session_run(struct jsonrpc_session *s)
             request = jsonrpc_create_request("echo", params, NULL);
             json_destroy(request->id);
             request->id = json_string_create("echo");
-            jsonrpc_send(s->rpc, request);
+            jsonrpc_send__(s->rpc, request, true);
         }
         break;
     }
@@ -1123,11 +1871,13 @@ jsonrpc_session_recv(struct jsonrpc_session *s)
 
         if (msg) {
             if (msg->type == JSONRPC_REQUEST && !strcmp(msg->method, "echo")) {
-                /* Echo request.  Send reply. */
+                /* Echo request.  Reply right here, ahead of whatever else is
+                 * queued, so that a busy connection still looks alive to the
+                 * peer's inactivity probes. */
                 struct jsonrpc_msg *reply;
 
                 reply = jsonrpc_create_reply(json_clone(msg->params), msg->id);
-                jsonrpc_session_send(s, reply);
+                jsonrpc_send__(s->rpc, reply, true);
             } else if (msg->type == JSONRPC_REPLY
                        && msg->id && msg->id->type == JSON_STRING
                        && !strcmp(msg->id->string, "echo")) {
@@ -1236,6 +1986,31 @@ jsonrpc_session_set_probe_interval(struct jsonrpc_session *s,
     reconnect_set_probe_interval(s->reconnect, probe_interval);
 }
 
+/* Arranges for 's' to serialize outgoing messages on a worker thread pool, by
+ * applying jsonrpc_set_threaded() to its current connection and to any
+ * connection created by a future reconnection. */
+void
+jsonrpc_session_set_threaded(struct jsonrpc_session *s)
+{
+    s->threaded = true;
+    if (s->rpc) {
+        jsonrpc_set_threaded(s->rpc);
+    }
+}
+
+/* Applies jsonrpc_set_binary() to 's''s current connection.  Unlike the
+ * threaded mode, this is not sticky across reconnections, because the binary
+ * encoding is negotiated with the peer per connection: the caller must
+ * negotiate again, and call this again, after the session's sequence number
+ * changes. */
+void
+jsonrpc_session_set_binary(struct jsonrpc_session *s)
+{
+    if (s->rpc) {
+        jsonrpc_set_binary(s->rpc);
+    }
+}
+
 /* Sets the DSCP value used for 's''s connection to 'dscp'.  If this is
  * different from the DSCP value currently in use then the connection is closed
  * and reconnected. */
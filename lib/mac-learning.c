@@ -25,6 +25,7 @@
 #include "hash.h"
 #include "openvswitch/list.h"
 #include "openvswitch/poll-loop.h"
+#include "ovs-rcu.h"
 #include "timeval.h"
 #include "unaligned.h"
 #include "util.h"
@@ -35,12 +36,21 @@ COVERAGE_DEFINE(mac_learning_expired);
 COVERAGE_DEFINE(mac_learning_evicted);
 COVERAGE_DEFINE(mac_learning_moved);
 
+/* Seconds between incremental aging sweeps of the learning table, and the
+ * minimum number of entries that each sweep visits.  Each sweep is budgeted
+ * so that the whole table is covered about twice per idle time. */
+#define MAC_LEARNING_SWEEP_INTERVAL 1
+#define MAC_LEARNING_SWEEP_MIN 64
+
 /* Returns the number of seconds since 'e' (within 'ml') was last learned. */
 int
-mac_entry_age(const struct mac_learning *ml, const struct mac_entry *e)
+mac_entry_age(const struct mac_learning *ml, const struct mac_entry *e_)
 {
-    time_t remaining = e->expires - time_now();
-    return ml->idle_time - remaining;
+    struct mac_entry *e = CONST_CAST(struct mac_entry *, e_);
+    time_t expires;
+
+    atomic_read_relaxed(&e->expires, &expires);
+    return ml->idle_time - (expires - time_now());
 }
 
 static uint32_t
@@ -62,7 +72,7 @@ mac_entry_lookup(const struct mac_learning *ml,
 {
     struct mac_entry *e;
 
-    HMAP_FOR_EACH_WITH_HASH (e, hmap_node, mac_table_hash(ml, mac, vlan),
+    CMAP_FOR_EACH_WITH_HASH (e, cmap_node, mac_table_hash(ml, mac, vlan),
                              &ml->table) {
         if (e->vlan == vlan && eth_addr_equals(e->mac, mac)) {
             return e;
@@ -109,7 +119,9 @@ mac_entry_set_port(struct mac_learning *ml, struct mac_entry *e, void *port)
                 ovs_assert(mlport->heap_node.priority == 1);
                 hmap_remove(&ml->ports_by_ptr, &mlport->hmap_node);
                 heap_remove(&ml->ports_by_usage, &mlport->heap_node);
-                free(mlport);
+                /* Lock-free readers may still dereference 'mlport' through
+                 * an entry they looked up before it changed port. */
+                ovsrcu_postpone(free, mlport);
             } else {
                 ovs_assert(mlport->heap_node.priority > 1);
                 heap_change(&ml->ports_by_usage, &mlport->heap_node,
@@ -140,7 +152,7 @@ mac_entry_set_port(struct mac_learning *ml, struct mac_entry *e, void *port)
 }
 
 /* Finds one of the ports with the most MAC entries and evicts its least
- * recently used entry. */
+ * recently learned entry. */
 static void
 evict_mac_entry_fairly(struct mac_learning *ml)
     OVS_REQ_WRLOCK(ml->rwlock)
@@ -157,9 +169,9 @@ evict_mac_entry_fairly(struct mac_learning *ml)
     mac_learning_expire(ml, e);
 }
 
-/* If the LRU list is not empty, stores the least-recently-used entry in '*e'
- * and returns true.  Otherwise, if the LRU list is empty, stores NULL in '*e'
- * and return false. */
+/* If the LRU list is not empty, stores the least-recently-learned entry in
+ * '*e' and returns true.  Otherwise, if the LRU list is empty, stores NULL in
+ * '*e' and return false. */
 static bool
 get_lru(struct mac_learning *ml, struct mac_entry **e)
     OVS_REQ_RDLOCK(ml->rwlock)
@@ -203,12 +215,14 @@ mac_learning_create(unsigned int idle_time)
 
     ml = xmalloc(sizeof *ml);
     ovs_list_init(&ml->lrus);
-    hmap_init(&ml->table);
+    cmap_init(&ml->table);
     ml->secret = random_uint32();
     ml->flood_vlans = NULL;
     ml->idle_time = normalize_idle_time(idle_time);
     ml->max_entries = MAC_DEFAULT_MAX;
     ml->need_revalidate = false;
+    memset(&ml->sweep_position, 0, sizeof ml->sweep_position);
+    ml->next_sweep = TIME_MIN;
     hmap_init(&ml->ports_by_ptr);
     heap_init(&ml->ports_by_usage);
     ovs_refcount_init(&ml->ref_cnt);
@@ -232,13 +246,9 @@ void
 mac_learning_unref(struct mac_learning *ml)
 {
     if (ml && ovs_refcount_unref(&ml->ref_cnt) == 1) {
-        struct mac_entry *e, *next;
-
         ovs_rwlock_wrlock(&ml->rwlock);
-        HMAP_FOR_EACH_SAFE (e, next, hmap_node, &ml->table) {
-            mac_learning_expire(ml, e);
-        }
-        hmap_destroy(&ml->table);
+        mac_learning_flush(ml);
+        cmap_destroy(&ml->table);
         hmap_destroy(&ml->ports_by_ptr);
         heap_destroy(&ml->ports_by_usage);
 
@@ -259,7 +269,10 @@ mac_learning_set_flood_vlans(struct mac_learning *ml,
     if (vlan_bitmap_equal(ml->flood_vlans, bitmap)) {
         return false;
     } else {
-        bitmap_free(ml->flood_vlans);
+        if (ml->flood_vlans) {
+            /* Lock-free lookups consult the bitmap. */
+            ovsrcu_postpone(free, ml->flood_vlans);
+        }
         ml->flood_vlans = vlan_bitmap_clone(bitmap);
         return true;
     }
@@ -276,7 +289,10 @@ mac_learning_set_idle_time(struct mac_learning *ml, unsigned int idle_time)
 
         delta = (int) idle_time - (int) ml->idle_time;
         LIST_FOR_EACH (e, lru_node, &ml->lrus) {
-            e->expires += delta;
+            time_t expires;
+
+            atomic_read_relaxed(&e->expires, &expires);
+            atomic_store_relaxed(&e->expires, expires + delta);
         }
         ml->idle_time = idle_time;
     }
@@ -326,29 +342,32 @@ mac_learning_insert(struct mac_learning *ml,
     if (!e) {
         uint32_t hash = mac_table_hash(ml, src_mac, vlan);
 
-        if (hmap_count(&ml->table) >= ml->max_entries) {
+        if (cmap_count(&ml->table) >= ml->max_entries) {
             evict_mac_entry_fairly(ml);
         }
 
         e = xmalloc(sizeof *e);
-        hmap_insert(&ml->table, &e->hmap_node, hash);
         e->mac = src_mac;
         e->vlan = vlan;
-        e->grat_arp_lock = TIME_MIN;
+        atomic_init(&e->expires, time_now() + ml->idle_time);
+        atomic_init(&e->grat_arp_lock, TIME_MIN);
         e->mlport = NULL;
+        /* Initialize everything before insertion, since lock-free readers
+         * may find 'e' as soon as it is in the cmap. */
+        cmap_insert(&ml->table, &e->cmap_node, hash);
         COVERAGE_INC(mac_learning_learned);
         ml->total_learned++;
     } else {
         ovs_list_remove(&e->lru_node);
+        atomic_store_relaxed(&e->expires, time_now() + ml->idle_time);
     }
 
-    /* Mark 'e' as recently used. */
+    /* Mark 'e' as recently learned. */
     ovs_list_push_back(&ml->lrus, &e->lru_node);
     if (e->mlport) {
         ovs_list_remove(&e->port_lru_node);
         ovs_list_push_back(&e->mlport->port_lrus, &e->port_lru_node);
     }
-    e->expires = time_now() + ml->idle_time;
 
     return e;
 }
@@ -359,8 +378,11 @@ mac_learning_insert(struct mac_learning *ml,
  * 'true' and 'in_port' is a bond port if 'is_bond' is 'true'.
  *
  * Most packets processed through the MAC learning table do not actually
- * change it in any way.  This function requires only a read lock on the MAC
- * learning table, so it is much cheaper in this common case.
+ * change it in any way.  This function takes no lock at all: when the entry
+ * already exists on the right port, it just refreshes the entry's expiration
+ * time in place with an atomic store.  Only structural changes (a new MAC, a
+ * MAC that moved to another port, or a gratuitous ARP lock to set) are
+ * reported to the caller, which then takes the write lock.
  *
  * Keep the code here synchronized with that in update_learning_table__()
  * below. */
@@ -369,7 +391,6 @@ is_mac_learning_update_needed(const struct mac_learning *ml,
                               struct eth_addr src, int vlan,
                               bool is_gratuitous_arp, bool is_bond,
                               void *in_port)
-    OVS_REQ_RDLOCK(ml->rwlock)
 {
     struct mac_entry *mac;
 
@@ -378,7 +399,7 @@ is_mac_learning_update_needed(const struct mac_learning *ml,
     }
 
     mac = mac_learning_lookup(ml, src, vlan);
-    if (!mac || mac_entry_age(ml, mac)) {
+    if (!mac) {
         return true;
     }
 
@@ -393,7 +414,15 @@ is_mac_learning_update_needed(const struct mac_learning *ml,
         }
     }
 
-    return mac_entry_get_port(ml, mac) != in_port /* ofbundle */;
+    if (mac_entry_get_port(ml, mac) != in_port /* ofbundle */) {
+        return true;
+    }
+
+    /* The entry is already as it should be.  Refresh its expiration time in
+     * place.  Racing with an aging sweep that has just decided to expire this
+     * entry is harmless: the MAC is simply relearned from the next packet. */
+    atomic_store_relaxed(&mac->expires, time_now() + ml->idle_time);
+    return false;
 }
 
 /* Updates MAC learning table 'ml' given that a packet matching 'src' was
@@ -466,12 +495,11 @@ mac_learning_update(struct mac_learning *ml, struct eth_addr src,
 
     /* Don't learn the OFPP_NONE port. */
     if (in_port != NULL) {
-        /* First try the common case: no change to MAC learning table. */
-        ovs_rwlock_rdlock(&ml->rwlock);
+        /* First try the common case, which takes no lock: no structural
+         * change to the MAC learning table. */
         need_update = is_mac_learning_update_needed(ml, src, vlan,
                                                     is_gratuitous_arp, is_bond,
                                                     in_port);
-        ovs_rwlock_unlock(&ml->rwlock);
 
         if (need_update) {
             /* Slow path: MAC learning table might need an update. */
@@ -501,20 +529,27 @@ mac_learning_lookup(const struct mac_learning *ml,
     } else {
         struct mac_entry *e = mac_entry_lookup(ml, dst, vlan);
 
-        ovs_assert(e == NULL || mac_entry_get_port(ml, e) != NULL);
-        return e;
+        /* A lock-free lookup can find an entry that was just inserted and
+         * does not yet have its port set.  Such an entry is not usable for
+         * forwarding, so treat it as absent. */
+        return e && mac_entry_get_port(ml, e) != NULL ? e : NULL;
     }
 }
 
-/* Expires 'e' from the 'ml' hash table. */
+/* Expires 'e' from the 'ml' table.  The entry becomes invisible to new
+ * lookups immediately, but is freed only after a grace period, since
+ * lock-free readers may still hold a pointer to it. */
 void
 mac_learning_expire(struct mac_learning *ml, struct mac_entry *e)
 {
     ml->need_revalidate = true;
-    mac_entry_set_port(ml, e, NULL);
-    hmap_remove(&ml->table, &e->hmap_node);
+    /* Remove 'e' from the table before clearing its port, so that lock-free
+     * lookups never see an in-table entry lose its port. */
+    cmap_remove(&ml->table, &e->cmap_node,
+                mac_table_hash(ml, e->mac, e->vlan));
     ovs_list_remove(&e->lru_node);
-    free(e);
+    mac_entry_set_port(ml, e, NULL);
+    ovsrcu_postpone(free, e);
 }
 
 /* Expires all the mac-learning entries in 'ml'. */
@@ -525,23 +560,52 @@ mac_learning_flush(struct mac_learning *ml)
     while (get_lru(ml, &e)){
         mac_learning_expire(ml, e);
     }
-    hmap_shrink(&ml->table);
 }
 
 /* Does periodic work required by 'ml'.  Returns true if something changed that
- * may require flow revalidation. */
+ * may require flow revalidation.
+ *
+ * Aging is incremental: each call visits at most a slice of the table, sized
+ * so that the whole table is covered about twice per idle time, which bounds
+ * the time spent under the write lock regardless of the number of learned
+ * MACs.  The sweep position is only a hint: a concurrent table resize may
+ * cause a pass to skip or revisit a few entries, which at worst delays their
+ * expiration to a later pass. */
 bool
 mac_learning_run(struct mac_learning *ml)
 {
     bool need_revalidate;
-    struct mac_entry *e;
+    time_t now = time_now();
 
-    while (get_lru(ml, &e)
-           && (hmap_count(&ml->table) > ml->max_entries
-               || time_now() >= e->expires)) {
-        COVERAGE_INC(mac_learning_expired);
-        ml->total_expired++;
-        mac_learning_expire(ml, e);
+    while (cmap_count(&ml->table) > ml->max_entries) {
+        evict_mac_entry_fairly(ml);
+    }
+
+    if (cmap_count(&ml->table) > 0 && now >= ml->next_sweep) {
+        size_t budget = (cmap_count(&ml->table)
+                         * 2 * MAC_LEARNING_SWEEP_INTERVAL / ml->idle_time
+                         + MAC_LEARNING_SWEEP_MIN);
+
+        while (budget-- > 0) {
+            struct cmap_node *node = cmap_next_position(&ml->table,
+                                                        &ml->sweep_position);
+            struct mac_entry *e;
+            time_t expires;
+
+            if (!node) {
+                /* Completed a pass over the whole table. */
+                break;
+            }
+
+            e = CONTAINER_OF(node, struct mac_entry, cmap_node);
+            atomic_read_relaxed(&e->expires, &expires);
+            if (now >= expires) {
+                COVERAGE_INC(mac_learning_expired);
+                ml->total_expired++;
+                mac_learning_expire(ml, e);
+            }
+        }
+        ml->next_sweep = now + MAC_LEARNING_SWEEP_INTERVAL;
     }
 
     need_revalidate = ml->need_revalidate;
@@ -552,11 +616,10 @@ mac_learning_run(struct mac_learning *ml)
 void
 mac_learning_wait(struct mac_learning *ml)
 {
-    if (hmap_count(&ml->table) > ml->max_entries
+    if (cmap_count(&ml->table) > ml->max_entries
         || ml->need_revalidate) {
         poll_immediate_wake();
-    } else if (!ovs_list_is_empty(&ml->lrus)) {
-        struct mac_entry *e = mac_entry_from_lru_node(ml->lrus.next);
-        poll_timer_wait_until(e->expires * 1000LL);
+    } else if (cmap_count(&ml->table) > 0) {
+        poll_timer_wait_until(ml->next_sweep * 1000LL);
     }
 }
@@ -18,6 +18,7 @@
 #define MAC_LEARNING_H 1
 
 #include <time.h>
+#include "cmap.h"
 #include "heap.h"
 #include "openvswitch/hmap.h"
 #include "openvswitch/list.h"
@@ -50,19 +51,18 @@
  * 'ovs-vswitchd Internals' guide for an explanation.
  *
  * Third, the implementation expires entries that are idle for longer than a
- * configurable amount of time.  This is implemented by keeping all of the
- * current table entries on a list ordered from least recently used (LRU) to
- * most recently used (MRU).  Each time a MAC entry is used, it is moved to the
- * MRU end of the list.  Periodically mac_learning_run() sweeps through the
- * list starting from the LRU end, deleting each entry that has been idle too
- * long.
+ * configurable amount of time.  Each entry records its own expiration time,
+ * which is refreshed in place every time the entry is used.  Periodically
+ * mac_learning_run() sweeps an incremental slice of the table, deleting each
+ * entry whose expiration time has passed, so that no single pass has to visit
+ * every entry at once.
  *
  * Finally, the number of MAC learning table entries has a configurable maximum
  * size to prevent memory exhaustion.  When a new entry must be inserted but
  * the table is already full, the implementation uses an eviction strategy
  * based on fairness: it chooses the port that currently has greatest number of
  * learned MACs (choosing arbitrarily in case of a tie), and among that port's
- * entries it evicts the least recently used.  (This is a security feature
+ * entries it evicts the least recently learned.  (This is a security feature
  * because it prevents an attacker from forcing other ports' MACs out of the
  * MAC learning table with a "MAC flooding attack" that causes the other ports'
  * traffic to be flooded so that the attacker can easily sniff it.)  The
@@ -77,13 +77,15 @@
  *
  * Many operations require the caller to take the MAC learning table's rwlock
  * for writing (please refer to the Clang thread safety annotations).  The
- * important exception to this is mac_learning_lookup(), which only needs a
- * read lock.  This is useful for the common case where a MAC learning entry
- * being looked up already exists and does not need an update.  However,
- * there's no deadlock-free way to upgrade a read lock to a write lock, so in
- * the case where the lookup result means that an update is required, the
- * caller must drop the read lock, take the write lock, and then repeat the
- * lookup (in case some other thread has already made a change).
+ * important exception to this is lookup: the table itself is a cmap and each
+ * entry's expiration time is atomic, so mac_learning_lookup() and the common
+ * case of mac_learning_update(), where the entry already exists on the right
+ * port and only its expiration time needs refreshing, take no lock at all.
+ * Lock-free readers must be inside an RCU quiescent-state-based critical
+ * section, as elsewhere in OVS, because expired entries are freed only after
+ * a grace period.  When a lock-free check shows that a structural update is
+ * required, the caller takes the write lock and the checks are repeated,
+ * since another thread may have raced ahead.
  */
 
 struct mac_learning;
@@ -99,11 +101,13 @@ struct mac_learning;
 #define MAC_GRAT_ARP_LOCK_TIME 5
 
 /* A MAC learning table entry.
- * Guarded by owning 'mac_learning''s rwlock. */
+ * Guarded by owning 'mac_learning''s rwlock, except that 'expires' and
+ * 'grat_arp_lock' are atomic and the entry may be found and read without the
+ * lock by RCU readers. */
 struct mac_entry {
-    struct hmap_node hmap_node; /* Node in a mac_learning hmap. */
-    time_t expires;             /* Expiration time. */
-    time_t grat_arp_lock;       /* Gratuitous ARP lock expiration time. */
+    struct cmap_node cmap_node; /* Node in a mac_learning cmap. */
+    ATOMIC(time_t) expires;     /* Expiration time. */
+    ATOMIC(time_t) grat_arp_lock; /* Gratuitous ARP lock expiration time. */
     struct eth_addr mac;        /* Known MAC address. */
     uint16_t vlan;              /* VLAN tag. */
 
@@ -138,20 +142,26 @@ struct mac_learning_port {
  * MAC_GRAT_ARP_LOCK_TIME seconds. */
 static inline void mac_entry_set_grat_arp_lock(struct mac_entry *mac)
 {
-    mac->grat_arp_lock = time_now() + MAC_GRAT_ARP_LOCK_TIME;
+    atomic_store_relaxed(&mac->grat_arp_lock,
+                         time_now() + MAC_GRAT_ARP_LOCK_TIME);
 }
 
 /* Returns true if a gratuitous ARP lock is in effect on 'mac', false if none
  * has ever been asserted or if it has expired. */
-static inline bool mac_entry_is_grat_arp_locked(const struct mac_entry *mac)
+static inline bool mac_entry_is_grat_arp_locked(const struct mac_entry *mac_)
 {
-    return time_now() < mac->grat_arp_lock;
+    struct mac_entry *mac = CONST_CAST(struct mac_entry *, mac_);
+    time_t lock_expires;
+
+    atomic_read_relaxed(&mac->grat_arp_lock, &lock_expires);
+    return time_now() < lock_expires;
 }
 
 /* MAC learning table. */
 struct mac_learning {
-    struct hmap table;          /* Learning table. */
-    struct ovs_list lrus OVS_GUARDED; /* In-use entries, LRU at front. */
+    struct cmap table;          /* Learning table. */
+    struct ovs_list lrus OVS_GUARDED; /* In-use entries, least recently
+                                       * learned at front. */
     uint32_t secret;            /* Secret for randomizing hash table. */
     unsigned long *flood_vlans; /* Bitmap of learning disabled VLANs. */
     unsigned int idle_time;     /* Max age before deleting an entry. */
@@ -160,6 +170,12 @@ struct mac_learning {
     struct ovs_rwlock rwlock;
     bool need_revalidate;
 
+    /* Aging.  Expired entries are reclaimed by an incremental sweep over the
+     * table rather than by keeping the entries in expiration order, so that
+     * refreshing an entry's expiration time does not require the rwlock. */
+    struct cmap_position sweep_position; /* Where the next sweep resumes. */
+    time_t next_sweep;          /* Earliest time for the next aging sweep. */
+
     /* Statistics */
     uint64_t total_learned;
     uint64_t total_expired;
@@ -182,8 +198,7 @@ struct mac_learning {
     struct heap ports_by_usage; /* struct mac_learning_port heap_nodes. */
 };
 
-int mac_entry_age(const struct mac_learning *ml, const struct mac_entry *e)
-    OVS_REQ_RDLOCK(ml->rwlock);
+int mac_entry_age(const struct mac_learning *ml, const struct mac_entry *e);
 
 /* Basics. */
 struct mac_learning *mac_learning_create(unsigned int idle_time);
@@ -219,11 +234,10 @@ bool mac_learning_update(struct mac_learning *ml, struct eth_addr src,
                          void *in_port)
     OVS_EXCLUDED(ml->rwlock);
 
-/* Lookup. */
+/* Lookup.  Safe without taking the rwlock, for RCU readers. */
 struct mac_entry *mac_learning_lookup(const struct mac_learning *ml,
                                       const struct eth_addr dst,
-                                      uint16_t vlan)
-    OVS_REQ_RDLOCK(ml->rwlock);
+                                      uint16_t vlan);
 
 /* Flushing. */
 void mac_learning_expire(struct mac_learning *ml, struct mac_entry *e)
@@ -235,7 +249,6 @@ void mac_learning_flush(struct mac_learning *ml) OVS_REQ_WRLOCK(ml->rwlock);
 static inline void *
 mac_entry_get_port(const struct mac_learning *ml OVS_UNUSED,
                    const struct mac_entry *e)
-    OVS_REQ_RDLOCK(ml->rwlock)
 {
     return e->mlport ? e->mlport->port : NULL;
 }
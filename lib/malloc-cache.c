@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2020 Open vSwitch contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+#include "malloc-cache.h"
+
+#include <stdlib.h>
+
+#include "coverage.h"
+#include "ovs-thread.h"
+#include "util.h"
+
+COVERAGE_DEFINE(malloc_cache_refill);
+COVERAGE_DEFINE(malloc_cache_drain);
+
+/* Cached block sizes.  The smallest class must be able to hold a pointer
+ * (for the free-list link) and the set should bracket the block sizes that
+ * dominate the packet and flow-setup paths: dp_packet and ofpbuf structs on
+ * the small end, packet data buffers on the large end. */
+static const size_t mc_class_size[] = { 128, 256, 512, 1024, 2048, 4096 };
+#define MC_N_CLASSES ARRAY_SIZE(mc_class_size)
+
+enum { MC_THREAD_MAX = 32 };    /* Blocks kept per class per thread. */
+enum { MC_BATCH = 8 };          /* Blocks moved to or from the shared pool
+                                 * at a time. */
+enum { MC_SHARED_MAX = 256 };   /* Blocks kept per class in the shared
+                                 * pool. */
+
+/* A free block, linked through its own first bytes. */
+struct mc_block {
+    struct mc_block *next;
+};
+
+struct mc_list {
+    struct mc_block *head;
+    size_t n;
+};
+
+/* Shared pool, the middle tier between thread caches and the system
+ * allocator.  One lock for all classes: it is only taken once per MC_BATCH
+ * blocks moved. */
+static struct ovs_mutex mc_mutex = OVS_MUTEX_INITIALIZER;
+static struct mc_list mc_shared[MC_N_CLASSES] OVS_GUARDED_BY(mc_mutex);
+
+struct mc_thread {
+    struct mc_list classes[MC_N_CLASSES];
+};
+
+static ovsthread_key_t mc_key;
+static struct ovsthread_once mc_once = OVSTHREAD_ONCE_INITIALIZER;
+
+/* Returns the smallest class whose blocks hold at least 'size' bytes, or -1
+ * if 'size' exceeds the largest class. */
+static int
+mc_class_ceil(size_t size)
+{
+    for (size_t c = 0; c < MC_N_CLASSES; c++) {
+        if (size <= mc_class_size[c]) {
+            return c;
+        }
+    }
+    return -1;
+}
+
+/* Returns the largest class whose blocks hold at most 'allocated' bytes, or
+ * -1 if 'allocated' is smaller than the smallest class or so much bigger
+ * than the largest class that caching the block would waste most of it. */
+static int
+mc_class_floor(size_t allocated)
+{
+    if (allocated < mc_class_size[0]
+        || allocated > 2 * mc_class_size[MC_N_CLASSES - 1]) {
+        return -1;
+    }
+    for (int c = MC_N_CLASSES - 1; c >= 0; c--) {
+        if (allocated >= mc_class_size[c]) {
+            return c;
+        }
+    }
+    OVS_NOT_REACHED();
+}
+
+static void
+mc_list_push(struct mc_list *list, struct mc_block *block)
+{
+    block->next = list->head;
+    list->head = block;
+    list->n++;
+}
+
+static struct mc_block *
+mc_list_pop(struct mc_list *list)
+{
+    struct mc_block *block = list->head;
+
+    if (block) {
+        list->head = block->next;
+        list->n--;
+    }
+    return block;
+}
+
+/* Thread exit: everything in the thread cache goes back to the shared pool,
+ * or to free() for whatever does not fit there. */
+static void
+mc_thread_exit(void *thread_)
+{
+    struct mc_thread *thread = thread_;
+
+    ovs_mutex_lock(&mc_mutex);
+    for (size_t c = 0; c < MC_N_CLASSES; c++) {
+        struct mc_block *block;
+
+        while ((block = mc_list_pop(&thread->classes[c]))) {
+            if (mc_shared[c].n < MC_SHARED_MAX) {
+                mc_list_push(&mc_shared[c], block);
+            } else {
+                free(block);
+            }
+        }
+    }
+    ovs_mutex_unlock(&mc_mutex);
+    free(thread);
+}
+
+static struct mc_thread *
+mc_thread_get(void)
+{
+    struct mc_thread *thread;
+
+    if (ovsthread_once_start(&mc_once)) {
+        ovsthread_key_create(&mc_key, mc_thread_exit);
+        ovsthread_once_done(&mc_once);
+    }
+
+    thread = ovsthread_getspecific(mc_key);
+    if (OVS_UNLIKELY(!thread)) {
+        thread = xzalloc(sizeof *thread);
+        ovsthread_setspecific(mc_key, thread);
+    }
+    return thread;
+}
+
+/* Moves up to MC_BATCH blocks of class 'c' from the shared pool into
+ * 'list'. */
+static void
+mc_refill(struct mc_list *list, int c)
+{
+    struct mc_block *block;
+    int moved = 0;
+
+    ovs_mutex_lock(&mc_mutex);
+    while (moved < MC_BATCH && (block = mc_list_pop(&mc_shared[c]))) {
+        mc_list_push(list, block);
+        moved++;
+    }
+    ovs_mutex_unlock(&mc_mutex);
+
+    if (moved) {
+        COVERAGE_INC(malloc_cache_refill);
+    }
+}
+
+/* Moves MC_BATCH blocks of class 'c' from 'list' into the shared pool,
+ * freeing them instead if the shared pool is full. */
+static void
+mc_drain(struct mc_list *list, int c)
+{
+    ovs_mutex_lock(&mc_mutex);
+    for (int i = 0; i < MC_BATCH; i++) {
+        struct mc_block *block = mc_list_pop(list);
+
+        if (!block) {
+            break;
+        }
+        if (mc_shared[c].n < MC_SHARED_MAX) {
+            mc_list_push(&mc_shared[c], block);
+        } else {
+            free(block);
+        }
+    }
+    ovs_mutex_unlock(&mc_mutex);
+
+    COVERAGE_INC(malloc_cache_drain);
+}
+
+static void *
+mc_alloc(int c)
+{
+    struct mc_thread *thread = mc_thread_get();
+    struct mc_list *list = &thread->classes[c];
+    struct mc_block *block;
+
+    if (!list->head) {
+        mc_refill(list, c);
+    }
+    block = mc_list_pop(list);
+    return block ? block : xmalloc(mc_class_size[c]);
+}
+
+static void
+mc_free(void *p, int c)
+{
+    struct mc_thread *thread = mc_thread_get();
+    struct mc_list *list = &thread->classes[c];
+
+    mc_list_push(list, p);
+    if (OVS_UNLIKELY(list->n > MC_THREAD_MAX)) {
+        mc_drain(list, c);
+    }
+}
+
+void *
+malloc_cache_alloc(size_t *size)
+{
+    int c = mc_class_ceil(*size);
+
+    if (c < 0) {
+        return xmalloc(*size);
+    }
+    *size = mc_class_size[c];
+    return mc_alloc(c);
+}
+
+void
+malloc_cache_free(void *p, size_t allocated)
+{
+    int c;
+
+    if (!p) {
+        return;
+    }
+
+    c = mc_class_floor(allocated);
+    if (c < 0) {
+        free(p);
+    } else {
+        mc_free(p, c);
+    }
+}
+
+void *
+malloc_cache_alloc_fixed(size_t size)
+{
+    int c = mc_class_ceil(size);
+
+    return c < 0 ? xmalloc(size) : mc_alloc(c);
+}
+
+void
+malloc_cache_free_fixed(void *p, size_t size)
+{
+    int c;
+
+    if (!p) {
+        return;
+    }
+
+    c = mc_class_ceil(size);
+    if (c < 0) {
+        free(p);
+    } else {
+        mc_free(p, c);
+    }
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2020 Open vSwitch contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MALLOC_CACHE_H
+#define MALLOC_CACHE_H 1
+
+#include <stddef.h>
+
+/* Thread-local cache of malloc() blocks.
+ *
+ * Hot allocation sites that obtain and release a buffer per packet or per
+ * flow-setup operation (dp_packets and ofpbufs in particular) pay for a trip
+ * through the system allocator, including its lock traffic, on every cycle.
+ * This module keeps small per-thread free lists of malloc() blocks in a few
+ * power-of-two size classes, refilled from and drained to a shared pool in
+ * batches, so that steady-state allocation and freeing touch only
+ * thread-local state.
+ *
+ * Every block handed out is an ordinary malloc() block, so memory obtained
+ * here may safely be released with plain free() (or realloc()ed) by code
+ * that is unaware of the cache; it is merely lost to reuse.  Conversely,
+ * malloc_cache_free() accepts any malloc() block, caching it when its usable
+ * size fits a class and passing it to free() otherwise.  Sizes above the
+ * largest class always fall through to xmalloc()/free().
+ *
+ * All functions are thread-safe.
+ */
+
+/* Allocates at least '*size' bytes, rounding '*size' up to the size actually
+ * usable.  Never returns NULL. */
+void *malloc_cache_alloc(size_t *size);
+
+/* Frees 'p', a malloc() block with at least 'allocated' usable bytes (such
+ * as the rounded-up size reported by malloc_cache_alloc()).  'p' may be a
+ * null pointer. */
+void malloc_cache_free(void *p, size_t allocated);
+
+/* Like the pair above but for fixed-size objects whose exact size is known
+ * at both ends, e.g. structs: the same 'size' must be passed to both
+ * functions. */
+void *malloc_cache_alloc_fixed(size_t size);
+void malloc_cache_free_fixed(void *p, size_t size);
+
+#endif /* malloc-cache.h */
@@ -24,6 +24,7 @@
 #include "simap.h"
 #include "timeval.h"
 #include "unixctl.h"
+#include "util.h"
 #include "openvswitch/vlog.h"
 
 VLOG_DEFINE_THIS_MODULE(memory);
@@ -114,6 +115,8 @@ compose_report(const struct simap *usage, struct ds *s)
 {
     const struct simap_node **nodes = simap_sort(usage);
     size_t n = simap_count(usage);
+    uint64_t bytes[MEM_N_TAGS], blocks[MEM_N_TAGS];
+    enum mem_tag tag;
     size_t i;
 
     for (i = 0; i < n; i++) {
@@ -121,6 +124,16 @@ compose_report(const struct simap *usage, struct ds *s)
 
         ds_put_format(s, "%s:%u ", node->name, node->data);
     }
+
+    /* Heap usage attributed to a subsystem through the tagged allocators. */
+    mem_tag_read(bytes, blocks);
+    for (tag = 0; tag < MEM_N_TAGS; tag++) {
+        if (blocks[tag]) {
+            ds_put_format(s, "%s:%"PRIu64"kB ",
+                          mem_tag_name(tag), bytes[tag] / 1024);
+        }
+    }
+
     ds_chomp(s, ' ');
     free(nodes);
 }
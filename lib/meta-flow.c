@@ -76,6 +76,81 @@ const union mf_value exact_match_mask = MF_VALUE_EXACT_INITIALIZER;
 
 static void nxm_init(void);
 
+/* Many fields are verbatim network-byte-order copies of a 'struct flow'
+ * member.  For those, mf_get_value() and mf_set_flow_value() can skip
+ * their big switch and go through a single memcpy with a table-driven
+ * offset and size, which matters in paths that touch dozens of fields per
+ * rule (flow_mod parsing, the xlate set-field path).  Fields that need
+ * byte swapping, masking, port translation or any other massaging keep
+ * using the switch; their table entry stays zero.  nxm_do_init() asserts
+ * that every entry's size matches the field's 'n_bytes'. */
+struct mf_flow_accessor {
+    uint16_t ofs;               /* Offset of member in struct flow. */
+    uint8_t size;               /* Member size in bytes; 0 to use switch. */
+};
+
+#define MF_DIRECT(ID, MEMBER)                           \
+    [ID] = { offsetof(struct flow, MEMBER),             \
+             sizeof ((struct flow *) NULL)->MEMBER }
+
+static const struct mf_flow_accessor mf_flow_accessors[MFF_N_IDS] = {
+    MF_DIRECT(MFF_PACKET_TYPE, packet_type),
+    MF_DIRECT(MFF_TUN_ID, tunnel.tun_id),
+    MF_DIRECT(MFF_TUN_SRC, tunnel.ip_src),
+    MF_DIRECT(MFF_TUN_DST, tunnel.ip_dst),
+    MF_DIRECT(MFF_TUN_IPV6_SRC, tunnel.ipv6_src),
+    MF_DIRECT(MFF_TUN_IPV6_DST, tunnel.ipv6_dst),
+    MF_DIRECT(MFF_TUN_GBP_ID, tunnel.gbp_id),
+    MF_DIRECT(MFF_TUN_GBP_FLAGS, tunnel.gbp_flags),
+    MF_DIRECT(MFF_TUN_TTL, tunnel.ip_ttl),
+    MF_DIRECT(MFF_TUN_TOS, tunnel.ip_tos),
+    MF_DIRECT(MFF_TUN_ERSPAN_VER, tunnel.erspan_ver),
+    MF_DIRECT(MFF_TUN_ERSPAN_DIR, tunnel.erspan_dir),
+    MF_DIRECT(MFF_TUN_ERSPAN_HWID, tunnel.erspan_hwid),
+    MF_DIRECT(MFF_TUN_GTPU_FLAGS, tunnel.gtpu_flags),
+    MF_DIRECT(MFF_TUN_GTPU_MSGTYPE, tunnel.gtpu_msgtype),
+    MF_DIRECT(MFF_METADATA, metadata),
+    MF_DIRECT(MFF_CT_NW_PROTO, ct_nw_proto),
+    MF_DIRECT(MFF_CT_NW_SRC, ct_nw_src),
+    MF_DIRECT(MFF_CT_NW_DST, ct_nw_dst),
+    MF_DIRECT(MFF_CT_IPV6_SRC, ct_ipv6_src),
+    MF_DIRECT(MFF_CT_IPV6_DST, ct_ipv6_dst),
+    MF_DIRECT(MFF_CT_TP_SRC, ct_tp_src),
+    MF_DIRECT(MFF_CT_TP_DST, ct_tp_dst),
+    MF_DIRECT(MFF_ETH_SRC, dl_src),
+    MF_DIRECT(MFF_ETH_DST, dl_dst),
+    MF_DIRECT(MFF_ETH_TYPE, dl_type),
+    MF_DIRECT(MFF_IPV4_SRC, nw_src),
+    MF_DIRECT(MFF_IPV4_DST, nw_dst),
+    MF_DIRECT(MFF_IPV6_SRC, ipv6_src),
+    MF_DIRECT(MFF_IPV6_DST, ipv6_dst),
+    MF_DIRECT(MFF_IP_PROTO, nw_proto),
+    MF_DIRECT(MFF_IP_TTL, nw_ttl),
+    MF_DIRECT(MFF_ARP_SPA, nw_src),
+    MF_DIRECT(MFF_ARP_TPA, nw_dst),
+    MF_DIRECT(MFF_ARP_SHA, arp_sha),
+    MF_DIRECT(MFF_ND_SLL, arp_sha),
+    MF_DIRECT(MFF_ARP_THA, arp_tha),
+    MF_DIRECT(MFF_ND_TLL, arp_tha),
+    MF_DIRECT(MFF_TCP_SRC, tp_src),
+    MF_DIRECT(MFF_UDP_SRC, tp_src),
+    MF_DIRECT(MFF_SCTP_SRC, tp_src),
+    MF_DIRECT(MFF_TCP_DST, tp_dst),
+    MF_DIRECT(MFF_UDP_DST, tp_dst),
+    MF_DIRECT(MFF_SCTP_DST, tp_dst),
+    MF_DIRECT(MFF_TCP_FLAGS, tcp_flags),
+    MF_DIRECT(MFF_ND_TARGET, nd_target),
+    MF_DIRECT(MFF_ND_RESERVED, igmp_group_ip4),
+    MF_DIRECT(MFF_NSH_FLAGS, nsh.flags),
+    MF_DIRECT(MFF_NSH_TTL, nsh.ttl),
+    MF_DIRECT(MFF_NSH_MDTYPE, nsh.mdtype),
+    MF_DIRECT(MFF_NSH_NP, nsh.np),
+    MF_DIRECT(MFF_NSH_C1, nsh.context[0]),
+    MF_DIRECT(MFF_NSH_C2, nsh.context[1]),
+    MF_DIRECT(MFF_NSH_C3, nsh.context[2]),
+    MF_DIRECT(MFF_NSH_C4, nsh.context[3]),
+};
+
 /* Returns the field with the given 'name', or a null pointer if no field has
  * that name. */
 const struct mf_field *
@@ -107,6 +182,10 @@ nxm_do_init(void)
 
         ovs_assert(mf->id == i); /* Fields must be in the enum order. */
 
+        /* A direct accessor must cover the field's whole value. */
+        ovs_assert(!mf_flow_accessors[i].size
+                   || mf_flow_accessors[i].size == mf->n_bytes);
+
         shash_add_once(&mf_by_name, mf->name, mf);
         if (mf->extra_name) {
             shash_add_once(&mf_by_name, mf->extra_name, mf);
@@ -662,6 +741,12 @@ void
 mf_get_value(const struct mf_field *mf, const struct flow *flow,
              union mf_value *value)
 {
+    const struct mf_flow_accessor *a = &mf_flow_accessors[mf->id];
+    if (a->size) {
+        memcpy(value, (const uint8_t *) flow + a->ofs, a->size);
+        return;
+    }
+
     switch (mf->id) {
     case MFF_DP_HASH:
         value->be32 = htonl(flow->dp_hash);
@@ -1421,6 +1506,12 @@ void
 mf_set_flow_value(const struct mf_field *mf,
                   const union mf_value *value, struct flow *flow)
 {
+    const struct mf_flow_accessor *a = &mf_flow_accessors[mf->id];
+    if (a->size) {
+        memcpy((uint8_t *) flow + a->ofs, value, a->size);
+        return;
+    }
+
     switch (mf->id) {
     case MFF_DP_HASH:
         flow->dp_hash = ntohl(value->be32);
@@ -21,6 +21,7 @@
 #include "netdev-afxdp.h"
 #include "netdev-afxdp-pool.h"
 
+#include <bpf/bpf.h>
 #include <errno.h>
 #include <inttypes.h>
 #include <linux/rtnetlink.h>
@@ -87,14 +88,26 @@ static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 20);
 #define NUM_FRAMES          (4 * (PROD_NUM_DESCS + CONS_NUM_DESCS))
 #define BATCH_SIZE          NETDEV_MAX_BURST
 
+/* Number of FILL ring descriptors replenished at once.  A multiple of 8
+ * keeps every replenishment writing whole cache lines of the 64-bit
+ * descriptor array. */
+#define FILL_CHUNK_SIZE     (2 * BATCH_SIZE)
+
+/* Reap TX completions only once this many descriptors are outstanding.
+ * Peeking the completion queue for every batch bounces its cache lines
+ * between the kernel and the PMD for no benefit. */
+#define CQ_REAP_THRESH      (2 * BATCH_SIZE)
+
 BUILD_ASSERT_DECL(IS_POW2(NUM_FRAMES));
 BUILD_ASSERT_DECL(PROD_NUM_DESCS == CONS_NUM_DESCS);
+BUILD_ASSERT_DECL(FILL_CHUNK_SIZE % 8 == 0);
 
 #define UMEM2DESC(elem, base) ((uint64_t)((char *)elem - (char *)base))
 
 static struct xsk_socket_info *xsk_configure(int ifindex, int xdp_queue_id,
                                              enum afxdp_mode mode,
                                              bool use_need_wakeup,
+                                             int xsks_map_fd,
                                              bool report_socket_failures);
 static void xsk_remove_xdp_program(uint32_t ifindex, enum afxdp_mode);
 static void xsk_destroy(struct xsk_socket_info *xsk);
@@ -152,6 +165,11 @@ struct xsk_umem_info {
     void *buffer;
 };
 
+/* Per-socket magazine of free umem elements, recycled between the TX path
+ * and its completions without touching the shared, spinlocked 'mpool'.
+ * Accessed only under the per-queue TX lock. */
+#define TX_MAGAZINE_SIZE (4 * BATCH_SIZE)
+
 struct xsk_socket_info {
     struct xsk_ring_cons rx;
     struct xsk_ring_prod tx;
@@ -160,6 +178,8 @@ struct xsk_socket_info {
     uint32_t outstanding_tx; /* Number of descriptors filled in tx and cq. */
     uint32_t available_rx;   /* Number of descriptors filled in rx and fq. */
     atomic_uint64_t tx_dropped;
+    uint32_t tx_magazine_cnt;
+    void *tx_magazine[TX_MAGAZINE_SIZE];
 };
 
 struct netdev_afxdp_tx_lock {
@@ -334,7 +354,8 @@ xsk_configure_umem(void *buffer, uint64_t size)
 static struct xsk_socket_info *
 xsk_configure_socket(struct xsk_umem_info *umem, uint32_t ifindex,
                      uint32_t queue_id, enum afxdp_mode mode,
-                     bool use_need_wakeup, bool report_socket_failures)
+                     bool use_need_wakeup, int xsks_map_fd,
+                     bool report_socket_failures)
 {
     struct xsk_socket_config cfg;
     struct xsk_socket_info *xsk;
@@ -347,7 +368,10 @@ xsk_configure_socket(struct xsk_umem_info *umem, uint32_t ifindex,
     xsk->umem = umem;
     cfg.rx_size = CONS_NUM_DESCS;
     cfg.tx_size = PROD_NUM_DESCS;
-    cfg.libbpf_flags = 0;
+    /* With a custom XDP program attached, libbpf must not load its
+     * built-in one on top of it. */
+    cfg.libbpf_flags = xsks_map_fd >= 0 ? XSK_LIBBPF_FLAGS__INHIBIT_PROG_LOAD
+                                        : 0;
     cfg.bind_flags = xdp_modes[mode].bind_flags;
     cfg.xdp_flags = xdp_modes[mode].xdp_flags | XDP_FLAGS_UPDATE_IF_NOEXIST;
 
@@ -376,7 +400,7 @@ xsk_configure_socket(struct xsk_umem_info *umem, uint32_t ifindex,
         return NULL;
     }
 
-    /* Make sure the built-in AF_XDP program is loaded. */
+    /* Make sure an XDP program, built-in or custom, is loaded. */
     ret = bpf_get_link_xdp_id(ifindex, &prog_id, cfg.xdp_flags);
     if (ret || !prog_id) {
         if (ret) {
@@ -389,6 +413,22 @@ xsk_configure_socket(struct xsk_umem_info *umem, uint32_t ifindex,
         return NULL;
     }
 
+    /* The built-in program inserts the socket into its map itself; for a
+     * custom program the socket has to be published in its "xsks_map" so
+     * that XDP_REDIRECT from the program can reach this queue. */
+    if (xsks_map_fd >= 0) {
+        int xsk_fd = xsk_socket__fd(xsk->xsk);
+
+        ret = bpf_map_update_elem(xsks_map_fd, &queue_id, &xsk_fd, 0);
+        if (ret) {
+            VLOG_ERR("Failed to insert AF_XDP socket for queue %"PRIu32
+                     " into xsks_map (%s)", queue_id, ovs_strerror(errno));
+            xsk_socket__delete(xsk->xsk);
+            free(xsk);
+            return NULL;
+        }
+    }
+
     while (!xsk_ring_prod__reserve(&xsk->umem->fq,
                                    PROD_NUM_DESCS, &idx)) {
         VLOG_WARN_RL(&rl, "Retry xsk_ring_prod__reserve to FILL queue");
@@ -413,7 +453,8 @@ xsk_configure_socket(struct xsk_umem_info *umem, uint32_t ifindex,
 
 static struct xsk_socket_info *
 xsk_configure(int ifindex, int xdp_queue_id, enum afxdp_mode mode,
-              bool use_need_wakeup, bool report_socket_failures)
+              bool use_need_wakeup, int xsks_map_fd,
+              bool report_socket_failures)
 {
     struct xsk_socket_info *xsk;
     struct xsk_umem_info *umem;
@@ -435,7 +476,8 @@ xsk_configure(int ifindex, int xdp_queue_id, enum afxdp_mode mode,
     VLOG_DBG("Allocated umem pool at 0x%"PRIxPTR, (uintptr_t) umem);
 
     xsk = xsk_configure_socket(umem, ifindex, xdp_queue_id, mode,
-                               use_need_wakeup, report_socket_failures);
+                               use_need_wakeup, xsks_map_fd,
+                               report_socket_failures);
     if (!xsk) {
         /* Clean up umem and xpacket pool. */
         if (xsk_umem__delete(umem->umem)) {
@@ -459,6 +501,7 @@ xsk_configure_queue(struct netdev_linux *dev, int ifindex, int queue_id,
              netdev_get_name(&dev->up), queue_id, xdp_modes[mode].name,
              dev->use_need_wakeup ? "true" : "false");
     xsk_info = xsk_configure(ifindex, queue_id, mode, dev->use_need_wakeup,
+                             dev->xdp_obj ? dev->xsks_map_fd : -1,
                              report_socket_failures);
     if (!xsk_info) {
         VLOG(report_socket_failures ? VLL_ERR : VLL_DBG,
@@ -475,6 +518,66 @@ xsk_configure_queue(struct netdev_linux *dev, int ifindex, int queue_id,
 }
 
 
+/* Loads the custom XDP program at 'dev->xdp_prog'.  The program is only
+ * opened and verified here; it starts to see traffic once
+ * xsk_attach_custom_program() binds it to the interface. */
+static int
+xsk_load_custom_program(struct netdev_linux *dev)
+{
+    struct bpf_object *obj;
+    struct bpf_map *map;
+    int prog_fd;
+
+    if (bpf_prog_load(dev->xdp_prog, BPF_PROG_TYPE_XDP, &obj, &prog_fd)) {
+        VLOG_ERR("%s: Failed to load XDP program at '%s'.",
+                 netdev_get_name(&dev->up), dev->xdp_prog);
+        return EINVAL;
+    }
+
+    /* The program must redirect AF_XDP bound traffic to this map, keyed
+     * by rx queue id, for the userspace datapath to receive anything. */
+    map = bpf_object__find_map_by_name(obj, "xsks_map");
+    if (!map) {
+        VLOG_ERR("%s: XDP program at '%s' does not provide an \"xsks_map\".",
+                 netdev_get_name(&dev->up), dev->xdp_prog);
+        bpf_object__close(obj);
+        return EINVAL;
+    }
+
+    dev->xdp_obj = obj;
+    dev->xdp_prog_fd = prog_fd;
+    dev->xsks_map_fd = bpf_map__fd(map);
+    VLOG_INFO("%s: Loaded custom XDP program from '%s'.",
+              netdev_get_name(&dev->up), dev->xdp_prog);
+    return 0;
+}
+
+static int
+xsk_attach_custom_program(struct netdev_linux *dev, int ifindex,
+                          enum afxdp_mode mode)
+{
+    uint32_t flags = xdp_modes[mode].xdp_flags | XDP_FLAGS_UPDATE_IF_NOEXIST;
+
+    if (bpf_set_link_xdp_fd(ifindex, dev->xdp_prog_fd, flags)) {
+        VLOG_ERR("%s: Failed to attach XDP program in %s mode (%s).",
+                 netdev_get_name(&dev->up), xdp_modes[mode].name,
+                 ovs_strerror(errno));
+        return EINVAL;
+    }
+    return 0;
+}
+
+static void
+xsk_unload_custom_program(struct netdev_linux *dev)
+{
+    if (dev->xdp_obj) {
+        bpf_object__close(dev->xdp_obj);
+        dev->xdp_obj = NULL;
+        dev->xdp_prog_fd = -1;
+        dev->xsks_map_fd = -1;
+    }
+}
+
 static int
 xsk_configure_all(struct netdev *netdev)
 {
@@ -487,6 +590,10 @@ xsk_configure_all(struct netdev *netdev)
     ovs_assert(dev->xsks == NULL);
     ovs_assert(dev->tx_locks == NULL);
 
+    if (dev->xdp_prog && xsk_load_custom_program(dev)) {
+        return EINVAL;
+    }
+
     n_rxq = netdev_n_rxq(netdev);
     dev->xsks = xcalloc(n_rxq, sizeof *dev->xsks);
 
@@ -494,6 +601,10 @@ xsk_configure_all(struct netdev *netdev)
         /* Trying to configure first queue with different modes to
          * find the most suitable. */
         for (i = OVS_AF_XDP_MODE_NATIVE_ZC; i < OVS_AF_XDP_MODE_MAX; i++) {
+            if (dev->xdp_obj
+                && xsk_attach_custom_program(dev, ifindex, i)) {
+                continue;
+            }
             if (!xsk_configure_queue(dev, ifindex, qid, i,
                                      i == OVS_AF_XDP_MODE_MAX - 1)) {
                 dev->xdp_mode_in_use = i;
@@ -501,6 +612,9 @@ xsk_configure_all(struct netdev *netdev)
                           netdev_get_name(netdev), xdp_modes[i].name);
                 break;
             }
+            if (dev->xdp_obj) {
+                xsk_remove_xdp_program(ifindex, i);
+            }
         }
         if (i == OVS_AF_XDP_MODE_MAX) {
             VLOG_ERR("%s: Failed to detect suitable XDP mode.",
@@ -510,6 +624,10 @@ xsk_configure_all(struct netdev *netdev)
         qid++;
     } else {
         dev->xdp_mode_in_use = dev->xdp_mode;
+        if (dev->xdp_obj
+            && xsk_attach_custom_program(dev, ifindex, dev->xdp_mode)) {
+            goto err;
+        }
     }
 
     /* Configure remaining queues. */
@@ -550,6 +668,11 @@ xsk_destroy(struct xsk_socket_info *xsk_info)
         VLOG_ERR("xsk_umem__delete failed.");
     }
 
+    /* Elements cached in the TX magazine are free, not lost in rings. */
+    umem_elem_push_n(&xsk_info->umem->mpool, xsk_info->tx_magazine_cnt,
+                     xsk_info->tx_magazine);
+    xsk_info->tx_magazine_cnt = 0;
+
     pool = xzalloc(sizeof *pool);
     pool->umem_info = xsk_info->umem;
     pool->lost_in_rings = xsk_info->outstanding_tx + xsk_info->available_rx;
@@ -585,6 +708,7 @@ xsk_destroy_all(struct netdev *netdev)
     VLOG_INFO("%s: Removing xdp program.", netdev_get_name(netdev));
     ifindex = linux_get_ifindex(netdev_get_name(netdev));
     xsk_remove_xdp_program(ifindex, dev->xdp_mode_in_use);
+    xsk_unload_custom_program(dev);
 
     if (dev->tx_locks) {
         for (i = 0; i < netdev_n_txq(netdev); i++) {
@@ -601,6 +725,7 @@ netdev_afxdp_set_config(struct netdev *netdev, const struct smap *args,
 {
     struct netdev_linux *dev = netdev_linux_cast(netdev);
     const char *str_xdp_mode;
+    const char *xdp_prog;
     enum afxdp_mode xdp_mode;
     bool need_wakeup;
     int new_n_rxq;
@@ -637,12 +762,17 @@ netdev_afxdp_set_config(struct netdev *netdev, const struct smap *args,
     }
 #endif
 
+    xdp_prog = smap_get(args, "xdp-prog");
+
     if (dev->requested_n_rxq != new_n_rxq
         || dev->requested_xdp_mode != xdp_mode
-        || dev->requested_need_wakeup != need_wakeup) {
+        || dev->requested_need_wakeup != need_wakeup
+        || !nullable_string_is_equal(dev->requested_xdp_prog, xdp_prog)) {
         dev->requested_n_rxq = new_n_rxq;
         dev->requested_xdp_mode = xdp_mode;
         dev->requested_need_wakeup = need_wakeup;
+        free(dev->requested_xdp_prog);
+        dev->requested_xdp_prog = nullable_xstrdup(xdp_prog);
         netdev_request_reconfigure(netdev);
     }
     ovs_mutex_unlock(&dev->mutex);
@@ -661,6 +791,9 @@ netdev_afxdp_get_config(const struct netdev *netdev, struct smap *args)
                     xdp_modes[dev->xdp_mode_in_use].name);
     smap_add_format(args, "use-need-wakeup", "%s",
                     dev->use_need_wakeup ? "true" : "false");
+    if (dev->xdp_prog) {
+        smap_add(args, "xdp-prog", dev->xdp_prog);
+    }
     ovs_mutex_unlock(&dev->mutex);
     return 0;
 }
@@ -696,6 +829,7 @@ netdev_afxdp_reconfigure(struct netdev *netdev)
     if (netdev->n_rxq == dev->requested_n_rxq
         && dev->xdp_mode == dev->requested_xdp_mode
         && dev->use_need_wakeup == dev->requested_need_wakeup
+        && nullable_string_is_equal(dev->xdp_prog, dev->requested_xdp_prog)
         && dev->xsks) {
         goto out;
     }
@@ -714,6 +848,9 @@ netdev_afxdp_reconfigure(struct netdev *netdev)
     }
     dev->use_need_wakeup = dev->requested_need_wakeup;
 
+    free(dev->xdp_prog);
+    dev->xdp_prog = nullable_xstrdup(dev->requested_xdp_prog);
+
     err = xsk_configure_all(netdev);
     if (err) {
         VLOG_ERR("%s: AF_XDP device reconfiguration failed.",
@@ -779,28 +916,28 @@ static inline void
 prepare_fill_queue(struct xsk_socket_info *xsk_info)
 {
     struct xsk_umem_info *umem;
-    void *elems[BATCH_SIZE];
+    void *elems[FILL_CHUNK_SIZE];
     unsigned int idx_fq;
     int i, ret;
 
     umem = xsk_info->umem;
 
-    if (xsk_prod_nb_free(&umem->fq, BATCH_SIZE) < BATCH_SIZE) {
+    if (xsk_prod_nb_free(&umem->fq, FILL_CHUNK_SIZE) < FILL_CHUNK_SIZE) {
         return;
     }
 
-    ret = umem_elem_pop_n(&umem->mpool, BATCH_SIZE, elems);
+    ret = umem_elem_pop_n(&umem->mpool, FILL_CHUNK_SIZE, elems);
     if (OVS_UNLIKELY(ret)) {
         return;
     }
 
-    if (!xsk_ring_prod__reserve(&umem->fq, BATCH_SIZE, &idx_fq)) {
-        umem_elem_push_n(&umem->mpool, BATCH_SIZE, elems);
+    if (!xsk_ring_prod__reserve(&umem->fq, FILL_CHUNK_SIZE, &idx_fq)) {
+        umem_elem_push_n(&umem->mpool, FILL_CHUNK_SIZE, elems);
         COVERAGE_INC(afxdp_fq_full);
         return;
     }
 
-    for (i = 0; i < BATCH_SIZE; i++) {
+    for (i = 0; i < FILL_CHUNK_SIZE; i++) {
         uint64_t index;
         void *elem;
 
@@ -811,8 +948,8 @@ prepare_fill_queue(struct xsk_socket_info *xsk_info)
 
         idx_fq++;
     }
-    xsk_ring_prod__submit(&umem->fq, BATCH_SIZE);
-    xsk_info->available_rx += BATCH_SIZE;
+    xsk_ring_prod__submit(&umem->fq, FILL_CHUNK_SIZE);
+    xsk_info->available_rx += FILL_CHUNK_SIZE;
 }
 
 int
@@ -980,6 +1117,21 @@ check_free_batch(struct dp_packet_batch *batch)
     return true;
 }
 
+/* Returns free umem elements to the per-socket TX magazine, spilling to the
+ * shared mpool once the magazine is full.  Caller holds the TX lock. */
+static inline void
+afxdp_tx_elems_free(struct xsk_socket_info *xsk_info, int n, void **elems)
+{
+    int i = 0;
+
+    while (i < n && xsk_info->tx_magazine_cnt < TX_MAGAZINE_SIZE) {
+        xsk_info->tx_magazine[xsk_info->tx_magazine_cnt++] = elems[i++];
+    }
+    if (i < n) {
+        umem_elem_push_n(&xsk_info->umem->mpool, n - i, &elems[i]);
+    }
+}
+
 static inline void
 afxdp_complete_tx(struct xsk_socket_info *xsk_info)
 {
@@ -992,7 +1144,7 @@ afxdp_complete_tx(struct xsk_socket_info *xsk_info)
     umem = xsk_info->umem;
     tx_done = xsk_ring_cons__peek(&umem->cq, CONS_NUM_DESCS, &idx_cq);
 
-    /* Recycle back to umem pool. */
+    /* Recycle into the TX magazine, overflowing to the umem pool. */
     for (j = 0; j < tx_done; j++) {
         uint64_t *addr;
         void *elem;
@@ -1009,7 +1161,7 @@ afxdp_complete_tx(struct xsk_socket_info *xsk_info)
         }
 
         if (tx_to_free == BATCH_SIZE || j == tx_done - 1) {
-            umem_elem_push_n(&umem->mpool, tx_to_free, elems_push);
+            afxdp_tx_elems_free(xsk_info, tx_to_free, elems_push);
             xsk_info->outstanding_tx -= tx_to_free;
             tx_to_free = 0;
         }
@@ -1042,13 +1194,34 @@ __netdev_afxdp_batch_send(struct netdev *netdev, int qid,
         goto out;
     }
 
-    afxdp_complete_tx(xsk_info);
+    /* Reap completions lazily: the completion queue's cache lines are
+     * shared with the kernel, so peek it only once enough descriptors are
+     * outstanding to amortize the traffic. */
+    if (xsk_info->outstanding_tx >= CQ_REAP_THRESH) {
+        afxdp_complete_tx(xsk_info);
+    }
 
     free_batch = check_free_batch(batch);
 
     umem = xsk_info->umem;
-    ret = umem_elem_pop_n(&umem->mpool, dp_packet_batch_size(batch),
-                          elems_pop);
+    if (xsk_info->tx_magazine_cnt >= dp_packet_batch_size(batch)) {
+        /* Serve the whole batch from the per-socket magazine, avoiding the
+         * shared pool's spinlock on the common TX path. */
+        xsk_info->tx_magazine_cnt -= dp_packet_batch_size(batch);
+        memcpy(elems_pop, &xsk_info->tx_magazine[xsk_info->tx_magazine_cnt],
+               dp_packet_batch_size(batch) * sizeof elems_pop[0]);
+        ret = 0;
+    } else {
+        ret = umem_elem_pop_n(&umem->mpool, dp_packet_batch_size(batch),
+                              elems_pop);
+        if (OVS_UNLIKELY(ret)) {
+            /* The pool may be exhausted only because completions have not
+             * been reaped for a while: reap them and retry once. */
+            afxdp_complete_tx(xsk_info);
+            ret = umem_elem_pop_n(&umem->mpool, dp_packet_batch_size(batch),
+                                  elems_pop);
+        }
+    }
     if (OVS_UNLIKELY(ret)) {
         atomic_add_relaxed(&xsk_info->tx_dropped, dp_packet_batch_size(batch),
                            &orig);
@@ -1062,7 +1235,7 @@ __netdev_afxdp_batch_send(struct netdev *netdev, int qid,
     ret = xsk_ring_prod__reserve(&xsk_info->tx, dp_packet_batch_size(batch),
                                  &idx);
     if (OVS_UNLIKELY(ret == 0)) {
-        umem_elem_push_n(&umem->mpool, dp_packet_batch_size(batch), elems_pop);
+        afxdp_tx_elems_free(xsk_info, dp_packet_batch_size(batch), elems_pop);
         atomic_add_relaxed(&xsk_info->tx_dropped, dp_packet_batch_size(batch),
                            &orig);
         COVERAGE_INC(afxdp_tx_full);
@@ -1184,6 +1357,12 @@ netdev_afxdp_construct(struct netdev *netdev)
     dev->requested_xdp_mode = OVS_AF_XDP_MODE_BEST_EFFORT;
     dev->requested_need_wakeup = NEED_WAKEUP_DEFAULT;
 
+    dev->xdp_prog = NULL;
+    dev->requested_xdp_prog = NULL;
+    dev->xdp_obj = NULL;
+    dev->xdp_prog_fd = -1;
+    dev->xsks_map_fd = -1;
+
     dev->xsks = NULL;
     dev->tx_locks = NULL;
 
@@ -1207,6 +1386,8 @@ netdev_afxdp_destruct(struct netdev *netdev)
      * skb-mode, we might need to clean up tc. */
 
     xsk_destroy_all(netdev);
+    free(dev->xdp_prog);
+    free(dev->requested_xdp_prog);
     ovs_mutex_destroy(&dev->mutex);
 }
 
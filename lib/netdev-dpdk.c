@@ -2562,6 +2562,48 @@ netdev_dpdk_vhost_update_tx_counters(struct netdev_dpdk *dev,
     }
 }
 
+/* Frees the 'cnt' DPDK packets in 'pkts'.  Direct, single-segment mbufs
+ * with no outstanding references are returned to their mempool in bulk,
+ * which amortizes the mempool cache manipulation that rte_pktmbuf_free()
+ * pays once per packet; anything else is freed one at a time. */
+static void
+netdev_dpdk_pktmbuf_free_bulk(struct dp_packet **pkts, int cnt)
+{
+    struct rte_mbuf *free_batch[NETDEV_MAX_BURST];
+    struct rte_mempool *mp = NULL;
+    unsigned int n_free = 0;
+    int i;
+
+    for (i = 0; i < cnt; i++) {
+        struct rte_mbuf *pkt = &pkts[i]->mbuf;
+        struct rte_mbuf *seg;
+
+        if (OVS_UNLIKELY(pkt->next != NULL || !RTE_MBUF_DIRECT(pkt))) {
+            rte_pktmbuf_free(pkt);
+            continue;
+        }
+
+        seg = rte_pktmbuf_prefree_seg(pkt);
+        if (OVS_UNLIKELY(!seg)) {
+            /* Still referenced elsewhere. */
+            continue;
+        }
+
+        if (seg->pool != mp || n_free == NETDEV_MAX_BURST) {
+            if (n_free) {
+                rte_mempool_put_bulk(mp, (void **) free_batch, n_free);
+            }
+            mp = seg->pool;
+            n_free = 0;
+        }
+        free_batch[n_free++] = seg;
+    }
+
+    if (n_free) {
+        rte_mempool_put_bulk(mp, (void **) free_batch, n_free);
+    }
+}
+
 static void
 __netdev_dpdk_vhost_send(struct netdev *netdev, int qid,
                          struct dp_packet **pkts, int cnt)
@@ -2571,7 +2613,7 @@ __netdev_dpdk_vhost_send(struct netdev *netdev, int qid,
     struct netdev_dpdk_sw_stats sw_stats_add;
     unsigned int n_packets_to_free = cnt;
     unsigned int total_packets = cnt;
-    int i, retries = 0;
+    int retries = 0;
     int max_retries = VHOST_ENQ_RETRY_MIN;
     int vid = netdev_dpdk_get_vid(dev);
 
@@ -2641,9 +2683,9 @@ __netdev_dpdk_vhost_send(struct netdev *netdev, int qid,
     rte_spinlock_unlock(&dev->stats_lock);
 
 out:
-    for (i = 0; i < n_packets_to_free; i++) {
-        dp_packet_delete(pkts[i]);
-    }
+    /* All packets here are DPDK mbufs: either the caller's batch was
+     * DPBUF_DPDK, or dpdk_do_tx_copy() allocated them from 'dpdk_mp'. */
+    netdev_dpdk_pktmbuf_free_bulk(pkts, n_packets_to_free);
 }
 
 static void
@@ -5162,6 +5204,35 @@ out:
     return ret;
 }
 
+/* Requests that 'netdev' allocate its packet buffers and descriptor rings on
+ * NUMA node 'numa_id'.  The datapath calls this when every pmd polling the
+ * port lives on a remote node, in which case moving the buffers to the
+ * consuming node keeps the pmd's reads local and leaves only the NIC's DMA
+ * writes crossing the interconnect.  Takes effect on the next reconfigure.
+ *
+ * vhost devices already track the guest's node, so only physical ports are
+ * steered here. */
+void
+netdev_dpdk_set_preferred_numa_id(struct netdev *netdev, int numa_id)
+{
+    struct netdev_dpdk *dev;
+
+    if (!is_dpdk_class(netdev->netdev_class) || numa_id < 0) {
+        return;
+    }
+
+    dev = netdev_dpdk_cast(netdev);
+    ovs_mutex_lock(&dev->mutex);
+    if (dev->type == DPDK_DEV_ETH && dev->requested_socket_id != numa_id) {
+        VLOG_INFO("%s: Moving packet buffers from numa node %d to node %d "
+                  "to match the polling threads.",
+                  netdev_get_name(netdev), dev->requested_socket_id, numa_id);
+        dev->requested_socket_id = numa_id;
+        netdev_request_reconfigure(netdev);
+    }
+    ovs_mutex_unlock(&dev->mutex);
+}
+
 bool
 netdev_dpdk_flow_api_supported(struct netdev *netdev)
 {
@@ -56,6 +56,8 @@ netdev_dpdk_rte_flow_query_count(struct netdev *netdev,
 int
 netdev_dpdk_get_port_id(struct netdev *netdev);
 
+void netdev_dpdk_set_preferred_numa_id(struct netdev *netdev, int numa_id);
+
 #else
 
 static inline void
@@ -69,6 +71,13 @@ free_dpdk_buf(struct dp_packet *buf OVS_UNUSED)
     /* Nothing */
 }
 
+static inline void
+netdev_dpdk_set_preferred_numa_id(struct netdev *netdev OVS_UNUSED,
+                                  int numa_id OVS_UNUSED)
+{
+    /* Nothing */
+}
+
 #endif
 
 #endif /* netdev-dpdk.h */
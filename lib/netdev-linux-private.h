@@ -117,6 +117,13 @@ struct netdev_linux {
     bool use_need_wakeup;
     bool requested_need_wakeup;
 
+    char *xdp_prog;             /* Path of the custom XDP program in use,
+                                 * or NULL for the libbpf built-in one. */
+    char *requested_xdp_prog;   /* Requested custom XDP program path. */
+    struct bpf_object *xdp_obj; /* Loaded custom XDP program, if any. */
+    int xdp_prog_fd;            /* Program fd within 'xdp_obj'. */
+    int xsks_map_fd;            /* "xsks_map" fd within 'xdp_obj'. */
+
     struct netdev_afxdp_tx_lock *tx_locks;  /* Array of locks for TX queues. */
 #endif
 };
@@ -1541,8 +1541,10 @@ netdev_linux_sock_batch_send(int sock, int ifindex, bool tso, int mtu,
     struct sockaddr_ll sll = { .sll_family = AF_PACKET,
                                .sll_ifindex = ifindex };
 
-    struct mmsghdr *mmsg = xmalloc(sizeof(*mmsg) * size);
-    struct iovec *iov = xmalloc(sizeof(*iov) * size);
+    /* A batch never exceeds NETDEV_MAX_BURST packets, so the headers fit
+     * on the stack and need not be allocated per call. */
+    struct mmsghdr mmsg[NETDEV_MAX_BURST];
+    struct iovec iov[NETDEV_MAX_BURST];
 
     struct dp_packet *packet;
     DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
@@ -1571,8 +1573,6 @@ netdev_linux_sock_batch_send(int sock, int ifindex, bool tso, int mtu,
         ofs += retval;
     }
 
-    free(mmsg);
-    free(iov);
     return error;
 }
 
@@ -6195,9 +6195,84 @@ netdev_stats_from_rtnl_link_stats64(struct netdev_stats *dst,
     dst->tx_window_errors = src->tx_window_errors;
 }
 
+/* Parses the link statistics attributes of an RTM_NEWLINK message whose
+ * nlmsghdr and ifinfomsg have already been pulled from 'msg' into 'stats'.
+ * Returns 0 if successful, otherwise EPROTO. */
+static int
+parse_rtnl_link_stats(const struct ofpbuf *msg, struct netdev_stats *stats)
+{
+    const struct nlattr *a = nl_attr_find(msg, 0, IFLA_STATS64);
+
+    if (a && nl_attr_get_size(a) >= sizeof(struct rtnl_link_stats64)) {
+        netdev_stats_from_rtnl_link_stats64(stats, nl_attr_get(a));
+        return 0;
+    }
+    a = nl_attr_find(msg, 0, IFLA_STATS);
+    if (a && nl_attr_get_size(a) >= sizeof(struct rtnl_link_stats)) {
+        netdev_stats_from_rtnl_link_stats(stats, nl_attr_get(a));
+        return 0;
+    }
+    return EPROTO;
+}
+
+/* Cache of link statistics for every device in the local namespace,
+ * refreshed with a single RTM_GETLINK dump.  A periodic stats sweep over
+ * many ports otherwise costs one netlink round trip per device. */
+static struct ovs_mutex stats_dump_mutex = OVS_MUTEX_INITIALIZER;
+static struct shash stats_dump_cache OVS_GUARDED_BY(stats_dump_mutex)
+    = SHASH_INITIALIZER(&stats_dump_cache);
+static long long int stats_dump_expires OVS_GUARDED_BY(stats_dump_mutex)
+    = LLONG_MIN;
+
+/* How long a dumped snapshot of link statistics stays valid, in
+ * milliseconds.  Within one stats sweep every device hits the same
+ * snapshot; the next sweep dumps afresh. */
+#define STATS_DUMP_VALIDITY_MSEC 1000
+
+static void
+refresh_stats_dump_cache(void)
+    OVS_REQUIRES(stats_dump_mutex)
+{
+    struct ofpbuf request, reply, buf;
+    struct nl_dump dump;
+
+    shash_clear_free_data(&stats_dump_cache);
+
+    ofpbuf_init(&request, 0);
+    nl_msg_put_nlmsghdr(&request, sizeof(struct ifinfomsg), RTM_GETLINK,
+                        NLM_F_REQUEST);
+    ofpbuf_put_zeros(&request, sizeof(struct ifinfomsg));
+    nl_dump_start(&dump, NETLINK_ROUTE, &request);
+    ofpbuf_uninit(&request);
+
+    ofpbuf_init(&buf, NL_DUMP_BUFSIZE);
+    while (nl_dump_next(&dump, &reply, &buf)) {
+        struct ofpbuf msg = reply;
+
+        if (ofpbuf_try_pull(&msg, NLMSG_HDRLEN + sizeof(struct ifinfomsg))) {
+            const struct nlattr *name = nl_attr_find(&msg, 0, IFLA_IFNAME);
+            struct netdev_stats stats;
+
+            memset(&stats, 0xFF, sizeof stats);
+            if (name && !parse_rtnl_link_stats(&msg, &stats)) {
+                shash_add(&stats_dump_cache, nl_attr_get_string(name),
+                          xmemdup(&stats, sizeof stats));
+            }
+        }
+    }
+    ofpbuf_uninit(&buf);
+    if (nl_dump_done(&dump)) {
+        /* Devices missing from the cache fall back to individual
+         * requests. */
+        shash_clear_free_data(&stats_dump_cache);
+    }
+    stats_dump_expires = time_msec() + STATS_DUMP_VALIDITY_MSEC;
+}
+
 int
 get_stats_via_netlink(const struct netdev *netdev_, struct netdev_stats *stats)
 {
+    const struct netdev_stats *cached;
     struct ofpbuf request;
     struct ofpbuf *reply;
     int error;
@@ -6205,6 +6280,22 @@ get_stats_via_netlink(const struct netdev *netdev_, struct netdev_stats *stats)
     /* Filtering all counters by default */
     memset(stats, 0xFF, sizeof(struct netdev_stats));
 
+    /* Serve from the dumped snapshot whenever possible. */
+    ovs_mutex_lock(&stats_dump_mutex);
+    if (time_msec() >= stats_dump_expires) {
+        refresh_stats_dump_cache();
+    }
+    cached = shash_find_data(&stats_dump_cache, netdev_get_name(netdev_));
+    if (cached) {
+        *stats = *cached;
+    }
+    ovs_mutex_unlock(&stats_dump_mutex);
+    if (cached) {
+        return 0;
+    }
+
+    /* Not in the dump, e.g. the device appeared after the snapshot was
+     * taken; ask for it individually. */
     ofpbuf_init(&request, 0);
     nl_msg_put_nlmsghdr(&request,
                         sizeof(struct ifinfomsg) + NL_ATTR_SIZE(IFNAMSIZ),
@@ -6218,26 +6309,15 @@ get_stats_via_netlink(const struct netdev *netdev_, struct netdev_stats *stats)
     }
 
     if (ofpbuf_try_pull(reply, NLMSG_HDRLEN + sizeof(struct ifinfomsg))) {
-        const struct nlattr *a = nl_attr_find(reply, 0, IFLA_STATS64);
-        if (a && nl_attr_get_size(a) >= sizeof(struct rtnl_link_stats64)) {
-            netdev_stats_from_rtnl_link_stats64(stats, nl_attr_get(a));
-            error = 0;
-        } else {
-            a = nl_attr_find(reply, 0, IFLA_STATS);
-            if (a && nl_attr_get_size(a) >= sizeof(struct rtnl_link_stats)) {
-                netdev_stats_from_rtnl_link_stats(stats, nl_attr_get(a));
-                error = 0;
-            } else {
-                VLOG_WARN_RL(&rl, "RTM_GETLINK reply lacks stats");
-                error = EPROTO;
-            }
+        error = parse_rtnl_link_stats(reply, stats);
+        if (error) {
+            VLOG_WARN_RL(&rl, "RTM_GETLINK reply lacks stats");
         }
     } else {
         VLOG_WARN_RL(&rl, "short RTM_GETLINK reply");
         error = EPROTO;
     }
 
-
     ofpbuf_delete(reply);
     return error;
 }
@@ -217,11 +217,11 @@ udp_extract_tnl_md(struct dp_packet *packet, struct flow_tnl *tnl,
 
 static void
 netdev_tnl_calc_udp_csum(struct udp_header *udp, struct dp_packet *packet,
-                         int ip_tot_size)
+                         int ip_tot_size, bool is_ipv6)
 {
     uint32_t csum;
 
-    if (netdev_tnl_is_header_ipv6(dp_packet_data(packet))) {
+    if (is_ipv6) {
         csum = packet_csum_pseudoheader6(netdev_tnl_ipv6_hdr(
                                          dp_packet_data(packet)));
     } else {
@@ -239,20 +239,26 @@ netdev_tnl_calc_udp_csum(struct udp_header *udp, struct dp_packet *packet,
 
 void
 netdev_tnl_push_udp_header(const struct netdev *netdev OVS_UNUSED,
-                           struct dp_packet *packet,
+                           struct dp_packet_batch *batch,
                            const struct ovs_action_push_tnl *data)
 {
-    struct udp_header *udp;
-    int ip_tot_size;
+    const bool is_ipv6 = netdev_tnl_is_header_ipv6(data->header);
+    struct dp_packet *packet;
 
-    udp = netdev_tnl_push_ip_header(packet, data->header, data->header_len, &ip_tot_size);
+    DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+        struct udp_header *udp;
+        int ip_tot_size;
 
-    /* set udp src port */
-    udp->udp_src = netdev_tnl_get_src_port(packet);
-    udp->udp_len = htons(ip_tot_size);
+        udp = netdev_tnl_push_ip_header(packet, data->header,
+                                        data->header_len, &ip_tot_size);
 
-    if (udp->udp_csum) {
-        netdev_tnl_calc_udp_csum(udp, packet, ip_tot_size);
+        /* set udp src port */
+        udp->udp_src = netdev_tnl_get_src_port(packet);
+        udp->udp_len = htons(ip_tot_size);
+
+        if (udp->udp_csum) {
+            netdev_tnl_calc_udp_csum(udp, packet, ip_tot_size, is_ipv6);
+        }
     }
 }
 
@@ -448,28 +454,32 @@ err:
 
 void
 netdev_gre_push_header(const struct netdev *netdev,
-                       struct dp_packet *packet,
+                       struct dp_packet_batch *batch,
                        const struct ovs_action_push_tnl *data)
 {
     struct netdev_vport *dev = netdev_vport_cast(netdev);
-    struct netdev_tunnel_config *tnl_cfg;
-    struct gre_base_hdr *greh;
-    int ip_tot_size;
+    struct netdev_tunnel_config *tnl_cfg = &dev->tnl_cfg;
+    struct dp_packet *packet;
 
-    greh = netdev_tnl_push_ip_header(packet, data->header, data->header_len, &ip_tot_size);
+    DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+        struct gre_base_hdr *greh;
+        int ip_tot_size;
 
-    if (greh->flags & htons(GRE_CSUM)) {
-        ovs_be16 *csum_opt = (ovs_be16 *) (greh + 1);
-        *csum_opt = csum(greh, ip_tot_size);
-    }
+        greh = netdev_tnl_push_ip_header(packet, data->header,
+                                         data->header_len, &ip_tot_size);
 
-    if (greh->flags & htons(GRE_SEQ)) {
-        /* Last 4 byte is GRE seqno */
-        int seq_ofs = gre_header_len(greh->flags) - 4;
-        ovs_16aligned_be32 *seq_opt =
-            ALIGNED_CAST(ovs_16aligned_be32 *, (char *)greh + seq_ofs);
-        tnl_cfg = &dev->tnl_cfg;
-        put_16aligned_be32(seq_opt, htonl(tnl_cfg->seqno++));
+        if (greh->flags & htons(GRE_CSUM)) {
+            ovs_be16 *csum_opt = (ovs_be16 *) (greh + 1);
+            *csum_opt = csum(greh, ip_tot_size);
+        }
+
+        if (greh->flags & htons(GRE_SEQ)) {
+            /* Last 4 byte is GRE seqno */
+            int seq_ofs = gre_header_len(greh->flags) - 4;
+            ovs_16aligned_be32 *seq_opt =
+                ALIGNED_CAST(ovs_16aligned_be32 *, (char *) greh + seq_ofs);
+            put_16aligned_be32(seq_opt, htonl(tnl_cfg->seqno++));
+        }
     }
 }
 
@@ -601,29 +611,32 @@ err:
 
 void
 netdev_erspan_push_header(const struct netdev *netdev,
-                          struct dp_packet *packet,
+                          struct dp_packet_batch *batch,
                           const struct ovs_action_push_tnl *data)
 {
     struct netdev_vport *dev = netdev_vport_cast(netdev);
-    struct netdev_tunnel_config *tnl_cfg;
-    struct erspan_base_hdr *ersh;
-    struct gre_base_hdr *greh;
-    struct erspan_md2 *md2;
-    int ip_tot_size;
-
-    greh = netdev_tnl_push_ip_header(packet, data->header,
-                                     data->header_len, &ip_tot_size);
-
-    /* update GRE seqno */
-    tnl_cfg = &dev->tnl_cfg;
-    ovs_16aligned_be32 *seqno = (ovs_16aligned_be32 *) (greh + 1);
-    put_16aligned_be32(seqno, htonl(tnl_cfg->seqno++));
-
-    /* update v2 timestamp */
-    if (greh->protocol == htons(ETH_TYPE_ERSPAN2)) {
-        ersh = ERSPAN_HDR(greh);
-        md2 = ALIGNED_CAST(struct erspan_md2 *, ersh + 1);
-        put_16aligned_be32(&md2->timestamp, get_erspan_ts(ERSPAN_100US));
+    struct netdev_tunnel_config *tnl_cfg = &dev->tnl_cfg;
+    struct dp_packet *packet;
+
+    DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+        struct erspan_base_hdr *ersh;
+        struct gre_base_hdr *greh;
+        struct erspan_md2 *md2;
+        int ip_tot_size;
+
+        greh = netdev_tnl_push_ip_header(packet, data->header,
+                                         data->header_len, &ip_tot_size);
+
+        /* update GRE seqno */
+        ovs_16aligned_be32 *seqno = (ovs_16aligned_be32 *) (greh + 1);
+        put_16aligned_be32(seqno, htonl(tnl_cfg->seqno++));
+
+        /* update v2 timestamp */
+        if (greh->protocol == htons(ETH_TYPE_ERSPAN2)) {
+            ersh = ERSPAN_HDR(greh);
+            md2 = ALIGNED_CAST(struct erspan_md2 *, ersh + 1);
+            put_16aligned_be32(&md2->timestamp, get_erspan_ts(ERSPAN_100US));
+        }
     }
 }
 
@@ -782,32 +795,36 @@ err:
 
 void
 netdev_gtpu_push_header(const struct netdev *netdev,
-                        struct dp_packet *packet,
+                        struct dp_packet_batch *batch,
                         const struct ovs_action_push_tnl *data)
 {
     struct netdev_vport *dev = netdev_vport_cast(netdev);
-    struct netdev_tunnel_config *tnl_cfg;
-    struct udp_header *udp;
-    struct gtpuhdr *gtpuh;
-    int ip_tot_size;
-    unsigned int payload_len;
-
-    payload_len = dp_packet_size(packet);
-    udp = netdev_tnl_push_ip_header(packet, data->header,
-                                    data->header_len, &ip_tot_size);
-    udp->udp_src = netdev_tnl_get_src_port(packet);
-    udp->udp_len = htons(ip_tot_size);
-    netdev_tnl_calc_udp_csum(udp, packet, ip_tot_size);
-
-    gtpuh = ALIGNED_CAST(struct gtpuhdr *, udp + 1);
-
-    tnl_cfg = &dev->tnl_cfg;
-    if (tnl_cfg->set_seq) {
-        ovs_be16 *seqno = ALIGNED_CAST(ovs_be16 *, gtpuh + 1);
-        *seqno = htons(tnl_cfg->seqno++);
-        payload_len += sizeof(struct gtpuhdr_opt);
+    struct netdev_tunnel_config *tnl_cfg = &dev->tnl_cfg;
+    const bool is_ipv6 = netdev_tnl_is_header_ipv6(data->header);
+    struct dp_packet *packet;
+
+    DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+        struct udp_header *udp;
+        struct gtpuhdr *gtpuh;
+        int ip_tot_size;
+        unsigned int payload_len;
+
+        payload_len = dp_packet_size(packet);
+        udp = netdev_tnl_push_ip_header(packet, data->header,
+                                        data->header_len, &ip_tot_size);
+        udp->udp_src = netdev_tnl_get_src_port(packet);
+        udp->udp_len = htons(ip_tot_size);
+        netdev_tnl_calc_udp_csum(udp, packet, ip_tot_size, is_ipv6);
+
+        gtpuh = ALIGNED_CAST(struct gtpuhdr *, udp + 1);
+
+        if (tnl_cfg->set_seq) {
+            ovs_be16 *seqno = ALIGNED_CAST(ovs_be16 *, gtpuh + 1);
+            *seqno = htons(tnl_cfg->seqno++);
+            payload_len += sizeof(struct gtpuhdr_opt);
+        }
+        gtpuh->len = htons(payload_len);
     }
-    gtpuh->len = htons(payload_len);
 }
 
 int
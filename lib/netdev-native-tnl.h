@@ -35,7 +35,7 @@ netdev_gre_build_header(const struct netdev *netdev,
 
 void
 netdev_gre_push_header(const struct netdev *netdev,
-                       struct dp_packet *packet,
+                       struct dp_packet_batch *batch,
                        const struct ovs_action_push_tnl *data);
 struct dp_packet *
 netdev_gre_pop_header(struct dp_packet *packet);
@@ -47,7 +47,7 @@ netdev_erspan_build_header(const struct netdev *netdev,
 
 void
 netdev_erspan_push_header(const struct netdev *netdev,
-                          struct dp_packet *packet,
+                          struct dp_packet_batch *batch,
                           const struct ovs_action_push_tnl *data);
 struct dp_packet *
 netdev_erspan_pop_header(struct dp_packet *packet);
@@ -57,7 +57,7 @@ netdev_gtpu_pop_header(struct dp_packet *packet);
 
 void
 netdev_gtpu_push_header(const struct netdev *netdev,
-                        struct dp_packet *packet,
+                        struct dp_packet_batch *batch,
                         const struct ovs_action_push_tnl *data);
 
 int
@@ -67,7 +67,7 @@ netdev_gtpu_build_header(const struct netdev *netdev,
 
 void
 netdev_tnl_push_udp_header(const struct netdev *netdev,
-                           struct dp_packet *packet,
+                           struct dp_packet_batch *batch,
                            const struct ovs_action_push_tnl *data);
 int
 netdev_geneve_build_header(const struct netdev *netdev,
@@ -26,6 +26,7 @@
 #include "netdev-provider.h"
 #include "openvswitch/match.h"
 #include "openvswitch/vlog.h"
+#include "ovs-thread.h"
 #include "packets.h"
 #include "uuid.h"
 
@@ -35,10 +36,11 @@ static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(100, 5);
 /* Thread-safety
  * =============
  *
- * Below API is NOT thread safe in following terms:
- *
- *  - The caller must be sure that none of these functions will be called
- *    simultaneously.  Even for different 'netdev's.
+ * Below API may be called simultaneously for different 'netdev's.  Calls
+ * for any single 'netdev' are serialized internally, by hashing the device
+ * into one of a small set of mutexes, since rte_flow operations on one port
+ * are not guaranteed to be thread safe.  The remaining restrictions on the
+ * caller are:
  *
  *  - The caller must be sure that 'netdev' will not be destructed/deallocated.
  *
@@ -46,13 +48,37 @@ static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(100, 5);
  *    For example, simultaneous call of 'netdev_reconfigure()' for the same
  *    'netdev' is forbidden.
  *
- * For current implementation all above restrictions could be fulfilled by
- * taking the datapath 'port_mutex' in lib/dpif-netdev.c.  */
+ * For current implementation all above restrictions are fulfilled by the
+ * offload threads in lib/dpif-netdev.c, which key their work queues by port
+ * and hold a reference to the 'netdev' for the duration of each call.  */
+
+#define NETDEV_OFFLOAD_LOCKS 16
+static struct ovs_mutex netdev_offload_locks[NETDEV_OFFLOAD_LOCKS];
+
+/* Returns the mutex serializing offload operations on 'netdev'. */
+static struct ovs_mutex *
+netdev_offload_dpdk_lock(const struct netdev *netdev)
+{
+    static struct ovsthread_once once = OVSTHREAD_ONCE_INITIALIZER;
+
+    if (ovsthread_once_start(&once)) {
+        for (int i = 0; i < NETDEV_OFFLOAD_LOCKS; i++) {
+            ovs_mutex_init(&netdev_offload_locks[i]);
+        }
+        ovsthread_once_done(&once);
+    }
+
+    return &netdev_offload_locks[hash_pointer(netdev, 0)
+                                 % NETDEV_OFFLOAD_LOCKS];
+}
 
 /*
- * A mapping from ufid to dpdk rte_flow.
+ * A mapping from ufid to dpdk rte_flow.  Insertions and removals may happen
+ * from offload threads working on different 'netdev's, so they are
+ * serialized by 'ufid_map_mutex'.  Lookups are lockless cmap reads.
  */
 static struct cmap ufid_to_rte_flow = CMAP_INITIALIZER;
+static struct ovs_mutex ufid_map_mutex = OVS_MUTEX_INITIALIZER;
 
 struct ufid_to_rte_flow_data {
     struct cmap_node node;
@@ -101,8 +127,10 @@ ufid_to_rte_flow_associate(const ovs_u128 *ufid,
     data->rte_flow = rte_flow;
     data->actions_offloaded = actions_offloaded;
 
+    ovs_mutex_lock(&ufid_map_mutex);
     cmap_insert(&ufid_to_rte_flow,
                 CONST_CAST(struct cmap_node *, &data->node), hash);
+    ovs_mutex_unlock(&ufid_map_mutex);
 }
 
 static inline void
@@ -113,8 +141,10 @@ ufid_to_rte_flow_disassociate(const ovs_u128 *ufid)
 
     CMAP_FOR_EACH_WITH_HASH (data, node, hash, &ufid_to_rte_flow) {
         if (ovs_u128_equals(*ufid, data->ufid)) {
+            ovs_mutex_lock(&ufid_map_mutex);
             cmap_remove(&ufid_to_rte_flow,
                         CONST_CAST(struct cmap_node *, &data->node), hash);
+            ovs_mutex_unlock(&ufid_map_mutex);
             ovsrcu_postpone(free, data);
             return;
         }
@@ -1494,9 +1524,12 @@ netdev_offload_dpdk_flow_put(struct netdev *netdev, struct match *match,
                              const ovs_u128 *ufid, struct offload_info *info,
                              struct dpif_flow_stats *stats)
 {
+    struct ovs_mutex *lock = netdev_offload_dpdk_lock(netdev);
     struct ufid_to_rte_flow_data *rte_flow_data;
     int ret;
 
+    ovs_mutex_lock(lock);
+
     /*
      * If an old rte_flow exists, it means it's a flow modification.
      * Here destroy the old rte flow first before adding a new one.
@@ -1506,33 +1539,44 @@ netdev_offload_dpdk_flow_put(struct netdev *netdev, struct match *match,
         ret = netdev_offload_dpdk_destroy_flow(netdev, ufid,
                                                rte_flow_data->rte_flow);
         if (ret < 0) {
-            return ret;
+            goto out;
         }
     }
 
     if (stats) {
         memset(stats, 0, sizeof *stats);
     }
-    return netdev_offload_dpdk_add_flow(netdev, match, actions,
-                                        actions_len, ufid, info);
+    ret = netdev_offload_dpdk_add_flow(netdev, match, actions,
+                                       actions_len, ufid, info);
+out:
+    ovs_mutex_unlock(lock);
+    return ret;
 }
 
 static int
 netdev_offload_dpdk_flow_del(struct netdev *netdev, const ovs_u128 *ufid,
                              struct dpif_flow_stats *stats)
 {
+    struct ovs_mutex *lock = netdev_offload_dpdk_lock(netdev);
     struct ufid_to_rte_flow_data *rte_flow_data;
+    int ret;
+
+    ovs_mutex_lock(lock);
 
     rte_flow_data = ufid_to_rte_flow_data_find(ufid);
     if (!rte_flow_data || !rte_flow_data->rte_flow) {
-        return -1;
+        ret = -1;
+        goto out;
     }
 
     if (stats) {
         memset(stats, 0, sizeof *stats);
     }
-    return netdev_offload_dpdk_destroy_flow(netdev, ufid,
-                                            rte_flow_data->rte_flow);
+    ret = netdev_offload_dpdk_destroy_flow(netdev, ufid,
+                                           rte_flow_data->rte_flow);
+out:
+    ovs_mutex_unlock(lock);
+    return ret;
 }
 
 static int
@@ -1550,11 +1594,14 @@ netdev_offload_dpdk_flow_get(struct netdev *netdev,
                              struct dpif_flow_attrs *attrs,
                              struct ofpbuf *buf OVS_UNUSED)
 {
+    struct ovs_mutex *lock = netdev_offload_dpdk_lock(netdev);
     struct rte_flow_query_count query = { .reset = 1 };
     struct ufid_to_rte_flow_data *rte_flow_data;
     struct rte_flow_error error;
     int ret = 0;
 
+    ovs_mutex_lock(lock);
+
     rte_flow_data = ufid_to_rte_flow_data_find(ufid);
     if (!rte_flow_data || !rte_flow_data->rte_flow) {
         ret = -1;
@@ -1583,6 +1630,7 @@ netdev_offload_dpdk_flow_get(struct netdev *netdev,
     }
     memcpy(stats, &rte_flow_data->stats, sizeof *stats);
 out:
+    ovs_mutex_unlock(lock);
     attrs->dp_extra_info = NULL;
     return ret;
 }
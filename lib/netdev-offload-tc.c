@@ -345,20 +345,41 @@ get_block_id_from_netdev(struct netdev *netdev)
 static int
 netdev_tc_flow_flush(struct netdev *netdev)
 {
-    struct ufid_tc_data *data, *next;
-    int err;
+    struct ufid_tc_data **deletes;
+    struct ufid_tc_data *data;
+    struct tcf_id **ids;
+    int *errors;
+    int i, n = 0;
 
     ovs_mutex_lock(&ufid_lock);
-    HMAP_FOR_EACH_SAFE (data, next, tc_to_ufid_node, &tc_to_ufid) {
-        if (data->netdev != netdev) {
-            continue;
+    deletes = xmalloc(hmap_count(&tc_to_ufid) * sizeof *deletes);
+    HMAP_FOR_EACH (data, tc_to_ufid_node, &tc_to_ufid) {
+        if (data->netdev == netdev) {
+            deletes[n++] = data;
         }
+    }
 
-        err = tc_del_filter(&data->id);
-        if (!err) {
-            del_ufid_tc_mapping_unlocked(&data->ufid);
+    if (n) {
+        /* Deleting one rule per netlink round trip is painfully slow when a
+         * port with many offloaded rules goes away, so batch the deletions
+         * into a single pipelined transaction. */
+        ids = xmalloc(n * sizeof *ids);
+        errors = xmalloc(n * sizeof *errors);
+        for (i = 0; i < n; i++) {
+            ids[i] = &deletes[i]->id;
         }
+
+        tc_del_filters(ids, errors, n);
+
+        for (i = 0; i < n; i++) {
+            if (!errors[i]) {
+                del_ufid_tc_mapping_unlocked(&deletes[i]->ufid);
+            }
+        }
+        free(errors);
+        free(ids);
     }
+    free(deletes);
     ovs_mutex_unlock(&ufid_lock);
 
     return 0;
@@ -956,6 +977,13 @@ netdev_tc_flow_dump_next(struct netdev_flow_dump *dump,
             continue;
         }
 
+        if (id.prio <= TC_RESERVED_PRIORITY_MAX) {
+            /* Reserved priorities carry OVS's own infrastructure rules,
+             * which never map to datapath flows, so don't bother
+             * converting them. */
+            continue;
+        }
+
         if (parse_tc_flower_to_match(&flower, match, actions, stats, attrs,
                                      wbuffer, dump->terse)) {
             continue;
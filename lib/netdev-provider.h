@@ -327,11 +327,12 @@ struct netdev_class {
                         const struct netdev_tnl_build_header_params *params);
 
     /* build_header() can not build entire header for all packets for given
-     * flow.  Push header is called for packet to build header specific to
-     * a packet on actual transmit.  It uses partial header build by
-     * build_header() which is passed as data. */
+     * flow.  Push header is called on actual transmit to finish the header
+     * of every packet in 'batch', using the partial header built by
+     * build_header() which is passed as data.  Operating on the whole batch
+     * lets implementations hoist per-tunnel work out of the packet loop. */
     void (*push_header)(const struct netdev *,
-                        struct dp_packet *packet,
+                        struct dp_packet_batch *batch,
                         const struct ovs_action_push_tnl *data);
 
     /* Pop tunnel header from packet, build tunnel metadata and resize packet
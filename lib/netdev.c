@@ -33,6 +33,7 @@
 
 #include "cmap.h"
 #include "coverage.h"
+#include "csum.h"
 #include "dpif.h"
 #include "dp-packet.h"
 #include "openvswitch/dynamic-string.h"
@@ -796,7 +797,9 @@ netdev_send_prepare_packet(const uint64_t netdev_flags,
 
     if (dp_packet_hwol_is_tso(packet)
         && !(netdev_flags & NETDEV_TX_OFFLOAD_TCP_TSO)) {
-            /* Fall back to GSO in software. */
+            /* netdev_send() segments TCP/IPv4 packets in software before
+             * they get here; anything still carrying the flag could not be
+             * segmented. */
             VLOG_ERR_BUF(errormsg, "No TSO support");
             return false;
     }
@@ -855,6 +858,167 @@ netdev_send_prepare_batch(const struct netdev *netdev,
     }
 }
 
+static int
+netdev_send__(struct netdev *netdev, int qid, struct dp_packet_batch *batch,
+              bool concurrent_txq)
+{
+    int error;
+
+    netdev_send_prepare_batch(netdev, batch);
+    if (OVS_UNLIKELY(dp_packet_batch_is_empty(batch))) {
+        return 0;
+    }
+
+    error = netdev->netdev_class->send(netdev, qid, batch, concurrent_txq);
+    if (!error) {
+        COVERAGE_INC(netdev_sent);
+    }
+    return error;
+}
+
+/* Segments the TSO-flagged TCP/IPv4 packet 'packet' into packets of at most
+ * 'mtu' bytes of L3 length each, appending them to 'out' and flushing 'out'
+ * through the device whenever it fills up.  Each segment gets its IP total
+ * length, IP id, sequence number and both checksums fixed up in software,
+ * and carries no offload flags, so it passes netdev_send_prepare_batch()
+ * unmodified.  Returns false without touching 'out' if 'packet' is not
+ * something this function knows how to segment. */
+static bool
+netdev_gso_send(struct netdev *netdev, int qid, struct dp_packet *packet,
+                int mtu, bool concurrent_txq, struct dp_packet_batch *out,
+                int *errorp)
+{
+    struct ip_header *nh = dp_packet_l3(packet);
+    struct tcp_header *th = dp_packet_l4(packet);
+    const char *payload;
+    size_t payload_len;
+    size_t ip_hdr_len;
+    size_t tcp_hdr_len;
+    size_t hdr_len;
+    size_t l3_ofs;
+    size_t l4_ofs;
+    uint32_t seq;
+    uint16_t ip_id;
+    size_t mss;
+    size_t ofs;
+
+    if (!nh || !th
+        || !dp_packet_hwol_is_ipv4(packet)
+        || !dp_packet_hwol_l4_is_tcp(packet)) {
+        return false;
+    }
+
+    ip_hdr_len = IP_IHL(nh->ip_ihl_ver) * 4;
+    tcp_hdr_len = TCP_OFFSET(th->tcp_ctl) * 4;
+    if (ip_hdr_len < IP_HEADER_LEN || tcp_hdr_len < TCP_HEADER_LEN
+        || dp_packet_l4_size(packet) < tcp_hdr_len
+        || mtu <= ip_hdr_len + tcp_hdr_len) {
+        return false;
+    }
+
+    payload = (char *) th + tcp_hdr_len;
+    payload_len = dp_packet_l4_size(packet) - tcp_hdr_len;
+    hdr_len = payload - (char *) dp_packet_data(packet);
+    l3_ofs = (char *) nh - (char *) dp_packet_data(packet);
+    l4_ofs = (char *) th - (char *) dp_packet_data(packet);
+    mss = mtu - ip_hdr_len - tcp_hdr_len;
+    seq = ntohl(get_16aligned_be32(&th->tcp_seq));
+    ip_id = ntohs(nh->ip_id);
+
+    for (ofs = 0; ofs < payload_len; ofs += mss) {
+        size_t len = MIN(mss, payload_len - ofs);
+        bool last = ofs + len == payload_len;
+        struct tcp_header *seg_th;
+        struct ip_header *seg_nh;
+        struct dp_packet *seg;
+
+        seg = dp_packet_new_with_headroom(hdr_len + len, VLAN_HEADER_LEN);
+        dp_packet_put(seg, dp_packet_data(packet), hdr_len);
+        dp_packet_put(seg, payload + ofs, len);
+
+        seg_nh = ALIGNED_CAST(struct ip_header *,
+                              (char *) dp_packet_data(seg) + l3_ofs);
+        seg_th = ALIGNED_CAST(struct tcp_header *,
+                              (char *) dp_packet_data(seg) + l4_ofs);
+
+        seg_nh->ip_tot_len = htons(ip_hdr_len + tcp_hdr_len + len);
+        seg_nh->ip_id = htons(ip_id++);
+        seg_nh->ip_csum = 0;
+        seg_nh->ip_csum = csum(seg_nh, ip_hdr_len);
+
+        put_16aligned_be32(&seg_th->tcp_seq, htonl(seq));
+        seq += len;
+        if (!last) {
+            /* FIN and PSH belong on the final segment only. */
+            seg_th->tcp_ctl &= ~htons(TCP_FIN | TCP_PSH);
+        }
+        seg_th->tcp_csum = 0;
+        seg_th->tcp_csum
+            = csum_finish(csum_continue(packet_csum_pseudoheader(seg_nh),
+                                        seg_th, tcp_hdr_len + len));
+
+        if (dp_packet_batch_is_full(out)) {
+            int error = netdev_send__(netdev, qid, out, concurrent_txq);
+            if (error) {
+                *errorp = error;
+            }
+            dp_packet_batch_init(out);
+        }
+        dp_packet_batch_add(out, seg);
+    }
+
+    return true;
+}
+
+/* Slow path of netdev_send() for devices without TSO support: TSO-flagged
+ * packets are segmented in software at this egress boundary, so oversized
+ * packets cross the pipeline once instead of as per-MTU segments.  Packets
+ * that cannot be segmented keep the usual fate of TSO packets on a
+ * non-TSO device: a warning and a drop. */
+static int
+netdev_send_tso(struct netdev *netdev, int qid, struct dp_packet_batch *batch,
+                bool concurrent_txq)
+{
+    struct dp_packet_batch out;
+    struct dp_packet *packet;
+    int error = 0;
+    int mtu;
+
+    if (netdev_get_mtu(netdev, &mtu)) {
+        mtu = ETH_PAYLOAD_MAX;
+    }
+
+    dp_packet_batch_init(&out);
+    DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+        if (dp_packet_hwol_is_tso(packet)
+            && netdev_gso_send(netdev, qid, packet, mtu, concurrent_txq,
+                               &out, &error)) {
+            dp_packet_delete(packet);
+            continue;
+        }
+
+        if (dp_packet_batch_is_full(&out)) {
+            int err = netdev_send__(netdev, qid, &out, concurrent_txq);
+            if (err) {
+                error = err;
+            }
+            dp_packet_batch_init(&out);
+        }
+        dp_packet_batch_add(&out, packet);
+    }
+
+    if (!dp_packet_batch_is_empty(&out)) {
+        int err = netdev_send__(netdev, qid, &out, concurrent_txq);
+        if (err) {
+            error = err;
+        }
+    }
+
+    /* Ownership of every packet has been handed over or dropped. */
+    dp_packet_batch_init(batch);
+    return error;
+}
+
 /* Sends 'batch' on 'netdev'.  Returns 0 if successful (for every packet),
  * otherwise a positive errno value.  Returns EAGAIN without blocking if
  * at least one the packets cannot be queued immediately.  Returns EMSGSIZE
@@ -884,18 +1048,17 @@ int
 netdev_send(struct netdev *netdev, int qid, struct dp_packet_batch *batch,
             bool concurrent_txq)
 {
-    int error;
+    if (OVS_UNLIKELY(!(netdev->ol_flags & NETDEV_TX_OFFLOAD_TCP_TSO))) {
+        struct dp_packet *packet;
 
-    netdev_send_prepare_batch(netdev, batch);
-    if (OVS_UNLIKELY(dp_packet_batch_is_empty(batch))) {
-        return 0;
+        DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+            if (dp_packet_hwol_is_tso(packet)) {
+                return netdev_send_tso(netdev, qid, batch, concurrent_txq);
+            }
+        }
     }
 
-    error = netdev->netdev_class->send(netdev, qid, batch, concurrent_txq);
-    if (!error) {
-        COVERAGE_INC(netdev_sent);
-    }
-    return error;
+    return netdev_send__(netdev, qid, batch, concurrent_txq);
 }
 
 /* Pop tunnel header, build tunnel metadata and resize 'batch->packets'
@@ -968,12 +1131,17 @@ netdev_push_header(const struct netdev *netdev,
                          "not supported: packet dropped",
                          netdev_get_name(netdev));
         } else {
-            netdev->netdev_class->push_header(netdev, packet, data);
-            pkt_metadata_init(&packet->md, data->out_port);
             dp_packet_batch_refill(batch, packet, i);
         }
     }
 
+    if (!dp_packet_batch_is_empty(batch)) {
+        netdev->netdev_class->push_header(netdev, batch, data);
+        DP_PACKET_BATCH_FOR_EACH (j, packet, batch) {
+            pkt_metadata_init(&packet->md, data->out_port);
+        }
+    }
+
     return 0;
 }
 
@@ -24,6 +24,9 @@
 #include <netinet/ip6.h>
 #include <stdlib.h>
 #include <string.h>
+#if __AVX2__
+#include <immintrin.h>
+#endif
 
 #include "coverage.h"
 #include "dp-packet.h"
@@ -33,6 +36,7 @@
 #include "odp-util.h"
 #include "packets.h"
 #include "flow.h"
+#include "sticky-table.h"
 #include "unaligned.h"
 #include "util.h"
 #include "csum.h"
@@ -116,6 +120,42 @@ ether_addr_copy_masked(struct eth_addr *dst, const struct eth_addr src,
     }
 }
 
+#if __AVX2__
+/* Lane mask enabling the three 32-bit lanes that cover the 12 bytes of the
+ * Ethernet destination and source addresses.  Masked loads and stores leave
+ * the disabled fourth lane untouched, so nothing beyond the addresses is
+ * ever read or written. */
+#define ETH_ADDRS_LANES _mm_set_epi32(0, -1, -1, -1)
+
+/* Shuffle control converting a struct ovs_key_ethernet, which carries the
+ * source address first, into wire order, which has the destination first.
+ * The disabled top lane is zeroed. */
+#define ETH_ADDRS_WIRE_ORDER \
+    _mm_set_epi8(-1, -1, -1, -1, 5, 4, 3, 2, 1, 0, 11, 10, 9, 8, 7, 6)
+
+static inline __m128i
+odp_eth_addrs_to_wire(const struct ovs_key_ethernet *addrs)
+{
+    return _mm_shuffle_epi8(
+        _mm_maskload_epi32((const int *) (const void *) addrs,
+                           ETH_ADDRS_LANES),
+        ETH_ADDRS_WIRE_ORDER);
+}
+
+/* Rewrites the masked bytes of the addresses of 'eh' in one 16-byte blend.
+ * 'key' and 'mask' are struct ovs_key_ethernet contents converted to wire
+ * order with odp_eth_addrs_to_wire(); the key is already properly masked. */
+static inline void
+odp_eth_blend_addrs(struct eth_header *eh, __m128i key, __m128i mask)
+{
+    int *base = (int *) (void *) eh;
+    __m128i old = _mm_maskload_epi32(base, ETH_ADDRS_LANES);
+
+    _mm_maskstore_epi32(base, ETH_ADDRS_LANES,
+                        _mm_or_si128(key, _mm_andnot_si128(mask, old)));
+}
+#endif
+
 static void
 odp_eth_set_addrs(struct dp_packet *packet, const struct ovs_key_ethernet *key,
                   const struct ovs_key_ethernet *mask)
@@ -127,10 +167,42 @@ odp_eth_set_addrs(struct dp_packet *packet, const struct ovs_key_ethernet *key,
             eh->eth_src = key->eth_src;
             eh->eth_dst = key->eth_dst;
         } else {
+#if __AVX2__
+            odp_eth_blend_addrs(eh, odp_eth_addrs_to_wire(key),
+                                odp_eth_addrs_to_wire(mask));
+#else
             ether_addr_copy_masked(&eh->eth_src, key->eth_src, mask->eth_src);
             ether_addr_copy_masked(&eh->eth_dst, key->eth_dst, mask->eth_dst);
+#endif
+        }
+    }
+}
+
+/* Applies a masked Ethernet address rewrite to all packets of 'batch' at
+ * once, so that the key and mask setup is paid per burst rather than per
+ * packet. */
+static void
+odp_eth_set_addrs_batch(struct dp_packet_batch *batch,
+                        const struct ovs_key_ethernet *key,
+                        const struct ovs_key_ethernet *mask)
+{
+    struct dp_packet *packet;
+#if __AVX2__
+    __m128i key_wire = odp_eth_addrs_to_wire(key);
+    __m128i mask_wire = odp_eth_addrs_to_wire(mask);
+
+    DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+        struct eth_header *eh = dp_packet_eth(packet);
+
+        if (eh) {
+            odp_eth_blend_addrs(eh, key_wire, mask_wire);
         }
     }
+#else
+    DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+        odp_eth_set_addrs(packet, key, mask);
+    }
+#endif
 }
 
 static void
@@ -138,49 +210,71 @@ odp_set_ipv4(struct dp_packet *packet, const struct ovs_key_ipv4 *key,
              const struct ovs_key_ipv4 *mask)
 {
     struct ip_header *nh = dp_packet_l3(packet);
-    ovs_be32 ip_src_nh;
-    ovs_be32 ip_dst_nh;
-    ovs_be32 new_ip_src;
-    ovs_be32 new_ip_dst;
-    uint8_t new_tos;
-    uint8_t new_ttl;
-
-    if (mask->ipv4_src) {
-        ip_src_nh = get_16aligned_be32(&nh->ip_src);
-        new_ip_src = key->ipv4_src | (ip_src_nh & ~mask->ipv4_src);
-
-        if (ip_src_nh != new_ip_src) {
-            packet_set_ipv4_addr(packet, &nh->ip_src, new_ip_src);
-        }
+    ovs_be32 old_ip_src = get_16aligned_be32(&nh->ip_src);
+    ovs_be32 old_ip_dst = get_16aligned_be32(&nh->ip_dst);
+    ovs_be32 new_ip_src = key->ipv4_src | (old_ip_src & ~mask->ipv4_src);
+    ovs_be32 new_ip_dst = key->ipv4_dst | (old_ip_dst & ~mask->ipv4_dst);
+    uint8_t new_tos = key->ipv4_tos | (nh->ip_tos & ~mask->ipv4_tos);
+    uint8_t new_ttl = key->ipv4_ttl | (nh->ip_ttl & ~mask->ipv4_ttl);
+    bool addrs_changed = false;
+    bool csum_changed = false;
+    uint32_t l4_delta = 0;
+    uint32_t ip_delta;
+
+    /* Accumulate the checksum deltas of all rewritten fields and fold each
+     * of the IP and L4 checksums once, instead of doing a read-modify-write
+     * of the checksums for every field. */
+    if (new_ip_src != old_ip_src) {
+        l4_delta = csum_delta32(l4_delta, old_ip_src, new_ip_src);
+        put_16aligned_be32(&nh->ip_src, new_ip_src);
+        addrs_changed = true;
     }
 
-    if (mask->ipv4_dst) {
-        ip_dst_nh = get_16aligned_be32(&nh->ip_dst);
-        new_ip_dst = key->ipv4_dst | (ip_dst_nh & ~mask->ipv4_dst);
+    if (new_ip_dst != old_ip_dst) {
+        l4_delta = csum_delta32(l4_delta, old_ip_dst, new_ip_dst);
+        put_16aligned_be32(&nh->ip_dst, new_ip_dst);
+        addrs_changed = true;
+    }
 
-        if (ip_dst_nh != new_ip_dst) {
-            packet_set_ipv4_addr(packet, &nh->ip_dst, new_ip_dst);
-        }
+    ip_delta = l4_delta;
+    csum_changed = addrs_changed;
+
+    if (nh->ip_tos != new_tos) {
+        ip_delta = csum_delta16(ip_delta, htons((uint16_t) nh->ip_tos),
+                                htons((uint16_t) new_tos));
+        nh->ip_tos = new_tos;
+        csum_changed = true;
     }
 
-    if (mask->ipv4_tos) {
-        new_tos = key->ipv4_tos | (nh->ip_tos & ~mask->ipv4_tos);
+    if (OVS_LIKELY(nh->ip_ttl != new_ttl)) {
+        ip_delta = csum_delta16(ip_delta, htons(nh->ip_ttl << 8),
+                                htons(new_ttl << 8));
+        nh->ip_ttl = new_ttl;
+        csum_changed = true;
+    }
 
-        if (nh->ip_tos != new_tos) {
-            nh->ip_csum = recalc_csum16(nh->ip_csum,
-                                        htons((uint16_t) nh->ip_tos),
-                                        htons((uint16_t) new_tos));
-            nh->ip_tos = new_tos;
-        }
+    if (csum_changed) {
+        nh->ip_csum = recalc_csum_delta(nh->ip_csum, ip_delta);
     }
 
-    if (OVS_LIKELY(mask->ipv4_ttl)) {
-        new_ttl = key->ipv4_ttl | (nh->ip_ttl & ~mask->ipv4_ttl);
+    if (addrs_changed) {
+        size_t l4_size = dp_packet_l4_size(packet);
+
+        pkt_metadata_init_conn(&packet->md);
 
-        if (OVS_LIKELY(nh->ip_ttl != new_ttl)) {
-            nh->ip_csum = recalc_csum16(nh->ip_csum, htons(nh->ip_ttl << 8),
-                                        htons(new_ttl << 8));
-            nh->ip_ttl = new_ttl;
+        if (nh->ip_proto == IPPROTO_TCP && l4_size >= TCP_HEADER_LEN) {
+            struct tcp_header *th = dp_packet_l4(packet);
+
+            th->tcp_csum = recalc_csum_delta(th->tcp_csum, l4_delta);
+        } else if (nh->ip_proto == IPPROTO_UDP && l4_size >= UDP_HEADER_LEN) {
+            struct udp_header *uh = dp_packet_l4(packet);
+
+            if (uh->udp_csum) {
+                uh->udp_csum = recalc_csum_delta(uh->udp_csum, l4_delta);
+                if (!uh->udp_csum) {
+                    uh->udp_csum = htons(0xffff);
+                }
+            }
         }
     }
 }
@@ -721,7 +815,7 @@ odp_execute_sample(void *dp, struct dp_packet *packet, bool steal,
 
 static void
 odp_execute_clone(void *dp, struct dp_packet_batch *batch, bool steal,
-                   const struct nlattr *actions,
+                   bool may_share_payload, const struct nlattr *actions,
                    odp_execute_cb dp_execute_action)
 {
     if (!steal) {
@@ -729,9 +823,17 @@ odp_execute_clone(void *dp, struct dp_packet_batch *batch, bool steal,
          * should not propagate beyond this clone action. Make a copy
          * the packet in case we don't own the packet, so that the
          * 'actions' are only applied to the clone.  'odp_execute_actions'
-         * will free the clone.  */
+         * will free the clone.
+         *
+         * When neither the nested actions nor the actions still to come
+         * can modify packet payload, the copy borrows the originals'
+         * buffers instead (see odp_actions_preserve_payload()). */
         struct dp_packet_batch clone_pkt_batch;
-        dp_packet_batch_clone(&clone_pkt_batch, batch);
+        if (may_share_payload) {
+            dp_packet_batch_clone_shared(&clone_pkt_batch, batch);
+        } else {
+            dp_packet_batch_clone(&clone_pkt_batch, batch);
+        }
         dp_packet_batch_reset_cutlen(batch);
         odp_execute_actions(dp, &clone_pkt_batch, true, nl_attr_get(actions),
                         nl_attr_get_size(actions), dp_execute_action);
@@ -820,6 +922,8 @@ requires_datapath_assistance(const struct nlattr *a)
     case OVS_ACTION_ATTR_CT_CLEAR:
     case OVS_ACTION_ATTR_CHECK_PKT_LEN:
     case OVS_ACTION_ATTR_DROP:
+    case OVS_ACTION_ATTR_STICKY_LEARN:
+    case OVS_ACTION_ATTR_STICKY_LOOKUP:
         return false;
 
     case OVS_ACTION_ATTR_UNSPEC:
@@ -830,255 +934,649 @@ requires_datapath_assistance(const struct nlattr *a)
     return false;
 }
 
-/* Executes all of the 'actions_len' bytes of datapath actions in 'actions' on
- * the packets in 'batch'.  If 'steal' is true, possibly modifies and
- * definitely free the packets in 'batch', otherwise leaves 'batch' unchanged.
- *
- * Some actions (e.g. output actions) can only be executed by a datapath.  This
- * function implements those actions by passing the action and the packets to
- * 'dp_execute_action' (along with 'dp').  If 'dp_execute_action' is passed a
- * true 'steal' parameter then it must definitely free the packets passed into
- * it.  The packet can be modified whether 'steal' is false or true.  If a
- * packet is removed from the batch, then the fate of the packet is determined
- * by the code that does this removal, irrespective of the value of 'steal'.
- * Otherwise, if the packet is not removed from the batch and 'steal' is false
- * then the packet could either be cloned or not. */
-void
-odp_execute_actions(void *dp, struct dp_packet_batch *batch, bool steal,
-                    const struct nlattr *actions, size_t actions_len,
-                    odp_execute_cb dp_execute_action)
+/* Returns true if none of the 'actions_len' bytes of actions in 'actions'
+ * can modify packet payload or reallocate packet buffers: they only transmit,
+ * truncate, meter, hash or drop.  Used to decide whether a side copy made for
+ * a non-final output or clone (e.g. for a mirror) may borrow the original's
+ * buffer instead of copying it; the original continues through the remaining
+ * actions while the copy may still be queued for transmit. */
+static bool
+odp_actions_preserve_payload(const struct nlattr *actions, size_t actions_len)
 {
-    struct dp_packet *packet;
     const struct nlattr *a;
     unsigned int left;
 
     NL_ATTR_FOR_EACH_UNSAFE (a, left, actions, actions_len) {
-        int type = nl_attr_type(a);
-        bool last_action = (left <= NLA_ALIGN(a->nla_len));
-
-        if (requires_datapath_assistance(a)) {
-            if (dp_execute_action) {
-                /* Allow 'dp_execute_action' to steal the packet data if we do
-                 * not need it any more. */
-                bool should_steal = steal && last_action;
-
-                dp_execute_action(dp, batch, a, should_steal);
-
-                if (last_action || dp_packet_batch_is_empty(batch)) {
-                    /* We do not need to free the packets.
-                     * Either dp_execute_actions() has stolen them
-                     * or the batch is freed due to errors. In either
-                     * case we do not need to execute further actions.
-                     */
-                    return;
-                }
-            }
-            continue;
-        }
+        enum ovs_action_attr type = nl_attr_type(a);
 
-        switch ((enum ovs_action_attr) type) {
-
-        case OVS_ACTION_ATTR_HASH: {
-            const struct ovs_action_hash *hash_act = nl_attr_get(a);
-
-            /* Calculate a hash value directly. This might not match the
-             * value computed by the datapath, but it is much less expensive,
-             * and the current use case (bonding) does not require a strict
-             * match to work properly. */
-            switch (hash_act->hash_alg) {
-            case OVS_HASH_ALG_L4: {
-                struct flow flow;
-                uint32_t hash;
-
-                DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
-                    /* RSS hash can be used here instead of 5tuple for
-                     * performance reasons. */
-                    if (dp_packet_rss_valid(packet)) {
-                        hash = dp_packet_get_rss_hash(packet);
-                        hash = hash_int(hash, hash_act->hash_basis);
-                    } else {
-                        flow_extract(packet, &flow);
-                        hash = flow_hash_5tuple(&flow, hash_act->hash_basis);
-                    }
-                    packet->md.dp_hash = hash;
-                }
-                break;
-            }
-            case OVS_HASH_ALG_SYM_L4: {
-                struct flow flow;
-                uint32_t hash;
-
-                DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
-                    flow_extract(packet, &flow);
-                    hash = flow_hash_symmetric_l3l4(&flow,
-                                                    hash_act->hash_basis,
-                                                    false);
-                    packet->md.dp_hash = hash;
-                }
-                break;
-            }
-            default:
-                /* Assert on unknown hash algorithm.  */
-                OVS_NOT_REACHED();
+        switch (type) {
+        case OVS_ACTION_ATTR_OUTPUT:
+        case OVS_ACTION_ATTR_LB_OUTPUT:
+        case OVS_ACTION_ATTR_TRUNC:
+        case OVS_ACTION_ATTR_HASH:
+        case OVS_ACTION_ATTR_METER:
+        case OVS_ACTION_ATTR_DROP:
+        case OVS_ACTION_ATTR_STICKY_LEARN:
+        case OVS_ACTION_ATTR_STICKY_LOOKUP:
+            break;
+
+        case OVS_ACTION_ATTR_CLONE:
+            if (!odp_actions_preserve_payload(nl_attr_get(a),
+                                              nl_attr_get_size(a))) {
+                return false;
             }
             break;
+
+        case OVS_ACTION_ATTR_TUNNEL_PUSH:
+        case OVS_ACTION_ATTR_TUNNEL_POP:
+        case OVS_ACTION_ATTR_USERSPACE:
+        case OVS_ACTION_ATTR_RECIRC:
+        case OVS_ACTION_ATTR_CT:
+        case OVS_ACTION_ATTR_SET:
+        case OVS_ACTION_ATTR_SET_MASKED:
+        case OVS_ACTION_ATTR_PUSH_VLAN:
+        case OVS_ACTION_ATTR_POP_VLAN:
+        case OVS_ACTION_ATTR_SAMPLE:
+        case OVS_ACTION_ATTR_PUSH_MPLS:
+        case OVS_ACTION_ATTR_POP_MPLS:
+        case OVS_ACTION_ATTR_PUSH_ETH:
+        case OVS_ACTION_ATTR_POP_ETH:
+        case OVS_ACTION_ATTR_PUSH_NSH:
+        case OVS_ACTION_ATTR_POP_NSH:
+        case OVS_ACTION_ATTR_CT_CLEAR:
+        case OVS_ACTION_ATTR_CHECK_PKT_LEN:
+        case OVS_ACTION_ATTR_UNSPEC:
+        case __OVS_ACTION_ATTR_MAX:
+        default:
+            return false;
         }
+    }
 
-        case OVS_ACTION_ATTR_PUSH_VLAN: {
-            const struct ovs_action_push_vlan *vlan = nl_attr_get(a);
+    return true;
+}
 
-            DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
-                eth_push_vlan(packet, vlan->vlan_tpid, vlan->vlan_tci);
-            }
-            break;
+/* A single step of a compiled datapath action list.
+ *
+ * 'action' and 'arg' point into the action buffer that the step was compiled
+ * from, so that buffer must outlive the step.  An 'execute' function returns
+ * true if it consumed the batch (stole, freed or emptied it), in which case
+ * no further steps may be executed. */
+struct odp_execute_step {
+    bool (*execute)(void *dp, struct dp_packet_batch *batch, bool steal,
+                    const struct odp_execute_step *step,
+                    odp_execute_cb dp_execute_action);
+    const struct nlattr *action; /* The OVS_ACTION_ATTR_* attribute. */
+    const void *arg;             /* nl_attr_get(action). */
+    bool last;                   /* Is this the final step of its list? */
+    bool may_share_payload;      /* For a non-final output or clone step: the
+                                  * side copy it makes may borrow the
+                                  * originals' payload, because the remaining
+                                  * actions preserve it. */
+};
+
+typedef bool odp_execute_step_func(void *dp, struct dp_packet_batch *batch,
+                                   bool steal,
+                                   const struct odp_execute_step *step,
+                                   odp_execute_cb dp_execute_action);
+
+static bool
+odp_execute_step_assist(void *dp, struct dp_packet_batch *batch, bool steal,
+                        const struct odp_execute_step *step,
+                        odp_execute_cb dp_execute_action)
+{
+    if (dp_execute_action) {
+        /* Allow 'dp_execute_action' to steal the packet data if we do
+         * not need it any more. */
+        bool should_steal = steal && step->last;
+
+        batch->may_share_payload = step->may_share_payload;
+        dp_execute_action(dp, batch, step->action, should_steal);
+        batch->may_share_payload = false;
+
+        if (step->last || dp_packet_batch_is_empty(batch)) {
+            /* We do not need to free the packets.
+             * Either 'dp_execute_action' has stolen them
+             * or the batch is freed due to errors. In either
+             * case we do not need to execute further actions.
+             */
+            return true;
         }
+    }
+    return false;
+}
 
-        case OVS_ACTION_ATTR_POP_VLAN:
-            DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
-                eth_pop_vlan(packet);
+static bool
+odp_execute_step_hash(void *dp OVS_UNUSED, struct dp_packet_batch *batch,
+                      bool steal OVS_UNUSED,
+                      const struct odp_execute_step *step,
+                      odp_execute_cb dp_execute_action OVS_UNUSED)
+{
+    const struct ovs_action_hash *hash_act = step->arg;
+    struct dp_packet *packet;
+
+    /* Calculate a hash value directly. This might not match the
+     * value computed by the datapath, but it is much less expensive,
+     * and the current use case (bonding) does not require a strict
+     * match to work properly. */
+    switch (hash_act->hash_alg) {
+    case OVS_HASH_ALG_L4: {
+        struct flow flow;
+        uint32_t hash;
+
+        DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+            /* RSS hash can be used here instead of 5tuple for
+             * performance reasons. */
+            if (dp_packet_rss_valid(packet)) {
+                hash = dp_packet_get_rss_hash(packet);
+                hash = hash_int(hash, hash_act->hash_basis);
+            } else {
+                flow_extract(packet, &flow);
+                hash = flow_hash_5tuple(&flow, hash_act->hash_basis);
             }
-            break;
+            packet->md.dp_hash = hash;
+        }
+        break;
+    }
+    case OVS_HASH_ALG_SYM_L4: {
+        struct flow flow;
+        uint32_t hash;
+
+        DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+            flow_extract(packet, &flow);
+            hash = flow_hash_symmetric_l3l4(&flow,
+                                            hash_act->hash_basis,
+                                            false);
+            packet->md.dp_hash = hash;
+        }
+        break;
+    }
+    default:
+        /* Assert on unknown hash algorithm.  */
+        OVS_NOT_REACHED();
+    }
+    return false;
+}
 
-        case OVS_ACTION_ATTR_PUSH_MPLS: {
-            const struct ovs_action_push_mpls *mpls = nl_attr_get(a);
+static bool
+odp_execute_step_push_vlan(void *dp OVS_UNUSED, struct dp_packet_batch *batch,
+                           bool steal OVS_UNUSED,
+                           const struct odp_execute_step *step,
+                           odp_execute_cb dp_execute_action OVS_UNUSED)
+{
+    const struct ovs_action_push_vlan *vlan = step->arg;
+    struct dp_packet *packet;
 
-            DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
-                push_mpls(packet, mpls->mpls_ethertype, mpls->mpls_lse);
-            }
-            break;
-         }
+    DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+        eth_push_vlan(packet, vlan->vlan_tpid, vlan->vlan_tci);
+    }
+    return false;
+}
 
-        case OVS_ACTION_ATTR_POP_MPLS:
-            DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
-                pop_mpls(packet, nl_attr_get_be16(a));
-            }
-            break;
+static bool
+odp_execute_step_pop_vlan(void *dp OVS_UNUSED, struct dp_packet_batch *batch,
+                          bool steal OVS_UNUSED,
+                          const struct odp_execute_step *step OVS_UNUSED,
+                          odp_execute_cb dp_execute_action OVS_UNUSED)
+{
+    struct dp_packet *packet;
 
-        case OVS_ACTION_ATTR_SET:
-            DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
-                odp_execute_set_action(packet, nl_attr_get(a));
-            }
-            break;
+    DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+        eth_pop_vlan(packet);
+    }
+    return false;
+}
 
-        case OVS_ACTION_ATTR_SET_MASKED:
-            DP_PACKET_BATCH_FOR_EACH(i, packet, batch) {
-                odp_execute_masked_set_action(packet, nl_attr_get(a));
-            }
-            break;
+static bool
+odp_execute_step_push_mpls(void *dp OVS_UNUSED, struct dp_packet_batch *batch,
+                           bool steal OVS_UNUSED,
+                           const struct odp_execute_step *step,
+                           odp_execute_cb dp_execute_action OVS_UNUSED)
+{
+    const struct ovs_action_push_mpls *mpls = step->arg;
+    struct dp_packet *packet;
 
-        case OVS_ACTION_ATTR_SAMPLE:
-            DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
-                odp_execute_sample(dp, packet, steal && last_action, a,
-                                   dp_execute_action);
-            }
+    DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+        push_mpls(packet, mpls->mpls_ethertype, mpls->mpls_lse);
+    }
+    return false;
+}
 
-            if (last_action) {
-                /* We do not need to free the packets. odp_execute_sample() has
-                 * stolen them*/
-                return;
-            }
-            break;
+static bool
+odp_execute_step_pop_mpls(void *dp OVS_UNUSED, struct dp_packet_batch *batch,
+                          bool steal OVS_UNUSED,
+                          const struct odp_execute_step *step,
+                          odp_execute_cb dp_execute_action OVS_UNUSED)
+{
+    ovs_be16 ethertype = nl_attr_get_be16(step->action);
+    struct dp_packet *packet;
 
-        case OVS_ACTION_ATTR_TRUNC: {
-            const struct ovs_action_trunc *trunc =
-                        nl_attr_get_unspec(a, sizeof *trunc);
+    DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+        pop_mpls(packet, ethertype);
+    }
+    return false;
+}
 
-            batch->trunc = true;
-            DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
-                dp_packet_set_cutlen(packet, trunc->max_len);
-            }
-            break;
-        }
+static bool
+odp_execute_step_set(void *dp OVS_UNUSED, struct dp_packet_batch *batch,
+                     bool steal OVS_UNUSED,
+                     const struct odp_execute_step *step,
+                     odp_execute_cb dp_execute_action OVS_UNUSED)
+{
+    struct dp_packet *packet;
 
-        case OVS_ACTION_ATTR_CLONE:
-            odp_execute_clone(dp, batch, steal && last_action, a,
-                                                dp_execute_action);
-            if (last_action) {
-                /* We do not need to free the packets. odp_execute_clone() has
-                 * stolen them.  */
-                return;
-            }
-            break;
-        case OVS_ACTION_ATTR_METER:
-            /* Not implemented yet. */
-            break;
-        case OVS_ACTION_ATTR_PUSH_ETH: {
-            const struct ovs_action_push_eth *eth = nl_attr_get(a);
+    DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+        odp_execute_set_action(packet, step->arg);
+    }
+    return false;
+}
 
-            DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
-                push_eth(packet, &eth->addresses.eth_dst,
-                         &eth->addresses.eth_src);
-            }
-            break;
+static bool
+odp_execute_step_set_masked(void *dp OVS_UNUSED, struct dp_packet_batch *batch,
+                            bool steal OVS_UNUSED,
+                            const struct odp_execute_step *step,
+                            odp_execute_cb dp_execute_action OVS_UNUSED)
+{
+    const struct nlattr *a = step->arg;
+    struct dp_packet *packet;
+
+    if (nl_attr_type(a) == OVS_KEY_ATTR_ETHERNET) {
+        /* MAC rewrites happen on nearly every forwarded packet, so they
+         * are worth a dedicated whole-batch path. */
+        odp_eth_set_addrs_batch(batch, nl_attr_get(a),
+                                get_mask(a, struct ovs_key_ethernet));
+        return false;
+    }
+
+    DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+        odp_execute_masked_set_action(packet, a);
+    }
+    return false;
+}
+
+static bool
+odp_execute_step_sample(void *dp, struct dp_packet_batch *batch, bool steal,
+                        const struct odp_execute_step *step,
+                        odp_execute_cb dp_execute_action)
+{
+    struct dp_packet *packet;
+
+    DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+        odp_execute_sample(dp, packet, steal && step->last, step->action,
+                           dp_execute_action);
+    }
+
+    /* When this is the last action we do not need to free the packets:
+     * odp_execute_sample() has stolen them. */
+    return step->last;
+}
+
+static bool
+odp_execute_step_trunc(void *dp OVS_UNUSED, struct dp_packet_batch *batch,
+                       bool steal OVS_UNUSED,
+                       const struct odp_execute_step *step,
+                       odp_execute_cb dp_execute_action OVS_UNUSED)
+{
+    const struct ovs_action_trunc *trunc =
+                nl_attr_get_unspec(step->action, sizeof *trunc);
+    struct dp_packet *packet;
+
+    batch->trunc = true;
+    DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+        dp_packet_set_cutlen(packet, trunc->max_len);
+    }
+    return false;
+}
+
+static bool
+odp_execute_step_clone(void *dp, struct dp_packet_batch *batch, bool steal,
+                       const struct odp_execute_step *step,
+                       odp_execute_cb dp_execute_action)
+{
+    odp_execute_clone(dp, batch, steal && step->last,
+                      step->may_share_payload, step->action,
+                      dp_execute_action);
+
+    /* When this is the last action we do not need to free the packets:
+     * odp_execute_clone() has stolen them. */
+    return step->last;
+}
+
+static bool
+odp_execute_step_push_eth(void *dp OVS_UNUSED, struct dp_packet_batch *batch,
+                          bool steal OVS_UNUSED,
+                          const struct odp_execute_step *step,
+                          odp_execute_cb dp_execute_action OVS_UNUSED)
+{
+    const struct ovs_action_push_eth *eth = step->arg;
+    struct dp_packet *packet;
+
+    DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+        push_eth(packet, &eth->addresses.eth_dst,
+                 &eth->addresses.eth_src);
+    }
+    return false;
+}
+
+static bool
+odp_execute_step_pop_eth(void *dp OVS_UNUSED, struct dp_packet_batch *batch,
+                         bool steal OVS_UNUSED,
+                         const struct odp_execute_step *step OVS_UNUSED,
+                         odp_execute_cb dp_execute_action OVS_UNUSED)
+{
+    struct dp_packet *packet;
+
+    DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+        pop_eth(packet);
+    }
+    return false;
+}
+
+static bool
+odp_execute_step_push_nsh(void *dp OVS_UNUSED, struct dp_packet_batch *batch,
+                          bool steal OVS_UNUSED,
+                          const struct odp_execute_step *step,
+                          odp_execute_cb dp_execute_action OVS_UNUSED)
+{
+    uint32_t buffer[NSH_HDR_MAX_LEN / 4];
+    struct nsh_hdr *nsh_hdr = ALIGNED_CAST(struct nsh_hdr *, buffer);
+    struct dp_packet *packet;
+
+    nsh_reset_ver_flags_ttl_len(nsh_hdr);
+    odp_nsh_hdr_from_attr(step->arg, nsh_hdr, NSH_HDR_MAX_LEN);
+    DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+        push_nsh(packet, nsh_hdr);
+    }
+    return false;
+}
+
+static bool
+odp_execute_step_pop_nsh(void *dp OVS_UNUSED, struct dp_packet_batch *batch,
+                         bool steal OVS_UNUSED,
+                         const struct odp_execute_step *step OVS_UNUSED,
+                         odp_execute_cb dp_execute_action OVS_UNUSED)
+{
+    const size_t num = dp_packet_batch_size(batch);
+    struct dp_packet *packet;
+    size_t i;
+
+    DP_PACKET_BATCH_REFILL_FOR_EACH (i, num, packet, batch) {
+        if (pop_nsh(packet)) {
+            dp_packet_batch_refill(batch, packet, i);
+        } else {
+            COVERAGE_INC(datapath_drop_nsh_decap_error);
+            dp_packet_delete(packet);
         }
+    }
+    return false;
+}
 
-        case OVS_ACTION_ATTR_POP_ETH:
-            DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
-                pop_eth(packet);
-            }
-            break;
+static bool
+odp_execute_step_ct_clear(void *dp OVS_UNUSED, struct dp_packet_batch *batch,
+                          bool steal OVS_UNUSED,
+                          const struct odp_execute_step *step OVS_UNUSED,
+                          odp_execute_cb dp_execute_action OVS_UNUSED)
+{
+    struct dp_packet *packet;
 
-        case OVS_ACTION_ATTR_PUSH_NSH: {
-            uint32_t buffer[NSH_HDR_MAX_LEN / 4];
-            struct nsh_hdr *nsh_hdr = ALIGNED_CAST(struct nsh_hdr *, buffer);
-            nsh_reset_ver_flags_ttl_len(nsh_hdr);
-            odp_nsh_hdr_from_attr(nl_attr_get(a), nsh_hdr, NSH_HDR_MAX_LEN);
-            DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
-                push_nsh(packet, nsh_hdr);
-            }
-            break;
+    DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+        conntrack_clear(packet);
+    }
+    return false;
+}
+
+static bool
+odp_execute_step_check_pkt_len(void *dp, struct dp_packet_batch *batch,
+                               bool steal,
+                               const struct odp_execute_step *step,
+                               odp_execute_cb dp_execute_action)
+{
+    struct dp_packet *packet;
+
+    DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+        odp_execute_check_pkt_len(dp, packet, steal && step->last,
+                                  step->action, dp_execute_action);
+    }
+
+    /* When this is the last action we do not need to free the packets:
+     * odp_execute_check_pkt_len() has stolen them. */
+    return step->last;
+}
+
+/* Derives the sticky-table key for 'packet': its IPv4 or IPv6 source
+ * address, with IPv4 in the v4-mapped form so the two families cannot
+ * alias.  Returns false for non-IP packets, which sticky actions skip. */
+static bool
+sticky_key_from_packet(struct dp_packet *packet, ovs_u128 *key)
+{
+    const struct ip_header *l3 = dp_packet_l3(packet);
+    size_t len;
+
+    if (OVS_UNLIKELY(!l3)) {
+        return false;
+    }
+
+    len = (char *) dp_packet_tail(packet) - (char *) l3;
+    if (IP_VER(l3->ip_ihl_ver) == 4 && len >= IP_HEADER_LEN) {
+        memset(key, 0, sizeof *key);
+        key->u32[2] = (OVS_FORCE uint32_t) htonl(0xffff);
+        key->u32[3] = (OVS_FORCE uint32_t) get_16aligned_be32(&l3->ip_src);
+        return true;
+    } else if (IP_VER(l3->ip_ihl_ver) == 6 && len >= IPV6_HEADER_LEN) {
+        const struct ovs_16aligned_ip6_hdr *ip6 = (const void *) l3;
+
+        memcpy(key, &ip6->ip6_src, sizeof ip6->ip6_src);
+        return true;
+    }
+    return false;
+}
+
+static bool
+odp_execute_step_sticky_learn(void *dp OVS_UNUSED,
+                              struct dp_packet_batch *batch,
+                              bool steal OVS_UNUSED,
+                              const struct odp_execute_step *step,
+                              odp_execute_cb dp_execute_action OVS_UNUSED)
+{
+    const struct ovs_action_sticky *sticky = step->arg;
+    struct dp_packet *packet;
+
+    DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+        ovs_u128 key;
+
+        if (sticky_key_from_packet(packet, &key)) {
+            sticky_table_learn(sticky->table_id, &key, packet->md.pkt_mark,
+                               sticky->ttl_ms);
         }
-        case OVS_ACTION_ATTR_POP_NSH: {
-            size_t i;
-            const size_t num = dp_packet_batch_size(batch);
-
-            DP_PACKET_BATCH_REFILL_FOR_EACH (i, num, packet, batch) {
-                if (pop_nsh(packet)) {
-                    dp_packet_batch_refill(batch, packet, i);
-                } else {
-                    COVERAGE_INC(datapath_drop_nsh_decap_error);
-                    dp_packet_delete(packet);
-                }
-            }
-            break;
+    }
+    return false;
+}
+
+static bool
+odp_execute_step_sticky_lookup(void *dp OVS_UNUSED,
+                               struct dp_packet_batch *batch,
+                               bool steal OVS_UNUSED,
+                               const struct odp_execute_step *step,
+                               odp_execute_cb dp_execute_action OVS_UNUSED)
+{
+    const struct ovs_action_sticky *sticky = step->arg;
+    struct dp_packet *packet;
+
+    DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
+        ovs_u128 key;
+        uint32_t value;
+
+        if (sticky_key_from_packet(packet, &key)
+            && sticky_table_lookup(sticky->table_id, &key, sticky->ttl_ms,
+                                   &value)) {
+            packet->md.pkt_mark = value;
         }
-        case OVS_ACTION_ATTR_CT_CLEAR:
-            DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
-                conntrack_clear(packet);
-            }
-            break;
+    }
+    return false;
+}
 
-        case OVS_ACTION_ATTR_CHECK_PKT_LEN:
-            DP_PACKET_BATCH_FOR_EACH (i, packet, batch) {
-                odp_execute_check_pkt_len(dp, packet, steal && last_action, a,
-                                          dp_execute_action);
-            }
+static bool
+odp_execute_step_drop(void *dp OVS_UNUSED, struct dp_packet_batch *batch,
+                      bool steal, const struct odp_execute_step *step,
+                      odp_execute_cb dp_execute_action OVS_UNUSED)
+{
+    const enum xlate_error *drop_reason = step->arg;
 
-            if (last_action) {
-                /* We do not need to free the packets.
-                 * odp_execute_check_pkt_len() has stolen them. */
-                return;
-            }
-            break;
+    dp_update_drop_action_counter(*drop_reason,
+                                  dp_packet_batch_size(batch));
+    dp_packet_delete_batch(batch, steal);
+    return true;
+}
+
+/* Steps for the actions that can be executed without datapath assistance,
+ * indexed by action type.  Actions for which requires_datapath_assistance()
+ * returns true are dispatched to odp_execute_step_assist() instead. */
+static odp_execute_step_func *const odp_execute_step_funcs[] = {
+    [OVS_ACTION_ATTR_HASH] = odp_execute_step_hash,
+    [OVS_ACTION_ATTR_PUSH_VLAN] = odp_execute_step_push_vlan,
+    [OVS_ACTION_ATTR_POP_VLAN] = odp_execute_step_pop_vlan,
+    [OVS_ACTION_ATTR_PUSH_MPLS] = odp_execute_step_push_mpls,
+    [OVS_ACTION_ATTR_POP_MPLS] = odp_execute_step_pop_mpls,
+    [OVS_ACTION_ATTR_SET] = odp_execute_step_set,
+    [OVS_ACTION_ATTR_SET_MASKED] = odp_execute_step_set_masked,
+    [OVS_ACTION_ATTR_SAMPLE] = odp_execute_step_sample,
+    [OVS_ACTION_ATTR_TRUNC] = odp_execute_step_trunc,
+    [OVS_ACTION_ATTR_CLONE] = odp_execute_step_clone,
+    [OVS_ACTION_ATTR_PUSH_ETH] = odp_execute_step_push_eth,
+    [OVS_ACTION_ATTR_POP_ETH] = odp_execute_step_pop_eth,
+    [OVS_ACTION_ATTR_PUSH_NSH] = odp_execute_step_push_nsh,
+    [OVS_ACTION_ATTR_POP_NSH] = odp_execute_step_pop_nsh,
+    [OVS_ACTION_ATTR_CT_CLEAR] = odp_execute_step_ct_clear,
+    [OVS_ACTION_ATTR_CHECK_PKT_LEN] = odp_execute_step_check_pkt_len,
+    [OVS_ACTION_ATTR_DROP] = odp_execute_step_drop,
+    [OVS_ACTION_ATTR_STICKY_LEARN] = odp_execute_step_sticky_learn,
+    [OVS_ACTION_ATTR_STICKY_LOOKUP] = odp_execute_step_sticky_lookup,
+};
+
+/* Initializes 'step' to execute action 'a', the first of the 'left' bytes of
+ * actions remaining in its list. */
+static void
+odp_execute_step_init(struct odp_execute_step *step, const struct nlattr *a,
+                      unsigned int left)
+{
+    enum ovs_action_attr type = nl_attr_type(a);
 
-        case OVS_ACTION_ATTR_DROP:{
-            const enum xlate_error *drop_reason = nl_attr_get(a);
+    if (requires_datapath_assistance(a)) {
+        step->execute = odp_execute_step_assist;
+    } else {
+        ovs_assert(type < ARRAY_SIZE(odp_execute_step_funcs)
+                   && odp_execute_step_funcs[type]);
+        step->execute = odp_execute_step_funcs[type];
+    }
+    step->action = a;
+    step->arg = nl_attr_get(a);
+    step->last = left <= NLA_ALIGN(a->nla_len);
+
+    /* A non-final output or clone makes a copy of the batch.  That copy may
+     * borrow the originals' buffers if the actions that the originals still
+     * go through (and, for a clone, the nested actions applied to the copy)
+     * leave packet payload untouched. */
+    step->may_share_payload = false;
+    if (!step->last
+        && (type == OVS_ACTION_ATTR_OUTPUT
+            || type == OVS_ACTION_ATTR_LB_OUTPUT
+            || type == OVS_ACTION_ATTR_CLONE)) {
+        step->may_share_payload =
+            odp_actions_preserve_payload(nl_attr_next(a),
+                                         left - NLA_ALIGN(a->nla_len))
+            && (type != OVS_ACTION_ATTR_CLONE
+                || odp_actions_preserve_payload(nl_attr_get(a),
+                                                nl_attr_get_size(a)));
+    }
+}
 
-            dp_update_drop_action_counter(*drop_reason,
-                                          dp_packet_batch_size(batch));
-            dp_packet_delete_batch(batch, steal);
+/* Executes all of the 'actions_len' bytes of datapath actions in 'actions' on
+ * the packets in 'batch'.  If 'steal' is true, possibly modifies and
+ * definitely free the packets in 'batch', otherwise leaves 'batch' unchanged.
+ *
+ * Some actions (e.g. output actions) can only be executed by a datapath.  This
+ * function implements those actions by passing the action and the packets to
+ * 'dp_execute_action' (along with 'dp').  If 'dp_execute_action' is passed a
+ * true 'steal' parameter then it must definitely free the packets passed into
+ * it.  The packet can be modified whether 'steal' is false or true.  If a
+ * packet is removed from the batch, then the fate of the packet is determined
+ * by the code that does this removal, irrespective of the value of 'steal'.
+ * Otherwise, if the packet is not removed from the batch and 'steal' is false
+ * then the packet could either be cloned or not. */
+void
+odp_execute_actions(void *dp, struct dp_packet_batch *batch, bool steal,
+                    const struct nlattr *actions, size_t actions_len,
+                    odp_execute_cb dp_execute_action)
+{
+    const struct nlattr *a;
+    unsigned int left;
+
+    NL_ATTR_FOR_EACH_UNSAFE (a, left, actions, actions_len) {
+        struct odp_execute_step step;
+
+        odp_execute_step_init(&step, a, left);
+        if (step.execute(dp, batch, steal, &step, dp_execute_action)) {
             return;
         }
-        case OVS_ACTION_ATTR_OUTPUT:
-        case OVS_ACTION_ATTR_LB_OUTPUT:
-        case OVS_ACTION_ATTR_TUNNEL_PUSH:
-        case OVS_ACTION_ATTR_TUNNEL_POP:
-        case OVS_ACTION_ATTR_USERSPACE:
-        case OVS_ACTION_ATTR_RECIRC:
-        case OVS_ACTION_ATTR_CT:
-        case OVS_ACTION_ATTR_UNSPEC:
-        case __OVS_ACTION_ATTR_MAX:
-            OVS_NOT_REACHED();
+    }
+
+    dp_packet_delete_batch(batch, steal);
+}
+
+/* A compiled datapath action list: the steps are fully initialized at
+ * compile time so that odp_execute_prog_run() does not re-parse the netlink
+ * attributes for every batch.  The steps point into the action buffer the
+ * program was compiled from, so that buffer must outlive the program. */
+struct odp_execute_prog {
+    size_t n_steps;
+    struct odp_execute_step steps[];
+};
+
+/* Compiles the 'actions_len' bytes of datapath actions in 'actions' into a
+ * program for odp_execute_prog_run().  The caller must not modify or free
+ * 'actions' before destroying the returned program with
+ * odp_execute_prog_destroy(). */
+struct odp_execute_prog *
+odp_execute_compile(const struct nlattr *actions, size_t actions_len)
+{
+    struct odp_execute_prog *prog;
+    const struct nlattr *a;
+    unsigned int left;
+    size_t n_steps = 0;
+
+    NL_ATTR_FOR_EACH_UNSAFE (a, left, actions, actions_len) {
+        n_steps++;
+    }
+
+    prog = xmalloc(sizeof *prog + n_steps * sizeof prog->steps[0]);
+    prog->n_steps = n_steps;
+
+    n_steps = 0;
+    NL_ATTR_FOR_EACH_UNSAFE (a, left, actions, actions_len) {
+        odp_execute_step_init(&prog->steps[n_steps++], a, left);
+    }
+
+    return prog;
+}
+
+void
+odp_execute_prog_destroy(struct odp_execute_prog *prog)
+{
+    free(prog);
+}
+
+/* Executes compiled datapath actions 'prog' on the packets in 'batch', with
+ * the same semantics as executing the actions the program was compiled from
+ * with odp_execute_actions(). */
+void
+odp_execute_prog_run(void *dp, struct dp_packet_batch *batch, bool steal,
+                     const struct odp_execute_prog *prog,
+                     odp_execute_cb dp_execute_action)
+{
+    for (size_t i = 0; i < prog->n_steps; i++) {
+        const struct odp_execute_step *step = &prog->steps[i];
+
+        if (step->execute(dp, batch, steal, step, dp_execute_action)) {
+            return;
         }
     }
 
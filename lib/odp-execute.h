@@ -39,4 +39,18 @@ void odp_execute_actions(void *dp, struct dp_packet_batch *batch,
                          bool steal,
                          const struct nlattr *actions, size_t actions_len,
                          odp_execute_cb dp_execute_action);
+
+/* A datapath action list compiled, once, into a flat sequence of steps that
+ * odp_execute_prog_run() can execute without re-parsing the netlink
+ * attributes for every batch.  The program keeps pointers into 'actions', so
+ * the action buffer passed to odp_execute_compile() must not be modified or
+ * freed before the program is destroyed. */
+struct odp_execute_prog;
+
+struct odp_execute_prog *odp_execute_compile(const struct nlattr *actions,
+                                             size_t actions_len);
+void odp_execute_prog_destroy(struct odp_execute_prog *);
+void odp_execute_prog_run(void *dp, struct dp_packet_batch *batch, bool steal,
+                          const struct odp_execute_prog *,
+                          odp_execute_cb dp_execute_action);
 #endif
@@ -143,6 +143,8 @@ odp_action_len(uint16_t type)
     case OVS_ACTION_ATTR_POP_NSH: return 0;
     case OVS_ACTION_ATTR_CHECK_PKT_LEN: return ATTR_LEN_VARIABLE;
     case OVS_ACTION_ATTR_DROP: return sizeof(uint32_t);
+    case OVS_ACTION_ATTR_STICKY_LEARN: return sizeof(struct ovs_action_sticky);
+    case OVS_ACTION_ATTR_STICKY_LOOKUP: return sizeof(struct ovs_action_sticky);
 
     case OVS_ACTION_ATTR_UNSPEC:
     case __OVS_ACTION_ATTR_MAX:
@@ -1256,6 +1258,16 @@ format_odp_action(struct ds *ds, const struct nlattr *a,
     case OVS_ACTION_ATTR_DROP:
         ds_put_cstr(ds, "drop");
         break;
+    case OVS_ACTION_ATTR_STICKY_LEARN:
+    case OVS_ACTION_ATTR_STICKY_LOOKUP: {
+        const struct ovs_action_sticky *sticky = nl_attr_get(a);
+
+        ds_put_format(ds, "%s(table=%"PRIu32",ttl=%"PRIu32")",
+                      nl_attr_type(a) == OVS_ACTION_ATTR_STICKY_LEARN
+                      ? "sticky_learn" : "sticky_lookup",
+                      sticky->table_id, sticky->ttl_ms);
+        break;
+    }
     case OVS_ACTION_ATTR_UNSPEC:
     case __OVS_ACTION_ATTR_MAX:
     default:
@@ -2451,6 +2463,24 @@ parse_odp_action__(struct parse_odp_context *context, const char *s,
         }
     }
 
+    {
+        struct ovs_action_sticky sticky;
+        int n = -1;
+
+        if (ovs_scan(s, "sticky_learn(table=%"SCNi32",ttl=%"SCNi32")%n",
+                     &sticky.table_id, &sticky.ttl_ms, &n)) {
+            nl_msg_put_unspec(actions, OVS_ACTION_ATTR_STICKY_LEARN,
+                              &sticky, sizeof sticky);
+            return n;
+        }
+        if (ovs_scan(s, "sticky_lookup(table=%"SCNi32",ttl=%"SCNi32")%n",
+                     &sticky.table_id, &sticky.ttl_ms, &n)) {
+            nl_msg_put_unspec(actions, OVS_ACTION_ATTR_STICKY_LOOKUP,
+                              &sticky, sizeof sticky);
+            return n;
+        }
+    }
+
     {
         double percentage;
         int n = -1;
@@ -6137,6 +6167,12 @@ odp_flow_key_from_flow__(const struct odp_flow_key_parms *parms,
     const struct flow *mask = parms->mask;
     const struct flow *data = export_mask ? mask : flow;
 
+    /* Reserve the documented upper bound on the encoded size up front, so
+     * that the individual nl_msg_put_*() calls below never reallocate 'buf'
+     * mid-encode: each key is written into its final location exactly once,
+     * even when 'buf' streams many keys back to back. */
+    ofpbuf_prealloc_tailroom(buf, ODPUTIL_FLOW_KEY_BYTES);
+
     nl_msg_put_u32(buf, OVS_KEY_ATTR_PRIORITY, data->skb_priority);
 
     if (flow_tnl_dst_is_set(&flow->tunnel) ||
@@ -24,6 +24,7 @@
 #include "colors.h"
 #include "compiler.h"
 #include "dummy.h"
+#include "hash.h"
 #include "openvswitch/hmap.h"
 #include "learn.h"
 #include "multipath.h"
@@ -39,6 +40,7 @@
 #include "openvswitch/ofp-table.h"
 #include "openvswitch/ofpbuf.h"
 #include "openvswitch/vlog.h"
+#include "ovs-thread.h"
 #include "unaligned.h"
 #include "util.h"
 #include "vl-mff-map.h"
@@ -8350,13 +8352,90 @@ get_actions_from_instruction(const struct ofp11_instruction *inst,
     *actions_len = ntohs(inst->len) - sizeof *inst;
 }
 
-enum ofperr
-ofpacts_pull_openflow_instructions(struct ofpbuf *openflow,
-                                   unsigned int instructions_len,
-                                   enum ofp_version version,
-                                   const struct vl_mff_map *vl_mff_map,
-                                   uint64_t *ofpacts_tlv_bitmap,
-                                   struct ofpbuf *ofpacts)
+/* Cache of decoded instruction lists, keyed by the raw instruction bytes
+ * and OpenFlow version.  Controllers tend to push thousands of flow_mods
+ * that share a handful of action programs, and decoding is far more
+ * expensive than the memcmp and memcpy of a hit.  Only decodes that never
+ * consulted the variable-length mf map are cached (see the bitmap check in
+ * ofpacts_pull_openflow_instructions()), so entries cannot go stale when
+ * tunnel metadata mappings change. */
+struct ofpacts_decode_cache_entry {
+    uint32_t hash;
+    enum ofp_version version;
+    unsigned int raw_len;       /* Length of 'raw' in bytes. */
+    size_t ofpacts_len;         /* Length of 'ofpacts' in bytes. */
+    void *raw;                  /* Original instruction bytes. */
+    void *ofpacts;              /* Decoded actions. */
+};
+
+#define DECODE_CACHE_ENTRIES 64         /* Must be a power of 2. */
+#define DECODE_CACHE_MAX_BYTES 8192     /* Cap on raw + decoded size. */
+BUILD_ASSERT_DECL(IS_POW2(DECODE_CACHE_ENTRIES));
+
+static struct ovs_mutex decode_cache_mutex = OVS_MUTEX_INITIALIZER;
+static struct ofpacts_decode_cache_entry *
+    decode_cache[DECODE_CACHE_ENTRIES] OVS_GUARDED_BY(decode_cache_mutex);
+
+/* If the cache holds the decode of 'raw_len' bytes at 'raw' for 'version',
+ * replaces the contents of 'ofpacts' with it and returns true. */
+static bool
+ofpacts_decode_cache_get(uint32_t hash, enum ofp_version version,
+                         const void *raw, unsigned int raw_len,
+                         struct ofpbuf *ofpacts)
+{
+    struct ofpacts_decode_cache_entry *e;
+    bool hit = false;
+
+    ovs_mutex_lock(&decode_cache_mutex);
+    e = decode_cache[hash & (DECODE_CACHE_ENTRIES - 1)];
+    if (e && e->hash == hash && e->version == version
+        && e->raw_len == raw_len && !memcmp(e->raw, raw, raw_len)) {
+        ofpbuf_clear(ofpacts);
+        ofpbuf_put(ofpacts, e->ofpacts, e->ofpacts_len);
+        hit = true;
+    }
+    ovs_mutex_unlock(&decode_cache_mutex);
+    return hit;
+}
+
+static void
+ofpacts_decode_cache_put(uint32_t hash, enum ofp_version version,
+                         const void *raw, unsigned int raw_len,
+                         const struct ofpbuf *ofpacts)
+{
+    struct ofpacts_decode_cache_entry *e, **slot;
+
+    if (raw_len + ofpacts->size > DECODE_CACHE_MAX_BYTES) {
+        return;
+    }
+
+    e = xmalloc(sizeof *e);
+    e->hash = hash;
+    e->version = version;
+    e->raw_len = raw_len;
+    e->ofpacts_len = ofpacts->size;
+    e->raw = xmemdup(raw, raw_len);
+    e->ofpacts = xmemdup(ofpacts->data, ofpacts->size);
+
+    ovs_mutex_lock(&decode_cache_mutex);
+    slot = &decode_cache[hash & (DECODE_CACHE_ENTRIES - 1)];
+    if (*slot) {
+        /* Direct-mapped: a colliding action program just takes the slot. */
+        free((*slot)->raw);
+        free((*slot)->ofpacts);
+        free(*slot);
+    }
+    *slot = e;
+    ovs_mutex_unlock(&decode_cache_mutex);
+}
+
+static enum ofperr
+ofpacts_pull_openflow_instructions__(struct ofpbuf *openflow,
+                                     unsigned int instructions_len,
+                                     enum ofp_version version,
+                                     const struct vl_mff_map *vl_mff_map,
+                                     uint64_t *ofpacts_tlv_bitmap,
+                                     struct ofpbuf *ofpacts)
 {
     const struct ofp11_instruction *instructions;
     const struct ofp11_instruction *insts[N_OVS_INSTRUCTIONS];
@@ -8471,6 +8550,49 @@ exit:
     return error;
 }
 
+enum ofperr
+ofpacts_pull_openflow_instructions(struct ofpbuf *openflow,
+                                   unsigned int instructions_len,
+                                   enum ofp_version version,
+                                   const struct vl_mff_map *vl_mff_map,
+                                   uint64_t *ofpacts_tlv_bitmap,
+                                   struct ofpbuf *ofpacts)
+{
+    const void *raw = openflow->data;
+    uint64_t bitmap_before;
+    uint32_t hash = 0;
+    bool probed = false;
+    enum ofperr error;
+
+    if (instructions_len && instructions_len <= openflow->size) {
+        hash = hash_bytes(raw, instructions_len, version);
+        probed = true;
+        if (ofpacts_decode_cache_get(hash, version, raw, instructions_len,
+                                     ofpacts)) {
+            /* Consume the instructions just as a real decode would. */
+            ofpbuf_pull(openflow, instructions_len);
+            return 0;
+        }
+    }
+
+    bitmap_before = ofpacts_tlv_bitmap ? *ofpacts_tlv_bitmap : 0;
+    error = ofpacts_pull_openflow_instructions__(openflow, instructions_len,
+                                                 version, vl_mff_map,
+                                                 ofpacts_tlv_bitmap, ofpacts);
+
+    /* Cache the decode only if it could not have depended on 'vl_mff_map':
+     * either no map was given, or the decode referenced none of its fields
+     * (it would have set bits in a clean '*ofpacts_tlv_bitmap'). */
+    if (!error && probed
+        && (!vl_mff_map
+            || (ofpacts_tlv_bitmap && !bitmap_before
+                && !*ofpacts_tlv_bitmap))) {
+        ofpacts_decode_cache_put(hash, version, raw, instructions_len,
+                                 ofpacts);
+    }
+    return error;
+}
+
 /* Update the length of the instruction that begins at offset 'ofs' within
  * 'openflow' and contains nested actions that extend to the end of 'openflow'.
  * If the instruction contains no nested actions, deletes it entirely. */
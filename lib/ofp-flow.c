@@ -31,6 +31,7 @@
 #include "openvswitch/ofp-table.h"
 #include "openvswitch/ofpbuf.h"
 #include "openvswitch/vlog.h"
+#include "ovs-thread.h"
 #include "util.h"
 #include "ox-stat.h"
 
@@ -1829,6 +1830,61 @@ parse_ofp_flow_mod_str(struct ofputil_flow_mod *fm, const char *string,
     return error;
 }
 
+/* Minimum number of lines a flow_mod file must have before it is worth
+ * spreading the parsing over several threads, per thread.  Text-to-flow_mod
+ * parsing dominates reading the file back by a wide margin, so on large rule
+ * sets (hundreds of thousands of lines) parallel parsing pays off, but
+ * spawning threads for a handful of lines would only add overhead. */
+#define PARSE_OFP_FLOW_MOD_LINES_PER_THREAD 10000
+
+/* One contiguous block of lines handed to a parser thread.  Each thread
+ * writes its flow_mods directly into the shared 'fms' array at the same
+ * indexes as its input lines, so the array comes out in file order without
+ * any reassembly step. */
+struct parse_ofp_flow_mod_block {
+    pthread_t thread;
+
+    /* Input: parse 'lines' in the range [begin, end). */
+    char **lines;               /* Shared array of preprocessed lines. */
+    int *line_numbers;          /* Line number of each element of 'lines'. */
+    size_t begin, end;
+    const struct ofputil_port_map *port_map;
+    const struct ofputil_table_map *table_map;
+    int command;
+    struct ofputil_flow_mod *fms; /* Shared output array. */
+
+    /* Output. */
+    enum ofputil_protocol usable_protocols;
+    size_t n_parsed;            /* fms[begin...begin + n_parsed - 1] valid. */
+    char *error;                /* First error in block, or NULL. */
+    int error_line;             /* Line number 'error' refers to. */
+};
+
+static void *
+parse_ofp_flow_mod_block(void *block_)
+{
+    struct parse_ofp_flow_mod_block *block = block_;
+    size_t i;
+
+    block->usable_protocols = OFPUTIL_P_ANY;
+    for (i = block->begin; i < block->end; i++) {
+        enum ofputil_protocol usable;
+        char *error;
+
+        error = parse_ofp_flow_mod_str(&block->fms[i], block->lines[i],
+                                       block->port_map, block->table_map,
+                                       block->command, &usable);
+        if (error) {
+            block->error = error;
+            block->error_line = block->line_numbers[i];
+            break;
+        }
+        block->usable_protocols &= usable; /* Each line can narrow the set. */
+        block->n_parsed++;
+    }
+    return NULL;
+}
+
 /* Opens file 'file_name' and reads each line as a flow_mod of the specified
  * type (one of OFPFC_*).  Stores each flow_mod in '*fm', an array allocated
  * on the caller's behalf, and the number of flow_mods in '*n_fms'.
@@ -1837,6 +1893,9 @@ parse_ofp_flow_mod_str(struct ofputil_flow_mod *fm, const char *string,
  * ("add", "modify", "delete", "modify_strict", or "delete_strict").  A missing
  * command name is treated as "add".
  *
+ * Large files are parsed by several threads in parallel; '*fms' is in file
+ * order regardless.
+ *
  * Returns NULL if successful, otherwise a malloc()'d string describing the
  * error.  The caller is responsible for freeing the returned string. */
 char * OVS_WARN_UNUSED_RESULT
@@ -1847,8 +1906,13 @@ parse_ofp_flow_mod_file(const char *file_name,
                         struct ofputil_flow_mod **fms, size_t *n_fms,
                         enum ofputil_protocol *usable_protocols)
 {
-    size_t allocated_fms;
+    struct parse_ofp_flow_mod_block *blocks;
+    size_t n_lines, allocated_lines;
+    size_t n_blocks, b;
+    char *err_msg = NULL;
+    int *line_numbers;
     int line_number;
+    char **lines;
     FILE *stream;
     struct ds s;
 
@@ -1863,48 +1927,96 @@ parse_ofp_flow_mod_file(const char *file_name,
                          file_name, ovs_strerror(errno));
     }
 
-    allocated_fms = *n_fms;
+    /* Read the whole file up front so that parsing, which dominates reading,
+     * can be spread over several threads. */
+    lines = NULL;
+    line_numbers = NULL;
+    n_lines = allocated_lines = 0;
     ds_init(&s);
     line_number = 0;
     while (!ds_get_preprocessed_line(&s, stream, &line_number)) {
-        char *error;
-        enum ofputil_protocol usable;
+        if (n_lines >= allocated_lines) {
+            lines = x2nrealloc(lines, &allocated_lines, sizeof *lines);
+            line_numbers = xrealloc(line_numbers,
+                                    allocated_lines * sizeof *line_numbers);
+        }
+        lines[n_lines] = xstrdup(ds_cstr(&s));
+        line_numbers[n_lines] = line_number;
+        n_lines++;
+    }
+    ds_destroy(&s);
+    if (stream != stdin) {
+        fclose(stream);
+    }
 
-        if (*n_fms >= allocated_fms) {
-            *fms = x2nrealloc(*fms, &allocated_fms, sizeof **fms);
+    n_blocks = n_lines / PARSE_OFP_FLOW_MOD_LINES_PER_THREAD;
+    n_blocks = MIN(n_blocks, (size_t) count_cpu_cores());
+    n_blocks = MAX(n_blocks, 1);
+
+    *fms = n_lines ? xmalloc(n_lines * sizeof **fms) : NULL;
+    blocks = xzalloc(n_blocks * sizeof *blocks);
+    for (b = 0; b < n_blocks; b++) {
+        struct parse_ofp_flow_mod_block *block = &blocks[b];
+
+        block->lines = lines;
+        block->line_numbers = line_numbers;
+        block->begin = n_lines * b / n_blocks;
+        block->end = n_lines * (b + 1) / n_blocks;
+        block->port_map = port_map;
+        block->table_map = table_map;
+        block->command = command;
+        block->fms = *fms;
+    }
+    if (n_blocks == 1) {
+        parse_ofp_flow_mod_block(&blocks[0]);
+    } else {
+        for (b = 0; b < n_blocks; b++) {
+            blocks[b].thread = ovs_thread_create("flow_mod_parse",
+                                                 parse_ofp_flow_mod_block,
+                                                 &blocks[b]);
         }
-        error = parse_ofp_flow_mod_str(&(*fms)[*n_fms], ds_cstr(&s), port_map,
-                                       table_map, command, &usable);
-        if (error) {
-            char *err_msg;
+        for (b = 0; b < n_blocks; b++) {
+            xpthread_join(blocks[b].thread, NULL);
+        }
+    }
+
+    for (b = 0; b < n_blocks; b++) {
+        struct parse_ofp_flow_mod_block *block = &blocks[b];
+
+        *usable_protocols &= block->usable_protocols;
+        if (block->error) {
+            if (!err_msg) {
+                err_msg = xasprintf("%s:%d: %s", file_name,
+                                    block->error_line, block->error);
+            }
+            free(block->error);
+        }
+    }
+
+    if (err_msg) {
+        for (b = 0; b < n_blocks; b++) {
             size_t i;
 
-            for (i = 0; i < *n_fms; i++) {
+            for (i = blocks[b].begin;
+                 i < blocks[b].begin + blocks[b].n_parsed; i++) {
                 free(CONST_CAST(struct ofpact *, (*fms)[i].ofpacts));
                 minimatch_destroy(&(*fms)[i].match);
             }
-            free(*fms);
-            *fms = NULL;
-            *n_fms = 0;
-
-            ds_destroy(&s);
-            if (stream != stdin) {
-                fclose(stream);
-            }
-
-            err_msg = xasprintf("%s:%d: %s", file_name, line_number, error);
-            free(error);
-            return err_msg;
         }
-        *usable_protocols &= usable; /* Each line can narrow the set. */
-        *n_fms += 1;
+        free(*fms);
+        *fms = NULL;
+    } else {
+        *n_fms = n_lines;
     }
 
-    ds_destroy(&s);
-    if (stream != stdin) {
-        fclose(stream);
+    for (b = 0; b < n_lines; b++) {
+        free(lines[b]);
     }
-    return NULL;
+    free(lines);
+    free(line_numbers);
+    free(blocks);
+
+    return err_msg;
 }
 
 /* Parses a specification of a flow from 's' into 'flow'.  's' must take the
@@ -19,6 +19,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "openvswitch/dynamic-string.h"
+#include "malloc-cache.h"
 #include "util.h"
 
 static void
@@ -120,7 +121,9 @@ ofpbuf_use_const(struct ofpbuf *b, const void *data, size_t size)
 void
 ofpbuf_init(struct ofpbuf *b, size_t size)
 {
-    ofpbuf_use(b, size ? xmalloc(size) : NULL, size);
+    void *base = size ? malloc_cache_alloc(&size) : NULL;
+
+    ofpbuf_use(b, base, size);
 }
 
 /* Frees memory that 'b' points to. */
@@ -129,7 +132,7 @@ ofpbuf_uninit(struct ofpbuf *b)
 {
     if (b) {
         if (b->source == OFPBUF_MALLOC) {
-            free(b->base);
+            malloc_cache_free(b->base, b->allocated);
         }
     }
 }
@@ -147,11 +150,21 @@ ofpbuf_reinit(struct ofpbuf *b, size_t size)
 struct ofpbuf *
 ofpbuf_new(size_t size)
 {
-    struct ofpbuf *b = xmalloc(sizeof *b);
+    struct ofpbuf *b = malloc_cache_alloc_fixed(sizeof *b);
     ofpbuf_init(b, size);
     return b;
 }
 
+/* Frees memory that 'b' points to, as well as 'b' itself. */
+void
+ofpbuf_delete(struct ofpbuf *b)
+{
+    if (b) {
+        ofpbuf_uninit(b);
+        malloc_cache_free_fixed(b, sizeof *b);
+    }
+}
+
 /* Creates and returns a new ofpbuf with an initial capacity of 'size +
  * headroom' bytes, reserving the first 'headroom' bytes as headroom. */
 struct ofpbuf *
@@ -242,9 +255,9 @@ ofpbuf_resize__(struct ofpbuf *b, size_t new_headroom, size_t new_tailroom)
         if (new_headroom == ofpbuf_headroom(b)) {
             new_base = xrealloc(b->base, new_allocated);
         } else {
-            new_base = xmalloc(new_allocated);
+            new_base = malloc_cache_alloc(&new_allocated);
             ofpbuf_copy__(b, new_base, new_headroom, new_tailroom);
-            free(b->base);
+            malloc_cache_free(b->base, b->allocated);
         }
         break;
 
@@ -253,7 +266,7 @@ ofpbuf_resize__(struct ofpbuf *b, size_t new_headroom, size_t new_tailroom)
 
     case OFPBUF_STUB:
         b->source = OFPBUF_MALLOC;
-        new_base = xmalloc(new_allocated);
+        new_base = malloc_cache_alloc(&new_allocated);
         ofpbuf_copy__(b, new_base, new_headroom, new_tailroom);
         break;
 
@@ -491,7 +504,7 @@ ofpbuf_steal_data(struct ofpbuf *b)
     } else {
         p = xmemdup(b->data, b->size);
         if (b->source == OFPBUF_MALLOC) {
-            free(b->base);
+            malloc_cache_free(b->base, b->allocated);
         }
     }
     b->base = NULL;
@@ -1098,6 +1098,25 @@ ovsdb_datum_sort__(struct ovsdb_datum *datum, enum ovsdb_atomic_type key_type,
          &cbdata);
 }
 
+/* Returns true if 'datum''s keys are already in strictly increasing order,
+ * which also implies that they are unique.  Serializers emit datums in this
+ * order, so data read back from the database file or from a well-behaved
+ * client passes this check and need not be sorted again. */
+static bool
+ovsdb_datum_is_strictly_sorted(const struct ovsdb_datum *datum,
+                               enum ovsdb_atomic_type key_type)
+{
+    size_t i;
+
+    for (i = 0; i + 1 < datum->n; i++) {
+        if (ovsdb_atom_compare_3way(&datum->keys[i], &datum->keys[i + 1],
+                                    key_type) >= 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
 /* The keys in an ovsdb_datum must be unique and in sorted order.  Most
  * functions that modify an ovsdb_datum maintain these invariants.  For those
  * that don't, this function checks and restores these invariants for 'datum',
@@ -1115,6 +1134,10 @@ ovsdb_datum_sort(struct ovsdb_datum *datum, enum ovsdb_atomic_type key_type)
         return NULL;
     }
 
+    if (ovsdb_datum_is_strictly_sorted(datum, key_type)) {
+        return NULL;
+    }
+
     ovsdb_datum_sort__(datum, key_type, OVSDB_TYPE_VOID);
 
     for (i = 0; i < datum->n - 1; i++) {
@@ -1159,6 +1182,10 @@ ovsdb_datum_sort_unique(struct ovsdb_datum *datum,
         return 0;
     }
 
+    if (ovsdb_datum_is_strictly_sorted(datum, key_type)) {
+        return 0;
+    }
+
     ovsdb_datum_sort__(datum, key_type, value_type);
 
     dst = 1;
@@ -22,6 +22,7 @@
 #include <inttypes.h>
 #include <limits.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include "bitmap.h"
 #include "coverage.h"
@@ -219,6 +220,10 @@ struct ovsdb_idl_db {
 
     /* Last db txn id, used for fast resync through monitor_cond_since */
     struct uuid last_id;
+
+    /* File in which to persist a snapshot of the replica across restarts,
+     * or NULL.  See ovsdb_idl_set_snapshot_file(). */
+    char *snapshot_file;
 };
 
 static void ovsdb_idl_db_track_clear(struct ovsdb_idl_db *);
@@ -260,6 +265,8 @@ struct ovsdb_idl {
     enum ovsdb_idl_state state;      /* Current session state. */
     unsigned int state_seqno;        /* See above. */
     struct json *request_id;         /* JSON ID for request awaiting reply. */
+    struct json *binary_request_id;  /* JSON ID for in-flight "binary_json"
+                                      * request, if any. */
 
     struct uuid cid;
 
@@ -321,6 +328,7 @@ static bool ovsdb_idl_handle_monitor_canceled(struct ovsdb_idl *,
 static void ovsdb_idl_db_parse_update(struct ovsdb_idl_db *,
                                       const struct json *table_updates,
                                       enum ovsdb_idl_monitor_method method);
+static void ovsdb_idl_db_save_snapshot(struct ovsdb_idl_db *);
 enum update_result {
     OVSDB_IDL_UPDATE_DB_CHANGED,
     OVSDB_IDL_UPDATE_NO_CHANGES,
@@ -600,6 +608,7 @@ ovsdb_idl_db_destroy(struct ovsdb_idl_db *db)
     free(db->lock_name);
     json_destroy(db->lock_request_id);
     json_destroy(db->monitor_id);
+    free(db->snapshot_file);
 }
 
 /* Destroys 'idl' and all of the data structures that it manages. */
@@ -607,11 +616,13 @@ void
 ovsdb_idl_destroy(struct ovsdb_idl *idl)
 {
     if (idl) {
+        ovsdb_idl_db_save_snapshot(&idl->data);
         ovsdb_idl_clear(idl);
         jsonrpc_session_close(idl->session);
         ovsdb_idl_db_destroy(&idl->server);
         ovsdb_idl_db_destroy(&idl->data);
         json_destroy(idl->request_id);
+        json_destroy(idl->binary_request_id);
         free(idl->remote);
         free(idl);
     }
@@ -626,6 +637,216 @@ ovsdb_idl_set_leader_only(struct ovsdb_idl *idl, bool leader_only)
     }
 }
 
+/* Returns true if every table in 'db' is monitored without a condition, that
+ * is, if the local replica is a complete copy of the monitored columns. */
+static bool
+ovsdb_idl_db_is_unconditional(const struct ovsdb_idl_db *db)
+{
+    for (size_t i = 0; i < db->class_->n_tables; i++) {
+        const struct ovsdb_idl_table *table = &db->tables[i];
+
+        if ((table->new_cond && !ovsdb_idl_condition_is_true(table->new_cond))
+            || (table->req_cond
+                && !ovsdb_idl_condition_is_true(table->req_cond))
+            || (table->ack_cond
+                && !ovsdb_idl_condition_is_true(table->ack_cond))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Returns JSON that describes the columns of 'db' that are monitored, mapping
+ * table name to a column name to column type map.  A snapshot taken by a
+ * client that monitored a different set of columns would silently leave the
+ * missing columns at their defaults after a fast resync, so a snapshot is
+ * only usable if this description matches exactly. */
+static struct json *
+ovsdb_idl_db_snapshot_columns(const struct ovsdb_idl_db *db)
+{
+    struct json *tables = json_object_create();
+
+    for (size_t i = 0; i < db->class_->n_tables; i++) {
+        const struct ovsdb_idl_table *table = &db->tables[i];
+        struct json *columns = json_object_create();
+
+        for (size_t j = 0; j < table->class_->n_columns; j++) {
+            const struct ovsdb_idl_column *column = &table->class_->columns[j];
+
+            if (table->modes[j] & OVSDB_IDL_MONITOR) {
+                json_object_put(columns, column->name,
+                                ovsdb_type_to_json(&column->type));
+            }
+        }
+        json_object_put(tables, table->class_->name, columns);
+    }
+    return tables;
+}
+
+/* Returns the committed rows of 'db' in the <table-updates2> form, as a map
+ * from table name to a map from row UUID to an "initial" row update. */
+static struct json *
+ovsdb_idl_db_snapshot_data(const struct ovsdb_idl_db *db)
+{
+    struct json *updates = json_object_create();
+
+    for (size_t i = 0; i < db->class_->n_tables; i++) {
+        const struct ovsdb_idl_table *table = &db->tables[i];
+        struct json *table_json = NULL;
+        const struct ovsdb_idl_row *row;
+
+        HMAP_FOR_EACH (row, hmap_node, &table->rows) {
+            if (!row->old_datum) {
+                continue;       /* Orphan row. */
+            }
+
+            struct json *columns = json_object_create();
+            for (size_t j = 0; j < table->class_->n_columns; j++) {
+                const struct ovsdb_idl_column *column
+                    = &table->class_->columns[j];
+
+                if (table->modes[j] & OVSDB_IDL_MONITOR
+                    && !ovsdb_datum_is_default(&row->old_datum[j],
+                                               &column->type)) {
+                    json_object_put(columns, column->name,
+                                    ovsdb_datum_to_json(&row->old_datum[j],
+                                                        &column->type));
+                }
+            }
+
+            struct json *row_json = json_object_create();
+            json_object_put(row_json, "initial", columns);
+
+            char uuid[UUID_LEN + 1];
+            snprintf(uuid, sizeof uuid, UUID_FMT, UUID_ARGS(&row->uuid));
+            if (!table_json) {
+                table_json = json_object_create();
+                json_object_put(updates, table->class_->name, table_json);
+            }
+            json_object_put(table_json, uuid, row_json);
+        }
+    }
+    return updates;
+}
+
+/* Writes a snapshot of 'db' to its snapshot file, if one was configured with
+ * ovsdb_idl_set_snapshot_file(). */
+static void
+ovsdb_idl_db_save_snapshot(struct ovsdb_idl_db *db)
+{
+    if (!db->snapshot_file) {
+        return;
+    }
+
+    /* Without a last transaction ID a restarted client cannot ask the server
+     * for just the changes since the snapshot, and under a conditional
+     * monitor the replica lacks the rows that the conditions excluded.
+     * Discard any previous snapshot so that the next run starts cold. */
+    if (uuid_is_zero(&db->last_id) || !ovsdb_idl_db_is_unconditional(db)) {
+        unlink(db->snapshot_file);
+        return;
+    }
+
+    struct json *snapshot = json_object_create();
+    json_object_put_string(snapshot, "database", db->class_->database);
+    json_object_put(snapshot, "columns", ovsdb_idl_db_snapshot_columns(db));
+    json_object_put(snapshot, "last-id",
+                    json_string_create_nocopy(
+                        xasprintf(UUID_FMT, UUID_ARGS(&db->last_id))));
+    json_object_put(snapshot, "data", ovsdb_idl_db_snapshot_data(db));
+
+    char *s = json_to_string(snapshot, 0);
+    json_destroy(snapshot);
+
+    char *tmp_file = xasprintf("%s.tmp", db->snapshot_file);
+    FILE *file = fopen(tmp_file, "w");
+    if (!file) {
+        VLOG_WARN("%s: create failed (%s)", tmp_file, ovs_strerror(errno));
+    } else {
+        bool ok = fputs(s, file) != EOF;
+        ok = !fclose(file) && ok;
+        if (!ok) {
+            VLOG_WARN("%s: write failed (%s)", tmp_file, ovs_strerror(errno));
+            unlink(tmp_file);
+        } else if (rename(tmp_file, db->snapshot_file)) {
+            VLOG_WARN("%s: rename failed (%s)",
+                      db->snapshot_file, ovs_strerror(errno));
+            unlink(tmp_file);
+        }
+    }
+    free(tmp_file);
+    free(s);
+}
+
+/* Configures 'idl' to persist its replica to 'path' when it is destroyed and
+ * to load a replica persisted there by a previous run, so that a restarted
+ * client can start work from the cached contents immediately and fetch only
+ * the changes made in the meantime through monitor_cond_since.  If the server
+ * does not recognize the snapshot's transaction ID (for example, after its
+ * database was compacted), the cached contents are flushed and replaced by a
+ * full download, just as without a snapshot.
+ *
+ * A snapshot only covers the monitored columns, so this should be called
+ * after the set of monitored columns is complete, e.g. after the calls to
+ * ovsdb_idl_add_column() or ovsdb_idl_omit().  A snapshot is not kept when
+ * any table has a monitor condition other than "true". */
+void
+ovsdb_idl_set_snapshot_file(struct ovsdb_idl *idl, const char *path)
+{
+    struct ovsdb_idl_db *db = &idl->data;
+
+    free(db->snapshot_file);
+    db->snapshot_file = xstrdup(path);
+
+    struct json *snapshot = json_from_file(path);
+    if (snapshot->type == JSON_STRING) {
+        VLOG_DBG("%s: no usable snapshot (%s)", path, json_string(snapshot));
+        json_destroy(snapshot);
+        return;
+    }
+
+    const char *failure = NULL;
+    if (snapshot->type != JSON_OBJECT) {
+        failure = "not a JSON object";
+    } else {
+        const struct shash *object = json_object(snapshot);
+        const struct json *database = shash_find_data(object, "database");
+        const struct json *columns = shash_find_data(object, "columns");
+        const struct json *last_id_json = shash_find_data(object, "last-id");
+        const struct json *data = shash_find_data(object, "data");
+        struct uuid last_id;
+
+        if (!database || database->type != JSON_STRING
+            || strcmp(json_string(database), db->class_->database)) {
+            failure = "database name mismatch";
+        } else if (!last_id_json || last_id_json->type != JSON_STRING
+                   || !uuid_from_string(&last_id,
+                                        json_string(last_id_json))) {
+            failure = "missing or invalid last-id";
+        } else if (!data || data->type != JSON_OBJECT) {
+            failure = "missing or invalid data";
+        } else {
+            struct json *our_columns = ovsdb_idl_db_snapshot_columns(db);
+            bool equal = columns && json_equal(columns, our_columns);
+            json_destroy(our_columns);
+
+            if (!equal) {
+                failure = "monitored columns changed";
+            } else {
+                ovsdb_idl_db_parse_update(db, data,
+                                          OVSDB_IDL_MM_MONITOR_COND);
+                db->last_id = last_id;
+                VLOG_INFO("%s: loaded snapshot, will resync from txn "
+                          UUID_FMT, path, UUID_ARGS(&last_id));
+            }
+        }
+    }
+    if (failure) {
+        VLOG_INFO("%s: discarding snapshot (%s)", path, failure);
+    }
+    json_destroy(snapshot);
+}
+
 static void
 ovsdb_idl_db_clear(struct ovsdb_idl_db *db)
 {
@@ -716,6 +937,18 @@ ovsdb_idl_send_request(struct ovsdb_idl *idl, struct jsonrpc_msg *request)
 static void
 ovsdb_idl_restart_fsm(struct ovsdb_idl *idl)
 {
+    /* Offer to switch this connection to binary message encoding.  A server
+     * that understands the offer encodes everything that follows its reply,
+     * including the bulky monitor updates, in binary; an older server replies
+     * with an "unknown method" error and everything stays text.  This is
+     * per connection, so it is renegotiated after every reconnect. */
+    struct jsonrpc_msg *binary_request
+        = jsonrpc_create_request("binary_json", json_array_create_empty(),
+                                 NULL);
+    json_destroy(idl->binary_request_id);
+    idl->binary_request_id = json_clone(binary_request->id);
+    jsonrpc_session_send(idl->session, binary_request);
+
     /* Resync data DB table conditions to avoid missing updates due to
      * conditions that were in flight or changed locally while the connection
      * was down.
@@ -852,6 +1085,20 @@ ovsdb_idl_process_msg(struct ovsdb_idl *idl, struct jsonrpc_msg *msg)
     bool is_response = (msg->type == JSONRPC_REPLY ||
                         msg->type == JSONRPC_ERROR);
 
+    /* Process a reply to a "binary_json" offer (see
+     * ovsdb_idl_restart_fsm()).  An error just means an older server, so
+     * keep sending text. */
+    if (is_response
+        && idl->binary_request_id
+        && json_equal(idl->binary_request_id, msg->id)) {
+        json_destroy(idl->binary_request_id);
+        idl->binary_request_id = NULL;
+        if (msg->type == JSONRPC_REPLY) {
+            jsonrpc_session_set_binary(idl->session);
+        }
+        return;
+    }
+
     /* Process a reply to an outstanding request. */
     if (is_response
         && idl->request_id && json_equal(idl->request_id, msg->id)) {
@@ -1874,6 +2121,37 @@ ovsdb_idl_track_add_all(struct ovsdb_idl *idl)
     }
 }
 
+/* Enables tracking for every column that the IDL is already monitoring with
+ * alerting enabled.  Unlike ovsdb_idl_track_add_column(), this does not
+ * re-enable alerting on columns that the client turned off with
+ * ovsdb_idl_omit_alert(), so it is suitable for clients that tune their
+ * column modes before enabling tracking.
+ *
+ * With tracking enabled, a change to a row also marks every row that
+ * references it, directly or indirectly, as modified, so a client can tell
+ * from a row's change sequence number whether anything in the subtree of rows
+ * it references changed.
+ *
+ * This function should be called between ovsdb_idl_create() and the first
+ * call to ovsdb_idl_run().  The client must periodically call
+ * ovsdb_idl_track_clear() after processing, otherwise deleted rows accumulate
+ * in the tracking lists. */
+void
+ovsdb_idl_track_add_monitored(struct ovsdb_idl *idl)
+{
+    size_t i, j;
+
+    for (i = 0; i < idl->data.class_->n_tables; i++) {
+        struct ovsdb_idl_table *table = &idl->data.tables[i];
+
+        for (j = 0; j < table->class_->n_columns; j++) {
+            if (table->modes[j] & OVSDB_IDL_ALERT) {
+                table->modes[j] |= OVSDB_IDL_TRACK;
+            }
+        }
+    }
+}
+
 /* Returns true if 'table' has any tracked column. */
 static bool
 ovsdb_idl_track_is_set(struct ovsdb_idl_table *table)
@@ -4503,6 +4781,30 @@ ovsdb_idl_txn_commit_block(struct ovsdb_idl_txn *txn)
     return status;
 }
 
+/* Returns the current status of 'txn', without doing any further work to
+ * advance it.
+ *
+ * This is the way for a client that pipelines transactions to poll for
+ * completion: after ovsdb_idl_txn_commit() returns TXN_INCOMPLETE, each call
+ * to ovsdb_idl_run() can update the status, which changes to its final value
+ * when the server's reply arrives.  (Calling ovsdb_idl_txn_commit() again
+ * also reports the status, but it bumps the transaction state coverage
+ * counters each time, which makes them useless for debugging.) */
+enum ovsdb_idl_txn_status
+ovsdb_idl_txn_get_status(const struct ovsdb_idl_txn *txn)
+{
+    return txn->status;
+}
+
+/* Returns the number of committed transactions on 'idl' whose replies have
+ * not yet arrived from the database server.  A client that pipelines
+ * transactions can use this to bound the number it keeps in flight. */
+size_t
+ovsdb_idl_get_outstanding_txn_count(const struct ovsdb_idl *idl)
+{
+    return hmap_count(&idl->data.outstanding_txns);
+}
+
 /* Returns the final (incremented) value of the column in 'txn' that was set to
  * be incremented by ovsdb_idl_txn_increment().  'txn' must have committed
  * successfully. */
@@ -68,6 +68,7 @@ void ovsdb_idl_reset_min_index(struct ovsdb_idl *);
 void ovsdb_idl_destroy(struct ovsdb_idl *);
 
 void ovsdb_idl_set_leader_only(struct ovsdb_idl *, bool leader_only);
+void ovsdb_idl_set_snapshot_file(struct ovsdb_idl *, const char *path);
 
 void ovsdb_idl_run(struct ovsdb_idl *);
 void ovsdb_idl_wait(struct ovsdb_idl *);
@@ -218,6 +219,7 @@ unsigned int ovsdb_idl_row_get_seqno(
 void ovsdb_idl_track_add_column(struct ovsdb_idl *idl,
                                 const struct ovsdb_idl_column *column);
 void ovsdb_idl_track_add_all(struct ovsdb_idl *idl);
+void ovsdb_idl_track_add_monitored(struct ovsdb_idl *idl);
 const struct ovsdb_idl_row *ovsdb_idl_track_get_first(
     const struct ovsdb_idl *, const struct ovsdb_idl_table_class *);
 const struct ovsdb_idl_row *ovsdb_idl_track_get_next(const struct ovsdb_idl_row *);
@@ -295,6 +297,21 @@ bool ovsdb_idl_row_is_synthetic(const struct ovsdb_idl_row *);
  *    step 1.  Only a call to ovsdb_idl_run() will change the return value of
  *    ovsdb_idl_get_seqno().  (ovsdb_idl_txn_commit_block() calls
  *    ovsdb_idl_run().)
+ *
+ * The IDL does not require one transaction to complete before the next one
+ * begins: once ovsdb_idl_txn_commit() has returned TXN_INCOMPLETE, the client
+ * may immediately create and commit further transactions without waiting for
+ * the first one's reply.  The server processes the requests in order and the
+ * IDL matches replies up with requests as they arrive, so each transaction's
+ * status resolves independently.  A client that issues many small,
+ * independent transactions can overlap their round trips this way, polling
+ * each transaction with ovsdb_idl_txn_get_status() and bounding the number in
+ * flight with ovsdb_idl_get_outstanding_txn_count().  One caveat: a pipelined
+ * transaction is composed against the latest state the IDL has seen, which
+ * does not yet reflect earlier unacknowledged transactions, so a transaction
+ * that reads or verifies a column written by a still-outstanding transaction
+ * should instead be merged into that transaction or deferred until it
+ * completes.
  */
 
 enum ovsdb_idl_txn_status {
@@ -325,6 +342,9 @@ void ovsdb_idl_txn_destroy(struct ovsdb_idl_txn *);
 void ovsdb_idl_txn_wait(const struct ovsdb_idl_txn *);
 enum ovsdb_idl_txn_status ovsdb_idl_txn_commit(struct ovsdb_idl_txn *);
 enum ovsdb_idl_txn_status ovsdb_idl_txn_commit_block(struct ovsdb_idl_txn *);
+enum ovsdb_idl_txn_status ovsdb_idl_txn_get_status(
+    const struct ovsdb_idl_txn *);
+size_t ovsdb_idl_get_outstanding_txn_count(const struct ovsdb_idl *);
 void ovsdb_idl_txn_abort(struct ovsdb_idl_txn *);
 
 const char *ovsdb_idl_txn_get_error(const struct ovsdb_idl_txn *);
@@ -0,0 +1,87 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+#include <string.h>
+
+#include "p4rt-arena.h"
+#include "util.h"
+
+/* Large enough for the keys and values of every table a p4c-generated
+ * program declares; oversized requests get a dedicated block. */
+#define P4RT_ARENA_BLOCK_SIZE 4096
+
+static struct p4rt_arena_block *
+p4rt_arena_new_block(struct p4rt_arena *arena, size_t min_size)
+{
+    size_t size = MAX(min_size, P4RT_ARENA_BLOCK_SIZE);
+    struct p4rt_arena_block *block = xmalloc(sizeof *block + size);
+
+    block->size = size;
+    block->used = 0;
+    block->next = arena->blocks;
+    arena->blocks = block;
+
+    return block;
+}
+
+void
+p4rt_arena_init(struct p4rt_arena *arena)
+{
+    arena->blocks = NULL;
+}
+
+void
+p4rt_arena_uninit(struct p4rt_arena *arena)
+{
+    struct p4rt_arena_block *block, *next;
+
+    for (block = arena->blocks; block; block = next) {
+        next = block->next;
+        free(block);
+    }
+    arena->blocks = NULL;
+}
+
+void *
+p4rt_arena_alloc(struct p4rt_arena *arena, size_t size)
+{
+    struct p4rt_arena_block *block = arena->blocks;
+    void *p;
+
+    if (!block || block->used + size > block->size) {
+        block = p4rt_arena_new_block(arena, size);
+    }
+
+    p = block->data + block->used;
+    block->used = ROUND_UP(block->used + size, 8);
+
+    return p;
+}
+
+void *
+p4rt_arena_zalloc(struct p4rt_arena *arena, size_t size)
+{
+    return memset(p4rt_arena_alloc(arena, size), 0, size);
+}
+
+void
+p4rt_arena_reset(struct p4rt_arena *arena)
+{
+    struct p4rt_arena_block *block;
+
+    for (block = arena->blocks; block; block = block->next) {
+        block->used = 0;
+    }
+}
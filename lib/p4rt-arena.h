@@ -0,0 +1,54 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef P4RT_ARENA_H
+#define P4RT_ARENA_H 1
+
+#include <stddef.h>
+
+/* Bump allocator for P4Runtime table-entry staging.
+ *
+ * Staging one table entry needs a handful of short-lived buffers (the
+ * translated key, the packed map value) that all die together once the
+ * entry is installed.  An arena hands them out by advancing a pointer
+ * through a block and reclaims them all at once with a reset, so a
+ * write burst touches the real allocator once per block instead of
+ * several times per entry.
+ *
+ * Not thread-safe; each arena belongs to one staging session. */
+
+struct p4rt_arena_block {
+    struct p4rt_arena_block *next;
+    size_t size;                /* Usable bytes in 'data'. */
+    size_t used;
+    char data[];
+};
+
+struct p4rt_arena {
+    struct p4rt_arena_block *blocks;  /* Current block first. */
+};
+
+#define P4RT_ARENA_INITIALIZER { NULL }
+
+void p4rt_arena_init(struct p4rt_arena *);
+void p4rt_arena_uninit(struct p4rt_arena *);
+
+void *p4rt_arena_alloc(struct p4rt_arena *, size_t);
+void *p4rt_arena_zalloc(struct p4rt_arena *, size_t);
+
+/* Invalidates everything allocated since init or the last reset, but
+ * keeps the blocks for reuse. */
+void p4rt_arena_reset(struct p4rt_arena *);
+
+#endif /* p4rt-arena.h */
@@ -0,0 +1,91 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+#include <errno.h>
+
+#include "p4rt-offload.h"
+#include "openvswitch/vlog.h"
+#include "util.h"
+
+VLOG_DEFINE_THIS_MODULE(p4rt_offload);
+
+static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 20);
+
+/* A single provider suffices: one NIC vendor backend per deployment,
+ * just as netdev-offload ends up with one flow API per port. */
+static const struct p4rt_offload_api *offload_api;
+
+/* Only these match kinds map onto what NIC table engines support;
+ * everything else stays software-only. */
+static bool
+p4rt_offload_match_supported(enum ubpf_map_type type)
+{
+    return type == UBPF_MAP_TYPE_HASHMAP
+           || type == UBPF_MAP_TYPE_LPM_TRIE
+           || type == UBPF_MAP_TYPE_LPM_DIR24;
+}
+
+int
+p4rt_offload_register_provider(const struct p4rt_offload_api *api)
+{
+    if (!api || !api->type || !api->entry_add || !api->entry_del) {
+        return EINVAL;
+    }
+    if (offload_api) {
+        VLOG_WARN("%s: a P4 offload provider is already registered (%s)",
+                  api->type, offload_api->type);
+        return EEXIST;
+    }
+    offload_api = api;
+    VLOG_INFO("registered P4 offload provider %s", api->type);
+    return 0;
+}
+
+/* Mirrors a freshly installed entry into hardware, if a provider is
+ * registered and can express it.  Best effort: the software entry is
+ * already in place and stays authoritative. */
+void
+p4rt_offload_entry_add(const struct p4rt_offload_entry *entry)
+{
+    int error;
+
+    if (!offload_api || !p4rt_offload_match_supported(entry->match_type)) {
+        return;
+    }
+
+    error = offload_api->entry_add(entry);
+    if (error) {
+        VLOG_DBG_RL(&rl, "%s: entry for table %"PRIu32" of program %"PRIu32
+                    " not offloaded (%s)", offload_api->type,
+                    entry->table_id, entry->prog_id, ovs_strerror(error));
+    }
+}
+
+void
+p4rt_offload_entry_del(const struct p4rt_offload_entry *entry)
+{
+    int error;
+
+    if (!offload_api || !p4rt_offload_match_supported(entry->match_type)) {
+        return;
+    }
+
+    error = offload_api->entry_del(entry);
+    if (error) {
+        VLOG_DBG_RL(&rl, "%s: failed to remove offloaded entry for table "
+                    "%"PRIu32" of program %"PRIu32" (%s)", offload_api->type,
+                    entry->table_id, entry->prog_id, ovs_strerror(error));
+    }
+}
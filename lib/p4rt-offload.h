@@ -0,0 +1,62 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef P4RT_OFFLOAD_H
+#define P4RT_OFFLOAD_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bpf/ubpf_int.h"
+
+/* Hardware offload of P4 match-action table entries.
+ *
+ * This is the P4 counterpart of netdev-offload: a provider (an
+ * rte_flow backend on a capable NIC, for instance) registers a
+ * p4rt_offload_api and the ubpf datapath mirrors exact-match and LPM
+ * entries into it as they are installed or removed.  The uBPF program
+ * remains the authoritative software path - a provider is free to
+ * reject any entry it cannot express, and provider failures are logged
+ * but never surfaced to the controller. */
+
+struct p4rt_offload_entry {
+    uint32_t prog_id;           /* P4 program (device) the entry is for. */
+    uint32_t table_id;          /* uBPF map index of the table. */
+    enum ubpf_map_type match_type; /* Exact (hashmap), LPM or ternary type. */
+    const void *key;            /* In the map's key layout. */
+    size_t key_size;
+    uint32_t action_id;         /* P4Info action id. */
+    const void *data;           /* In the map's value layout. */
+    size_t data_size;
+};
+
+struct p4rt_offload_api {
+    const char *type;
+
+    /* Mirrors one entry into hardware.  Returns 0 on success, a
+     * positive errno value (typically EOPNOTSUPP) if the entry cannot
+     * be expressed. */
+    int (*entry_add)(const struct p4rt_offload_entry *);
+
+    /* Removes a previously mirrored entry.  An entry the provider had
+     * rejected on add may be passed here; return 0 for those. */
+    int (*entry_del)(const struct p4rt_offload_entry *);
+};
+
+int p4rt_offload_register_provider(const struct p4rt_offload_api *);
+
+void p4rt_offload_entry_add(const struct p4rt_offload_entry *);
+void p4rt_offload_entry_del(const struct p4rt_offload_entry *);
+
+#endif /* p4rt-offload.h */
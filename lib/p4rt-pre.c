@@ -0,0 +1,402 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <string.h>
+
+#include "p4rt-pre.h"
+#include "cmap.h"
+#include "hash.h"
+#include "openvswitch/hmap.h"
+#include "openvswitch/list.h"
+#include "openvswitch/vlog.h"
+#include "ovs-rcu.h"
+#include "ovs-thread.h"
+#include "util.h"
+
+VLOG_DEFINE_THIS_MODULE(p4rt_pre);
+
+/* A replication node: one rid with its egress ports.  Owned by at most
+ * one group at a time, which is all the P4Runtime frontend ever asks
+ * for. */
+struct pre_node {
+    struct hmap_node hmap_node;  /* In 'pre_nodes', by handle. */
+    struct ovs_list list_node;   /* In the owning group's 'nodes'. */
+    uint32_t handle;
+    uint16_t rid;
+    struct pre_node_ports *ports;
+    struct pre_group *group;     /* Owning group, or NULL if detached. */
+};
+
+struct pre_node_ports {
+    size_t n_ports;
+    uint32_t ports[];
+};
+
+struct pre_group {
+    struct cmap_node cmap_node;  /* In 'pre_groups', by group id. */
+    uint32_t grp_id;
+    struct ovs_list nodes;       /* Attached 'struct pre_node's. */
+    OVSRCU_TYPE(struct p4rt_pre_ports *) flat;  /* Published egress list. */
+};
+
+static struct ovs_mutex pre_mutex = OVS_MUTEX_INITIALIZER;
+static struct cmap pre_groups = CMAP_INITIALIZER;
+static struct hmap pre_nodes OVS_GUARDED_BY(pre_mutex)
+    = HMAP_INITIALIZER(&pre_nodes);
+static uint32_t pre_next_node_handle OVS_GUARDED_BY(pre_mutex) = 1;
+
+static struct pre_group *
+pre_group_find(uint32_t grp_id)
+{
+    struct pre_group *grp;
+
+    CMAP_FOR_EACH_WITH_HASH (grp, cmap_node, hash_int(grp_id, 0),
+                             &pre_groups) {
+        if (grp->grp_id == grp_id) {
+            return grp;
+        }
+    }
+    return NULL;
+}
+
+static struct pre_node *
+pre_node_find(uint32_t handle) OVS_REQUIRES(pre_mutex)
+{
+    struct pre_node *node;
+
+    HMAP_FOR_EACH_WITH_HASH (node, hmap_node, hash_int(handle, 0),
+                             &pre_nodes) {
+        if (node->handle == handle) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+/* Recompiles 'grp''s egress list from its attached nodes and publishes
+ * it.  The previous list stays valid for in-flight readers until a
+ * grace period has passed. */
+static void
+pre_group_refresh(struct pre_group *grp) OVS_REQUIRES(pre_mutex)
+{
+    struct p4rt_pre_ports *flat, *old;
+    struct pre_node *node;
+    size_t n = 0;
+
+    LIST_FOR_EACH (node, list_node, &grp->nodes) {
+        n += node->ports->n_ports;
+    }
+
+    flat = xmalloc(sizeof *flat + n * sizeof flat->ports[0]);
+    flat->n_ports = 0;
+    LIST_FOR_EACH (node, list_node, &grp->nodes) {
+        memcpy(&flat->ports[flat->n_ports], node->ports->ports,
+               node->ports->n_ports * sizeof flat->ports[0]);
+        flat->n_ports += node->ports->n_ports;
+    }
+
+    old = ovsrcu_get_protected(struct p4rt_pre_ports *, &grp->flat);
+    ovsrcu_set(&grp->flat, flat);
+    ovsrcu_postpone(free, old);
+}
+
+/* Creates multicast group 'grp_id' if it does not exist yet.  Returns
+ * the group handle, which is the group id itself. */
+uint32_t
+p4rt_pre_group_create(uint32_t grp_id)
+{
+    struct pre_group *grp;
+
+    ovs_mutex_lock(&pre_mutex);
+    grp = pre_group_find(grp_id);
+    if (!grp) {
+        grp = xzalloc(sizeof *grp);
+        grp->grp_id = grp_id;
+        ovs_list_init(&grp->nodes);
+        ovsrcu_set(&grp->flat,
+                   xzalloc(sizeof(struct p4rt_pre_ports)));
+        cmap_insert(&pre_groups, &grp->cmap_node, hash_int(grp_id, 0));
+        VLOG_DBG("created multicast group %"PRIu32, grp_id);
+    }
+    ovs_mutex_unlock(&pre_mutex);
+
+    return grp_id;
+}
+
+int
+p4rt_pre_group_delete(uint32_t grp_handle)
+{
+    struct pre_group *grp;
+    struct pre_node *node;
+
+    ovs_mutex_lock(&pre_mutex);
+    grp = pre_group_find(grp_handle);
+    if (!grp) {
+        ovs_mutex_unlock(&pre_mutex);
+        return ENOENT;
+    }
+
+    LIST_FOR_EACH_POP (node, list_node, &grp->nodes) {
+        node->group = NULL;
+    }
+    cmap_remove(&pre_groups, &grp->cmap_node, hash_int(grp->grp_id, 0));
+    ovsrcu_postpone(free,
+                    ovsrcu_get_protected(struct p4rt_pre_ports *,
+                                         &grp->flat));
+    ovsrcu_postpone(free, grp);
+    ovs_mutex_unlock(&pre_mutex);
+
+    return 0;
+}
+
+static struct pre_node_ports *
+pre_node_ports_clone(size_t n_ports, const uint32_t *ports)
+{
+    struct pre_node_ports *np;
+
+    np = xmalloc(sizeof *np + n_ports * sizeof np->ports[0]);
+    np->n_ports = n_ports;
+    memcpy(np->ports, ports, n_ports * sizeof np->ports[0]);
+    return np;
+}
+
+int
+p4rt_pre_node_create(uint16_t rid, size_t n_ports, const uint32_t *ports,
+                     uint32_t *node_handle)
+{
+    struct pre_node *node;
+
+    node = xzalloc(sizeof *node);
+    node->rid = rid;
+    node->ports = pre_node_ports_clone(n_ports, ports);
+
+    ovs_mutex_lock(&pre_mutex);
+    node->handle = pre_next_node_handle++;
+    hmap_insert(&pre_nodes, &node->hmap_node, hash_int(node->handle, 0));
+    ovs_mutex_unlock(&pre_mutex);
+
+    *node_handle = node->handle;
+    return 0;
+}
+
+int
+p4rt_pre_node_modify(uint32_t node_handle, size_t n_ports,
+                     const uint32_t *ports)
+{
+    struct pre_node *node;
+
+    ovs_mutex_lock(&pre_mutex);
+    node = pre_node_find(node_handle);
+    if (!node) {
+        ovs_mutex_unlock(&pre_mutex);
+        return ENOENT;
+    }
+
+    free(node->ports);
+    node->ports = pre_node_ports_clone(n_ports, ports);
+    if (node->group) {
+        pre_group_refresh(node->group);
+    }
+    ovs_mutex_unlock(&pre_mutex);
+
+    return 0;
+}
+
+int
+p4rt_pre_node_delete(uint32_t node_handle)
+{
+    struct pre_node *node;
+
+    ovs_mutex_lock(&pre_mutex);
+    node = pre_node_find(node_handle);
+    if (!node) {
+        ovs_mutex_unlock(&pre_mutex);
+        return ENOENT;
+    }
+
+    if (node->group) {
+        ovs_list_remove(&node->list_node);
+        pre_group_refresh(node->group);
+    }
+    hmap_remove(&pre_nodes, &node->hmap_node);
+    free(node->ports);
+    free(node);
+    ovs_mutex_unlock(&pre_mutex);
+
+    return 0;
+}
+
+int
+p4rt_pre_group_attach(uint32_t grp_handle, uint32_t node_handle)
+{
+    struct pre_group *grp;
+    struct pre_node *node;
+    int error = 0;
+
+    ovs_mutex_lock(&pre_mutex);
+    grp = pre_group_find(grp_handle);
+    node = pre_node_find(node_handle);
+    if (!grp || !node) {
+        error = ENOENT;
+    } else if (node->group) {
+        error = EEXIST;
+    } else {
+        node->group = grp;
+        ovs_list_push_back(&grp->nodes, &node->list_node);
+        pre_group_refresh(grp);
+    }
+    ovs_mutex_unlock(&pre_mutex);
+
+    return error;
+}
+
+int
+p4rt_pre_group_detach(uint32_t grp_handle, uint32_t node_handle)
+{
+    struct pre_group *grp;
+    struct pre_node *node;
+    int error = 0;
+
+    ovs_mutex_lock(&pre_mutex);
+    grp = pre_group_find(grp_handle);
+    node = pre_node_find(node_handle);
+    if (!grp || !node || node->group != grp) {
+        error = ENOENT;
+    } else {
+        node->group = NULL;
+        ovs_list_remove(&node->list_node);
+        pre_group_refresh(grp);
+    }
+    ovs_mutex_unlock(&pre_mutex);
+
+    return error;
+}
+
+/* Returns the current egress list of group 'grp_id', or NULL if no such
+ * group exists.  The result is RCU-protected: it stays valid until the
+ * caller next quiesces, and must not be retained beyond that. */
+const struct p4rt_pre_ports *
+p4rt_pre_group_lookup(uint32_t grp_id)
+{
+    struct pre_group *grp = pre_group_find(grp_id);
+
+    return grp ? ovsrcu_get(struct p4rt_pre_ports *, &grp->flat) : NULL;
+}
+
+/* A clone session points at either a single egress port (published as a
+ * one-entry flat list) or a multicast group, whose egress list is
+ * resolved at lookup time so later group edits take effect. */
+struct pre_clone_session {
+    struct cmap_node cmap_node;  /* In 'pre_clone_sessions', by id. */
+    uint32_t session_id;
+    bool has_grp;
+    uint32_t grp_id;
+    OVSRCU_TYPE(struct p4rt_pre_ports *) flat;  /* If '!has_grp'. */
+};
+
+static struct cmap pre_clone_sessions = CMAP_INITIALIZER;
+
+static struct pre_clone_session *
+pre_clone_session_find(uint32_t session_id)
+{
+    struct pre_clone_session *session;
+
+    CMAP_FOR_EACH_WITH_HASH (session, cmap_node, hash_int(session_id, 0),
+                             &pre_clone_sessions) {
+        if (session->session_id == session_id) {
+            return session;
+        }
+    }
+    return NULL;
+}
+
+int
+p4rt_pre_clone_session_set(uint32_t session_id, bool has_port, uint32_t port,
+                           bool has_grp, uint32_t grp_id)
+{
+    struct pre_clone_session *session;
+    struct p4rt_pre_ports *flat, *old;
+
+    if (has_port == has_grp) {
+        return EINVAL;
+    }
+
+    flat = xzalloc(sizeof *flat + (has_port ? sizeof flat->ports[0] : 0));
+    if (has_port) {
+        flat->n_ports = 1;
+        flat->ports[0] = port;
+    }
+
+    ovs_mutex_lock(&pre_mutex);
+    session = pre_clone_session_find(session_id);
+    if (!session) {
+        session = xzalloc(sizeof *session);
+        session->session_id = session_id;
+        ovsrcu_set(&session->flat, flat);
+        session->has_grp = has_grp;
+        session->grp_id = grp_id;
+        cmap_insert(&pre_clone_sessions, &session->cmap_node,
+                    hash_int(session_id, 0));
+    } else {
+        old = ovsrcu_get_protected(struct p4rt_pre_ports *, &session->flat);
+        session->grp_id = grp_id;
+        session->has_grp = has_grp;
+        ovsrcu_set(&session->flat, flat);
+        ovsrcu_postpone(free, old);
+    }
+    ovs_mutex_unlock(&pre_mutex);
+
+    return 0;
+}
+
+int
+p4rt_pre_clone_session_reset(uint32_t session_id)
+{
+    struct pre_clone_session *session;
+
+    ovs_mutex_lock(&pre_mutex);
+    session = pre_clone_session_find(session_id);
+    if (!session) {
+        ovs_mutex_unlock(&pre_mutex);
+        return ENOENT;
+    }
+
+    cmap_remove(&pre_clone_sessions, &session->cmap_node,
+                hash_int(session_id, 0));
+    ovsrcu_postpone(free,
+                    ovsrcu_get_protected(struct p4rt_pre_ports *,
+                                         &session->flat));
+    ovsrcu_postpone(free, session);
+    ovs_mutex_unlock(&pre_mutex);
+
+    return 0;
+}
+
+/* Returns the egress list that clone session 'session_id' currently
+ * mirrors to, or NULL if the session does not exist.  Same RCU lifetime
+ * rules as p4rt_pre_group_lookup(). */
+const struct p4rt_pre_ports *
+p4rt_pre_clone_session_lookup(uint32_t session_id)
+{
+    struct pre_clone_session *session = pre_clone_session_find(session_id);
+
+    if (!session) {
+        return NULL;
+    }
+    return session->has_grp
+           ? p4rt_pre_group_lookup(session->grp_id)
+           : ovsrcu_get(struct p4rt_pre_ports *, &session->flat);
+}
@@ -0,0 +1,60 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef P4RT_PRE_H
+#define P4RT_PRE_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* P4 packet replication engine (PRE).
+ *
+ * Holds the multicast group tables programmed through P4Runtime: a group
+ * is a set of replication nodes, a node is a replication id plus a list
+ * of egress ports.  Writers (the PI frontend) mutate groups and nodes
+ * under a mutex; each mutation recompiles the group's full egress port
+ * list into an immutable flat array that PMD threads read via RCU, so a
+ * packet replication costs one lookup and no locks. */
+
+/* Flattened egress list of one multicast group.  Immutable once
+ * published; replaced wholesale when the group changes. */
+struct p4rt_pre_ports {
+    size_t n_ports;
+    uint32_t ports[];
+};
+
+uint32_t p4rt_pre_group_create(uint32_t grp_id);
+int p4rt_pre_group_delete(uint32_t grp_handle);
+
+int p4rt_pre_node_create(uint16_t rid, size_t n_ports, const uint32_t *ports,
+                         uint32_t *node_handle);
+int p4rt_pre_node_modify(uint32_t node_handle, size_t n_ports,
+                         const uint32_t *ports);
+int p4rt_pre_node_delete(uint32_t node_handle);
+
+int p4rt_pre_group_attach(uint32_t grp_handle, uint32_t node_handle);
+int p4rt_pre_group_detach(uint32_t grp_handle, uint32_t node_handle);
+
+const struct p4rt_pre_ports *p4rt_pre_group_lookup(uint32_t grp_id);
+
+/* Clone sessions.  A session mirrors packets either to one egress port
+ * or to an existing multicast group. */
+int p4rt_pre_clone_session_set(uint32_t session_id, bool has_port,
+                               uint32_t port, bool has_grp, uint32_t grp_id);
+int p4rt_pre_clone_session_reset(uint32_t session_id);
+
+const struct p4rt_pre_ports *p4rt_pre_clone_session_lookup(uint32_t session_id);
+
+#endif /* p4rt-pre.h */
@@ -37,12 +37,21 @@ VLOG_DEFINE_THIS_MODULE(poll_loop);
 
 COVERAGE_DEFINE(poll_create_node);
 COVERAGE_DEFINE(poll_zero_timeout);
+COVERAGE_DEFINE(poll_wake_critical);
+COVERAGE_DEFINE(poll_wake_background);
+COVERAGE_DEFINE(poll_critical_starvation);
+
+/* A critical waiter found already ready after the caller spent longer than
+ * this processing the previous iteration, in milliseconds, is counted as
+ * starved. */
+#define POLL_STARVATION_THRESHOLD_MSEC 100
 
 struct poll_node {
     struct hmap_node hmap_node;
     struct pollfd pollfd;       /* Events to pass to time_poll(). */
     HANDLE wevent;              /* Events for WaitForMultipleObjects(). */
     const char *where;          /* Where poll_node was created. */
+    enum poll_wait_class class; /* Scheduling class of the waiter. */
 };
 
 struct poll_loop {
@@ -53,6 +62,19 @@ struct poll_loop {
      * wake up immediately, or LLONG_MAX to wait forever. */
     long long int timeout_when; /* In msecs as returned by time_msec(). */
     const char *timeout_where;  /* Where 'timeout_when' was set. */
+    enum poll_wait_class timeout_class; /* Class that set 'timeout_when'. */
+
+    /* Scheduling class applied to events registered from now on. */
+    enum poll_wait_class wait_class;
+
+    /* Most critical class among the events that caused the last
+     * poll_block() to wake up. */
+    enum poll_wait_class woke_class;
+
+    /* When the last poll_block() returned, or LLONG_MIN before the first
+     * call.  Used to measure how long the caller processed between
+     * blocks. */
+    long long int last_return;
 };
 
 static struct poll_loop *poll_loop(void);
@@ -110,10 +132,12 @@ poll_create_node(int fd, HANDLE wevent, short int events, const char *where)
     /* Both 'fd' and 'wevent' cannot be set. */
     ovs_assert(!fd != !wevent);
 
-    /* Check for duplicate.  If found, "or" the events. */
+    /* Check for duplicate.  If found, "or" the events and keep the more
+     * critical class. */
     node = find_poll_node(loop, fd, wevent);
     if (node) {
         node->pollfd.events |= events;
+        node->class = MIN(node->class, loop->wait_class);
     } else {
         node = xzalloc(sizeof *node);
         hmap_insert(&loop->poll_nodes, &node->hmap_node,
@@ -127,6 +151,7 @@ poll_create_node(int fd, HANDLE wevent, short int events, const char *where)
 #endif
         node->wevent = wevent;
         node->where = where;
+        node->class = loop->wait_class;
     }
 }
 
@@ -217,9 +242,32 @@ poll_timer_wait_until_at(long long int when, const char *where)
     if (when < loop->timeout_when) {
         loop->timeout_when = when;
         loop->timeout_where = where;
+        loop->timeout_class = loop->wait_class;
     }
 }
 
+/* Sets the scheduling class tagged onto events registered with this thread's
+ * poll loop from now on.  The class is sticky across registrations but
+ * resets to POLL_WAIT_DEFAULT when poll_block() returns, so a main loop
+ * typically brackets each subordinate module's "wait" call with the class
+ * its work deserves. */
+void
+poll_set_wait_class(enum poll_wait_class class)
+{
+    ovs_assert(class < POLL_N_WAIT_CLASSES);
+    poll_loop()->wait_class = class;
+}
+
+/* Returns the most critical scheduling class among the events that caused
+ * the last poll_block() to wake up, or POLL_WAIT_DEFAULT before the first
+ * call.  A main loop may use this to defer housekeeping while
+ * datapath-critical waiters are the ones demanding service. */
+enum poll_wait_class
+poll_woke_class(void)
+{
+    return poll_loop()->woke_class;
+}
+
 /* Causes the following call to poll_block() to wake up immediately, without
  * blocking.
  *
@@ -319,9 +367,11 @@ void
 poll_block(void)
 {
     struct poll_loop *loop = poll_loop();
+    enum poll_wait_class woke_class;
     struct poll_node *node;
     struct pollfd *pollfds;
     HANDLE *wevents = NULL;
+    long long int busy;
     int elapsed;
     int retval;
     int i;
@@ -361,26 +411,66 @@ poll_block(void)
         i++;
     }
 
+    /* Time the caller spent processing since the previous poll_block()
+     * returned. */
+    busy = (loop->last_return != LLONG_MIN
+            ? time_msec() - loop->last_return : 0);
+
     retval = time_poll(pollfds, hmap_count(&loop->poll_nodes), wevents,
                        loop->timeout_when, &elapsed);
+    woke_class = POLL_WAIT_DEFAULT;
     if (retval < 0) {
         static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
         VLOG_ERR_RL(&rl, "poll: %s", ovs_strerror(-retval));
     } else if (!retval) {
+        woke_class = loop->timeout_class;
         log_wakeup(loop->timeout_where, NULL, elapsed);
-    } else if (get_cpu_usage() > 50 || VLOG_IS_DBG_ENABLED()) {
+    } else {
+        bool log_details = get_cpu_usage() > 50 || VLOG_IS_DBG_ENABLED();
+        const char *critical_where = NULL;
+
+        woke_class = POLL_N_WAIT_CLASSES;
         i = 0;
         HMAP_FOR_EACH (node, hmap_node, &loop->poll_nodes) {
             if (pollfds[i].revents) {
-                log_wakeup(node->where, &pollfds[i], 0);
+                if (node->class < woke_class) {
+                    woke_class = node->class;
+                    critical_where = node->where;
+                }
+                if (log_details) {
+                    log_wakeup(node->where, &pollfds[i], 0);
+                }
             }
             i++;
         }
+
+        /* A critical waiter that is already ready when the loop re-enters
+         * poll after a long processing burst sat unserviced for that whole
+         * burst. */
+        if (woke_class == POLL_WAIT_CRITICAL && !elapsed
+            && busy > POLL_STARVATION_THRESHOLD_MSEC) {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 60);
+
+            COVERAGE_INC(poll_critical_starvation);
+            VLOG_WARN_RL(&rl, "critical poll waiter (%s) starved for "
+                         "%lld ms by other main loop work",
+                         critical_where ? critical_where : "?", busy);
+        }
+    }
+    if (woke_class == POLL_WAIT_CRITICAL) {
+        COVERAGE_INC(poll_wake_critical);
+    } else if (woke_class == POLL_WAIT_BACKGROUND) {
+        COVERAGE_INC(poll_wake_background);
     }
+    loop->woke_class = (woke_class < POLL_N_WAIT_CLASSES
+                        ? woke_class : POLL_WAIT_DEFAULT);
 
     free_poll_nodes(loop);
     loop->timeout_when = LLONG_MAX;
     loop->timeout_where = NULL;
+    loop->timeout_class = POLL_WAIT_DEFAULT;
+    loop->wait_class = POLL_WAIT_DEFAULT;
+    loop->last_return = time_msec();
     free(pollfds);
     free(wevents);
 
@@ -416,6 +506,10 @@ poll_loop(void)
     if (!loop) {
         loop = xzalloc(sizeof *loop);
         loop->timeout_when = LLONG_MAX;
+        loop->timeout_class = POLL_WAIT_DEFAULT;
+        loop->wait_class = POLL_WAIT_DEFAULT;
+        loop->woke_class = POLL_WAIT_DEFAULT;
+        loop->last_return = LLONG_MIN;
         hmap_init(&loop->poll_nodes);
         xpthread_setspecific(key, loop);
     }
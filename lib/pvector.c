@@ -202,6 +202,58 @@ pvector_change_priority(struct pvector *pvec, void *ptr, int priority)
     old->vector[index].priority = priority;
 }
 
+/* Recomputes each published entry's priority and nudges the vector towards
+ * sorted order in place.
+ *
+ * For each entry, 'compute_priority' (if nonnull) is called with the
+ * entry's pointer and current priority to obtain a fresh priority.  Then a
+ * single adjacent-swap pass moves every entry whose priority now exceeds
+ * its predecessor's one step forward.  Repeated calls converge on a fully
+ * sorted vector while bounding the work done by any one call, and no copy
+ * of the vector is allocated or published.
+ *
+ * This walks and modifies the published vector directly, so the caller
+ * must exclude concurrent writers and must be the only concurrent reader:
+ * a swap momentarily duplicates one entry and hides another from anybody
+ * else iterating at the same time.  Any changes staged in 'temp' are
+ * unaffected and override these priorities when published.
+ *
+ * Returns true if no swaps were needed, i.e., the vector was already in
+ * priority order. */
+bool
+pvector_reprioritize(struct pvector *pvec,
+                     int (*compute_priority)(void *ptr, int priority,
+                                             void *aux),
+                     void *aux)
+{
+    struct pvector_impl *impl = pvector_impl_get(pvec);
+    bool sorted = true;
+    size_t size;
+    size_t i;
+
+    atomic_read_relaxed(&impl->size, &size);
+
+    if (compute_priority) {
+        for (i = 0; i < size; i++) {
+            impl->vector[i].priority
+                = compute_priority(impl->vector[i].ptr,
+                                   impl->vector[i].priority, aux);
+        }
+    }
+
+    for (i = 1; i < size; i++) {
+        if (impl->vector[i].priority > impl->vector[i - 1].priority) {
+            struct pvector_entry tmp = impl->vector[i - 1];
+
+            impl->vector[i - 1] = impl->vector[i];
+            impl->vector[i] = tmp;
+            sorted = false;
+        }
+    }
+
+    return sorted;
+}
+
 /* Make the modified pvector available for iteration. */
 void pvector_publish__(struct pvector *pvec)
 {
@@ -91,6 +91,13 @@ void pvector_insert(struct pvector *, void *, int priority);
 void pvector_change_priority(struct pvector *, void *, int priority);
 void pvector_remove(struct pvector *, void *);
 
+/* In-place incremental priority maintenance.  Requires the caller to be
+ * the only concurrent reader and to exclude writers; see pvector.c. */
+bool pvector_reprioritize(struct pvector *,
+                          int (*compute_priority)(void *ptr, int priority,
+                                                  void *aux),
+                          void *aux);
+
 /* Make the modified pvector available for iteration. */
 static inline void pvector_publish(struct pvector *);
 
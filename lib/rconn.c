@@ -539,6 +539,12 @@ do_tx_work(struct rconn *rc)
         }
         rc->last_activity = time_msec();
     }
+    /* Messages that vconn_send() accepted may have been coalesced inside the
+     * vconn instead of written out.  Give the vconn a chance to flush them
+     * now rather than waiting for the next rconn_run(). */
+    if (rc->vconn) {
+        vconn_run(rc->vconn);
+    }
     if (ovs_list_is_empty(&rc->txq)) {
         poll_immediate_wake();
     }
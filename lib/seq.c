@@ -25,14 +25,25 @@
 #include "openvswitch/hmap.h"
 #include "latch.h"
 #include "openvswitch/list.h"
+#include "ovs-atomic.h"
 #include "ovs-thread.h"
 #include "openvswitch/poll-loop.h"
 
 COVERAGE_DEFINE(seq_change);
 
-/* A sequence number object. */
+/* A sequence number object.
+ *
+ * 'value' is read and written atomically, so that seq_read() and the common
+ * case of seq_change(), where no thread is waiting, take no lock at all.
+ * 'has_waiters' tells a changer whether it must take 'seq_mutex' to hand out
+ * wakeups; it is set (under 'seq_mutex') before a waiter's deciding read of
+ * 'value' and read (without the mutex) after a changer's write of 'value',
+ * with seq_cst ordering on all four accesses, so that at least one of the two
+ * threads is guaranteed to see the other's store and no wakeup can be
+ * lost. */
 struct seq {
-    uint64_t value OVS_GUARDED;
+    atomic_uint64_t value;
+    atomic_bool has_waiters;         /* Is 'waiters' nonempty? */
     struct hmap waiters OVS_GUARDED; /* Contains 'struct seq_waiter's. */
 };
 
@@ -57,7 +68,7 @@ struct seq_thread {
 
 static struct ovs_mutex seq_mutex = OVS_MUTEX_INITIALIZER;
 
-static uint64_t seq_next OVS_GUARDED_BY(seq_mutex) = 1;
+static atomic_uint64_t seq_next = ATOMIC_VAR_INIT(UINT64_C(1));
 
 static pthread_key_t seq_thread_key;
 
@@ -69,9 +80,10 @@ static void seq_waiter_destroy(struct seq_waiter *) OVS_REQUIRES(seq_mutex);
 static void seq_wake_waiters(struct seq *) OVS_REQUIRES(seq_mutex);
 
 /* Creates and returns a new 'seq' object. */
-struct seq * OVS_EXCLUDED(seq_mutex)
+struct seq *
 seq_create(void)
 {
+    uint64_t value;
     struct seq *seq;
 
     seq_init();
@@ -80,10 +92,16 @@ seq_create(void)
 
     COVERAGE_INC(seq_change);
 
-    ovs_mutex_lock(&seq_mutex);
-    seq->value = seq_next++;
+    /* Seed each seq from a shared counter so that a new seq never starts over
+     * at a value that an observer might have recorded from a previous seq at
+     * the same address.  After creation, each seq counts up independently:
+     * values need to be unique and monotonic only within a single seq (see
+     * ovsrcu_synchronize() for a user that relies on monotonicity). */
+    atomic_add_explicit(&seq_next, UINT64_C(1) << 32, &value,
+                        memory_order_relaxed);
+    atomic_init(&seq->value, value);
+    atomic_init(&seq->has_waiters, false);
     hmap_init(&seq->waiters);
-    ovs_mutex_unlock(&seq_mutex);
 
     return seq;
 }
@@ -126,21 +144,40 @@ void
 seq_change_protected(struct seq *seq)
     OVS_REQUIRES(seq_mutex)
 {
+    uint64_t value;
+
     COVERAGE_INC(seq_change);
 
-    seq->value = seq_next++;
+    atomic_add_explicit(&seq->value, 1, &value, memory_order_seq_cst);
     seq_wake_waiters(seq);
 }
 
 /* Increments 'seq''s sequence number, waking up any threads that are waiting
- * on 'seq'. */
+ * on 'seq'.
+ *
+ * When no thread is waiting on 'seq', this is a single atomic update and a
+ * flag check, without taking any lock. */
 void
 seq_change(struct seq *seq)
     OVS_EXCLUDED(seq_mutex)
 {
-    ovs_mutex_lock(&seq_mutex);
-    seq_change_protected(seq);
-    ovs_mutex_unlock(&seq_mutex);
+    bool has_waiters;
+    uint64_t value;
+
+    COVERAGE_INC(seq_change);
+
+    /* The seq_cst increment and load below pair with seq_wait_at(): a waiter
+     * publishes 'has_waiters' before its deciding read of 'value', so either
+     * we observe the waiter here or the waiter observes our new value and
+     * does not go to sleep on the old one. */
+    atomic_add_explicit(&seq->value, 1, &value, memory_order_seq_cst);
+    atomic_read_explicit(&seq->has_waiters, &has_waiters,
+                         memory_order_seq_cst);
+    if (has_waiters) {
+        ovs_mutex_lock(&seq_mutex);
+        seq_wake_waiters(seq);
+        ovs_mutex_unlock(&seq_mutex);
+    }
 }
 
 /* Returns 'seq''s current sequence number (which could change immediately).
@@ -152,7 +189,7 @@ uint64_t
 seq_read_protected(const struct seq *seq)
     OVS_REQUIRES(seq_mutex)
 {
-    return seq->value;
+    return seq_read(seq);
 }
 
 /* Returns 'seq''s current sequence number (which could change immediately).
@@ -161,14 +198,15 @@ seq_read_protected(const struct seq *seq)
  * when an object changes, even without an ability to lock the object.  See
  * Usage in seq.h for details. */
 uint64_t
-seq_read(const struct seq *seq)
-    OVS_EXCLUDED(seq_mutex)
+seq_read(const struct seq *seq_)
 {
+    struct seq *seq = CONST_CAST(struct seq *, seq_);
     uint64_t value;
 
-    ovs_mutex_lock(&seq_mutex);
-    value = seq_read_protected(seq);
-    ovs_mutex_unlock(&seq_mutex);
+    /* Acquire ordering pairs with the store in seq_change(), so that all
+     * effects of memory accesses made before that seq_change() are visible
+     * to a reader that observes the new value. */
+    atomic_read_explicit(&seq->value, &value, memory_order_acquire);
 
     return value;
 }
@@ -224,11 +262,22 @@ seq_wait_at(const struct seq *seq_, uint64_t value, const char *where)
     OVS_EXCLUDED(seq_mutex)
 {
     struct seq *seq = CONST_CAST(struct seq *, seq_);
+    uint64_t current;
 
     ovs_mutex_lock(&seq_mutex);
-    if (value == seq->value) {
+
+    /* Publish our intent to wait before the deciding read of 'value'.  This
+     * pairs with the seq_cst accesses in seq_change(): a changer that misses
+     * 'has_waiters' must have stored its new value before our read below, so
+     * we notice the change and do not go to sleep on a stale value. */
+    atomic_store_explicit(&seq->has_waiters, true, memory_order_seq_cst);
+    atomic_read_explicit(&seq->value, &current, memory_order_seq_cst);
+    if (value == current) {
         seq_wait__(seq, value, where);
     } else {
+        if (hmap_is_empty(&seq->waiters)) {
+            atomic_store_relaxed(&seq->has_waiters, false);
+        }
         poll_immediate_wake_at(where);
     }
     ovs_mutex_unlock(&seq_mutex);
@@ -310,9 +359,15 @@ static void
 seq_waiter_destroy(struct seq_waiter *waiter)
     OVS_REQUIRES(seq_mutex)
 {
-    hmap_remove(&waiter->seq->waiters, &waiter->hmap_node);
+    struct seq *seq = waiter->seq;
+
+    hmap_remove(&seq->waiters, &waiter->hmap_node);
     ovs_list_remove(&waiter->list_node);
     free(waiter);
+
+    if (hmap_is_empty(&seq->waiters)) {
+        atomic_store_relaxed(&seq->has_waiters, false);
+    }
 }
 
 static void
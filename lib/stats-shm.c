@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2020 Open vSwitch contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include "stats-shm.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dirs.h"
+#include "openvswitch/vlog.h"
+#include "ovs-atomic.h"
+#include "ovs-thread.h"
+#include "timeval.h"
+#include "util.h"
+
+VLOG_DEFINE_THIS_MODULE(stats_shm);
+
+/* The mapped segment, or NULL when the export is disabled. */
+static struct stats_shm *shm;
+
+/* Serializes slot claiming; publication itself is lock-free. */
+static struct ovs_mutex shm_mutex = OVS_MUTEX_INITIALIZER;
+
+/* Seqlock write side.  The fences pair with the retry loop of an external
+ * reader: no payload store may be observed outside the odd window. */
+static void
+seq_write_begin(volatile uint32_t *seq)
+{
+    ++*seq;                     /* Now odd. */
+    atomic_thread_fence(memory_order_release);
+}
+
+static void
+seq_write_end(volatile uint32_t *seq)
+{
+    atomic_thread_fence(memory_order_release);
+    ++*seq;                     /* Even again. */
+}
+
+/* Creates and maps the statistics segment.  Failure only costs the export:
+ * the daemon keeps running without it. */
+void
+stats_shm_enable(void)
+{
+#ifndef _WIN32
+    char *path;
+    int fd;
+    size_t i;
+
+    if (shm) {
+        return;
+    }
+
+    path = xasprintf("%s/%s.stats", ovs_rundir(), program_name);
+    fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        VLOG_WARN("%s: create failed (%s)", path, ovs_strerror(errno));
+        free(path);
+        return;
+    }
+    if (ftruncate(fd, sizeof *shm)
+        || (shm = mmap(NULL, sizeof *shm, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        VLOG_WARN("%s: map failed (%s)", path, ovs_strerror(errno));
+        shm = NULL;
+        close(fd);
+        free(path);
+        return;
+    }
+    close(fd);
+
+    memset(shm, 0, sizeof *shm);
+    for (i = 0; i < STATS_SHM_MAX_PMDS; i++) {
+        shm->pmds[i].core_id = UINT32_MAX;
+    }
+    shm->header.version = STATS_SHM_VERSION;
+    shm->header.size = sizeof *shm;
+    shm->header.n_pmd_slots = STATS_SHM_MAX_PMDS;
+    atomic_thread_fence(memory_order_release);
+    shm->header.magic = STATS_SHM_MAGIC;    /* Segment is now valid. */
+
+    VLOG_INFO("exporting statistics to %s", path);
+    free(path);
+#endif
+}
+
+bool
+stats_shm_is_enabled(void)
+{
+    return shm != NULL;
+}
+
+/* Returns the slot publishing for 'core_id', claiming a free one on first
+ * use.  Claims are rare, so the linear scans do not matter. */
+static struct stats_shm_pmd *
+stats_shm_pmd_slot(unsigned core_id)
+{
+    struct stats_shm_pmd *slot = NULL;
+    size_t i;
+
+    for (i = 0; i < STATS_SHM_MAX_PMDS; i++) {
+        if (shm->pmds[i].core_id == core_id) {
+            return &shm->pmds[i];
+        }
+    }
+
+    ovs_mutex_lock(&shm_mutex);
+    for (i = 0; i < STATS_SHM_MAX_PMDS; i++) {
+        if (shm->pmds[i].core_id == core_id) {
+            slot = &shm->pmds[i];
+            break;
+        } else if (!slot && shm->pmds[i].core_id == UINT32_MAX) {
+            slot = &shm->pmds[i];
+        }
+    }
+    if (slot && slot->core_id != core_id) {
+        seq_write_begin(&slot->seq);
+        slot->core_id = core_id;
+        memset(slot->stats, 0, sizeof slot->stats);
+        seq_write_end(&slot->seq);
+    }
+    ovs_mutex_unlock(&shm_mutex);
+
+    return slot;
+}
+
+/* Publishes 'n' counters for the PMD on 'core_id'.  Called by the PMD
+ * thread itself, off the per-packet path. */
+void
+stats_shm_publish_pmd(unsigned core_id, const uint64_t *stats, size_t n)
+{
+    struct stats_shm_pmd *slot;
+
+    if (!shm) {
+        return;
+    }
+    slot = stats_shm_pmd_slot(core_id);
+    if (!slot) {
+        return;                 /* More PMDs than slots. */
+    }
+
+    n = MIN(n, STATS_SHM_PMD_N_STATS);
+    seq_write_begin(&slot->seq);
+    slot->updated_ms = time_wall_msec();
+    memcpy(slot->stats, stats, n * sizeof *stats);
+    seq_write_end(&slot->seq);
+}
+
+/* Releases the slot of a PMD that is going away. */
+void
+stats_shm_retire_pmd(unsigned core_id)
+{
+    size_t i;
+
+    if (!shm) {
+        return;
+    }
+    ovs_mutex_lock(&shm_mutex);
+    for (i = 0; i < STATS_SHM_MAX_PMDS; i++) {
+        struct stats_shm_pmd *slot = &shm->pmds[i];
+
+        if (slot->core_id == core_id) {
+            seq_write_begin(&slot->seq);
+            slot->core_id = UINT32_MAX;
+            seq_write_end(&slot->seq);
+            break;
+        }
+    }
+    ovs_mutex_unlock(&shm_mutex);
+}
+
+/* Opens the coverage array for writing and returns it, or NULL when the
+ * export is disabled.  The caller fills up to STATS_SHM_MAX_COVERAGE
+ * entries and must then call stats_shm_coverage_commit().  Publication is
+ * serialized by the caller (coverage_mutex). */
+struct stats_shm_coverage *
+stats_shm_coverage_start(void)
+{
+    if (!shm) {
+        return NULL;
+    }
+    seq_write_begin(&shm->header.coverage_seq);
+    return shm->coverage;
+}
+
+void
+stats_shm_coverage_commit(size_t n)
+{
+    shm->header.n_coverage = MIN(n, STATS_SHM_MAX_COVERAGE);
+    seq_write_end(&shm->header.coverage_seq);
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2020 Open vSwitch contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STATS_SHM_H
+#define STATS_SHM_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Shared-memory statistics export.
+ *
+ * When enabled (ovs-vswitchd does so at startup), selected counters are
+ * mirrored into "<rundir>/<program>.stats", a plain file that a telemetry
+ * agent can mmap read-only and poll without unixctl round trips and
+ * without taking any time from the switch.
+ *
+ * Every record carries a sequence counter: the writer bumps it to an odd
+ * value before touching the payload and back to an even value afterwards,
+ * so a reader must retry if it sees an odd value or if the value changed
+ * while it was copying the payload.  All fields hold host-endian values.
+ * 'magic' is written last during initialization; a reader should ignore
+ * the segment until it matches and 'version' is one it understands. */
+
+#define STATS_SHM_MAGIC    0x5353564f   /* "OVSS". */
+#define STATS_SHM_VERSION  1
+
+#define STATS_SHM_MAX_PMDS      64
+#define STATS_SHM_MAX_COVERAGE  768
+#define STATS_SHM_NAME_LEN      48
+#define STATS_SHM_PMD_N_STATS   32
+
+/* Per-PMD counters, filled from the pmd_stat_type values of
+ * lib/dpif-netdev-perf.h in enum order. */
+struct stats_shm_pmd {
+    uint32_t seq;
+    uint32_t core_id;            /* UINT32_MAX while the slot is unused. */
+    uint64_t updated_ms;         /* Wall clock of the last update. */
+    uint64_t stats[STATS_SHM_PMD_N_STATS];
+};
+
+struct stats_shm_coverage {
+    char name[STATS_SHM_NAME_LEN];
+    uint64_t total;
+};
+
+struct stats_shm_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;               /* Total segment size in bytes. */
+    uint32_t n_pmd_slots;        /* Capacity of 'pmds'. */
+    uint32_t coverage_seq;       /* Seqlock over 'n_coverage' + 'coverage'. */
+    uint32_t n_coverage;         /* Valid entries in 'coverage'. */
+};
+
+struct stats_shm {
+    struct stats_shm_header header;
+    struct stats_shm_pmd pmds[STATS_SHM_MAX_PMDS];
+    struct stats_shm_coverage coverage[STATS_SHM_MAX_COVERAGE];
+};
+
+/* Writer interface.  All functions are no-ops until stats_shm_enable()
+ * has been called (only daemons that want the export do so). */
+void stats_shm_enable(void);
+bool stats_shm_is_enabled(void);
+
+void stats_shm_publish_pmd(unsigned core_id, const uint64_t *stats, size_t n);
+void stats_shm_retire_pmd(unsigned core_id);
+
+struct stats_shm_coverage *stats_shm_coverage_start(void);
+void stats_shm_coverage_commit(size_t n);
+
+#endif /* stats-shm.h */
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2020 Open vSwitch contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <config.h>
+
+#include "sticky-table.h"
+
+#include "cmap.h"
+#include "coverage.h"
+#include "hash.h"
+#include "ovs-atomic.h"
+#include "ovs-rcu.h"
+#include "ovs-thread.h"
+#include "timeval.h"
+#include "util.h"
+
+COVERAGE_DEFINE(sticky_table_full);
+
+/* Upper bound on entries per table, so a scanning client cannot grow a
+ * table without limit.  Learns beyond this fail until entries expire. */
+#define STICKY_TABLE_MAX_ENTRIES (1u << 17)
+
+/* How often, at most, the learn path sweeps a table for expired entries.
+ * Expired entries are invisible to lookups as soon as they expire; the
+ * sweep only reclaims their memory. */
+#define STICKY_SWEEP_INTERVAL_MSEC 1000
+
+struct sticky_entry {
+    struct cmap_node node;      /* In 'table''s 'entries'. */
+    ovs_u128 key;
+    ATOMIC(uint32_t) value;
+    atomic_llong expires;       /* time_msec() past which this is a miss. */
+};
+
+struct sticky_table {
+    struct cmap_node node;      /* In 'sticky_tables', by hash of 'id'. */
+    uint32_t id;
+    struct cmap entries;
+    struct ovs_mutex mutex;     /* Serializes insertions and sweeps. */
+    long long int next_sweep OVS_GUARDED;
+};
+
+static struct cmap sticky_tables = CMAP_INITIALIZER;
+static struct ovs_mutex sticky_tables_mutex = OVS_MUTEX_INITIALIZER;
+
+static uint32_t
+sticky_key_hash(const ovs_u128 *key)
+{
+    return hash_bytes(key, sizeof *key, 0);
+}
+
+static struct sticky_table *
+sticky_table_find(uint32_t table_id)
+{
+    struct sticky_table *table;
+
+    CMAP_FOR_EACH_WITH_HASH (table, node, hash_int(table_id, 0),
+                             &sticky_tables) {
+        if (table->id == table_id) {
+            return table;
+        }
+    }
+    return NULL;
+}
+
+/* Returns the table with the given 'table_id', creating it if it does not
+ * exist yet.  Tables are never destroyed: their number is bounded by the
+ * distinct ids the installed pipelines use. */
+static struct sticky_table *
+sticky_table_get(uint32_t table_id)
+{
+    struct sticky_table *table = sticky_table_find(table_id);
+
+    if (OVS_LIKELY(table)) {
+        return table;
+    }
+
+    ovs_mutex_lock(&sticky_tables_mutex);
+    table = sticky_table_find(table_id);
+    if (!table) {
+        table = xzalloc(sizeof *table);
+        table->id = table_id;
+        cmap_init(&table->entries);
+        ovs_mutex_init(&table->mutex);
+        cmap_insert(&sticky_tables, &table->node, hash_int(table_id, 0));
+    }
+    ovs_mutex_unlock(&sticky_tables_mutex);
+
+    return table;
+}
+
+static struct sticky_entry *
+sticky_entry_find(const struct sticky_table *table, const ovs_u128 *key)
+{
+    struct sticky_entry *entry;
+
+    CMAP_FOR_EACH_WITH_HASH (entry, node, sticky_key_hash(key),
+                             &table->entries) {
+        if (ovs_u128_equals(entry->key, *key)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void
+sticky_table_sweep(struct sticky_table *table, long long int now)
+    OVS_REQUIRES(table->mutex)
+{
+    struct sticky_entry *entry;
+
+    CMAP_FOR_EACH (entry, node, &table->entries) {
+        long long int expires;
+
+        atomic_read_relaxed(&entry->expires, &expires);
+        if (now > expires) {
+            cmap_remove(&table->entries, &entry->node,
+                        sticky_key_hash(&entry->key));
+            ovsrcu_postpone(free, entry);
+        }
+    }
+}
+
+/* Learns 'key' -> 'value' in the table with the given 'table_id', creating
+ * the table if necessary.  The entry expires 'ttl_ms' milliseconds from
+ * now; learning an existing key updates its value and re-arms its expiry.
+ * Returns false only if the table is full of unexpired entries. */
+bool
+sticky_table_learn(uint32_t table_id, const ovs_u128 *key, uint32_t value,
+                   uint32_t ttl_ms)
+{
+    struct sticky_table *table = sticky_table_get(table_id);
+    long long int now = time_msec();
+    struct sticky_entry *entry;
+
+    entry = sticky_entry_find(table, key);
+    if (OVS_LIKELY(entry)) {
+        atomic_store_relaxed(&entry->value, value);
+        atomic_store_relaxed(&entry->expires, now + ttl_ms);
+        return true;
+    }
+
+    ovs_mutex_lock(&table->mutex);
+    if (now >= table->next_sweep) {
+        sticky_table_sweep(table, now);
+        table->next_sweep = now + STICKY_SWEEP_INTERVAL_MSEC;
+    }
+
+    /* Another thread may have learned 'key' while we were not looking. */
+    entry = sticky_entry_find(table, key);
+    if (entry) {
+        atomic_store_relaxed(&entry->value, value);
+        atomic_store_relaxed(&entry->expires, now + ttl_ms);
+    } else if (cmap_count(&table->entries) >= STICKY_TABLE_MAX_ENTRIES) {
+        COVERAGE_INC(sticky_table_full);
+        ovs_mutex_unlock(&table->mutex);
+        return false;
+    } else {
+        entry = xmalloc(sizeof *entry);
+        entry->key = *key;
+        atomic_init(&entry->value, value);
+        atomic_init(&entry->expires, now + ttl_ms);
+        cmap_insert(&table->entries, &entry->node, sticky_key_hash(key));
+    }
+    ovs_mutex_unlock(&table->mutex);
+
+    return true;
+}
+
+/* If the table with the given 'table_id' holds an unexpired entry for
+ * 'key', stores its value in '*value' and returns true, otherwise returns
+ * false.  A nonzero 'ttl_ms' re-arms a hit entry to expire that many
+ * milliseconds from now, making the entry sticky as long as its client
+ * keeps sending; zero leaves the expiry unchanged.  Lockless. */
+bool
+sticky_table_lookup(uint32_t table_id, const ovs_u128 *key, uint32_t ttl_ms,
+                    uint32_t *value)
+{
+    struct sticky_table *table = sticky_table_find(table_id);
+    long long int now = time_msec();
+    struct sticky_entry *entry;
+    long long int expires;
+
+    if (!table) {
+        return false;
+    }
+
+    entry = sticky_entry_find(table, key);
+    if (!entry) {
+        return false;
+    }
+
+    atomic_read_relaxed(&entry->expires, &expires);
+    if (now > expires) {
+        return false;
+    }
+
+    atomic_read_relaxed(&entry->value, value);
+    if (ttl_ms) {
+        atomic_store_relaxed(&entry->expires, now + ttl_ms);
+    }
+    return true;
+}
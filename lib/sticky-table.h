@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2020 Open vSwitch contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef STICKY_TABLE_H
+#define STICKY_TABLE_H 1
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "openvswitch/types.h"
+
+/* Sticky tables: datapath-native learn tables.
+ *
+ * A sticky table maps an opaque 128-bit key to a 32-bit value with a
+ * per-entry expiry, in the style of a hardware learn table.  Entries are
+ * inserted and refreshed from the packet path, so all operations here are
+ * safe to call concurrently from any number of PMD threads; lookups and
+ * refreshes take no locks.
+ *
+ * Tables are identified by a caller-chosen id and created on first use.
+ * The datapath reaches them through the OVS_ACTION_ATTR_STICKY_* actions
+ * (see odp-execute.c) and P4 programs through the ubpf_sticky_* externs
+ * (see bpf.c); both views of a given id are the same table. */
+
+bool sticky_table_learn(uint32_t table_id, const ovs_u128 *key,
+                        uint32_t value, uint32_t ttl_ms);
+bool sticky_table_lookup(uint32_t table_id, const ovs_u128 *key,
+                         uint32_t ttl_ms, uint32_t *value);
+
+#endif /* sticky-table.h */
@@ -22,6 +22,7 @@
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include "fatal-signal.h"
 #include "openvswitch/poll-loop.h"
@@ -143,6 +144,29 @@ fd_send(struct stream *stream, const void *buffer, size_t n)
     return (retval > 0 ? retval : -EAGAIN);
 }
 
+#ifndef _WIN32
+static ssize_t
+fd_sendv(struct stream *stream, const struct iovec *iov, size_t n_iov)
+{
+    struct stream_fd *s = stream_fd_cast(stream);
+    ssize_t retval;
+
+#ifdef IOV_MAX
+    if (n_iov > IOV_MAX) {
+        n_iov = IOV_MAX;
+    }
+#endif
+    retval = writev(s->fd, iov, n_iov);
+    if (retval < 0) {
+        if (errno != EAGAIN) {
+            VLOG_DBG_RL(&rl, "writev: %s", ovs_strerror(errno));
+        }
+        return -errno;
+    }
+    return (retval > 0 ? retval : -EAGAIN);
+}
+#endif
+
 static void
 fd_wait(struct stream *stream, enum stream_wait_type wait)
 {
@@ -170,6 +194,11 @@ static const struct stream_class stream_fd_class = {
     fd_connect,                 /* connect */
     fd_recv,                    /* recv */
     fd_send,                    /* send */
+#ifndef _WIN32
+    fd_sendv,                   /* sendv */
+#else
+    NULL,                       /* sendv */
+#endif
     NULL,                       /* run */
     NULL,                       /* run_wait */
     fd_wait,                    /* wait */
@@ -109,6 +109,17 @@ struct stream_class {
      * accepted for transmission, it should return -EAGAIN immediately. */
     ssize_t (*send)(struct stream *stream, const void *buffer, size_t n);
 
+    /* Tries to send the 'n_iov' buffers of 'iov' on 'stream', as if by a
+     * single call to the send function on their concatenation, and returns
+     * the total number of bytes sent (at least 1, but possibly short, even
+     * partway through a buffer) or a negative errno value.
+     *
+     * Optional scatter/gather fast path, so that a queue of small messages
+     * can leave in one system call.  May be null, in which case callers fall
+     * back to the send function. */
+    ssize_t (*sendv)(struct stream *stream, const struct iovec *iov,
+                     size_t n_iov);
+
     /* Allows 'stream' to perform maintenance activities, such as flushing
      * output buffers.
      *
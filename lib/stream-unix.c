@@ -70,6 +70,7 @@ const struct stream_class unix_stream_class = {
     NULL,                       /* connect */
     NULL,                       /* recv */
     NULL,                       /* send */
+    NULL,                       /* sendv */
     NULL,                       /* run */
     NULL,                       /* run_wait */
     NULL,                       /* wait */
@@ -371,6 +371,7 @@ const struct stream_class windows_stream_class = {
     windows_connect,            /* connect */
     windows_recv,               /* recv */
     windows_send,               /* send */
+    NULL,                       /* sendv */
     NULL,                       /* run */
     NULL,                       /* run_wait */
     windows_wait,               /* wait */
@@ -19,6 +19,7 @@
 #include <errno.h>
 #include <inttypes.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <poll.h>
 #include <stdlib.h>
@@ -390,6 +391,35 @@ stream_send(struct stream *stream, const void *buffer, size_t n)
             : (stream->class->send)(stream, buffer, n));
 }
 
+/* Tries to send the 'n_iov' buffers of 'iov' on 'stream', gathering them into
+ * as few system calls as the stream class allows, and returns:
+ *
+ *     - If successful, the total number of bytes sent, which may fall short
+ *       of the total even partway through a buffer.  0 is only a valid
+ *       return value if 'n_iov' is 0.
+ *
+ *     - On error, a negative errno value.
+ *
+ * Like stream_send(), this will not block; it returns -EAGAIN if no bytes
+ * can be immediately accepted for transmission. */
+int
+stream_sendv(struct stream *stream, const struct iovec *iov, size_t n_iov)
+{
+    int retval = stream_connect(stream);
+
+    if (retval) {
+        return -retval;
+    } else if (!n_iov) {
+        return 0;
+    } else if (stream->class->sendv) {
+        return (stream->class->sendv)(stream, iov, n_iov);
+    } else {
+        /* No scatter/gather support: send the first buffer.  A short write
+         * is valid, so the caller will come back for the rest. */
+        return (stream->class->send)(stream, iov[0].iov_base, iov[0].iov_len);
+    }
+}
+
 /* Allows 'stream' to perform maintenance activities, such as flushing
  * output buffers. */
 void
@@ -25,6 +25,7 @@
 #include "socket-util.h"
 #include "util.h"
 
+struct iovec;
 struct pstream;
 struct stream;
 struct vlog_module;
@@ -40,6 +41,7 @@ const char *stream_get_name(const struct stream *);
 int stream_connect(struct stream *);
 int stream_recv(struct stream *, void *buffer, size_t n);
 int stream_send(struct stream *, const void *buffer, size_t n);
+int stream_sendv(struct stream *, const struct iovec *iov, size_t n_iov);
 
 void stream_run(struct stream *);
 void stream_run_wait(struct stream *);
@@ -1889,6 +1889,48 @@ tc_del_filter(struct tcf_id *id)
     return tc_transact(&request, NULL);
 }
 
+/* Deletes the 'n' filters in 'ids' as a single pipelined netlink batch
+ * instead of one synchronous round trip per filter.  The kernel still
+ * acknowledges every message, but the requests are written out and the
+ * acknowledgements collected in bulk, which is considerably cheaper when
+ * rules churn in large numbers.
+ *
+ * Stores each filter's own result in 'errors' and returns 0 if all
+ * deletions succeeded, otherwise the first error encountered. */
+int
+tc_del_filters(struct tcf_id **ids, int *errors, int n)
+{
+    struct nl_transaction *txns = xmalloc(n * sizeof *txns);
+    struct nl_transaction **txnps = xmalloc(n * sizeof *txnps);
+    struct ofpbuf *requests = xmalloc(n * sizeof *requests);
+    int error = 0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        request_from_tcf_id(ids[i], 0, RTM_DELTFILTER, NLM_F_ACK,
+                            &requests[i]);
+        txns[i].request = &requests[i];
+        txns[i].reply = NULL;
+        txnps[i] = &txns[i];
+    }
+
+    nl_transact_multiple(NETLINK_ROUTE, txnps, n);
+
+    for (i = 0; i < n; i++) {
+        errors[i] = txns[i].error;
+        if (!error && txns[i].error) {
+            error = txns[i].error;
+        }
+        ofpbuf_uninit(&requests[i]);
+    }
+
+    free(requests);
+    free(txnps);
+    free(txns);
+
+    return error;
+}
+
 int
 tc_get_flower(struct tcf_id *id, struct tc_flower *flower)
 {
@@ -358,6 +358,7 @@ BUILD_ASSERT_DECL(offsetof(struct tc_flower, rewrite)
 
 int tc_replace_flower(struct tcf_id *id, struct tc_flower *flower);
 int tc_del_filter(struct tcf_id *id);
+int tc_del_filters(struct tcf_id **ids, int *errors, int n);
 int tc_get_flower(struct tcf_id *id, struct tc_flower *flower);
 int tc_dump_flower_start(struct tcf_id *id, struct nl_dump *dump, bool terse);
 int parse_netlink_to_tc_flower(struct ofpbuf *reply,
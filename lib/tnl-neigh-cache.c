@@ -51,7 +51,8 @@ struct tnl_neigh_entry {
     struct cmap_node cmap_node;
     struct in6_addr ip;
     struct eth_addr mac;
-    time_t expires;             /* Expiration time. */
+    atomic_llong expires;       /* Expiration time.  Readers refresh it
+                                 * without taking 'mutex'. */
     char br_name[IFNAMSIZ];
 };
 
@@ -73,11 +74,21 @@ tnl_neigh_lookup__(const char br_name[IFNAMSIZ], const struct in6_addr *dst)
     hash = tnl_neigh_hash(dst);
     CMAP_FOR_EACH_WITH_HASH (neigh, cmap_node, hash, &table) {
         if (ipv6_addr_equals(&neigh->ip, dst) && !strcmp(neigh->br_name, br_name)) {
-            if (neigh->expires <= time_now()) {
+            long long int expires, refreshed;
+
+            atomic_read_relaxed(&neigh->expires, &expires);
+            if (expires <= time_now()) {
                 return NULL;
             }
 
-            neigh->expires = time_now() + NEIGH_ENTRY_DEFAULT_IDLE_TIME;
+            /* Refresh the idle timer.  time_now() has one-second
+             * granularity, so the refreshed value only changes once a
+             * second; skipping the redundant stores keeps the entry's cache
+             * line clean for concurrent lookups on other threads. */
+            refreshed = time_now() + NEIGH_ENTRY_DEFAULT_IDLE_TIME;
+            if (expires != refreshed) {
+                atomic_store_relaxed(&neigh->expires, refreshed);
+            }
             return neigh;
         }
     }
@@ -121,7 +132,8 @@ tnl_neigh_set__(const char name[IFNAMSIZ], const struct in6_addr *dst,
     struct tnl_neigh_entry *neigh = tnl_neigh_lookup__(name, dst);
     if (neigh) {
         if (eth_addr_equals(neigh->mac, mac)) {
-            neigh->expires = time_now() + NEIGH_ENTRY_DEFAULT_IDLE_TIME;
+            atomic_store_relaxed(&neigh->expires,
+                                 time_now() + NEIGH_ENTRY_DEFAULT_IDLE_TIME);
             ovs_mutex_unlock(&mutex);
             return;
         }
@@ -133,7 +145,7 @@ tnl_neigh_set__(const char name[IFNAMSIZ], const struct in6_addr *dst,
 
     neigh->ip = *dst;
     neigh->mac = mac;
-    neigh->expires = time_now() + NEIGH_ENTRY_DEFAULT_IDLE_TIME;
+    atomic_init(&neigh->expires, time_now() + NEIGH_ENTRY_DEFAULT_IDLE_TIME);
     ovs_strlcpy(neigh->br_name, name, sizeof neigh->br_name);
     cmap_insert(&table, &neigh->cmap_node, tnl_neigh_hash(&neigh->ip));
     ovs_mutex_unlock(&mutex);
@@ -208,7 +220,10 @@ tnl_neigh_cache_run(void)
 
     ovs_mutex_lock(&mutex);
     CMAP_FOR_EACH(neigh, cmap_node, &table) {
-        if (neigh->expires <= time_now()) {
+        long long int expires;
+
+        atomic_read_relaxed(&neigh->expires, &expires);
+        if (expires <= time_now()) {
             tnl_neigh_delete(neigh);
             changed = true;
         }
@@ -310,6 +325,7 @@ tnl_neigh_cache_show(struct unixctl_conn *conn, int argc OVS_UNUSED,
     ovs_mutex_lock(&mutex);
     CMAP_FOR_EACH(neigh, cmap_node, &table) {
         int start_len, need_ws;
+        long long int expires;
 
         start_len = ds.length;
         ipv6_format_mapped(&neigh->ip, &ds);
@@ -319,7 +335,8 @@ tnl_neigh_cache_show(struct unixctl_conn *conn, int argc OVS_UNUSED,
 
         ds_put_format(&ds, ETH_ADDR_FMT"   %s",
                       ETH_ADDR_ARGS(neigh->mac), neigh->br_name);
-        if (neigh->expires <= time_now()) {
+        atomic_read_relaxed(&neigh->expires, &expires);
+        if (expires <= time_now()) {
             ds_put_format(&ds, " STALE");
         }
         ds_put_char(&ds, '\n');
@@ -23,11 +23,13 @@
 #include <string.h>
 
 #include "classifier.h"
+#include "cmap.h"
 #include "openvswitch/dynamic-string.h"
 #include "hash.h"
 #include "openvswitch/list.h"
 #include "netdev.h"
 #include "openvswitch/ofpbuf.h"
+#include "ovs-rcu.h"
 #include "ovs-thread.h"
 #include "odp-util.h"
 #include "unixctl.h"
@@ -48,6 +50,69 @@ struct ip_device {
 
 static struct ovs_list addr_list;
 
+/* Local tunnel endpoint addresses, one entry per address of every device on
+ * 'addr_list'.  Kept in a cmap so datapath threads can consult it without
+ * taking 'mutex' when they synthesize ARP/ND replies (see
+ * tnl_port_endpoint_lookup()). */
+struct tnl_endpoint {
+    struct cmap_node node;      /* In 'endpoint_map', by address hash. */
+    struct in6_addr addr;
+    struct eth_addr mac;        /* MAC of the owning device. */
+    char dev_name[IFNAMSIZ];    /* Owning device, for removal. */
+};
+
+static struct cmap endpoint_map = CMAP_INITIALIZER;
+
+static uint32_t
+tnl_endpoint_hash(const struct in6_addr *addr)
+{
+    return hash_bytes(addr->s6_addr, sizeof addr->s6_addr, 0);
+}
+
+static void
+endpoint_map_insert(const struct ip_device *ip_dev)
+{
+    for (int i = 0; i < ip_dev->n_addr; i++) {
+        struct tnl_endpoint *e = xzalloc(sizeof *e);
+
+        e->addr = ip_dev->addr[i];
+        e->mac = ip_dev->mac;
+        ovs_strlcpy_arrays(e->dev_name, ip_dev->dev_name);
+        cmap_insert(&endpoint_map, &e->node, tnl_endpoint_hash(&e->addr));
+    }
+}
+
+static void
+endpoint_map_delete(const char dev_name[])
+{
+    struct tnl_endpoint *e;
+
+    CMAP_FOR_EACH (e, node, &endpoint_map) {
+        if (!strcmp(e->dev_name, dev_name)) {
+            cmap_remove(&endpoint_map, &e->node, tnl_endpoint_hash(&e->addr));
+            ovsrcu_postpone(free, e);
+        }
+    }
+}
+
+/* If 'addr' is the address of a local tunnel endpoint device, stores that
+ * device's MAC address in '*mac' and returns true, otherwise returns false.
+ * Safe to call from any thread without locking. */
+bool
+tnl_port_endpoint_lookup(const struct in6_addr *addr, struct eth_addr *mac)
+{
+    struct tnl_endpoint *e;
+
+    CMAP_FOR_EACH_WITH_HASH (e, node, tnl_endpoint_hash(addr),
+                             &endpoint_map) {
+        if (ipv6_addr_equals(&e->addr, addr)) {
+            *mac = e->mac;
+            return true;
+        }
+    }
+    return false;
+}
+
 struct tnl_port {
     odp_port_t port;
     struct ovs_refcount ref_cnt;
@@ -395,6 +460,7 @@ insert_ipdev__(struct netdev *dev,
     ovs_strlcpy(ip_dev->dev_name, netdev_get_name(dev), sizeof ip_dev->dev_name);
     ovs_list_insert(&addr_list, &ip_dev->node);
     map_insert_ipdev(ip_dev);
+    endpoint_map_insert(ip_dev);
     return;
 
 err_free_ipdev:
@@ -435,6 +501,7 @@ delete_ipdev(struct ip_device *ip_dev)
         ipdev_map_delete(ip_dev, p->tp_port, p->nw_proto);
     }
 
+    endpoint_map_delete(ip_dev->dev_name);
     ovs_list_remove(&ip_dev->node);
     netdev_close(ip_dev->dev);
     free(ip_dev->addr);
@@ -36,4 +36,6 @@ void tnl_port_map_run(void);
 
 void tnl_port_map_init(void);
 
+bool tnl_port_endpoint_lookup(const struct in6_addr *, struct eth_addr *mac);
+
 #endif
@@ -333,6 +333,93 @@ free_pagealign(void *p)
     free_size_align(p);
 }
 
+/* Per-subsystem allocation accounting.  See the comment on enum mem_tag in
+ * util.h. */
+
+static const char *mem_tag_names[MEM_N_TAGS] = {
+    [MEM_TAG_UKEY] = "ukeys",
+    [MEM_TAG_XLATE] = "xlate-cache",
+    [MEM_TAG_UBPF] = "ubpf",
+};
+
+static ATOMIC(uint64_t) mem_tag_bytes[MEM_N_TAGS];
+static ATOMIC(uint64_t) mem_tag_blocks[MEM_N_TAGS];
+
+/* Every tagged block is preceded by a header recording how to account its
+ * release.  Two size_ts, so that the payload keeps malloc()'s alignment. */
+struct mem_tag_hdr {
+    size_t size;
+    size_t tag;
+};
+
+/* Adds 'bytes' and 'blocks' (either may be negative) to the counters for
+ * 'tag'.  For allocators that manage their own blocks; the tagged wrappers
+ * below call this internally. */
+void
+mem_tag_adjust(enum mem_tag tag, long long int bytes, int blocks)
+{
+    uint64_t orig;
+
+    atomic_add_relaxed(&mem_tag_bytes[tag], (uint64_t) bytes, &orig);
+    atomic_add_relaxed(&mem_tag_blocks[tag], (uint64_t) blocks, &orig);
+}
+
+/* Like xmalloc(), but accounts the block to 'tag'.  Free the returned block
+ * with free_tag(). */
+void *
+xmalloc_tag(size_t size, enum mem_tag tag)
+{
+    struct mem_tag_hdr *hdr = xmalloc(sizeof *hdr + size);
+
+    hdr->size = size;
+    hdr->tag = tag;
+    mem_tag_adjust(tag, size, 1);
+    return hdr + 1;
+}
+
+/* Like xzalloc(), but accounts the block to 'tag'.  Free the returned block
+ * with free_tag(). */
+void *
+xzalloc_tag(size_t size, enum mem_tag tag)
+{
+    void *p = xmalloc_tag(size, tag);
+
+    memset(p, 0, size);
+    return p;
+}
+
+/* Frees a block obtained from xmalloc_tag() or xzalloc_tag().  'p' may be
+ * NULL. */
+void
+free_tag(void *p)
+{
+    if (p) {
+        struct mem_tag_hdr *hdr = (struct mem_tag_hdr *) p - 1;
+
+        mem_tag_adjust(hdr->tag, -(long long int) hdr->size, -1);
+        free(hdr);
+    }
+}
+
+const char *
+mem_tag_name(enum mem_tag tag)
+{
+    return mem_tag_names[tag];
+}
+
+/* Copies the current per-tag byte and block counts into 'bytes' and
+ * 'blocks'. */
+void
+mem_tag_read(uint64_t bytes[MEM_N_TAGS], uint64_t blocks[MEM_N_TAGS])
+{
+    size_t i;
+
+    for (i = 0; i < MEM_N_TAGS; i++) {
+        atomic_read_relaxed(&mem_tag_bytes[i], &bytes[i]);
+        atomic_read_relaxed(&mem_tag_blocks[i], &blocks[i]);
+    }
+}
+
 char *
 xasprintf(const char *format, ...)
 {
@@ -33,6 +33,18 @@
 #include <arm_neon.h>
 #endif
 
+/* Userspace Static Defined Trace (USDT) probe points.  Compiled in with
+ * --enable-usdt-probes; a disarmed probe is a single nop instruction, so
+ * they may be placed on hot paths.  Probe arguments should be values or
+ * pointers that are cheaply available at the probe site. */
+#ifdef HAVE_USDT_PROBES
+#include <sys/sdt.h>
+#define OVS_USDT_PROBE(provider, name, ...) \
+    STAP_PROBEV(provider, name, ## __VA_ARGS__)
+#else
+#define OVS_USDT_PROBE(provider, name, ...)
+#endif
+
 extern char *program_name;
 
 #define __ARRAY_SIZE_NOCHECK(ARRAY) (sizeof(ARRAY) / sizeof((ARRAY)[0]))
@@ -174,6 +186,30 @@ void free_pagealign(void *);
 void *xmalloc_size_align(size_t, size_t) MALLOC_LIKE;
 void free_size_align(void *);
 
+/* Allocation accounting by subsystem.
+ *
+ * Allocations made through these wrappers are counted per subsystem tag, so
+ * that "ovs-appctl memory/show" can attribute heap growth to a subsystem
+ * instead of only reporting the total.  The cost is a small per-block header
+ * and one relaxed counter update per allocation or free, cheap enough to
+ * leave enabled in production.
+ *
+ * Blocks from xmalloc_tag() and xzalloc_tag() must be released with
+ * free_tag().  Allocators that manage their own blocks can account through
+ * mem_tag_adjust() instead. */
+enum mem_tag {
+    MEM_TAG_UKEY,               /* Datapath flow ukeys. */
+    MEM_TAG_XLATE,              /* Flow translation caches. */
+    MEM_TAG_UBPF,               /* uBPF programs and map payloads. */
+    MEM_N_TAGS
+};
+void *xmalloc_tag(size_t, enum mem_tag) MALLOC_LIKE;
+void *xzalloc_tag(size_t, enum mem_tag) MALLOC_LIKE;
+void free_tag(void *);
+void mem_tag_adjust(enum mem_tag, long long int bytes, int blocks);
+const char *mem_tag_name(enum mem_tag);
+void mem_tag_read(uint64_t bytes[MEM_N_TAGS], uint64_t blocks[MEM_N_TAGS]);
+
 /* The C standards say that neither the 'dst' nor 'src' argument to
  * memcpy() may be null, even if 'n' is zero.  This wrapper tolerates
  * the null case. */
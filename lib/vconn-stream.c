@@ -189,6 +189,11 @@ vconn_stream_clear_txbuf(struct vconn_stream *s)
     s->txbuf = NULL;
 }
 
+/* Maximum number of queued bytes beyond which vconn_stream_send() pushes
+ * back on the caller with EAGAIN instead of coalescing further messages
+ * into 'txbuf'. */
+#define VCONN_STREAM_TXBUF_LIMIT (64 * 1024)
+
 static int
 vconn_stream_send(struct vconn *vconn, struct ofpbuf *buffer)
 {
@@ -196,7 +201,17 @@ vconn_stream_send(struct vconn *vconn, struct ofpbuf *buffer)
     ssize_t retval;
 
     if (s->txbuf) {
-        return EAGAIN;
+        if (s->txbuf->size >= VCONN_STREAM_TXBUF_LIMIT) {
+            return EAGAIN;
+        }
+
+        /* The stream did not keep up with the sender.  Coalesce this message
+         * with the data already queued, so that the whole backlog can be
+         * flushed with one system call per txbuf instead of one per
+         * message. */
+        ofpbuf_put(s->txbuf, buffer->data, buffer->size);
+        ofpbuf_delete(buffer);
+        return 0;
     }
 
     retval = stream_send(s->stream, buffer->data, buffer->size);
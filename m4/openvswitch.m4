@@ -602,6 +602,14 @@ AC_DEFUN([OVS_CHECK_POSIX_AIO],
   [AC_SEARCH_LIBS([aio_write], [rt])
    AM_CONDITIONAL([HAVE_POSIX_AIO], [test "$ac_cv_search_aio_write" != no])])
 
+dnl OVS_CHECK_LIBURING
+AC_DEFUN([OVS_CHECK_LIBURING],
+  [AC_CHECK_HEADERS([liburing.h])
+   AC_SEARCH_LIBS([io_uring_queue_init], [uring])
+   AM_CONDITIONAL([HAVE_LIBURING],
+     [test "$ac_cv_header_liburing_h" = yes \
+      && test "$ac_cv_search_io_uring_queue_init" != no])])
+
 dnl OVS_CHECK_INCLUDE_NEXT
 AC_DEFUN([OVS_CHECK_INCLUDE_NEXT],
   [AC_REQUIRE([gl_CHECK_NEXT_HEADERS])
@@ -661,6 +669,34 @@ AC_DEFUN([OVS_CHECK_UNBOUND],
    AC_SUBST([HAVE_UNBOUND])])
 
 dnl Checks for libunwind.
+dnl OVS_CHECK_USDT
+dnl
+dnl Check whether User Statically Defined Tracing (USDT) probes should be
+dnl compiled in, and whether <sys/sdt.h> is available to do so.
+AC_DEFUN([OVS_CHECK_USDT],
+  [AC_ARG_ENABLE(
+     [usdt-probes],
+     [AS_HELP_STRING([--enable-usdt-probes],
+                     [Enable User Statically Defined Tracing (USDT) probes])],
+     [case "${enableval}" in
+        (yes) usdt=true ;;
+        (no)  usdt=false ;;
+        (*) AC_MSG_ERROR([bad value ${enableval} for --enable-usdt-probes]) ;;
+      esac],
+     [usdt=false])
+
+   AC_MSG_CHECKING([whether USDT probes are enabled])
+   if test "$usdt" != true; then
+     AC_MSG_RESULT([no])
+   else
+     AC_MSG_RESULT([yes])
+     AC_CHECK_HEADER([sys/sdt.h],
+       [AC_DEFINE([HAVE_USDT_PROBES], [1],
+                  [Define to 1 if USDT probes are enabled.])],
+       [AC_MSG_ERROR([--enable-usdt-probes requires sys/sdt.h, provided dnl
+by systemtap-sdt-dev or systemtap-sdt-devel])])
+   fi])
+
 AC_DEFUN([OVS_CHECK_UNWIND],
   [AC_CHECK_LIB([unwind], [unw_backtrace],
    [AC_CHECK_HEADERS([libunwind.h], [HAVE_UNWIND=yes], [HAVE_UNWIND=no])],
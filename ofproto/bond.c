@@ -154,6 +154,7 @@ struct bond {
 enum bond_op {
     ADD,        /* Add the rule to ofproto's flow table. */
     DEL,        /* Delete the rule from the ofproto's flow table. */
+    KEEP,       /* Leave the installed rule alone; its bucket did not move. */
 };
 
 /* A rule to add to or delete from ofproto's internal flow table. */
@@ -311,7 +312,11 @@ add_pr_rule(struct bond *bond, const struct match *match,
 
     HMAP_FOR_EACH_WITH_HASH(pr_op, hmap_node, hash, &bond->pr_rule_ops) {
         if (match_equal(&pr_op->match, match)) {
-            pr_op->op = ADD;
+            /* If the bucket still points at the same slave and its rule is
+             * installed, there is nothing to rewrite. */
+            pr_op->op = (pr_op->out_ofport == out_ofport
+                         && pr_op->pr_rule == rule && *rule
+                         ? KEEP : ADD);
             pr_op->out_ofport = out_ofport;
             pr_op->pr_rule = rule;
             return;
@@ -410,6 +415,9 @@ update_recirc_rules__(struct bond *bond)
             }
             free(pr_op);
             break;
+
+        case KEEP:
+            break;
         }
     }
 
@@ -1167,9 +1175,7 @@ bond_shift_load(struct bond_entry *hash, struct bond_slave *to)
     from->tx_bytes -= delta;
     to->tx_bytes += delta;
 
-    /* Arrange for flows to be revalidated. */
     hash->slave = to;
-    bond->bond_revalidate = true;
 }
 
 /* Picks and returns a bond_entry to migrate from 'from' (the most heavily
@@ -1339,8 +1345,18 @@ bond_rebalance(struct bond *bond)
         e->tx_bytes /= 2;
     }
 
-    if (use_recirc && rebalanced) {
-        bond_update_post_recirc_rules__(bond,true);
+    if (rebalanced) {
+        if (use_recirc) {
+            /* Moved buckets are repointed by rewriting only their dp_hash
+             * indirection entries: the per-bucket post-recirculation rules,
+             * or the datapath lb_output bucket table.  Flows hashing to
+             * unmoved buckets stay untouched, so there is no need to
+             * revalidate the world. */
+            bond_update_post_recirc_rules__(bond, true);
+        } else {
+            /* Arrange for flows to be revalidated. */
+            bond->bond_revalidate = true;
+        }
     }
 
 done:
@@ -20,7 +20,9 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "socket-util.h"
@@ -127,6 +129,50 @@ collectors_send(const struct collectors *c, const void *payload, size_t n)
     return errors;
 }
 
+/* Sends each of the 'n' datagrams in 'iovs' to each of the collectors in 'c',
+ * using a single system call per collector where the platform supports it.
+ * Returns the number of datagrams that could not be sent, counting each
+ * collector separately. */
+size_t
+collectors_send_batch(const struct collectors *c, const struct iovec *iovs,
+                      size_t n)
+{
+    size_t errors = 0;
+
+    if (c && n) {
+        struct mmsghdr *mmsgs = xmalloc(n * sizeof *mmsgs);
+        size_t i, j;
+
+        memset(mmsgs, 0, n * sizeof *mmsgs);
+        for (j = 0; j < n; j++) {
+            mmsgs[j].msg_hdr.msg_iov = CONST_CAST(struct iovec *, &iovs[j]);
+            mmsgs[j].msg_hdr.msg_iovlen = 1;
+        }
+
+        for (i = 0; i < c->n_fds; i++) {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+            size_t sent = 0;
+
+            while (sent < n) {
+                int retval = sendmmsg(c->fds[i], mmsgs + sent, n - sent, 0);
+
+                if (retval < 0) {
+                    char *s = describe_fd(c->fds[i]);
+                    VLOG_WARN_RL(&rl, "%s: sending to collector failed (%s)",
+                                 s, ovs_strerror(errno));
+                    free(s);
+                    errors += n - sent;
+                    break;
+                }
+                sent += retval;
+            }
+        }
+        free(mmsgs);
+    }
+
+    return errors;
+}
+
 int
 collectors_count(const struct collectors *c)
 {
@@ -21,6 +21,7 @@
 #include <stdint.h>
 
 struct collectors;
+struct iovec;
 struct sset;
 
 int collectors_create(const struct sset *targets, int default_port,
@@ -28,6 +29,8 @@ int collectors_create(const struct sset *targets, int default_port,
 void collectors_destroy(struct collectors *);
 
 size_t collectors_send(const struct collectors *, const void *, size_t);
+size_t collectors_send_batch(const struct collectors *,
+                             const struct iovec *, size_t);
 
 int collectors_count(const struct collectors *);
 
@@ -21,6 +21,7 @@
 #include "bundles.h"
 #include "connmgr.h"
 #include "coverage.h"
+#include "dp-packet.h"
 #include "fail-open.h"
 #include "in-band.h"
 #include "odp-util.h"
@@ -1649,6 +1650,25 @@ connmgr_send_table_status(struct connmgr *mgr,
     }
 }
 
+/* Returns a hash of the flow that triggered 'pin', used to pick the fair
+ * queue inside the packet-in rate limiter.  Keying the limiter queues on the
+ * flow rather than on the input port keeps a single high-rate flow from
+ * crowding everyone else's packet-ins out of the controller channel; the
+ * symmetric hash puts both directions of a connection in the same queue. */
+static uint32_t
+pin_flow_hash(const struct ofputil_packet_in *pin)
+{
+    struct dp_packet packet;
+    struct flow flow;
+
+    dp_packet_use_const(&packet, pin->packet, pin->packet_len);
+    pkt_metadata_from_flow(&packet.md, &pin->flow_metadata.flow);
+    flow_extract(&packet, &flow);
+
+    return hash_int(ofp_to_u16(pin->flow_metadata.flow.in_port.ofp_port),
+                    flow_hash_symmetric_l4(&flow, 0));
+}
+
 /* Given 'pin', sends an OFPT_PACKET_IN message to each OpenFlow controller as
  * necessary according to their individual configurations. */
 void
@@ -1673,8 +1693,8 @@ connmgr_send_async_msg(struct connmgr *mgr,
         bool is_miss = (am->pin.up.base.reason == OFPR_NO_MATCH ||
                         am->pin.up.base.reason == OFPR_EXPLICIT_MISS ||
                         am->pin.up.base.reason == OFPR_IMPLICIT_MISS);
-        pinsched_send(ofconn->schedulers[is_miss],
-                      am->pin.up.base.flow_metadata.flow.in_port.ofp_port,
+        struct pinsched *ps = ofconn->schedulers[is_miss];
+        pinsched_send(ps, ps ? pin_flow_hash(&am->pin.up.base) : 0,
                       msg, &txq);
         do_send_packet_ins(ofconn, &txq);
     }
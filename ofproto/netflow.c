@@ -21,6 +21,7 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include "byte-order.h"
 #include "collectors.h"
@@ -39,6 +40,10 @@
 
 VLOG_DEFINE_THIS_MODULE(netflow);
 
+/* Number of full NetFlow packets queued up before they are pushed to the
+ * collectors with a single system call per collector. */
+#define NETFLOW_MAX_BATCH 16
+
 struct netflow {
     uint8_t engine_type;          /* Value of engine_type to use. */
     uint8_t engine_id;            /* Value of engine_id to use. */
@@ -49,6 +54,8 @@ struct netflow {
                                    * bits of the interface fields. */
     uint32_t netflow_cnt;         /* Flow sequence number for NetFlow. */
     struct ofpbuf packet;         /* NetFlow packet being accumulated. */
+    struct iovec queued[NETFLOW_MAX_BATCH]; /* Full packets awaiting send. */
+    size_t n_queued;              /* Number of packets in 'queued'. */
     long long int active_timeout; /* Timeout for flows that are still active. */
     long long int next_timeout;   /* Next scheduled active timeout. */
     long long int reconfig_time;  /* When we reconfigured the timeouts. */
@@ -90,6 +97,7 @@ static uint32_t netflow_flow_hash(const struct flow *);
 static void netflow_expire__(struct netflow *, struct netflow_flow *)
     OVS_REQUIRES(mutex);
 static void netflow_run__(struct netflow *) OVS_REQUIRES(mutex);
+static void netflow_send__(struct netflow *) OVS_REQUIRES(mutex);
 
 void
 netflow_mask_wc(const struct flow *flow, struct flow_wildcards *wc)
@@ -165,9 +173,19 @@ gen_netflow_rec(struct netflow *nf, struct netflow_flow *nf_flow,
     nf_rec->ip_proto = nf_flow->nw_proto;
     nf_rec->ip_tos = nf_flow->nw_tos & IP_DSCP_MASK;
 
-    /* NetFlow messages are limited to 30 records. */
+    /* NetFlow messages are limited to 30 records.  Queue the full packet
+     * rather than sending it immediately, so that a burst of expirations
+     * costs one system call per NETFLOW_MAX_BATCH packets per collector. */
     if (ntohs(nf_hdr->count) >= 30) {
-        netflow_run__(nf);
+        if (nf->n_queued >= NETFLOW_MAX_BATCH) {
+            netflow_send__(nf);
+        } else {
+            struct iovec *iov = &nf->queued[nf->n_queued++];
+
+            iov->iov_base = xmemdup(nf->packet.data, nf->packet.size);
+            iov->iov_len = nf->packet.size;
+            nf->packet.size = 0;
+        }
     }
 }
 
@@ -293,6 +311,34 @@ netflow_flow_clear(struct netflow *nf, const struct flow *flow)
     ovs_mutex_unlock(&mutex);
 }
 
+/* Sends the queued full packets and the packet being accumulated, if any, to
+ * each collector in a single batch. */
+static void
+netflow_send__(struct netflow *nf) OVS_REQUIRES(mutex)
+{
+    struct iovec iovs[NETFLOW_MAX_BATCH + 1];
+    size_t n = 0;
+    size_t i;
+
+    for (i = 0; i < nf->n_queued; i++) {
+        iovs[n++] = nf->queued[i];
+    }
+    if (nf->packet.size) {
+        iovs[n].iov_base = nf->packet.data;
+        iovs[n].iov_len = nf->packet.size;
+        n++;
+    }
+    if (n) {
+        collectors_send_batch(nf->collectors, iovs, n);
+    }
+
+    for (i = 0; i < nf->n_queued; i++) {
+        free(nf->queued[i].iov_base);
+    }
+    nf->n_queued = 0;
+    nf->packet.size = 0;
+}
+
 /* Returns true if it's time to send out a round of NetFlow active timeouts,
  * false otherwise. */
 static void
@@ -301,10 +347,7 @@ netflow_run__(struct netflow *nf) OVS_REQUIRES(mutex)
     long long int now = time_msec();
     struct netflow_flow *nf_flow, *next;
 
-    if (nf->packet.size) {
-        collectors_send(nf->collectors, nf->packet.data, nf->packet.size);
-        nf->packet.size = 0;
-    }
+    netflow_send__(nf);
 
     if (!nf->active_timeout || now < nf->next_timeout) {
         return;
@@ -342,7 +385,7 @@ netflow_wait(struct netflow *nf) OVS_EXCLUDED(mutex)
     if (nf->active_timeout) {
         poll_timer_wait_until(nf->next_timeout);
     }
-    if (nf->packet.size) {
+    if (nf->packet.size || nf->n_queued) {
         poll_immediate_wake();
     }
     ovs_mutex_unlock(&mutex);
@@ -412,9 +455,14 @@ void
 netflow_unref(struct netflow *nf)
 {
     if (nf && ovs_refcount_unref_relaxed(&nf->ref_cnt) == 1) {
+        size_t i;
+
         atomic_count_dec(&netflow_count);
         collectors_destroy(nf->collectors);
         ofpbuf_uninit(&nf->packet);
+        for (i = 0; i < nf->n_queued; i++) {
+            free(nf->queued[i].iov_base);
+        }
 
         struct netflow_flow *nf_flow, *next;
         HMAP_FOR_EACH_SAFE (nf_flow, next, hmap_node, &nf->flows) {
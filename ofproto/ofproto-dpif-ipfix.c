@@ -17,6 +17,7 @@
 #include <config.h>
 #include "ofproto-dpif-ipfix.h"
 #include <sys/time.h>
+#include <sys/uio.h>
 #include "byte-order.h"
 #include "collectors.h"
 #include "flow.h"
@@ -1274,6 +1275,62 @@ ipfix_send_msg(const struct collectors *collectors, struct dp_packet *msg)
     return tx_errors;
 }
 
+/* Number of full messages accumulated before they are pushed to the
+ * collectors. */
+#define IPFIX_MSG_BATCH_SIZE 32
+
+/* A batch of IPFIX messages on their way to the collectors.  Data records
+ * are packed into maximally sized messages and full messages accumulate
+ * here, so that a cache expiration run costs one system call per
+ * IPFIX_MSG_BATCH_SIZE datagrams per collector instead of one system call
+ * per record. */
+struct ipfix_msg_batch {
+    struct dp_packet msgs[IPFIX_MSG_BATCH_SIZE];
+    size_t n;                   /* Number of finished messages in 'msgs'. */
+};
+
+/* Finishes the message currently being packed into 'batch', adjusting the
+ * length in its header. */
+static void
+ipfix_msg_batch_close(struct ipfix_msg_batch *batch)
+{
+    struct dp_packet *msg = &batch->msgs[batch->n];
+    struct ipfix_header *hdr = dp_packet_data(msg);
+
+    hdr->length = htons(dp_packet_size(msg));
+    batch->n++;
+}
+
+/* Sends the finished messages in 'batch' to 'exporter''s collectors and
+ * accounts for the results. */
+static void
+ipfix_msg_batch_flush(struct dpif_ipfix_exporter *exporter,
+                      struct ipfix_msg_batch *batch)
+{
+    struct iovec iovs[IPFIX_MSG_BATCH_SIZE];
+    size_t tx_errors;
+    size_t i;
+
+    if (!batch->n) {
+        return;
+    }
+
+    for (i = 0; i < batch->n; i++) {
+        iovs[i].iov_base = dp_packet_data(&batch->msgs[i]);
+        iovs[i].iov_len = dp_packet_size(&batch->msgs[i]);
+    }
+    tx_errors = collectors_send_batch(exporter->collectors, iovs, batch->n);
+
+    exporter->ofproto_stats.tx_pkts +=
+        batch->n * collectors_count(exporter->collectors) - tx_errors;
+    exporter->ofproto_stats.tx_errors += tx_errors;
+
+    for (i = 0; i < batch->n; i++) {
+        dp_packet_uninit(&batch->msgs[i]);
+    }
+    batch->n = 0;
+}
+
 static uint16_t
 ipfix_get_template_id(enum ipfix_proto_l2 l2, enum ipfix_proto_l3 l3,
                       enum ipfix_proto_l4 l4, enum ipfix_proto_tunnel tunnel,
@@ -2626,34 +2683,6 @@ ipfix_send_exporter_data_msg(struct dpif_ipfix_exporter *exporter,
     exporter->ofproto_stats.tx_errors += tx_errors;
 }
 
-/* Send an IPFIX message with a single data record. */
-static void
-ipfix_send_data_msg(struct dpif_ipfix_exporter *exporter,
-                    uint32_t export_time_sec,
-                    struct ipfix_flow_cache_entry *entry,
-                    enum ipfix_flow_end_reason flow_end_reason)
-{
-    uint64_t msg_stub[DIV_ROUND_UP(MAX_MESSAGE_LEN, 8)];
-    struct dp_packet msg;
-    size_t tx_errors;
-
-    dp_packet_use_stub(&msg, msg_stub, sizeof msg_stub);
-
-    ipfix_init_header(export_time_sec, exporter->seq_number++,
-                      entry->flow_key.obs_domain_id, &msg);
-    ipfix_put_data_set(export_time_sec, entry, flow_end_reason,
-                       exporter->virtual_obs_id, exporter->virtual_obs_len,
-                       &msg);
-    tx_errors = ipfix_send_msg(exporter->collectors, &msg);
-
-    dp_packet_uninit(&msg);
-
-    exporter->ofproto_stats.current_flows--;
-    exporter->ofproto_stats.tx_pkts +=
-            collectors_count(exporter->collectors) - tx_errors;
-    exporter->ofproto_stats.tx_errors += tx_errors;
-}
-
 static void
 dpif_ipfix_sample(const struct dpif_ipfix *di,
                   struct dpif_ipfix_exporter *exporter,
@@ -2803,11 +2832,15 @@ dpif_ipfix_cache_expire(struct dpif_ipfix_exporter *exporter,
     uint64_t max_flow_start_timestamp_usec;
     bool template_msg_sent = false;
     enum ipfix_flow_end_reason flow_end_reason;
+    struct ipfix_msg_batch batch;
+    struct dp_packet *msg = NULL;
+    uint32_t msg_obs_domain_id = 0;
 
     if (ovs_list_is_empty(&exporter->cache_flow_start_timestamp_list)) {
         return;
     }
 
+    batch.n = 0;
     max_flow_start_timestamp_usec = export_time_usec -
         1000000LL * exporter->cache_active_timeout;
 
@@ -2846,11 +2879,40 @@ dpif_ipfix_cache_expire(struct dpif_ipfix_exporter *exporter,
             ipfix_send_exporter_data_msg(exporter, export_time_sec);
         }
 
-        /* XXX: Group multiple data records for the same obs domain id
-         * into the same message. */
-        ipfix_send_data_msg(exporter, export_time_sec, entry, flow_end_reason);
+        /* Group data records for the same obs domain id into the same
+         * message, since the obs domain id is part of the message header,
+         * and pack each message as full as MAX_MESSAGE_LEN allows. */
+        if (msg && entry->flow_key.obs_domain_id != msg_obs_domain_id) {
+            ipfix_msg_batch_close(&batch);
+            msg = NULL;
+        }
+        if (!msg) {
+            if (batch.n >= IPFIX_MSG_BATCH_SIZE) {
+                ipfix_msg_batch_flush(exporter, &batch);
+            }
+            msg = &batch.msgs[batch.n];
+            dp_packet_init(msg, MAX_MESSAGE_LEN);
+            msg_obs_domain_id = entry->flow_key.obs_domain_id;
+            ipfix_init_header(export_time_sec, exporter->seq_number,
+                              msg_obs_domain_id, msg);
+        }
+        ipfix_put_data_set(export_time_sec, entry, flow_end_reason,
+                           exporter->virtual_obs_id,
+                           exporter->virtual_obs_len, msg);
+        exporter->seq_number++;
+        exporter->ofproto_stats.current_flows--;
         free(entry);
+
+        if (dp_packet_size(msg) >= MAX_MESSAGE_LEN) {
+            ipfix_msg_batch_close(&batch);
+            msg = NULL;
+        }
+    }
+
+    if (msg) {
+        ipfix_msg_batch_close(&batch);
     }
+    ipfix_msg_batch_flush(exporter, &batch);
 }
 
 static void
@@ -68,6 +68,9 @@ struct mirror {
     int out_vlan;               /* Output VLAN or -1. */
     uint16_t snaplen;           /* Max per mirrored packet size in byte,
                                    set to 0 equals 65535. */
+    uint32_t meter_id;          /* Provider meter that rate-limits the
+                                   mirrored copies in the datapath, or
+                                   UINT32_MAX.  Owned by the client. */
     mirror_mask_t dup_mirrors;  /* Bitmap of mirrors with the same output. */
 
     /* Counters. */
@@ -212,7 +215,7 @@ mirror_set(struct mbridge *mbridge, void *aux, const char *name,
            struct ofbundle **dsts, size_t n_dsts,
            unsigned long *src_vlans, struct ofbundle *out_bundle,
            uint16_t snaplen,
-           uint16_t out_vlan)
+           uint16_t out_vlan, uint32_t meter_id)
 {
     struct mbundle *mbundle, *out;
     mirror_mask_t mirror_bit;
@@ -237,6 +240,7 @@ mirror_set(struct mbridge *mbridge, void *aux, const char *name,
         mirror->aux = aux;
         mirror->out_vlan = -1;
         mirror->snaplen = 0;
+        mirror->meter_id = UINT32_MAX;
     }
 
     unsigned long *vlans = ovsrcu_get(unsigned long *, &mirror->vlans);
@@ -261,7 +265,8 @@ mirror_set(struct mbridge *mbridge, void *aux, const char *name,
         && vlan_bitmap_equal(vlans, src_vlans)
         && mirror->out == out
         && mirror->out_vlan == out_vlan
-        && mirror->snaplen == snaplen)
+        && mirror->snaplen == snaplen
+        && mirror->meter_id == meter_id)
     {
         hmapx_destroy(&srcs_map);
         hmapx_destroy(&dsts_map);
@@ -284,6 +289,7 @@ mirror_set(struct mbridge *mbridge, void *aux, const char *name,
     mirror->out = out;
     mirror->out_vlan = out_vlan;
     mirror->snaplen = snaplen;
+    mirror->meter_id = meter_id;
 
     /* Update mbundles. */
     mirror_bit = MIRROR_MASK_C(1) << mirror->idx;
@@ -410,15 +416,17 @@ mirror_update_stats(struct mbridge *mbridge, mirror_mask_t mirrors,
  * either a null pointer if the mirror includes all VLANs or a 4096-bit bitmap
  * in which a 1-bit indicates that the mirror includes a particular VLAN,
  * '*dup_mirrors' receives a bitmap of mirrors whose output duplicates mirror
- * 'index', '*out' receives the output ofbundle (if any), and '*out_vlan'
- * receives the output VLAN (if any).
+ * 'index', '*out' receives the output ofbundle (if any), '*out_vlan'
+ * receives the output VLAN (if any), and '*meter_id' receives the provider
+ * meter that rate-limits the mirrored copies, or UINT32_MAX if the mirror is
+ * not rate-limited.
  *
  * Everything returned here is assumed to be RCU protected.
  */
 bool
 mirror_get(struct mbridge *mbridge, int index, const unsigned long **vlans,
            mirror_mask_t *dup_mirrors, struct ofbundle **out,
-           int *snaplen, int *out_vlan)
+           int *snaplen, int *out_vlan, uint32_t *meter_id)
 {
     struct mirror *mirror;
 
@@ -438,6 +446,7 @@ mirror_get(struct mbridge *mbridge, int index, const unsigned long **vlans,
     *out = mirror->out ? mirror->out->ofbundle : NULL;
     *out_vlan = mirror->out_vlan;
     *snaplen = mirror->snaplen;
+    *meter_id = mirror->meter_id;
     return true;
 }
 
@@ -34,9 +34,9 @@ static struct ovs_list expiring OVS_GUARDED_BY(mutex)
 static struct ovs_list expired OVS_GUARDED_BY(mutex)
     = OVS_LIST_INITIALIZER(&expired);
 
-static uint32_t next_id OVS_GUARDED_BY(mutex) = 1; /* Possible next free id. */
-
-#define RECIRC_POOL_STATIC_IDS 1024
+/* Possible next free id.  Claimed with an atomic increment, so allocating
+ * threads never contend on 'mutex' for an id. */
+static atomic_uint32_t next_id = ATOMIC_VAR_INIT(1);
 
 static void recirc_id_node_free(struct recirc_id_node *);
 
@@ -86,14 +86,6 @@ recirc_run(void)
 /* We use the id as the hash value, which works due to cmap internal rehashing.
  * We also only insert nodes with unique IDs, so all possible hash collisions
  * remain internal to the cmap. */
-static struct recirc_id_node *
-recirc_find__(uint32_t id)
-    OVS_REQUIRES(mutex)
-{
-    struct cmap_node *node = cmap_find_protected(&id_map, id);
-
-    return node ? CONTAINER_OF(node, struct recirc_id_node, id_node) : NULL;
-}
 
 /* Lockless RCU protected lookup.  If node is needed accross RCU quiescent
  * state, caller should copy the contents. */
@@ -238,22 +230,29 @@ recirc_alloc_id__(const struct frozen_state *state, uint32_t hash)
     ovs_refcount_init(&node->refcount);
     frozen_state_clone(CONST_CAST(struct frozen_state *, &node->state), state);
 
-    ovs_mutex_lock(&mutex);
     for (;;) {
-        /* Claim the next ID.  The ID space should be sparse enough for the
-           allocation to succeed at the first try.  We do skip the first
-           RECIRC_POOL_STATIC_IDS IDs on the later rounds, though, as some of
-           the initial allocations may be for long term uses (like bonds). */
-        node->id = next_id++;
-        if (OVS_UNLIKELY(!node->id)) {
-            next_id = RECIRC_POOL_STATIC_IDS + 1;
-            node->id = next_id++;
+        uint32_t id;
+
+        /* Claim the next ID without taking 'mutex': the atomic increment
+         * hands each allocating thread a distinct candidate, so no two
+         * in-flight allocations can race for the same id until the counter
+         * wraps all the way around, by which time the candidate has long
+         * since been inserted or discarded.  The ID space should be sparse
+         * enough for the allocation to succeed at the first try. */
+        atomic_add_relaxed(&next_id, 1, &id);
+        if (OVS_UNLIKELY(!id)) {
+            continue;       /* Zero means "no recirculation". */
         }
-        /* Find if the id is free. */
-        if (OVS_LIKELY(!recirc_find__(node->id))) {
+        /* Find if the id is free; ids claimed by long term users (like
+         * bonds) stay in 'id_map' and are skipped here after a wraparound.
+         * The RCU protected lookup is safe without 'mutex'. */
+        if (OVS_LIKELY(!recirc_id_node_find(id))) {
+            node->id = id;
             break;
         }
     }
+
+    ovs_mutex_lock(&mutex);
     cmap_insert(&id_map, &node->id_node, node->id);
     cmap_insert(&metadata_map, &node->metadata_node, node->hash);
     ovs_mutex_unlock(&mutex);
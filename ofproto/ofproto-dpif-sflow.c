@@ -25,6 +25,7 @@
 #include "collectors.h"
 #include "compiler.h"
 #include "dpif.h"
+#include "guarded-list.h"
 #include "hash.h"
 #include "openvswitch/hmap.h"
 #include "netdev.h"
@@ -35,6 +36,7 @@
 #include "openvswitch/poll-loop.h"
 #include "ovs-router.h"
 #include "route-table.h"
+#include "seq.h"
 #include "sflow_api.h"
 #include "socket-util.h"
 #include "timeval.h"
@@ -80,12 +82,42 @@ struct dpif_sflow {
     size_t n_flood, n_all;
     struct hmap ports;          /* Contains "struct dpif_sflow_port"s. */
     uint32_t probability;
+    atomic_uint max_header;     /* Configured maximum header size, readable
+                                 * without taking 'mutex'. */
     struct ovs_refcount ref_cnt;
 };
 
 static void dpif_sflow_del_port__(struct dpif_sflow *,
                                   struct dpif_sflow_port *);
 
+/* A sampled packet queued for the sFlow sample thread, so that the
+ * forwarding thread that took the sample does not pay for encoding it into a
+ * datagram.  Only the header bytes that can end up on the wire are copied. */
+struct dpif_sflow_sample {
+    struct ovs_list list_node;  /* In 'sample_queue'. */
+
+    struct dpif_sflow *ds;      /* Referenced while queued. */
+    struct flow flow;
+    odp_port_t odp_in_port;
+    struct user_action_cookie cookie;
+    struct dpif_sflow_actions sflow_actions;
+    bool have_sflow_actions;
+
+    uint32_t frame_length;      /* Original frame length, FCS excluded. */
+    uint32_t header_len;        /* Number of bytes in 'header'. */
+    uint8_t header[];
+};
+
+/* Bound on the number of queued samples.  Past it, new samples are dropped,
+ * which is acceptable for a sampling protocol and preferable to unbounded
+ * memory use when the sample thread falls behind. */
+#define SFLOW_SAMPLE_QUEUE_MAX 1024
+
+static struct guarded_list sample_queue; /* dpif_sflow_sample entries. */
+static struct seq *sample_queue_seq;     /* Incremented on enqueue. */
+
+static void *dpif_sflow_sample_thread(void *) OVS_EXCLUDED(mutex);
+
 #define RECEIVER_INDEX 1
 
 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
@@ -551,6 +583,9 @@ dpif_sflow_create(void)
 
     if (ovsthread_once_start(&once)) {
         ovs_mutex_init_recursive(&mutex);
+        guarded_list_init(&sample_queue);
+        sample_queue_seq = seq_create();
+        ovs_thread_create("sflow_sample", dpif_sflow_sample_thread, NULL);
         ovsthread_once_done(&once);
     }
 
@@ -558,6 +593,7 @@ dpif_sflow_create(void)
     ds->next_tick = time_now() + 1;
     hmap_init(&ds->ports);
     ds->probability = 0;
+    atomic_init(&ds->max_header, SFL_DEFAULT_HEADER_SIZE);
     ovs_refcount_init(&ds->ref_cnt);
 
     return ds;
@@ -814,6 +850,7 @@ dpif_sflow_set_options(struct dpif_sflow *ds,
     sampler = sfl_agent_addSampler(ds->sflow_agent, &dsi);
     sfl_sampler_set_sFlowFsPacketSamplingRate(sampler, ds->options->sampling_rate);
     sfl_sampler_set_sFlowFsMaximumHeaderSize(sampler, ds->options->header_len);
+    atomic_store_relaxed(&ds->max_header, ds->options->header_len);
     sfl_sampler_set_sFlowFsReceiver(sampler, RECEIVER_INDEX);
 
     /* Add a counter poller for the bridge so we can use it to send
@@ -1270,13 +1307,19 @@ dpif_sflow_cookie_num_outputs(const struct user_action_cookie *cookie)
     return 0;
 }
 
-void
-dpif_sflow_received(struct dpif_sflow *ds, const struct dp_packet *packet,
-                    const struct flow *flow, odp_port_t odp_in_port,
-                    const struct user_action_cookie *cookie,
-                    const struct dpif_sflow_actions *sflow_actions)
+/* Encodes 'sample' into a flow sample and hands it to the sFlow agent.
+ * Runs in the sFlow sample thread, off the forwarding threads' critical
+ * path. */
+static void
+dpif_sflow_sample__(struct dpif_sflow_sample *sample)
     OVS_EXCLUDED(mutex)
 {
+    struct dpif_sflow *ds = sample->ds;
+    const struct flow *flow = &sample->flow;
+    const struct user_action_cookie *cookie = &sample->cookie;
+    const struct dpif_sflow_actions *sflow_actions
+        = sample->have_sflow_actions ? &sample->sflow_actions : NULL;
+    odp_port_t odp_in_port = sample->odp_in_port;
     SFL_FLOW_SAMPLE_TYPE fs;
     SFLFlow_sample_element hdrElem;
     SFLSampled_header *header;
@@ -1319,12 +1362,12 @@ dpif_sflow_received(struct dpif_sflow *ds, const struct dp_packet *packet,
     header->header_protocol = SFLHEADER_ETHERNET_ISO8023;
     /* The frame_length should include the Ethernet FCS (4 bytes),
      * but it has already been stripped,  so we need to add 4 here. */
-    header->frame_length = dp_packet_size(packet) + 4;
+    header->frame_length = sample->frame_length + 4;
     /* Ethernet FCS stripped off. */
     header->stripped = 4;
-    header->header_length = MIN(dp_packet_size(packet),
+    header->header_length = MIN(sample->header_len,
                                 sampler->sFlowFsMaximumHeaderSize);
-    header->header_bytes = dp_packet_data(packet);
+    header->header_bytes = sample->header;
 
     /* Add extended switch element. */
     memset(&switchElem, 0, sizeof(switchElem));
@@ -1409,6 +1452,76 @@ out:
     ovs_mutex_unlock(&mutex);
 }
 
+static void *
+dpif_sflow_sample_thread(void *arg OVS_UNUSED)
+    OVS_EXCLUDED(mutex)
+{
+    for (;;) {
+        uint64_t seqno = seq_read(sample_queue_seq);
+        struct ovs_list samples;
+
+        if (guarded_list_pop_all(&sample_queue, &samples)) {
+            struct dpif_sflow_sample *sample, *next;
+
+            LIST_FOR_EACH_SAFE (sample, next, list_node, &samples) {
+                ovs_list_remove(&sample->list_node);
+                dpif_sflow_sample__(sample);
+                dpif_sflow_unref(sample->ds);
+                free(sample);
+            }
+        } else {
+            seq_wait(sample_queue_seq, seqno);
+            poll_block();
+        }
+    }
+
+    return NULL;
+}
+
+/* Queues the sampled 'packet' for the sFlow sample thread.  Copies out the
+ * fields the sample needs, so the caller may release 'packet' immediately and
+ * does not pay for encoding or for 'mutex'. */
+void
+dpif_sflow_received(struct dpif_sflow *ds, const struct dp_packet *packet,
+                    const struct flow *flow, odp_port_t odp_in_port,
+                    const struct user_action_cookie *cookie,
+                    const struct dpif_sflow_actions *sflow_actions)
+    OVS_EXCLUDED(mutex)
+{
+    struct dpif_sflow_sample *sample;
+    unsigned int max_header;
+    uint32_t header_len;
+
+    atomic_read_relaxed(&ds->max_header, &max_header);
+    header_len = MIN(dp_packet_size(packet), max_header);
+
+    sample = xmalloc(sizeof *sample + header_len);
+    sample->ds = dpif_sflow_ref(ds);
+    sample->flow = *flow;
+    sample->odp_in_port = odp_in_port;
+    sample->cookie = *cookie;
+    if (sflow_actions) {
+        sample->sflow_actions = *sflow_actions;
+        sample->have_sflow_actions = true;
+    } else {
+        sample->have_sflow_actions = false;
+    }
+    sample->frame_length = dp_packet_size(packet);
+    sample->header_len = header_len;
+    memcpy(sample->header, dp_packet_data(packet), header_len);
+
+    if (guarded_list_push_back(&sample_queue, &sample->list_node,
+                               SFLOW_SAMPLE_QUEUE_MAX)) {
+        seq_change(sample_queue_seq);
+    } else {
+        static struct vlog_rate_limit drop_rl = VLOG_RATE_LIMIT_INIT(1, 5);
+
+        VLOG_WARN_RL(&drop_rl, "sFlow sample queue overflow, dropping sample");
+        dpif_sflow_unref(sample->ds);
+        free(sample);
+    }
+}
+
 void
 dpif_sflow_run(struct dpif_sflow *ds) OVS_EXCLUDED(mutex)
 {
@@ -48,14 +48,21 @@
 #define UPCALL_MAX_BATCH 64
 #define REVALIDATE_MAX_BATCH 50
 
+/* Sweeps delete in much larger batches than interleaved revalidation, so
+ * that a mass invalidation clears the datapath quickly (see
+ * revalidator_sweep__()). */
+#define REVALIDATE_SWEEP_MAX_BATCH 512
+
 VLOG_DEFINE_THIS_MODULE(ofproto_dpif_upcall);
 
 COVERAGE_DEFINE(dumped_duplicate_flow);
 COVERAGE_DEFINE(dumped_new_flow);
 COVERAGE_DEFINE(handler_duplicate_upcall);
+COVERAGE_DEFINE(handler_fastpath_upcall);
 COVERAGE_DEFINE(upcall_ukey_contention);
 COVERAGE_DEFINE(upcall_ukey_replace);
 COVERAGE_DEFINE(revalidate_missed_dp_flow);
+COVERAGE_DEFINE(revalidate_port_down_skip);
 COVERAGE_DEFINE(upcall_flow_limit_hit);
 
 /* A thread that reads upcalls from dpif, forwards each upcall's packet,
@@ -137,6 +144,17 @@ struct udpif {
 
     /* Revalidation. */
     struct seq *reval_seq;             /* Incremented to force revalidation. */
+
+    /* When the most recent change to 'reval_seq' was triggered solely by a
+     * datapath port going down, a hint identifying that port, so that the
+     * revalidators can keep unaffected flows without re-translating them.
+     * The hint is valid only while 'reval_port_seq' matches the current
+     * 'reval_seq' value; 'reval_port_prev_seq' is the value that unaffected
+     * flows must still be current against.  See
+     * udpif_revalidate_port_down(). */
+    ATOMIC(odp_port_t) reval_port_down;
+    atomic_uint64_t reval_port_prev_seq;
+    atomic_uint64_t reval_port_seq;
     bool reval_exit;                   /* Set by leader on 'exit_latch. */
     struct ovs_barrier reval_barrier;  /* Barrier used by revalidators. */
     struct dpif_flow_dump *dump;       /* DPIF flow dump state. */
@@ -232,9 +250,14 @@ struct upcall {
     struct dpif_ipfix *ipfix;      /* IPFIX pointer or NULL. */
     struct dpif_sflow *sflow;      /* SFlow pointer or NULL. */
 
+    struct xlate_learn_batch *learn_batch; /* Handler's staging buffer for
+                                              learned flows, or NULL. */
+
     struct udpif_key *ukey;        /* Revalidator flow cache. */
     bool ukey_persists;            /* Set true to keep 'ukey' beyond the
                                       lifetime of this upcall. */
+    bool fastpath;                 /* Actions were reused from an existing
+                                      ukey without translation. */
 
     uint64_t reval_seq;            /* udpif->reval_seq at translation time. */
 
@@ -283,6 +306,9 @@ struct udpif_key {
     bool ufid_present;             /* True if 'ufid' is in datapath. */
     uint32_t hash;                 /* Pre-computed hash for 'key'. */
     unsigned pmd_id;               /* Datapath poll mode driver id. */
+    struct flow flow;              /* 'key' decoded into a flow, so that each
+                                    * revalidation need not re-parse it. */
+    enum odp_key_fitness key_fitness; /* Fitness of 'flow' relative to 'key'. */
 
     struct ovs_mutex mutex;                   /* Guards the following. */
     struct dpif_flow_stats stats OVS_GUARDED; /* Last known stats.*/
@@ -446,6 +472,9 @@ udpif_create(struct dpif_backer *backer, struct dpif *dpif)
     udpif->backer = backer;
     atomic_init(&udpif->flow_limit, MIN(ofproto_flow_limit, 10000));
     udpif->reval_seq = seq_create();
+    atomic_init(&udpif->reval_port_down, ODPP_NONE);
+    atomic_init(&udpif->reval_port_prev_seq, 0);
+    atomic_init(&udpif->reval_port_seq, 0);
     udpif->dump_seq = seq_create();
     latch_init(&udpif->exit_latch);
     latch_init(&udpif->pause_latch);
@@ -659,6 +688,24 @@ udpif_revalidate(struct udpif *udpif)
     seq_change(udpif->reval_seq);
 }
 
+/* Like udpif_revalidate(), but for the case where the only change since
+ * revalidation was last triggered is datapath port 'odp_port' going down.
+ * Revalidators may then keep flows that were current before the change and
+ * that neither match on nor send packets to 'odp_port', without
+ * re-translating them. */
+void
+udpif_revalidate_port_down(struct udpif *udpif, odp_port_t odp_port)
+{
+    /* Invalidate the hint before publishing the new one so that readers,
+     * which read the port first and validate 'reval_port_seq' afterwards,
+     * never pair a fresh port with a stale sequence number. */
+    atomic_store(&udpif->reval_port_seq, 0);
+    atomic_store(&udpif->reval_port_down, odp_port);
+    atomic_store(&udpif->reval_port_prev_seq, seq_read(udpif->reval_seq));
+    seq_change(udpif->reval_seq);
+    atomic_store(&udpif->reval_port_seq, seq_read(udpif->reval_seq));
+}
+
 /* Returns a seq which increments every time 'udpif' pulls stats from the
  * datapath.  Callers can use this to get a sense of when might be a good time
  * to do periodic work which relies on relatively up to date statistics. */
@@ -758,6 +805,53 @@ udpif_upcall_handler(void *arg)
     return NULL;
 }
 
+/* Attempts to handle 'upcall', which must be a flow miss, by reusing the
+ * translation behind a still-current ukey for the same flow.  A burst of
+ * packets in a new flow produces a thundering herd of identical misses in
+ * the window between the first miss and its datapath flow install, and each
+ * of them is otherwise translated from scratch only to find at install time
+ * that the ukey already exists.
+ *
+ * On success, copies the ukey's datapath actions into 'upcall->odp_actions'
+ * and returns true; since these are the verbatim actions of the installed
+ * (or about to be installed) datapath flow, executing the packet with them
+ * is equivalent to the packet having hit that flow.  The statistics and MAC
+ * learning attribution that translation would have performed are skipped
+ * for such packets, which is bounded by the flow setup window.
+ *
+ * Returns false if there is no suitable ukey, it is contended, or it might
+ * be stale, in which case the caller should translate as usual. */
+static bool
+upcall_fastpath(struct udpif *udpif, struct upcall *upcall)
+{
+    struct udpif_key *ukey;
+    bool fastpath = false;
+
+    if (upcall->type != MISS_UPCALL) {
+        return false;
+    }
+
+    ukey = ukey_lookup(udpif, upcall->ufid, upcall->pmd_id);
+    if (!ukey || ovs_mutex_trylock(&ukey->mutex)) {
+        return false;
+    }
+
+    if ((ukey->state == UKEY_VISIBLE || ukey->state == UKEY_OPERATIONAL)
+        && ukey->reval_seq == seq_read(udpif->reval_seq)) {
+        const struct nlattr *actions;
+        size_t actions_len;
+
+        ukey_get_actions(ukey, &actions, &actions_len);
+        ofpbuf_put(&upcall->odp_actions, actions, actions_len);
+        upcall->fastpath = true;
+        fastpath = true;
+        COVERAGE_INC(handler_fastpath_upcall);
+    }
+    ovs_mutex_unlock(&ukey->mutex);
+
+    return fastpath;
+}
+
 static size_t
 recv_upcalls(struct handler *handler)
 {
@@ -767,8 +861,10 @@ recv_upcalls(struct handler *handler)
     struct dpif_upcall dupcalls[UPCALL_MAX_BATCH];
     struct upcall upcalls[UPCALL_MAX_BATCH];
     struct flow flows[UPCALL_MAX_BATCH];
+    struct xlate_learn_batch learn_batch;
     size_t n_upcalls, i;
 
+    xlate_learn_batch_init(&learn_batch);
     n_upcalls = 0;
     while (n_upcalls < UPCALL_MAX_BATCH) {
         struct ofpbuf *recv_buf = &recv_bufs[n_upcalls];
@@ -829,6 +925,15 @@ recv_upcalls(struct handler *handler)
         pkt_metadata_from_flow(&dupcall->packet.md, flow);
         flow_extract(&dupcall->packet, flow);
 
+        OVS_USDT_PROBE(recv_upcalls, recv_upcall, udpif, dupcall->type,
+                       &dupcall->packet, flow, &dupcall->ufid);
+
+        if (upcall_fastpath(udpif, upcall)) {
+            n_upcalls++;
+            continue;
+        }
+
+        upcall->learn_batch = &learn_batch;
         error = process_upcall(udpif, upcall,
                                &upcall->odp_actions, &upcall->wc);
         if (error) {
@@ -845,6 +950,9 @@ free_dupcall:
         ofpbuf_uninit(recv_buf);
     }
 
+    /* Install the flows learned while translating this batch. */
+    xlate_learn_batch_flush(&learn_batch);
+
     if (n_upcalls) {
         handle_upcalls(handler->udpif, upcalls, n_upcalls);
         for (i = 0; i < n_upcalls; i++) {
@@ -1138,6 +1246,8 @@ upcall_receive(struct upcall *upcall, const struct dpif_backer *backer,
 
     upcall->xout_initialized = false;
     upcall->ukey_persists = false;
+    upcall->fastpath = false;
+    upcall->learn_batch = NULL;
 
     upcall->ukey = NULL;
     upcall->key = NULL;
@@ -1168,6 +1278,7 @@ upcall_xlate(struct udpif *udpif, struct upcall *upcall,
                   ofproto_dpif_get_tables_version(upcall->ofproto),
                   upcall->flow, upcall->ofp_in_port, NULL,
                   stats.tcp_flags, upcall->packet, wc, odp_actions);
+    xin.learn_batch = upcall->learn_batch;
 
     if (upcall->type == MISS_UPCALL) {
         xin.resubmit_stats = &stats;
@@ -1575,7 +1686,7 @@ handle_upcalls(struct udpif *udpif, struct upcall *upcalls,
         const struct dp_packet *packet = upcall->packet;
         struct ukey_op *op;
 
-        if (should_install_flow(udpif, upcall)) {
+        if (!upcall->fastpath && should_install_flow(udpif, upcall)) {
             struct udpif_key *ukey = upcall->ukey;
 
             if (ukey_install(udpif, ukey)) {
@@ -1594,7 +1705,8 @@ handle_upcalls(struct udpif *udpif, struct upcall *upcalls,
                                  op->dop.execute.packet);
             op->dop.execute.actions = upcall->odp_actions.data;
             op->dop.execute.actions_len = upcall->odp_actions.size;
-            op->dop.execute.needs_help = (upcall->xout.slow & SLOW_ACTION) != 0;
+            op->dop.execute.needs_help = !upcall->fastpath
+                && (upcall->xout.slow & SLOW_ACTION) != 0;
             op->dop.execute.probe = false;
             op->dop.execute.mtu = upcall->mru;
             op->dop.execute.hash = upcall->hash;
@@ -1676,11 +1788,16 @@ ukey_create__(const struct nlattr *key, size_t key_len,
               uint32_t key_recirc_id, struct xlate_out *xout)
     OVS_NO_THREAD_SAFETY_ANALYSIS
 {
-    struct udpif_key *ukey = xmalloc(sizeof *ukey);
+    struct udpif_key *ukey = xmalloc_tag(sizeof *ukey, MEM_TAG_UKEY);
 
     memcpy(&ukey->keybuf, key, key_len);
     ukey->key = &ukey->keybuf.nla;
     ukey->key_len = key_len;
+    /* Decode the key once up front: revalidation passes can then translate
+     * straight from the cached flow instead of re-parsing the netlink
+     * attributes for every pass. */
+    ukey->key_fitness = odp_flow_key_to_flow(ukey->key, key_len, &ukey->flow,
+                                             NULL);
     memcpy(&ukey->maskbuf, mask, mask_len);
     ukey->mask = &ukey->maskbuf.nla;
     ukey->mask_len = mask_len;
@@ -2011,7 +2128,7 @@ ukey_delete__(struct udpif_key *ukey)
         xlate_cache_delete(ukey->xcache);
         ofpbuf_delete(ovsrcu_get(struct ofpbuf *, &ukey->actions));
         ovs_mutex_destroy(&ukey->mutex);
-        free(ukey);
+        free_tag(ukey);
     }
 }
 
@@ -2076,34 +2193,34 @@ struct reval_context {
     /* Required output parameters */
     struct xlate_out xout;
     struct flow flow;
+    struct ofproto_dpif *ofproto; /* Bridge the flow was looked up in. */
+    ofp_port_t ofp_in_port;
 };
 
-/* Translates 'key' into a flow, populating 'ctx' as it goes along.
+/* Translates the flow already decoded into 'ctx->flow', whose fitness
+ * relative to its datapath key is 'fitness', populating the rest of 'ctx' as
+ * it goes along.
  *
  * Returns 0 on success, otherwise a positive errno value.
  *
  * The caller is responsible for uninitializing ctx->xout on success.
  */
 static int
-xlate_key(struct udpif *udpif, const struct nlattr *key, unsigned int len,
-          const struct dpif_flow_stats *push, struct reval_context *ctx)
+xlate_flow(struct udpif *udpif, enum odp_key_fitness fitness,
+           const struct dpif_flow_stats *push, struct reval_context *ctx)
 {
     struct ofproto_dpif *ofproto;
     ofp_port_t ofp_in_port;
-    enum odp_key_fitness fitness;
     struct xlate_in xin;
     int error;
 
-    fitness = odp_flow_key_to_flow(key, len, &ctx->flow, NULL);
-    if (fitness == ODP_FIT_ERROR) {
-        return EINVAL;
-    }
-
     error = xlate_lookup(udpif->backer, &ctx->flow, &ofproto, NULL, NULL,
                          ctx->netflow, &ofp_in_port);
     if (error) {
         return error;
     }
+    ctx->ofproto = ofproto;
+    ctx->ofp_in_port = ofp_in_port;
 
     xlate_in_init(&xin, ofproto, ofproto_dpif_get_tables_version(ofproto),
                   &ctx->flow, ofp_in_port, NULL, push->tcp_flags,
@@ -2121,6 +2238,26 @@ xlate_key(struct udpif *udpif, const struct nlattr *key, unsigned int len,
     return 0;
 }
 
+/* Translates 'key' into a flow, populating 'ctx' as it goes along.
+ *
+ * Returns 0 on success, otherwise a positive errno value.
+ *
+ * The caller is responsible for uninitializing ctx->xout on success.
+ */
+static int
+xlate_key(struct udpif *udpif, const struct nlattr *key, unsigned int len,
+          const struct dpif_flow_stats *push, struct reval_context *ctx)
+{
+    enum odp_key_fitness fitness;
+
+    fitness = odp_flow_key_to_flow(key, len, &ctx->flow, NULL);
+    if (fitness == ODP_FIT_ERROR) {
+        return EINVAL;
+    }
+
+    return xlate_flow(udpif, fitness, push, ctx);
+}
+
 static int
 xlate_ukey(struct udpif *udpif, const struct udpif_key *ukey,
            uint16_t tcp_flags, struct reval_context *ctx)
@@ -2128,7 +2265,15 @@ xlate_ukey(struct udpif *udpif, const struct udpif_key *ukey,
     struct dpif_flow_stats push = {
         .tcp_flags = tcp_flags,
     };
-    return xlate_key(udpif, ukey->key, ukey->key_len, &push, ctx);
+
+    if (ukey->key_fitness == ODP_FIT_ERROR) {
+        return EINVAL;
+    }
+
+    /* Use the flow cached at ukey creation rather than re-parsing the
+     * netlink key on every revalidation pass. */
+    ctx->flow = ukey->flow;
+    return xlate_flow(udpif, ukey->key_fitness, &push, ctx);
 }
 
 static int
@@ -2184,20 +2329,14 @@ revalidate_ukey__(struct udpif *udpif, const struct udpif_key *ukey,
     }
 
     if (xoutp->slow) {
-        struct ofproto_dpif *ofproto;
-        ofp_port_t ofp_in_port;
-
-        ofproto = xlate_lookup_ofproto(udpif->backer, &ctx.flow, &ofp_in_port,
-                                       NULL);
+        /* The bridge was already looked up during translation; no need to
+         * search the backer for it a second time. */
+        struct ofproto_dpif *ofproto = ctx.ofproto;
 
         ofpbuf_clear(odp_actions);
 
-        if (!ofproto) {
-            goto exit;
-        }
-
         compose_slow_path(udpif, xoutp, ctx.flow.in_port.odp_port,
-                          ofp_in_port, odp_actions,
+                          ctx.ofp_in_port, odp_actions,
                           ofproto->up.slowpath_meter_id, &ofproto->uuid);
     }
 
@@ -2236,6 +2375,149 @@ exit:
     return result;
 }
 
+/* Obtains the port-down revalidation hint for the revalidation round
+ * identified by 'reval_seq', if there is one.  Returns the downed port, or
+ * ODPP_NONE if the round was triggered by anything else.  On success stores
+ * in '*prev_seq' the reval_seq value that unaffected flows must still be
+ * current against to be kept without re-translation. */
+static odp_port_t
+udpif_get_reval_port_down(struct udpif *udpif, uint64_t reval_seq,
+                          uint64_t *prev_seq)
+{
+    odp_port_t port;
+    uint64_t port_seq;
+
+    atomic_read(&udpif->reval_port_down, &port);
+    atomic_read(&udpif->reval_port_prev_seq, prev_seq);
+    atomic_read(&udpif->reval_port_seq, &port_seq);
+
+    return port_seq == reval_seq ? port : ODPP_NONE;
+}
+
+/* Returns true if any action within 'actions' might send packets to datapath
+ * port 'port'.  Errs on the side of caution: action types that this function
+ * does not recognize count as a possible reference. */
+static bool
+odp_actions_may_use_port(const struct nlattr *actions, size_t actions_len,
+                         odp_port_t port)
+{
+    const struct nlattr *a;
+    unsigned int left;
+
+    NL_ATTR_FOR_EACH (a, left, actions, actions_len) {
+        const struct nlattr *b;
+        unsigned int left_b;
+
+        enum ovs_action_attr type = nl_attr_type(a);
+
+        switch (type) {
+        case OVS_ACTION_ATTR_OUTPUT:
+        case OVS_ACTION_ATTR_TUNNEL_POP:
+            if (nl_attr_get_odp_port(a) == port) {
+                return true;
+            }
+            break;
+
+        case OVS_ACTION_ATTR_TUNNEL_PUSH: {
+            const struct ovs_action_push_tnl *data = nl_attr_get(a);
+
+            if (u32_to_odp(data->tnl_port) == port
+                || u32_to_odp(data->out_port) == port) {
+                return true;
+            }
+            break;
+        }
+
+        case OVS_ACTION_ATTR_CLONE:
+            if (odp_actions_may_use_port(nl_attr_get(a), nl_attr_get_size(a),
+                                         port)) {
+                return true;
+            }
+            break;
+
+        case OVS_ACTION_ATTR_SAMPLE:
+            NL_ATTR_FOR_EACH (b, left_b, nl_attr_get(a), nl_attr_get_size(a)) {
+                if (nl_attr_type(b) == OVS_SAMPLE_ATTR_ACTIONS
+                    && odp_actions_may_use_port(nl_attr_get(b),
+                                                nl_attr_get_size(b), port)) {
+                    return true;
+                }
+            }
+            break;
+
+        case OVS_ACTION_ATTR_CHECK_PKT_LEN:
+            NL_ATTR_FOR_EACH (b, left_b, nl_attr_get(a), nl_attr_get_size(a)) {
+                int subtype = nl_attr_type(b);
+
+                if ((subtype == OVS_CHECK_PKT_LEN_ATTR_ACTIONS_IF_GREATER
+                     || subtype == OVS_CHECK_PKT_LEN_ATTR_ACTIONS_IF_LESS_EQUAL)
+                    && odp_actions_may_use_port(nl_attr_get(b),
+                                                nl_attr_get_size(b), port)) {
+                    return true;
+                }
+            }
+            break;
+
+        case OVS_ACTION_ATTR_USERSPACE:
+        case OVS_ACTION_ATTR_SET:
+        case OVS_ACTION_ATTR_SET_MASKED:
+        case OVS_ACTION_ATTR_PUSH_VLAN:
+        case OVS_ACTION_ATTR_POP_VLAN:
+        case OVS_ACTION_ATTR_RECIRC:
+        case OVS_ACTION_ATTR_HASH:
+        case OVS_ACTION_ATTR_PUSH_MPLS:
+        case OVS_ACTION_ATTR_POP_MPLS:
+        case OVS_ACTION_ATTR_CT:
+        case OVS_ACTION_ATTR_CT_CLEAR:
+        case OVS_ACTION_ATTR_TRUNC:
+        case OVS_ACTION_ATTR_PUSH_ETH:
+        case OVS_ACTION_ATTR_POP_ETH:
+        case OVS_ACTION_ATTR_PUSH_NSH:
+        case OVS_ACTION_ATTR_POP_NSH:
+        case OVS_ACTION_ATTR_METER:
+        case OVS_ACTION_ATTR_STICKY_LEARN:
+        case OVS_ACTION_ATTR_STICKY_LOOKUP:
+        case OVS_ACTION_ATTR_DROP:
+            /* Never forwards to a port. */
+            break;
+
+        case OVS_ACTION_ATTR_LB_OUTPUT:
+            /* Outputs to a bond member chosen per packet, which could be
+             * any port. */
+        case OVS_ACTION_ATTR_UNSPEC:
+        case __OVS_ACTION_ATTR_MAX:
+        default:
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Returns true if the translation of 'ukey' could be affected by datapath
+ * port 'port' going down, that is, if the flow was received on 'port' (the
+ * input port's liveness can steer bonding and the NORMAL action) or if its
+ * actions may send packets to it. */
+static bool
+ukey_may_use_port(struct udpif_key *ukey, odp_port_t port)
+    OVS_REQUIRES(ukey->mutex)
+{
+    const struct nlattr *actions;
+    const struct nlattr *a;
+    size_t actions_len;
+    unsigned int left;
+
+    NL_ATTR_FOR_EACH (a, left, ukey->key, ukey->key_len) {
+        if (nl_attr_type(a) == OVS_KEY_ATTR_IN_PORT
+            && nl_attr_get_odp_port(a) == port) {
+            return true;
+        }
+    }
+
+    ukey_get_actions(ukey, &actions, &actions_len);
+    return odp_actions_may_use_port(actions, actions_len, port);
+}
+
 /* Verifies that the datapath actions of 'ukey' are still correct, and pushes
  * 'stats' for it.
  *
@@ -2253,15 +2535,30 @@ exit:
  *
  * The caller is responsible for both initializing 'recircs' prior this call,
  * and ensuring any references are eventually freed.
+ *
+ * If 'reval_port_down' is not ODPP_NONE, the only change since the
+ * 'reval_prev_seq' revalidation round is that datapath port going down, and
+ * flows that provably cannot be affected by it are kept without
+ * re-translation.
  */
 static enum reval_result
 revalidate_ukey(struct udpif *udpif, struct udpif_key *ukey,
                 const struct dpif_flow_stats *stats,
                 struct ofpbuf *odp_actions, uint64_t reval_seq,
+                odp_port_t reval_port_down, uint64_t reval_prev_seq,
                 struct recirc_refs *recircs, bool offloaded)
     OVS_REQUIRES(ukey->mutex)
 {
     bool need_revalidate = ukey->reval_seq != reval_seq;
+
+    if (need_revalidate && reval_port_down != ODPP_NONE
+        && ukey->reval_seq == reval_prev_seq
+        && !ukey_may_use_port(ukey, reval_port_down)) {
+        /* The flow was current before the port went down and does not
+         * reference the port, so its translation cannot have changed. */
+        COVERAGE_INC(revalidate_port_down_skip);
+        need_revalidate = false;
+    }
     enum reval_result result = UKEY_DELETE;
     struct dpif_flow_stats push;
 
@@ -2298,6 +2595,9 @@ revalidate_ukey(struct udpif *udpif, struct udpif_key *ukey,
         ukey->reval_seq = reval_seq;
     }
 
+    OVS_USDT_PROBE(revalidate_ukey, flow_result, udpif, ukey, result,
+                   need_revalidate);
+
     return result;
 }
 
@@ -2346,19 +2646,51 @@ put_op_init(struct ukey_op *op, struct udpif_key *ukey,
                      &op->dop.flow_put.actions_len);
 }
 
-/* Executes datapath operations 'ops' and attributes stats retrieved from the
- * datapath as part of those operations. */
+/* Orders flow deletions so that those bound for the same PMD are adjacent,
+ * which lets dpif-netdev take each PMD's flow table lock once per run
+ * instead of once per flow.  Other operations keep their original order,
+ * using the pointer values as a tiebreak (the pointers index into a single
+ * array, so their order is the submission order). */
+static int
+dp_op_pmd_cmp(const void *a_, const void *b_)
+{
+    const struct dpif_op *const *ap = a_, *const *bp = b_;
+    const struct dpif_op *a = *ap, *b = *bp;
+    bool a_del = a->type == DPIF_OP_FLOW_DEL;
+    bool b_del = b->type == DPIF_OP_FLOW_DEL;
+
+    if (a_del != b_del) {
+        return a_del ? 1 : -1;
+    }
+    if (a_del && a->flow_del.pmd_id != b->flow_del.pmd_id) {
+        return a->flow_del.pmd_id < b->flow_del.pmd_id ? -1 : 1;
+    }
+    return a < b ? -1 : a > b;
+}
+
+/* Executes datapath operations 'ops'.  The operations must apply to
+ * distinct flows, since they may be reordered to group deletions per
+ * PMD. */
 static void
-push_dp_ops(struct udpif *udpif, struct ukey_op *ops, size_t n_ops)
+dp_ops_execute(struct udpif *udpif, struct ukey_op *ops, size_t n_ops)
 {
-    struct dpif_op *opsp[REVALIDATE_MAX_BATCH];
+    struct dpif_op **opsp = xmalloc(n_ops * sizeof *opsp);
     size_t i;
 
-    ovs_assert(n_ops <= REVALIDATE_MAX_BATCH);
     for (i = 0; i < n_ops; i++) {
         opsp[i] = &ops[i].dop;
     }
+    qsort(opsp, n_ops, sizeof *opsp, dp_op_pmd_cmp);
     dpif_operate(udpif->dpif, opsp, n_ops, DPIF_OFFLOAD_AUTO);
+    free(opsp);
+}
+
+/* Attributes stats retrieved from the datapath as part of already executed
+ * operations 'ops', and transitions the ukeys of deleted flows. */
+static void
+dp_ops_attribute(struct udpif *udpif, struct ukey_op *ops, size_t n_ops)
+{
+    size_t i;
 
     for (i = 0; i < n_ops; i++) {
         struct ukey_op *op = &ops[i];
@@ -2430,6 +2762,15 @@ push_dp_ops(struct udpif *udpif, struct ukey_op *ops, size_t n_ops)
     }
 }
 
+/* Executes datapath operations 'ops' and attributes stats retrieved from the
+ * datapath as part of those operations. */
+static void
+push_dp_ops(struct udpif *udpif, struct ukey_op *ops, size_t n_ops)
+{
+    dp_ops_execute(udpif, ops, n_ops);
+    dp_ops_attribute(udpif, ops, n_ops);
+}
+
 /* Executes datapath operations 'ops', attributes stats retrieved from the
  * datapath, and deletes ukeys corresponding to deleted flows. */
 static void
@@ -2604,11 +2945,14 @@ revalidate(struct revalidator *revalidator)
 
     struct udpif *udpif = revalidator->udpif;
     struct dpif_flow_dump_thread *dump_thread;
-    uint64_t dump_seq, reval_seq;
+    uint64_t dump_seq, reval_seq, reval_prev_seq;
+    odp_port_t reval_port_down;
     unsigned int flow_limit;
 
     dump_seq = seq_read(udpif->dump_seq);
     reval_seq = seq_read(udpif->reval_seq);
+    reval_port_down = udpif_get_reval_port_down(udpif, reval_seq,
+                                                &reval_prev_seq);
     atomic_read_relaxed(&udpif->flow_limit, &flow_limit);
     dump_thread = dpif_flow_dump_thread_create(udpif->dump);
     for (;;) {
@@ -2706,7 +3050,8 @@ revalidate(struct revalidator *revalidator)
                 result = UKEY_DELETE;
             } else {
                 result = revalidate_ukey(udpif, ukey, &stats, &odp_actions,
-                                         reval_seq, &recircs,
+                                         reval_seq, reval_port_down,
+                                         reval_prev_seq, &recircs,
                                          f->attrs.offloaded);
             }
             ukey->dump_seq = dump_seq;
@@ -2745,16 +3090,28 @@ revalidator_pause(struct revalidator *revalidator)
     ovs_barrier_block(&revalidator->udpif->pause_barrier);
 }
 
+/* A block of executed datapath operations whose stats attribution and ukey
+ * cleanup have been deferred until the datapath has been swept (see
+ * revalidator_sweep__()). */
+struct sweep_op_block {
+    struct ovs_list list_node;
+    size_t n_ops;
+    struct ukey_op ops[REVALIDATE_SWEEP_MAX_BATCH];
+};
+
 static void
 revalidator_sweep__(struct revalidator *revalidator, bool purge)
 {
     struct udpif *udpif;
-    uint64_t dump_seq, reval_seq;
+    uint64_t dump_seq, reval_seq, reval_prev_seq;
+    odp_port_t reval_port_down;
     int slice;
 
     udpif = revalidator->udpif;
     dump_seq = seq_read(udpif->dump_seq);
     reval_seq = seq_read(udpif->reval_seq);
+    reval_port_down = udpif_get_reval_port_down(udpif, reval_seq,
+                                                &reval_prev_seq);
     slice = revalidator - udpif->revalidators;
     ovs_assert(slice < udpif->n_revalidators);
 
@@ -2762,7 +3119,9 @@ revalidator_sweep__(struct revalidator *revalidator, bool purge)
         uint64_t odp_actions_stub[1024 / 8];
         struct ofpbuf odp_actions = OFPBUF_STUB_INITIALIZER(odp_actions_stub);
 
-        struct ukey_op ops[REVALIDATE_MAX_BATCH];
+        struct ovs_list executed = OVS_LIST_INITIALIZER(&executed);
+        struct sweep_op_block *block = xmalloc(sizeof *block);
+        struct ukey_op *ops = block->ops;
         struct udpif_key *ukey;
         struct umap *umap = &udpif->ukeys[i];
         size_t n_ops = 0;
@@ -2792,7 +3151,8 @@ revalidator_sweep__(struct revalidator *revalidator, bool purge)
                     COVERAGE_INC(revalidate_missed_dp_flow);
                     memset(&stats, 0, sizeof stats);
                     result = revalidate_ukey(udpif, ukey, &stats, &odp_actions,
-                                             reval_seq, &recircs, false);
+                                             reval_seq, reval_port_down,
+                                             reval_prev_seq, &recircs, false);
                 }
                 if (result != UKEY_KEEP) {
                     /* Clears 'recircs' if filled by revalidate_ukey(). */
@@ -2810,16 +3170,39 @@ revalidator_sweep__(struct revalidator *revalidator, bool purge)
                 ovs_mutex_unlock(&umap->mutex);
             }
 
-            if (n_ops == REVALIDATE_MAX_BATCH) {
-                /* Update/delete missed flows and clean up corresponding ukeys
-                 * if necessary. */
-                push_ukey_ops(udpif, umap, ops, n_ops);
+            if (n_ops == REVALIDATE_SWEEP_MAX_BATCH) {
+                /* Clear the datapath now; defer stats attribution and ukey
+                 * cleanup until the whole map has been swept, so that stale
+                 * flows stop forwarding as soon as possible. */
+                block->n_ops = n_ops;
+                dp_ops_execute(udpif, block->ops, block->n_ops);
+                ovs_list_push_back(&executed, &block->list_node);
+                block = xmalloc(sizeof *block);
+                ops = block->ops;
                 n_ops = 0;
             }
         }
 
         if (n_ops) {
-            push_ukey_ops(udpif, umap, ops, n_ops);
+            block->n_ops = n_ops;
+            dp_ops_execute(udpif, block->ops, block->n_ops);
+            ovs_list_push_back(&executed, &block->list_node);
+        } else {
+            free(block);
+        }
+
+        /* The datapath no longer forwards with the stale flows; attribute
+         * their final stats and drop their ukeys at leisure. */
+        LIST_FOR_EACH_POP (block, list_node, &executed) {
+            dp_ops_attribute(udpif, block->ops, block->n_ops);
+            ovs_mutex_lock(&umap->mutex);
+            for (size_t j = 0; j < block->n_ops; j++) {
+                if (block->ops[j].dop.type == DPIF_OP_FLOW_DEL) {
+                    ukey_delete(umap, block->ops[j].ukey);
+                }
+            }
+            ovs_mutex_unlock(&umap->mutex);
+            free(block);
         }
 
         ofpbuf_uninit(&odp_actions);
@@ -2849,7 +3232,7 @@ dp_purge_cb(void *aux, unsigned pmd_id)
 
     udpif_pause_revalidators(udpif);
     for (i = 0; i < N_UMAPS; i++) {
-        struct ukey_op ops[REVALIDATE_MAX_BATCH];
+        struct ukey_op *ops = xmalloc(REVALIDATE_SWEEP_MAX_BATCH * sizeof *ops);
         struct udpif_key *ukey;
         struct umap *umap = &udpif->ukeys[i];
         size_t n_ops = 0;
@@ -2859,7 +3242,7 @@ dp_purge_cb(void *aux, unsigned pmd_id)
                 delete_op_init(udpif, &ops[n_ops++], ukey);
                 transition_ukey(ukey, UKEY_EVICTING);
 
-                if (n_ops == REVALIDATE_MAX_BATCH) {
+                if (n_ops == REVALIDATE_SWEEP_MAX_BATCH) {
                     push_ukey_ops(udpif, umap, ops, n_ops);
                     n_ops = 0;
                 }
@@ -2870,6 +3253,7 @@ dp_purge_cb(void *aux, unsigned pmd_id)
             push_ukey_ops(udpif, umap, ops, n_ops);
         }
 
+        free(ops);
         ovsrcu_quiesce();
     }
     udpif_resume_revalidators(udpif);
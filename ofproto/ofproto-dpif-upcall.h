@@ -17,6 +17,8 @@
 
 #include <stddef.h>
 
+#include "openvswitch/types.h"
+
 struct dpif;
 struct dpif_backer;
 struct dpif_upcall;
@@ -35,6 +37,7 @@ void udpif_set_threads(struct udpif *, size_t n_handlers,
                        size_t n_revalidators);
 void udpif_destroy(struct udpif *);
 void udpif_revalidate(struct udpif *);
+void udpif_revalidate_port_down(struct udpif *, odp_port_t odp_port);
 void udpif_get_memory_usage(struct udpif *, struct simap *usage);
 struct seq *udpif_dump_seq(struct udpif *);
 void udpif_flush(struct udpif *);
@@ -51,13 +51,14 @@ VLOG_DEFINE_THIS_MODULE(ofproto_xlate_cache);
 void
 xlate_cache_init(struct xlate_cache *xcache)
 {
-    ofpbuf_init(&xcache->entries, 120);
+    ofpbuf_use_stub(&xcache->entries, xcache->entries_stub,
+                    sizeof xcache->entries_stub);
 }
 
 struct xlate_cache *
 xlate_cache_new(void)
 {
-    struct xlate_cache *xcache = xmalloc(sizeof *xcache);
+    struct xlate_cache *xcache = xmalloc_tag(sizeof *xcache, MEM_TAG_XLATE);
     xlate_cache_init(xcache);
     return xcache;
 }
@@ -278,7 +279,7 @@ void
 xlate_cache_delete(struct xlate_cache *xcache)
 {
     xlate_cache_uninit(xcache);
-    free(xcache);
+    free_tag(xcache);
 }
 
 /* Append all the entries in src into dst and remove them from src.
@@ -137,6 +137,7 @@ struct xc_entry {
 
 struct xlate_cache {
     struct ofpbuf entries;
+    uint64_t entries_stub[1024 / 8];
 };
 
 void xlate_cache_init(struct xlate_cache *);
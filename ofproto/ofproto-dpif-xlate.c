@@ -1177,17 +1177,20 @@ xlate_xport_copy(struct xbridge *xbridge, struct xbundle *xbundle,
  *     ...
  *     xlate_txn_commit();
  *
- * The ovsrcu_synchronize() call here also ensures that the upcall threads
- * retain no references to anything in the previous configuration.
- */
+ * The previous configuration is destroyed via ovsrcu_postpone() rather than
+ * synchronously: upcall threads translating against it keep it alive until
+ * they quiesce, and the main thread does not stall for a grace period on
+ * every topology change, which used to show up as an upcall latency spike
+ * whenever a port was added. */
 void
 xlate_txn_commit(void)
 {
     struct xlate_cfg *xcfg = ovsrcu_get(struct xlate_cfg *, &xcfgp);
 
     ovsrcu_set(&xcfgp, new_xcfg);
-    ovsrcu_synchronize();
-    xlate_xcfg_free(xcfg);
+    if (xcfg) {
+        ovsrcu_postpone(xlate_xcfg_free, xcfg);
+    }
     new_xcfg = NULL;
 }
 
@@ -1952,6 +1955,28 @@ group_first_live_bucket(const struct xlate_ctx *ctx,
     return NULL;
 }
 
+/* Looks up 'hash' in the precomputed hash mapping table of 'group'.
+ *
+ * Starting from the masked hash value, iterates over the mapping table to
+ * find the first live bucket.  As the buckets are quasi-randomly spread
+ * over the hash values, this maintains a distribution according to bucket
+ * weights even when some buckets are non-live. */
+static struct ofputil_bucket *
+group_hash_map_bucket(const struct xlate_ctx *ctx,
+                      const struct group_dpif *group, uint32_t hash)
+{
+    uint32_t hash_mask = group->hash_mask;
+
+    for (int i = 0; i <= hash_mask; i++) {
+        struct ofputil_bucket *b = group->hash_map[(hash + i) & hash_mask];
+        if (bucket_is_alive(ctx, b, 0)) {
+            return b;
+        }
+    }
+
+    return NULL;
+}
+
 static struct ofputil_bucket *
 group_best_live_bucket(const struct xlate_ctx *ctx,
                        const struct group_dpif *group,
@@ -2121,13 +2146,14 @@ mirror_packet(struct xlate_ctx *ctx, struct xbundle *xbundle,
         const unsigned long *vlans;
         mirror_mask_t dup_mirrors;
         struct ofbundle *out;
+        uint32_t meter_id;
         int out_vlan;
         int snaplen;
 
         /* Get the details of the mirror represented by the rightmost 1-bit. */
         ovs_assert(mirror_get(xbridge->mbridge, raw_ctz(mirrors),
                               &vlans, &dup_mirrors,
-                              &out, &snaplen, &out_vlan));
+                              &out, &snaplen, &out_vlan, &meter_id));
 
 
         /* If this mirror selects on the basis of VLAN, and it does not select
@@ -2150,6 +2176,22 @@ mirror_packet(struct xlate_ctx *ctx, struct xbundle *xbundle,
         ctx->mirrors |= dup_mirrors;
         ctx->mirror_snaplen = snaplen;
 
+        /* If the mirror is rate-limited, wrap its outputs in
+         * clone(meter(id), ...), so that packets over the mirror's budget
+         * are dropped from the mirrored copy only and the primary path is
+         * never affected.  Actions committed inside the clone do not leak
+         * out of it, so 'base_flow' is restored afterwards. */
+        size_t clone_ofs = 0;
+        bool metered = meter_id != UINT32_MAX && ctx->xbridge->support.clone;
+        struct flow old_base_flow;
+
+        if (metered) {
+            memcpy(&old_base_flow, &ctx->base_flow, sizeof old_base_flow);
+            clone_ofs = nl_msg_start_nested(ctx->odp_actions,
+                                            OVS_ACTION_ATTR_CLONE);
+            nl_msg_put_u32(ctx->odp_actions, OVS_ACTION_ATTR_METER, meter_id);
+        }
+
         /* Send the packet to the mirror. */
         if (out) {
             struct xbundle *out_xbundle = xbundle_lookup(ctx->xcfg, out);
@@ -2171,6 +2213,11 @@ mirror_packet(struct xlate_ctx *ctx, struct xbundle *xbundle,
             xvlan.v[0].vid = old_vid;
         }
 
+        if (metered) {
+            nl_msg_end_nested(ctx->odp_actions, clone_ofs);
+            memcpy(&ctx->base_flow, &old_base_flow, sizeof ctx->base_flow);
+        }
+
         /* output_normal() could have recursively output (to different
          * mirrors), so make sure that we don't send duplicates. */
         mirrors &= ~ctx->mirrors;
@@ -4562,10 +4609,16 @@ pick_ff_group(struct xlate_ctx *ctx, struct group_dpif *group)
 static struct ofputil_bucket *
 pick_default_select_group(struct xlate_ctx *ctx, struct group_dpif *group)
 {
+    uint32_t basis;
+
     flow_mask_hash_fields(&ctx->xin->flow, ctx->wc,
                           NX_HASH_FIELDS_SYMMETRIC_L4);
-    return group_best_live_bucket(ctx, group,
-                                  flow_hash_symmetric_l4(&ctx->xin->flow, 0));
+    basis = flow_hash_symmetric_l4(&ctx->xin->flow, 0);
+
+    if (group->hash_map) {
+        return group_hash_map_bucket(ctx, group, basis);
+    }
+    return group_best_live_bucket(ctx, group, basis);
 }
 
 static struct ofputil_bucket *
@@ -4605,6 +4658,9 @@ pick_hash_fields_select_group(struct xlate_ctx *ctx, struct group_dpif *group)
         mf_mask_field_masked(mf, &mask, ctx->wc);
     }
 
+    if (group->hash_map) {
+        return group_hash_map_bucket(ctx, group, basis);
+    }
     return group_best_live_bucket(ctx, group, basis);
 }
 
@@ -4626,23 +4682,9 @@ pick_dp_hash_select_group(struct xlate_ctx *ctx, struct group_dpif *group)
         ctx_trigger_recirculate_with_hash(ctx, hash_alg, group->hash_basis);
         return NULL;
     } else {
-        uint32_t hash_mask = group->hash_mask;
-        ctx->wc->masks.dp_hash |= hash_mask;
-
-        /* Starting from the original masked dp_hash value iterate over the
-         * hash mapping table to find the first live bucket. As the buckets
-         * are quasi-randomly spread over the hash values, this maintains
-         * a distribution according to bucket weights even when some buckets
-         * are non-live. */
-        for (int i = 0; i <= hash_mask; i++) {
-            struct ofputil_bucket *b =
-                    group->hash_map[(dp_hash + i) & hash_mask];
-            if (bucket_is_alive(ctx, b, 0)) {
-                return b;
-            }
-        }
+        ctx->wc->masks.dp_hash |= group->hash_mask;
 
-        return NULL;
+        return group_hash_map_bucket(ctx, group, dp_hash);
     }
 }
 
@@ -5431,6 +5473,70 @@ xlate_bundle_action(struct xlate_ctx *ctx,
     }
 }
 
+void
+xlate_learn_batch_init(struct xlate_learn_batch *xlb)
+{
+    xlb->n = 0;
+}
+
+/* Installs all the flows staged in 'xlb', see ofproto_flow_mod_learn_batch()
+ * for the details. */
+void
+xlate_learn_batch_flush(struct xlate_learn_batch *xlb)
+{
+    if (xlb->n) {
+        ofproto_flow_mod_learn_batch(xlb->ofms, xlb->n);
+        xlb->n = 0;
+    }
+}
+
+/* Returns a digest of the flow that 'fm' would create, for weeding out
+ * duplicates within a learn batch. */
+static uint32_t
+xlate_learn_digest(const struct ofputil_flow_mod *fm)
+{
+    uint32_t digest = minimatch_hash(&fm->match, fm->table_id);
+
+    digest = hash_int(fm->priority, digest);
+    return hash_bytes(fm->ofpacts, fm->ofpacts_len, digest);
+}
+
+/* Returns true if a flow identical to 'fm', whose digest is 'digest', is
+ * already staged in 'xlb', so that installing 'fm' would be redundant. */
+static bool
+xlate_learn_batch_is_dup(const struct xlate_learn_batch *xlb, uint32_t digest,
+                         const struct ofputil_flow_mod *fm)
+{
+    size_t i;
+
+    for (i = 0; i < xlb->n; i++) {
+        if (xlb->digests[i] == digest) {
+            const struct rule *rule = xlb->ofms[i]->temp_rule;
+            const struct rule_actions *actions = rule_get_actions(rule);
+
+            if (rule->table_id == fm->table_id
+                && rule->cr.priority == fm->priority
+                && minimatch_equal(&rule->cr.match, &fm->match)
+                && ofpacts_equal(actions->ofpacts, actions->ofpacts_len,
+                                 fm->ofpacts, fm->ofpacts_len)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void
+xlate_learn_batch_stage(struct xlate_learn_batch *xlb, uint32_t digest,
+                        struct ofproto_flow_mod *ofm)
+{
+    if (xlb->n == XLATE_LEARN_BATCH_MAX) {
+        xlate_learn_batch_flush(xlb);
+    }
+    xlb->digests[xlb->n] = digest;
+    xlb->ofms[xlb->n++] = ofm;
+}
+
 static void
 xlate_learn_action(struct xlate_ctx *ctx, const struct ofpact_learn *learn)
 {
@@ -5442,12 +5548,13 @@ xlate_learn_action(struct xlate_ctx *ctx, const struct ofpact_learn *learn)
         struct ofproto_flow_mod ofm__, *ofm;
         struct ofpbuf ofpacts;
         enum ofperr error;
+        uint32_t digest = 0;
 
-        if (ctx->xin->xcache) {
-            ofm = xmalloc(sizeof *ofm);
-        } else {
-            ofm = &ofm__;
-        }
+        /* Stage the learned flow for a batched install, unless the actions
+         * that follow depend on the outcome of installing it right now. */
+        bool defer = (ctx->xin->learn_batch && ctx->xin->allow_side_effects
+                      && !ctx->xin->xcache && !learn->limit
+                      && !(learn->flags & NX_LEARN_F_WRITE_RESULT));
 
         ofpbuf_use_stub(&ofpacts, ofpacts_stub, sizeof ofpacts_stub);
         learn_execute(learn, &ctx->xin->flow, &fm, &ofpacts);
@@ -5477,13 +5584,34 @@ xlate_learn_action(struct xlate_ctx *ctx, const struct ofpact_learn *learn)
             xlate_report(ctx, OFT_DETAIL, "%s", ds_cstr(&s));
             ds_destroy(&s);
         }
+        if (defer) {
+            digest = xlate_learn_digest(&fm);
+            if (xlate_learn_batch_is_dup(ctx->xin->learn_batch, digest,
+                                         &fm)) {
+                /* An identical flow is already staged for installation, so
+                 * there is nothing more to do for this one. */
+                ofpbuf_uninit(&ofpacts);
+                minimatch_destroy(&fm.match);
+                return;
+            }
+        }
+
+        if (ctx->xin->xcache || defer) {
+            ofm = xmalloc(sizeof *ofm);
+        } else {
+            ofm = &ofm__;
+        }
+
         error = ofproto_dpif_flow_mod_init_for_learn(ctx->xbridge->ofproto,
                                                      &fm, ofm);
         ofpbuf_uninit(&ofpacts);
 
         if (!error) {
             bool success = true;
-            if (ctx->xin->allow_side_effects) {
+            if (defer) {
+                xlate_learn_batch_stage(ctx->xin->learn_batch, digest, ofm);
+                ofm = NULL;
+            } else if (ctx->xin->allow_side_effects) {
                 error = ofproto_flow_mod_learn(ofm, ctx->xin->xcache != NULL,
                                                learn->limit, &success);
             } else if (learn->limit) {
@@ -5510,7 +5638,7 @@ xlate_learn_action(struct xlate_ctx *ctx, const struct ofpact_learn *learn)
                 entry->learn.ofm = ofm;
                 entry->learn.limit = learn->limit;
                 ofm = NULL;
-            } else {
+            } else if (ofm) {
                 ofproto_flow_mod_uninit(ofm);
             }
 
@@ -7194,6 +7322,7 @@ xlate_in_init(struct xlate_in *xin, struct ofproto_dpif *ofproto,
     xin->resubmits = 0;
     xin->wc = wc;
     xin->odp_actions = odp_actions;
+    xin->learn_batch = NULL;
     xin->in_packet_out = false;
     xin->recirc_queue = NULL;
     xin->xport_uuid = UUID_ZERO;
@@ -7467,6 +7596,8 @@ xlate_actions(struct xlate_in *xin, struct xlate_out *xout)
         return XLATE_BRIDGE_NOT_FOUND;
     }
 
+    OVS_USDT_PROBE(xlate_actions, start, xin, xout);
+
     struct flow *flow = &xin->flow;
 
     uint8_t stack_stub[1024];
@@ -7880,6 +8011,8 @@ exit:
         ctx.error = XLATE_OK;
     }
 
+    OVS_USDT_PROBE(xlate_actions, end, xin, xout, ctx.rule_cookie, ctx.error);
+
     return ctx.error;
 }
 
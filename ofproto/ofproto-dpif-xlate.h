@@ -36,8 +36,30 @@ struct dpif_ipfix;
 struct dpif_sflow;
 struct mac_learning;
 struct mcast_snooping;
+struct ofproto_flow_mod;
 struct xlate_cache;
 
+/* A staging buffer for flows created by learn actions.
+ *
+ * Handler threads translate upcalls in batches.  Rather than installing each
+ * learned flow during translation, taking 'ofproto_mutex' and starting a new
+ * classifier version per flow, translation stages learned flows here and the
+ * handler installs them all at once, under a single mutex acquisition and
+ * classifier version, after the whole batch of upcalls has been translated.
+ * Duplicates within a batch, as caused by a burst of packets from one new
+ * flow, are weeded out at staging time, before any ofproto state is
+ * touched.  Learn actions that need immediate feedback (a result register or
+ * a limit check) are never staged but installed right away. */
+#define XLATE_LEARN_BATCH_MAX 64
+struct xlate_learn_batch {
+    struct ofproto_flow_mod *ofms[XLATE_LEARN_BATCH_MAX];
+    uint32_t digests[XLATE_LEARN_BATCH_MAX]; /* Hashes for duplicate check. */
+    size_t n;
+};
+
+void xlate_learn_batch_init(struct xlate_learn_batch *);
+void xlate_learn_batch_flush(struct xlate_learn_batch *);
+
 struct xlate_out {
     /* Caching exceptions:
      *
@@ -141,6 +163,14 @@ struct xlate_in {
      * calling xlate_in_init(). */
     struct xlate_cache *xcache;
 
+    /* If nonnull, flows created by learn actions that need no immediate
+     * feedback are staged here instead of being installed during
+     * translation.  The owner must flush the batch once done translating.
+     *
+     * This is normally null so the client has to set it manually after
+     * calling xlate_in_init(). */
+    struct xlate_learn_batch *learn_batch;
+
     /* If nonnull, flow translation puts the resulting datapath actions in this
      * buffer.  If null, flow translation will not produce datapath actions. */
     struct ofpbuf *odp_actions;
@@ -128,6 +128,21 @@ static void rstp_run(struct ofproto_dpif *ofproto);
 static void set_rstp_port(struct ofport *,
                          const struct ofproto_port_rstp_settings *);
 
+static void meter_del(struct ofproto *, ofproto_meter_id);
+
+/* A hidden datapath meter that rate-limits the copies made for one mirror.
+ * Tracked here, keyed on the mirror client's 'aux', because the mirror
+ * module has no access to the datapath; the mirror itself only carries the
+ * meter id for flow translation. */
+struct mirror_meter {
+    struct hmap_node hmap_node;  /* In ofproto_dpif 'mirror_meters'. */
+    void *aux;                   /* Mirror client handle. */
+    uint32_t meter_id;           /* Provider meter id. */
+    uint32_t rate;               /* Packets per second. */
+    uint32_t burst;              /* Burst size in packets. */
+};
+static void mirror_meter_release(struct ofproto_dpif *, struct mirror_meter *);
+
 struct ofport_dpif {
     struct hmap_node odp_port_node; /* In dpif_backer's "odp_to_ofport_map". */
     struct ofport up;
@@ -456,6 +471,13 @@ type_run(const char *type)
         }
         simap_destroy(&tmp_backers);
 
+        /* The hint is only usable if a lone port going down is still the
+         * only reason for revalidating; tunnel garbage collection above may
+         * have upgraded the reason to REV_RECONFIGURE. */
+        odp_port_t rev_port_down = (backer->need_revalidate == REV_PORT_TOGGLED
+                                    ? backer->rev_port_down
+                                    : ODPP_NONE);
+
         switch (backer->need_revalidate) {
         case REV_RECONFIGURE:    COVERAGE_INC(rev_reconfigure);    break;
         case REV_STP:            COVERAGE_INC(rev_stp);            break;
@@ -467,6 +489,7 @@ type_run(const char *type)
         case REV_MCAST_SNOOPING: COVERAGE_INC(rev_mcast_snooping); break;
         }
         backer->need_revalidate = 0;
+        backer->rev_port_down = ODPP_NONE;
 
         xlate_txn_start();
         HMAP_FOR_EACH (ofproto, all_ofproto_dpifs_by_name_node,
@@ -478,6 +501,13 @@ type_run(const char *type)
                 continue;
             }
 
+            /* Group bucket liveness may depend on watch ports that the
+             * bucket actions never output to, so flows cannot be filtered
+             * by the actions they install.  Fall back to the full sweep. */
+            if (cmap_count(&ofproto->up.groups)) {
+                rev_port_down = ODPP_NONE;
+            }
+
             xlate_ofproto_set(ofproto, ofproto->up.name,
                               ofproto->backer->dpif, ofproto->ml,
                               ofproto->stp, ofproto->rstp, ofproto->ms,
@@ -512,7 +542,11 @@ type_run(const char *type)
         }
         xlate_txn_commit();
 
-        udpif_revalidate(backer->udpif);
+        if (rev_port_down != ODPP_NONE) {
+            udpif_revalidate_port_down(backer->udpif, rev_port_down);
+        } else {
+            udpif_revalidate(backer->udpif);
+        }
     }
 
     process_dpif_port_changes(backer);
@@ -789,6 +823,7 @@ open_dpif_backer(const char *type, struct dpif_backer **backerp)
     hmap_init(&backer->odp_to_ofport_map);
     ovs_rwlock_init(&backer->odp_to_ofport_lock);
     backer->need_revalidate = 0;
+    backer->rev_port_down = ODPP_NONE;
     simap_init(&backer->tnl_backers);
     backer->recv_set_enable = !ofproto_get_flow_restore_wait();
     *backerp = backer;
@@ -1630,6 +1665,7 @@ construct(struct ofproto *ofproto_)
     ofproto->ml = mac_learning_create(MAC_ENTRY_DEFAULT_IDLE_TIME);
     ofproto->ms = NULL;
     ofproto->mbridge = mbridge_create();
+    hmap_init(&ofproto->mirror_meters);
     ofproto->has_bonded_bundles = false;
     ofproto->lacp_enabled = false;
     ovs_mutex_init_adaptive(&ofproto->stats_mutex);
@@ -1782,6 +1818,12 @@ destruct(struct ofproto *ofproto_, bool del)
 
     recirc_free_ofproto(ofproto, ofproto->up.name);
 
+    struct mirror_meter *mm, *next_mm;
+    HMAP_FOR_EACH_SAFE (mm, next_mm, hmap_node, &ofproto->mirror_meters) {
+        mirror_meter_release(ofproto, mm);
+    }
+    hmap_destroy(&ofproto->mirror_meters);
+
     mbridge_unref(ofproto->mbridge);
 
     netflow_unref(ofproto->netflow);
@@ -3589,16 +3631,113 @@ bundle_wait(struct ofbundle *bundle)
 
 /* Mirrors. */
 
+static struct mirror_meter *
+mirror_meter_find(struct ofproto_dpif *ofproto, void *aux)
+{
+    struct mirror_meter *mm;
+
+    HMAP_FOR_EACH_WITH_HASH (mm, hmap_node, hash_pointer(aux, 0),
+                             &ofproto->mirror_meters) {
+        if (mm->aux == aux) {
+            return mm;
+        }
+    }
+    return NULL;
+}
+
+static void
+mirror_meter_release(struct ofproto_dpif *ofproto, struct mirror_meter *mm)
+{
+    if (mm) {
+        /* Release the datapath meter after a grace period, like an OpenFlow
+         * meter, so that datapath flows still referring to it can be
+         * revalidated first. */
+        meter_del(&ofproto->up, (ofproto_meter_id) { mm->meter_id });
+        hmap_remove(&ofproto->mirror_meters, &mm->hmap_node);
+        free(mm);
+    }
+}
+
+/* Ensures that the hidden datapath meter backing 'aux''s rate limit matches
+ * 's', creating, reprogramming or releasing it as needed.  Returns the
+ * provider meter id to attach to the mirror, or UINT32_MAX if the mirror is
+ * not rate-limited or the datapath cannot meter. */
+static uint32_t
+mirror_meter_update(struct ofproto_dpif *ofproto, void *aux,
+                    const struct ofproto_mirror_settings *s)
+{
+    struct mirror_meter *mm = mirror_meter_find(ofproto, aux);
+    uint32_t burst;
+
+    if (!s->rate_limit) {
+        mirror_meter_release(ofproto, mm);
+        return UINT32_MAX;
+    }
+
+    if (!ofproto->backer->meter_ids) {
+        VLOG_WARN_RL(&rl, "mirror %s: datapath has no meter support, cannot "
+                     "enforce rate limit", s->name);
+        return UINT32_MAX;
+    }
+
+    if (!mm) {
+        uint32_t meter_id;
+
+        if (!id_pool_alloc_id(ofproto->backer->meter_ids, &meter_id)) {
+            VLOG_WARN_RL(&rl, "mirror %s: out of datapath meters, cannot "
+                         "enforce rate limit", s->name);
+            return UINT32_MAX;
+        }
+
+        mm = xmalloc(sizeof *mm);
+        mm->aux = aux;
+        mm->meter_id = meter_id;
+        mm->rate = 0;
+        mm->burst = 0;
+        hmap_insert(&ofproto->mirror_meters, &mm->hmap_node,
+                    hash_pointer(aux, 0));
+    }
+
+    burst = s->burst_limit ? s->burst_limit : s->rate_limit;
+    if (mm->rate != s->rate_limit || mm->burst != burst) {
+        struct ofputil_meter_band band = {
+            .type = OFPMBT13_DROP,
+            .rate = s->rate_limit,
+            .burst_size = burst,
+        };
+        struct ofputil_meter_config config = {
+            .flags = OFPMF13_PKTPS | OFPMF13_BURST,
+            .n_bands = 1,
+            .bands = &band,
+        };
+
+        if (dpif_meter_set(ofproto->backer->dpif,
+                           (ofproto_meter_id) { mm->meter_id }, &config)) {
+            VLOG_WARN_RL(&rl, "mirror %s: failed to program rate limit "
+                         "meter", s->name);
+            mirror_meter_release(ofproto, mm);
+            return UINT32_MAX;
+        }
+
+        mm->rate = s->rate_limit;
+        mm->burst = burst;
+    }
+
+    return mm->meter_id;
+}
+
 static int
 mirror_set__(struct ofproto *ofproto_, void *aux,
              const struct ofproto_mirror_settings *s)
 {
     struct ofproto_dpif *ofproto = ofproto_dpif_cast(ofproto_);
     struct ofbundle **srcs, **dsts;
+    uint32_t meter_id;
     int error;
     size_t i;
 
     if (!s) {
+        mirror_meter_release(ofproto, mirror_meter_find(ofproto, aux));
         mirror_destroy(ofproto->mbridge, aux);
         return 0;
     }
@@ -3614,10 +3753,12 @@ mirror_set__(struct ofproto *ofproto_, void *aux,
         dsts[i] = bundle_lookup(ofproto, s->dsts[i]);
     }
 
+    meter_id = mirror_meter_update(ofproto, aux, s);
+
     error = mirror_set(ofproto->mbridge, aux, s->name, srcs, s->n_srcs, dsts,
                        s->n_dsts, s->src_vlans,
                        bundle_lookup(ofproto, s->out_bundle),
-                       s->snaplen, s->out_vlan);
+                       s->snaplen, s->out_vlan, meter_id);
     free(srcs);
     free(dsts);
     return error;
@@ -3836,7 +3977,19 @@ port_run(struct ofport_dpif *ofport)
         ofproto_port_set_enable(&ofport->up, enable);
 
         struct ofproto_dpif *ofproto = ofproto_dpif_cast(ofport->up.ofproto);
-        ofproto->backer->need_revalidate = REV_PORT_TOGGLED;
+        struct dpif_backer *backer = ofproto->backer;
+
+        /* A port going down can only invalidate the translations of flows
+         * that reference it, so record the port to let the revalidators
+         * narrow their sweep.  A port coming up, a second toggled port, or
+         * any other pending change requires the full sweep. */
+        if (!enable && !backer->need_revalidate) {
+            backer->rev_port_down = ofport->odp_port;
+        } else if (!(backer->need_revalidate == REV_PORT_TOGGLED
+                     && backer->rev_port_down == ofport->odp_port)) {
+            backer->rev_port_down = ODPP_NONE;
+        }
+        backer->need_revalidate = REV_PORT_TOGGLED;
 
         if (ofport->rstp_port) {
             rstp_port_set_mac_operational(ofport->rstp_port, enable);
@@ -5184,6 +5337,20 @@ group_set_selection_method(struct group_dpif *group)
         /* Parsing of groups should ensure this never happens */
         OVS_NOT_REACHED();
     }
+
+    if ((group->selection_method == SEL_METHOD_DEFAULT
+         || group->selection_method == SEL_METHOD_HASH)
+        && !group->hash_map) {
+        /* Precompute the hash mapping table also for the methods handled in
+         * the slow path, so that bucket selection is a single table lookup
+         * instead of scoring every bucket for every packet.  If the bucket
+         * weights are too skewed for the table, selection falls back to
+         * scoring the buckets. */
+        if (group_setup_dp_hash_table(group, 0)) {
+            VLOG_DBG("Using %d hash values for slow-path bucket selection.",
+                     group->hash_mask + 1);
+        }
+    }
 }
 
 static enum ofperr
@@ -5908,7 +6075,7 @@ ofproto_unixctl_fdb_stats_show(struct unixctl_conn *conn, int argc OVS_UNUSED,
 
     ds_put_format(&ds, "  Current/maximum MAC entries in the table: %"
                   PRIuSIZE"/%"PRIuSIZE"\n",
-                  hmap_count(&ofproto->ml->table), ofproto->ml->max_entries);
+                  cmap_count(&ofproto->ml->table), ofproto->ml->max_entries);
     ds_put_format(&ds,
                   "  Total number of learned MAC entries     : %"PRIu64"\n",
                   ofproto->ml->total_learned);
@@ -250,6 +250,13 @@ struct dpif_backer {
 
     enum revalidate_reason need_revalidate; /* Revalidate all flows. */
 
+    /* When 'need_revalidate' is REV_PORT_TOGGLED and the only change since
+     * revalidation was last triggered is a single port going down, the
+     * datapath port that went down, otherwise ODPP_NONE.  This lets the
+     * revalidators skip re-translating flows that cannot have been affected
+     * by the change. */
+    odp_port_t rev_port_down;
+
     bool recv_set_enable; /* Enables or disables receiving packets. */
 
     /* Meter. */
@@ -320,6 +327,8 @@ struct ofproto_dpif {
     bool has_bonded_bundles;
     bool lacp_enabled;
     struct mbridge *mbridge;
+    struct hmap mirror_meters;  /* "struct mirror_meter"s, keyed on the
+                                 * mirror client's aux pointer. */
 
     struct ovs_mutex stats_mutex;
     struct netdev_stats stats OVS_GUARDED; /* To account packets generated and
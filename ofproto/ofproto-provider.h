@@ -2012,6 +2012,9 @@ enum ofperr ofproto_flow_mod_init_for_learn(struct ofproto *,
 enum ofperr ofproto_flow_mod_learn(struct ofproto_flow_mod *, bool keep_ref,
                                    unsigned limit, bool *below_limit)
     OVS_EXCLUDED(ofproto_mutex);
+void ofproto_flow_mod_learn_batch(struct ofproto_flow_mod **ofms,
+                                  size_t n_ofms)
+    OVS_EXCLUDED(ofproto_mutex);
 enum ofperr ofproto_flow_mod_learn_refresh(struct ofproto_flow_mod *ofm);
 enum ofperr ofproto_flow_mod_learn_start(struct ofproto_flow_mod *ofm)
     OVS_REQUIRES(ofproto_mutex);
@@ -2594,6 +2594,13 @@ ofproto_port_unregister(struct ofproto *ofproto, ofp_port_t ofp_port)
     }
 }
 
+static void
+ofport_dealloc__(struct ofport *port)
+{
+    netdev_close(port->netdev);
+    port->ofproto->ofproto_class->port_dealloc(port);
+}
+
 static void
 ofport_destroy__(struct ofport *port)
 {
@@ -2604,8 +2611,12 @@ ofport_destroy__(struct ofport *port)
     hmap_remove(&ofproto->ports, &port->hmap_node);
     shash_find_and_delete(&ofproto->port_by_name, name);
 
-    netdev_close(port->netdev);
-    ofproto->ofproto_class->port_dealloc(port);
+    /* Translation threads can still reach 'port' through an old xlate
+     * configuration, which is itself destroyed only after a grace period,
+     * so the memory must stick around for at least as long.  (The ofproto
+     * itself is destroyed through two deferrals, so it outlives this
+     * callback.) */
+    ovsrcu_postpone(ofport_dealloc__, port);
 }
 
 static void
@@ -5526,6 +5537,93 @@ ofproto_flow_mod_learn(struct ofproto_flow_mod *ofm, bool keep_ref,
     return error;
 }
 
+/* Installs all the learned flows staged in 'ofms', of which there are
+ * 'n_ofms', taking 'ofproto_mutex' only once and starting a single new
+ * classifier version per bridge for the whole batch, instead of once per
+ * flow.  Each 'ofms[i]' must be heap-allocated and initialized by
+ * ofproto_dpif_flow_mod_init_for_learn(); this function consumes them all,
+ * releasing the rule references as if ofproto_flow_mod_learn() had been
+ * called without 'keep_ref'.
+ *
+ * Flows that cannot be installed are dropped without reporting an error; the
+ * next packet of such a flow will simply trigger the learn again. */
+void
+ofproto_flow_mod_learn_batch(struct ofproto_flow_mod **ofms, size_t n_ofms)
+    OVS_EXCLUDED(ofproto_mutex)
+{
+    struct ofproto *flushed = NULL;
+    size_t i;
+
+    /* Refresh the rules outside of the mutex, as for a single learn.  A rule
+     * that is already in the classifier needs nothing more than the refresh,
+     * so drop it from the batch right away. */
+    for (i = 0; i < n_ofms; i++) {
+        struct ofproto_flow_mod *ofm = ofms[i];
+
+        if (ofproto_flow_mod_learn_refresh(ofm)
+            || ofm->temp_rule->state != RULE_INITIALIZED) {
+            ofproto_flow_mod_uninit(ofm);
+            free(ofm);
+            ofms[i] = NULL;
+        }
+    }
+
+    ovs_mutex_lock(&ofproto_mutex);
+    for (i = 0; i < n_ofms; i++) {
+        struct ofproto_flow_mod *ofm = ofms[i];
+
+        if (ofm) {
+            ofm->version = ofm->temp_rule->ofproto->tables_version + 1;
+            if (ofproto_flow_mod_learn_start(ofm)) {
+                ofproto_flow_mod_uninit(ofm);
+                free(ofm);
+                ofms[i] = NULL;
+            }
+        }
+    }
+
+    /* All the flows of one bridge were given the same version above, so the
+     * first one to get here bumps it and the rest see it already bumped. */
+    for (i = 0; i < n_ofms; i++) {
+        if (ofms[i]) {
+            struct ofproto *ofproto = ofms[i]->temp_rule->ofproto;
+
+            if (ofproto->tables_version < ofms[i]->version) {
+                ofproto_bump_tables_version(ofproto);
+            }
+        }
+    }
+
+    for (i = 0; i < n_ofms; i++) {
+        struct ofproto_flow_mod *ofm = ofms[i];
+
+        if (ofm) {
+            /* Passing the rule's own bridge suppresses the per-flow version
+             * bump and monitor flush in ofproto_flow_mod_learn_finish(). */
+            struct ofproto *ofproto = ofm->temp_rule->ofproto;
+
+            ofproto_flow_mod_learn_finish(ofm, ofproto);
+            /* Batches almost always stay within one bridge, so flushing
+             * whenever the bridge differs from the previous flow's is as
+             * good as tracking the full set of bridges in the batch. */
+            if (ofproto != flushed) {
+                ofmonitor_flush(ofproto->connmgr);
+                flushed = ofproto;
+            }
+        }
+    }
+    ovs_mutex_unlock(&ofproto_mutex);
+
+    for (i = 0; i < n_ofms; i++) {
+        struct ofproto_flow_mod *ofm = ofms[i];
+
+        if (ofm) {
+            ofproto_rule_unref(ofm->temp_rule);
+            free(ofm);
+        }
+    }
+}
+
 static void
 replace_rule_start(struct ofproto *ofproto, struct ofproto_flow_mod *ofm,
                    struct rule *old_rule, struct rule *new_rule)
@@ -5745,8 +5843,33 @@ modify_flows_start__(struct ofproto *ofproto, struct ofproto_flow_mod *ofm)
         ovs_assert(rule_collection_n(new_rules)
                    == rule_collection_n(old_rules));
 
-        RULE_COLLECTIONS_FOR_EACH (old_rule, new_rule, old_rules, new_rules) {
-            replace_rule_start(ofproto, ofm, old_rule, new_rule);
+        if (rule_collection_n(old_rules) > 1) {
+            /* Defer once for each table touched, so that modifying a large
+             * number of rules pays the subtable publication cost only once
+             * per table instead of once per rule.  The new version making
+             * the replacement rules visible is announced by the caller only
+             * after this function returns. */
+            unsigned long tables[BITMAP_N_LONGS(256)];
+            size_t table_id;
+
+            memset(tables, 0, sizeof tables);
+            RULE_COLLECTIONS_FOR_EACH (old_rule, new_rule, old_rules,
+                                       new_rules) {
+                if (!bitmap_is_set(tables, new_rule->table_id)) {
+                    bitmap_set1(tables, new_rule->table_id);
+                    classifier_defer(&ofproto->tables[new_rule->table_id].cls);
+                }
+                replace_rule_start(ofproto, ofm, old_rule, new_rule);
+            }
+
+            BITMAP_FOR_EACH_1 (table_id, 256, tables) {
+                classifier_publish(&ofproto->tables[table_id].cls);
+            }
+        } else {
+            RULE_COLLECTIONS_FOR_EACH (old_rule, new_rule, old_rules,
+                                       new_rules) {
+                replace_rule_start(ofproto, ofm, old_rule, new_rule);
+            }
         }
     } else if (ofm->modify_may_add_flow) {
         /* No match, add a new flow, consumes 'temp'. */
@@ -8150,10 +8273,20 @@ do_bundle_commit(struct ofconn *ofconn, uint32_t id, uint16_t flags)
         error = OFPERR_OFPBFC_BAD_FLAGS;
     } else {
         bool prev_is_port_mod = false;
+        int table_id;
 
         error = 0;
         ovs_mutex_lock(&ofproto_mutex);
 
+        /* Defer subtable publication in every table for the duration of the
+         * begin and revert phases, so that a bundle carrying many flow mods
+         * pays the publication cost once per table rather than once per
+         * rule.  The new versions are only announced in the finish phase,
+         * after publication. */
+        for (table_id = 0; table_id < ofproto->n_tables; table_id++) {
+            classifier_defer(&ofproto->tables[table_id].cls);
+        }
+
         /* 1. Begin. */
         LIST_FOR_EACH (be, node, &bundle->msg_list) {
             if (be->type == OFPTYPE_PORT_MOD) {
@@ -8183,8 +8316,19 @@ do_bundle_commit(struct ofconn *ofconn, uint32_t id, uint16_t flags)
                     be->ogm.version = version;
                     error = ofproto_group_mod_start(ofproto, &be->ogm);
                 } else if (be->type == OFPTYPE_PACKET_OUT) {
+                    /* Translating the packet-out may look up rules added
+                     * earlier in the bundle, so any deferred changes must be
+                     * published for the duration of the translation. */
+                    for (table_id = 0; table_id < ofproto->n_tables;
+                         table_id++) {
+                        classifier_publish(&ofproto->tables[table_id].cls);
+                    }
                     be->opo.version = version;
                     error = ofproto_packet_out_start(ofproto, &be->opo);
+                    for (table_id = 0; table_id < ofproto->n_tables;
+                         table_id++) {
+                        classifier_defer(&ofproto->tables[table_id].cls);
+                    }
                 } else {
                     OVS_NOT_REACHED();
                 }
@@ -8210,7 +8354,17 @@ do_bundle_commit(struct ofconn *ofconn, uint32_t id, uint16_t flags)
                 }
                 /* Nothing needs to be reverted for a port mod. */
             }
+
+            for (table_id = 0; table_id < ofproto->n_tables; table_id++) {
+                classifier_publish(&ofproto->tables[table_id].cls);
+            }
         } else {
+            /* 3. Publish the deferred subtable changes in every table before
+             * announcing any of the new versions below. */
+            for (table_id = 0; table_id < ofproto->n_tables; table_id++) {
+                classifier_publish(&ofproto->tables[table_id].cls);
+            }
+
             /* 4. Finish. */
             LIST_FOR_EACH (be, node, &bundle->msg_list) {
                 if (be->type == OFPTYPE_PORT_MOD) {
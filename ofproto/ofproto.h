@@ -485,6 +485,11 @@ struct ofproto_mirror_settings {
     uint16_t out_vlan;          /* Output VLAN, only if out_bundle is NULL. */
     uint16_t snaplen;           /* Max packet size of a mirrored packet
                                    in byte, set to 0 equals 65535. */
+
+    /* Rate limiting, applied in the datapath to the mirrored copies only. */
+    uint32_t rate_limit;        /* Max packets per second, 0 disables. */
+    uint32_t burst_limit;       /* Burst size in packets, 0 picks a
+                                   default. */
 };
 
 int ofproto_mirror_register(struct ofproto *, void *aux,
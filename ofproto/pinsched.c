@@ -36,7 +36,7 @@
 
 struct pinqueue {
     struct hmap_node node;      /* In struct pinsched's 'queues' hmap. */
-    ofp_port_t port_no;         /* Port number. */
+    uint32_t queue_id;          /* Hash of the flow behind the packet-ins. */
     struct ovs_list packets;    /* Contains "struct ofpbuf"s. */
     int n;                      /* Number of packets in 'packets'. */
 };
@@ -44,7 +44,7 @@ struct pinqueue {
 struct pinsched {
     struct token_bucket token_bucket;
 
-    /* One queue per physical port. */
+    /* One queue per flow. */
     struct hmap queues;         /* Contains "struct pinqueue"s. */
     unsigned int n_queued;      /* Sum over queues[*].n. */
     struct pinqueue *next_txq;  /* Next pinqueue check in round-robin. */
@@ -105,20 +105,20 @@ pinqueue_destroy(struct pinsched *ps, struct pinqueue *q)
 }
 
 static struct pinqueue *
-pinqueue_get(struct pinsched *ps, ofp_port_t port_no)
+pinqueue_get(struct pinsched *ps, uint32_t queue_id)
 {
-    uint32_t hash = hash_ofp_port(port_no);
+    uint32_t hash = hash_int(queue_id, 0);
     struct pinqueue *q;
 
     HMAP_FOR_EACH_IN_BUCKET (q, node, hash, &ps->queues) {
-        if (port_no == q->port_no) {
+        if (queue_id == q->queue_id) {
             return q;
         }
     }
 
     q = xmalloc(sizeof *q);
     hmap_insert(&ps->queues, &q->node, hash);
-    q->port_no = port_no;
+    q->queue_id = queue_id;
     ovs_list_init(&q->packets);
     q->n = 0;
     return q;
@@ -188,7 +188,7 @@ get_token(struct pinsched *ps)
 }
 
 void
-pinsched_send(struct pinsched *ps, ofp_port_t port_no,
+pinsched_send(struct pinsched *ps, uint32_t queue_id,
               struct ofpbuf *packet, struct ovs_list *txq)
 {
     ovs_list_init(txq);
@@ -205,7 +205,7 @@ pinsched_send(struct pinsched *ps, ofp_port_t port_no,
             drop_packet(ps);
         }
 
-        struct pinqueue *q = pinqueue_get(ps, port_no);
+        struct pinqueue *q = pinqueue_get(ps, queue_id);
         ovs_list_push_back(&q->packets, &packet->list_node);
         q->n++;
         ps->n_queued++;
@@ -28,7 +28,7 @@ void pinsched_get_limits(const struct pinsched *,
                          int *rate_limit, int *burst_limit);
 void pinsched_set_limits(struct pinsched *, int rate_limit, int burst_limit);
 void pinsched_destroy(struct pinsched *);
-void pinsched_send(struct pinsched *, ofp_port_t port_no, struct ofpbuf *,
+void pinsched_send(struct pinsched *, uint32_t queue_id, struct ofpbuf *,
                    struct ovs_list *txq);
 void pinsched_run(struct pinsched *, struct ovs_list *txq);
 void pinsched_wait(struct pinsched *);
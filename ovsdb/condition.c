@@ -399,7 +399,8 @@ ovsdb_condition_match_every_clause(const struct ovsdb_row *row,
 static bool
 ovsdb_condition_match_any_clause_optimized(const struct ovsdb_datum *row_datum,
                                            const struct ovsdb_condition *cnd,
-                                           unsigned int index_map[])
+                                           unsigned int index_map[],
+                                           uint32_t hash_cache[])
 {
     if (ovsdb_condition_is_true(cnd)) {
         return true;
@@ -409,11 +410,22 @@ ovsdb_condition_match_any_clause_optimized(const struct ovsdb_datum *row_datum,
     SHASH_FOR_EACH (node, &cnd->o_columns) {
         struct ovsdb_o_column *o_column = node->data;
         const struct ovsdb_column *column = o_column->column;
-        const struct ovsdb_datum *arg = &row_datum[index_map ?
-                                                   index_map[column->index] :
-                                                   column->index];
-        uint32_t hash = ovsdb_datum_hash(arg, &column->type, 0);
+        unsigned int idx = index_map ? index_map[column->index]
+                                     : column->index;
+        const struct ovsdb_datum *arg = &row_datum[idx];
         struct ovsdb_o_clause *o_clause;
+        uint32_t hash;
+
+        /* A cache entry holds the datum's hash plus one, so that zero means
+         * "not computed yet". */
+        if (hash_cache) {
+            if (!hash_cache[idx]) {
+                hash_cache[idx] = ovsdb_datum_hash(arg, &column->type, 0) + 1;
+            }
+            hash = hash_cache[idx] - 1;
+        } else {
+            hash = ovsdb_datum_hash(arg, &column->type, 0);
+        }
 
         HMAP_FOR_EACH_WITH_HASH(o_clause, hmap_node, hash, &o_column->o_clauses) {
             if (ovsdb_datum_equals(arg, o_clause->arg, &column->type)) {
@@ -426,17 +438,22 @@ ovsdb_condition_match_any_clause_optimized(const struct ovsdb_datum *row_datum,
 
 /* Returns true if condition evaluation of one of the clauses is
  * true. index_map[] is an optional array that if exists indicates a mapping
- * between indexing row_datum to the indexes in ovsdb_column */
+ * between indexing row_datum to the indexes in ovsdb_column.  hash_cache[]
+ * is an optional array, indexed like row_datum, in which the hashes of the
+ * row's datums are cached across calls, e.g. across the many sessions whose
+ * conditions are evaluated against the same row. */
 bool
 ovsdb_condition_match_any_clause(const struct ovsdb_datum *row_datum,
                                  const struct ovsdb_condition *cnd,
-                                 unsigned int index_map[])
+                                 unsigned int index_map[],
+                                 uint32_t hash_cache[])
 {
     size_t i;
 
     if (cnd->optimized) {
         return ovsdb_condition_match_any_clause_optimized(row_datum, cnd,
-                                                          index_map);
+                                                          index_map,
+                                                          hash_cache);
     }
 
     for (i = 0; i < cnd->n_clauses; i++) {
@@ -55,7 +55,8 @@ bool ovsdb_condition_match_every_clause(const struct ovsdb_row *,
                                         const struct ovsdb_condition *);
 bool ovsdb_condition_match_any_clause(const struct ovsdb_datum *,
                                       const struct ovsdb_condition *,
-                                      unsigned int index_map[]);
+                                      unsigned int index_map[],
+                                      uint32_t hash_cache[]);
 int ovsdb_condition_cmp_3way(const struct ovsdb_condition *a,
                              const struct ovsdb_condition *b);
 void ovsdb_condition_clone(struct ovsdb_condition *to,
@@ -69,10 +70,12 @@ ovsdb_condition_get_columns(const struct ovsdb_condition *cond,
 static inline bool
 ovsdb_condition_empty_or_match_any(const struct ovsdb_datum *row_datum,
                                    const struct ovsdb_condition *cnd,
-                                   unsigned int index_map[])
+                                   unsigned int index_map[],
+                                   uint32_t hash_cache[])
 {
     return (ovsdb_condition_empty(cnd) ||
-            ovsdb_condition_match_any_clause(row_datum, cnd, index_map));
+            ovsdb_condition_match_any_clause(row_datum, cnd, index_map,
+                                             hash_cache));
 }
 
 #endif /* ovsdb/condition.h */
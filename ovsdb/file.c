@@ -28,6 +28,7 @@
 #include "lockfile.h"
 #include "ovsdb.h"
 #include "ovsdb-error.h"
+#include "ovs-thread.h"
 #include "row.h"
 #include "socket-util.h"
 #include "storage.h"
@@ -52,6 +53,9 @@ static void ovsdb_file_txn_add_row(struct ovsdb_file_txn *,
                                    const struct ovsdb_row *old,
                                    const struct ovsdb_row *new,
                                    const unsigned long int *changed);
+static struct json *ovsdb_file_row_to_json(const struct ovsdb_row *old,
+                                           const struct ovsdb_row *new,
+                                           const unsigned long int *changed);
 
 static struct ovsdb_error *
 ovsdb_file_update_row_from_json(struct ovsdb_row *row, bool converting,
@@ -311,24 +315,111 @@ ovsdb_file_change_cb(const struct ovsdb_row *old,
     return true;
 }
 
+/* Returns the rows of 'table' in the JSON format used in OVSDB files, or NULL
+ * if 'table' contains no persistent data. */
+static struct json *
+ovsdb_table_to_txn_json(const struct ovsdb_table *table)
+{
+    struct json *table_json = NULL;
+    const struct ovsdb_row *row;
+
+    HMAP_FOR_EACH (row, hmap_node, &table->rows) {
+        struct json *row_json = ovsdb_file_row_to_json(NULL, row, NULL);
+        if (row_json) {
+            char uuid[UUID_LEN + 1];
+
+            if (!table_json) {
+                table_json = json_object_create();
+            }
+            snprintf(uuid, sizeof uuid,
+                     UUID_FMT, UUID_ARGS(ovsdb_row_get_uuid(row)));
+            json_object_put(table_json, uuid, row_json);
+        }
+    }
+    return table_json;
+}
+
+/* Serialization of a snapshot of a whole database.  The tables are
+ * independent of one another, so a team of threads serializes them in
+ * parallel.  Each thread claims the next unclaimed table off a shared
+ * counter, so that one large table does not leave the other threads idle. */
+struct ovsdb_snapshot_task {
+    const struct ovsdb_table *table;
+    struct json *json;          /* Output: rows of 'table', or NULL. */
+};
+
+struct ovsdb_snapshot {
+    struct ovsdb_snapshot_task *tasks;
+    size_t n_tasks;
+    atomic_size_t next_task;
+};
+
+static void *
+ovsdb_snapshot_thread(void *snapshot_)
+{
+    struct ovsdb_snapshot *snapshot = snapshot_;
+
+    for (;;) {
+        size_t i;
+
+        atomic_add(&snapshot->next_task, 1, &i);
+        if (i >= snapshot->n_tasks) {
+            break;
+        }
+        snapshot->tasks[i].json
+            = ovsdb_table_to_txn_json(snapshot->tasks[i].table);
+    }
+    return NULL;
+}
+
 struct json *
 ovsdb_to_txn_json(const struct ovsdb *db, const char *comment)
 {
-    struct ovsdb_file_txn ftxn;
+    struct ovsdb_snapshot snapshot;
+    struct json *json = NULL;
+    struct shash_node *node;
+    size_t n_threads;
+    size_t i;
 
-    ovsdb_file_txn_init(&ftxn);
+    snapshot.n_tasks = shash_count(&db->tables);
+    snapshot.tasks = xmalloc(snapshot.n_tasks * sizeof *snapshot.tasks);
+    atomic_init(&snapshot.next_task, 0);
 
-    struct shash_node *node;
+    i = 0;
     SHASH_FOR_EACH (node, &db->tables) {
-        const struct ovsdb_table *table = node->data;
-        const struct ovsdb_row *row;
+        snapshot.tasks[i++].table = node->data;
+    }
+
+    n_threads = MIN(snapshot.n_tasks, count_cpu_cores());
+    if (n_threads > 1) {
+        pthread_t *threads = xmalloc(n_threads * sizeof *threads);
 
-        HMAP_FOR_EACH (row, hmap_node, &table->rows) {
-            ovsdb_file_txn_add_row(&ftxn, NULL, row, NULL);
+        for (i = 0; i < n_threads; i++) {
+            threads[i] = ovs_thread_create("snapshot",
+                                           ovsdb_snapshot_thread, &snapshot);
+        }
+        for (i = 0; i < n_threads; i++) {
+            xpthread_join(threads[i], NULL);
+        }
+        free(threads);
+    } else {
+        ovsdb_snapshot_thread(&snapshot);
+    }
+
+    /* Assemble the tables in iteration order, just as a serial
+     * implementation would produce them. */
+    for (i = 0; i < snapshot.n_tasks; i++) {
+        if (snapshot.tasks[i].json) {
+            if (!json) {
+                json = json_object_create();
+            }
+            json_object_put(json, snapshot.tasks[i].table->schema->name,
+                            snapshot.tasks[i].json);
         }
     }
+    free(snapshot.tasks);
 
-    return ovsdb_file_txn_annotate(ftxn.json, comment);
+    return ovsdb_file_txn_annotate(json, comment);
 }
 
 /* Returns 'txn' transformed into the JSON format that is used in OVSDB files.
@@ -365,9 +456,11 @@ ovsdb_file_txn_init(struct ovsdb_file_txn *ftxn)
     ftxn->table = NULL;
 }
 
-static void
-ovsdb_file_txn_add_row(struct ovsdb_file_txn *ftxn,
-                       const struct ovsdb_row *old,
+/* Returns JSON for the change from 'old' to 'new', in the format used for
+ * rows in OVSDB files, or NULL if there is nothing worth recording.  A whole
+ * row is expressed by null 'old' and 'changed'. */
+static struct json *
+ovsdb_file_row_to_json(const struct ovsdb_row *old,
                        const struct ovsdb_row *new,
                        const unsigned long int *changed)
 {
@@ -397,6 +490,16 @@ ovsdb_file_txn_add_row(struct ovsdb_file_txn *ftxn,
             }
         }
     }
+    return row;
+}
+
+static void
+ovsdb_file_txn_add_row(struct ovsdb_file_txn *ftxn,
+                       const struct ovsdb_row *old,
+                       const struct ovsdb_row *new,
+                       const unsigned long int *changed)
+{
+    struct json *row = ovsdb_file_row_to_json(old, new, changed);
 
     if (row) {
         struct ovsdb_table *table = new ? new->table : old->table;
@@ -456,7 +559,7 @@ ovsdb_file_read__(const char *filename, bool rw,
         }
         json_destroy(txn_json);
 
-        error = ovsdb_txn_replay_commit(txn);
+        error = ovsdb_txn_replay_commit_trusted(txn);
         if (error) {
             ovsdb_storage_unread(storage);
             break;
@@ -498,6 +498,7 @@ ovsdb_jsonrpc_session_create(struct ovsdb_jsonrpc_remote *remote,
     hmap_init(&s->triggers);
     hmap_init(&s->monitors);
     s->js = js;
+    jsonrpc_session_set_threaded(js);
     s->js_seqno = jsonrpc_session_get_seqno(js);
     s->read_only = read_only;
 
@@ -1058,6 +1059,11 @@ ovsdb_jsonrpc_session_got_request(struct ovsdb_jsonrpc_session *s,
         reply = ovsdb_jsonrpc_session_unlock(s, request);
     } else if (!strcmp(request->method, "set_db_change_aware")) {
         reply = ovsdb_jsonrpc_session_set_db_change_aware(s, request);
+    } else if (!strcmp(request->method, "binary_json")) {
+        /* The client has proved it understands binary frames by asking for
+         * them, so the reply and everything after it may use them. */
+        jsonrpc_session_set_binary(s->js);
+        reply = jsonrpc_create_reply(json_object_create(), request->id);
     } else if (!strcmp(request->method, "echo")) {
         reply = jsonrpc_create_reply(json_clone(request->params), request->id);
     } else {
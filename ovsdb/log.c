@@ -84,6 +84,7 @@ struct ovsdb_log {
     FILE *stream;
     off_t base;
     struct afsync *afsync;
+    struct ovsdb_log_replace_async *replace;
 };
 
 /* Whether the OS supports renaming open files.
@@ -104,6 +105,10 @@ static bool is_magic_ok(const char *needle, const char *haystack);
 static struct afsync *afsync_create(int fd, uint64_t initial_ticket);
 static uint64_t afsync_destroy(struct afsync *);
 
+static void ovsdb_log_replace_async_cancel(struct ovsdb_log *);
+static void ovsdb_log_replace_async_record(struct ovsdb_log *,
+                                           const struct json *);
+
 /* Attempts to open 'name' with the specified 'open_mode'.  On success, stores
  * the new log into '*filep' and returns NULL; otherwise returns NULL and
  * stores NULL into '*filep'.
@@ -279,6 +284,7 @@ ovsdb_log_open(const char *name, const char *magic,
     file->offset = 0;
     file->base = 0;
     file->afsync = NULL;
+    file->replace = NULL;
     *filep = file;
     return NULL;
 
@@ -317,6 +323,7 @@ void
 ovsdb_log_close(struct ovsdb_log *file)
 {
     if (file) {
+        ovsdb_log_replace_async_cancel(file);
         ovsdb_error_destroy(file->error);
         afsync_destroy(file->afsync);
         free(file->name);
@@ -583,8 +590,11 @@ ovsdb_log_compose_record(const struct json *json,
  * If the log contains some records that have not yet been read, then calling
  * this function truncates them.
  *
- * Log writes are atomic.  A client may use ovsdb_log_commit() to ensure that
- * they are durable.
+ * Log writes are atomic but buffered: the record does not reach the operating
+ * system until ovsdb_log_flush() or one of the commit functions is called, so
+ * that a burst of records costs one write() instead of one per record.  A
+ * client may use ovsdb_log_commit_block() or ovsdb_log_commit_start() to
+ * ensure that records are durable.
  */
 struct ovsdb_error *
 ovsdb_log_write(struct ovsdb_log *file, const struct json *json)
@@ -618,10 +628,10 @@ ovsdb_log_write(struct ovsdb_log *file, const struct json *json)
     ovsdb_log_compose_record(json, file->magic, &header, &data);
     size_t total_length = header.length + data.length;
 
-    /* Write. */
+    /* Write.  The record accumulates in the stdio buffer until the next
+     * flush or commit. */
     bool ok = (fwrite(header.string, header.length, 1, file->stream) == 1
-               && fwrite(data.string, data.length, 1, file->stream) == 1
-               && fflush(file->stream) == 0);
+               && fwrite(data.string, data.length, 1, file->stream) == 1);
     ds_destroy(&header);
     ds_destroy(&data);
     if (!ok) {
@@ -641,6 +651,10 @@ ovsdb_log_write(struct ovsdb_log *file, const struct json *json)
         return ovsdb_error_clone(file->error);
     }
 
+    if (file->replace) {
+        ovsdb_log_replace_async_record(file, json);
+    }
+
     file->offset += total_length;
     return NULL;
 }
@@ -653,11 +667,46 @@ ovsdb_log_write_and_free(struct ovsdb_log *log, struct json *json)
     return error;
 }
 
+/* Pushes the records buffered by ovsdb_log_write() out to the operating
+ * system.  This does not make them durable; use one of the commit functions
+ * for that (they flush implicitly).  Returns NULL if successful, otherwise
+ * an error (which the caller must eventually destroy). */
+struct ovsdb_error *
+ovsdb_log_flush(struct ovsdb_log *file)
+{
+    if (file->state != OVSDB_LOG_WRITE || !file->stream) {
+        return file->error ? ovsdb_error_clone(file->error) : NULL;
+    }
+
+    if (fflush(file->stream)) {
+        int error = errno;
+
+        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 5);
+        VLOG_WARN_RL(&rl, "%s: flush failed (%s)",
+                     file->name, ovs_strerror(error));
+
+        /* Unlike a failed ovsdb_log_write(), there is no use in truncating
+         * here: it is unknown how much of the buffered data reached the file,
+         * and the per-record checksums let a reader recognize a partial tail
+         * record in any case. */
+        file->error = ovsdb_io_error(error, "%s: flush failed",
+                                     file->display_name);
+        file->state = OVSDB_LOG_WRITE_ERROR;
+        return ovsdb_error_clone(file->error);
+    }
+
+    return NULL;
+}
+
 /* Attempts to commit 'file' to disk.  Waits for the commit to succeed or fail.
  * Returns NULL if successful, otherwise the error that occurred. */
 struct ovsdb_error *
 ovsdb_log_commit_block(struct ovsdb_log *file)
 {
+    struct ovsdb_error *error = ovsdb_log_flush(file);
+    if (error) {
+        return error;
+    }
 #if (_POSIX_C_SOURCE >= 199309L || _XOPEN_SOURCE >= 500)
     /* we do not check metadata - mtime, atime, anywhere, so we
      * do not need to update it every time we sync the log.
@@ -860,6 +909,224 @@ ovsdb_log_replace_commit(struct ovsdb_log *old, struct ovsdb_log *new)
     return NULL;
 }
 
+/* Asynchronous log replacement.
+ *
+ * Serializing and writing a snapshot of a large database can take several
+ * seconds, too long to block a poll loop.  ovsdb_log_replace_async_start()
+ * hands the entries off to a writer thread instead.  The original log remains
+ * in use while the thread runs; records written to it in the meantime are
+ * retained and appended to the replacement before it takes effect, so that no
+ * records are lost.  ovsdb_log_replace_async_run() commits (or aborts) the
+ * replacement once the thread finishes. */
+struct ovsdb_log_replace_async {
+    /* Immutable while the thread runs. */
+    struct ovsdb_log *new;      /* Temporary log being written. */
+    struct json **entries;      /* Entries for the thread to write. */
+    size_t n_entries;
+    pthread_t thread;
+
+    /* Thread to main thread. */
+    struct seq *done;           /* Signaled when the thread finishes. */
+    atomic_bool finished;
+    struct ovsdb_error *write_error; /* Owned by thread until 'finished'. */
+
+    /* Main thread only. */
+    struct json **follow_ups;   /* Records written to the original log while
+                                 * the thread was running. */
+    size_t n_follow_ups, allocated_follow_ups;
+};
+
+static void *
+ovsdb_log_replace_thread(void *replace_)
+{
+    struct ovsdb_log_replace_async *replace = replace_;
+
+    /* This thread only touches its own temporary log and the immutable
+     * 'entries', so it can remain quiescent for its whole lifetime. */
+    ovsrcu_quiesce_start();
+
+    struct ovsdb_error *error = NULL;
+    for (size_t i = 0; !error && i < replace->n_entries; i++) {
+        error = ovsdb_log_write(replace->new, replace->entries[i]);
+    }
+    if (!error) {
+        ovsdb_log_mark_base(replace->new);
+
+        /* Sync the bulk of the data here, so that committing the replacement
+         * on the main thread has almost nothing left to do. */
+        error = ovsdb_log_commit_block(replace->new);
+    }
+
+    replace->write_error = error;
+    atomic_store_explicit(&replace->finished, true, memory_order_release);
+    seq_change(replace->done);
+
+    return NULL;
+}
+
+/* Starts replacing the contents of 'log', on disk, by the 'n' entries in
+ * 'entries', like ovsdb_log_replace() except that the serialization and disk
+ * I/O happen in a separate thread, so that the caller's poll loop stays
+ * responsive.  'log' remains usable in the meantime: records written to it
+ * are appended to the replacement before it takes effect.
+ *
+ * The caller must drive the replacement to completion by calling
+ * ovsdb_log_replace_async_run() and ovsdb_log_replace_async_wait() from its
+ * poll loop.
+ *
+ * Returns NULL if the replacement started successfully, otherwise an error
+ * (which the caller must eventually destroy). */
+struct ovsdb_error * OVS_WARN_UNUSED_RESULT
+ovsdb_log_replace_async_start(struct ovsdb_log *log,
+                              struct json **entries, size_t n)
+{
+    if (log->replace) {
+        return ovsdb_error(NULL, "%s: log replacement already in progress",
+                           log->display_name);
+    }
+
+    struct ovsdb_log *new;
+    struct ovsdb_error *error = ovsdb_log_replace_start(log, &new);
+    if (error) {
+        return error;
+    }
+
+    struct ovsdb_log_replace_async *replace = xzalloc(sizeof *replace);
+    replace->new = new;
+    replace->entries = xmalloc(n * sizeof *replace->entries);
+    for (size_t i = 0; i < n; i++) {
+        replace->entries[i] = json_clone(entries[i]);
+    }
+    replace->n_entries = n;
+    replace->done = seq_create();
+    atomic_init(&replace->finished, false);
+    log->replace = replace;
+    replace->thread = ovs_thread_create("log_replace",
+                                        ovsdb_log_replace_thread, replace);
+    return NULL;
+}
+
+/* Returns true if a replacement started with ovsdb_log_replace_async_start()
+ * on 'log' has not yet completed, false otherwise. */
+bool
+ovsdb_log_replace_is_active(const struct ovsdb_log *log)
+{
+    return log->replace != NULL;
+}
+
+/* Saves a copy of 'json', just written to 'log', so that it can be appended
+ * to the in-progress replacement before that takes effect. */
+static void
+ovsdb_log_replace_async_record(struct ovsdb_log *log, const struct json *json)
+{
+    struct ovsdb_log_replace_async *replace = log->replace;
+
+    if (replace->n_follow_ups >= replace->allocated_follow_ups) {
+        replace->follow_ups = x2nrealloc(replace->follow_ups,
+                                         &replace->allocated_follow_ups,
+                                         sizeof *replace->follow_ups);
+    }
+    replace->follow_ups[replace->n_follow_ups++] = json_clone(json);
+}
+
+static void
+ovsdb_log_replace_async_destroy(struct ovsdb_log *log)
+{
+    struct ovsdb_log_replace_async *replace = log->replace;
+
+    for (size_t i = 0; i < replace->n_entries; i++) {
+        json_destroy(replace->entries[i]);
+    }
+    free(replace->entries);
+    for (size_t i = 0; i < replace->n_follow_ups; i++) {
+        json_destroy(replace->follow_ups[i]);
+    }
+    free(replace->follow_ups);
+    seq_destroy(replace->done);
+    free(replace);
+    log->replace = NULL;
+}
+
+/* Drives the replacement, if any, started on 'log' with
+ * ovsdb_log_replace_async_start().  Returns false if no replacement is in
+ * progress or if the writer thread is still running.  Returns true when the
+ * replacement has completed, in which case '*errorp' receives the outcome:
+ * NULL on success, otherwise an error (which the caller must eventually
+ * destroy).  On failure the original log remains in use. */
+bool
+ovsdb_log_replace_async_run(struct ovsdb_log *log, struct ovsdb_error **errorp)
+{
+    struct ovsdb_log_replace_async *replace = log->replace;
+    if (!replace) {
+        return false;
+    }
+
+    bool finished;
+    atomic_read_explicit(&replace->finished, &finished, memory_order_acquire);
+    if (!finished) {
+        return false;
+    }
+    xpthread_join(replace->thread, NULL);
+
+    struct ovsdb_error *error = replace->write_error;
+    if (!error) {
+        /* Append the records written to 'log' while the thread was running,
+         * so that the replacement does not lose them.  (They are synced by
+         * ovsdb_log_replace_commit().) */
+        for (size_t i = 0; !error && i < replace->n_follow_ups; i++) {
+            error = ovsdb_log_write(replace->new, replace->follow_ups[i]);
+        }
+    }
+
+    if (error) {
+        ovsdb_log_replace_abort(replace->new);
+    } else {
+        error = ovsdb_log_replace_commit(log, replace->new);
+    }
+    replace->new = NULL;
+    ovsdb_log_replace_async_destroy(log);
+
+    *errorp = error;
+    return true;
+}
+
+/* Causes poll_block() to wake up when ovsdb_log_replace_async_run() has work
+ * to do. */
+void
+ovsdb_log_replace_async_wait(struct ovsdb_log *log)
+{
+    struct ovsdb_log_replace_async *replace = log->replace;
+    if (!replace) {
+        return;
+    }
+
+    uint64_t seq = seq_read(replace->done);
+    bool finished;
+    atomic_read_explicit(&replace->finished, &finished, memory_order_acquire);
+    if (finished) {
+        poll_immediate_wake();
+    } else {
+        seq_wait(replace->done, seq);
+    }
+}
+
+/* Waits for the writer thread, if any, then discards its work.  Called when
+ * 'log' is being closed. */
+static void
+ovsdb_log_replace_async_cancel(struct ovsdb_log *log)
+{
+    struct ovsdb_log_replace_async *replace = log->replace;
+    if (!replace) {
+        return;
+    }
+
+    xpthread_join(replace->thread, NULL);
+    ovsdb_error_destroy(replace->write_error);
+    ovsdb_log_replace_abort(replace->new);
+    replace->new = NULL;
+    ovsdb_log_replace_async_destroy(log);
+}
+
 void
 ovsdb_log_replace_abort(struct ovsdb_log *new)
 {
@@ -968,6 +1235,17 @@ ovsdb_log_get_afsync(struct ovsdb_log *log)
 uint64_t
 ovsdb_log_commit_start(struct ovsdb_log *log)
 {
+    /* The fsync thread syncs the file descriptor directly, so any buffered
+     * records must reach the operating system before the ticket exists. */
+    struct ovsdb_error *error = ovsdb_log_flush(log);
+    if (error) {
+        /* Return a ticket that will never complete, so that the caller does
+         * not mistake the lost records for durable ones.  The error itself
+         * surfaces again on the next write or blocking commit. */
+        ovsdb_error_destroy(error);
+        return UINT64_MAX - 1;
+    }
+
     struct afsync *afsync = ovsdb_log_get_afsync(log);
 
     uint64_t orig;
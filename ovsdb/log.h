@@ -73,6 +73,8 @@ struct ovsdb_error *ovsdb_log_write(struct ovsdb_log *, const struct json *)
     OVS_WARN_UNUSED_RESULT;
 struct ovsdb_error *ovsdb_log_write_and_free(struct ovsdb_log *, struct json *)
     OVS_WARN_UNUSED_RESULT;
+struct ovsdb_error *ovsdb_log_flush(struct ovsdb_log *)
+    OVS_WARN_UNUSED_RESULT;
 
 uint64_t ovsdb_log_commit_start(struct ovsdb_log *);
 uint64_t ovsdb_log_commit_progress(struct ovsdb_log *);
@@ -94,6 +96,14 @@ struct ovsdb_error *ovsdb_log_replace_commit(struct ovsdb_log *old,
     OVS_WARN_UNUSED_RESULT;
 void ovsdb_log_replace_abort(struct ovsdb_log *new);
 
+struct ovsdb_error *ovsdb_log_replace_async_start(struct ovsdb_log *,
+                                                  struct json **entries,
+                                                  size_t n)
+    OVS_WARN_UNUSED_RESULT;
+bool ovsdb_log_replace_is_active(const struct ovsdb_log *);
+bool ovsdb_log_replace_async_run(struct ovsdb_log *, struct ovsdb_error **);
+void ovsdb_log_replace_async_wait(struct ovsdb_log *);
+
 /* For testing. */
 void ovsdb_log_disable_renaming_open_files(void);
 
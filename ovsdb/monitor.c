@@ -114,6 +114,22 @@ struct ovsdb_monitor_row {
     struct uuid uuid;           /* UUID of row that changed. */
     struct ovsdb_datum *old;    /* Old data, NULL for an inserted row. */
     struct ovsdb_datum *new;    /* New data, NULL for a deleted row. */
+
+    /* Per-column JSON fragments, serialized on first use and then shared,
+     * through refcounting, by every session that composes an update from this
+     * row.  Both arrays are indexed by monitored column and NULL until
+     * needed.  They must be discarded whenever 'new' changes. */
+    struct json **diff_jsons;   /* <diff> of 'old' and 'new' for "modify". */
+    struct json **new_jsons;    /* 'new' values for "insert"/"initial". */
+
+    /* Lazily allocated caches of ovsdb_datum_hash() values for 'old' and
+     * 'new', shared by all the sessions that probe their conditions' hash
+     * indexes against this row, so that each datum is hashed once instead of
+     * once per session.  Indexed like 'old' and 'new'; see
+     * ovsdb_condition_match_any_clause() for the encoding.  'new_hashes'
+     * must be discarded whenever 'new' changes. */
+    uint32_t *old_hashes;
+    uint32_t *new_hashes;
 };
 
 /* Contains a set of changes that are not yet flushed to all the jsonrpc
@@ -383,6 +399,34 @@ free_monitor_row_data(const struct ovsdb_monitor_table *mt,
     }
 }
 
+/* Discards the cached column fragments for 'row', if any.  This must be
+ * called whenever the row's data changes after fragments might have been
+ * serialized from it. */
+static void
+ovsdb_monitor_row_clear_json(struct ovsdb_monitor_row *row, size_t n_columns)
+{
+    size_t i;
+
+    if (row->diff_jsons) {
+        for (i = 0; i < n_columns; i++) {
+            json_destroy(row->diff_jsons[i]);
+        }
+        free(row->diff_jsons);
+        row->diff_jsons = NULL;
+    }
+    if (row->new_jsons) {
+        for (i = 0; i < n_columns; i++) {
+            json_destroy(row->new_jsons[i]);
+        }
+        free(row->new_jsons);
+        row->new_jsons = NULL;
+    }
+
+    /* The hashes of 'new' are derived data just like the fragments. */
+    free(row->new_hashes);
+    row->new_hashes = NULL;
+}
+
 /* Frees 'row', which must have been created from 'mt'. */
 static void
 ovsdb_monitor_row_destroy(const struct ovsdb_monitor_table *mt,
@@ -390,8 +434,10 @@ ovsdb_monitor_row_destroy(const struct ovsdb_monitor_table *mt,
                           size_t n_columns)
 {
     if (row) {
+        ovsdb_monitor_row_clear_json(row, n_columns);
         free_monitor_row_data(mt, row->old, n_columns);
         free_monitor_row_data(mt, row->new, n_columns);
+        free(row->old_hashes);
         free(row);
     }
 }
@@ -826,7 +872,9 @@ ovsdb_monitor_row_update_type_condition(
                       bool initial,
                       enum ovsdb_monitor_row_type row_type,
                       const struct ovsdb_datum *old,
-                      const struct ovsdb_datum *new)
+                      const struct ovsdb_datum *new,
+                      uint32_t old_hashes[],
+                      uint32_t new_hashes[])
 {
     struct ovsdb_condition *old_condition, *new_condition;
     enum ovsdb_monitor_selection type =
@@ -841,13 +889,13 @@ ovsdb_monitor_row_update_type_condition(
                                                 old_condition,
                                                 row_type == OVSDB_MONITOR_ROW ?
                                                 mt->columns_index_map :
-                                                NULL);
+                                                NULL, old_hashes);
         bool new_cond = !new ? false
             : ovsdb_condition_empty_or_match_any(new,
                                                 new_condition,
                                                 row_type == OVSDB_MONITOR_ROW ?
                                                 mt->columns_index_map :
-                                                NULL);
+                                                NULL, new_hashes);
 
         if (!old_cond && !new_cond) {
             type = OJMS_NONE;
@@ -912,6 +960,47 @@ ovsdb_monitor_row_skip_update(const struct ovsdb_monitor_table *mt,
     return false;
 }
 
+/* Returns a JSON fragment for the <diff> between the old and new values of
+ * monitored column 'i' of 'row', serializing it on the first call and handing
+ * out refcounted clones afterward, so that every session subscribed to the
+ * same monitor shares a single serialization. */
+static struct json *
+ovsdb_monitor_row_diff_json(struct ovsdb_monitor_row *row,
+                            const struct ovsdb_monitor_table *mt,
+                            size_t i, size_t n_columns)
+{
+    if (!row->diff_jsons) {
+        row->diff_jsons = xzalloc(n_columns * sizeof *row->diff_jsons);
+    }
+    if (!row->diff_jsons[i]) {
+        const struct ovsdb_column *c = mt->columns[i].column;
+        struct ovsdb_datum diff;
+
+        ovsdb_datum_diff(&diff, &row->old[i], &row->new[i], &c->type);
+        row->diff_jsons[i] = ovsdb_datum_to_json(&diff, &c->type);
+        ovsdb_datum_destroy(&diff, &c->type);
+    }
+    return json_clone(row->diff_jsons[i]);
+}
+
+/* Like ovsdb_monitor_row_diff_json() but for the new value of monitored
+ * column 'i' of 'row'. */
+static struct json *
+ovsdb_monitor_row_new_json(struct ovsdb_monitor_row *row,
+                           const struct ovsdb_monitor_table *mt,
+                           size_t i, size_t n_columns)
+{
+    if (!row->new_jsons) {
+        row->new_jsons = xzalloc(n_columns * sizeof *row->new_jsons);
+    }
+    if (!row->new_jsons[i]) {
+        const struct ovsdb_column *c = mt->columns[i].column;
+
+        row->new_jsons[i] = ovsdb_datum_to_json(&row->new[i], &c->type);
+    }
+    return json_clone(row->new_jsons[i]);
+}
+
 /* Returns JSON for a <row-update> (as described in RFC 7047) for 'row' within
  * 'mt', or NULL if no row update should be sent.
  *
@@ -928,7 +1017,7 @@ ovsdb_monitor_compose_row_update(
     enum ovsdb_monitor_row_type row_type OVS_UNUSED,
     const void *_row,
     bool initial, unsigned long int *changed,
-    size_t n_columns OVS_UNUSED)
+    size_t n_columns)
 {
     const struct ovsdb_monitor_row *row = _row;
     enum ovsdb_monitor_selection type;
@@ -972,8 +1061,9 @@ ovsdb_monitor_compose_row_update(
         }
         if (type & (OJMS_INITIAL | OJMS_INSERT | OJMS_MODIFY)) {
             json_object_put(new_json, c->column->name,
-                            ovsdb_datum_to_json(&row->new[i],
-                                                &c->column->type));
+                            ovsdb_monitor_row_new_json(
+                                CONST_CAST(struct ovsdb_monitor_row *, row),
+                                mt, i, n_columns));
         }
     }
 
@@ -1001,17 +1091,36 @@ ovsdb_monitor_compose_row_update2(
     enum ovsdb_monitor_selection type;
     struct json *row_update2, *diff_json;
     const struct ovsdb_datum *old, *new;
+    uint32_t *old_hashes = NULL, *new_hashes = NULL;
     size_t i;
 
     if (row_type == OVSDB_MONITOR_ROW) {
-        old = ((const struct ovsdb_monitor_row *)_row)->old;;
-        new = ((const struct ovsdb_monitor_row *)_row)->new;
+        struct ovsdb_monitor_row *row
+            = CONST_CAST(struct ovsdb_monitor_row *, _row);
+
+        old = row->old;
+        new = row->new;
+
+        /* Set up the shared datum hash caches, so that the sessions that
+         * evaluate their conditions against this row hash each datum only
+         * once. */
+        if (condition && condition->conditional) {
+            if (old && !row->old_hashes) {
+                row->old_hashes = xzalloc(n_columns * sizeof *row->old_hashes);
+            }
+            if (new && !row->new_hashes) {
+                row->new_hashes = xzalloc(n_columns * sizeof *row->new_hashes);
+            }
+            old_hashes = row->old_hashes;
+            new_hashes = row->new_hashes;
+        }
     } else {
         old = new = ((const struct ovsdb_row *)_row)->fields;
     }
 
     type = ovsdb_monitor_row_update_type_condition(mt, condition, initial,
-                                                   row_type, old, new);
+                                                   row_type, old, new,
+                                                   old_hashes, new_hashes);
     if (ovsdb_monitor_row_skip_update(mt, row_type, old, new, type, changed,
                                       n_columns)) {
         return NULL;
@@ -1035,22 +1144,39 @@ ovsdb_monitor_compose_row_update2(
             }
 
             if (type == OJMS_MODIFY) {
-                struct ovsdb_datum diff;
-
                 if (!bitmap_is_set(changed, i)) {
                     continue;
                 }
 
-                ovsdb_datum_diff(&diff ,&old[index], &new[index],
-                                        &c->column->type);
-                json_object_put(diff_json, c->column->name,
-                                ovsdb_datum_to_json(&diff, &c->column->type));
-                ovsdb_datum_destroy(&diff, &c->column->type);
-            } else {
-                if (!ovsdb_datum_is_default(&new[index], &c->column->type)) {
+                if (row_type == OVSDB_MONITOR_ROW) {
+                    json_object_put(
+                        diff_json, c->column->name,
+                        ovsdb_monitor_row_diff_json(
+                            CONST_CAST(struct ovsdb_monitor_row *, _row),
+                            mt, i, n_columns));
+                } else {
+                    struct ovsdb_datum diff;
+
+                    ovsdb_datum_diff(&diff, &old[index], &new[index],
+                                     &c->column->type);
                     json_object_put(diff_json, c->column->name,
-                                    ovsdb_datum_to_json(&new[index],
+                                    ovsdb_datum_to_json(&diff,
                                                         &c->column->type));
+                    ovsdb_datum_destroy(&diff, &c->column->type);
+                }
+            } else {
+                if (!ovsdb_datum_is_default(&new[index], &c->column->type)) {
+                    if (row_type == OVSDB_MONITOR_ROW) {
+                        json_object_put(
+                            diff_json, c->column->name,
+                            ovsdb_monitor_row_new_json(
+                                CONST_CAST(struct ovsdb_monitor_row *, _row),
+                                mt, i, n_columns));
+                    } else {
+                        json_object_put(diff_json, c->column->name,
+                                        ovsdb_datum_to_json(&new[index],
+                                                            &c->column->type));
+                    }
                 }
             }
         }
@@ -1369,9 +1495,11 @@ ovsdb_monitor_changes_update(const struct ovsdb_row *old,
             } else {
                 update_monitor_row_data(mt, new, change->new, mcst->n_columns);
             }
+            ovsdb_monitor_row_clear_json(change, mcst->n_columns);
         } else {
             free_monitor_row_data(mt, change->new, mcst->n_columns);
             change->new = NULL;
+            ovsdb_monitor_row_clear_json(change, mcst->n_columns);
 
             if (!change->old) {
                 /* This row was added then deleted.  Forget about it. */
@@ -76,6 +76,10 @@ static char *ssl_protocols;
 static char *ssl_ciphers;
 static bool bootstrap_ca_cert;
 
+/* --relay: True if the synced databases are served to read-only clients from
+ * memory only, without maintaining the local storage for failover. */
+static bool is_relay;
+
 static unixctl_cb_func ovsdb_server_exit;
 static unixctl_cb_func ovsdb_server_compact;
 static unixctl_cb_func ovsdb_server_reconnect;
@@ -150,7 +154,8 @@ ovsdb_replication_init(const char *sync_from, const char *exclude,
                        struct shash *all_dbs, const struct uuid *server_uuid,
                        int probe_interval)
 {
-    replication_init(sync_from, exclude, server_uuid, probe_interval);
+    replication_init(sync_from, exclude, server_uuid, probe_interval,
+                     is_relay);
     struct shash_node *node;
     SHASH_FOR_EACH (node, all_dbs) {
         struct db *db = node->data;
@@ -320,6 +325,10 @@ main(int argc, char *argv[])
     parse_options(argc, argv, &db_filenames, &remotes, &unixctl_path,
                   &run_command, &sync_from, &sync_exclude, &active);
     is_backup = sync_from && !active;
+    if (is_relay && !is_backup) {
+        ovs_fatal(0, "--relay requires --sync-from and is incompatible "
+                  "with --active");
+    }
 
     daemon_become_new_user(false);
 
@@ -591,7 +600,7 @@ parse_txn(struct server_config *config, struct db *db,
         error = ovsdb_file_txn_from_json(db->db, txn_json, false, &txn);
         if (!error) {
             ovsdb_txn_set_txnid(txnid, txn);
-            log_and_free_error(ovsdb_txn_replay_commit(txn));
+            log_and_free_error(ovsdb_txn_replay_commit_trusted(txn));
         }
         if (!error && !uuid_is_zero(txnid)) {
             db->db->prereq = *txnid;
@@ -1355,6 +1364,14 @@ ovsdb_server_disconnect_active_ovsdb_server(struct unixctl_conn *conn,
 {
     struct server_config *config = config_;
 
+    if (is_relay) {
+        /* A relay's local storage was never kept up to date, so it must not
+         * start serving writes. */
+        unixctl_command_reply_error(conn, "cannot disconnect a relay from "
+                                    "its active server");
+        return;
+    }
+
     disconnect_active_server();
     *config->is_backup = false;
     save_config(config);
@@ -1695,7 +1712,8 @@ ovsdb_server_get_sync_status(struct unixctl_conn *conn, int argc OVS_UNUSED,
     bool is_backup = *config->is_backup;
     struct ds ds = DS_EMPTY_INITIALIZER;
 
-    ds_put_format(&ds, "state: %s\n", is_backup ? "backup" : "active");
+    ds_put_format(&ds, "state: %s\n",
+                  is_backup ? is_relay ? "relay" : "backup" : "active");
 
     if (is_backup) {
         ds_put_and_free_cstr(&ds, replication_status());
@@ -1755,6 +1773,7 @@ parse_options(int argc, char *argv[],
         OPT_SYNC_FROM,
         OPT_SYNC_EXCLUDE,
         OPT_ACTIVE,
+        OPT_RELAY,
         OPT_NO_DBS,
         VLOG_OPTION_ENUMS,
         DAEMON_OPTION_ENUMS,
@@ -1777,6 +1796,7 @@ parse_options(int argc, char *argv[],
         {"sync-from",   required_argument, NULL, OPT_SYNC_FROM},
         {"sync-exclude-tables", required_argument, NULL, OPT_SYNC_EXCLUDE},
         {"active", no_argument, NULL, OPT_ACTIVE},
+        {"relay", no_argument, NULL, OPT_RELAY},
         {"no-dbs", no_argument, NULL, OPT_NO_DBS},
         {NULL, 0, NULL, 0},
     };
@@ -1864,6 +1884,10 @@ parse_options(int argc, char *argv[],
             *active = true;
             break;
 
+        case OPT_RELAY:
+            is_relay = true;
+            break;
+
         case OPT_NO_DBS:
             add_default_db = false;
             break;
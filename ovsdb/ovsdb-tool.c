@@ -347,6 +347,9 @@ write_standalone_db(const char *file_name, const char *comment,
     if (!error) {
         error = ovsdb_log_write_and_free(log, ovsdb_to_txn_json(db, comment));
     }
+    if (!error) {
+        error = ovsdb_log_flush(log);
+    }
     ovsdb_log_close(log);
 
     if (error) {
@@ -22,6 +22,81 @@
 #include "row.h"
 #include "table.h"
 
+/* Returns the argument of a clause in 'cnd' of the form "'column' ==
+ * <value>", or a null pointer if there is no such clause. */
+static const struct ovsdb_datum *
+ovsdb_query_find_eq_arg(const struct ovsdb_condition *cnd,
+                        const struct ovsdb_column *column)
+{
+    size_t i;
+
+    for (i = 0; i < cnd->n_clauses; i++) {
+        const struct ovsdb_clause *clause = &cnd->clauses[i];
+        if (clause->function == OVSDB_F_EQ
+            && clause->column->index == column->index) {
+            return &clause->arg;
+        }
+    }
+
+    return NULL;
+}
+
+/* Attempts to satisfy 'cnd' by probing one of 'table''s indexes instead of
+ * scanning every row.  An index is usable if 'cnd' has an equality clause for
+ * each of its columns.  Returns true if some index was probed (and the
+ * matching rows, if any, passed to 'output_row'), false if the caller must
+ * fall back to a full scan.
+ *
+ * The indexes only cover committed rows, so they cannot be used while a
+ * transaction that has already modified 'table' is in progress. */
+static bool
+ovsdb_query_index_probe(struct ovsdb_table *table,
+                        const struct ovsdb_condition *cnd,
+                        bool (*output_row)(const struct ovsdb_row *,
+                                           void *aux),
+                        void *aux)
+{
+    size_t i;
+
+    if (table->txn_table) {
+        return false;
+    }
+
+    for (i = 0; i < table->schema->n_indexes; i++) {
+        const struct ovsdb_column_set *columns = &table->schema->indexes[i];
+        struct hmap_node *node;
+        uint32_t hash = 0;
+        size_t j;
+
+        for (j = 0; j < columns->n_columns; j++) {
+            const struct ovsdb_column *column = columns->columns[j];
+            const struct ovsdb_datum *arg = ovsdb_query_find_eq_arg(cnd,
+                                                                    column);
+            if (!arg) {
+                break;
+            }
+            hash = ovsdb_datum_hash(arg, &column->type, hash);
+        }
+        if (j < columns->n_columns) {
+            continue;
+        }
+
+        /* The index is unique, so at most one row can match 'cnd', but hash
+         * collisions make the full condition check necessary. */
+        for (node = hmap_first_with_hash(&table->indexes[i], hash); node;
+             node = hmap_next_with_hash(node)) {
+            const struct ovsdb_row *row
+                = ovsdb_row_from_index_node(node, table, i);
+            if (ovsdb_condition_match_every_clause(row, cnd)) {
+                output_row(row, aux);
+            }
+        }
+        return true;
+    }
+
+    return false;
+}
+
 void
 ovsdb_query(struct ovsdb_table *table, const struct ovsdb_condition *cnd,
             bool (*output_row)(const struct ovsdb_row *, void *aux), void *aux)
@@ -38,6 +113,8 @@ ovsdb_query(struct ovsdb_table *table, const struct ovsdb_condition *cnd,
             ovsdb_condition_match_every_clause(row, cnd)) {
             output_row(row, aux);
         }
+    } else if (ovsdb_query_index_probe(table, cnd, output_row, aux)) {
+        /* Satisfied by a probe of one of the table's indexes. */
     } else {
         /* Linear scan. */
         const struct ovsdb_row *row, *next;
@@ -138,7 +138,8 @@ enum raft_waiter_type {
 /* An action deferred until a log write commits to disk. */
 struct raft_waiter {
     struct ovs_list list_node;
-    uint64_t commit_ticket;
+    bool start_commit;          /* Needs a durability ticket? */
+    uint64_t commit_ticket;     /* Assigned in raft_waiters_start_commit(). */
 
     enum raft_waiter_type type;
     union {
@@ -940,6 +941,12 @@ raft_add_conn(struct raft *raft, struct jsonrpc_session *js,
     conn->incoming = incoming;
     conn->js_seqno = jsonrpc_session_get_seqno(conn->js);
     jsonrpc_session_set_probe_interval(js, 0);
+
+    /* Serialize outgoing messages on the worker thread pool.  Most raft
+     * messages are small, but an install_snapshot_request carries the whole
+     * database, and serializing it inline would stall heartbeats and log
+     * replication to every other server for the duration. */
+    jsonrpc_session_set_threaded(js);
 }
 
 /* Starts the local server in an existing Raft cluster, using the local copy of
@@ -1586,6 +1593,26 @@ raft_waiter_destroy(struct raft_waiter *w)
     free(w);
 }
 
+/* Assigns a durability ticket to any waiter that needs one but has not been
+ * given one yet.  All such waiters share a single ticket, so that a burst of
+ * log appends within one poll loop iteration is flushed to disk and fsync'ed
+ * as one batch rather than record by record. */
+static void
+raft_waiters_start_commit(struct raft *raft)
+{
+    uint64_t ticket = 0;
+    struct raft_waiter *w;
+
+    LIST_FOR_EACH (w, list_node, &raft->waiters) {
+        if (w->start_commit && !w->commit_ticket) {
+            if (!ticket) {
+                ticket = ovsdb_log_commit_start(raft->log);
+            }
+            w->commit_ticket = ticket;
+        }
+    }
+}
+
 static void
 raft_waiters_run(struct raft *raft)
 {
@@ -1593,6 +1620,8 @@ raft_waiters_run(struct raft *raft)
         return;
     }
 
+    raft_waiters_start_commit(raft);
+
     uint64_t cur = ovsdb_log_commit_progress(raft->log);
     struct raft_waiter *w, *next;
     LIST_FOR_EACH_SAFE (w, next, list_node, &raft->waiters) {
@@ -1607,6 +1636,8 @@ raft_waiters_run(struct raft *raft)
 static void
 raft_waiters_wait(struct raft *raft)
 {
+    raft_waiters_start_commit(raft);
+
     struct raft_waiter *w;
     LIST_FOR_EACH (w, list_node, &raft->waiters) {
         ovsdb_log_commit_wait(raft->log, w->commit_ticket);
@@ -1799,6 +1830,17 @@ raft_run(struct raft *raft)
 
     raft_waiters_run(raft);
 
+    /* Commit a snapshot once its writer thread finishes.  On failure the
+     * current log simply remains in use; a later snapshot will retry the
+     * replacement. */
+    struct ovsdb_error *replace_error;
+    if (ovsdb_log_replace_async_run(raft->log, &replace_error)
+        && replace_error) {
+        char *s = ovsdb_error_to_string_free(replace_error);
+        VLOG_WARN("%s: failed to store snapshot (%s)", raft->name, s);
+        free(s);
+    }
+
     if (!raft->listener && time_msec() >= raft->listen_backoff) {
         char *paddr = raft_make_address_passive(raft->local_address);
         int error = pstream_open(paddr, &raft->listener, DSCP_DEFAULT);
@@ -1951,6 +1993,7 @@ raft_wait(struct raft *raft)
     }
 
     raft_waiters_wait(raft);
+    ovsdb_log_replace_async_wait(raft->log);
 
     if (raft->listener) {
         pstream_wait(raft->listener);
@@ -1982,7 +2025,7 @@ raft_waiter_create(struct raft *raft, enum raft_waiter_type type,
 {
     struct raft_waiter *w = xzalloc(sizeof *w);
     ovs_list_push_back(&raft->waiters, &w->list_node);
-    w->commit_ticket = start_commit ? ovsdb_log_commit_start(raft->log) : 0;
+    w->start_commit = start_commit;
     w->type = type;
     return w;
 }
@@ -3292,6 +3335,15 @@ raft_send_install_snapshot_request(struct raft *raft,
                                    const struct raft_server *s,
                                    const char *comment)
 {
+    /* The snapshot is by far the largest message we ever send.  If the
+     * connection still has a backlog -- quite possibly an earlier snapshot
+     * that is still on its way out -- don't queue another copy behind it;
+     * this function will be called again on the next append cycle. */
+    struct raft_conn *conn = raft_find_conn_by_sid(raft, &s->sid);
+    if (conn && jsonrpc_session_get_backlog(conn->js)) {
+        return;
+    }
+
     union raft_rpc rpc = {
         .install_snapshot_request = {
             .common = {
@@ -3858,11 +3910,20 @@ raft_handle_write_error(struct raft *raft, struct ovsdb_error *error)
     return !raft->failed;
 }
 
-static struct ovsdb_error * OVS_WARN_UNUSED_RESULT
-raft_write_snapshot(struct raft *raft, struct ovsdb_log *log,
-                    uint64_t new_log_start,
-                    const struct raft_entry *new_snapshot)
+/* Composes the records for a snapshot of 'raft': a header record that has
+ * 'new_snapshot' as its base, followed by the log entries from
+ * 'new_log_start' onward and the current term, vote, and commit index.
+ * Stores the records into '*entriesp' and their number into '*n_entriesp';
+ * the caller owns them. */
+static void
+raft_compose_snapshot(struct raft *raft, uint64_t new_log_start,
+                      const struct raft_entry *new_snapshot,
+                      struct json ***entriesp, size_t *n_entriesp)
 {
+    size_t allocated = (raft->log_end - new_log_start) + 3;
+    struct json **entries = xmalloc(allocated * sizeof *entries);
+    size_t n = 0;
+
     struct raft_header h = {
         .sid = raft->sid,
         .cid = raft->cid,
@@ -3871,14 +3932,9 @@ raft_write_snapshot(struct raft *raft, struct ovsdb_log *log,
         .snap_index = new_log_start - 1,
         .snap = *new_snapshot,
     };
-    struct ovsdb_error *error = ovsdb_log_write_and_free(
-        log, raft_header_to_json(&h));
-    if (error) {
-        return error;
-    }
-    ovsdb_log_mark_base(raft->log);
+    entries[n++] = raft_header_to_json(&h);
 
-    /* Write log records. */
+    /* Log records. */
     for (uint64_t index = new_log_start; index < raft->log_end; index++) {
         const struct raft_entry *e = &raft->entries[index - raft->log_start];
         struct raft_record r = {
@@ -3892,52 +3948,58 @@ raft_write_snapshot(struct raft *raft, struct ovsdb_log *log,
                 .eid = e->eid,
             },
         };
-        error = ovsdb_log_write_and_free(log, raft_record_to_json(&r));
-        if (error) {
-            return error;
-        }
+        entries[n++] = raft_record_to_json(&r);
     }
 
-    /* Write term and vote (if any).
+    /* Term and vote (if any).
      *
-     * The term is redundant if we wrote a log record for that term above.  The
-     * vote, if any, is never redundant.
+     * The term is redundant if we composed a log record for that term above.
+     * The vote, if any, is never redundant.
      */
-    error = raft_write_state(log, raft->term, &raft->vote);
-    if (error) {
-        return error;
+    struct raft_record state = { .term = raft->term };
+    if (!uuid_is_zero(&raft->vote)) {
+        state.type = RAFT_REC_VOTE;
+        state.sid = raft->vote;
+    } else {
+        state.type = RAFT_REC_TERM;
     }
+    entries[n++] = raft_record_to_json(&state);
 
-    /* Write commit_index if it's beyond the new start of the log. */
+    /* Commit index, if it's beyond the new start of the log. */
     if (raft->commit_index >= new_log_start) {
         struct raft_record r = {
             .type = RAFT_REC_COMMIT_INDEX,
             .commit_index = raft->commit_index,
         };
-        return ovsdb_log_write_and_free(log, raft_record_to_json(&r));
+        entries[n++] = raft_record_to_json(&r);
     }
-    return NULL;
+
+    ovs_assert(n <= allocated);
+    *entriesp = entries;
+    *n_entriesp = n;
 }
 
+/* Starts replacing the log for 'raft' by a snapshot.  The serialization and
+ * disk I/O happen in a writer thread; raft_run() commits the replacement when
+ * the thread finishes.  Until then the current log remains in use and new
+ * records appended to it carry over into the replacement. */
 static struct ovsdb_error * OVS_WARN_UNUSED_RESULT
 raft_save_snapshot(struct raft *raft,
                    uint64_t new_start, const struct raft_entry *new_snapshot)
 
 {
-    struct ovsdb_log *new_log;
-    struct ovsdb_error *error;
-    error = ovsdb_log_replace_start(raft->log, &new_log);
-    if (error) {
-        return error;
-    }
+    struct json **entries;
+    size_t n_entries;
+    raft_compose_snapshot(raft, new_start, new_snapshot,
+                          &entries, &n_entries);
 
-    error = raft_write_snapshot(raft, new_log, new_start, new_snapshot);
-    if (error) {
-        ovsdb_log_replace_abort(new_log);
-        return error;
+    struct ovsdb_error *error
+        = ovsdb_log_replace_async_start(raft->log, entries, n_entries);
+    for (size_t i = 0; i < n_entries; i++) {
+        json_destroy(entries[i]);
     }
-
-    return ovsdb_log_replace_commit(raft->log, new_log);
+    free(entries);
+    return error;
 }
 
 static bool
@@ -4097,12 +4159,45 @@ raft_may_snapshot(const struct raft *raft)
             && !raft->leaving
             && !raft->left
             && !raft->failed
+            && !ovsdb_log_replace_is_active(raft->log)
             && raft->last_applied >= raft->log_start);
 }
 
+/* Rotating per-server time slots for taking snapshots.  Compacting the log
+ * stalls a server while the database is serialized, so the members of a
+ * cluster take turns: time is divided into slots of this length and each
+ * server only starts a snapshot during the slot that matches its rank within
+ * the cluster.  That way at most one member compacts at any given time and
+ * the rest keep the cluster responsive. */
+#define RAFT_SNAPSHOT_SLOT_MSEC (60 * 1000)
+
+/* Returns true if it is 'raft''s turn to take a snapshot, false if a snapshot
+ * taken now could coincide with one on another member of the cluster. */
+bool
+raft_snapshot_slot_open(const struct raft *raft)
+{
+    const struct raft_server *s;
+    size_t rank = 0;
+    size_t n = 0;
+
+    HMAP_FOR_EACH (s, hmap_node, &raft->servers) {
+        n++;
+        if (uuid_compare_3way(&s->sid, &raft->sid) < 0) {
+            rank++;
+        }
+    }
+    if (n < 2) {
+        return true;
+    }
+
+    return (time_msec() / RAFT_SNAPSHOT_SLOT_MSEC) % n == rank;
+}
+
 /* Replaces the log for 'raft', up to the last log entry read, by
- * 'new_snapshot_data'.  Returns NULL if successful, otherwise an error that
- * the caller must eventually free.
+ * 'new_snapshot_data'.  Returns NULL if the replacement started successfully,
+ * otherwise an error that the caller must eventually free.  The disk I/O
+ * happens in a background thread; raft_run() commits the replacement when it
+ * finishes, and until then no further snapshot may be taken.
  *
  * This function can only succeed if raft_may_snapshot() returns true.  It is
  * only valuable to call it if raft_get_log_length() is significant and
@@ -4122,6 +4217,8 @@ raft_store_snapshot(struct raft *raft, const struct json *new_snapshot_data)
     } else if (raft->failed) {
         return ovsdb_error(NULL,
                            "cannot store a snapshot following failure");
+    } else if (ovsdb_log_replace_is_active(raft->log)) {
+        return ovsdb_error(NULL, "snapshot already in progress");
     }
 
     if (raft->last_applied < raft->log_start) {
@@ -4143,7 +4240,11 @@ raft_store_snapshot(struct raft *raft, const struct json *new_snapshot_data)
         return error;
     }
 
-    raft->log_synced = raft->log_end - 1;
+    /* The snapshot is still being written in the background, so unlike the
+     * entries' own commit tickets it proves nothing about durability yet;
+     * leave 'log_synced' to the waiters.  The in-memory log can be compacted
+     * right away, though: the current log file stays in use, and keeps
+     * accumulating records, until the replacement commits. */
     raft_entry_uninit(&raft->snap);
     raft->snap = new_snapshot;
     for (size_t i = 0; i < new_log_start - raft->log_start; i++) {
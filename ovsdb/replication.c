@@ -49,6 +49,11 @@ static void add_monitored_table(struct ovsdb_table_schema *table,
 
 static struct ovsdb_error *reset_database(struct ovsdb *db);
 
+/* True if this server is a relay: the local databases are only an in-memory
+ * cache of the active server, re-multiplexed to read-only clients, and are
+ * never written back to the local storage. */
+static bool relay_mode;
+
 static struct ovsdb_error *process_notification(struct json *, struct ovsdb *);
 static struct ovsdb_error *process_table_update(struct json *table_update,
                                                 const char *table_name,
@@ -125,8 +130,10 @@ static struct replication_db *find_db(const char *db_name);
 
 void
 replication_init(const char *sync_from_, const char *exclude_tables,
-                 const struct uuid *server, int probe_interval)
+                 const struct uuid *server, int probe_interval, bool relay)
 {
+    relay_mode = relay;
+
     free(sync_from);
     sync_from = xstrdup(sync_from_);
     /* Caller should have verified that the 'exclude_tables' is
@@ -551,6 +558,21 @@ find_db(const char *db_name)
     return shash_find_data(replication_dbs, db_name);
 }
 
+/* Commits 'txn', which holds data mirrored from the active server.  A backup
+ * keeps its local storage up to date so that it can take over as the active
+ * server.  A relay's copy is only a cache that is rebuilt from the active
+ * server after a restart anyway, so commit it straight to memory and skip
+ * both the storage write and the constraint re-checks that the active server
+ * already performed. */
+static struct ovsdb_error *
+replication_commit_txn(struct ovsdb_txn *txn)
+{
+    if (relay_mode) {
+        return ovsdb_txn_replay_commit_trusted(txn);
+    }
+    return ovsdb_txn_propose_commit_block(txn, false);
+}
+
 static struct ovsdb_error *
 reset_database(struct ovsdb *db)
 {
@@ -568,7 +590,7 @@ reset_database(struct ovsdb *db)
         }
     }
 
-    return ovsdb_txn_propose_commit_block(txn, false);
+    return replication_commit_txn(txn);
 }
 
 /* Create a monitor request for 'db'. The monitor request will include
@@ -646,7 +668,7 @@ process_notification(struct json *table_updates, struct ovsdb *db)
             return error;
         } else {
             /* Commit transaction. */
-            error = ovsdb_txn_propose_commit_block(txn, false);
+            error = replication_commit_txn(txn);
         }
     }
 
@@ -998,5 +1020,7 @@ Syncing options:\n\
                           backup mode (except with --active)\n\
   --sync-exclude-tables=DB:TABLE,...\n\
                           exclude the TABLE in DB from syncing\n\
-  --active                with --sync-from, start in active mode\n");
+  --active                with --sync-from, start in active mode\n\
+  --relay                 with --sync-from, serve the synced data to\n\
+                          read-only clients from memory only\n");
 }
@@ -47,7 +47,8 @@ struct ovsdb;
 #define REPLICATION_DEFAULT_PROBE_INTERVAL 60000
 
 void replication_init(const char *sync_from, const char *exclude_tables,
-                      const struct uuid *server, int probe_interval);
+                      const struct uuid *server, int probe_interval,
+                      bool relay);
 void replication_run(void);
 void replication_wait(void);
 void replication_destroy(void);
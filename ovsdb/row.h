@@ -73,6 +73,11 @@ struct ovsdb_row *ovsdb_row_create(const struct ovsdb_table *);
 struct ovsdb_row *ovsdb_row_clone(const struct ovsdb_row *);
 void ovsdb_row_destroy(struct ovsdb_row *);
 
+struct hmap_node *ovsdb_row_get_index_node(struct ovsdb_row *, size_t i);
+struct ovsdb_row *ovsdb_row_from_index_node(struct hmap_node *,
+                                            const struct ovsdb_table *,
+                                            size_t i);
+
 uint32_t ovsdb_row_hash_columns(const struct ovsdb_row *,
                                 const struct ovsdb_column_set *,
                                 uint32_t basis);
@@ -524,6 +524,12 @@ ovsdb_storage_should_snapshot(const struct ovsdb_storage *storage)
             return false;
         }
 
+        /* Wait for our turn in the cluster's rotation, so that at most one
+         * member compacts at a time. */
+        if (storage->raft && !raft_snapshot_slot_open(storage->raft)) {
+            return false;
+        }
+
         uint64_t log_len = (storage->raft
                             ? raft_get_log_length(storage->raft)
                             : storage->n_read + storage->n_written);
@@ -51,7 +51,7 @@ struct ovsdb_txn_table {
 
     /* This has the same form as the 'indexes' member of struct ovsdb_table,
      * but it is only used or updated at transaction commit time, from
-     * check_index_uniqueness(). */
+     * update_index_nodes() and check_index_uniqueness(). */
     struct hmap *txn_indexes;
 
     /* Used by for_each_txn_row(). */
@@ -157,33 +157,6 @@ ovsdb_txn_row_abort(struct ovsdb_txn *txn OVS_UNUSED,
     return NULL;
 }
 
-/* Returns the offset in bytes from the start of an ovsdb_row for 'table' to
- * the hmap_node for the index numbered 'i'. */
-static size_t
-ovsdb_row_index_offset__(const struct ovsdb_table *table, size_t i)
-{
-    size_t n_fields = shash_count(&table->schema->columns);
-    return (offsetof(struct ovsdb_row, fields)
-            + n_fields * sizeof(struct ovsdb_datum)
-            + i * sizeof(struct hmap_node));
-}
-
-/* Returns the hmap_node in 'row' for the index numbered 'i'. */
-static struct hmap_node *
-ovsdb_row_get_index_node(struct ovsdb_row *row, size_t i)
-{
-    return (void *) ((char *) row + ovsdb_row_index_offset__(row->table, i));
-}
-
-/* Returns the ovsdb_row given 'index_node', which is a pointer to that row's
- * hmap_node for the index numbered 'i' within 'table'. */
-static struct ovsdb_row *
-ovsdb_row_from_index_node(struct hmap_node *index_node,
-                          const struct ovsdb_table *table, size_t i)
-{
-    return (void *) ((char *) index_node - ovsdb_row_index_offset__(table, i));
-}
-
 void
 ovsdb_txn_abort(struct ovsdb_txn *txn)
 {
@@ -772,8 +745,36 @@ duplicate_index_row(const struct ovsdb_column_set *index,
     return error;
 }
 
+/* Computes each schema index's hash for 'txn_row''s new row and inserts the
+ * row's index nodes into the transaction's temporary index hash tables.  This
+ * is not just bookkeeping for check_index_uniqueness(): the insertion is what
+ * sets each node's hash, which ovsdb_txn_row_commit() reuses when it moves
+ * the nodes into the table's real indexes, so it must run for every committed
+ * row whether or not the uniqueness check does. */
+static struct ovsdb_error * OVS_WARN_UNUSED_RESULT
+update_index_nodes(struct ovsdb_txn *txn OVS_UNUSED,
+                   struct ovsdb_txn_row *txn_row)
+{
+    struct ovsdb_row *row = txn_row->new;
+    if (!row) {
+        return NULL;
+    }
+
+    struct ovsdb_txn_table *txn_table = txn_row->table->txn_table;
+    struct ovsdb_table *table = txn_row->table;
+    for (size_t i = 0; i < table->schema->n_indexes; i++) {
+        const struct ovsdb_column_set *index = &table->schema->indexes[i];
+        uint32_t hash = ovsdb_row_hash_columns(row, index, 0);
+
+        hmap_insert(&txn_table->txn_indexes[i],
+                    ovsdb_row_get_index_node(row, i), hash);
+    }
+
+    return NULL;
+}
+
 static struct ovsdb_error * OVS_WARN_UNUSED_RESULT
-check_index_uniqueness(struct ovsdb_txn *txn OVS_UNUSED,
+check_index_uniqueness(struct ovsdb_txn *txn,
                        struct ovsdb_txn_row *txn_row)
 {
     /* Skip rows that are being deleted since they can't violate uniqueness. */
@@ -808,13 +809,10 @@ check_index_uniqueness(struct ovsdb_txn *txn OVS_UNUSED,
         if (irow && !irow->txn_row) {
             return duplicate_index_row(index, irow, row);
         }
-
-        /* Add row to temporary hash table. */
-        hmap_insert(&txn_table->txn_indexes[i],
-                    ovsdb_row_get_index_node(row, i), hash);
     }
 
-    return NULL;
+    /* Add row to temporary hash tables. */
+    return update_index_nodes(txn, txn_row);
 }
 
 static struct ovsdb_error * OVS_WARN_UNUSED_RESULT
@@ -839,7 +837,7 @@ ovsdb_txn_is_empty(const struct ovsdb_txn *txn)
 }
 
 static struct ovsdb_error * OVS_WARN_UNUSED_RESULT
-ovsdb_txn_precommit(struct ovsdb_txn *txn)
+ovsdb_txn_precommit__(struct ovsdb_txn *txn, bool check_constraints)
 {
     struct ovsdb_error *error;
 
@@ -867,9 +865,11 @@ ovsdb_txn_precommit(struct ovsdb_txn *txn)
     }
 
     /* Check maximum rows table constraints. */
-    error = check_max_rows(txn);
-    if (error) {
-        return error;
+    if (check_constraints) {
+        error = check_max_rows(txn);
+        if (error) {
+            return error;
+        }
     }
 
     /* Check reference counts and remove bad references for "weak" referential
@@ -879,8 +879,12 @@ ovsdb_txn_precommit(struct ovsdb_txn *txn)
         return error;
     }
 
-    /* Verify that the indexes will still be unique post-transaction. */
-    error = for_each_txn_row(txn, check_index_uniqueness);
+    /* Verify that the indexes will still be unique post-transaction.  Even
+     * when the check is skipped, the index nodes still have to be populated,
+     * since that is what assigns their hashes (see update_index_nodes()). */
+    error = for_each_txn_row(txn, check_constraints
+                                  ? check_index_uniqueness
+                                  : update_index_nodes);
     if (error) {
         return error;
     }
@@ -894,6 +898,12 @@ ovsdb_txn_precommit(struct ovsdb_txn *txn)
     return error;
 }
 
+static struct ovsdb_error * OVS_WARN_UNUSED_RESULT
+ovsdb_txn_precommit(struct ovsdb_txn *txn)
+{
+    return ovsdb_txn_precommit__(txn, true);
+}
+
 static struct ovsdb_txn*
 ovsdb_txn_clone(const struct ovsdb_txn *txn)
 {
@@ -993,6 +1003,26 @@ ovsdb_txn_replay_commit(struct ovsdb_txn *txn)
     return error;
 }
 
+/* Variant of ovsdb_txn_replay_commit() for transactions read back from the
+ * database's own storage.  Those transactions already passed the full checks
+ * when they were first committed, so this skips re-checking the constraints
+ * (index uniqueness and table size limits) and only does the bookkeeping
+ * needed to reconstruct the in-memory state, which makes replaying a long log
+ * considerably faster.  It must not be used for data from any other source,
+ * e.g. for database conversion. */
+struct ovsdb_error * OVS_WARN_UNUSED_RESULT
+ovsdb_txn_replay_commit_trusted(struct ovsdb_txn *txn)
+{
+    struct ovsdb_error *error = ovsdb_txn_precommit__(txn, false);
+    if (error) {
+        ovsdb_txn_abort(txn);
+    } else {
+        ovsdb_txn_add_to_history(txn);
+        ovsdb_txn_complete(txn);
+    }
+    return error;
+}
+
 /* If 'error' is nonnull, the transaction is complete, with the given error as
  * the result.
  *
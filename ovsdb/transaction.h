@@ -32,6 +32,8 @@ void ovsdb_txn_abort(struct ovsdb_txn *);
 bool ovsdb_txn_precheck_prereq(const struct ovsdb *db);
 struct ovsdb_error *ovsdb_txn_replay_commit(struct ovsdb_txn *)
     OVS_WARN_UNUSED_RESULT;
+struct ovsdb_error *ovsdb_txn_replay_commit_trusted(struct ovsdb_txn *)
+    OVS_WARN_UNUSED_RESULT;
 struct ovsdb_txn_progress *ovsdb_txn_propose_commit(struct ovsdb_txn *,
                                                     bool durable)
     OVS_WARN_UNUSED_RESULT;
@@ -478,18 +478,54 @@ p4rt_dpif_entry_add(struct p4rt *p, struct p4rtutil_table_entry *entry)
     }
 
     return dpif->dpif_class->dp_table_entry_add(dpif, p->dev_id, entry->table_id,
-                                                entry->action_id,
+                                                entry->action_id, entry->priority,
                                                 entry->match_key, entry->key_size, entry->action_data,
                                                 entry->data_size);
 }
 
 static int
-p4rt_dpif_entry_del(struct p4rt *p, uint32_t table_id, const char *match_key, size_t key_size)
+p4rt_dpif_entry_add_batch(struct p4rt *p, struct ovs_list *entries)
 {
     struct p4rt_dpif *p4rt = p4rt_dpif_cast(p);
     struct dpif *dpif = p4rt->backer->dpif;
+    struct p4rtutil_table_entry *entry;
+
+    /* Default-action entries descend through a different datapath call,
+     * so a batch containing one falls back to per-entry installation. */
+    if (dpif->dpif_class->dp_table_entry_add_batch) {
+        bool any_default = false;
+
+        LIST_FOR_EACH (entry, list_node, entries) {
+            if (entry->is_default) {
+                any_default = true;
+                break;
+            }
+        }
+        if (!any_default) {
+            return dpif->dpif_class->dp_table_entry_add_batch(dpif, p->dev_id,
+                                                              entries);
+        }
+    }
+
+    LIST_FOR_EACH (entry, list_node, entries) {
+        int error = p4rt_dpif_entry_add(p, entry);
+        if (error) {
+            return error;
+        }
+    }
+
+    return 0;
+}
 
-    return dpif->dpif_class->dp_table_entry_del(dpif, p->dev_id, table_id, match_key, key_size);
+static int
+p4rt_dpif_entry_del(struct p4rt *p, uint32_t table_id, uint32_t priority,
+                    const char *match_key, size_t key_size)
+{
+    struct p4rt_dpif *p4rt = p4rt_dpif_cast(p);
+    struct dpif *dpif = p4rt->backer->dpif;
+
+    return dpif->dpif_class->dp_table_entry_del(dpif, p->dev_id, table_id,
+                                                priority, match_key, key_size);
 }
 
 static int
@@ -503,6 +539,114 @@ p4rt_dpif_fetch_entries(struct p4rt *p OVS_UNUSED,
     return dpif->dpif_class->dp_table_query(dpif, p->dev_id, table_id, entries);
 }
 
+static int
+p4rt_dpif_counter_read_all(struct p4rt *p, uint32_t counter_id,
+                           uint64_t **valuesp, size_t *n_valuesp)
+{
+    struct p4rt_dpif *p4rt = p4rt_dpif_cast(p);
+    struct dpif *dpif = p4rt->backer->dpif;
+
+    if (!dpif->dpif_class->dp_counter_query) {
+        return EOPNOTSUPP;
+    }
+    return dpif->dpif_class->dp_counter_query(dpif, p->dev_id, counter_id,
+                                              valuesp, n_valuesp);
+}
+
+static int
+p4rt_dpif_act_prof_member_create(struct p4rt *p, uint32_t act_prof_id,
+                                 uint32_t action_id, const char *action_data,
+                                 size_t data_size, uint32_t *mbr_handle)
+{
+    struct p4rt_dpif *p4rt = p4rt_dpif_cast(p);
+    struct dpif *dpif = p4rt->backer->dpif;
+
+    if (!dpif->dpif_class->dp_act_prof_member_create) {
+        return EOPNOTSUPP;
+    }
+    return dpif->dpif_class->dp_act_prof_member_create(dpif, p->dev_id,
+                                                       act_prof_id, action_id,
+                                                       action_data, data_size,
+                                                       mbr_handle);
+}
+
+static int
+p4rt_dpif_act_prof_member_modify(struct p4rt *p, uint32_t act_prof_id,
+                                 uint32_t mbr_handle, uint32_t action_id,
+                                 const char *action_data, size_t data_size)
+{
+    struct p4rt_dpif *p4rt = p4rt_dpif_cast(p);
+    struct dpif *dpif = p4rt->backer->dpif;
+
+    if (!dpif->dpif_class->dp_act_prof_member_modify) {
+        return EOPNOTSUPP;
+    }
+    return dpif->dpif_class->dp_act_prof_member_modify(dpif, p->dev_id,
+                                                       act_prof_id,
+                                                       mbr_handle, action_id,
+                                                       action_data,
+                                                       data_size);
+}
+
+static int
+p4rt_dpif_act_prof_member_del(struct p4rt *p, uint32_t act_prof_id,
+                              uint32_t mbr_handle)
+{
+    struct p4rt_dpif *p4rt = p4rt_dpif_cast(p);
+    struct dpif *dpif = p4rt->backer->dpif;
+
+    if (!dpif->dpif_class->dp_act_prof_member_del) {
+        return EOPNOTSUPP;
+    }
+    return dpif->dpif_class->dp_act_prof_member_del(dpif, p->dev_id,
+                                                    act_prof_id, mbr_handle);
+}
+
+static int
+p4rt_dpif_act_prof_group_create(struct p4rt *p, uint32_t act_prof_id,
+                                uint32_t *grp_handle)
+{
+    struct p4rt_dpif *p4rt = p4rt_dpif_cast(p);
+    struct dpif *dpif = p4rt->backer->dpif;
+
+    if (!dpif->dpif_class->dp_act_prof_group_create) {
+        return EOPNOTSUPP;
+    }
+    return dpif->dpif_class->dp_act_prof_group_create(dpif, p->dev_id,
+                                                      act_prof_id,
+                                                      grp_handle);
+}
+
+static int
+p4rt_dpif_act_prof_group_set(struct p4rt *p, uint32_t act_prof_id,
+                             uint32_t grp_handle,
+                             const uint32_t *mbr_handles, size_t n_mbrs)
+{
+    struct p4rt_dpif *p4rt = p4rt_dpif_cast(p);
+    struct dpif *dpif = p4rt->backer->dpif;
+
+    if (!dpif->dpif_class->dp_act_prof_group_set) {
+        return EOPNOTSUPP;
+    }
+    return dpif->dpif_class->dp_act_prof_group_set(dpif, p->dev_id,
+                                                   act_prof_id, grp_handle,
+                                                   mbr_handles, n_mbrs);
+}
+
+static int
+p4rt_dpif_act_prof_group_del(struct p4rt *p, uint32_t act_prof_id,
+                             uint32_t grp_handle)
+{
+    struct p4rt_dpif *p4rt = p4rt_dpif_cast(p);
+    struct dpif *dpif = p4rt->backer->dpif;
+
+    if (!dpif->dpif_class->dp_act_prof_group_del) {
+        return EOPNOTSUPP;
+    }
+    return dpif->dpif_class->dp_act_prof_group_del(dpif, p->dev_id,
+                                                   act_prof_id, grp_handle);
+}
+
 static int
 p4rt_dpif_entry_get_default(struct p4rt *p, uint32_t table_id, uint32_t *action_id, char **action_data)
 {
@@ -543,4 +687,12 @@ const struct p4rt_class p4rt_dpif_class = {
         p4rt_dpif_entry_del,
         p4rt_dpif_fetch_entries,
         p4rt_dpif_entry_get_default,
+        p4rt_dpif_entry_add_batch,
+        p4rt_dpif_counter_read_all,
+        p4rt_dpif_act_prof_member_create,
+        p4rt_dpif_act_prof_member_modify,
+        p4rt_dpif_act_prof_member_del,
+        p4rt_dpif_act_prof_group_create,
+        p4rt_dpif_act_prof_group_set,
+        p4rt_dpif_act_prof_group_del,
 };
@@ -176,9 +176,41 @@ struct p4rt_class {
 /* ## ------------------------ ## */
 
     int (*entry_add)(struct p4rt *p, struct p4rtutil_table_entry *entry);
-    int (*entry_del)(struct p4rt *p, uint32_t table_id, const char *match_key, size_t key_size);
+    int (*entry_del)(struct p4rt *p, uint32_t table_id, uint32_t priority,
+                     const char *match_key, size_t key_size);
     int (*fetch_entries)(struct p4rt *p, uint32_t table_id, struct ovs_list *entries);
     int (*entry_get_default)(struct p4rt *p, uint32_t table_id, uint32_t *action_id, char **action_data);
+
+    /* Installs every 'struct p4rtutil_table_entry' on 'entries' in one
+     * call.  Optional; p4rt_entry_add_batch() falls back to per-entry
+     * 'entry_add' when NULL. */
+    int (*entry_add_batch)(struct p4rt *p, struct ovs_list *entries);
+
+    /* Snapshots every value of counter 'counter_id' in one pass.  See
+     * dp_counter_query in struct dpif_class for the contract on
+     * '*valuesp' and '*n_valuesp'.  Optional. */
+    int (*counter_read_all)(struct p4rt *p, uint32_t counter_id,
+                            uint64_t **valuesp, size_t *n_valuesp);
+
+    /* Action profile operations backing P4 action selectors.  Member and
+     * group handles are allocated by the datapath and returned through
+     * the out parameters.  Optional as a set. */
+    int (*act_prof_member_create)(struct p4rt *p, uint32_t act_prof_id,
+                                  uint32_t action_id,
+                                  const char *action_data, size_t data_size,
+                                  uint32_t *mbr_handle);
+    int (*act_prof_member_modify)(struct p4rt *p, uint32_t act_prof_id,
+                                  uint32_t mbr_handle, uint32_t action_id,
+                                  const char *action_data, size_t data_size);
+    int (*act_prof_member_del)(struct p4rt *p, uint32_t act_prof_id,
+                               uint32_t mbr_handle);
+    int (*act_prof_group_create)(struct p4rt *p, uint32_t act_prof_id,
+                                 uint32_t *grp_handle);
+    int (*act_prof_group_set)(struct p4rt *p, uint32_t act_prof_id,
+                              uint32_t grp_handle,
+                              const uint32_t *mbr_handles, size_t n_mbrs);
+    int (*act_prof_group_del)(struct p4rt *p, uint32_t act_prof_id,
+                              uint32_t grp_handle);
 };
 
 extern const struct p4rt_class p4rt_dpif_class;
@@ -6,6 +6,8 @@
 
 #include <PI/int/pi_int.h>
 #include <PI/pi.h>
+#include <PI/target/pi_act_prof_imp.h>
+#include <PI/target/pi_counter_imp.h>
 #include <PI/target/pi_imp.h>
 #include <PI/target/pi_tables_imp.h>
 
@@ -19,6 +21,10 @@
 #include "ovs-rcu.h"
 #include "smap.h"
 #include "sset.h"
+#include "lib/bpf/ubpf_digest.h"
+#include "lib/bpf/ubpf_expiry.h"
+#include "lib/bpf/ubpf_packetin.h"
+#include "lib/dp-packet.h"
 #include "lib/dpif.h"
 #include "lib/p4rt-objects.h"
 
@@ -467,9 +473,61 @@ p4rt_enumerate_types(struct sset *types)
     }
 }
 
+/* Receives coalesced digest batches from the datapath's digest thread.
+ * One callback invocation corresponds to one DigestList toward the
+ * controller; the actual P4Runtime encoding has to go through the PI
+ * learn frontend, which cannot be driven until DeviceMgr integration is
+ * sorted out (see the FIXME in p4rt_init()), so for now the batch is
+ * only accounted for. */
+static void
+p4rt_digest_cb(const struct ubpf_digest_record *recs, size_t n,
+               void *aux OVS_UNUSED)
+{
+    VLOG_DBG_RL(&rl, "digest batch: %"PRIuSIZE" records, first id %"PRIu32,
+                n, recs[0].digest_id);
+}
+
+/* Receives punted-packet batches from the datapath's PacketIn delivery
+ * thread and relays each packet to the P4Runtime frontend, which
+ * forwards it on the controller's StreamChannel.  Any metadata for the
+ * controller (the program's @controller_header fields) travels in-band
+ * in the frame the program prepared; the ingress port recorded with
+ * each packet is kept for accounting.  The per-batch cost - waking the
+ * delivery thread, the session locks inside PI - is paid once here, the
+ * pi_packetin_receive() call itself is per packet. */
+static void
+p4rt_packet_in_cb(const struct ubpf_packetin *pkts, size_t n,
+                  void *aux OVS_UNUSED)
+{
+    for (size_t i = 0; i < n; i++) {
+        pi_packetin_receive(pkts[i].prog_id, dp_packet_data(pkts[i].packet),
+                            dp_packet_size(pkts[i].packet));
+    }
+    VLOG_DBG_RL(&rl, "packet-in batch: %"PRIuSIZE" packets, first from "
+                "port %"PRIu32, n, pkts[0].in_port);
+}
+
+/* Receives idle-timeout eviction batches from the datapath's expiry
+ * sweeper.  Each record is one table entry evicted for inactivity; the
+ * P4Runtime IdleTimeoutNotification encoding has to go through PI's
+ * DeviceMgr like the digests above, so until that integration lands the
+ * evictions are only accounted for here.  The datapath entry is gone
+ * either way. */
+static void
+p4rt_idle_timeout_cb(const struct ubpf_expiry_record *recs, size_t n,
+                     void *aux OVS_UNUSED)
+{
+    VLOG_DBG_RL(&rl, "idle-timeout batch: %"PRIuSIZE" entries evicted, "
+                "first from prog %"PRIu32" table %"PRIu16,
+                n, recs[0].prog_id, recs[0].map_id);
+}
+
 void
 p4rt_init(void)
 {
+    ubpf_digest_set_cb(p4rt_digest_cb, NULL);
+    ubpf_expiry_set_cb(p4rt_idle_timeout_cb, NULL);
+    ubpf_packetin_set_cb(p4rt_packet_in_cb, NULL);
     p4rt_class_register(&p4rt_dpif_class);
     size_t i;
     for (i = 0; i < n_p4rt_classes; i++) {
@@ -767,10 +825,163 @@ p4rt_prog_del(struct p4rt *p)
     return 0;
 }
 
+/* Installs every 'struct p4rtutil_table_entry' on 'entries' into 'p', in
+ * one descent into the provider when it supports batching.  Stops at the
+ * first entry that fails and returns its error.  Control-plane frontends
+ * should prefer this over per-entry insertion when loading large
+ * tables. */
+int
+p4rt_entry_add_batch(struct p4rt *p, struct ovs_list *entries)
+{
+    struct p4rtutil_table_entry *entry;
+
+    if (p->p4rt_class->entry_add_batch) {
+        return p->p4rt_class->entry_add_batch(p, entries);
+    }
+
+    LIST_FOR_EACH (entry, list_node, entries) {
+        int error = p->p4rt_class->entry_add(p, entry);
+        if (error) {
+            return error;
+        }
+    }
+
+    return 0;
+}
+
 /* ## ------------- ## */
 /* ## PI functions. ## */
 /* ## ------------- ## */
 
+/* Batched table ingestion.
+ *
+ * Between _pi_batch_begin() and _pi_batch_end() the PI frontend may issue
+ * many table inserts for one WriteRequest.  Instead of descending into the
+ * provider for each of them, inserts are queued per session and handed to
+ * p4rt_entry_add_batch() in chunks, which is what makes pipelined bulk
+ * loads (e.g. "ovs-p4ctl load-entries") fast.  Queued inserts are flushed
+ * before any delete, default-action change or fetch on the same session so
+ * that update ordering is preserved. */
+
+#define P4RT_BATCH_FLUSH_THRESHOLD 4096
+
+struct p4rt_batch {
+    struct hmap_node hmap_node;  /* In 'batches', hashed on session. */
+    pi_session_handle_t session;
+    uint64_t dev_id;             /* Device the queued entries target. */
+    struct ovs_list entries;     /* Deep copies of queued table entries. */
+    size_t n_entries;
+};
+
+static struct ovs_mutex batch_mutex = OVS_MUTEX_INITIALIZER;
+static struct hmap batches OVS_GUARDED_BY(batch_mutex)
+    = HMAP_INITIALIZER(&batches);
+
+static struct p4rt_batch *
+p4rt_batch_find(pi_session_handle_t session) OVS_REQUIRES(batch_mutex)
+{
+    struct p4rt_batch *batch;
+
+    HMAP_FOR_EACH_WITH_HASH (batch, hmap_node, hash_int(session, 0),
+                             &batches) {
+        if (batch->session == session) {
+            return batch;
+        }
+    }
+    return NULL;
+}
+
+static void
+p4rt_batch_entry_free(struct p4rtutil_table_entry *entry)
+{
+    free(CONST_CAST(char *, entry->match_key));
+    free(entry->action_data);
+    free(entry);
+}
+
+/* Installs the queued entries of 'batch' in one provider call and empties
+ * the queue.  Returns PI_STATUS_SUCCESS, or the status of the first
+ * failing entry. */
+static pi_status_t
+p4rt_batch_flush(struct p4rt_batch *batch) OVS_REQUIRES(batch_mutex)
+{
+    struct p4rtutil_table_entry *entry, *next;
+    pi_status_t status = PI_STATUS_SUCCESS;
+
+    if (batch->n_entries) {
+        struct p4rt *p4rt = p4rt_lookup_by_dev_id(batch->dev_id);
+
+        if (p4rt) {
+            int error = p4rt_entry_add_batch(p4rt, &batch->entries);
+            if (error) {
+                VLOG_WARN_RL(&rl, "failed to insert batched P4 table entries "
+                             "to device %"PRIu64" (%s)",
+                             batch->dev_id, ovs_strerror(error));
+                status = PI_STATUS_TARGET_ERROR;
+            }
+        } else {
+            status = PI_STATUS_DEV_OUT_OF_RANGE;
+        }
+    }
+
+    LIST_FOR_EACH_SAFE (entry, next, list_node, &batch->entries) {
+        ovs_list_remove(&entry->list_node);
+        p4rt_batch_entry_free(entry);
+    }
+    batch->n_entries = 0;
+
+    return status;
+}
+
+/* Flushes any inserts queued on 'session' so that a subsequent operation
+ * observes them in order.  A no-op outside a batch. */
+static void
+p4rt_batch_barrier(pi_session_handle_t session)
+{
+    struct p4rt_batch *batch;
+
+    ovs_mutex_lock(&batch_mutex);
+    batch = p4rt_batch_find(session);
+    if (batch) {
+        p4rt_batch_flush(batch);
+    }
+    ovs_mutex_unlock(&batch_mutex);
+}
+
+pi_status_t _pi_batch_begin(pi_session_handle_t session_handle) {
+    struct p4rt_batch *batch;
+
+    ovs_mutex_lock(&batch_mutex);
+    batch = p4rt_batch_find(session_handle);
+    if (!batch) {
+        batch = xmalloc(sizeof *batch);
+        batch->session = session_handle;
+        batch->n_entries = 0;
+        ovs_list_init(&batch->entries);
+        hmap_insert(&batches, &batch->hmap_node, hash_int(session_handle, 0));
+    }
+    ovs_mutex_unlock(&batch_mutex);
+
+    return PI_STATUS_SUCCESS;
+}
+
+pi_status_t _pi_batch_end(pi_session_handle_t session_handle,
+                          bool hw_sync OVS_UNUSED) {
+    pi_status_t status = PI_STATUS_SUCCESS;
+    struct p4rt_batch *batch;
+
+    ovs_mutex_lock(&batch_mutex);
+    batch = p4rt_batch_find(session_handle);
+    if (batch) {
+        status = p4rt_batch_flush(batch);
+        hmap_remove(&batches, &batch->hmap_node);
+        free(batch);
+    }
+    ovs_mutex_unlock(&batch_mutex);
+
+    return status;
+}
+
 
 pi_status_t _pi_assign_device(pi_dev_id_t dev_id, const pi_p4info_t *p4info OVS_UNUSED,
                               pi_assign_extra_t *extra OVS_UNUSED) {
@@ -807,7 +1018,7 @@ pi_status_t _pi_update_device_start(pi_dev_id_t dev_id,
     return PI_STATUS_SUCCESS;
 }
 
-pi_status_t _pi_table_entry_add(pi_session_handle_t session_handle OVS_UNUSED,
+pi_status_t _pi_table_entry_add(pi_session_handle_t session_handle,
                                 pi_dev_tgt_t dev_tgt, pi_p4_id_t table_id,
                                 const pi_match_key_t *match_key,
                                 const pi_table_entry_t *table_entry,
@@ -815,6 +1026,7 @@ pi_status_t _pi_table_entry_add(pi_session_handle_t session_handle OVS_UNUSED,
                                 pi_entry_handle_t *entry_handle OVS_UNUSED) {
     int error;
     struct p4rtutil_table_entry entry;
+    struct p4rt_batch *batch;
 
     struct p4rt *p4rt = p4rt_lookup_by_dev_id(dev_tgt.dev_id);
     if (!p4rt) {
@@ -822,8 +1034,43 @@ pi_status_t _pi_table_entry_add(pi_session_handle_t session_handle OVS_UNUSED,
         return PI_STATUS_DEV_OUT_OF_RANGE;
     }
 
+    ovs_mutex_lock(&batch_mutex);
+    batch = p4rt_batch_find(session_handle);
+    if (batch) {
+        pi_status_t status = PI_STATUS_SUCCESS;
+        struct p4rtutil_table_entry *copy;
+
+        if (batch->n_entries && batch->dev_id != dev_tgt.dev_id) {
+            /* Entries queued for another device; flush to keep order. */
+            status = p4rt_batch_flush(batch);
+        }
+        batch->dev_id = dev_tgt.dev_id;
+
+        copy = xzalloc(sizeof *copy);
+        copy->table_id = table_id;
+        copy->action_id = table_entry->entry.action_data->action_id;
+        copy->priority = match_key->priority;
+        copy->is_default = false;
+        copy->match_key = xmemdup(match_key->data, match_key->data_size);
+        copy->key_size = match_key->data_size;
+        copy->action_data = xmemdup(table_entry->entry.action_data->data,
+                                    table_entry->entry.action_data->data_size);
+        copy->data_size = table_entry->entry.action_data->data_size;
+        ovs_list_push_back(&batch->entries, &copy->list_node);
+
+        if (++batch->n_entries >= P4RT_BATCH_FLUSH_THRESHOLD
+            && status == PI_STATUS_SUCCESS) {
+            status = p4rt_batch_flush(batch);
+        }
+        ovs_mutex_unlock(&batch_mutex);
+        return status;
+    }
+    ovs_mutex_unlock(&batch_mutex);
+
     entry.table_id = table_id;
     entry.action_id = table_entry->entry.action_data->action_id;
+    entry.priority = match_key->priority;
+    entry.is_default = false;
     entry.match_key = match_key->data;
     entry.key_size = match_key->data_size;
     entry.action_data = table_entry->entry.action_data->data;
@@ -839,13 +1086,15 @@ pi_status_t _pi_table_entry_add(pi_session_handle_t session_handle OVS_UNUSED,
     return PI_STATUS_SUCCESS;
 }
 
-pi_status_t _pi_table_default_action_set(pi_session_handle_t session_handle OVS_UNUSED,
+pi_status_t _pi_table_default_action_set(pi_session_handle_t session_handle,
                                          pi_dev_tgt_t dev_tgt,
                                          pi_p4_id_t table_id,
                                          const pi_table_entry_t *table_entry) {
     int error;
     struct p4rtutil_table_entry entry;
 
+    p4rt_batch_barrier(session_handle);
+
     struct p4rt *p4rt = p4rt_lookup_by_dev_id(dev_tgt.dev_id);
     if (!p4rt) {
         /* P4 Device does not exist. */
@@ -973,11 +1222,13 @@ emit_pi_table_entries(struct p4rt *p, pi_p4_id_t table_id, struct ovs_list *entr
     return b;
 }
 
-pi_status_t _pi_table_entries_fetch(pi_session_handle_t session_handle OVS_UNUSED,
+pi_status_t _pi_table_entries_fetch(pi_session_handle_t session_handle,
                                     pi_dev_tgt_t dev_tgt, pi_p4_id_t table_id,
                                     pi_table_fetch_res_t *res) {
     int error;
 
+    p4rt_batch_barrier(session_handle);
+
     struct p4rt *p4rt = p4rt_lookup_by_dev_id(dev_tgt.dev_id);
     if (!p4rt) {
         /* P4 Device does not exist. */
@@ -1016,6 +1267,82 @@ pi_status_t _pi_table_entries_fetch_done(pi_session_handle_t session_handle OVS_
     return PI_STATUS_SUCCESS;
 }
 
+/* ## ----------------------------- ## */
+/* ## P4Runtime counter functions.  ## */
+/* ## ----------------------------- ## */
+
+/* Snapshot of the counter array most recently polled.  PI reads
+ * counters one index at a time; without this every index would cost a
+ * full descent into the datapath, serializing a 100k-counter poll on
+ * the map each time.  Instead the first index of a poll cycle (index 0,
+ * a change of counter, or an explicit HW_SYNC) snapshots the whole
+ * array in one O(n) pass and the remaining indices are served from the
+ * snapshot. */
+static struct ovs_mutex counter_snap_mutex = OVS_MUTEX_INITIALIZER;
+static struct {
+    uint64_t dev_id;
+    uint32_t counter_id;
+    uint64_t *values;
+    size_t n_values;
+} counter_snap OVS_GUARDED_BY(counter_snap_mutex);
+
+pi_status_t _pi_counter_read(pi_session_handle_t session_handle OVS_UNUSED,
+                             pi_dev_tgt_t dev_tgt, pi_p4_id_t counter_id,
+                             size_t index, int flags,
+                             pi_counter_data_t *counter_data) {
+    pi_status_t status = PI_STATUS_SUCCESS;
+
+    struct p4rt *p4rt = p4rt_lookup_by_dev_id(dev_tgt.dev_id);
+    if (!p4rt) {
+        /* P4 Device does not exist. */
+        return PI_STATUS_DEV_OUT_OF_RANGE;
+    }
+    if (!p4rt->p4rt_class->counter_read_all) {
+        return PI_STATUS_TARGET_ERROR;
+    }
+
+    ovs_mutex_lock(&counter_snap_mutex);
+    if (!counter_snap.values
+        || counter_snap.dev_id != dev_tgt.dev_id
+        || counter_snap.counter_id != counter_id
+        || index == 0
+        || flags & PI_COUNTER_FLAGS_HW_SYNC) {
+        uint64_t *values;
+        size_t n_values;
+        int error;
+
+        error = p4rt->p4rt_class->counter_read_all(p4rt, counter_id,
+                                                   &values, &n_values);
+        if (error) {
+            VLOG_WARN_RL(&rl, "failed to snapshot counter %"PRIu32" of "
+                         "device %"PRIu64" (%s)", counter_id, dev_tgt.dev_id,
+                         ovs_strerror(error));
+            status = PI_STATUS_TARGET_ERROR;
+            goto unlock;
+        }
+        free(counter_snap.values);
+        counter_snap.dev_id = dev_tgt.dev_id;
+        counter_snap.counter_id = counter_id;
+        counter_snap.values = values;
+        counter_snap.n_values = n_values;
+    }
+
+    if (index >= counter_snap.n_values) {
+        status = PI_STATUS_TARGET_ERROR;
+        goto unlock;
+    }
+
+    /* The target stores a single integer per counter index; the
+     * P4Runtime layer reports whichever unit the P4 program declared. */
+    counter_data->valid = PI_COUNTER_UNIT_PACKETS | PI_COUNTER_UNIT_BYTES;
+    counter_data->packets = counter_snap.values[index];
+    counter_data->bytes = counter_snap.values[index];
+
+unlock:
+    ovs_mutex_unlock(&counter_snap_mutex);
+    return status;
+}
+
 pi_status_t _pi_table_entry_delete(pi_session_handle_t session_handle OVS_UNUSED,
                                    pi_dev_id_t dev_id OVS_UNUSED, pi_p4_id_t table_id OVS_UNUSED,
                                    pi_entry_handle_t entry_handle OVS_UNUSED)
@@ -1024,19 +1351,22 @@ pi_status_t _pi_table_entry_delete(pi_session_handle_t session_handle OVS_UNUSED
     return PI_STATUS_NOT_IMPLEMENTED_BY_TARGET;
 }
 
-pi_status_t _pi_table_entry_delete_wkey(pi_session_handle_t session_handle OVS_UNUSED,
+pi_status_t _pi_table_entry_delete_wkey(pi_session_handle_t session_handle,
                                         pi_dev_tgt_t dev_tgt,
                                         pi_p4_id_t table_id,
                                         const pi_match_key_t *match_key) {
     int error;
 
+    p4rt_batch_barrier(session_handle);
+
     struct p4rt *p4rt = p4rt_lookup_by_dev_id(dev_tgt.dev_id);
     if (!p4rt) {
         /* P4 Device does not exist. */
         return PI_STATUS_DEV_OUT_OF_RANGE;
     }
 
-    error = p4rt->p4rt_class->entry_del(p4rt, table_id, match_key->data, match_key->data_size);
+    error = p4rt->p4rt_class->entry_del(p4rt, table_id, match_key->priority,
+                                        match_key->data, match_key->data_size);
     if (error) {
         VLOG_ERR("%s: failed to delete table entry from table with ID %u", p4rt->name, table_id);
         return PI_STATUS_TARGET_ERROR;
@@ -1045,6 +1375,191 @@ pi_status_t _pi_table_entry_delete_wkey(pi_session_handle_t session_handle OVS_U
     return PI_STATUS_SUCCESS;
 }
 
+/* ## --------------------------------- ## */
+/* ## P4 Action Profile implementation. ## */
+/* ## --------------------------------- ## */
+
+/* Group handles share the pi_indirect_handle_t space with member handles,
+ * so they carry a marker bit above the 32 bits the datapath allocates. */
+#define P4RT_GRP_HANDLE_MARKER (UINT64_C(1) << 32)
+
+pi_status_t _pi_act_prof_mbr_create(pi_session_handle_t session_handle OVS_UNUSED,
+                                    pi_dev_tgt_t dev_tgt,
+                                    pi_p4_id_t act_prof_id,
+                                    const pi_action_data_t *action_data,
+                                    pi_indirect_handle_t *mbr_handle) {
+    uint32_t handle;
+    int error;
+
+    struct p4rt *p4rt = p4rt_lookup_by_dev_id(dev_tgt.dev_id);
+    if (!p4rt) {
+        /* P4 Device does not exist. */
+        return PI_STATUS_DEV_OUT_OF_RANGE;
+    }
+    if (!p4rt->p4rt_class->act_prof_member_create) {
+        return PI_STATUS_NOT_IMPLEMENTED_BY_TARGET;
+    }
+
+    error = p4rt->p4rt_class->act_prof_member_create(p4rt, act_prof_id,
+                                                     action_data->action_id,
+                                                     action_data->data,
+                                                     action_data->data_size,
+                                                     &handle);
+    if (error) {
+        VLOG_WARN_RL(&rl, "failed to create action profile member on device "
+                     "%lu (%s)", dev_tgt.dev_id, ovs_strerror(error));
+        return PI_STATUS_TARGET_ERROR;
+    }
+
+    *mbr_handle = handle;
+    return PI_STATUS_SUCCESS;
+}
+
+pi_status_t _pi_act_prof_mbr_modify(pi_session_handle_t session_handle OVS_UNUSED,
+                                    pi_dev_id_t dev_id, pi_p4_id_t act_prof_id,
+                                    pi_indirect_handle_t mbr_handle,
+                                    const pi_action_data_t *action_data) {
+    int error;
+
+    struct p4rt *p4rt = p4rt_lookup_by_dev_id(dev_id);
+    if (!p4rt) {
+        /* P4 Device does not exist. */
+        return PI_STATUS_DEV_OUT_OF_RANGE;
+    }
+    if (!p4rt->p4rt_class->act_prof_member_modify) {
+        return PI_STATUS_NOT_IMPLEMENTED_BY_TARGET;
+    }
+
+    error = p4rt->p4rt_class->act_prof_member_modify(p4rt, act_prof_id,
+                                                     mbr_handle,
+                                                     action_data->action_id,
+                                                     action_data->data,
+                                                     action_data->data_size);
+    if (error) {
+        VLOG_WARN_RL(&rl, "failed to modify action profile member on device "
+                     "%lu (%s)", dev_id, ovs_strerror(error));
+        return PI_STATUS_TARGET_ERROR;
+    }
+
+    return PI_STATUS_SUCCESS;
+}
+
+pi_status_t _pi_act_prof_mbr_delete(pi_session_handle_t session_handle OVS_UNUSED,
+                                    pi_dev_id_t dev_id, pi_p4_id_t act_prof_id,
+                                    pi_indirect_handle_t mbr_handle) {
+    int error;
+
+    struct p4rt *p4rt = p4rt_lookup_by_dev_id(dev_id);
+    if (!p4rt) {
+        /* P4 Device does not exist. */
+        return PI_STATUS_DEV_OUT_OF_RANGE;
+    }
+    if (!p4rt->p4rt_class->act_prof_member_del) {
+        return PI_STATUS_NOT_IMPLEMENTED_BY_TARGET;
+    }
+
+    error = p4rt->p4rt_class->act_prof_member_del(p4rt, act_prof_id,
+                                                  mbr_handle);
+    if (error) {
+        VLOG_WARN_RL(&rl, "failed to delete action profile member on device "
+                     "%lu (%s)", dev_id, ovs_strerror(error));
+        return PI_STATUS_TARGET_ERROR;
+    }
+
+    return PI_STATUS_SUCCESS;
+}
+
+pi_status_t _pi_act_prof_grp_create(pi_session_handle_t session_handle OVS_UNUSED,
+                                    pi_dev_tgt_t dev_tgt,
+                                    pi_p4_id_t act_prof_id,
+                                    size_t max_size OVS_UNUSED,
+                                    pi_indirect_handle_t *grp_handle) {
+    uint32_t handle;
+    int error;
+
+    struct p4rt *p4rt = p4rt_lookup_by_dev_id(dev_tgt.dev_id);
+    if (!p4rt) {
+        /* P4 Device does not exist. */
+        return PI_STATUS_DEV_OUT_OF_RANGE;
+    }
+    if (!p4rt->p4rt_class->act_prof_group_create) {
+        return PI_STATUS_NOT_IMPLEMENTED_BY_TARGET;
+    }
+
+    error = p4rt->p4rt_class->act_prof_group_create(p4rt, act_prof_id,
+                                                    &handle);
+    if (error) {
+        VLOG_WARN_RL(&rl, "failed to create action profile group on device "
+                     "%lu (%s)", dev_tgt.dev_id, ovs_strerror(error));
+        return PI_STATUS_TARGET_ERROR;
+    }
+
+    *grp_handle = handle | P4RT_GRP_HANDLE_MARKER;
+    return PI_STATUS_SUCCESS;
+}
+
+pi_status_t _pi_act_prof_grp_delete(pi_session_handle_t session_handle OVS_UNUSED,
+                                    pi_dev_id_t dev_id, pi_p4_id_t act_prof_id,
+                                    pi_indirect_handle_t grp_handle) {
+    int error;
+
+    struct p4rt *p4rt = p4rt_lookup_by_dev_id(dev_id);
+    if (!p4rt) {
+        /* P4 Device does not exist. */
+        return PI_STATUS_DEV_OUT_OF_RANGE;
+    }
+    if (!p4rt->p4rt_class->act_prof_group_del) {
+        return PI_STATUS_NOT_IMPLEMENTED_BY_TARGET;
+    }
+
+    error = p4rt->p4rt_class->act_prof_group_del(p4rt, act_prof_id,
+                                                 (uint32_t) grp_handle);
+    if (error) {
+        VLOG_WARN_RL(&rl, "failed to delete action profile group on device "
+                     "%lu (%s)", dev_id, ovs_strerror(error));
+        return PI_STATUS_TARGET_ERROR;
+    }
+
+    return PI_STATUS_SUCCESS;
+}
+
+pi_status_t _pi_act_prof_grp_set_mbrs(
+        pi_session_handle_t session_handle OVS_UNUSED, pi_dev_id_t dev_id,
+        pi_p4_id_t act_prof_id, pi_indirect_handle_t grp_handle, size_t num_mbrs,
+        const pi_indirect_handle_t *mbr_handles, const bool *activate) {
+    uint32_t *mbrs;
+    size_t n_mbrs = 0;
+    int error;
+
+    struct p4rt *p4rt = p4rt_lookup_by_dev_id(dev_id);
+    if (!p4rt) {
+        /* P4 Device does not exist. */
+        return PI_STATUS_DEV_OUT_OF_RANGE;
+    }
+    if (!p4rt->p4rt_class->act_prof_group_set) {
+        return PI_STATUS_NOT_IMPLEMENTED_BY_TARGET;
+    }
+
+    mbrs = xmalloc(num_mbrs * sizeof *mbrs);
+    for (size_t i = 0; i < num_mbrs; i++) {
+        if (!activate || activate[i]) {
+            mbrs[n_mbrs++] = mbr_handles[i];
+        }
+    }
+
+    error = p4rt->p4rt_class->act_prof_group_set(p4rt, act_prof_id,
+                                                 (uint32_t) grp_handle,
+                                                 mbrs, n_mbrs);
+    free(mbrs);
+    if (error) {
+        VLOG_WARN_RL(&rl, "failed to set action profile group members on "
+                     "device %lu (%s)", dev_id, ovs_strerror(error));
+        return PI_STATUS_TARGET_ERROR;
+    }
+
+    return PI_STATUS_SUCCESS;
+}
+
 /* ## ------------------------------- ## */
 /* ## Functions exposed to ovs-p4ctl. ## */
 /* ## ------------------------------- ## */
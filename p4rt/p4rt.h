@@ -44,6 +44,7 @@ int p4rt_port_add(struct p4rt *p, struct netdev *netdev, ofp_port_t *ofp_portp);
 int p4rt_port_del(struct p4rt *p, const char *name);
 void p4rt_get_ports(struct p4rt *p, struct sset *p4rt_ports);
 int p4rt_prog_del(struct p4rt *p);
+int p4rt_entry_add_batch(struct p4rt *p, struct ovs_list *entries);
 
 /* unixctl commands */
 int p4rt_query_switch_features(const char *name, struct p4rt_switch_features *features);
@@ -358,6 +358,23 @@ check-dpdk: all
 	set $(SHELL) '$(SYSTEM_DPDK_TESTSUITE)' -C tests  AUTOTEST_PATH='$(AUTOTEST_PATH)'; \
 	"$$@" $(TESTSUITEFLAGS) -j1 || (test X'$(RECHECK)' = Xyes && "$$@" --recheck)
 
+# uBPF map and VM microbenchmarks.  Pass UBPF_BENCH_ARGS to override the
+# default entry and operation counts, e.g. UBPF_BENCH_ARGS='8192 1000000'.
+benchmark-ubpf: tests/ovstest$(EXEEXT)
+	$(AM_V_at)tests/ovstest$(EXEEXT) test-ubpf benchmark $(UBPF_BENCH_ARGS)
+
+# uBPF pipeline packet-rate benchmark: parameterized packet mixes through
+# the PMD's batch entry point, reported as Mpps and cycles per packet.
+check-ubpf-perf: tests/ovstest$(EXEEXT)
+	$(AM_V_at)tests/ovstest$(EXEEXT) test-ubpf benchmark-pipeline $(UBPF_BENCH_ARGS)
+
+# Pinned-CPU performance regression benchmarks for the core data structures
+# (cmap, classifier, miniflow, pvector), with machine-readable PERF output
+# lines for comparing builds.  Pass PERF_CHECK_ARGS to override the
+# defaults: '<n_elems> <n_threads> <n_ops> <first_core>'.
+perf-check: tests/ovstest$(EXEEXT)
+	$(AM_V_at)tests/ovstest$(EXEEXT) test-perf suite $(PERF_CHECK_ARGS)
+
 clean-local:
 	test ! -f '$(TESTSUITE)' || $(SHELL) '$(TESTSUITE)' -C tests --clean
 
@@ -479,7 +496,9 @@ tests_ovstest_SOURCES = \
 	tests/test-bitmap.c \
 	tests/test-vconn.c \
 	tests/test-aa.c \
-	tests/test-stopwatch.c
+	tests/test-stopwatch.c \
+	tests/test-perf.c \
+	tests/test-ubpf.c
 
 if !WIN32
 tests_ovstest_SOURCES += \
@@ -995,7 +995,7 @@ do_evaluate_condition__(struct ovs_cmdl_context *ctx, int mode)
             } else {
                 result = ovsdb_condition_match_any_clause(rows[j]->fields,
                                                           &conditions[i],
-                                                          NULL);
+                                                          NULL, NULL);
             }
             if (j % 5 == 0) {
                 putchar(' ');
@@ -0,0 +1,552 @@
+/*
+ * Copyright (c) 2020 Open vSwitch contributors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Performance regression benchmarks for the core datapath data structures,
+ * run by "make perf-check".  Unlike the timing printfs in test-cmap and
+ * test-classifier these pin each thread to a CPU, run an untimed warm-up
+ * pass before measuring, and emit one machine-readable line per result:
+ *
+ *   PERF name=<benchmark> threads=<n> ops=<total> ns=<elapsed> mops=<rate>
+ *
+ * so that rates from two builds can be diffed mechanically. */
+
+#include <config.h>
+#undef NDEBUG
+#include <getopt.h>
+#include <pthread.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#include <stdio.h>
+#include <string.h>
+
+#include "classifier.h"
+#include "cmap.h"
+#include "dp-packet.h"
+#include "fatal-signal.h"
+#include "flow.h"
+#include "hash.h"
+#include "openvswitch/match.h"
+#include "ovs-atomic.h"
+#include "ovs-thread.h"
+#include "ovstest.h"
+#include "packets.h"
+#include "pvector.h"
+#include "random.h"
+#include "util.h"
+
+static int n_elems = 1 << 16;   /* Elements/rules per structure. */
+static int n_threads = 4;       /* Reader threads per benchmark. */
+static int n_ops = 1 << 20;     /* Timed operations per reader thread. */
+static int first_core = 0;      /* First CPU to pin to, or -1 for no pin. */
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+/* Pins the calling thread to one CPU so that results do not depend on the
+ * scheduler.  Thread 'idx' of a benchmark gets core 'first_core' + 'idx'. */
+static void
+pin_thread(int idx)
+{
+#ifdef __linux__
+    if (first_core >= 0) {
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        CPU_SET(first_core + idx, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof set, &set)) {
+            static struct ovsthread_once once = OVSTHREAD_ONCE_INITIALIZER;
+
+            if (ovsthread_once_start(&once)) {
+                printf("# warning: could not pin thread to core %d\n",
+                       first_core + idx);
+                ovsthread_once_done(&once);
+            }
+        }
+    }
+#else
+    (void) idx;
+#endif
+}
+
+static void
+report(const char *name, int threads, uint64_t ops, uint64_t ns)
+{
+    printf("PERF name=%s threads=%d ops=%"PRIu64" ns=%"PRIu64" mops=%.3f\n",
+           name, threads, ops, ns, ns ? ops * 1000.0 / ns : 0.0);
+}
+
+/* cmap reader-writer mix.
+ *
+ * 'n_threads' readers each perform 'n_ops' lookups of pseudo-random keys
+ * while one writer continuously removes and re-inserts elements under a
+ * mutex, as the datapath classifier thread does.  Reader and writer rates
+ * are reported separately. */
+
+struct element {
+    struct cmap_node node;
+    int value;
+};
+
+struct cmap_aux {
+    struct ovs_mutex mutex;
+    struct cmap *cmap;
+    struct element *elements;
+    atomic_bool done;           /* Set when the readers have finished. */
+    ATOMIC(uint64_t) mutations;
+    int idx;
+};
+
+static struct element *
+cmap_find_value(const struct cmap *cmap, int value)
+{
+    struct element *e;
+
+    CMAP_FOR_EACH_WITH_HASH (e, node, hash_int(value, 0), cmap) {
+        if (e->value == value) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void *
+cmap_reader(void *aux_)
+{
+    struct cmap_aux *aux = aux_;
+    int idx = ++aux->idx;
+    int i;
+
+    pin_thread(idx);
+    for (i = 0; i < n_ops; i++) {
+        ignore(cmap_find_value(aux->cmap, hash_int(i, idx) % n_elems));
+    }
+    return NULL;
+}
+
+static void *
+cmap_writer(void *aux_)
+{
+    struct cmap_aux *aux = aux_;
+    uint64_t mutations = 0;
+    bool done;
+    int i = 0;
+
+    pin_thread(0);
+    for (;;) {
+        struct element *e = &aux->elements[i];
+
+        atomic_read_relaxed(&aux->done, &done);
+        if (done) {
+            break;
+        }
+        ovs_mutex_lock(&aux->mutex);
+        cmap_remove(aux->cmap, &e->node, hash_int(e->value, 0));
+        cmap_insert(aux->cmap, &e->node, hash_int(e->value, 0));
+        ovs_mutex_unlock(&aux->mutex);
+        mutations++;
+        i = (i + 1) % n_elems;
+    }
+    atomic_store_relaxed(&aux->mutations, mutations);
+    return NULL;
+}
+
+static void
+benchmark_cmap_mix(void)
+{
+    struct element *elements = xmalloc(n_elems * sizeof *elements);
+    pthread_t *threads = xmalloc(n_threads * sizeof *threads);
+    struct cmap cmap;
+    struct cmap_aux aux;
+    pthread_t writer;
+    uint64_t start, ns, mutations;
+    int i;
+
+    cmap_init(&cmap);
+    for (i = 0; i < n_elems; i++) {
+        elements[i].value = i;
+        cmap_insert(&cmap, &elements[i].node, hash_int(i, 0));
+    }
+
+    /* Warm up the table. */
+    for (i = 0; i < n_elems; i++) {
+        ignore(cmap_find_value(&cmap, i));
+    }
+
+    aux.cmap = &cmap;
+    aux.elements = elements;
+    aux.idx = 0;
+    ovs_mutex_init(&aux.mutex);
+    atomic_init(&aux.done, false);
+    atomic_init(&aux.mutations, 0);
+
+    start = now_ns();
+    writer = ovs_thread_create("cmap-writer", cmap_writer, &aux);
+    for (i = 0; i < n_threads; i++) {
+        threads[i] = ovs_thread_create("cmap-reader", cmap_reader, &aux);
+    }
+    for (i = 0; i < n_threads; i++) {
+        xpthread_join(threads[i], NULL);
+    }
+    ns = now_ns() - start;
+    atomic_store(&aux.done, true);
+    xpthread_join(writer, NULL);
+
+    report("cmap_lookup", n_threads, (uint64_t) n_threads * n_ops, ns);
+    atomic_read(&aux.mutations, &mutations);
+    report("cmap_mutate", 1, mutations, ns);
+
+    cmap_destroy(&cmap);
+    ovsrcu_quiesce();
+    free(threads);
+    free(aux.elements);
+}
+
+/* Classifier lookups.
+ *
+ * Installs 'n_elems' IPv4 rules spread over two subtables (nw_src only and
+ * nw_src + nw_dst) and four priorities, then measures concurrent lookups
+ * with wildcard tracking, as the upcall path performs them. */
+
+struct perf_cls_rule {
+    struct cls_rule cls_rule;
+};
+
+struct cls_aux {
+    struct classifier *cls;
+    int idx;
+};
+
+static void
+perf_cls_flow(struct flow *flow, uint32_t key)
+{
+    memset(flow, 0, sizeof *flow);
+    flow->dl_type = htons(ETH_TYPE_IP);
+    flow->nw_src = htonl(0x0a000000 | key);
+    flow->nw_dst = htonl(0xc0a80000 | (key & 0xffff));
+}
+
+static void *
+cls_reader(void *aux_)
+{
+    struct cls_aux *aux = aux_;
+    int idx = ++aux->idx;
+    int i;
+
+    pin_thread(idx - 1);
+    for (i = 0; i < n_ops; i++) {
+        struct flow_wildcards wc;
+        struct flow flow;
+
+        perf_cls_flow(&flow, hash_int(i, idx) % n_elems);
+        flow_wildcards_init_catchall(&wc);
+        ignore(classifier_lookup(aux->cls, OVS_VERSION_MIN, &flow, &wc));
+    }
+    return NULL;
+}
+
+static void
+free_perf_cls_rule(struct perf_cls_rule *rule)
+{
+    cls_rule_destroy(&rule->cls_rule);
+    free(rule);
+}
+
+static void
+benchmark_classifier(void)
+{
+    pthread_t *threads = xmalloc(n_threads * sizeof *threads);
+    struct classifier cls;
+    struct perf_cls_rule *rule;
+    struct cls_aux aux;
+    uint64_t start, ns;
+    int i;
+
+    classifier_init(&cls, flow_segment_u64s);
+
+    for (i = 0; i < n_elems; i++) {
+        struct match match;
+
+        match_init_catchall(&match);
+        match_set_dl_type(&match, htons(ETH_TYPE_IP));
+        match_set_nw_src(&match, htonl(0x0a000000 | i));
+        if (i & 1) {
+            /* Second subtable with a wider mask. */
+            match_set_nw_dst(&match, htonl(0xc0a80000 | (i & 0xffff)));
+        }
+        rule = xmalloc(sizeof *rule);
+        cls_rule_init(&rule->cls_rule, &match, (i % 4) << 8);
+        classifier_insert(&cls, &rule->cls_rule, OVS_VERSION_MIN, NULL, 0);
+    }
+
+    /* Warm up trie and subtable caches. */
+    for (i = 0; i < n_elems; i++) {
+        struct flow flow;
+
+        perf_cls_flow(&flow, i);
+        ignore(classifier_lookup(&cls, OVS_VERSION_MIN, &flow, NULL));
+    }
+
+    aux.cls = &cls;
+    aux.idx = 0;
+    start = now_ns();
+    for (i = 0; i < n_threads; i++) {
+        threads[i] = ovs_thread_create("cls-reader", cls_reader, &aux);
+    }
+    for (i = 0; i < n_threads; i++) {
+        xpthread_join(threads[i], NULL);
+    }
+    ns = now_ns() - start;
+    report("classifier_lookup", n_threads, (uint64_t) n_threads * n_ops, ns);
+
+    classifier_defer(&cls);
+    CLS_FOR_EACH (rule, cls_rule, &cls) {
+        classifier_remove_assert(&cls, &rule->cls_rule);
+        ovsrcu_postpone(free_perf_cls_rule, rule);
+    }
+    classifier_destroy(&cls);
+    ovsrcu_quiesce();
+    free(threads);
+}
+
+/* miniflow_extract() over a warm Ethernet/IPv4/UDP packet, the per-packet
+ * fixed cost of the userspace datapath.  Single threaded: the extract code
+ * has no shared state worth contending on. */
+
+static void
+benchmark_miniflow(void)
+{
+    struct dp_packet packet;
+    struct eth_header *eth;
+    struct ip_header *ip;
+    struct udp_header *udp;
+    uint64_t start, ns;
+    uint32_t hash = 0;
+    int i;
+
+    dp_packet_init(&packet, 128);
+    eth = dp_packet_put_zeros(&packet, sizeof *eth);
+    eth->eth_type = htons(ETH_TYPE_IP);
+    ip = dp_packet_put_zeros(&packet, sizeof *ip);
+    ip->ip_ihl_ver = IP_IHL_VER(5, 4);
+    ip->ip_tot_len = htons(sizeof *ip + sizeof *udp);
+    ip->ip_ttl = 64;
+    ip->ip_proto = IPPROTO_UDP;
+    put_16aligned_be32(&ip->ip_src, htonl(0x0a000001));
+    put_16aligned_be32(&ip->ip_dst, htonl(0x0a000002));
+    udp = dp_packet_put_zeros(&packet, sizeof *udp);
+    udp->udp_src = htons(1234);
+    udp->udp_dst = htons(4789);
+    udp->udp_len = htons(sizeof *udp);
+
+    pin_thread(0);
+
+    /* Warm up. */
+    for (i = 0; i < 1000; i++) {
+        struct {
+            struct miniflow mf;
+            uint64_t buf[FLOW_U64S];
+        } m;
+
+        miniflow_extract(&packet, &m.mf);
+    }
+
+    start = now_ns();
+    for (i = 0; i < n_ops; i++) {
+        struct {
+            struct miniflow mf;
+            uint64_t buf[FLOW_U64S];
+        } m;
+
+        miniflow_extract(&packet, &m.mf);
+        hash ^= miniflow_hash_5tuple(&m.mf, hash);
+    }
+    ns = now_ns() - start;
+    ignore(hash);
+    report("miniflow_extract", 1, n_ops, ns);
+
+    dp_packet_uninit(&packet);
+}
+
+/* pvector reader-writer mix.
+ *
+ * Readers iterate the priority vector from highest to lowest priority, as
+ * the datapath iterates subtables, while a writer republishes it with one
+ * entry's priority changed.  Each full iteration counts as one op. */
+
+struct pvec_entry {
+    int value;
+};
+
+struct pvec_aux {
+    struct ovs_mutex mutex;
+    struct pvector *pvec;
+    struct pvec_entry *entries;
+    atomic_bool done;
+    ATOMIC(uint64_t) republishes;
+    int idx;
+};
+
+static void *
+pvector_reader(void *aux_)
+{
+    struct pvec_aux *aux = aux_;
+    uint64_t sum = 0;
+    int i;
+
+    pin_thread(++aux->idx);
+    for (i = 0; i < n_ops; i++) {
+        struct pvec_entry *e;
+
+        PVECTOR_FOR_EACH (e, aux->pvec) {
+            sum += e->value;
+        }
+    }
+    ignore(sum);
+    return NULL;
+}
+
+static void *
+pvector_writer(void *aux_)
+{
+    struct pvec_aux *aux = aux_;
+    uint64_t republishes = 0;
+    bool done;
+    int i = 0;
+    int n = MIN(n_elems, 64);
+
+    pin_thread(0);
+    for (;;) {
+        struct pvec_entry *e = &aux->entries[i];
+
+        atomic_read_relaxed(&aux->done, &done);
+        if (done) {
+            break;
+        }
+        ovs_mutex_lock(&aux->mutex);
+        pvector_remove(aux->pvec, e);
+        pvector_insert(aux->pvec, e, random_range(n * 4));
+        pvector_publish(aux->pvec);
+        ovs_mutex_unlock(&aux->mutex);
+        republishes++;
+        i = (i + 1) % n;
+    }
+    atomic_store_relaxed(&aux->republishes, republishes);
+    return NULL;
+}
+
+static void
+benchmark_pvector_mix(void)
+{
+    pthread_t *threads = xmalloc(n_threads * sizeof *threads);
+    int n = MIN(n_elems, 64);   /* Typical subtable vector size. */
+    struct pvec_entry *entries = xmalloc(n * sizeof *entries);
+    struct pvector pvec;
+    struct pvec_aux aux;
+    pthread_t writer;
+    uint64_t start, ns, republishes;
+    int i;
+
+    pvector_init(&pvec);
+    for (i = 0; i < n; i++) {
+        entries[i].value = i;
+        pvector_insert(&pvec, &entries[i], i);
+    }
+    pvector_publish(&pvec);
+
+    aux.pvec = &pvec;
+    aux.entries = entries;
+    aux.idx = 0;
+    ovs_mutex_init(&aux.mutex);
+    atomic_init(&aux.done, false);
+    atomic_init(&aux.republishes, 0);
+
+    start = now_ns();
+    writer = ovs_thread_create("pvec-writer", pvector_writer, &aux);
+    for (i = 0; i < n_threads; i++) {
+        threads[i] = ovs_thread_create("pvec-reader", pvector_reader, &aux);
+    }
+    for (i = 0; i < n_threads; i++) {
+        xpthread_join(threads[i], NULL);
+    }
+    ns = now_ns() - start;
+    atomic_store(&aux.done, true);
+    xpthread_join(writer, NULL);
+
+    report("pvector_iterate", n_threads, (uint64_t) n_threads * n_ops, ns);
+    atomic_read(&aux.republishes, &republishes);
+    report("pvector_republish", 1, republishes, ns);
+
+    pvector_destroy(&pvec);
+    ovsrcu_quiesce();
+    free(threads);
+    free(entries);
+}
+
+static void
+run_perf_suite(struct ovs_cmdl_context *ctx)
+{
+    fatal_signal_init();
+    random_set_seed(0xb02ab02a);
+
+    if (ctx->argc > 1) {
+        n_elems = strtol(ctx->argv[1], NULL, 10);
+    }
+    if (ctx->argc > 2) {
+        n_threads = strtol(ctx->argv[2], NULL, 10);
+    }
+    if (ctx->argc > 3) {
+        n_ops = strtol(ctx->argv[3], NULL, 10);
+    }
+    if (ctx->argc > 4) {
+        first_core = strtol(ctx->argv[4], NULL, 10);
+    }
+
+    printf("# perf-check: n_elems=%d n_threads=%d n_ops=%d first_core=%d\n",
+           n_elems, n_threads, n_ops, first_core);
+
+    benchmark_cmap_mix();
+    benchmark_classifier();
+    benchmark_miniflow();
+    benchmark_pvector_mix();
+}
+
+static const struct ovs_cmdl_command commands[] = {
+    /* Benchmark suite: [n_elems [n_threads [n_ops [first_core]]]].
+     * A negative 'first_core' disables CPU pinning. */
+    {"suite", NULL, 0, 4, run_perf_suite, OVS_RO},
+    {NULL, NULL, 0, 0, NULL, OVS_RO},
+};
+
+static void
+test_perf_main(int argc, char *argv[])
+{
+    struct ovs_cmdl_context ctx = {
+        .argc = argc - optind,
+        .argv = argv + optind,
+    };
+
+    set_program_name(argv[0]);
+    ovs_cmdl_run_command(&ctx, commands);
+}
+
+OVSTEST_REGISTER("test-perf", test_perf_main);
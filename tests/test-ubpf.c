@@ -0,0 +1,780 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Microbenchmarks for the uBPF datapath primitives: one throughput
+ * benchmark per "struct ubpf_map_ops" implementation, plus interpreter
+ * versus JIT execution of a synthetic straight-line program.  Run as:
+ *
+ *     make benchmark-ubpf
+ * or: tests/ovstest test-ubpf benchmark [n-entries [n-ops]]
+ */
+
+#include <config.h>
+#undef NDEBUG
+#include <assert.h>
+#include <getopt.h>
+#include <string.h>
+#include <time.h>
+#include "bpf.h"
+#include "bpf/ebpf.h"
+#include "bpf/ubpf_act_prof.h"
+#include "bpf/ubpf_array.h"
+#include "bpf/ubpf_bf.h"
+#include "bpf/ubpf_countmin.h"
+#include "bpf/ubpf_hashmap.h"
+#include "bpf/ubpf_lpm_dir24.h"
+#include "bpf/ubpf_lpm_trie.h"
+#include "bpf/ubpf_meter.h"
+#include "bpf/ubpf_percpu.h"
+#include "bpf/ubpf_ternary.h"
+#include "command-line.h"
+#include "ovstest.h"
+#include "util.h"
+
+static unsigned int n_entries;  /* Number of entries to install per map. */
+static unsigned int n_ops;      /* Number of timed data-plane operations. */
+
+/* Returns the CPU timestamp counter on x86-64, a monotonic nanosecond
+ * clock elsewhere.  Only differences within one run are meaningful. */
+#if defined(__x86_64__) || defined(_M_X64)
+#define TICK_UNIT "cycles"
+static uint64_t
+ticks(void)
+{
+    uint32_t l, h;
+
+    asm volatile("rdtsc" : "=a" (l), "=d" (h));
+    return ((uint64_t) h << 32) | l;
+}
+#else
+#define TICK_UNIT "ns"
+static uint64_t
+ticks(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
+#endif
+
+static void
+report(const char *map, const char *op, uint64_t elapsed, unsigned int n)
+{
+    printf("%-16s %-8s %8.1f " TICK_UNIT "/op  (%u ops)\n",
+           map, op, elapsed / (double) n, n);
+}
+
+/* Builds a map around an already created implementation, the way
+ * ubpf_loader.c does when it hits a map symbol. */
+static struct ubpf_map
+wrap_map(const struct ubpf_map_def *def, struct ubpf_map_ops ops,
+         void *data)
+{
+    struct ubpf_map map = {
+        .type = def->type,
+        .key_size = def->key_size,
+        .value_size = def->value_size,
+        .max_entries = def->max_entries,
+        .ops = ops,
+        .data = data,
+    };
+
+    assert(data);
+    return map;
+}
+
+/* Exact-match maps: uint64_t key, uint64_t value.  The key must be 64 bits
+ * wide because the array maps read a full uint64_t index from it.  Installs
+ * 'n' entries, then times update, lookup and (where supported) delete
+ * through the same wrappers the datapath helpers use. */
+static void
+benchmark_exact_map(const char *name, struct ubpf_map *map, unsigned int n)
+{
+    uint64_t start;
+    uint64_t key;
+    unsigned int i;
+
+    start = ticks();
+    for (key = 0; key < n; key++) {
+        uint64_t value = key;
+
+        assert(!ubpf_map_update(map, &key, &value));
+    }
+    report(name, "update", ticks() - start, n);
+
+    key = 0;
+    start = ticks();
+    for (i = 0; i < n_ops; i++) {
+        ignore(ubpf_map_lookup(map, &key));
+        if (++key >= n) {
+            key = 0;
+        }
+    }
+    report(name, "lookup", ticks() - start, n_ops);
+
+    if (map->ops.map_delete) {
+        start = ticks();
+        for (key = 0; key < n; key++) {
+            ubpf_map_delete(map, &key);
+        }
+        report(name, "delete", ticks() - start, n);
+    }
+
+    map->ops.map_destroy(map);
+}
+
+static void
+benchmark_array(void)
+{
+    struct ubpf_map_def def = {
+        .type = UBPF_MAP_TYPE_ARRAY,
+        .key_size = sizeof(uint64_t),
+        .value_size = sizeof(uint64_t),
+        .max_entries = n_entries,
+    };
+    struct ubpf_map map = wrap_map(&def, ubpf_array_ops,
+                                   ubpf_array_create(&def));
+
+    benchmark_exact_map("array", &map, n_entries);
+}
+
+static void
+benchmark_percpu_array(void)
+{
+    struct ubpf_map_def def = {
+        .type = UBPF_MAP_TYPE_PERCPU_ARRAY,
+        .key_size = sizeof(uint64_t),
+        .value_size = sizeof(uint64_t),
+        .max_entries = n_entries,
+    };
+    struct ubpf_map map = wrap_map(&def, ubpf_percpu_array_ops,
+                                   ubpf_percpu_array_create(&def));
+
+    benchmark_exact_map("percpu-array", &map, n_entries);
+}
+
+static void
+benchmark_hashmap(void)
+{
+    struct ubpf_map_def def = {
+        .type = UBPF_MAP_TYPE_HASHMAP,
+        .key_size = sizeof(uint64_t),
+        .value_size = sizeof(uint64_t),
+        .max_entries = n_entries,
+    };
+    struct ubpf_map map = wrap_map(&def, ubpf_hashmap_ops,
+                                   ubpf_hashmap_create(&def));
+
+    benchmark_exact_map("hashmap", &map, n_entries);
+}
+
+static void
+benchmark_percpu_hashmap(void)
+{
+    struct ubpf_map_def def = {
+        .type = UBPF_MAP_TYPE_PERCPU_HASHMAP,
+        .key_size = sizeof(uint64_t),
+        .value_size = sizeof(uint64_t),
+        .max_entries = n_entries,
+    };
+    struct ubpf_map map = wrap_map(&def, ubpf_percpu_hashmap_ops,
+                                   ubpf_percpu_hashmap_create(&def));
+
+    benchmark_exact_map("percpu-hashmap", &map, n_entries);
+}
+
+/* Sketches: add 'n_entries' keys, then time membership lookups. */
+static void
+benchmark_sketch_map(const char *name, struct ubpf_map *map)
+{
+    uint64_t start;
+    uint32_t key;
+    unsigned int i;
+
+    start = ticks();
+    for (key = 0; key < n_entries; key++) {
+        assert(map->ops.map_add(map, &key) >= 0);
+    }
+    report(name, "add", ticks() - start, n_entries);
+
+    key = 0;
+    start = ticks();
+    for (i = 0; i < n_ops; i++) {
+        ignore(ubpf_map_lookup(map, &key));
+        if (++key >= n_entries) {
+            key = 0;
+        }
+    }
+    report(name, "lookup", ticks() - start, n_ops);
+
+    map->ops.map_destroy(map);
+}
+
+/* The sketch ops structs are private to ubpf_loader.c, so mirror them. */
+static const struct ubpf_map_ops bench_bf_ops = {
+    .map_lookup = ubpf_bf_lookup,
+    .map_add = ubpf_bf_add,
+    .map_destroy = ubpf_bf_destroy,
+};
+
+static const struct ubpf_map_ops bench_countmin_ops = {
+    .map_lookup = ubpf_countmin_lookup,
+    .map_add = ubpf_countmin_add,
+    .map_destroy = ubpf_countmin_destroy,
+};
+
+static void
+benchmark_bloomfilter(void)
+{
+    struct ubpf_map_def def = {
+        .type = UBPF_MAP_TYPE_BLOOMFILTER,
+        .key_size = sizeof(uint32_t),
+        .value_size = 0,
+        .max_entries = n_entries,
+        .nb_hash_functions = 3,
+    };
+    struct ubpf_map map = wrap_map(&def, bench_bf_ops, ubpf_bf_create(&def));
+
+    benchmark_sketch_map("bloomfilter", &map);
+}
+
+static void
+benchmark_countmin(void)
+{
+    struct ubpf_map_def def = {
+        .type = UBPF_MAP_TYPE_COUNTMIN,
+        .key_size = sizeof(uint64_t),
+        .value_size = sizeof(uint64_t),
+        .max_entries = n_entries,
+        .nb_hash_functions = 3,
+    };
+    struct ubpf_map map = wrap_map(&def, bench_countmin_ops,
+                                   ubpf_countmin_create(&def));
+
+    benchmark_sketch_map("countmin", &map);
+}
+
+/* IPv4 prefix key matching "struct lpm_trie_key"'s layout. */
+struct lpm_bench_key {
+    uint32_t prefix_len;
+    uint8_t data[4];
+};
+
+static struct lpm_bench_key
+lpm_key(uint32_t addr, uint32_t prefix_len)
+{
+    struct lpm_bench_key key = {
+        .prefix_len = prefix_len,
+        .data = { addr >> 24, addr >> 16, addr >> 8, addr },
+    };
+
+    return key;
+}
+
+/* LPM maps: distinct /24 routes, full-length lookups.  Control-plane
+ * updates and deletes scan the installed rules, so 'n' stays capped to
+ * keep those quadratic phases bounded. */
+static void
+benchmark_lpm_map(const char *name, struct ubpf_map *map, unsigned int n)
+{
+    uint64_t start;
+    unsigned int i;
+
+    start = ticks();
+    for (i = 0; i < n; i++) {
+        struct lpm_bench_key key = lpm_key(i << 8, 24);
+        uint64_t value = i;
+
+        assert(!ubpf_map_update(map, &key, &value));
+    }
+    report(name, "update", ticks() - start, n);
+
+    start = ticks();
+    for (i = 0; i < n_ops; i++) {
+        struct lpm_bench_key key = lpm_key((i % n) << 8 | (i & 0xff), 32);
+
+        ignore(ubpf_map_lookup(map, &key));
+    }
+    report(name, "lookup", ticks() - start, n_ops);
+
+    start = ticks();
+    for (i = 0; i < n; i++) {
+        struct lpm_bench_key key = lpm_key(i << 8, 24);
+
+        ubpf_map_delete(map, &key);
+    }
+    report(name, "delete", ticks() - start, n);
+
+    map->ops.map_destroy(map);
+}
+
+static void
+benchmark_lpm_trie(void)
+{
+    unsigned int n = MIN(n_entries, 8192);
+    struct ubpf_map_def def = {
+        .type = UBPF_MAP_TYPE_LPM_TRIE,
+        .key_size = sizeof(uint64_t),
+        .value_size = sizeof(uint64_t),
+        .max_entries = n,
+    };
+    struct ubpf_map map = wrap_map(&def, ubpf_lpm_trie_ops,
+                                   ubpf_lpm_trie_create(&def));
+
+    benchmark_lpm_map("lpm-trie", &map, n);
+}
+
+static void
+benchmark_lpm_dir24(void)
+{
+    unsigned int n = MIN(n_entries, 8192);
+    struct ubpf_map_def def = {
+        .type = UBPF_MAP_TYPE_LPM_DIR24,
+        .key_size = sizeof(uint64_t),
+        .value_size = sizeof(uint64_t),
+        .max_entries = n,
+    };
+    struct ubpf_map map = wrap_map(&def, ubpf_lpm_dir24_ops,
+                                   ubpf_lpm_dir24_create(&def));
+
+    benchmark_lpm_map("lpm-dir24", &map, n);
+}
+
+/* Ternary map: every entry shares an all-ones mask, so lookups hit a
+ * single tuple; distinct priorities exercise the priority bookkeeping.
+ * Deletes recompute tuple priorities, so 'n' stays capped. */
+static void
+benchmark_ternary(void)
+{
+    unsigned int n = MIN(n_entries, 4096);
+    struct ubpf_map_def def = {
+        .type = UBPF_MAP_TYPE_TERNARY,
+        .key_size = sizeof(uint64_t),
+        .value_size = sizeof(uint64_t),
+        .max_entries = n,
+    };
+    struct ubpf_map map = wrap_map(&def, ubpf_ternary_ops,
+                                   ubpf_ternary_create(&def));
+    struct {
+        struct ubpf_ternary_key hdr;
+        uint32_t value;
+        uint32_t mask;
+    } tkey;
+    uint64_t start;
+    unsigned int i;
+
+    start = ticks();
+    for (i = 0; i < n; i++) {
+        uint64_t value = i;
+
+        tkey.hdr.priority = i;
+        tkey.value = i;
+        tkey.mask = UINT32_MAX;
+        assert(!ubpf_map_update(&map, &tkey, &value));
+    }
+    report("ternary", "update", ticks() - start, n);
+
+    start = ticks();
+    for (i = 0; i < n_ops; i++) {
+        uint32_t key = i % n;
+
+        ignore(ubpf_map_lookup(&map, &key));
+    }
+    report("ternary", "lookup", ticks() - start, n_ops);
+
+    start = ticks();
+    for (i = 0; i < n; i++) {
+        tkey.hdr.priority = i;
+        tkey.value = i;
+        tkey.mask = UINT32_MAX;
+        ubpf_map_delete(&map, &tkey);
+    }
+    report("ternary", "delete", ticks() - start, n);
+
+    map.ops.map_destroy(&map);
+}
+
+/* Action selector: one group spread over capped member count, lookups
+ * rotate the selector hash the way a program-computed 5-tuple hash
+ * would. */
+static void
+benchmark_act_selector(void)
+{
+    unsigned int n = MIN(n_entries, 1024);
+    struct ubpf_map_def def = {
+        .type = UBPF_MAP_TYPE_ACT_SELECTOR,
+        .key_size = sizeof(struct ubpf_act_selector_key),
+        .value_size = 16,
+        .max_entries = n,
+    };
+    struct ubpf_map map = wrap_map(&def, ubpf_act_prof_ops,
+                                   ubpf_act_prof_create(&def));
+    uint32_t *mbrs = xmalloc(n * sizeof *mbrs);
+    char value[16];
+    uint64_t start;
+    uint32_t grp;
+    unsigned int i;
+
+    start = ticks();
+    for (i = 0; i < n; i++) {
+        memset(value, i, sizeof value);
+        assert(!ubpf_act_prof_member_create(&map, value, &mbrs[i]));
+    }
+    report("act-selector", "member", ticks() - start, n);
+
+    assert(!ubpf_act_prof_group_create(&map, &grp));
+    assert(!ubpf_act_prof_group_set_members(&map, grp, mbrs, n));
+
+    start = ticks();
+    for (i = 0; i < n_ops; i++) {
+        struct ubpf_act_selector_key key = { .group = grp, .hash = i };
+
+        ignore(ubpf_map_lookup(&map, &key));
+    }
+    report("act-selector", "lookup", ticks() - start, n_ops);
+
+    free(mbrs);
+    map.ops.map_destroy(&map);
+}
+
+/* Meter: one configuration per index, then time the data-plane
+ * color/token check. */
+static void
+benchmark_meter(void)
+{
+    struct ubpf_map_def def = {
+        .type = UBPF_MAP_TYPE_METER,
+        .key_size = sizeof(uint32_t),
+        .value_size = sizeof(struct ubpf_meter_config),
+        .max_entries = n_entries,
+    };
+    struct ubpf_map map = wrap_map(&def, ubpf_meter_ops,
+                                   ubpf_meter_create(&def));
+    struct ubpf_meter_config config = {
+        .cir = 1000000, .cbs = 100000,
+        .pir = 2000000, .pbs = 200000,
+    };
+    uint64_t start;
+    uint32_t key;
+    unsigned int i;
+
+    start = ticks();
+    for (key = 0; key < n_entries; key++) {
+        assert(!ubpf_map_update(&map, &key, &config));
+    }
+    report("meter", "update", ticks() - start, n_entries);
+
+    key = 0;
+    start = ticks();
+    for (i = 0; i < n_ops; i++) {
+        ignore(ubpf_meter_exec(&map, key, 64));
+        if (++key >= n_entries) {
+            key = 0;
+        }
+    }
+    report("meter", "exec", ticks() - start, n_ops);
+
+    map.ops.map_destroy(&map);
+}
+
+/* VM execution: a synthetic straight-line program in the shape of p4c
+ * output's ALU-heavy header rewriting, with a sprinkling of forward
+ * branches, run through the interpreter and (where available) the JIT. */
+#define VM_BENCH_BODY 512
+
+static struct ebpf_inst
+alu_inst(uint8_t opcode, uint8_t dst, int32_t imm)
+{
+    struct ebpf_inst inst = { .opcode = opcode, .dst = dst, .imm = imm };
+
+    return inst;
+}
+
+static void
+benchmark_vm(void)
+{
+    struct ubpf_vm *vm = ubpf_create(0);
+    struct ebpf_inst *insts = xmalloc((VM_BENCH_BODY + 2) * sizeof *insts);
+    struct standard_metadata md;
+    char buf[64], *errmsg;
+    unsigned int n_runs;
+    uint64_t start;
+    ubpf_jit_fn fn;
+    size_t n = 0;
+    unsigned int i;
+
+    insts[n++] = alu_inst(EBPF_OP_MOV64_IMM, 0, 1);
+    for (i = 0; i < VM_BENCH_BODY - 1; i++) {
+        switch (i % 128) {
+        case 42:
+            /* Never-taken forward branch. */
+            insts[n] = alu_inst(EBPF_OP_JEQ_IMM, 0, -1);
+            insts[n++].offset = 1;
+            break;
+        case 0:
+            insts[n++] = alu_inst(EBPF_OP_AND64_IMM, 0, 0xffffff);
+            break;
+        case 1:
+            insts[n++] = alu_inst(EBPF_OP_XOR64_IMM, 0, 0x5a5a);
+            break;
+        default:
+            insts[n++] = alu_inst(EBPF_OP_ADD64_IMM, 0, 7);
+            break;
+        }
+    }
+    insts[n].opcode = EBPF_OP_EXIT;
+    insts[n].dst = 0;
+    insts[n].imm = 0;
+    n++;
+
+    errmsg = NULL;
+    if (ubpf_load(vm, insts, n * sizeof *insts, &errmsg)) {
+        ovs_fatal(0, "benchmark program rejected: %s", errmsg);
+    }
+
+    memset(buf, 0, sizeof buf);
+    memset(&md, 0, sizeof md);
+    n_runs = MAX(n_ops / VM_BENCH_BODY, 1);
+
+    start = ticks();
+    for (i = 0; i < n_runs; i++) {
+        ignore(ubpf_exec(vm, buf, sizeof buf));
+    }
+    report("vm-interpreter", "run", ticks() - start, n_runs);
+    report("vm-interpreter", "insn", ticks() - start, n_runs * n);
+
+    fn = ubpf_compile(vm, &errmsg);
+    if (!fn) {
+        printf("vm-jit: skipped (%s)\n", errmsg);
+        free(errmsg);
+    } else {
+        start = ticks();
+        for (i = 0; i < n_runs; i++) {
+            ignore(fn(buf, &md));
+        }
+        report("vm-jit", "run", ticks() - start, n_runs);
+        report("vm-jit", "insn", ticks() - start, n_runs * n);
+    }
+
+    ubpf_destroy(vm);
+    free(insts);
+}
+
+/* End-to-end pipeline packet-rate benchmark: parameterized packet mixes
+ * generated in memory and pushed through the same batch entry point the
+ * PMD uses, for both the JIT and the interpreter. */
+
+#define PIPELINE_BATCH 32
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+/* Loads a handcrafted parse-and-hash program shaped like p4c parser
+ * output: guard on the packet length, pull Ethernet and IPv4 header
+ * fields, hash the packet start and fold everything into the verdict. */
+static struct ubpf_vm *
+load_pipeline_program(void)
+{
+    struct ebpf_inst insts[] = {
+        /* r6 = ctx; r0 = ubpf_packet_data(ctx); r7 = r0. */
+        { .opcode = EBPF_OP_MOV64_REG, .dst = 6, .src = 1 },
+        { .opcode = EBPF_OP_CALL, .imm = 9 },
+        { .opcode = EBPF_OP_MOV64_REG, .dst = 7, .src = 0 },
+        /* if (packet_length < 42) return 0. */
+        { .opcode = EBPF_OP_JGE_IMM, .dst = 2, .offset = 2, .imm = 42 },
+        { .opcode = EBPF_OP_MOV64_IMM, .dst = 0, .imm = 0 },
+        { .opcode = EBPF_OP_EXIT },
+        /* EtherType and the IPv4 address pair. */
+        { .opcode = EBPF_OP_LDXH, .dst = 3, .src = 7, .offset = 12 },
+        { .opcode = EBPF_OP_LDXW, .dst = 4, .src = 7, .offset = 26 },
+        { .opcode = EBPF_OP_LDXW, .dst = 5, .src = 7, .offset = 30 },
+        { .opcode = EBPF_OP_XOR64_REG, .dst = 4, .src = 5 },
+        { .opcode = EBPF_OP_ADD64_REG, .dst = 4, .src = 3 },
+        /* r0 = ubpf_hash(pkt, 8) ^ r4, masked to a verdict. */
+        { .opcode = EBPF_OP_MOV64_REG, .dst = 1, .src = 7 },
+        { .opcode = EBPF_OP_MOV64_IMM, .dst = 2, .imm = 8 },
+        { .opcode = EBPF_OP_CALL, .imm = 6 },
+        { .opcode = EBPF_OP_XOR64_REG, .dst = 0, .src = 4 },
+        { .opcode = EBPF_OP_AND64_IMM, .dst = 0, .imm = 1 },
+        { .opcode = EBPF_OP_EXIT },
+    };
+    struct ubpf_vm *vm = create_ubpf_vm(0);
+    char *errmsg = NULL;
+
+    if (ubpf_load(vm, insts, sizeof insts, &errmsg)) {
+        ovs_fatal(0, "pipeline program rejected: %s", errmsg);
+    }
+    return vm;
+}
+
+/* A minimal Ethernet/IPv4/UDP frame with per-flow addresses. */
+static struct dp_packet *
+make_packet(uint32_t flow, unsigned int size)
+{
+    struct dp_packet *packet = dp_packet_new(size);
+    uint8_t *data = dp_packet_put_zeros(packet, size);
+
+    memset(data, 0x02, 12);             /* Locally administered MACs. */
+    data[12] = 0x08;                    /* EtherType: IPv4. */
+    data[14] = 0x45;                    /* Version and IHL. */
+    data[23] = 17;                      /* Protocol: UDP. */
+    data[26] = 0x0a;                    /* Source: 10.x.y.z per flow. */
+    data[27] = flow >> 16;
+    data[28] = flow >> 8;
+    data[29] = flow;
+    data[30] = 0xc0;                    /* Destination: 192.x.y.z. */
+    data[31] = flow >> 16;
+    data[32] = flow >> 8;
+    data[33] = flow;
+    return packet;
+}
+
+static void
+report_pipeline(const char *mix, const char *engine, uint64_t n_pkts,
+                uint64_t elapsed_ns, uint64_t elapsed_ticks)
+{
+    printf("%-8s %-12s %7.2f Mpps  %8.1f " TICK_UNIT "/packet\n",
+           mix, engine, n_pkts * 1000.0 / elapsed_ns,
+           elapsed_ticks / (double) n_pkts);
+}
+
+static void
+benchmark_pipeline_mix(struct ubpf_vm *vm, const char *mix,
+                       const unsigned int *sizes, size_t n_sizes)
+{
+    struct ubpf_batch_entry entries[PIPELINE_BATCH];
+    struct standard_metadata mds[PIPELINE_BATCH];
+    struct dp_packet *pkts[PIPELINE_BATCH];
+    unsigned int n_rounds = MAX(n_ops / PIPELINE_BATCH, 1);
+    uint64_t n_pkts = (uint64_t) n_rounds * PIPELINE_BATCH;
+    uint64_t start_ns, start;
+    unsigned int i, r;
+
+    for (i = 0; i < PIPELINE_BATCH; i++) {
+        unsigned int size = sizes[i % n_sizes];
+
+        pkts[i] = make_packet(i, size);
+        memset(&mds[i], 0, sizeof mds[i]);
+        mds[i].input_port = 1;
+        mds[i].packet_length = size;
+        entries[i].mem = pkts[i];
+        entries[i].md = &mds[i];
+    }
+
+    if (vm->jitted) {
+        ubpf_handle_packet_batch(vm, entries, PIPELINE_BATCH); /* Warm up. */
+        start_ns = now_ns();
+        start = ticks();
+        for (r = 0; r < n_rounds; r++) {
+            ubpf_handle_packet_batch(vm, entries, PIPELINE_BATCH);
+        }
+        report_pipeline(mix, "jit", n_pkts, now_ns() - start_ns,
+                        ticks() - start);
+    }
+
+    start_ns = now_ns();
+    start = ticks();
+    for (r = 0; r < n_rounds; r++) {
+        for (i = 0; i < PIPELINE_BATCH; i++) {
+            ignore(ubpf_exec(vm, pkts[i], (uintptr_t) &mds[i]));
+        }
+    }
+    report_pipeline(mix, "interpreter", n_pkts, now_ns() - start_ns,
+                    ticks() - start);
+
+    for (i = 0; i < PIPELINE_BATCH; i++) {
+        dp_packet_delete(pkts[i]);
+    }
+}
+
+static void
+run_pipeline_benchmarks(struct ovs_cmdl_context *ctx)
+{
+    static const unsigned int size_64[] = { 64 };
+    static const unsigned int size_512[] = { 512 };
+    static const unsigned int size_1518[] = { 1518 };
+    /* Classic 7:4:1 IMIX. */
+    static const unsigned int size_imix[] = {
+        64, 64, 64, 64, 64, 64, 64, 576, 576, 576, 576, 1518,
+    };
+    struct ubpf_vm *vm;
+    char *errmsg = NULL;
+
+    n_ops = ctx->argc > 1 ? strtol(ctx->argv[1], NULL, 10) : 4 * 1024 * 1024;
+
+    vm = load_pipeline_program();
+    if (!ubpf_compile(vm, &errmsg)) {
+        printf("JIT unavailable, interpreter only (%s)\n", errmsg);
+        free(errmsg);
+    }
+
+    printf("Pipeline benchmark, %u packets per engine and mix:\n", n_ops);
+    benchmark_pipeline_mix(vm, "64B", size_64, ARRAY_SIZE(size_64));
+    benchmark_pipeline_mix(vm, "512B", size_512, ARRAY_SIZE(size_512));
+    benchmark_pipeline_mix(vm, "1518B", size_1518, ARRAY_SIZE(size_1518));
+    benchmark_pipeline_mix(vm, "imix", size_imix, ARRAY_SIZE(size_imix));
+
+    ubpf_destroy(vm);
+}
+
+static void
+run_benchmarks(struct ovs_cmdl_context *ctx)
+{
+    n_entries = ctx->argc > 1 ? strtol(ctx->argv[1], NULL, 10) : 65536;
+    n_ops = ctx->argc > 2 ? strtol(ctx->argv[2], NULL, 10) : 4 * 1024 * 1024;
+
+    printf("Benchmarking with %u entries, %u operations:\n",
+           n_entries, n_ops);
+
+    benchmark_array();
+    benchmark_percpu_array();
+    benchmark_hashmap();
+    benchmark_percpu_hashmap();
+    benchmark_bloomfilter();
+    benchmark_countmin();
+    benchmark_lpm_trie();
+    benchmark_lpm_dir24();
+    benchmark_ternary();
+    benchmark_act_selector();
+    benchmark_meter();
+    putchar('\n');
+    benchmark_vm();
+}
+
+static const struct ovs_cmdl_command commands[] = {
+    {"benchmark", NULL, 0, 2, run_benchmarks, OVS_RO},
+    {"benchmark-pipeline", NULL, 0, 1, run_pipeline_benchmarks, OVS_RO},
+    {NULL, NULL, 0, 0, NULL, OVS_RO},
+};
+
+static void
+test_ubpf_main(int argc, char *argv[])
+{
+    struct ovs_cmdl_context ctx = {
+        .argc = argc - optind,
+        .argv = argv + optind,
+    };
+
+    set_program_name(argv[0]);
+    ovs_cmdl_run_command(&ctx, commands);
+}
+
+OVSTEST_REGISTER("test-ubpf", test_ubpf_main);
@@ -51,6 +51,7 @@
 #include "openvswitch/vlog.h"
 #include "ovs-lldp.h"
 #include "ovs-numa.h"
+#include "ovs-thread.h"
 #include "packets.h"
 #include "openvswitch/poll-loop.h"
 #include "seq.h"
@@ -91,6 +92,10 @@ struct iface {
     ofp_port_t ofp_port;        /* OpenFlow port number. */
     uint64_t change_seq;
 
+    /* Hash of the statistics map last written to the database, so unchanged
+     * statistics are not rebuilt and rewritten on every sweep. */
+    uint32_t stats_hash;
+
     /* These members are valid only within bridge_reconfigure(). */
     const char *type;           /* Usually same as cfg->type. */
     const struct ovsrec_interface *cfg;
@@ -212,6 +217,11 @@ static struct ovsdb_idl_txn *daemonize_txn;
 /* Most recently processed IDL sequence number. */
 static unsigned int idl_seqno;
 
+/* IDL sequence number that bridge_reconfigure() most recently caught up with.
+ * Rows whose change sequence number is greater than this changed since then.
+ * Zero forces the next reconfiguration to treat every bridge as changed. */
+static unsigned int reconfigure_cutoff_seqno;
+
 /* Track changes to port connectivity. */
 static uint64_t connectivity_seqno = LLONG_MIN;
 
@@ -339,8 +349,11 @@ static bool mirror_configure(struct mirror *);
 static void mirror_refresh_stats(struct mirror *);
 
 static void iface_configure_lacp(struct iface *, struct lacp_slave_settings *);
-static bool iface_create(struct bridge *, const struct ovsrec_interface *,
-                         const struct ovsrec_port *);
+struct iface_open_task;
+static bool iface_create(struct bridge *, struct iface_open_task *);
+static int iface_open_netdev(const struct bridge *,
+                             const struct ovsrec_interface *,
+                             struct netdev **, char **errp);
 static bool iface_is_internal(const struct ovsrec_interface *iface,
                               const struct ovsrec_bridge *br);
 static const char *iface_get_type(const struct ovsrec_interface *,
@@ -535,6 +548,19 @@ bridge_init(const char *remote)
 
     ovsdb_idl_omit(idl, &ovsrec_ssl_col_external_ids);
 
+    /* Track changes to the columns configured above, so that
+     * bridge_reconfigure() can tell which bridges' rows (or rows they
+     * reference) actually changed and skip the rest. */
+    ovsdb_idl_track_add_monitored(idl);
+
+    /* Persist the replica across restarts, so that a restarted ovs-vswitchd
+     * can start reconfiguring from the cached contents right away and only
+     * fetch the changes made in the meantime from the database. */
+    char *snapshot_file = xasprintf("%s/ovs-vswitchd.snapshot",
+                                    ovs_rundir());
+    ovsdb_idl_set_snapshot_file(idl, snapshot_file);
+    free(snapshot_file);
+
     /* Register unixctl commands. */
     unixctl_command_register("qos/show-types", "interface", 1, 1,
                              qos_unixctl_show_types, NULL);
@@ -871,6 +897,23 @@ bridge_update_p4rt_device_id(struct bridge *br, uint64_t dev_id)
     free(device_id);
 }
 
+/* Returns true if 'br''s row in the Bridge table, or any row that it
+ * references directly or indirectly (ports, interfaces, controllers, QoS and
+ * so on), changed since the IDL sequence number 'cutoff'.  Change tracking
+ * marks a row as modified whenever a row it references changes, so this is a
+ * complete test. */
+static bool
+bridge_changed_since(const struct bridge *br, unsigned int cutoff)
+{
+    const struct ovsrec_bridge *cfg = br->cfg;
+
+    return (!cfg
+            || ovsrec_bridge_row_get_seqno(cfg,
+                                           OVSDB_IDL_CHANGE_INSERT) > cutoff
+            || ovsrec_bridge_row_get_seqno(cfg,
+                                           OVSDB_IDL_CHANGE_MODIFY) > cutoff);
+}
+
 static void
 bridge_reconfigure(const struct ovsrec_open_vswitch *ovs_cfg)
 {
@@ -989,12 +1032,34 @@ bridge_reconfigure(const struct ovsrec_open_vswitch *ovs_cfg)
     datapath_reconfigure(ovs_cfg);
 
 
-    /* Complete the configuration. */
+    /* Complete the configuration.  This is the expensive part: it pushes the
+     * whole configuration of every bridge down to ofproto, so skip bridges
+     * whose subtree of rows did not change.  A change to the Open_vSwitch row
+     * itself (which includes the manager configuration that feeds the in-band
+     * managers below) disables the fast path for this round. */
+    bool all_changed
+        = (!reconfigure_cutoff_seqno
+           || (ovsrec_open_vswitch_row_get_seqno(ovs_cfg,
+                                                 OVSDB_IDL_CHANGE_INSERT)
+               > reconfigure_cutoff_seqno)
+           || (ovsrec_open_vswitch_row_get_seqno(ovs_cfg,
+                                                 OVSDB_IDL_CHANGE_MODIFY)
+               > reconfigure_cutoff_seqno));
     sflow_bridge_number = 0;
     collect_in_band_managers(ovs_cfg, &managers, &n_managers);
     HMAP_FOR_EACH (br, node, &all_bridges) {
         struct port *port;
 
+        if (!all_changed
+            && !bridge_changed_since(br, reconfigure_cutoff_seqno)) {
+            /* Keep the sFlow sub-agent numbering stable for the bridges that
+             * do get reconfigured. */
+            if (!br->p4 && br->cfg->sflow) {
+                sflow_bridge_number++;
+            }
+            continue;
+        }
+
         /* We need the datapath ID early to allow LACP ports to use it as the
          * default system ID. */
         if (!br->p4) {
@@ -1293,42 +1358,148 @@ bridge_delete_or_reconfigure_ports(struct bridge *br)
     sset_destroy(&ofproto_ports);
 }
 
+/* Opening and configuring the network device dominates the cost of adding a
+ * port, and for independent interfaces that work has no ordering
+ * requirement, so bridge_add_ports() runs it from a temporary pool of
+ * threads.  Only the attachment to the ofproto, which assigns port numbers,
+ * runs serially afterwards. */
+#define IFACE_OPEN_MAX_THREADS 8
+
+struct iface_open_task {
+    /* Input. */
+    const struct bridge *br;
+    const struct ovsrec_interface *iface_cfg;
+    const struct ovsrec_port *port_cfg;
+
+    /* Output. */
+    struct netdev *netdev;
+    int error;
+    char *errp;
+};
+
+struct iface_open_pool {
+    struct iface_open_task *tasks;
+    size_t n_tasks;
+    atomic_count next_task;
+};
+
+static void *
+iface_open_thread(void *pool_)
+{
+    struct iface_open_pool *pool = pool_;
+
+    for (;;) {
+        unsigned int i = atomic_count_inc(&pool->next_task);
+        struct iface_open_task *task;
+
+        if (i >= pool->n_tasks) {
+            return NULL;
+        }
+        task = &pool->tasks[i];
+        task->error = iface_open_netdev(task->br, task->iface_cfg,
+                                        &task->netdev, &task->errp);
+    }
+}
+
 static void
-bridge_add_ports__(struct bridge *br, const struct shash *wanted_ports,
+bridge_add_ports__(struct bridge *br, struct iface_open_pool *pool,
                    bool with_requested_port)
 {
+    size_t i;
+
+    for (i = 0; i < pool->n_tasks; i++) {
+        struct iface_open_task *task = &pool->tasks[i];
+        ofp_port_t requested_ofp_port;
+
+        requested_ofp_port = iface_get_requested_ofp_port(task->iface_cfg);
+        if ((requested_ofp_port != OFPP_NONE) == with_requested_port) {
+            if (iface_lookup(br, task->iface_cfg->name)) {
+                /* Duplicate interface name within this batch; as before,
+                 * only the first one wins. */
+                netdev_close(task->netdev);
+            } else {
+                iface_create(br, task);
+            }
+            free(task->errp);
+        }
+    }
+}
+
+static void
+bridge_add_ports(struct bridge *br, const struct shash *wanted_ports)
+{
+    struct iface_open_pool pool;
     struct shash_node *port_node;
+    size_t allocated = 0;
+    size_t n_threads;
+    size_t i;
 
+    /* Collect the interfaces to be created. */
+    pool.tasks = NULL;
+    pool.n_tasks = 0;
     SHASH_FOR_EACH (port_node, wanted_ports) {
         const struct ovsrec_port *port_cfg = port_node->data;
-        size_t i;
 
         for (i = 0; i < port_cfg->n_interfaces; i++) {
             const struct ovsrec_interface *iface_cfg = port_cfg->interfaces[i];
-            ofp_port_t requested_ofp_port;
 
-            requested_ofp_port = iface_get_requested_ofp_port(iface_cfg);
-            if ((requested_ofp_port != OFPP_NONE) == with_requested_port) {
-                struct iface *iface = iface_lookup(br, iface_cfg->name);
+            if (!iface_lookup(br, iface_cfg->name)) {
+                struct iface_open_task *task;
 
-                if (!iface) {
-                    iface_create(br, iface_cfg, port_cfg);
+                if (pool.n_tasks >= allocated) {
+                    pool.tasks = x2nrealloc(pool.tasks, &allocated,
+                                            sizeof *pool.tasks);
                 }
+                task = &pool.tasks[pool.n_tasks++];
+                task->br = br;
+                task->iface_cfg = iface_cfg;
+                task->port_cfg = port_cfg;
+                task->netdev = NULL;
+                task->error = 0;
+                task->errp = NULL;
             }
         }
     }
-}
 
-static void
-bridge_add_ports(struct bridge *br, const struct shash *wanted_ports)
-{
+    /* Open and configure the network devices in parallel. */
+    atomic_count_init(&pool.next_task, 0);
+    n_threads = MIN(pool.n_tasks, IFACE_OPEN_MAX_THREADS);
+    if (n_threads > 1) {
+        pthread_t *threads = xmalloc(n_threads * sizeof *threads);
+
+        for (i = 0; i < n_threads; i++) {
+            threads[i] = ovs_thread_create("iface_open", iface_open_thread,
+                                           &pool);
+        }
+        for (i = 0; i < n_threads; i++) {
+            xpthread_join(threads[i], NULL);
+        }
+        free(threads);
+    } else if (pool.n_tasks) {
+        iface_open_thread(&pool);
+    }
+
     /* First add interfaces that request a particular port number. */
-    bridge_add_ports__(br, wanted_ports, true);
+    bridge_add_ports__(br, &pool, true);
 
     /* Then add interfaces that want automatic port number assignment.
      * We add these afterward to avoid accidentally taking a specifically
      * requested port number. */
-    bridge_add_ports__(br, wanted_ports, false);
+    bridge_add_ports__(br, &pool, false);
+
+    /* Populate initial status in the database for the new interfaces in one
+     * batch, so the writebacks coalesce into the enclosing transaction
+     * instead of interleaving with port instantiation. */
+    for (i = 0; i < pool.n_tasks; i++) {
+        struct iface *iface = iface_lookup(br, pool.tasks[i].iface_cfg->name);
+
+        if (iface) {
+            iface_refresh_stats(iface);
+            iface_refresh_netdev_status(iface);
+        }
+    }
+
+    free(pool.tasks);
 }
 
 static void
@@ -2166,16 +2337,16 @@ iface_set_netdev_config(const struct ovsrec_interface *iface_cfg,
     return netdev_set_config(netdev, &iface_cfg->options, errp);
 }
 
-/* Opens a network device for 'if_cfg' and configures it.  Adds the network
- * device to br->ofproto and stores the OpenFlow port number in '*ofp_portp'.
+/* Opens a network device for 'iface_cfg' and configures it.  This is the
+ * part of interface creation that is independent of other interfaces, so it
+ * may run from the iface_open_thread() pool.
  *
  * If successful, returns 0 and stores the network device in '*netdevp'.  On
  * failure, returns a positive errno value and stores NULL in '*netdevp'. */
 static int
-iface_do_create(const struct bridge *br,
-                const struct ovsrec_interface *iface_cfg,
-                ofp_port_t *ofp_portp, struct netdev **netdevp,
-                char **errp)
+iface_open_netdev(const struct bridge *br,
+                  const struct ovsrec_interface *iface_cfg,
+                  struct netdev **netdevp, char **errp)
 {
     struct netdev *netdev = NULL;
     int error;
@@ -2210,6 +2381,28 @@ iface_do_create(const struct bridge *br,
 
     iface_set_netdev_mtu(iface_cfg, netdev);
 
+    *netdevp = netdev;
+    return 0;
+
+error:
+    *netdevp = NULL;
+    netdev_close(netdev);
+    return error;
+}
+
+/* Adds the already opened and configured 'netdev' for 'iface_cfg' to
+ * br->ofproto and stores the OpenFlow port number in '*ofp_portp'.  Takes
+ * ownership of 'netdev': it is closed on failure.
+ *
+ * Returns 0 if successful, otherwise a positive errno value. */
+static int
+iface_do_create(const struct bridge *br,
+                const struct ovsrec_interface *iface_cfg,
+                struct netdev *netdev, ofp_port_t *ofp_portp,
+                char **errp)
+{
+    int error;
+
     *ofp_portp = iface_pick_ofport(iface_cfg);
     ofp_port_t requested_port = *ofp_portp;
     if (!br->p4) {
@@ -2227,47 +2420,44 @@ iface_do_create(const struct bridge *br,
             VLOG_WARN("%s", *errp);
         }
 
-        goto error;
+        netdev_close(netdev);
+        return error;
     }
 
     VLOG_INFO("bridge %s: added interface %s on port %d",
               br->name, iface_cfg->name, *ofp_portp);
 
-    *netdevp = netdev;
     return 0;
-
-error:
-    *netdevp = NULL;
-    netdev_close(netdev);
-    return error;
 }
 
-/* Creates a new iface on 'br' based on 'if_cfg'.  The new iface has OpenFlow
- * port number 'ofp_port'.  If ofp_port is OFPP_NONE, an OpenFlow port is
- * automatically allocated for the iface.  Takes ownership of and
- * deallocates 'if_cfg'.
+/* Creates a new iface on 'br' from 'task', whose network device was already
+ * opened by the iface_open_thread() pool.  Takes ownership of the task's
+ * netdev.
  *
  * Return true if an iface is successfully created, false otherwise. */
 static bool
-iface_create(struct bridge *br, const struct ovsrec_interface *iface_cfg,
-             const struct ovsrec_port *port_cfg)
+iface_create(struct bridge *br, struct iface_open_task *task)
 {
-    struct netdev *netdev;
+    const struct ovsrec_interface *iface_cfg = task->iface_cfg;
+    const struct ovsrec_port *port_cfg = task->port_cfg;
+    struct netdev *netdev = task->netdev;
     struct iface *iface;
     ofp_port_t ofp_port;
     struct port *port;
-    char *errp = NULL;
     int error;
 
     /* Do the bits that can fail up front. */
     ovs_assert(!iface_lookup(br, iface_cfg->name));
-    error = iface_do_create(br, iface_cfg, &ofp_port, &netdev, &errp);
+    error = task->error;
+    if (!error) {
+        error = iface_do_create(br, iface_cfg, netdev, &ofp_port,
+                                &task->errp);
+    }
     if (error) {
         if (br->p4 && iface_cfg->ofport_request) {
             ovsrec_interface_update_ofport_request_delvalue(iface_cfg, *iface_cfg->ofport_request);
         }
-        iface_clear_db_record(iface_cfg, errp);
-        free(errp);
+        iface_clear_db_record(iface_cfg, task->errp);
         return false;
     }
 
@@ -2291,10 +2481,6 @@ iface_create(struct bridge *br, const struct ovsrec_interface *iface_cfg,
     hmap_insert(&br->ifaces, &iface->ofp_port_node,
                 hash_ofp_port(ofp_port));
 
-    /* Populate initial status in database. */
-    iface_refresh_stats(iface);
-    iface_refresh_netdev_status(iface);
-
     /* Add bond fake iface if necessary. */
     if (port_is_bond_fake_iface(port)) {
         struct ofproto_port ofproto_port;
@@ -2791,7 +2977,7 @@ iface_refresh_stats(struct iface *iface)
     struct netdev_custom_stats custom_stats;
     struct netdev_stats stats;
     int n;
-    uint32_t i, counters_size;
+    uint32_t i, counters_size, hash;
 
 #define IFACE_STATS                             \
     IFACE_STAT(rx_packets,              "rx_packets")               \
@@ -2869,7 +3055,16 @@ iface_refresh_stats(struct iface *iface)
 
     ovs_assert(n <= counters_size);
 
-    ovsrec_interface_set_statistics(iface->cfg, keys, values, n);
+    /* Only dirty the database column if some value actually changed;
+     * idle interfaces then contribute nothing to the transaction. */
+    hash = hash_bytes(values, n * sizeof *values, n);
+    for (i = 0; i < n; i++) {
+        hash = hash_string(keys[i], hash);
+    }
+    if (hash != iface->stats_hash) {
+        ovsrec_interface_set_statistics(iface->cfg, keys, values, n);
+        iface->stats_hash = hash;
+    }
 #undef IFACE_STATS
 
     free(values);
@@ -3516,14 +3711,22 @@ bridge_run(void)
         stream_ssl_set_ca_cert_file(ssl->ca_cert, ssl->bootstrap_ca_cert);
     }
 
-    if (ovsdb_idl_get_seqno(idl) != idl_seqno ||
-        if_notifier_changed(ifnotifier)) {
+    bool datapath_changed = if_notifier_changed(ifnotifier);
+    if (ovsdb_idl_get_seqno(idl) != idl_seqno || datapath_changed) {
         struct ovsdb_idl_txn *txn;
 
+        /* A datapath change arrives outside the database, so the per-row
+         * change sequence numbers say nothing about it; reconfigure
+         * everything in that case. */
+        reconfigure_cutoff_seqno = datapath_changed || !cfg ? 0 : idl_seqno;
         idl_seqno = ovsdb_idl_get_seqno(idl);
         txn = ovsdb_idl_txn_create(idl);
         bridge_reconfigure(cfg ? cfg : &null_cfg);
 
+        /* The tracked changes have been consumed.  Dropping them also frees
+         * the rows that were deleted, so this must happen every round. */
+        ovsdb_idl_track_clear(idl);
+
         if (cfg) {
             ovsrec_open_vswitch_set_cur_cfg(cfg, cfg->next_cfg);
             discover_types(cfg);
@@ -5356,6 +5559,10 @@ mirror_configure(struct mirror *m)
         s.snaplen = 0;
     }
 
+    /* Get rate limit.  The database constrains the range. */
+    s.rate_limit = cfg->rate_limit ? *cfg->rate_limit : 0;
+    s.burst_limit = cfg->burst_limit ? *cfg->burst_limit : 0;
+
     /* Get port selection. */
     if (cfg->select_all) {
         size_t n_ports = hmap_count(&m->bridge->ports);
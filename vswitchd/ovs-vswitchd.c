@@ -42,6 +42,7 @@
 #include "ovs-thread.h"
 #include "openvswitch/poll-loop.h"
 #include "simap.h"
+#include "stats-shm.h"
 #include "stream-ssl.h"
 #include "stream.h"
 #include "svec.h"
@@ -59,6 +60,11 @@ VLOG_DEFINE_THIS_MODULE(vswitchd);
  * the kernel from paging any of its memory to disk. */
 static bool want_mlockall;
 
+/* Maximum time, in milliseconds, that housekeeping (appctl commands, netdev
+ * status refresh, memory reports) may be deferred in favor of
+ * datapath-critical work. */
+#define HOUSEKEEPING_DEADLINE_MSEC 200
+
 static unixctl_cb_func ovs_vswitchd_exit;
 
 static char *parse_options(int argc, char *argv[], char **unixctl_path);
@@ -75,7 +81,8 @@ main(int argc, char *argv[])
     char *unixctl_path = NULL;
     struct unixctl_server *unixctl;
     char *remote;
-    bool exiting, cleanup;
+    bool exiting, cleanup, housekeeping;
+    long long int next_housekeeping;
     struct ovs_vswitchd_exit_args exit_args = {&exiting, &cleanup};
     int retval;
 
@@ -109,29 +116,54 @@ main(int argc, char *argv[])
     unixctl_command_register("exit", "[--cleanup]", 0, 1,
                              ovs_vswitchd_exit, &exit_args);
 
+    stats_shm_enable();
+
     bridge_init(remote);
     free(remote);
 
     exiting = false;
     cleanup = false;
+    next_housekeeping = LLONG_MIN;
     while (!exiting) {
-        memory_run();
-        if (memory_should_report()) {
-            struct simap usage;
-
-            simap_init(&usage);
-            bridge_get_memory_usage(&usage);
-            memory_report(&usage);
-            simap_destroy(&usage);
+        /* When a datapath-critical waiter (registered by bridge_wait() and
+         * below) woke us, give bridge_run() the whole iteration and defer
+         * housekeeping, so a slow appctl command or netdev status refresh
+         * cannot delay flow installation.  The deadline keeps housekeeping
+         * from starving under sustained datapath pressure. */
+        housekeeping = (poll_woke_class() != POLL_WAIT_CRITICAL
+                        || time_msec() >= next_housekeeping);
+
+        if (housekeeping) {
+            memory_run();
+            if (memory_should_report()) {
+                struct simap usage;
+
+                simap_init(&usage);
+                bridge_get_memory_usage(&usage);
+                memory_report(&usage);
+                simap_destroy(&usage);
+            }
         }
         bridge_run();
-        unixctl_server_run(unixctl);
-        netdev_run();
+        if (housekeeping) {
+            unixctl_server_run(unixctl);
+            netdev_run();
+            next_housekeeping = time_msec() + HOUSEKEEPING_DEADLINE_MSEC;
+        }
 
+        poll_set_wait_class(POLL_WAIT_BACKGROUND);
         memory_wait();
+        poll_set_wait_class(POLL_WAIT_CRITICAL);
         bridge_wait();
+        poll_set_wait_class(POLL_WAIT_BACKGROUND);
         unixctl_server_wait(unixctl);
         netdev_wait();
+        poll_set_wait_class(POLL_WAIT_DEFAULT);
+        if (!housekeeping) {
+            /* Deferred work still pending; make sure we come back for it by
+             * its deadline at the latest. */
+            poll_timer_wait_until(next_housekeeping);
+        }
         if (exiting) {
             poll_immediate_wake();
         }